@@ -62,13 +62,13 @@
 #define configUSE_PREEMPTION                     1
 #define configSUPPORT_STATIC_ALLOCATION          1
 #define configSUPPORT_DYNAMIC_ALLOCATION         1
-#define configUSE_IDLE_HOOK                      0
+#define configUSE_IDLE_HOOK                      1
 #define configUSE_TICK_HOOK                      0
 #define configCPU_CLOCK_HZ                       ( SystemCoreClock )
 #define configTICK_RATE_HZ                       ((TickType_t)1000)
 #define configMAX_PRIORITIES                     ( 56 )
 #define configMINIMAL_STACK_SIZE                 ((uint16_t)128)
-#define configTOTAL_HEAP_SIZE                    ((size_t)20480)
+#define configTOTAL_HEAP_SIZE                    ((size_t)1024)
 #define configMAX_TASK_NAME_LEN                  ( 16 )
 #define configUSE_TRACE_FACILITY                 1
 #define configUSE_16_BIT_TICKS                   0
@@ -168,6 +168,15 @@ standard names. */
 
 /* USER CODE BEGIN Defines */
 /* Section where parameter definitions can be added (for instance, to override default ones in FreeRTOS.h) */
+// Per task run time, counted by TIM5 (see cpuStats.c)
+#define configGENERATE_RUN_TIME_STATS            1
+#define INCLUDE_xTaskGetIdleTaskHandle           1
+#if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
+  #include CMSIS_device_header
+  extern void cpuStatsConfigureTimer(void);
+#endif
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() cpuStatsConfigureTimer()
+#define portGET_RUN_TIME_COUNTER_VALUE()         (TIM5->CNT)
 /* USER CODE END Defines */
 
 #endif /* FREERTOS_CONFIG_H */
@@ -55,6 +55,11 @@
 
 /* Private application code --------------------------------------------------*/
 /* USER CODE BEGIN Application */
+// The main task now blocks between its passes, sleep until the next interrupt when no task is ready.
+void vApplicationIdleHook(void)
+{
+	__WFI();
+}
      
 /* USER CODE END Application */
 
@@ -30,6 +30,8 @@
 #include "functions/trx.h"
 #include "interfaces/gps.h"
 #include "functions/aprs.h"
+#include "functions/pocsag.h"
+#include "functions/perf.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -67,6 +69,7 @@ extern ADC_HandleTypeDef hadc1;
 extern ADC_HandleTypeDef hadc2;
 extern DAC_HandleTypeDef hdac;
 extern DMA_HandleTypeDef hdma_i2s3_ext_tx;
+extern DMA_HandleTypeDef hdma_spi2_tx;
 extern DMA_HandleTypeDef hdma_spi3_rx;
 extern DMA_HandleTypeDef hdma_usart1_rx;
 extern UART_HandleTypeDef huart1;
@@ -232,6 +235,20 @@ void DMA1_Stream0_IRQHandler(void)
   /* USER CODE END DMA1_Stream0_IRQn 1 */
 }
 
+/**
+  * @brief This function handles DMA1 stream4 global interrupt.
+  */
+void DMA1_Stream4_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Stream4_IRQn 0 */
+
+  /* USER CODE END DMA1_Stream4_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_spi2_tx);
+  /* USER CODE BEGIN DMA1_Stream4_IRQn 1 */
+
+  /* USER CODE END DMA1_Stream4_IRQn 1 */
+}
+
 /**
   * @brief This function handles DMA1 stream5 global interrupt.
   */
@@ -310,6 +327,7 @@ void TIM6_DAC_IRQHandler(void)
 {
   /* USER CODE BEGIN TIM6_DAC_IRQn 0 */
   aprsBitStreamSender();
+  pocsagBitStreamSender();
   /* USER CODE END TIM6_DAC_IRQn 0 */
   HAL_DAC_IRQHandler(&hdac);
   HAL_TIM_IRQHandler(&htim6);
@@ -372,21 +390,25 @@ void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
 	{
 		if (GPIO_Pin == GPIO_PIN_0)
 		{
+			PERF_BEGIN(PERF_PROBE_HRC_TIMESLOT_IRQ);
 			hrc6000SetInIRQHandler(true);
 			hrc6000TimeslotInterruptHandler();
 			hrc6000SetInIRQHandler(false);
+			PERF_END(PERF_PROBE_HRC_TIMESLOT_IRQ);
 		}
 		else if (GPIO_Pin == GPIO_PIN_1)
 		{
-			hrc6000SetInIRQHandler(true);
-			hrc6000SysInterruptHandler();
-			hrc6000SetInIRQHandler(false);
+			PERF_BEGIN(PERF_PROBE_HRC_SYS_IRQ);
+			hrc6000SysInterruptCapture(); // the processing is deferred to a task
+			PERF_END(PERF_PROBE_HRC_SYS_IRQ);
 		}
 		else if (GPIO_Pin == GPIO_PIN_2)
 		{
+			PERF_BEGIN(PERF_PROBE_HRC_TX_IRQ);
 			hrc6000SetInIRQHandler(true);
 			hrc6000TxInterruptHandler();
 			hrc6000SetInIRQHandler(false);
+			PERF_END(PERF_PROBE_HRC_TX_IRQ);
 		}
 	}
 
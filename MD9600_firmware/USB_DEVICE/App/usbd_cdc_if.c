@@ -24,7 +24,9 @@
 
 /* USER CODE BEGIN INCLUDE */
 #include "usb/usb_com.h"
+#include "usb/usb_benchmark.h"
 #include "functions/hotspot.h"
+#include "functions/scheduler.h"
 #if defined(HAS_GPS)
 #include "user_interface/uiGlobals.h"
 #include "interfaces/gps.h"
@@ -173,7 +175,7 @@ static int8_t CDC_Init_FS(void)
   com_request = 0;
   s_recvCount = 0;
   s_receivingBufferOffset = 0;
-  comRecvMMDVMIndexIn = comRecvMMDVMIndexOut = 0;
+  usbComMMDVMParserReset();
 
   return (USBD_OK);
   /* USER CODE END 3 */
@@ -287,46 +289,12 @@ static int8_t CDC_Receive_FS(uint8_t* Buf, uint32_t *Len)
 	{
 		if (settingsUsbMode == USB_MODE_HOTSPOT)
 		{
-			if (Buf[0] == MMDVM_FRAME_START)
-			{
-				if (recvSize >= 3) // The shortest MMDVMHost frame length is 3U
-				{
-					uint8_t frameLength = (uint8_t)recvSize;
-
-					s_recvCount = recvSize;
-
-					// We can't rely on the MMDVMHost's frame size, so we're managing
-					// the block size ourselves.
-					com_requestbuffer[comRecvMMDVMIndexIn++] = frameLength + 1;
-
-					// Make sure the index stays within limits.
-					if (comRecvMMDVMIndexIn >= COM_REQUESTBUFFER_SIZE)
-					{
-						comRecvMMDVMIndexIn = 0;
-					}
-
-					// Copy the MMDVMHost data
-					for (uint8_t i = 0; i < frameLength; i++)
-					{
-						com_requestbuffer[comRecvMMDVMIndexIn++] = Buf[i];
-
-						// Make sure the index stays within limits.
-						if (comRecvMMDVMIndexIn >= COM_REQUESTBUFFER_SIZE)
-						{
-							comRecvMMDVMIndexIn = 0;
-						}
-					}
-
-					// Make sure the index stays within limits.
-					if (comRecvMMDVMIndexIn >= COM_REQUESTBUFFER_SIZE)
-					{
-						comRecvMMDVMIndexIn = 0;
-					}
-
-					// Increment the frame counter
-					comRecvMMDVMFrameCount++;
-				}
-			}
+			// A short packet ends the USB transfer
+			usbComMMDVMParserFeed(Buf, recvSize, (recvSize < hUsbDeviceFS.ep_out[0].maxpacket));
+		}
+		else if (settingsUsbMode == USB_MODE_BENCHMARK)
+		{
+			usbBenchmarkFeed(Buf, recvSize);
 		}
 		else
 		{
@@ -345,7 +313,6 @@ static int8_t CDC_Receive_FS(uint8_t* Buf, uint32_t *Len)
 				else
 				{
 					bool mmdvmStarts = false;
-					uint32_t mmdvmLen = 0;
 
 					// Clear the buffer when the first bulk is handled
 					if (s_receivingBufferOffset == 0)
@@ -432,12 +399,8 @@ static int8_t CDC_Receive_FS(uint8_t* Buf, uint32_t *Len)
 									}
 #endif
 
-									// We can't rely on the MMDVMHost's frame size, so we're managing
-									// the block size ourselves.
-									mmdvmLen = recvSize + 1;
-									com_requestbuffer[0] = mmdvmLen;
-									s_receivingBufferOffset = 1;
-									comRecvMMDVMIndexIn = comRecvMMDVMIndexOut = 0;
+									// The MMDVM parser takes over from here, see below.
+									s_receivingBufferOffset = 0;
 									mmdvmStarts = true;
 									settingsUsbMode = USB_MODE_HOTSPOT;
 								}
@@ -456,8 +419,8 @@ static int8_t CDC_Receive_FS(uint8_t* Buf, uint32_t *Len)
 						// MMDVMHost send a valid request, time to switch USB mode.
 						if (mmdvmStarts)
 						{
-							comRecvMMDVMIndexIn = mmdvmLen;
-							comRecvMMDVMFrameCount = 1;
+							usbComMMDVMParserReset();
+							usbComMMDVMParserFeed(Buf, recvSize, true);
 						}
 
 						s_receivingBufferOffset = 0;
@@ -484,6 +447,8 @@ static int8_t CDC_Receive_FS(uint8_t* Buf, uint32_t *Len)
 	USBD_CDC_SetRxBuffer(&hUsbDeviceFS, UserRxBufferFS); // Reset the RX buffer.
 	USBD_CDC_ReceivePacket(&hUsbDeviceFS); // Prepare for the next reception.
 
+	schedulerPostEventFromISR(SCHEDULER_EVENT_USB);
+
 	return (USBD_OK);
   /* USER CODE END 6 */
 }
@@ -537,6 +502,9 @@ static int8_t CDC_TransmitCplt_FS(uint8_t *Buf, uint32_t *Len, uint8_t epnum)
   UNUSED(Buf);
   UNUSED(Len);
   UNUSED(epnum);
+
+  // Lets the main task queue the next packet (streamed CPS reads, benchmark) without waiting for its next pass
+  schedulerPostEventFromISR(SCHEDULER_EVENT_USB);
   /* USER CODE END 13 */
   return result;
 }
@@ -79,6 +79,10 @@
 
 #define APRS_XMIT_TX_DELAY                   50U
 
+#define APRS_HEARD_LIST_SIZE                128U // Max 255, as the links are stored in an uint8_t (index + 1, 0 is the end of list marker)
+#define APRS_HEARD_CALLSIGN_LEN_MAX          11U // "CALLSIG-SS" + terminator, longer keys are truncated
+#define APRS_HEARD_COMMENT_LEN_MAX           44U // 43 chars (max position comment length) + terminator
+
 typedef enum
 {
 	APRS_TX_IDLE = 0,
@@ -140,6 +144,22 @@ typedef struct
 	aprsSmartBeaconingSettings_t smart;
 } aprsBeaconingSettings_t;
 
+typedef struct
+{
+	char                         callsign[APRS_HEARD_CALLSIGN_LEN_MAX]; // callsign-SSID, the lookup key
+	char                         comment[APRS_HEARD_COMMENT_LEN_MAX];
+	double                       latitude; // NAN if the station never sent a position
+	double                       longitude;
+	uint32_t                     time; // current system time when this station was heard
+	uint32_t                     distance; // in meters from our position (lazily computed)
+	uint16_t                     bearing; // in degrees from our position (lazily computed)
+	uint16_t                     course; // in degrees, as sent by the station
+	uint16_t                     speed; // in knots, as sent by the station
+	uint16_t                     positionEpoch; // own position epoch used to compute distance/bearing, 0 if not computed
+	uint8_t                      hashNext; // next item in the same hash bucket
+	uint8_t                      prev; // LRU list
+	uint8_t                      next; // LRU list
+} aprsHeardStation_t;
 
 extern volatile aprsSendProgress_t aprsTxProgress;
 
@@ -166,6 +186,19 @@ void aprsBeaconingToggles(void);
 aprsBeaconingMode_t aprsBeaconingGetMode(void);
 bool aprsBeaconingSendBeacon(bool fromSatScreen);
 
+double aprsDistanceBetweenTwoCoords(double lat1, double lon1, double lat2, double lon2);
+double aprsCourseTo(double lat1, double lon1, double lat2, double lon2);
+
+// Heard stations (aprsHeard.c)
+void aprsHeardClear(void);
+aprsHeardStation_t *aprsHeardUpdate(const char *callsign, double latitude, double longitude, uint16_t course, uint16_t speed, const char *comment);
+aprsHeardStation_t *aprsHeardFind(const char *callsign);
+aprsHeardStation_t *aprsHeardGetFirst(void);
+aprsHeardStation_t *aprsHeardGetNext(aprsHeardStation_t *station);
+uint32_t aprsHeardGetCount(void);
+void aprsHeardSetOwnPosition(double latitude, double longitude);
+bool aprsHeardGetDistanceAndBearing(aprsHeardStation_t *station, uint32_t *distance, uint16_t *bearing);
+
 #else //PLATFORM_GD77S
 
 #define aprsBeaconingPrepareSatelliteConfig() do {} while(0)
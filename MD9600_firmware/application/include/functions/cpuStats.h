@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _OPENGD77_CPU_STATS_H_
+#define _OPENGD77_CPU_STATS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include "main.h"
+
+#define CPU_STATS_TASKS_MAX         12U
+#define CPU_STATS_UPDATE_PERIOD   1000U // ms
+#define CPU_STATS_COUNTER_FREQUENCY 1000000U // Hz, run time counter resolution
+
+typedef struct
+{
+	TaskHandle_t handle;
+	char         name[configMAX_TASK_NAME_LEN];
+	uint32_t     runTime;        // run time counter value at the last update
+	uint16_t     loadPermille;   // over the last update period
+	uint16_t     stackHighWater; // minimum ever free stack, in words
+	uint16_t     stackSize;      // in words, 0 if the stack isn't registered (functions/taskMemory.h)
+	uint8_t      priority;
+	uint8_t      number;         // FreeRTOS task number, to keep a stable order
+} cpuStatsTask_t;
+
+typedef struct
+{
+	uint32_t       totalRunTime;        // run time counter value at the last update
+	uint32_t       periodRunTime;       // run time counted during the last update period
+	uint16_t       loadPermille;        // everything but the idle task
+	uint8_t        taskCount;
+	bool           overflow;            // more tasks than CPU_STATS_TASKS_MAX, the last update was skipped
+	uint32_t       heapFree;
+	uint32_t       heapMinimumEverFree;
+	cpuStatsTask_t tasks[CPU_STATS_TASKS_MAX];
+} cpuStats_t;
+
+// Run time counter (TIM5), free running at CPU_STATS_COUNTER_FREQUENCY since the scheduler start. Unlike the DWT
+// cycle counter, it keeps counting while the core sleeps in WFI, so it is the timebase for any duration which can
+// span some idle time.
+static inline uint32_t cpuStatsGetRunTimeCounter(void)
+{
+	return TIM5->CNT;
+}
+
+void cpuStatsConfigureTimer(void);
+void cpuStatsInit(void);
+void cpuStatsTick(void);
+const cpuStats_t *cpuStatsGet(void);
+void cpuStatsAccount(cpuStats_t *stats, const TaskStatus_t *status, uint32_t count, uint32_t totalRunTime, TaskHandle_t idleTask);
+
+#endif /* _OPENGD77_CPU_STATS_H_ */
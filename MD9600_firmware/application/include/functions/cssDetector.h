@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _OPENGD77_CSS_DETECTOR_H_
+#define _OPENGD77_CSS_DETECTOR_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "functions/codeplug.h"
+
+#define CSS_DETECTOR_SAMPLE_RATE          8000U
+#define CSS_DETECTOR_DECIMATION              8U // CTCSS and DCS are below 300Hz, work at 1kHz
+#define CSS_DETECTOR_WINDOW_SIZE           250U // decimated samples, 250ms analysis window (4Hz resolution)
+
+void cssDetectorInit(void);
+void cssDetectorStart(CodeplugCSSTypes_t types);
+void cssDetectorStop(void);
+bool cssDetectorIsActive(void);
+void cssDetectorProcessSamples(const int16_t *samples, size_t count, size_t stride);
+bool cssDetectorGetTone(uint16_t *tone);
+void cssDetectorTick(void);
+
+#endif /* _OPENGD77_CSS_DETECTOR_H_ */
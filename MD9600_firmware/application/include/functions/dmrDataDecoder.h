@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _OPENGD77_DMR_DATA_DECODER_H_
+#define _OPENGD77_DMR_DATA_DECODER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Enable this to decode the received data bursts (texts and LIP positions). It stays off until the layout of the burst
+// read from the HR-C6000 page 3 buffer is confirmed against captures: garbage texts and positions would be shown.
+//#define USING_DMR_DATA_DECODER 1
+
+// Burst payload as delivered by the HR-C6000: 216 bits, sync/embedded field removed
+// (98 info bits, 2 x 10 slot type bits, 98 info bits)
+#define DMR_DATA_DECODER_BURST_LENGTH        27U
+#define DMR_DATA_DECODER_QUEUE_SIZE           8U // power of 2
+#define DMR_DATA_DECODER_BLOCKS_MAX          16U
+#define DMR_DATA_DECODER_BLOCK_TIMEOUT      360U // ms, a partial message is dropped after this delay without block
+#define DMR_DATA_DECODER_MESSAGE_LEN_MAX     64U
+
+#define DMR_DATA_DECODER_BPTC_PAYLOAD_LENGTH    12U // Rate 1/2
+#define DMR_DATA_DECODER_TRELLIS_PAYLOAD_LENGTH 18U // Rate 3/4
+
+// Slot Type data types
+typedef enum
+{
+	DMR_DATA_TYPE_DATA_HEADER  = 0x06,
+	DMR_DATA_TYPE_RATE_12_DATA = 0x07,
+	DMR_DATA_TYPE_RATE_34_DATA = 0x08
+} dmrDataType_t;
+
+// Data Packet Formats
+typedef enum
+{
+	DMR_DATA_DPF_UDT                = 0x00,
+	DMR_DATA_DPF_RESPONSE           = 0x01,
+	DMR_DATA_DPF_UNCONFIRMED        = 0x02,
+	DMR_DATA_DPF_CONFIRMED          = 0x03,
+	DMR_DATA_DPF_SHORT_DATA_DEFINED = 0x0D,
+	DMR_DATA_DPF_SHORT_DATA_RAW     = 0x0E,
+	DMR_DATA_DPF_PROPRIETARY        = 0x0F
+} dmrDataPacketFormat_t;
+
+typedef struct
+{
+	uint32_t srcId;
+	uint32_t dstId;
+	bool     isGroup;
+	char     text[DMR_DATA_DECODER_MESSAGE_LEN_MAX];
+} dmrDataMessage_t;
+
+#if defined(USING_DMR_DATA_DECODER)
+
+void dmrDataDecoderInit(void);
+void dmrDataDecoderReset(void);
+void dmrDataDecoderPushBurst(uint8_t dataType, const uint8_t *burst);
+bool dmrDataDecoderProcessBurst(uint8_t dataType, const uint8_t *burst);
+bool dmrDataDecoderBPTCDecode(const uint8_t *burst, uint8_t *payload);
+bool dmrDataDecoderTrellisDecode(const uint8_t *burst, uint8_t *payload);
+bool dmrDataDecoderGetMessage(dmrDataMessage_t *message);
+void dmrDataDecoderTick(void);
+
+#else // USING_DMR_DATA_DECODER
+
+#define dmrDataDecoderInit()            do {} while(0)
+#define dmrDataDecoderReset()           do {} while(0)
+#define dmrDataDecoderTick()            do {} while(0)
+
+#endif // USING_DMR_DATA_DECODER
+
+#endif /* _OPENGD77_DMR_DATA_DECODER_H_ */
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _OPENGD77_DTMF_DECODER_H_
+#define _OPENGD77_DTMF_DECODER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "io/keyboard.h"
+
+#define DTMF_DECODER_SAMPLE_RATE          8000U
+#define DTMF_DECODER_BLOCK_SIZE            102U // 12.75ms, 2 consecutive blocks are needed for a hit (ITU 40ms tone / 40ms pause)
+#define DTMF_DECODER_EVENT_QUEUE_SIZE       16U // power of 2
+#define DTMF_DECODER_RECEIVED_DIGITS_MAX    16U
+#define DTMF_DECODER_REMOTE_TIMEOUT      60000U // ms, remote control is locked again after this idle period
+
+void dtmfDecoderInit(void);
+void dtmfDecoderReset(void);
+bool dtmfDecoderIsActive(void);
+void dtmfDecoderProcessSamples(const int16_t *samples, size_t count, size_t stride);
+bool dtmfDecoderGetDigit(char *digit);
+bool dtmfDecoderGetRemoteKey(keyboardCode_t *keys);
+void dtmfDecoderTick(void);
+
+#endif /* _OPENGD77_DTMF_DECODER_H_ */
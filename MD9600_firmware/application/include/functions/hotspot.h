@@ -50,6 +50,14 @@ typedef struct
 	uint8_t		rawData[12];
 } DMRLC_t;
 
+typedef struct
+{
+	uint32_t    overflows; // frames dropped because the USB TX queue was full
+	uint32_t    packets; // USB packets sent
+	uint32_t    frames; // MMDVM frames sent
+	uint16_t    peakUsage; // USB TX queue high water mark, in bytes
+} hotspotUSBTxStats_t;
+
 
 
 enum HOTSPOT_RX_STATE
@@ -113,7 +121,8 @@ enum HOTSPOT_COMMAND
 	MMDVM_NAK           = 0x7FU,
 	MMDVM_TRANSPARENT   = 0x90U,
 	MMDVM_QSO_INFO      = 0x91U,
-	MMDVM_FRAME_START   = 0xE0U
+	MMDVM_FRAME_START   = 0xE0U,
+	MMDVM_DEBUG_DUMP    = 0xFAU
 };
 
 typedef enum
@@ -136,6 +145,8 @@ typedef enum
 } MMDVMHOST_RX_STATE;
 
 
+#define HOTSPOT_TELEMETRY_PERIOD  10000U // ms, MMDVM_DEBUG_DUMP telemetry frames interval (MMDVMHost only), 0 to disable
+
 // Uncomment this to enable all mmdvmSendDebug*() functions. You will see the results in the MMDVMHost log file.
 //#define MMDVM_SEND_DEBUG
 
@@ -160,10 +171,12 @@ void cwReset(void);
 void handleHotspotRequest(void);
 void processUSBDataQueue(void);
 void enqueueUSBData(uint8_t *data, uint8_t length);
+void hotspotGetUSBTxStats(hotspotUSBTxStats_t *stats);
 void hotspotStateMachine(void);
 void hotspotInit(void);
 
 extern bool hotspotCwKeying;
+extern bool hotspotPocsagKeying;
 extern uint16_t hotspotCwpoLen;
 extern uint8_t hotspotCurrentRxCommandState;
 extern char hotspotMmdvmQSOInfoIP[22];
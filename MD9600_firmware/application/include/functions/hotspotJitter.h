@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef _OPENGD77_HOTSPOT_JITTER_H_
+#define _OPENGD77_HOTSPOT_JITTER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define HOTSPOT_JITTER_FRAME_DURATION     60U // ms, one DMR voice burst
+#define HOTSPOT_JITTER_STREAM_GAP       1000U // ms, a longer silence starts a new network stream
+#define HOTSPOT_JITTER_DEPTH_MIN           2U
+#define HOTSPOT_JITTER_DEPTH_DEFAULT       5U // same as the former fixed pre-buffering
+#define HOTSPOT_JITTER_DEPTH_MAX          16U // ~1s of latency
+
+typedef struct
+{
+	uint32_t frames; // network voice frames received
+	uint32_t underruns; // frames that arrived after the transmitter ran out of audio
+	uint32_t starvedSlots; // silence bursts sent because of underruns
+	uint32_t overflows; // frames dropped, the buffer was full
+	uint16_t jitter; // ms, current network delay spread estimate
+	uint8_t  targetDepth; // frames buffered before the transmission starts
+	uint8_t  depth; // buffer depth after the last received frame
+	uint8_t  maxDepth;
+} hotspotJitterStats_t;
+
+void hotspotJitterInit(void);
+void hotspotJitterFrameArrived(uint32_t timeMs, uint32_t depth);
+void hotspotJitterFrameDropped(void);
+void hotspotJitterSlotStarved(void);
+uint32_t hotspotJitterGetTargetDepth(void);
+void hotspotJitterGetStats(hotspotJitterStats_t *stats);
+
+#endif /* _OPENGD77_HOTSPOT_JITTER_H_ */
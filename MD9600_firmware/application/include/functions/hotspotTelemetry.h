@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef _OPENGD77_HOTSPOT_TELEMETRY_H_
+#define _OPENGD77_HOTSPOT_TELEMETRY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define HOTSPOT_TELEMETRY_MAGIC               0x54U // 'T', first byte of the payload
+#define HOTSPOT_TELEMETRY_VERSION                1U
+#define HOTSPOT_TELEMETRY_HISTOGRAM_BUCKETS      8U // [0], [1..2), [2..4), ..., [64..), in units of (1 << shift)
+#define HOTSPOT_TELEMETRY_FRAME_STAMPS          48U // >= HOTSPOT_BUFFER_COUNT
+#define HOTSPOT_TELEMETRY_PAYLOAD_LENGTH_MAX   200U
+
+typedef enum
+{
+	HOTSPOT_TELEMETRY_COUNTER_RF_FRAMES = 0,
+	HOTSPOT_TELEMETRY_COUNTER_NET_FRAMES,
+	HOTSPOT_TELEMETRY_COUNTER_USB_OVERFLOWS,
+	HOTSPOT_TELEMETRY_COUNTER_RF_OVERFLOWS,
+	HOTSPOT_TELEMETRY_COUNTER_NET_OVERFLOWS,
+	HOTSPOT_TELEMETRY_COUNTER_NET_UNDERRUNS,
+	HOTSPOT_TELEMETRY_COUNTER_LC_DECODE_FAILURES,
+	HOTSPOT_TELEMETRY_COUNTER_FEC_CORRECTED_BITS,
+	HOTSPOT_TELEMETRY_COUNTER_USB_PARSER_ERRORS, // malformed MMDVM frames from the host
+	HOTSPOT_TELEMETRY_COUNTER_USB_PARSER_OVERFLOWS, // MMDVM frames from the host dropped, no room left
+	HOTSPOT_TELEMETRY_COUNTER_MAX
+} hotspotTelemetryCounter_t;
+
+typedef enum
+{
+	HOTSPOT_TELEMETRY_HISTOGRAM_USB_QUEUE_DEPTH = 0, // bytes
+	HOTSPOT_TELEMETRY_HISTOGRAM_RF_BUFFER_DEPTH, // frames, RF to network
+	HOTSPOT_TELEMETRY_HISTOGRAM_NET_BUFFER_DEPTH, // frames, network to RF
+	HOTSPOT_TELEMETRY_HISTOGRAM_FRAME_TO_AIR_LATENCY, // ms, network frame received to handed to the transmitter
+	HOTSPOT_TELEMETRY_HISTOGRAM_ISR_TO_USB_LATENCY, // ms, RF frame received to queued for USB
+	HOTSPOT_TELEMETRY_HISTOGRAM_MAX
+} hotspotTelemetryHistogram_t;
+
+typedef enum
+{
+	HOTSPOT_TELEMETRY_STAMP_RF = 0,
+	HOTSPOT_TELEMETRY_STAMP_NET,
+	HOTSPOT_TELEMETRY_STAMP_MAX
+} hotspotTelemetryStamp_t;
+
+typedef struct
+{
+	uint32_t periodMs;
+	uint32_t counters[HOTSPOT_TELEMETRY_COUNTER_MAX];
+	uint16_t histograms[HOTSPOT_TELEMETRY_HISTOGRAM_MAX][HOTSPOT_TELEMETRY_HISTOGRAM_BUCKETS];
+} hotspotTelemetrySnapshot_t;
+
+void hotspotTelemetryInit(uint32_t timeMs);
+void hotspotTelemetryCount(hotspotTelemetryCounter_t counter, uint32_t value);
+void hotspotTelemetrySample(hotspotTelemetryHistogram_t histogram, uint32_t value);
+void hotspotTelemetryStampFrame(hotspotTelemetryStamp_t stamp, uint32_t index, uint32_t timeMs);
+void hotspotTelemetryFrameDone(hotspotTelemetryStamp_t stamp, uint32_t index, uint32_t timeMs);
+void hotspotTelemetryTakeSnapshot(hotspotTelemetrySnapshot_t *snapshot, uint32_t timeMs);
+uint8_t hotspotTelemetryEncode(const hotspotTelemetrySnapshot_t *snapshot, uint8_t sequence, uint8_t *buffer, uint8_t bufferSize);
+
+#endif /* _OPENGD77_HOTSPOT_TELEMETRY_H_ */
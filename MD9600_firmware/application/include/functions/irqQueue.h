@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _OPENGD77_IRQ_QUEUE_H_
+#define _OPENGD77_IRQ_QUEUE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define IRQ_QUEUE_SIZE           8U // entries, power of 2
+#define IRQ_QUEUE_VALUES_MAX     4U
+
+// Snapshot taken by an ISR, for the task the processing is deferred to
+typedef struct
+{
+	uint8_t values[IRQ_QUEUE_VALUES_MAX];
+} irqQueueEntry_t;
+
+typedef struct
+{
+	irqQueueEntry_t   entries[IRQ_QUEUE_SIZE];
+	volatile uint32_t head; // only written by the producer
+	volatile uint32_t tail; // only written by the consumer
+	volatile uint32_t dropped;
+} irqQueue_t;
+
+void irqQueueInit(irqQueue_t *queue);
+bool irqQueuePush(irqQueue_t *queue, const irqQueueEntry_t *entry);
+bool irqQueuePop(irqQueue_t *queue, irqQueueEntry_t *entry);
+bool irqQueueIsEmpty(irqQueue_t *queue);
+uint32_t irqQueueGetDropped(irqQueue_t *queue);
+
+#endif /* _OPENGD77_IRQ_QUEUE_H_ */
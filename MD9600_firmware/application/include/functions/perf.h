@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _OPENGD77_PERF_H_
+#define _OPENGD77_PERF_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//#define USING_PERF 1 // Enable this to build the timing probes (dumped by tools/perf/perf_dump.py)
+
+#define PERF_HISTOGRAM_BUCKETS    32U // bucket n counts the durations in [2^n, 2^(n+1)) counter ticks (bucket 0 also counts 0)
+#define PERF_NAME_LENGTH           8U
+
+// Probe IDs. Their order is the one of the USB dump, new probes have to be added before PERF_PROBE_MAX.
+typedef enum
+{
+	PERF_PROBE_HRC_SYS_IRQ = 0,
+	PERF_PROBE_HRC_TIMESLOT_IRQ,
+	PERF_PROBE_CODEC_DECODE,
+	PERF_PROBE_DISPLAY_RENDER,
+	PERF_PROBE_SPI_FLASH_READ,
+	PERF_PROBE_HRC_SYS_DEFERRED,
+	PERF_PROBE_HRC_TX_IRQ,
+	PERF_PROBE_MAX
+} perfProbe_t;
+
+typedef struct
+{
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint64_t total;
+	uint32_t buckets[PERF_HISTOGRAM_BUCKETS];
+} perfProbeStats_t;
+
+#if defined(USING_PERF)
+
+#if defined(__arm__)
+#include "main.h"
+
+// Cortex-M4 cycle counter
+static inline uint32_t perfGetCounter(void)
+{
+	return DWT->CYCCNT;
+}
+#else
+#include <time.h>
+
+// Host build, in ns
+static inline uint32_t perfGetCounter(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)((ts.tv_sec * 1000000000ULL) + ts.tv_nsec);
+}
+#endif
+
+// A probe scope can only be opened once per block, and must not block: the cycle counter stops while the idle task
+// sleeps in WFI
+#define PERF_BEGIN(p)         const uint32_t perfStart_##p = perfGetCounter()
+#define PERF_END(p)           perfRecord((p), (perfGetCounter() - perfStart_##p))
+
+void perfInit(void);
+void perfRecord(perfProbe_t probe, uint32_t duration);
+void perfGetStats(perfProbe_t probe, perfProbeStats_t *stats);
+const char *perfGetName(perfProbe_t probe);
+uint32_t perfGetCounterFrequency(void);
+void perfReset(void);
+
+#else // USING_PERF
+
+#define PERF_BEGIN(p)         do {} while(0)
+#define PERF_END(p)           do {} while(0)
+
+#define perfInit()            do {} while(0)
+
+#endif // USING_PERF
+
+#endif /* _OPENGD77_PERF_H_ */
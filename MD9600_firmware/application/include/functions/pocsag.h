@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _OPENGD77_POCSAG_H_
+#define _OPENGD77_POCSAG_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define POCSAG_BAUDRATE_512                512U
+#define POCSAG_BAUDRATE_1200              1200U
+#define POCSAG_DEVIATION                   450U // 4.5kHz, in 10Hz units
+#define POCSAG_PREAMBLE_BITS               576U
+#define POCSAG_BATCH_WORDS                  17U // sync codeword + 8 frames of 2 codewords
+#define POCSAG_BATCH_BYTES                (POCSAG_BATCH_WORDS * 4U)
+#define POCSAG_QUEUE_BATCHES                 8U // power of 2
+#define POCSAG_SYNC_CODEWORD       0x7CD215D8U
+#define POCSAG_IDLE_CODEWORD       0x7A89C197U
+
+typedef enum
+{
+	POCSAG_TX_IDLE = 0,
+	POCSAG_TX_IN_PROGRESS,
+	POCSAG_TX_FINISHED
+} pocsagTxProgress_t;
+
+typedef enum
+{
+	POCSAG_FUNCTION_NUMERIC = 0,
+	POCSAG_FUNCTION_TONE_1,
+	POCSAG_FUNCTION_TONE_2,
+	POCSAG_FUNCTION_ALPHANUMERIC
+} pocsagFunction_t;
+
+extern volatile pocsagTxProgress_t pocsagTxProgress;
+
+uint32_t pocsagEncodeCodeword(uint32_t data);
+bool pocsagCodewordIsValid(uint32_t codeword);
+uint8_t pocsagEncodeMessage(uint32_t ric, pocsagFunction_t function, const char *message, uint32_t *batches, uint8_t maxBatches);
+
+void pocsagInit(void);
+bool pocsagQueueBatch(const uint32_t *codewords);
+uint8_t pocsagGetQueueSpace(void);
+bool pocsagTxStart(uint32_t freq, uint16_t baudRate);
+void pocsagTxStop(void);
+void pocsagBitStreamSender(void);
+
+#endif /* _OPENGD77_POCSAG_H_ */
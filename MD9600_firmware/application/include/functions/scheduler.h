@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef _OPENGD77_SCHEDULER_H_
+#define _OPENGD77_SCHEDULER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SCHEDULER_WAIT_MAX          100U // ms, upper bound of a single wait
+
+// Events, posted by the ISRs and drivers to wake the main task up
+#define SCHEDULER_EVENT_USB    (1U << 0) // USB data received, or transmission completed
+#define SCHEDULER_EVENT_INPUT  (1U << 1) // rotary encoder moved
+
+// Main task clients with a deadline
+typedef enum
+{
+	SCHEDULER_CLIENT_MAIN_LOOP = 0,   // next ms, while something needs every pass (keys held, audio, TX/RX, scan, other menus...)
+	SCHEDULER_CLIENT_TICKS_CALLBACKS, // earliest timer callback expiry
+	SCHEDULER_CLIENT_KEYBOARD,        // next keypad/buttons scan, when they are idle
+	SCHEDULER_CLIENT_DISPLAY,         // backlight timeout
+	SCHEDULER_CLIENT_USB,             // CPS background work (flash programming, read stream, benchmark)
+	SCHEDULER_CLIENT_MAX
+} schedulerClient_t;
+
+void schedulerInit(void);
+void schedulerSetDeadline(schedulerClient_t client, uint32_t time);
+void schedulerClearDeadline(schedulerClient_t client);
+bool schedulerIsDue(schedulerClient_t client, uint32_t now);
+bool schedulerIsAnyDue(uint32_t now);
+uint32_t schedulerGetTimeout(uint32_t now);
+void schedulerPostEvent(uint32_t events);
+void schedulerPostEventFromISR(uint32_t events);
+uint32_t schedulerWait(void);
+
+#endif /* _OPENGD77_SCHEDULER_H_ */
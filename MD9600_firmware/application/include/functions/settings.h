@@ -33,7 +33,7 @@
 #include "functions/codeplug.h"
 #include "functions/trx.h"
 
-enum USB_MODE { USB_MODE_CPS, USB_MODE_HOTSPOT, USB_MODE_DEBUG };
+enum USB_MODE { USB_MODE_CPS, USB_MODE_HOTSPOT, USB_MODE_DEBUG, USB_MODE_BENCHMARK };
 enum SETTINGS_UI_MODE { SETTINGS_CHANNEL_MODE = 0, SETTINGS_VFO_A_MODE, SETTINGS_VFO_B_MODE };
 enum BACKLIGHT_MODE { BACKLIGHT_MODE_AUTO = 0, BACKLIGHT_MODE_SQUELCH, BACKLIGHT_MODE_MANUAL, BACKLIGHT_MODE_BUTTONS, BACKLIGHT_MODE_NONE };
 enum HOTSPOT_TYPE { HOTSPOT_TYPE_OFF = 0, HOTSPOT_TYPE_MMDVM, HOTSPOT_TYPE_BLUEDV };
@@ -137,6 +137,8 @@ typedef enum
 #if defined(PLATFORM_MDUV380) && !defined(PLATFORM_VARIANT_UV380_PLUS_10W)
 	BIT_FORCE_10W_RADIO             = (1 << 24),
 #endif
+	BIT_DTMF_DECODER                = (1 << 25),
+	BIT_DTMF_REMOTE_CONTROL         = (1 << 26),
 } bitfieldOptions_t;
 
 #if defined(PLATFORM_MD9600)
@@ -109,6 +109,8 @@ bool soundReceiveData(void);
 void soundReceiveRefillData(uint32_t bufNum);
 bool soundMelodyIsPlaying(void);
 void soundStartDMA(void);
+void soundMonitorStart(void);
+void soundMonitorStop(void);
 
 //bit masks to track amp usage
 #define AUDIO_AMP_MODE_NONE 	0
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _OPENGD77_TASK_MEMORY_H_
+#define _OPENGD77_TASK_MEMORY_H_
+
+#include <stdint.h>
+#include <FreeRTOS.h>
+#include <task.h>
+
+#define TASK_MEMORY_STACKS_MAX 12U
+
+// Statically allocated task stacks (sizes in words).
+// Each stack gets its own input section, named after its variable, so tools/memory_map/map_report.py --budget can
+// list them from the map file:
+//  - TASK_STACK_CCM: in the core coupled RAM. Not for a task which hands buffers on its stack to a DMA.
+//  - TASK_STACK_RAM: in the main SRAM.
+#define TASK_STACK_CCM(name, words) StackType_t name[(words)] __attribute__((section(".ccmram.stack." #name), aligned(8)))
+#define TASK_STACK_RAM(name, words) StackType_t name[(words)] __attribute__((section(".bss.stack." #name), aligned(8)))
+
+TaskHandle_t taskMemoryCreate(TaskFunction_t function, const char *name, StackType_t *stack, uint32_t stackSize, StaticTask_t *tcb, UBaseType_t priority);
+void taskMemoryRegister(const StackType_t *stack, uint32_t stackSize);
+uint32_t taskMemoryGetStackSize(const StackType_t *stack);
+
+#endif /* _OPENGD77_TASK_MEMORY_H_ */
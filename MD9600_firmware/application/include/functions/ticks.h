@@ -35,7 +35,13 @@
 #include <FreeRTOS.h>
 #include <task.h>
 
+#if !defined(TICKS_CALLBACKS_MAX)
+#define TICKS_CALLBACKS_MAX             32U // max 65535
+#endif
+#define TICKS_CALLBACK_INVALID_HANDLE    0U
+
 typedef void (*timerCallback_t)(void);
+typedef uint32_t ticksCallbackHandle_t;
 
 typedef struct
 {
@@ -46,6 +52,9 @@ typedef struct
 extern uint32_t ticksGetMillis(void);
 bool addTimerCallback(timerCallback_t funPtr, uint32_t delayIn_mS, int menuDest, bool updateExistingCallbackTime);
 bool cancelTimerCallback(timerCallback_t funPtr, int menuDest);
+ticksCallbackHandle_t ticksCallbackAdd(timerCallback_t funPtr, uint32_t delayIn_mS, int menuDest);
+bool ticksCallbackCancel(ticksCallbackHandle_t handle);
+bool ticksCallbackGetNextExpiry(uint32_t *expiry);
 void handleTimerCallbacks(void);
 
 void ticksTimerReset(ticksTimer_t *timer);
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef _OPENGD77_TRACE_H_
+#define _OPENGD77_TRACE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//#define USING_TRACE 1 // Enable this to build the binary trace ring (decoded by tools/trace/decode_trace.py)
+
+#define TRACE_ARGS_MAX         4U
+#define TRACE_RING_SIZE      128U // records, power of 2
+
+// Event IDs. The format strings live in tools/trace/decode_trace.py, keep both in sync (IDs must never be reused).
+typedef enum
+{
+	TRACE_EVENT_NONE = 0, // marks a record being written, never traced
+	TRACE_EVENT_DROPPED, // records lost since the previous drain, the ring was full
+	TRACE_EVENT_HRC_SYS_IRQ, // reg 0x82, reg 0x52
+	TRACE_EVENT_HRC_TIMESLOT_IRQ, // slot state, timeslot
+	TRACE_EVENT_HRC_TX_IRQ, // slot state
+	TRACE_EVENT_TA_TX_FLAG, // talker alias flag
+	TRACE_EVENT_DMR_RX_AGC, // peak average, gain, DAC gain
+	TRACE_EVENT_DMR_TS_EDGE, // none, first thing in the timeslot ISR (slot grid reference for tools/trace/tdma_timing.py)
+	TRACE_EVENT_DMR_SLOT_STATE, // previous slot state, new slot state
+	TRACE_EVENT_DMR_RX_DATA, // sync class, data type, CRC valid, sync type
+	TRACE_EVENT_DMR_LC_RECEIVED, // FLCO, CRC valid, destination ID, source ID
+	TRACE_EVENT_DMR_TX_OFF, // slot state
+	TRACE_EVENT_DMR_TX_BURST_CALLBACK, // slot state
+	TRACE_EVENT_MAX
+} traceEvent_t;
+
+// One record, as stored in the ring and sent to the host (little endian)
+typedef struct
+{
+	volatile uint32_t header; // (event << 8) | argument count, written last (0 while the record is being written)
+	uint32_t          timestamp; // run time counter, in us (functions/cpuStats.h)
+	uint32_t          args[TRACE_ARGS_MAX];
+} traceRecord_t;
+
+#if defined(USING_TRACE)
+
+#define TRACE0(e)             traceWrite((e), 0, 0, 0, 0, 0)
+#define TRACE1(e, a)          traceWrite((e), 1, (uint32_t)(a), 0, 0, 0)
+#define TRACE2(e, a, b)       traceWrite((e), 2, (uint32_t)(a), (uint32_t)(b), 0, 0)
+#define TRACE3(e, a, b, c)    traceWrite((e), 3, (uint32_t)(a), (uint32_t)(b), (uint32_t)(c), 0)
+#define TRACE4(e, a, b, c, d) traceWrite((e), 4, (uint32_t)(a), (uint32_t)(b), (uint32_t)(c), (uint32_t)(d))
+
+void traceInit(void);
+void traceWrite(traceEvent_t event, uint32_t argCount, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+uint32_t traceRead(traceRecord_t *records, uint32_t maxRecords);
+void traceDrain(void);
+
+#else // USING_TRACE
+
+#define TRACE0(e)             do {} while(0)
+#define TRACE1(e, a)          do {} while(0)
+#define TRACE2(e, a, b)       do {} while(0)
+#define TRACE3(e, a, b, c)    do {} while(0)
+#define TRACE4(e, a, b, c, d) do {} while(0)
+
+#define traceInit()           do {} while(0)
+#define traceDrain()          do {} while(0)
+
+#endif // USING_TRACE
+
+#endif /* _OPENGD77_TRACE_H_ */
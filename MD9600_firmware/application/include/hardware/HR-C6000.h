@@ -129,6 +129,7 @@ void HRC6000SetDTMF(uint8_t code);
 void HRC6000InitDTMF(void);
 void HRC6000DTMFoff(bool enableMic);
 void hrc6000SysInterruptHandler(void);
+void hrc6000SysInterruptCapture(void);
 void hrc6000TimeslotInterruptHandler(void);
 void hrc6000TxInterruptHandler(void);
 void hrc6000SetInIRQHandler(bool in);
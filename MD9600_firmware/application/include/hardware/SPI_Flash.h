@@ -67,6 +67,10 @@ bool SPI_Flash_read(uint32_t addrress,uint8_t *buf,int size);
 bool SPI_Flash_write(uint32_t addr, uint8_t *dataBuf, int size);
 bool SPI_Flash_writePage(uint32_t address,uint8_t *dataBuf);// page is 256 bytes
 bool SPI_Flash_eraseSector(uint32_t address);// sector is 16 pages  = 4k bytes
+void SPI_Flash_writePageStart(uint32_t address, uint8_t *dataBuf);// non blocking
+void SPI_Flash_eraseSectorStart(uint32_t address);// non blocking
+bool SPI_Flash_isBusy(void);
+bool SPI_Flash_waitForWriteCompletion(void);
 uint8_t SPI_Flash_readManufacturer(void);// Not necessarily Winbond !
 uint32_t SPI_Flash_readPartID(void);// Should be 4014 for 1M or 4017 for 8M
 uint32_t SPI_Flash_readStatusRegisters(void);// May come in handy
@@ -119,6 +119,9 @@ extern uint16_t themeItems[NIGHT + 1][THEME_ITEM_MAX]; // Theme storage
 #endif
 #define DISPLAY_SIZE_X                          128
 #define DISPLAY_NUMBER_OF_ROWS  (DISPLAY_SIZE_Y / 8)
+#define DISPLAY_COLUMN_OFFSET                    4 // first visible column of the panel RAM
+#define DISPLAY_SPAN_MIN_GAP                     4 // unchanged bytes worth splitting a dirty span for (a new span costs 3 commands)
+#define DISPLAY_SPANS_MAX       (DISPLAY_NUMBER_OF_ROWS * ((DISPLAY_SIZE_X / (DISPLAY_SPAN_MIN_GAP + 1)) + 1)) // worst case, per render
 
 
 #if defined(HAS_COLOURS)
@@ -148,6 +151,10 @@ void displayClearRows(int16_t startRow, int16_t endRow, bool isInverted);
 void displayRenderWithoutNotification(void);
 void displayRender(void);
 void displayRenderRows(int16_t startRow, int16_t endRow);
+void displayMarkAllDirty(void);
+void displayInvalidatePanel(void);
+const uint8_t *displayTakeDirtySpan(int16_t row, int16_t *x, int16_t *length);
+void displayWaitForTransferComplete(void);
 void displayPrintCentered(uint16_t y, const char *text, ucFont_t fontSize);
 void displayPrintAt(uint16_t x, uint16_t y, const  char *text, ucFont_t fontSize);
 int displayPrintCore(int16_t x, int16_t y, const char *szMsg, ucFont_t fontSize, ucTextAlign_t alignment, bool isInverted);
@@ -43,6 +43,41 @@ typedef enum
 #define FREQUENCY_OUT_OF_BAND  UINT32_MAX
 #define POWER_UNSET            UINT8_MAX
 
+#if defined(MD9600_VERSION_5)
+#define RADIO_HAS_FSK_TX // radioFSKPrepare()/radioFSKSetSymbol() can key the synthesiser (POCSAG transmitter)
+#endif
+
+typedef struct
+{
+	bool     bandIsVHF;
+	uint16_t reg1[2]; // FSK symbols: [0] low, [1] high
+	uint16_t reg2[2];
+	uint16_t reg4[2];
+} radioFSKConfig_t;
+
+// Shadow copies of the synthesiser and IF chip registers, indexed by RADIO_BAND_VHF / RADIO_BAND_UHF
+#define RADIO_SHADOW_BANDS_NUM  2U
+#if defined(MD9600_VERSION_5)
+#define RADIO_SYNTH_REGISTERS_NUM  0x2BU // TI, up to 0x2A
+#elif defined(MD9600_VERSION_4)
+#define RADIO_SYNTH_REGISTERS_NUM  16U   // AK1590
+#else
+#define RADIO_SYNTH_REGISTERS_NUM  10U   // SKY
+#endif
+
+typedef struct
+{
+	uint32_t synthRegs[RADIO_SHADOW_BANDS_NUM][RADIO_SYNTH_REGISTERS_NUM];
+	bool     synthValid[RADIO_SHADOW_BANDS_NUM];
+	bool     synthTx[RADIO_SHADOW_BANDS_NUM]; // VCO the synthesiser has been locked for
+	bool     ifValid[RADIO_SHADOW_BANDS_NUM];
+	bool     ifWide[RADIO_SHADOW_BANDS_NUM];
+	uint32_t synthWritten; // transfers
+	uint32_t synthSkipped;
+	uint32_t ifWritten;
+	uint32_t ifSkipped;
+} radioShadow_t;
+
 void radioPowerOn(void);
 void radioPowerOff(void);
 void radioInit(void);
@@ -81,6 +116,10 @@ void radioAudioAmp(bool on);
 void radioSetAudioPath(bool fromFM);
 void radioFastTx(bool tx);
 void radioSetRxLNAForDevice(RadioDevice_t deviceId);
+bool radioFSKPrepare(uint32_t freq, uint32_t deviation, radioFSKConfig_t *config);
+void radioFSKSetSymbol(const radioFSKConfig_t *config, bool high);
+void radioShadowInvalidate(void);
+const radioShadow_t *radioGetShadow(void);
 
 
 extern RadioDevice_t currentRadioDeviceId;
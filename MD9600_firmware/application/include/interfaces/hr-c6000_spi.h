@@ -29,6 +29,7 @@
 #ifndef _OPENGD77_SPI_H_
 #define _OPENGD77_SPI_H_
 
+#include <stdbool.h>
 #include <FreeRTOS.h>
 #include <task.h>
 
@@ -43,16 +44,42 @@ enum _generic_status
     kStatus_NoTransferInProgress,
 };
 
+#define SPI0_SHADOW_PAGES_NUM       2U // 0x01 and 0x04
+
+#define SPI0_BATCH_BUFFER_SIZE    128U
+#define SPI0_BATCH_FRAMES_MAX     (SPI0_BATCH_BUFFER_SIZE / 3U) // the shortest frame is 3 bytes
+
+// Register writes queued to be played in a single critical section (see SPI0BatchCommit())
+typedef struct
+{
+	uint8_t  buffer[SPI0_BATCH_BUFFER_SIZE]; // the frames, back to back
+	uint8_t  frameLengths[SPI0_BATCH_FRAMES_MAX];
+	uint8_t  length; // in bytes
+	uint8_t  frameCount;
+	uint8_t  lastPage;
+	uint16_t lastReg;
+	bool     lastIsExtended;
+} spi0Batch_t;
+
 
 void SPIInit(void);
 void SPI0Read(uint8_t *txBuf,uint8_t *rxBuf,uint8_t length);
 void SPI0Write(uint8_t *txBuf,uint8_t length);
 int SPI0WritePageRegByte(uint8_t page, uint8_t reg, uint8_t val);
+int SPI0WritePageRegByteIfChanged(uint8_t page, uint8_t reg, uint8_t val);
 int SPI0WritePageRegByteExtended(uint8_t page, uint16_t reg, uint8_t val);
 int SPI0ReadPageRegByte(uint8_t page, uint8_t reg, volatile uint8_t *val);
 int SPI0ClearPageRegByteWithMask(uint8_t page, uint8_t reg, uint8_t mask, uint8_t val);
 int SPI0WritePageRegByteArray(uint8_t page, uint8_t reg, const uint8_t *values, uint8_t length);
 int SPI0ReadPageRegByteArray(uint8_t page, uint8_t reg, volatile uint8_t *values, uint8_t length);
+void SPI0BatchInit(spi0Batch_t *batch);
+int SPI0BatchWritePageRegByte(spi0Batch_t *batch, uint8_t page, uint8_t reg, uint8_t val);
+int SPI0BatchWritePageRegByteIfChanged(spi0Batch_t *batch, uint8_t page, uint8_t reg, uint8_t val);
+int SPI0BatchWritePageRegByteExtended(spi0Batch_t *batch, uint8_t page, uint16_t reg, uint8_t val);
+int SPI0BatchCommit(spi0Batch_t *batch);
+void SPI0ShadowInvalidate(void);
+bool SPI0ShadowGet(uint8_t page, uint8_t reg, uint8_t *val);
+void SPI0ShadowGetStats(uint32_t *written, uint32_t *skipped);
 
 int SPI1WritePageRegByteArray(uint8_t page, uint8_t reg, const uint8_t *values, uint8_t length);
 int SPI1ReadPageRegByteArray(uint8_t page, uint8_t reg, volatile uint8_t *values, uint8_t length);
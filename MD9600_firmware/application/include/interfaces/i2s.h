@@ -108,11 +108,13 @@ extern uint16_t i2s_Rx_Buffer[NUM_I2S_BUFFERS][2][WAV_BUFFER_SIZE];
 extern volatile bool g_TX_SAI_in_use;
 extern volatile bool isSending;
 extern volatile bool isReceiving;
+extern volatile bool isMonitoring;
 
 void init_I2S(void);
 void setup_I2S(void);
 void I2SReset(void);
 void I2STerminateTransfers(void);
 void I2SStartDMA(uint16_t *txbuff, uint16_t *rxbuff, size_t bufferLen);
+void I2SMonitorStop(void);
 
 #endif /* _OPENGD77_I2S_H_ */
@@ -38,5 +38,6 @@ bool interruptsClearPinFlags(uint32_t *port, uint32_t pin);
 
 void interruptsDisableC6000Interrupts(void);
 void interruptsEnableC6000Interrupts(void);
+bool interruptsC6000InterruptsAreDisabled(void);
 
 #endif
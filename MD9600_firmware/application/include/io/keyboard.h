@@ -122,6 +122,7 @@
 #define EVENT_KEY_CHANGE 1
 
 #define KEY_DEBOUNCE_COUNTER   20
+#define KEYBOARD_IDLE_SCAN_PERIOD  10U // ms, keypad and buttons polling period while nothing is pressed
 
 #if defined(PLATFORM_MD380) || defined(PLATFORM_MDUV380) || defined(PLATFORM_RT84_DM1701) || defined(PLATFORM_MD2017)
 #if defined(PLATFORM_RT84_DM1701) || defined(PLATFORM_MD2017)
@@ -179,6 +180,7 @@ extern volatile rotaryData_t rotaryData;
 
 void keyboardInit(void);
 void keyboardReset(void);
+bool keyboardIsIdle(void);
 bool keyboardKeyIsDTMFKey(char key);
 void keyboardCheckKeyEvent(keyboardCode_t *keys, int *event, uint16_t frontPanelButtons);
 bool keyboardScanKey(uint32_t scancode, char *keycode);
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef _OPENGD77_USB_BENCHMARK_H_
+#define _OPENGD77_USB_BENCHMARK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define USB_BENCHMARK_DURATION_MAX     60000U // ms
+#define USB_BENCHMARK_RTT_BUCKET         100U // us, round trip time histogram resolution
+#define USB_BENCHMARK_RTT_BUCKETS        100U // the last one also holds the longer round trips
+#define USB_BENCHMARK_PROBE_TIMEOUT     1000U // ms, the probe is considered lost
+
+typedef enum
+{
+	USB_BENCHMARK_MODE_ECHO = 1, // the radio sends probes, the host sends them back, the round trip times are recorded
+	USB_BENCHMARK_MODE_SINK, // the host sends, the radio counts
+	USB_BENCHMARK_MODE_SOURCE // the radio sends, the host counts
+} usbBenchmarkMode_t;
+
+typedef struct
+{
+	uint8_t  mode;
+	uint32_t duration; // ms, actual
+	uint32_t rxBytes;
+	uint32_t rxPackets;
+	uint32_t txBytes;
+	uint32_t txPackets;
+	uint32_t rttSamples;
+	uint32_t rttLost; // probes not sent back within USB_BENCHMARK_PROBE_TIMEOUT
+	uint32_t rttMin; // us
+	uint32_t rttMax; // us
+	uint32_t rttP50; // us, upper bound of the histogram bucket
+	uint32_t rttP90;
+	uint32_t rttP99;
+} usbBenchmarkResults_t;
+
+bool usbBenchmarkStart(usbBenchmarkMode_t mode, uint32_t packetSize, uint32_t duration);
+void usbBenchmarkFeed(const uint8_t *data, uint32_t length);
+bool usbBenchmarkTick(void);
+void usbBenchmarkGetResults(usbBenchmarkResults_t *results);
+
+#endif /* _OPENGD77_USB_BENCHMARK_H_ */
@@ -42,15 +42,13 @@
 
 #define COM_BUFFER_SIZE APP_RX_DATA_SIZE
 #define COM_REQUESTBUFFER_SIZE COM_BUFFER_SIZE
+#define COM_MMDVM_FRAME_QUEUE_SIZE 32U // power of 2
 
 extern volatile uint8_t com_buffer[COM_BUFFER_SIZE];
 extern int com_buffer_write_idx;
 extern int com_buffer_read_idx;
 extern volatile int com_buffer_cnt;
 
-extern volatile int comRecvMMDVMIndexIn;
-extern volatile int comRecvMMDVMIndexOut;
-extern volatile int comRecvMMDVMFrameCount;
 extern volatile int com_request;
 extern volatile uint8_t com_requestbuffer[COM_REQUESTBUFFER_SIZE];
 
@@ -62,9 +60,17 @@ extern USB_DMA_NONINIT_DATA_ALIGN(USB_DATA_ALIGN_SIZE) uint8_t usbComSendBuf[COM
 extern bool isCompressingAMBE;
 
 void tick_com_request(void);
+bool usbComHasPendingWork(void);
 void send_packet(uint8_t val_0x82, uint8_t val_0x86, int ram);
 void send_packet_big(uint8_t val_0x82, uint8_t val_0x86, int ram1, int ram2);
 void add_to_commbuffer(uint8_t value);
+void usbComMMDVMParserReset(void);
+void usbComMMDVMParserFeed(const uint8_t *data, uint32_t length, bool endOfTransfer);
+bool usbComMMDVMHasFrame(void);
+bool usbComMMDVMPeekFrame(const uint8_t **frame, uint8_t *length);
+void usbComMMDVMReleaseFrame(void);
+void usbComMMDVMGetParserStats(uint32_t *errors, uint32_t *overflows);
+void usbComSendNMEA(const char *line);
 void USB_DEBUG_PRINT(char *str);
 void USB_DEBUG_printf(const char *format, ...) __attribute__((format(__printf__, 1, 2)));
 
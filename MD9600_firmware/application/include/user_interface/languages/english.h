@@ -334,6 +334,8 @@ const stringsTable_t englishLanguage =
 .p3talkaround = "Talkaround",
 .p3fastcall               = "fast channel",
 .p3filter                 = "filters",
+.dtmf_decoder             = "DTMF decode", // MaxLen 16 (with ':' + .off or .on or .dtmf_remote)
+.dtmf_remote              = "Remote",
 };
 /********************************************************************
  *
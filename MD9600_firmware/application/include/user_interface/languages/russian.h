@@ -301,6 +301,8 @@ const stringsTable_t russianLanguage =
 .p3talkaround             = "прямая связь",
 .p3fastcall               = "быстр. канал",
 .p3filter                 = "фильтры",
+.dtmf_decoder             = "Декод. DTMF",
+.dtmf_remote              = "Упр.",
 
 };
 /********************************************************************
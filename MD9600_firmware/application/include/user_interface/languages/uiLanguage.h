@@ -340,6 +340,8 @@ typedef struct
    const char p3talkaround[LANGUAGE_TEXTS_LENGTH];
    const char p3fastcall[LANGUAGE_TEXTS_LENGTH];
    const char p3filter[LANGUAGE_TEXTS_LENGTH];
+   const char dtmf_decoder[LANGUAGE_TEXTS_LENGTH];
+   const char dtmf_remote[LANGUAGE_TEXTS_LENGTH];
 } stringsTable_t;
 
 #endif // _OPENGD77_UILANGUAGE_H_
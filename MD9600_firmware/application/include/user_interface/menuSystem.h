@@ -119,6 +119,7 @@ typedef enum
 } uiNotificationID_t;
 
 #define NOTIFICATION_ID_USER_APO (NOTIFICATION_ID_USER)
+#define NOTIFICATION_ID_USER_DMR_DATA_MESSAGE (NOTIFICATION_ID_USER + 1)
 
 typedef struct
 {
@@ -328,6 +329,7 @@ enum MENU_SCREENS
 	MENU_COLOUR_PICKER,
 #endif
 	MENU_DMRID,
+	MENU_DIAGNOSTICS,
 	NUM_MENU_ENTRIES
 };
 
@@ -432,6 +434,7 @@ menuStatus_t menuZoneList(uiEvent_t *event, bool isFirstRun);
 menuStatus_t menuDisplayMenuList(uiEvent_t *event, bool isFirstRun);
 menuStatus_t menuRadioInfos(uiEvent_t *event, bool isFirstRun);
 menuStatus_t menuDMRID(uiEvent_t *event, bool isFirstRun);
+menuStatus_t menuDiagnostics(uiEvent_t *event, bool isFirstRun);
 menuStatus_t menuFirmwareInfoScreen(uiEvent_t *event, bool isFirstRun);
 menuStatus_t menuNumericalEntry(uiEvent_t *event, bool isFirstRun);
 menuStatus_t menuTxScreen(uiEvent_t *event, bool isFirstRun);
@@ -204,6 +204,7 @@ void uiUtilityRenderQSOData(void);
 void uiUtilityRenderHeader(bool isVFODualWatchScanning, bool isVFOSweepScanning);
 void uiUtilityRedrawHeaderOnly(bool isVFODualWatchScanning, bool isVFOSweepScanning);
 LinkItem_t *lastHeardFindInList(uint32_t id);
+bool lastHeardUpdateLocation(uint32_t id, double latitude, double longitude);
 void lastHeardInitList(void);
 void lastHeardClearWorkingTAData(void);
 bool lastHeardListUpdate(uint8_t *dmrDataBuffer, bool forceOnHotspot);
@@ -69,4 +69,24 @@
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
 #endif
 
+// Code and data placement (see STM32F405VGTX_FLASH.ld, tools/memory_map/map_report.py lists what landed where):
+//  - RAM_FUNCTION: copied to the RAM at boot, so its timing doesn't depend on the flash accelerator cache state.
+//    The calls to functions left in flash go through linker veneers. Nothing is placed there yet: a function only
+//    goes there with its before/after perf probe cycle counts (build with and without NO_RAM_FUNCTIONS).
+//  - CCM_DATA: placed in the 64KB core coupled RAM, zeroed at boot. It's only reachable by the CPU: never a DMA
+//    buffer, and no initializer.
+//#define NO_RAM_FUNCTIONS 1 // Enable this to keep all the code in flash (before/after timing measurements)
+
+#if !defined(RAM_FUNCTION)
+#if defined(NO_RAM_FUNCTIONS)
+#define RAM_FUNCTION
+#else
+#define RAM_FUNCTION __attribute__((section(".RamFunc"), noinline))
+#endif
+#endif
+
+#if !defined(CCM_DATA)
+#define CCM_DATA __attribute__((section(".ccmram")))
+#endif
+
 #endif
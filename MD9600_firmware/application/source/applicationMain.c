@@ -50,6 +50,13 @@
 #include "interfaces/gps.h"
 #include "interfaces/settingsStorage.h"
 #include "interfaces/remoteHead.h"
+#include "functions/cssDetector.h"
+#include "functions/dmrDataDecoder.h"
+#include "functions/trace.h"
+#include "functions/perf.h"
+#include "functions/scheduler.h"
+#include "functions/cpuStats.h"
+#include "functions/dtmfDecoder.h"
 
 #if defined(USING_EXTERNAL_DEBUGGER)
 #include "SeggerRTT/RTT/SEGGER_RTT.h"
@@ -307,6 +314,60 @@ static void latchedSk2Callback(void)
 	}
 }
 
+// Arms the deadlines of the main task clients (see scheduler.h), it then sleeps until the earliest one.
+static void scheduleNextPass(uint32_t startTime, bool hadEvent, uint32_t buttons, bool backlightCountingDown)
+{
+	int currentMenu = menuSystemGetCurrentMenuNumber();
+	uint32_t expiry;
+
+	// Everything which still counts the passes, or has to react within a ms, needs the next pass straight away.
+	// Otherwise, in the Channel/VFO screens, nothing happens until a key is pressed, the rotary encoder moves,
+	// a timer expires or some USB data is received.
+	if (hadEvent || (keyboardIsIdle() == false) || (buttons != BUTTON_NONE) || remoteHeadActive ||
+			(getAudioAmpStatus() != 0) || (melody_play != NULL) || voicePromptsIsPlaying() ||
+			trxTransmissionEnabled || trxIsTransmitting || (slotState != DMR_STATE_IDLE) ||
+			(aprsTxProgress != APRS_TX_IDLE) || uiDataGlobal.Scan.active || voxIsEnabled() ||
+			(nonVolatileSettings.gps > GPS_MODE_OFF) ||
+			((currentMenu != UI_CHANNEL_MODE) && (currentMenu != UI_VFO_MODE)))
+	{
+		schedulerSetDeadline(SCHEDULER_CLIENT_MAIN_LOOP, (startTime + 1));
+	}
+	else
+	{
+		schedulerClearDeadline(SCHEDULER_CLIENT_MAIN_LOOP);
+	}
+
+	if (ticksCallbackGetNextExpiry(&expiry))
+	{
+		schedulerSetDeadline(SCHEDULER_CLIENT_TICKS_CALLBACKS, expiry);
+	}
+	else
+	{
+		schedulerClearDeadline(SCHEDULER_CLIENT_TICKS_CALLBACKS);
+	}
+
+	// The rotary encoder posts an event, but the keypad and the buttons have to be polled.
+	schedulerSetDeadline(SCHEDULER_CLIENT_KEYBOARD, (startTime + KEYBOARD_IDLE_SCAN_PERIOD));
+
+	if (backlightCountingDown)
+	{
+		schedulerSetDeadline(SCHEDULER_CLIENT_DISPLAY, (startTime + menuDataGlobal.lightTimer));
+	}
+	else
+	{
+		schedulerClearDeadline(SCHEDULER_CLIENT_DISPLAY);
+	}
+
+	if (usbComHasPendingWork())
+	{
+		schedulerSetDeadline(SCHEDULER_CLIENT_USB, (startTime + 1));
+	}
+	else
+	{
+		schedulerClearDeadline(SCHEDULER_CLIENT_USB);
+	}
+}
+
 void applicationMainTask(void)
 {
 	keyboardCode_t keys;
@@ -321,6 +382,10 @@ void applicationMainTask(void)
 	int16_t *quickkeyPushedMenuMelody = NULL;
 	int keyFunction;
 	bool wasRestoringDefaultsettings = false;
+#if defined(USING_DMR_DATA_DECODER)
+	bool wasReceivingDMR = false;
+	dmrDataMessage_t dmrDataMessage;
+#endif
 	uiEvent_t ev = { .buttons = 0, .keys = NO_KEYCODE, .rotary = 0, .function = 0, .events = NO_EVENT, .hasEvent = false, .time = ticksGetMillis() };
 	bool safeBootMode = false;
 	bool forceSafeBootMode = false;
@@ -334,6 +399,8 @@ void applicationMainTask(void)
 	SEGGER_RTT_ConfigUpBuffer(0, NULL, NULL, 0, SEGGER_RTT_MODE_NO_BLOCK_TRIM);
 	SEGGER_RTT_printf(0,"Segger RTT initialised\n");
 #endif
+	traceInit();
+	perfInit();
 
 	buttonsFrontPanelInit();
 	buttonsInit();
@@ -498,14 +565,25 @@ void applicationMainTask(void)
 	ticksTimerStart(&autolockTimer, (nonVolatileSettings.autolockTimer * 30000U));
 
 	aprsBeaconingInit();
+	dtmfDecoderInit();
+	cssDetectorInit();
+	dmrDataDecoderInit();
 	aprsBeaconingStart();
+	schedulerInit();
+	cpuStatsInit();
+
+	uint32_t lastPassTime = ticksGetMillis();
 
 	/* Infinite loop */
 	for(;;)
 	{
 		uint16_t frontPanelButtons = FRONT_KEY_NONE;
 		uint32_t startTime = ticksGetMillis();
+		uint32_t elapsed = (startTime - lastPassTime); // the passes aren't 1ms apart when idle
 		bool syntheticEvent = false; // used to not trigger the backlight on faked key/button events
+		bool backlightCountingDown = false;
+
+		lastPassTime = startTime;
 
 		mainIsRunning = true;
 		keyOrButtonChanged = false;
@@ -525,6 +603,13 @@ void applicationMainTask(void)
 			// frontPanelButtons variable will have ALARM, P1 and P2 states cleared, as they will
 			// become ORANGE, SK2 and SK1 buttons, after calling buttonsCheckButtonsEvent()
 			buttonsCheckButtonsEvent(&buttons, &button_event, (keys.key != 0), uiDataGlobal.sk2latched, &frontPanelButtons); // Read button state and event
+
+			// DTMF remote control, the received digits are faked as key events.
+			if ((key_event == EVENT_KEY_NONE) && (keys.key == 0) && (keypadLocked == false) && dtmfDecoderGetRemoteKey(&keys))
+			{
+				key_event = EVENT_KEY_CHANGE;
+				syntheticEvent = true;
+			}
 		}
 		else
 		{
@@ -1303,7 +1388,8 @@ void applicationMainTask(void)
 			if ((nonVolatileSettings.backlightMode == BACKLIGHT_MODE_AUTO) || (nonVolatileSettings.backlightMode == BACKLIGHT_MODE_BUTTONS) ||
 					((nonVolatileSettings.backlightMode == BACKLIGHT_MODE_SQUELCH) && ((getAudioAmpStatus() & AUDIO_AMP_MODE_RF) == 0)))
 			{
-				menuDataGlobal.lightTimer--;
+				menuDataGlobal.lightTimer = (((uint32_t)menuDataGlobal.lightTimer > elapsed) ? (menuDataGlobal.lightTimer - elapsed) : 0);
+				backlightCountingDown = (menuDataGlobal.lightTimer > 0);
 			}
 
 			if (menuDataGlobal.lightTimer == 0)
@@ -1317,6 +1403,27 @@ void applicationMainTask(void)
 		voxTick();
 		gpsTick();
 		aprsBeaconingTick(&ev);
+		dtmfDecoderTick();
+		dmrDataDecoderTick();
+
+#if defined(USING_DMR_DATA_DECODER)
+		// Call end, a data message which didn't get all of its blocks won't get them anymore
+		if (slotState != DMR_STATE_IDLE)
+		{
+			wasReceivingDMR = true;
+		}
+		else if (wasReceivingDMR)
+		{
+			wasReceivingDMR = false;
+			dmrDataDecoderReset();
+		}
+
+		if (dmrDataDecoderGetMessage(&dmrDataMessage) && (settingsUsbMode != USB_MODE_HOTSPOT))
+		{
+			uiNotificationShow(NOTIFICATION_TYPE_MESSAGE, NOTIFICATION_ID_USER_DMR_DATA_MESSAGE, 5000U, dmrDataMessage.text, true);
+		}
+#endif
+		cpuStatsTick();
 		settingsSaveIfNeeded(false);
 
 		if (((trxTransmissionEnabled || trxIsTransmitting) == false))
@@ -1337,10 +1444,32 @@ void applicationMainTask(void)
 			}
 #endif
 		}
-		
-		while(ticksGetMillis() < startTime + 1)				// ensure this Task runs at 1ms intervals. Regardless of clock speed.
+
+		traceDrain();
+
+		// Sleep until the earliest subsystem deadline (1ms at most while something needs every pass, the idle keyboard scan period otherwise).
+		// The USB traffic is handled as soon as it happens in the meantime, and the rotary encoder starts a pass straight away.
+		scheduleNextPass(startTime, (keyOrButtonChanged || (function_event != NO_EVENT)), buttons, backlightCountingDown);
+
+		while (schedulerIsAnyDue(ticksGetMillis()) == false)
 		{
-			vTaskDelay(0);
+			uint32_t events = schedulerWait();
+
+			if (events & SCHEDULER_EVENT_USB)
+			{
+				tick_com_request();
+
+				// A CPS request may have started some background work
+				if (usbComHasPendingWork())
+				{
+					schedulerSetDeadline(SCHEDULER_CLIENT_USB, (ticksGetMillis() + 1));
+				}
+			}
+
+			if (events & SCHEDULER_EVENT_INPUT)
+			{
+				break;
+			}
 		}
 
 	}
@@ -824,13 +824,20 @@ void aprsBitStreamSender(void)
 		int tval = (newTone * 65536) / 32000;												//calculate the value required to generate this tone
 		uint8_t tH = (tval >> 8) & 0xFF;
 		uint8_t tL = tval & 0xFF;
-		SPI0WritePageRegByteExtended(0x01, 0x11B, tH);// Set  DTMF tone osc 1 to frequency of the required tone
-		SPI0WritePageRegByteExtended(0x01, 0x11A, tL);
+		spi0Batch_t batch;
 
+		// Both oscillators are updated in the same critical section, so the tone pair never gets out of step
+		SPI0BatchInit(&batch);
+		SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x11B, tH);// Set  DTMF tone osc 1 to frequency of the required tone
+		SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x11A, tL);
 
-		SPI0WritePageRegByteExtended(0x01, 0x123, tH);// Set  DTMF tone osc 2 to frequency of the required tone
-		SPI0WritePageRegByteExtended(0x01, 0x122, tL);
-		lastTone = newTone;
+		SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x123, tH);// Set  DTMF tone osc 2 to frequency of the required tone
+		SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x122, tL);
+
+		if (SPI0BatchCommit(&batch) == 0)
+		{
+			lastTone = newTone; // otherwise, retry on next bit
+		}
 	}
 #else // PLATFORM_MD9600
 	newTone = (encoderData.baudIs300 ? 16000 : 12000) + ((dataByte & 0x01) ? (encoderData.baudIs300 ? 2000 : 10000) : 0);
@@ -1019,7 +1026,7 @@ static double aprsGetBearingAngleDiff(double a, double b)
 	return (delta <= 180.0 ? delta : (360.0 - delta));
 }
 
-static double DistanceBetweenTwoCoords(double lat1, double lon1, double lat2, double lon2)
+double aprsDistanceBetweenTwoCoords(double lat1, double lon1, double lat2, double lon2)
 {
 	// returns distance in meters between two positions, both specified
 	// as signed decimal-degrees latitude and longitude. Uses great-circle
@@ -1045,9 +1052,7 @@ static double DistanceBetweenTwoCoords(double lat1, double lon1, double lat2, do
 	return (delta * 6372795);
 }
 
-#if defined(APRS_USE_COURSETO_FOR_BEARING)
-
-static double courseTo(double lat1, double lon1, double lat2, double lon2)
+double aprsCourseTo(double lat1, double lon1, double lat2, double lon2)
 {
 	// returns course in degrees (North=0, West=270) from position 1 to position 2,
 	// both specified as signed decimal-degrees latitude and longitude.
@@ -1069,12 +1074,13 @@ static double courseTo(double lat1, double lon1, double lat2, double lon2)
 	return (a2 * RAD_TO_DEG);
 }
 
+#if defined(APRS_USE_COURSETO_FOR_BEARING)
 uint16_t aprsBeaconingGetBearing(void)
 {
-	if (DistanceBetweenTwoCoords(aprsBcnData.previousBearingPosition.latitude, aprsBcnData.previousBearingPosition.longitude,
+	if (aprsDistanceBetweenTwoCoords(aprsBcnData.previousBearingPosition.latitude, aprsBcnData.previousBearingPosition.longitude,
 			aprsBcnData.currentLocation.coords.latitude, aprsBcnData.currentLocation.coords.longitude) > 2.0)
 	{
-		aprsBcnData.currentCourse = (uint16_t)(courseTo(aprsBcnData.previousBearingPosition.latitude, aprsBcnData.previousBearingPosition.longitude,
+		aprsBcnData.currentCourse = (uint16_t)(aprsCourseTo(aprsBcnData.previousBearingPosition.latitude, aprsBcnData.previousBearingPosition.longitude,
 				aprsBcnData.currentLocation.coords.latitude, aprsBcnData.currentLocation.coords.longitude) * 1E2);
 
 		memcpy(&aprsBcnData.previousBearingPosition, &aprsBcnData.currentLocation.coords, sizeof(aprsBeaconingCoordinates_t));
@@ -1113,7 +1119,7 @@ static bool aprsSmartBeaconingCornerPegging(double *currentSpeedMPS, uint32_t *t
 
 static double aprsSmartBeaconingGetMaxSpeed(double currentSpeedMPS, uint32_t timeDiff)
 {
-    double dist = DistanceBetweenTwoCoords(aprsBcnData.currentLocation.coords.latitude, aprsBcnData.currentLocation.coords.longitude, aprsBcnData.previousLocation.coords.latitude, aprsBcnData.previousLocation.coords.longitude);
+    double dist = aprsDistanceBetweenTwoCoords(aprsBcnData.currentLocation.coords.latitude, aprsBcnData.currentLocation.coords.longitude, aprsBcnData.previousLocation.coords.latitude, aprsBcnData.previousLocation.coords.longitude);
 
     return MAX(MAX((dist / (timeDiff / MILLISECS_PER_SEC)), currentSpeedMPS), ((aprsBcnData.previousLocation.speed * 1E-2) * MPS_PER_KNOT));
 }
@@ -1740,7 +1746,7 @@ void aprsBeaconingTick(uiEvent_t *ev)
 
 						if (aprsBeaconingLocationIsValid(&aprsBcnData.currentLocation) && aprsBeaconingLocationIsValid(&aprsBcnData.previousLocation))
 						{
-							dist = DistanceBetweenTwoCoords(aprsBcnData.currentLocation.coords.latitude, aprsBcnData.currentLocation.coords.longitude, aprsBcnData.previousLocation.coords.latitude, aprsBcnData.previousLocation.coords.longitude);
+							dist = aprsDistanceBetweenTwoCoords(aprsBcnData.currentLocation.coords.latitude, aprsBcnData.currentLocation.coords.longitude, aprsBcnData.previousLocation.coords.latitude, aprsBcnData.previousLocation.coords.longitude);
 						}
 
 						ticksTimerStart(&aprsBcnData.nextBeaconTimer, ((initialIntervalsInSecs[aprsBcnData.settings.initialInterval] * MILLISECS_PER_SEC) * aprsBcnData.decayMult));
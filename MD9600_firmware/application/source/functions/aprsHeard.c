@@ -0,0 +1,304 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <math.h>
+#include <string.h>
+#include "functions/aprs.h"
+#include "functions/ticks.h"
+#include "utils.h"
+
+#if !defined(PLATFORM_GD77S)
+
+//
+// Heard stations table.
+//
+// Stations are kept in a fixed pool, indexed by a hash table (keyed by callsign-SSID) for O(1) lookup,
+// and chained in a LRU list (most recently heard first). When the pool is full, the least recently
+// heard station is recycled.
+// The links are stored as (index + 1), so the zeroed pool and hash table (CCM RAM, cleared at boot)
+// are an empty list, without any initialization.
+// Distance and bearing are only recomputed when they are requested and our own position has moved
+// (position epoch).
+//
+#define APRS_HEARD_HASH_SIZE                256U // power of 2
+#define APRS_HEARD_NONE                       0U
+#define APRS_HEARD_OWN_POSITION_MOVE_MIN    25.0 // m
+
+#define APRS_HEARD_LINK(index)              ((uint8_t)((index) + 1))
+#define APRS_HEARD_STATION(link)            (&aprsHeardStations[(link) - 1])
+
+static CCM_DATA aprsHeardStation_t aprsHeardStations[APRS_HEARD_LIST_SIZE];
+static CCM_DATA uint8_t aprsHeardHashTable[APRS_HEARD_HASH_SIZE];
+
+static struct
+{
+	uint8_t  head;
+	uint8_t  tail;
+	uint32_t count;
+	uint16_t positionEpoch; // 0 until our position is known
+	double   ownLatitude;
+	double   ownLongitude;
+} aprsHeard;
+
+static uint32_t aprsHeardHash(const char *callsign)
+{
+	// FNV-1a (AX.25 addresses are always upper case)
+	uint32_t hash = 2166136261U;
+
+	while (*callsign != 0)
+	{
+		hash ^= (uint8_t)*callsign;
+		hash *= 16777619U;
+		callsign++;
+	}
+
+	return (hash & (APRS_HEARD_HASH_SIZE - 1));
+}
+
+static void aprsHeardUnlinkLRU(aprsHeardStation_t *station)
+{
+	if (station->prev != APRS_HEARD_NONE)
+	{
+		APRS_HEARD_STATION(station->prev)->next = station->next;
+	}
+	else
+	{
+		aprsHeard.head = station->next;
+	}
+
+	if (station->next != APRS_HEARD_NONE)
+	{
+		APRS_HEARD_STATION(station->next)->prev = station->prev;
+	}
+	else
+	{
+		aprsHeard.tail = station->prev;
+	}
+}
+
+static void aprsHeardPushFrontLRU(uint8_t link)
+{
+	aprsHeardStation_t *station = APRS_HEARD_STATION(link);
+
+	station->prev = APRS_HEARD_NONE;
+	station->next = aprsHeard.head;
+
+	if (aprsHeard.head != APRS_HEARD_NONE)
+	{
+		APRS_HEARD_STATION(aprsHeard.head)->prev = link;
+	}
+	aprsHeard.head = link;
+
+	if (aprsHeard.tail == APRS_HEARD_NONE)
+	{
+		aprsHeard.tail = link;
+	}
+}
+
+static void aprsHeardUnlinkHash(uint8_t link)
+{
+	uint8_t *bucketLink = &aprsHeardHashTable[aprsHeardHash(APRS_HEARD_STATION(link)->callsign)];
+
+	while (*bucketLink != APRS_HEARD_NONE)
+	{
+		if (*bucketLink == link)
+		{
+			*bucketLink = APRS_HEARD_STATION(link)->hashNext;
+			return;
+		}
+
+		bucketLink = &APRS_HEARD_STATION(*bucketLink)->hashNext;
+	}
+}
+
+void aprsHeardClear(void)
+{
+	memset(aprsHeardHashTable, 0, sizeof(aprsHeardHashTable));
+	memset(aprsHeardStations, 0, sizeof(aprsHeardStations));
+	memset(&aprsHeard, 0, sizeof(aprsHeard));
+}
+
+// The stored key is at most (APRS_HEARD_CALLSIGN_LEN_MAX - 1) chars, the lookups use the same
+// truncated key, otherwise a longer callsign would never be found again.
+static void aprsHeardMakeKey(char *key, const char *callsign)
+{
+	strncpy(key, callsign, (APRS_HEARD_CALLSIGN_LEN_MAX - 1));
+	key[APRS_HEARD_CALLSIGN_LEN_MAX - 1] = 0;
+}
+
+static aprsHeardStation_t *aprsHeardFindKey(const char *key)
+{
+	uint8_t link = aprsHeardHashTable[aprsHeardHash(key)];
+
+	while (link != APRS_HEARD_NONE)
+	{
+		aprsHeardStation_t *station = APRS_HEARD_STATION(link);
+
+		if (strcmp(station->callsign, key) == 0)
+		{
+			return station;
+		}
+
+		link = station->hashNext;
+	}
+
+	return NULL;
+}
+
+aprsHeardStation_t *aprsHeardFind(const char *callsign)
+{
+	char key[APRS_HEARD_CALLSIGN_LEN_MAX];
+
+	aprsHeardMakeKey(key, callsign);
+
+	return aprsHeardFindKey(key);
+}
+
+// Add or refresh a station, which becomes the head of the list.
+// latitude/longitude can be NAN if the packet doesn't carry a position, the previous one is kept in that case.
+aprsHeardStation_t *aprsHeardUpdate(const char *callsign, double latitude, double longitude, uint16_t course, uint16_t speed, const char *comment)
+{
+	char key[APRS_HEARD_CALLSIGN_LEN_MAX];
+	aprsHeardStation_t *station;
+	uint8_t link;
+
+	aprsHeardMakeKey(key, callsign);
+	station = aprsHeardFindKey(key);
+
+	if (station != NULL)
+	{
+		link = APRS_HEARD_LINK(station - aprsHeardStations);
+		aprsHeardUnlinkLRU(station);
+	}
+	else
+	{
+		if (aprsHeard.count < APRS_HEARD_LIST_SIZE)
+		{
+			link = APRS_HEARD_LINK(aprsHeard.count);
+			aprsHeard.count++;
+		}
+		else
+		{
+			// Recycle the least recently heard station
+			link = aprsHeard.tail;
+			aprsHeardUnlinkLRU(APRS_HEARD_STATION(link));
+			aprsHeardUnlinkHash(link);
+		}
+
+		station = APRS_HEARD_STATION(link);
+
+		memset(station, 0, sizeof(aprsHeardStation_t));
+		strcpy(station->callsign, key);
+		station->latitude = station->longitude = NAN;
+
+		uint32_t bucket = aprsHeardHash(key);
+		station->hashNext = aprsHeardHashTable[bucket];
+		aprsHeardHashTable[bucket] = link;
+	}
+
+	if ((isnan(latitude) == 0) && (isnan(longitude) == 0))
+	{
+		station->latitude = latitude;
+		station->longitude = longitude;
+		station->positionEpoch = 0; // force distance/bearing computation
+	}
+
+	station->course = course;
+	station->speed = speed;
+	station->time = ticksGetMillis();
+
+	if (comment != NULL)
+	{
+		strncpy(station->comment, comment, (APRS_HEARD_COMMENT_LEN_MAX - 1));
+		station->comment[APRS_HEARD_COMMENT_LEN_MAX - 1] = 0;
+	}
+
+	aprsHeardPushFrontLRU(link);
+
+	return station;
+}
+
+aprsHeardStation_t *aprsHeardGetFirst(void)
+{
+	return ((aprsHeard.head != APRS_HEARD_NONE) ? APRS_HEARD_STATION(aprsHeard.head) : NULL);
+}
+
+aprsHeardStation_t *aprsHeardGetNext(aprsHeardStation_t *station)
+{
+	return (((station != NULL) && (station->next != APRS_HEARD_NONE)) ? APRS_HEARD_STATION(station->next) : NULL);
+}
+
+uint32_t aprsHeardGetCount(void)
+{
+	return aprsHeard.count;
+}
+
+// Our reference position (GPS fix or fixed position). All the distances/bearings are invalidated when it
+// moved far enough, the small GPS position wander is ignored.
+void aprsHeardSetOwnPosition(double latitude, double longitude)
+{
+	if ((isnan(latitude) != 0) || (isnan(longitude) != 0))
+	{
+		return;
+	}
+
+	if ((aprsHeard.positionEpoch == 0) ||
+			(aprsDistanceBetweenTwoCoords(aprsHeard.ownLatitude, aprsHeard.ownLongitude, latitude, longitude) > APRS_HEARD_OWN_POSITION_MOVE_MIN))
+	{
+		aprsHeard.ownLatitude = latitude;
+		aprsHeard.ownLongitude = longitude;
+
+		aprsHeard.positionEpoch++;
+		if (aprsHeard.positionEpoch == 0)
+		{
+			aprsHeard.positionEpoch = 1U;
+		}
+	}
+}
+
+// Returns false if either our position or the station one is unknown.
+bool aprsHeardGetDistanceAndBearing(aprsHeardStation_t *station, uint32_t *distance, uint16_t *bearing)
+{
+	if ((isnan(station->latitude) != 0) || (aprsHeard.positionEpoch == 0))
+	{
+		return false;
+	}
+
+	if (station->positionEpoch != aprsHeard.positionEpoch)
+	{
+		station->distance = (uint32_t)aprsDistanceBetweenTwoCoords(aprsHeard.ownLatitude, aprsHeard.ownLongitude, station->latitude, station->longitude);
+		station->bearing = (uint16_t)round(aprsCourseTo(aprsHeard.ownLatitude, aprsHeard.ownLongitude, station->latitude, station->longitude)) % 360U;
+		station->positionEpoch = aprsHeard.positionEpoch;
+	}
+
+	*distance = station->distance;
+	*bearing = station->bearing;
+
+	return true;
+}
+
+#endif // PLATFORM_GD77S
@@ -132,9 +132,16 @@ typedef struct
 	int dataLength;
 } codeplugCustomDataBlockHeader_t;
 
-__attribute__((section(".data.$RAM2"))) codeplugContactsCache_t codeplugContactsCache;
+// Looked up on each received call
+#if defined(PLATFORM_MD9600)
+#define CONTACTS_CACHE_RAMLOCATION ".ccmram"
+#else
+#define CONTACTS_CACHE_RAMLOCATION ".data.$RAM2"
+#endif
+
+__attribute__((section(CONTACTS_CACHE_RAMLOCATION))) codeplugContactsCache_t codeplugContactsCache;
 
-__attribute__((section(".data.$RAM2"))) uint8_t codeplugRXGroupCache[CODEPLUG_RX_GROUPLIST_MAX];
+__attribute__((section(CONTACTS_CACHE_RAMLOCATION))) uint8_t codeplugRXGroupCache[CODEPLUG_RX_GROUPLIST_MAX];
 __attribute__((section(".data.$RAM2"))) uint8_t codeplugAllChannelsCache[128];
 __attribute__((section(".data.$RAM2"))) uint8_t codeplugZonesInUseCache[CODEPLUG_EX_ZONE_INUSE_PACKED_DATA_SIZE];
 __attribute__((section(".data.$RAM2"))) uint16_t quickKeysCache[CODEPLUG_QUICKKEYS_SIZE];
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <string.h>
+#include "main.h"
+#include "functions/cpuStats.h"
+#include "functions/ticks.h"
+#include "functions/taskMemory.h"
+
+//
+// Per task CPU load, stack and heap usage.
+//
+// FreeRTOS accumulates the run time of each task with TIM5, a free running 32 bits counter at
+// CPU_STATS_COUNTER_FREQUENCY. The DWT cycle counter can't be used here, as it stops while the idle task
+// sleeps in WFI. The loads are computed from the counters differences between two updates, so the counters
+// wrapping (every ~71 minutes) doesn't matter.
+//
+typedef struct
+{
+	ticksTimer_t updateTimer;
+	TaskStatus_t status[CPU_STATS_TASKS_MAX];
+	cpuStats_t   stats;
+} cpuStatsData_t;
+
+static cpuStatsData_t cpuStatsData;
+
+
+// Called by the FreeRTOS kernel, when the scheduler starts (portCONFIGURE_TIMER_FOR_RUN_TIME_STATS)
+void cpuStatsConfigureTimer(void)
+{
+	uint32_t timerClock = HAL_RCC_GetPCLK1Freq();
+
+	// APB1 timers are clocked at twice PCLK1, unless the APB1 prescaler is 1
+	if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_CFGR_PPRE1_DIV1)
+	{
+		timerClock *= 2;
+	}
+
+	__HAL_RCC_TIM5_CLK_ENABLE();
+
+	TIM5->CR1 = 0;
+	TIM5->PSC = ((timerClock / CPU_STATS_COUNTER_FREQUENCY) - 1);
+	TIM5->ARR = 0xFFFFFFFF;
+	TIM5->CNT = 0;
+	TIM5->EGR = TIM_EGR_UG; // load the prescaler now
+	TIM5->CR1 = TIM_CR1_CEN;
+}
+
+void cpuStatsInit(void)
+{
+	memset(&cpuStatsData.stats, 0, sizeof(cpuStats_t));
+	ticksTimerStart(&cpuStatsData.updateTimer, 0);
+}
+
+// Called from the main loop
+void cpuStatsTick(void)
+{
+	if (ticksTimerHasExpired(&cpuStatsData.updateTimer))
+	{
+		uint32_t totalRunTime;
+		UBaseType_t count = uxTaskGetSystemState(cpuStatsData.status, CPU_STATS_TASKS_MAX, &totalRunTime);
+
+		// uxTaskGetSystemState() returns nothing when the array is too small
+		cpuStatsData.stats.overflow = ((count == 0) && (uxTaskGetNumberOfTasks() > CPU_STATS_TASKS_MAX));
+
+		if (count > 0)
+		{
+			cpuStatsAccount(&cpuStatsData.stats, cpuStatsData.status, count, totalRunTime, xTaskGetIdleTaskHandle());
+		}
+
+		cpuStatsData.stats.heapFree = xPortGetFreeHeapSize();
+		cpuStatsData.stats.heapMinimumEverFree = xPortGetMinimumEverFreeHeapSize();
+
+		ticksTimerStart(&cpuStatsData.updateTimer, CPU_STATS_UPDATE_PERIOD);
+	}
+}
+
+const cpuStats_t *cpuStatsGet(void)
+{
+	return &cpuStatsData.stats;
+}
+
+// Updates the stats from a uxTaskGetSystemState() snapshot.
+// The tasks unknown at the previous update (and all of them on the first one) get a 0 load, as there is no
+// reference for their counter yet.
+void cpuStatsAccount(cpuStats_t *stats, const TaskStatus_t *status, uint32_t count, uint32_t totalRunTime, TaskHandle_t idleTask)
+{
+	uint32_t deltas[CPU_STATS_TASKS_MAX];
+	uint32_t busy = 0;
+
+	if (count > CPU_STATS_TASKS_MAX)
+	{
+		count = CPU_STATS_TASKS_MAX;
+	}
+
+	stats->periodRunTime = ((stats->taskCount > 0) ? (totalRunTime - stats->totalRunTime) : 0);
+	stats->totalRunTime = totalRunTime;
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		deltas[i] = 0;
+
+		for (uint32_t t = 0; t < stats->taskCount; t++)
+		{
+			if (stats->tasks[t].handle == status[i].xHandle)
+			{
+				deltas[i] = (status[i].ulRunTimeCounter - stats->tasks[t].runTime);
+				break;
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		cpuStatsTask_t *task = &stats->tasks[i];
+		uint32_t load = ((stats->periodRunTime > 0) ? (uint32_t)(((uint64_t)deltas[i] * 1000U) / stats->periodRunTime) : 0);
+
+		task->handle = status[i].xHandle;
+		strncpy(task->name, status[i].pcTaskName, (configMAX_TASK_NAME_LEN - 1));
+		task->name[configMAX_TASK_NAME_LEN - 1] = 0;
+		task->runTime = status[i].ulRunTimeCounter;
+		task->loadPermille = ((load > 1000U) ? 1000U : load);
+		task->stackHighWater = status[i].usStackHighWaterMark;
+		task->stackSize = taskMemoryGetStackSize(status[i].pxStackBase);
+		task->priority = status[i].uxCurrentPriority;
+		task->number = status[i].xTaskNumber;
+
+		if (status[i].xHandle != idleTask)
+		{
+			busy += task->loadPermille;
+		}
+	}
+
+	stats->taskCount = count;
+	stats->loadPermille = ((busy > 1000U) ? 1000U : busy);
+
+	// Keep the creation order, uxTaskGetSystemState() lists the tasks by state
+	for (uint32_t i = 1; i < count; i++)
+	{
+		cpuStatsTask_t task = stats->tasks[i];
+		uint32_t j = i;
+
+		while ((j > 0) && (stats->tasks[j - 1].number > task.number))
+		{
+			stats->tasks[j] = stats->tasks[j - 1];
+			j--;
+		}
+
+		stats->tasks[j] = task;
+	}
+}
@@ -0,0 +1,415 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include <math.h>
+#include <string.h>
+#include "functions/cssDetector.h"
+#include "functions/dtmfDecoder.h"
+#include "functions/sound.h"
+#include "functions/trx.h"
+
+//
+// Software sub-audible tone detector, used to identify the CTCSS/DCS of a received signal in one go,
+// instead of stepping through each tone with the HR-C6000 decoder.
+//
+// The 8kHz RX audio is decimated to 1kHz (3rd order CIC, so a whistle doesn't alias in the CTCSS band) and the DC removed, then:
+//  - CTCSS: a fixed point Goertzel bank evaluates all the tones over a 250ms window. A tone is reported when
+//    its power is above CSS_DETECTOR_POWER_MIN, at least 6dB above any non adjacent tone, and holds a fair
+//    share of the window energy (no noise/speech).
+//    The adjacent tones (down to 2.3Hz apart) are within the 4Hz main lobe of each other's filter, they are only
+//    told apart by the strongest filter. The filter response falls monotonically away from its tone, so a signal
+//    up to half the spacing off frequency (1.15Hz for the closest tones) still peaks on its nominal filter.
+//  - DCS: the audio is low passed and sliced, a DPLL recovers the 134.4 bps clock, and every received bit the
+//    last 23 bits are checked against each rotation of the Golay(23,12) codewords (normal and inverted polarity).
+//    A code is reported once it has been decoded on CSS_DETECTOR_DCS_CONFIRMATIONS consecutive bits.
+//
+#define CSS_DETECTOR_NUM_CTCSS                50U
+#define CSS_DETECTOR_DECIMATED_RATE         (CSS_DETECTOR_SAMPLE_RATE / CSS_DETECTOR_DECIMATION)
+#define CSS_DETECTOR_COEFF_SHIFT              14 // coefficients are Q14
+#define CSS_DETECTOR_INPUT_SHIFT               4 // keep 12 bits per sample
+#define CSS_DETECTOR_CIC_SHIFT                 9 // CIC gain is (decimation ^ 3)
+#define CSS_DETECTOR_DC_SHIFT                  6 // ~2.5Hz high pass
+#define CSS_DETECTOR_POWER_MIN          4000000LL
+#define CSS_DETECTOR_RELATIVE_PEAK             4 // 6dB
+#define CSS_DETECTOR_ENERGY_RATIO             16 // tone power >= 1/8 of the pure tone power for the window energy
+#define CSS_DETECTOR_DCS_BITS                 23U
+#define CSS_DETECTOR_DCS_MASK         ((1U << CSS_DETECTOR_DCS_BITS) - 1U)
+#define CSS_DETECTOR_DCS_PHASE_INC          8808U // 134.4 / 1000 * 65536
+#define CSS_DETECTOR_DCS_ERRORS_MAX            1
+#define CSS_DETECTOR_DCS_CONFIRMATIONS         8U
+
+typedef struct
+{
+	uint32_t          integrator1; // unsigned, the CIC integrators are allowed to wrap
+	uint32_t          integrator2;
+	uint32_t          integrator3;
+	uint32_t          comb1Delay;
+	uint32_t          comb2Delay;
+	uint32_t          comb3Delay;
+	uint8_t           decimationCount;
+	int32_t           dcLevel; // << CSS_DETECTOR_DC_SHIFT
+	uint8_t           numTones;
+	int32_t           coeffs[CSS_DETECTOR_NUM_CTCSS];
+	int32_t           s1[CSS_DETECTOR_NUM_CTCSS];
+	int32_t           s2[CSS_DETECTOR_NUM_CTCSS];
+	int64_t           energy;
+	uint32_t          sampleCount;
+	int32_t           dcsLowPass;
+	bool              dcsLevel;
+	uint16_t          dcsPhase;
+	uint32_t          dcsWord;
+	uint8_t           dcsBitCount;
+	uint16_t          dcsCandidate;
+	uint8_t           dcsMatches;
+	CodeplugCSSTypes_t types; // CSS_TYPE_NONE: all
+	volatile uint16_t detectedTone; // written by the audio ISR
+	volatile bool     active;
+} cssDetectorData_t;
+
+static cssDetectorData_t cssDetector;
+
+static void cssDetectorResetWindow(void)
+{
+	memset(cssDetector.s1, 0, sizeof(cssDetector.s1));
+	memset(cssDetector.s2, 0, sizeof(cssDetector.s2));
+	cssDetector.energy = 0;
+	cssDetector.sampleCount = 0;
+}
+
+static void cssDetectorResetState(void)
+{
+	cssDetector.integrator1 = cssDetector.integrator2 = cssDetector.integrator3 = 0;
+	cssDetector.comb1Delay = cssDetector.comb2Delay = cssDetector.comb3Delay = 0;
+	cssDetector.decimationCount = 0;
+	cssDetector.dcLevel = 0;
+	cssDetectorResetWindow();
+	cssDetector.dcsLowPass = 0;
+	cssDetector.dcsLevel = false;
+	cssDetector.dcsPhase = 0;
+	cssDetector.dcsWord = 0;
+	cssDetector.dcsBitCount = 0;
+	cssDetector.dcsCandidate = CODEPLUG_CSS_TONE_NONE;
+	cssDetector.dcsMatches = 0;
+	cssDetector.detectedTone = CODEPLUG_CSS_TONE_NONE;
+}
+
+static inline int64_t cssDetectorTonePower(int tone)
+{
+	int64_t s1 = cssDetector.s1[tone];
+	int64_t s2 = cssDetector.s2[tone];
+
+	return ((s1 * s1) + (s2 * s2) - (((cssDetector.coeffs[tone] * s1) >> CSS_DETECTOR_COEFF_SHIFT) * s2));
+}
+
+static void cssDetectorEndOfWindow(void)
+{
+	int64_t powers[CSS_DETECTOR_NUM_CTCSS];
+	int64_t otherPower = 0;
+	uint8_t peak = 0;
+
+	for (uint8_t i = 0; i < cssDetector.numTones; i++)
+	{
+		powers[i] = cssDetectorTonePower(i);
+
+		if (powers[i] > powers[peak])
+		{
+			peak = i;
+		}
+	}
+
+	// Adjacent tones are too close (down to 2.3Hz) to be rejected with a 4Hz resolution, skip them: the peak is the
+	// nominal tone
+	for (uint8_t i = 0; i < cssDetector.numTones; i++)
+	{
+		if (((i + 1) < peak) || (i > (peak + 1)))
+		{
+			if (powers[i] > otherPower)
+			{
+				otherPower = powers[i];
+			}
+		}
+	}
+
+	// A pure tone gives power == (energy * N / 2)
+	if ((powers[peak] >= CSS_DETECTOR_POWER_MIN) &&
+			(powers[peak] > (otherPower * CSS_DETECTOR_RELATIVE_PEAK)) &&
+			((powers[peak] * CSS_DETECTOR_ENERGY_RATIO) >= (cssDetector.energy * CSS_DETECTOR_WINDOW_SIZE)))
+	{
+		// A decoded DCS is more reliable than a spectral line
+		if (cssDetector.dcsMatches < CSS_DETECTOR_DCS_CONFIRMATIONS)
+		{
+			cssDetector.detectedTone = TRX_CTCSSTones[peak];
+		}
+	}
+
+	cssDetectorResetWindow();
+}
+
+static uint32_t cssDetectorGolayEncode(uint32_t data)
+{
+	uint32_t cw = data;
+
+	for (int i = 0; i < 12; i++)
+	{
+		if (cw & 1)
+		{
+			cw ^= 0xC75; // DCS generator polynomial, gives the standard codewords (e.g. 023 -> 0x763813)
+		}
+		cw >>= 1;
+	}
+
+	return ((cw << 12) | data);
+}
+
+// The DCS codeword is sent continuously, so any 23 bits window holds a rotation of it.
+// Returns the DCS code (in the TRX_DCSCodes[] format), or CODEPLUG_CSS_TONE_NONE.
+static uint16_t cssDetectorDcsMatch(uint32_t word)
+{
+	for (uint8_t r = 0; r < CSS_DETECTOR_DCS_BITS; r++)
+	{
+		// 9 bits code followed by the 100 marker
+		if ((word & 0xE00) == 0x800)
+		{
+			if (__builtin_popcount(cssDetectorGolayEncode(word & 0xFFF) ^ word) <= CSS_DETECTOR_DCS_ERRORS_MAX)
+			{
+				uint16_t code = (((word >> 6) & 0x07) << 8) | (((word >> 3) & 0x07) << 4) | (word & 0x07);
+
+				for (uint8_t i = 0; i < TRX_NUM_DCS; i++)
+				{
+					if (TRX_DCSCodes[i] == code)
+					{
+						return code;
+					}
+				}
+			}
+		}
+
+		word = ((word >> 1) | (word << (CSS_DETECTOR_DCS_BITS - 1))) & CSS_DETECTOR_DCS_MASK;
+	}
+
+	return CODEPLUG_CSS_TONE_NONE;
+}
+
+static void cssDetectorDcsBit(bool bit)
+{
+	uint16_t code;
+
+	cssDetector.dcsWord = (cssDetector.dcsWord >> 1) | (bit ? (1U << (CSS_DETECTOR_DCS_BITS - 1)) : 0);
+
+	if (cssDetector.dcsBitCount < CSS_DETECTOR_DCS_BITS)
+	{
+		cssDetector.dcsBitCount++;
+		return;
+	}
+
+	// Some normal codes are rotations of inverted ones (e.g. 023N and 047I), the normal polarity wins when both are searched
+	code = CODEPLUG_CSS_TONE_NONE;
+	if ((cssDetector.types & CSS_TYPE_NONE) || (cssDetector.types == CSS_TYPE_DCS))
+	{
+		if ((code = cssDetectorDcsMatch(cssDetector.dcsWord)) != CODEPLUG_CSS_TONE_NONE)
+		{
+			code |= CSS_TYPE_DCS;
+		}
+	}
+
+	if ((code == CODEPLUG_CSS_TONE_NONE) && (cssDetector.types & (CSS_TYPE_NONE | CSS_TYPE_DCS_INVERTED)))
+	{
+		if ((code = cssDetectorDcsMatch(~cssDetector.dcsWord & CSS_DETECTOR_DCS_MASK)) != CODEPLUG_CSS_TONE_NONE)
+		{
+			code |= (CSS_TYPE_DCS | CSS_TYPE_DCS_INVERTED);
+		}
+	}
+
+	if ((code != CODEPLUG_CSS_TONE_NONE) && (code == cssDetector.dcsCandidate))
+	{
+		if (cssDetector.dcsMatches < CSS_DETECTOR_DCS_CONFIRMATIONS)
+		{
+			cssDetector.dcsMatches++;
+		}
+
+		if (cssDetector.dcsMatches >= CSS_DETECTOR_DCS_CONFIRMATIONS)
+		{
+			cssDetector.detectedTone = code;
+		}
+	}
+	else
+	{
+		cssDetector.dcsCandidate = code;
+		cssDetector.dcsMatches = ((code != CODEPLUG_CSS_TONE_NONE) ? 1 : 0);
+	}
+}
+
+static void cssDetectorProcessDecimated(int32_t x)
+{
+	// DC removal
+	cssDetector.dcLevel += (x - (cssDetector.dcLevel >> CSS_DETECTOR_DC_SHIFT));
+	x -= (cssDetector.dcLevel >> CSS_DETECTOR_DC_SHIFT);
+
+	// CTCSS
+	if (cssDetector.types & (CSS_TYPE_NONE | CSS_TYPE_CTCSS))
+	{
+		for (uint8_t i = 0; i < cssDetector.numTones; i++)
+		{
+			int32_t s0 = x + (int32_t)((cssDetector.coeffs[i] * (int64_t)cssDetector.s1[i]) >> CSS_DETECTOR_COEFF_SHIFT) - cssDetector.s2[i];
+
+			cssDetector.s2[i] = cssDetector.s1[i];
+			cssDetector.s1[i] = s0;
+		}
+
+		cssDetector.energy += (x * x);
+
+		if (++cssDetector.sampleCount == CSS_DETECTOR_WINDOW_SIZE)
+		{
+			cssDetectorEndOfWindow();
+		}
+	}
+
+	if ((cssDetector.types & (CSS_TYPE_NONE | CSS_TYPE_DCS)) == 0)
+	{
+		return;
+	}
+
+	// DCS, ~110Hz low pass then slicing
+	cssDetector.dcsLowPass += ((x - cssDetector.dcsLowPass) >> 1);
+
+	bool level = (cssDetector.dcsLowPass > 0);
+
+	// Bit boundaries are expected on the phase wrap, pull the phase toward it on each transition
+	if (level != cssDetector.dcsLevel)
+	{
+		cssDetector.dcsLevel = level;
+		cssDetector.dcsPhase -= ((int16_t)cssDetector.dcsPhase >> 2);
+	}
+
+	uint16_t previousPhase = cssDetector.dcsPhase;
+
+	cssDetector.dcsPhase += CSS_DETECTOR_DCS_PHASE_INC;
+
+	// Sample in the middle of the bit
+	if ((previousPhase < 0x8000) && (cssDetector.dcsPhase >= 0x8000))
+	{
+		cssDetectorDcsBit(level);
+	}
+}
+
+void cssDetectorInit(void)
+{
+	memset(&cssDetector, 0, sizeof(cssDetectorData_t));
+
+	cssDetector.numTones = ((TRX_NUM_CTCSS < CSS_DETECTOR_NUM_CTCSS) ? TRX_NUM_CTCSS : CSS_DETECTOR_NUM_CTCSS);
+
+	// 2 * cos(2 * PI * f / 1000) in Q14, tones are stored in tenth of Hz
+	for (uint8_t i = 0; i < cssDetector.numTones; i++)
+	{
+		cssDetector.coeffs[i] = (int32_t)lround(2.0 * cos((2.0 * M_PI * (TRX_CTCSSTones[i] / 10.0)) / CSS_DETECTOR_DECIMATED_RATE) * (1 << CSS_DETECTOR_COEFF_SHIFT));
+	}
+
+	cssDetectorResetState();
+}
+
+// types is the CSS type to look for (CSS_TYPE_CTCSS, CSS_TYPE_DCS, (CSS_TYPE_DCS | CSS_TYPE_DCS_INVERTED)), or CSS_TYPE_NONE for all of them
+void cssDetectorStart(CodeplugCSSTypes_t types)
+{
+	taskENTER_CRITICAL();
+	cssDetectorResetState();
+	cssDetector.types = types;
+	cssDetector.active = true;
+	taskEXIT_CRITICAL();
+
+	soundMonitorStart();
+}
+
+void cssDetectorStop(void)
+{
+	cssDetector.active = false;
+
+	// The DTMF decoder may still need the audio capture
+	if (dtmfDecoderIsActive() == false)
+	{
+		soundMonitorStop();
+	}
+}
+
+bool cssDetectorIsActive(void)
+{
+	return cssDetector.active;
+}
+
+// Called from the I2S DMA interrupt, cost is bounded to (50 Goertzel iterations + 1 DCS bit check) per decimated sample
+void cssDetectorProcessSamples(const int16_t *samples, size_t count, size_t stride)
+{
+	if (cssDetector.active == false)
+	{
+		return;
+	}
+
+	while (count-- > 0)
+	{
+		cssDetector.integrator1 += (uint32_t)(int32_t)(*samples >> CSS_DETECTOR_INPUT_SHIFT);
+		cssDetector.integrator2 += cssDetector.integrator1;
+		cssDetector.integrator3 += cssDetector.integrator2;
+
+		if (++cssDetector.decimationCount == CSS_DETECTOR_DECIMATION)
+		{
+			uint32_t comb1 = cssDetector.integrator3 - cssDetector.comb1Delay;
+			uint32_t comb2 = comb1 - cssDetector.comb2Delay;
+			uint32_t comb3 = comb2 - cssDetector.comb3Delay;
+
+			cssDetector.comb1Delay = cssDetector.integrator3;
+			cssDetector.comb2Delay = comb1;
+			cssDetector.comb3Delay = comb2;
+			cssDetector.decimationCount = 0;
+
+			cssDetectorProcessDecimated((int32_t)comb3 >> CSS_DETECTOR_CIC_SHIFT);
+		}
+
+		samples += stride;
+	}
+}
+
+// Returns the detected tone, either a CTCSS frequency (in tenth of Hz), or a DCS code with its CSS_TYPE_DCS* flags.
+bool cssDetectorGetTone(uint16_t *tone)
+{
+	uint16_t detected = cssDetector.detectedTone;
+
+	if ((cssDetector.active == false) || (detected == CODEPLUG_CSS_TONE_NONE))
+	{
+		return false;
+	}
+
+	*tone = detected;
+
+	return true;
+}
+
+void cssDetectorTick(void)
+{
+	if (cssDetector.active)
+	{
+		// (Re)start the audio capture if nothing else is using the I2S bus
+		soundMonitorStart();
+	}
+}
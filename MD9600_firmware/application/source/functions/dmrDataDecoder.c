@@ -0,0 +1,736 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <string.h>
+#include "functions/dmrDataDecoder.h"
+#include "functions/ticks.h"
+#include "user_interface/uiUtilities.h"
+
+#if defined(USING_DMR_DATA_DECODER)
+
+//
+// DMR data bursts decoding (ETSI TS 102 361-1 Annex B, TS 102 361-4 UDT):
+//  - Data headers and rate 1/2 blocks are BPTC(196,96) encoded, corrected with iterative Hamming (15,11,3) rows
+//    and (13,9,3) columns passes.
+//  - Rate 3/4 blocks are trellis encoded (8 states, 16 points constellation), decoded with a hard decision
+//    Viterbi, using the distance between symbol levels as branch metric.
+//  - Blocks are reassembled following the data header, then checked with CRC-9 (confirmed blocks) and
+//    CRC-32 (whole message), or CRC-CCITT for UDT.
+//  - Texts (UDT text formats, Motorola/Hytera SMS over IP/UDP) and LIP short location reports are extracted,
+//    received locations update the last heard list.
+//
+// Bursts are queued from the HR-C6000 ISR, and decoded by the main task (dmrDataDecoderTick()).
+//
+#define DMR_DATA_DECODER_INFO_BITS                 196
+#define DMR_DATA_DECODER_INFO_HALF_BITS             98
+#define DMR_DATA_DECODER_SLOT_TYPE_BITS             20
+#define DMR_DATA_DECODER_BPTC_PASSES_MAX             5
+#define DMR_DATA_DECODER_TRELLIS_TRIBITS            49 // 48 data tribits + flushing tribit
+#define DMR_DATA_DECODER_TRELLIS_METRIC_MAX          5 // path metric above which the burst is discarded (noise ends at 7 or more)
+#define DMR_DATA_DECODER_TRELLIS_METRIC_INIT    0x3FFF
+
+#define DMR_DATA_DECODER_HEADER_CRC_MASK        0xCCCC
+#define DMR_DATA_DECODER_CRC9_MASK_RATE_12       0x0F0
+#define DMR_DATA_DECODER_CRC9_MASK_RATE_34       0x1FF
+
+#define DMR_DATA_DECODER_SAP_IP                   0x04
+#define DMR_DATA_DECODER_SAP_SHORT_DATA           0x0A
+
+#define DMR_DATA_DECODER_UDT_FORMAT_BINARY        0x00
+#define DMR_DATA_DECODER_UDT_FORMAT_ISO7          0x03
+#define DMR_DATA_DECODER_UDT_FORMAT_ISO8          0x04
+#define DMR_DATA_DECODER_UDT_FORMAT_UTF16         0x07
+
+#define DMR_DATA_DECODER_IP_PROTOCOL_UDP            17
+#define DMR_DATA_DECODER_UDP_PORT_TMS            4007U // Motorola Text Messaging Service
+#define DMR_DATA_DECODER_UDP_PORT_HYTERA_SMS     5016U
+
+#define DMR_DATA_DECODER_LIP_LENGTH_MIN            10U // Short location report is 76 bits long
+
+// Hamming parity checks (data and parity bits of each check), and syndrome to bit error position (0xFF: uncorrectable)
+static const uint16_t HAMMING_15_11_CHECKS[4] = { 0x09AF, 0x135E, 0x26BC, 0x44D7 };
+static const uint8_t HAMMING_15_11_SYNDROMES[16] = { 0xFF, 11, 12, 8, 13, 5, 9, 3, 14, 0, 6, 1, 10, 7, 4, 2 };
+static const uint16_t HAMMING_13_9_CHECKS[4] = { 0x026B, 0x04D7, 0x09AF, 0x1135 };
+static const uint8_t HAMMING_13_9_SYNDROMES[16] = { 0xFF, 9, 10, 6, 11, 3, 7, 1, 12, 0xFF, 4, 0xFF, 8, 5, 2, 0 };
+
+static const uint8_t BPTC_COPY_RANGES[9][2] = { {4, 11}, {16, 26}, {31, 41}, {46, 56}, {61, 71}, {76, 86}, {91, 101}, {106, 116}, {121, 131} };
+
+static const uint8_t TRELLIS_INTERLEAVE[98] =
+{
+		 0,  1,  8,  9, 16, 17, 24, 25, 32, 33, 40, 41, 48, 49, 56, 57, 64, 65, 72, 73, 80, 81, 88, 89, 96, 97,
+		 2,  3, 10, 11, 18, 19, 26, 27, 34, 35, 42, 43, 50, 51, 58, 59, 66, 67, 74, 75, 82, 83, 90, 91,
+		 4,  5, 12, 13, 20, 21, 28, 29, 36, 37, 44, 45, 52, 53, 60, 61, 68, 69, 76, 77, 84, 85, 92, 93,
+		 6,  7, 14, 15, 22, 23, 30, 31, 38, 39, 46, 47, 54, 55, 62, 63, 70, 71, 78, 79, 86, 87, 94, 95
+};
+
+// Constellation point sent for [state][tribit], the state being the previous tribit
+static const uint8_t TRELLIS_ENCODE[8][8] =
+{
+		{  0,  8,  4, 12,  2, 10,  6, 14 },
+		{  4, 12,  2, 10,  6, 14,  0,  8 },
+		{  1,  9,  5, 13,  3, 11,  7, 15 },
+		{  5, 13,  3, 11,  7, 15,  1,  9 },
+		{  3, 11,  7, 15,  1,  9,  5, 13 },
+		{  7, 15,  1,  9,  5, 13,  3, 11 },
+		{  2, 10,  6, 14,  0,  8,  4, 12 },
+		{  6, 14,  0,  8,  4, 12,  2, 10 }
+};
+
+// Symbol levels of each constellation point, 2 bits per dibit (0: +3, 1: +1, 2: -1, 3: -3), first dibit in bits 3..2
+static const uint8_t TRELLIS_POINT_LEVELS[16] = { 0x6, 0xA, 0x3, 0xF, 0xE, 0x2, 0xB, 0x7, 0xC, 0x0, 0x9, 0x5, 0x4, 0x8, 0x1, 0xD };
+
+// Dibit bits (01: +3, 00: +1, 10: -1, 11: -3) to symbol level
+static const uint8_t DIBIT_LEVELS[4] = { 1, 0, 2, 3 };
+
+typedef struct
+{
+	uint8_t dataType;
+	uint8_t burst[DMR_DATA_DECODER_BURST_LENGTH];
+} dmrDataDecoderBurst_t;
+
+typedef struct
+{
+	volatile uint8_t      queueHead; // written by the HR-C6000 ISR
+	volatile uint8_t      queueTail; // written by the main task
+	dmrDataDecoderBurst_t queue[DMR_DATA_DECODER_QUEUE_SIZE];
+	uint8_t               trellisMetrics[16][16]; // [received levels][constellation point]
+	bool                  headerValid;
+	dmrDataPacketFormat_t dpf;
+	uint8_t               sap;
+	uint8_t               udtFormat;
+	uint8_t               padLength; // in octets, or nibbles for UDT
+	bool                  isGroup;
+	uint32_t              srcId;
+	uint32_t              dstId;
+	uint8_t               blocksExpected;
+	uint8_t               blocksReceived;
+	uint16_t              length;
+	uint32_t              lastBlockTime;
+	uint8_t               data[DMR_DATA_DECODER_BLOCKS_MAX * DMR_DATA_DECODER_TRELLIS_PAYLOAD_LENGTH];
+	bool                  hasMessage;
+	dmrDataMessage_t      message;
+} dmrDataDecoderData_t;
+
+static dmrDataDecoderData_t dmrDataDecoder;
+
+static inline uint8_t dmrDataDecoderGetInfoBit(const uint8_t *burst, uint32_t index)
+{
+	// Skip the slot type field, between both info halves
+	if (index >= DMR_DATA_DECODER_INFO_HALF_BITS)
+	{
+		index += DMR_DATA_DECODER_SLOT_TYPE_BITS;
+	}
+
+	return ((burst[index >> 3] >> (7 - (index & 0x07))) & 0x01);
+}
+
+static uint32_t dmrDataDecoderGetBits(const uint8_t *data, uint32_t offset, uint32_t count)
+{
+	uint32_t value = 0;
+
+	for (uint32_t i = offset; i < (offset + count); i++)
+	{
+		value = (value << 1) | ((data[i >> 3] >> (7 - (i & 0x07))) & 0x01);
+	}
+
+	return value;
+}
+
+static uint16_t dmrDataDecoderCRCCCITT(const uint8_t *data, size_t length)
+{
+	uint16_t crc = 0x0000;
+
+	for (size_t i = 0; i < length; i++)
+	{
+		crc ^= ((uint16_t)data[i] << 8);
+
+		for (int b = 0; b < 8; b++)
+		{
+			crc = ((crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1));
+		}
+	}
+
+	return ~crc;
+}
+
+// CRC-9 over the user data then the 7 bits serial number (x^9 + x^6 + x^4 + x^3 + 1), inverted
+static uint16_t dmrDataDecoderCRC9(const uint8_t *data, size_t length, uint8_t serialNumber)
+{
+	uint16_t crc = 0x0000;
+	size_t nbBits = (length * 8) + 7;
+
+	for (size_t i = 0; i < nbBits; i++)
+	{
+		uint8_t bit = ((i < (length * 8)) ? ((data[i >> 3] >> (7 - (i & 0x07))) & 0x01) : ((serialNumber >> (6 - (i - (length * 8)))) & 0x01));
+
+		crc = ((((crc >> 8) & 0x01) ^ bit) ? (((crc << 1) ^ 0x059) & 0x1FF) : ((crc << 1) & 0x1FF));
+	}
+
+	return (~crc & 0x1FF);
+}
+
+// CRC-32 over the user data, octets being processed by swapped pairs
+static uint32_t dmrDataDecoderCRC32(const uint8_t *data, size_t length)
+{
+	uint32_t crc = 0x00000000;
+
+	for (size_t i = 0; i < length; i++)
+	{
+		crc ^= ((uint32_t)data[i ^ 0x01] << 24);
+
+		for (int b = 0; b < 8; b++)
+		{
+			crc = ((crc & 0x80000000) ? ((crc << 1) ^ 0x04C11DB7) : (crc << 1));
+		}
+	}
+
+	return crc;
+}
+
+// Returns 0 if the codeword is correct, 1 if a bit was corrected, -1 if it's uncorrectable
+static int dmrDataDecoderHammingCorrect(uint8_t *bits, uint32_t stride, uint32_t length, const uint16_t *checks, const uint8_t *syndromes)
+{
+	uint16_t word = 0;
+	uint8_t syndrome = 0;
+
+	for (uint32_t i = 0; i < length; i++)
+	{
+		word |= (bits[i * stride] << i);
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		syndrome |= (__builtin_parity(word & checks[i]) << i);
+	}
+
+	if (syndrome == 0)
+	{
+		return 0;
+	}
+
+	if (syndromes[syndrome] == 0xFF)
+	{
+		return -1;
+	}
+
+	bits[syndromes[syndrome] * stride] ^= 0x01;
+
+	return 1;
+}
+
+bool dmrDataDecoderBPTCDecode(const uint8_t *burst, uint8_t *payload)
+{
+	uint8_t matrix[DMR_DATA_DECODER_INFO_BITS];
+	bool valid = false;
+	uint32_t bitIndex = 0;
+
+	for (int i = 0; i < DMR_DATA_DECODER_INFO_BITS; i++)
+	{
+		matrix[i] = dmrDataDecoderGetInfoBit(burst, ((i * 181) % DMR_DATA_DECODER_INFO_BITS)); // deinterleave
+	}
+
+	// 13 rows of 15 bits, starting after the reserved bit. Only the first 9 rows are Hamming (15,11,3) codewords,
+	// the 15 columns are Hamming (13,9,3) codewords.
+	// Rows go first: a row miscorrected by a double error holds 3 errors, each alone in its column, so the column pass
+	// fixes them. The other way round, a double error in a column can bounce between the column and row passes.
+	for (int pass = 0; pass < DMR_DATA_DECODER_BPTC_PASSES_MAX; pass++)
+	{
+		int corrections = 0;
+		bool uncorrectable = false;
+
+		for (int i = 0; i < 9; i++)
+		{
+			int result = dmrDataDecoderHammingCorrect(&matrix[1 + (i * 15)], 1, 15, HAMMING_15_11_CHECKS, HAMMING_15_11_SYNDROMES);
+
+			uncorrectable |= (result < 0);
+			corrections += ((result > 0) ? 1 : 0);
+		}
+
+		for (int i = 0; i < 15; i++)
+		{
+			int result = dmrDataDecoderHammingCorrect(&matrix[1 + i], 15, 13, HAMMING_13_9_CHECKS, HAMMING_13_9_SYNDROMES);
+
+			uncorrectable |= (result < 0);
+			corrections += ((result > 0) ? 1 : 0);
+		}
+
+		if (corrections == 0)
+		{
+			valid = (uncorrectable == false);
+			break;
+		}
+	}
+
+	memset(payload, 0, DMR_DATA_DECODER_BPTC_PAYLOAD_LENGTH);
+
+	for (int range = 0; range < 9; range++)
+	{
+		for (uint32_t i = BPTC_COPY_RANGES[range][0]; i <= BPTC_COPY_RANGES[range][1]; i++, bitIndex++)
+		{
+			payload[bitIndex >> 3] |= (matrix[i] << (7 - (bitIndex & 0x07)));
+		}
+	}
+
+	return valid;
+}
+
+bool dmrDataDecoderTrellisDecode(const uint8_t *burst, uint8_t *payload)
+{
+	uint8_t levels[DMR_DATA_DECODER_INFO_HALF_BITS];
+	uint8_t survivors[DMR_DATA_DECODER_TRELLIS_TRIBITS][8];
+	uint16_t metrics[8];
+	uint16_t nextMetrics[8];
+	uint8_t state;
+
+	for (int i = 0; i < DMR_DATA_DECODER_INFO_HALF_BITS; i++)
+	{
+		uint8_t dibit = ((dmrDataDecoderGetInfoBit(burst, (i * 2)) << 1) | dmrDataDecoderGetInfoBit(burst, ((i * 2) + 1)));
+
+		levels[TRELLIS_INTERLEAVE[i]] = DIBIT_LEVELS[dibit];
+	}
+
+	// The encoder starts from state 0
+	metrics[0] = 0;
+	for (int s = 1; s < 8; s++)
+	{
+		metrics[s] = DMR_DATA_DECODER_TRELLIS_METRIC_INIT;
+	}
+
+	for (int step = 0; step < DMR_DATA_DECODER_TRELLIS_TRIBITS; step++)
+	{
+		const uint8_t *branchMetrics = dmrDataDecoder.trellisMetrics[(levels[step * 2] << 2) | levels[(step * 2) + 1]];
+
+		for (int tribit = 0; tribit < 8; tribit++)
+		{
+			uint16_t best = UINT16_MAX;
+			uint8_t bestState = 0;
+
+			for (int s = 0; s < 8; s++)
+			{
+				uint16_t metric = metrics[s] + branchMetrics[TRELLIS_ENCODE[s][tribit]];
+
+				if (metric < best)
+				{
+					best = metric;
+					bestState = s;
+				}
+			}
+
+			nextMetrics[tribit] = best;
+			survivors[step][tribit] = bestState;
+		}
+
+		memcpy(metrics, nextMetrics, sizeof(metrics));
+	}
+
+	// The last tribit is the null flushing one, so the path ends in state 0
+	if (metrics[0] > DMR_DATA_DECODER_TRELLIS_METRIC_MAX)
+	{
+		return false;
+	}
+
+	memset(payload, 0, DMR_DATA_DECODER_TRELLIS_PAYLOAD_LENGTH);
+	state = 0;
+
+	for (int step = (DMR_DATA_DECODER_TRELLIS_TRIBITS - 1); step > 0; step--)
+	{
+		uint32_t bitIndex = ((step - 1) * 3);
+
+		state = survivors[step][state]; // tribit of the previous step
+
+		for (int b = 0; b < 3; b++, bitIndex++)
+		{
+			payload[bitIndex >> 3] |= (((state >> (2 - b)) & 0x01) << (7 - (bitIndex & 0x07)));
+		}
+	}
+
+	return true;
+}
+
+static bool dmrDataDecoderParseHeader(const uint8_t *header)
+{
+	if ((dmrDataDecoderCRCCCITT(header, 10) ^ DMR_DATA_DECODER_HEADER_CRC_MASK) != ((header[10] << 8) | header[11]))
+	{
+		return false;
+	}
+
+	dmrDataDecoder.headerValid = true;
+	dmrDataDecoder.dpf = (dmrDataPacketFormat_t)(header[0] & 0x0F);
+	dmrDataDecoder.isGroup = ((header[0] & 0x80) != 0);
+	dmrDataDecoder.sap = (header[1] >> 4);
+	dmrDataDecoder.udtFormat = 0;
+	dmrDataDecoder.dstId = ((header[2] << 16) | (header[3] << 8) | header[4]);
+	dmrDataDecoder.srcId = ((header[5] << 16) | (header[6] << 8) | header[7]);
+	dmrDataDecoder.blocksReceived = 0;
+	dmrDataDecoder.length = 0;
+	dmrDataDecoder.lastBlockTime = ticksGetMillis();
+
+	switch (dmrDataDecoder.dpf)
+	{
+		case DMR_DATA_DPF_UDT:
+			dmrDataDecoder.udtFormat = (header[1] & 0x0F);
+			dmrDataDecoder.padLength = (header[8] >> 3);
+			dmrDataDecoder.blocksExpected = ((header[8] & 0x03) + 1);
+			break;
+		case DMR_DATA_DPF_UNCONFIRMED:
+		case DMR_DATA_DPF_CONFIRMED:
+			dmrDataDecoder.padLength = ((header[0] & 0x10) | (header[1] & 0x0F));
+			dmrDataDecoder.blocksExpected = (header[8] & 0x7F);
+			break;
+		case DMR_DATA_DPF_SHORT_DATA_DEFINED:
+		case DMR_DATA_DPF_SHORT_DATA_RAW:
+			dmrDataDecoder.padLength = 0;
+			dmrDataDecoder.blocksExpected = ((header[0] & 0x30) | (header[1] & 0x0F));
+			break;
+		default: // Responses and proprietary headers don't carry anything we can use
+			dmrDataDecoder.blocksExpected = 0;
+			break;
+	}
+
+	if ((dmrDataDecoder.blocksExpected == 0) || (dmrDataDecoder.blocksExpected > DMR_DATA_DECODER_BLOCKS_MAX))
+	{
+		dmrDataDecoder.headerValid = false;
+	}
+
+	return true;
+}
+
+static void dmrDataDecoderPublishMessage(void)
+{
+	dmrDataDecoder.message.srcId = dmrDataDecoder.srcId;
+	dmrDataDecoder.message.dstId = dmrDataDecoder.dstId;
+	dmrDataDecoder.message.isGroup = dmrDataDecoder.isGroup;
+	dmrDataDecoder.hasMessage = (dmrDataDecoder.message.text[0] != 0);
+}
+
+static void dmrDataDecoderStoreText(const uint8_t *data, size_t length, uint8_t charBits)
+{
+	size_t nbChars = ((length * 8) / charBits);
+	size_t i;
+
+	for (i = 0; (i < nbChars) && (i < (DMR_DATA_DECODER_MESSAGE_LEN_MAX - 1)); i++)
+	{
+		char c = (char)dmrDataDecoderGetBits(data, (i * charBits), charBits);
+
+		if (c == 0)
+		{
+			break;
+		}
+
+		dmrDataDecoder.message.text[i] = (((c >= 0x20) && (c < 0x7F)) ? c : '?');
+	}
+	dmrDataDecoder.message.text[i] = 0;
+
+	dmrDataDecoderPublishMessage();
+}
+
+// Extract the longest run of printable ASCII characters from UTF-16 data, as the text could be
+// preceded by some application header (Motorola TMS, Hytera SMS)
+static void dmrDataDecoderStoreUTF16Text(const uint8_t *data, size_t length, bool bigEndian)
+{
+	size_t bestStart = 0;
+	size_t bestLength = 0;
+	size_t i;
+
+	for (size_t alignment = 0; alignment < 2; alignment++)
+	{
+		size_t runStart = alignment;
+		size_t runLength = 0;
+
+		for (i = alignment; (i + 1) < length; i += 2)
+		{
+			uint16_t c = (bigEndian ? ((data[i] << 8) | data[i + 1]) : ((data[i + 1] << 8) | data[i]));
+
+			if ((c >= 0x20) && (c < 0x7F))
+			{
+				if (runLength == 0)
+				{
+					runStart = i;
+				}
+
+				runLength++;
+
+				if (runLength > bestLength)
+				{
+					bestStart = runStart;
+					bestLength = runLength;
+				}
+			}
+			else
+			{
+				runLength = 0;
+			}
+		}
+	}
+
+	for (i = 0; (i < bestLength) && (i < (DMR_DATA_DECODER_MESSAGE_LEN_MAX - 1)); i++)
+	{
+		dmrDataDecoder.message.text[i] = (char)data[bestStart + (i * 2) + (bigEndian ? 1 : 0)];
+	}
+	dmrDataDecoder.message.text[i] = 0;
+
+	dmrDataDecoderPublishMessage();
+}
+
+// LIP short location report: PDU type (2 bits, 0), time elapsed (2), longitude (25), latitude (24), ...
+static void dmrDataDecoderParseLIP(const uint8_t *data, size_t length)
+{
+	if ((length < DMR_DATA_DECODER_LIP_LENGTH_MIN) || ((data[0] >> 6) != 0))
+	{
+		return;
+	}
+
+	uint32_t longitude = dmrDataDecoderGetBits(data, 4, 25);
+	uint32_t latitude = dmrDataDecoderGetBits(data, 29, 24);
+
+	if ((longitude == 0) && (latitude == 0))
+	{
+		return;
+	}
+
+	// Two's complement, 360 / 2^25 and 180 / 2^24 degree steps
+	int32_t lon = (int32_t)(longitude << 7) >> 7;
+	int32_t lat = (int32_t)(latitude << 8) >> 8;
+
+	lastHeardUpdateLocation(dmrDataDecoder.srcId, (lat * (180.0 / 16777216.0)), (lon * (360.0 / 33554432.0)));
+}
+
+static void dmrDataDecoderParseIP(const uint8_t *data, size_t length)
+{
+	if ((length < 28) || ((data[0] >> 4) != 4) || (data[9] != DMR_DATA_DECODER_IP_PROTOCOL_UDP))
+	{
+		return;
+	}
+
+	size_t headerLength = ((data[0] & 0x0F) * 4);
+
+	if ((headerLength < 20) || (length < (headerLength + 8)))
+	{
+		return;
+	}
+
+	uint16_t port = ((data[headerLength + 2] << 8) | data[headerLength + 3]);
+
+	if ((port == DMR_DATA_DECODER_UDP_PORT_TMS) || (port == DMR_DATA_DECODER_UDP_PORT_HYTERA_SMS))
+	{
+		dmrDataDecoderStoreUTF16Text(&data[headerLength + 8], (length - (headerLength + 8)), false);
+	}
+}
+
+static void dmrDataDecoderHandleMessage(void)
+{
+	uint16_t length = dmrDataDecoder.length;
+	uint8_t *data = dmrDataDecoder.data;
+
+	if (dmrDataDecoder.dpf == DMR_DATA_DPF_UDT)
+	{
+		length -= 2;
+
+		if (dmrDataDecoderCRCCCITT(data, length) != ((data[length] << 8) | data[length + 1]))
+		{
+			return;
+		}
+
+		// Pad is in nibbles
+		if ((dmrDataDecoder.padLength >> 1) < length)
+		{
+			length -= (dmrDataDecoder.padLength >> 1);
+		}
+
+		switch (dmrDataDecoder.udtFormat)
+		{
+			case DMR_DATA_DECODER_UDT_FORMAT_BINARY:
+				dmrDataDecoderParseLIP(data, length);
+				break;
+			case DMR_DATA_DECODER_UDT_FORMAT_ISO7:
+				dmrDataDecoderStoreText(data, length, 7);
+				break;
+			case DMR_DATA_DECODER_UDT_FORMAT_ISO8:
+				dmrDataDecoderStoreText(data, length, 8);
+				break;
+			case DMR_DATA_DECODER_UDT_FORMAT_UTF16:
+				dmrDataDecoderStoreUTF16Text(data, length, true);
+				break;
+			default:
+				break;
+		}
+
+		return;
+	}
+
+	if (length < (4 + dmrDataDecoder.padLength))
+	{
+		return;
+	}
+
+	length -= 4;
+
+	// CRC-32 is sent LSB first
+	if (dmrDataDecoderCRC32(data, length) !=
+			((uint32_t)data[length] | ((uint32_t)data[length + 1] << 8) | ((uint32_t)data[length + 2] << 16) | ((uint32_t)data[length + 3] << 24)))
+	{
+		return;
+	}
+
+	length -= dmrDataDecoder.padLength;
+
+	if ((dmrDataDecoder.dpf == DMR_DATA_DPF_SHORT_DATA_DEFINED) || (dmrDataDecoder.dpf == DMR_DATA_DPF_SHORT_DATA_RAW) ||
+			(dmrDataDecoder.sap == DMR_DATA_DECODER_SAP_SHORT_DATA))
+	{
+		dmrDataDecoderParseLIP(data, length);
+	}
+	else if (dmrDataDecoder.sap == DMR_DATA_DECODER_SAP_IP)
+	{
+		dmrDataDecoderParseIP(data, length);
+	}
+}
+
+static bool dmrDataDecoderAddBlock(const uint8_t *block, uint8_t length, bool isRate34)
+{
+	uint32_t now = ticksGetMillis();
+
+	if (dmrDataDecoder.headerValid == false)
+	{
+		return false;
+	}
+
+	if (((now - dmrDataDecoder.lastBlockTime) > DMR_DATA_DECODER_BLOCK_TIMEOUT) || ((dmrDataDecoder.dpf == DMR_DATA_DPF_UDT) && isRate34))
+	{
+		dmrDataDecoder.headerValid = false;
+		return false;
+	}
+
+	// Confirmed data blocks start with a 7 bits serial number and their CRC-9
+	if (dmrDataDecoder.dpf == DMR_DATA_DPF_CONFIRMED)
+	{
+		uint16_t crc = (((block[0] & 0x01) << 8) | block[1]);
+
+		if ((dmrDataDecoderCRC9(&block[2], (length - 2), (block[0] >> 1)) ^
+				(isRate34 ? DMR_DATA_DECODER_CRC9_MASK_RATE_34 : DMR_DATA_DECODER_CRC9_MASK_RATE_12)) != crc)
+		{
+			dmrDataDecoder.headerValid = false;
+			return false;
+		}
+
+		block += 2;
+		length -= 2;
+	}
+
+	memcpy(&dmrDataDecoder.data[dmrDataDecoder.length], block, length);
+	dmrDataDecoder.length += length;
+	dmrDataDecoder.lastBlockTime = now;
+
+	if (++dmrDataDecoder.blocksReceived == dmrDataDecoder.blocksExpected)
+	{
+		dmrDataDecoder.headerValid = false;
+		dmrDataDecoderHandleMessage();
+	}
+
+	return true;
+}
+
+void dmrDataDecoderInit(void)
+{
+	memset(&dmrDataDecoder, 0, sizeof(dmrDataDecoderData_t));
+
+	// Branch metrics: distance between the received and the constellation point symbol levels
+	for (int received = 0; received < 16; received++)
+	{
+		for (int point = 0; point < 16; point++)
+		{
+			int d1 = (received >> 2) - (TRELLIS_POINT_LEVELS[point] >> 2);
+			int d2 = (received & 0x03) - (TRELLIS_POINT_LEVELS[point] & 0x03);
+
+			dmrDataDecoder.trellisMetrics[received][point] = (((d1 < 0) ? -d1 : d1) + ((d2 < 0) ? -d2 : d2));
+		}
+	}
+}
+
+// Call end: the queued bursts are still processed, then the partially received message is dropped
+void dmrDataDecoderReset(void)
+{
+	dmrDataDecoderTick();
+	dmrDataDecoder.headerValid = false;
+}
+
+// Called from the HR-C6000 ISR
+void dmrDataDecoderPushBurst(uint8_t dataType, const uint8_t *burst)
+{
+	uint8_t next = ((dmrDataDecoder.queueHead + 1) & (DMR_DATA_DECODER_QUEUE_SIZE - 1));
+
+	// Drop the burst if the queue is full
+	if (next != dmrDataDecoder.queueTail)
+	{
+		dmrDataDecoder.queue[dmrDataDecoder.queueHead].dataType = dataType;
+		memcpy(dmrDataDecoder.queue[dmrDataDecoder.queueHead].burst, burst, DMR_DATA_DECODER_BURST_LENGTH);
+		dmrDataDecoder.queueHead = next;
+	}
+}
+
+bool dmrDataDecoderProcessBurst(uint8_t dataType, const uint8_t *burst)
+{
+	uint8_t payload[DMR_DATA_DECODER_TRELLIS_PAYLOAD_LENGTH];
+
+	switch (dataType)
+	{
+		case DMR_DATA_TYPE_DATA_HEADER:
+			return (dmrDataDecoderBPTCDecode(burst, payload) && dmrDataDecoderParseHeader(payload));
+		case DMR_DATA_TYPE_RATE_12_DATA:
+			return (dmrDataDecoderBPTCDecode(burst, payload) && dmrDataDecoderAddBlock(payload, DMR_DATA_DECODER_BPTC_PAYLOAD_LENGTH, false));
+		case DMR_DATA_TYPE_RATE_34_DATA:
+			return (dmrDataDecoderTrellisDecode(burst, payload) && dmrDataDecoderAddBlock(payload, DMR_DATA_DECODER_TRELLIS_PAYLOAD_LENGTH, true));
+		default:
+			break;
+	}
+
+	return false;
+}
+
+bool dmrDataDecoderGetMessage(dmrDataMessage_t *message)
+{
+	if (dmrDataDecoder.hasMessage)
+	{
+		memcpy(message, &dmrDataDecoder.message, sizeof(dmrDataMessage_t));
+		dmrDataDecoder.hasMessage = false;
+		return true;
+	}
+
+	return false;
+}
+
+void dmrDataDecoderTick(void)
+{
+	while (dmrDataDecoder.queueTail != dmrDataDecoder.queueHead)
+	{
+		dmrDataDecoderBurst_t *entry = &dmrDataDecoder.queue[dmrDataDecoder.queueTail];
+
+		dmrDataDecoderProcessBurst(entry->dataType, entry->burst);
+		dmrDataDecoder.queueTail = ((dmrDataDecoder.queueTail + 1) & (DMR_DATA_DECODER_QUEUE_SIZE - 1));
+	}
+}
+
+#endif // USING_DMR_DATA_DECODER
@@ -0,0 +1,487 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <string.h>
+#include "functions/dtmfDecoder.h"
+#include "functions/codeplug.h"
+#include "functions/settings.h"
+#include "functions/sound.h"
+#include "functions/ticks.h"
+#include "functions/trx.h"
+#include "user_interface/menuSystem.h"
+
+//
+// Fixed point Goertzel bank over the 8 DTMF frequencies, working on 8kHz PCM.
+//
+// A block result is accepted as a digit hit when:
+//  - the strongest row and column tones are above DTMF_DECODER_POWER_MIN,
+//  - twist is within limits (normal: row louder by up to 8dB, reverse: column louder by up to 4dB),
+//  - the other tones of each group are at least 6dB below the strongest one,
+//  - both tones hold most of the block energy (no speech/noise),
+//  - the tones last the whole block: over its first half, a steady tone pair gets a quarter of its block power.
+// A digit is reported after 2 consecutive identical hits, and a new digit can only be reported
+// after 2 consecutive blocks without any hit.
+// A 40ms tone always covers 2 whole blocks, so it is always a digit (ITU-T Q.24). A tone has to cover about 88% of
+// a block to pass the half block check, so a tone up to 21ms can't give 2 hits: it either covers a whole block and
+// less than 60% of the next one, or less than 88% of both.
+//
+#define DTMF_DECODER_NUM_TONES                8
+#define DTMF_DECODER_COEFF_SHIFT             14 // coefficients are Q14
+#define DTMF_DECODER_INPUT_SHIFT              4 // keep 12 bits per sample
+#define DTMF_DECODER_POWER_MIN           40000LL
+#define DTMF_DECODER_TWIST_NORMAL_X10        63 // 8dB
+#define DTMF_DECODER_TWIST_REVERSE_X10       25 // 4dB
+#define DTMF_DECODER_RELATIVE_PEAK            4 // 6dB
+#define DTMF_DECODER_ENERGY_RATIO_X10         3 // tones power >= 60% of the pure tones power for the block energy
+#define DTMF_DECODER_HALF_POWER_MIN_PERCENT  18 // tones power over the first half of the block, 25% for a steady tone
+#define DTMF_DECODER_HALF_POWER_MAX_PERCENT  35 // (more than 25% when off frequency, the half block filter is wider)
+#define DTMF_DECODER_RECEIVED_TIMEOUT      5000U // ms, received digits are cleared after this idle period
+#define DTMF_DECODER_DISPLAYED_DIGITS_MAX    10U
+#define DTMF_DECODER_REMOTE_CODE_MAX          6U // same as the boot PIN
+
+// 2 * cos(2 * PI * f / 8000) in Q14, rows 697, 770, 852, 941Hz, columns 1209, 1336, 1477, 1633Hz
+static const int32_t DTMF_COEFFS[DTMF_DECODER_NUM_TONES] = { 27980, 26956, 25701, 24219, 19073, 16325, 13085, 9315 };
+
+static const char DTMF_DIGITS[4][4] =
+{
+		{ '1', '2', '3', 'A' },
+		{ '4', '5', '6', 'B' },
+		{ '7', '8', '9', 'C' },
+		{ '*', '0', '#', 'D' }
+};
+
+typedef struct
+{
+	int32_t          s1[DTMF_DECODER_NUM_TONES];
+	int32_t          s2[DTMF_DECODER_NUM_TONES];
+	int32_t          halfS1[DTMF_DECODER_NUM_TONES]; // Goertzel state over the first half of the block
+	int32_t          halfS2[DTMF_DECODER_NUM_TONES];
+	int64_t          energy;
+	uint32_t         sampleCount;
+	char             lastHit;
+	char             currentDigit;
+	uint8_t          gapCount;
+	volatile uint8_t queueHead; // written by the audio ISR
+	volatile uint8_t queueTail; // written by the main task
+	char             queue[DTMF_DECODER_EVENT_QUEUE_SIZE];
+	volatile bool    active;
+	char             remoteKey;
+	bool             remoteUnlocked;
+	uint8_t          remoteCodeLength;
+	char             remoteCode[DTMF_DECODER_REMOTE_CODE_MAX];
+	ticksTimer_t     remoteTimer;
+	char             receivedDigits[DTMF_DECODER_RECEIVED_DIGITS_MAX + 1];
+	ticksTimer_t     receivedTimer;
+} dtmfDecoderData_t;
+
+static dtmfDecoderData_t dtmfDecoder;
+
+static void dtmfDecoderResetBlock(void)
+{
+	memset(dtmfDecoder.s1, 0, sizeof(dtmfDecoder.s1));
+	memset(dtmfDecoder.s2, 0, sizeof(dtmfDecoder.s2));
+	dtmfDecoder.energy = 0;
+	dtmfDecoder.sampleCount = 0;
+}
+
+static inline int64_t dtmfDecoderGoertzelPower(int tone, int64_t s1, int64_t s2)
+{
+	return ((s1 * s1) + (s2 * s2) - (((DTMF_COEFFS[tone] * s1) >> DTMF_DECODER_COEFF_SHIFT) * s2));
+}
+
+static inline int64_t dtmfDecoderTonePower(int tone)
+{
+	return dtmfDecoderGoertzelPower(tone, dtmfDecoder.s1[tone], dtmfDecoder.s2[tone]);
+}
+
+static uint8_t dtmfDecoderFindPeak(const int64_t *powers, int64_t *peakPower)
+{
+	uint8_t peak = 0;
+
+	for (uint8_t i = 1; i < 4; i++)
+	{
+		if (powers[i] > powers[peak])
+		{
+			peak = i;
+		}
+	}
+
+	for (uint8_t i = 0; i < 4; i++)
+	{
+		if ((i != peak) && ((powers[i] * DTMF_DECODER_RELATIVE_PEAK) > powers[peak]))
+		{
+			return 0xFF;
+		}
+	}
+
+	*peakPower = powers[peak];
+
+	return peak;
+}
+
+// Returns the detected digit for the current block, or 0.
+static char dtmfDecoderEvaluateBlock(void)
+{
+	int64_t powers[DTMF_DECODER_NUM_TONES];
+	int64_t rowPower = 0;
+	int64_t colPower = 0;
+
+	for (int i = 0; i < DTMF_DECODER_NUM_TONES; i++)
+	{
+		powers[i] = dtmfDecoderTonePower(i);
+	}
+
+	uint8_t row = dtmfDecoderFindPeak(&powers[0], &rowPower);
+	uint8_t col = dtmfDecoderFindPeak(&powers[4], &colPower);
+
+	if ((row == 0xFF) || (col == 0xFF) || (rowPower < DTMF_DECODER_POWER_MIN) || (colPower < DTMF_DECODER_POWER_MIN))
+	{
+		return 0;
+	}
+
+	// Twist
+	if ((rowPower > colPower) ? ((rowPower * 10) > (colPower * DTMF_DECODER_TWIST_NORMAL_X10)) :
+			((colPower * 10) > (rowPower * DTMF_DECODER_TWIST_REVERSE_X10)))
+	{
+		return 0;
+	}
+
+	// A pure tone pair gives (rowPower + colPower) == (energy * N / 2)
+	if (((rowPower + colPower) * 20) < (dtmfDecoder.energy * DTMF_DECODER_BLOCK_SIZE * DTMF_DECODER_ENERGY_RATIO_X10 * 2))
+	{
+		return 0;
+	}
+
+	// The tones power grows with the square of their duration: a tone which starts or stops within the block
+	// gives too little or too much power over the first half
+	int64_t halfPower = (dtmfDecoderGoertzelPower(row, dtmfDecoder.halfS1[row], dtmfDecoder.halfS2[row]) +
+			dtmfDecoderGoertzelPower((4 + col), dtmfDecoder.halfS1[4 + col], dtmfDecoder.halfS2[4 + col]));
+
+	if (((halfPower * 100) < ((rowPower + colPower) * DTMF_DECODER_HALF_POWER_MIN_PERCENT)) ||
+			((halfPower * 100) > ((rowPower + colPower) * DTMF_DECODER_HALF_POWER_MAX_PERCENT)))
+	{
+		return 0;
+	}
+
+	return DTMF_DIGITS[row][col];
+}
+
+static void dtmfDecoderPushDigit(char digit)
+{
+	uint8_t next = ((dtmfDecoder.queueHead + 1) & (DTMF_DECODER_EVENT_QUEUE_SIZE - 1));
+
+	// Drop the digit if the queue is full
+	if (next != dtmfDecoder.queueTail)
+	{
+		dtmfDecoder.queue[dtmfDecoder.queueHead] = digit;
+		dtmfDecoder.queueHead = next;
+	}
+}
+
+static void dtmfDecoderEndOfBlock(void)
+{
+	char hit = dtmfDecoderEvaluateBlock();
+
+	if (hit != 0)
+	{
+		if ((hit == dtmfDecoder.lastHit) && (dtmfDecoder.currentDigit == 0))
+		{
+			dtmfDecoder.currentDigit = hit;
+			dtmfDecoderPushDigit(hit);
+		}
+		dtmfDecoder.gapCount = 0;
+	}
+	else
+	{
+		if (dtmfDecoder.gapCount < 2)
+		{
+			dtmfDecoder.gapCount++;
+		}
+
+		if (dtmfDecoder.gapCount >= 2)
+		{
+			dtmfDecoder.currentDigit = 0;
+		}
+	}
+
+	dtmfDecoder.lastHit = hit;
+	dtmfDecoderResetBlock();
+}
+
+static void dtmfDecoderAppendReceived(char digit)
+{
+	size_t len = strlen(dtmfDecoder.receivedDigits);
+
+	if (len == DTMF_DECODER_RECEIVED_DIGITS_MAX)
+	{
+		memmove(&dtmfDecoder.receivedDigits[0], &dtmfDecoder.receivedDigits[1], (DTMF_DECODER_RECEIVED_DIGITS_MAX - 1));
+		len--;
+	}
+
+	dtmfDecoder.receivedDigits[len] = digit;
+	dtmfDecoder.receivedDigits[len + 1] = 0;
+	ticksTimerStart(&dtmfDecoder.receivedTimer, DTMF_DECODER_RECEIVED_TIMEOUT);
+
+	int currentMenu = menuSystemGetCurrentMenuNumber();
+
+	if ((currentMenu == UI_CHANNEL_MODE) || (currentMenu == UI_VFO_MODE))
+	{
+		char buf[DTMF_DECODER_DISPLAYED_DIGITS_MAX + 6];
+
+		len = strlen(dtmfDecoder.receivedDigits);
+		snprintf(buf, sizeof(buf), "DTMF %s",
+				&dtmfDecoder.receivedDigits[(len > DTMF_DECODER_DISPLAYED_DIGITS_MAX) ? (len - DTMF_DECODER_DISPLAYED_DIGITS_MAX) : 0]);
+		uiNotificationShow(NOTIFICATION_TYPE_MESSAGE, NOTIFICATION_ID_MESSAGE, DTMF_DECODER_RECEIVED_TIMEOUT, buf, false);
+	}
+}
+
+void dtmfDecoderInit(void)
+{
+	memset(&dtmfDecoder, 0, sizeof(dtmfDecoderData_t));
+}
+
+void dtmfDecoderReset(void)
+{
+	taskENTER_CRITICAL();
+	dtmfDecoderResetBlock();
+	dtmfDecoder.lastHit = 0;
+	dtmfDecoder.currentDigit = 0;
+	dtmfDecoder.gapCount = 0;
+	dtmfDecoder.queueTail = dtmfDecoder.queueHead;
+	dtmfDecoder.remoteKey = 0;
+	dtmfDecoder.remoteUnlocked = false;
+	dtmfDecoder.remoteCodeLength = 0;
+	taskEXIT_CRITICAL();
+}
+
+bool dtmfDecoderIsActive(void)
+{
+	return dtmfDecoder.active;
+}
+
+// Called from the I2S DMA interrupt, cost is bounded to (8 Goertzel iterations per sample + 1 evaluation per block)
+void dtmfDecoderProcessSamples(const int16_t *samples, size_t count, size_t stride)
+{
+	if (dtmfDecoder.active == false)
+	{
+		return;
+	}
+
+	while (count-- > 0)
+	{
+		int32_t x = (*samples >> DTMF_DECODER_INPUT_SHIFT);
+
+		for (int i = 0; i < DTMF_DECODER_NUM_TONES; i++)
+		{
+			int32_t s0 = x + (int32_t)((DTMF_COEFFS[i] * (int64_t)dtmfDecoder.s1[i]) >> DTMF_DECODER_COEFF_SHIFT) - dtmfDecoder.s2[i];
+
+			dtmfDecoder.s2[i] = dtmfDecoder.s1[i];
+			dtmfDecoder.s1[i] = s0;
+		}
+
+		dtmfDecoder.energy += (x * x);
+
+		if (++dtmfDecoder.sampleCount == (DTMF_DECODER_BLOCK_SIZE / 2))
+		{
+			memcpy(dtmfDecoder.halfS1, dtmfDecoder.s1, sizeof(dtmfDecoder.halfS1));
+			memcpy(dtmfDecoder.halfS2, dtmfDecoder.s2, sizeof(dtmfDecoder.halfS2));
+		}
+		else if (dtmfDecoder.sampleCount == DTMF_DECODER_BLOCK_SIZE)
+		{
+			dtmfDecoderEndOfBlock();
+		}
+
+		samples += stride;
+	}
+}
+
+bool dtmfDecoderGetDigit(char *digit)
+{
+	if (dtmfDecoder.queueTail == dtmfDecoder.queueHead)
+	{
+		return false;
+	}
+
+	*digit = dtmfDecoder.queue[dtmfDecoder.queueTail];
+	dtmfDecoder.queueTail = ((dtmfDecoder.queueTail + 1) & (DTMF_DECODER_EVENT_QUEUE_SIZE - 1));
+
+	return true;
+}
+
+static bool dtmfDecoderRemoteIsUnlocked(void)
+{
+	if (dtmfDecoder.remoteUnlocked && ticksTimerHasExpired(&dtmfDecoder.remoteTimer))
+	{
+		dtmfDecoder.remoteUnlocked = false;
+	}
+
+	return dtmfDecoder.remoteUnlocked;
+}
+
+// Collects the access code digits, '#' checks them against the boot PIN, anything else starts again.
+static void dtmfDecoderRemoteEnterCode(char digit)
+{
+	if ((digit >= '0') && (digit <= '9'))
+	{
+		if (dtmfDecoder.remoteCodeLength == DTMF_DECODER_REMOTE_CODE_MAX)
+		{
+			memmove(dtmfDecoder.remoteCode, &dtmfDecoder.remoteCode[1], (DTMF_DECODER_REMOTE_CODE_MAX - 1));
+			dtmfDecoder.remoteCodeLength--;
+		}
+
+		dtmfDecoder.remoteCode[dtmfDecoder.remoteCodeLength++] = digit;
+		return;
+	}
+
+	if (digit == '#')
+	{
+		int32_t pinCode = 0;
+		int pinLength = codeplugGetPasswordPin(&pinCode);
+
+		if ((pinLength > 0) && (pinLength == dtmfDecoder.remoteCodeLength))
+		{
+			char pin[DTMF_DECODER_REMOTE_CODE_MAX + 1];
+
+			snprintf(pin, sizeof(pin), "%0*d", pinLength, (int)pinCode);
+
+			if (memcmp(pin, dtmfDecoder.remoteCode, pinLength) == 0)
+			{
+				dtmfDecoder.remoteUnlocked = true;
+				ticksTimerStart(&dtmfDecoder.remoteTimer, DTMF_DECODER_REMOTE_TIMEOUT);
+			}
+		}
+	}
+
+	dtmfDecoder.remoteCodeLength = 0;
+}
+
+// In remote control mode, each received digit is turned into a key press, then a key release, on the next call.
+// A, B, C and D are mapped to UP, DOWN, GREEN and RED.
+// Only A and B (channel/frequency up and down) are accepted until the access code, the boot PIN followed by '#',
+// has been received. The other keys then work until DTMF_DECODER_REMOTE_TIMEOUT without any digit.
+// With no boot PIN set, only A and B are ever accepted.
+bool dtmfDecoderGetRemoteKey(keyboardCode_t *keys)
+{
+	char digit;
+
+	if ((dtmfDecoder.active == false) || (settingsIsOptionBitSet(BIT_DTMF_REMOTE_CONTROL) == false))
+	{
+		return false;
+	}
+
+	if (dtmfDecoder.remoteKey != 0)
+	{
+		keys->key = dtmfDecoder.remoteKey;
+		keys->event = KEY_MOD_UP;
+		dtmfDecoder.remoteKey = 0;
+		return true;
+	}
+
+	if (dtmfDecoderGetDigit(&digit))
+	{
+		dtmfDecoderAppendReceived(digit);
+
+		if (dtmfDecoderRemoteIsUnlocked())
+		{
+			ticksTimerStart(&dtmfDecoder.remoteTimer, DTMF_DECODER_REMOTE_TIMEOUT);
+		}
+		else if ((digit != 'A') && (digit != 'B'))
+		{
+			dtmfDecoderRemoteEnterCode(digit);
+			return false;
+		}
+
+		switch (digit)
+		{
+			case 'A':
+				dtmfDecoder.remoteKey = KEY_UP;
+				break;
+			case 'B':
+				dtmfDecoder.remoteKey = KEY_DOWN;
+				break;
+			case 'C':
+				dtmfDecoder.remoteKey = KEY_GREEN;
+				break;
+			case 'D':
+				dtmfDecoder.remoteKey = KEY_RED;
+				break;
+			default: // 0..9, '*' and '#' match the keypad codes
+				dtmfDecoder.remoteKey = digit;
+				break;
+		}
+
+		keys->key = dtmfDecoder.remoteKey;
+		keys->event = (KEY_MOD_DOWN | KEY_MOD_PRESS);
+		return true;
+	}
+
+	return false;
+}
+
+void dtmfDecoderTick(void)
+{
+	bool enable = (settingsIsOptionBitSet(BIT_DTMF_DECODER) && (trxGetMode() == RADIO_MODE_ANALOG) &&
+			(trxTransmissionEnabled == false) && (settingsUsbMode != USB_MODE_HOTSPOT));
+
+	if (enable != dtmfDecoder.active)
+	{
+		if (enable)
+		{
+			dtmfDecoderReset();
+			dtmfDecoder.active = true;
+		}
+		else
+		{
+			dtmfDecoder.active = false;
+			soundMonitorStop();
+		}
+	}
+
+	if (dtmfDecoder.active == false)
+	{
+		return;
+	}
+
+	// (Re)start the audio capture if nothing else is using the I2S bus
+	soundMonitorStart();
+
+	// In remote control mode, digits are consumed by the main loop as key events
+	if (settingsIsOptionBitSet(BIT_DTMF_REMOTE_CONTROL) == false)
+	{
+		char digit;
+
+		while (dtmfDecoderGetDigit(&digit))
+		{
+			dtmfDecoderAppendReceived(digit);
+		}
+	}
+
+	if ((dtmfDecoder.receivedDigits[0] != 0) && ticksTimerHasExpired(&dtmfDecoder.receivedTimer))
+	{
+		dtmfDecoder.receivedDigits[0] = 0;
+	}
+}
@@ -41,6 +41,8 @@
 
 #include "functions/calibration.h"
 #include "functions/hotspot.h"
+#include "functions/hotspotJitter.h"
+#include "functions/hotspotTelemetry.h"
 #include "user_interface/menuSystem.h"
 #include "user_interface/uiUtilities.h"
 #include "user_interface/uiLocalisation.h"
@@ -49,6 +51,7 @@
 #include "functions/sound.h"
 #include "functions/ticks.h"
 #include "functions/trx.h"
+#include "functions/pocsag.h"
 #include "usb/usb_com.h"
 #include "functions/rxPowerSaving.h"
 #include "user_interface/uiHotspot.h"
@@ -104,7 +107,6 @@ static const uint8_t MS_SOURCED_AUDIO_SYNC[]   = { 0x07, 0xF7, 0xD5, 0xDD, 0x57,
 static const uint8_t SYNC_MASK[]               = { 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0 };
 static const uint8_t MMDVM_VOICE_SYNC_PATTERN = 0x20;
 static const int EMBEDDED_DATA_OFFSET = 13;
-static const int TX_BUFFER_MIN_BEFORE_TRANSMISSION = 4;
 static const uint8_t START_FRAME_PATTERN[]  = { 0xFF,0x57,0xD7,0x5D,0xF5,0xD9 };
 static const uint8_t END_FRAME_PATTERN[]    = { 0x5D,0x7F,0x77,0xFD,0x75,0x79 };
 static const uint8_t VOICE_LC_SYNC_FULL[]       = { 0x04, 0x6D, 0x5D, 0x7F, 0x77, 0xFD, 0x75, 0x7E, 0x30 };
@@ -184,10 +186,13 @@ static const int embedddataCopyRanges[][2] = {{0,10},{16,26},{32,41},{48,57},{64
 static uint8_t hotspotTxLC[9];
 static bool startedEmbeddedSearch = false;
 
-// USB TX read/write positions and count
-static volatile uint16_t usbComSendBufWritePosition = 0;
-static volatile uint16_t usbComSendBufReadPosition = 0;
-static volatile uint16_t usbComSendBufCount = 0;
+// USB TX ring (usbComSendBuf), head/tail byte positions. COM_BUFFER_SIZE isn't a power of 2 on every platform
+// (512 * 3 without PLATFORM_MD9600), so the positions wrap explicitly, and a byte is kept free to tell a full ring
+// from an empty one.
+#define USB_COM_TX_PACKET_SIZE    64U // Full Speed bulk packet size
+static volatile uint16_t usbComSendBufHead = 0; // written by the producers (enqueueUSBData())
+static volatile uint16_t usbComSendBufTail = 0; // written by the consumer (processUSBDataQueue())
+static hotspotUSBTxStats_t usbComSendStats;
 
 // RF data read/write positions and count
 static volatile uint32_t rfFrameBufReadIdx = 0;
@@ -235,9 +240,18 @@ static bool	embeddedDataIsValid;
 
 __attribute__((section(BPTRAMLOCATION))) static bool BPTCRaw[196];
 __attribute__((section(BPTRAMLOCATION))) static bool BPTCDeInterleaved[196];
+static uint32_t BPTCCorrectedBits = 0; // bits fixed by the last BPTCdecode()
 
 static const uint32_t cwDOTDuration = 60; // 60ms per DOT
 static ticksTimer_t cwNextPeriodTimer = { 0, 0 };
+#if (HOTSPOT_TELEMETRY_PERIOD > 0)
+static ticksTimer_t telemetryTimer = { 0, 0 };
+static uint8_t telemetrySequence = 0;
+static hotspotUSBTxStats_t telemetryLastUSBTxStats;
+static hotspotJitterStats_t telemetryLastJitterStats;
+static uint32_t telemetryLastParserErrors;
+static uint32_t telemetryLastParserOverflows;
+#endif
 static uint8_t cwBuffer[64];
 static uint16_t cwpoPtr;
 
@@ -246,10 +260,12 @@ static HRC6000_Tone1Config_t tone1Config;
 #endif
 
 bool hotspotCwKeying = false;
+bool hotspotPocsagKeying = false;
 uint16_t hotspotCwpoLen;
 uint8_t hotspotCurrentRxCommandState;
 uint32_t hotspotFreqRx = 0;
 uint32_t hotspotFreqTx = 0;
+static uint32_t hotspotFreqPocsag = 0;
 char hotspotMmdvmQSOInfoIP[22] = {0}; // use 6x8 font; 21 char long
 DMRLC_t hotspotRxedDMR_LC; // used to stored LC info from RXed frames
 uint8_t hotspotSavedPowerLevel = POWER_UNSET;// no power level saved yet
@@ -611,6 +627,8 @@ static void BPTCdecode(const uint8_t *inputData, uint8_t *outputData)
 
 			if (hammingOK)
 			{
+				BPTCCorrectedBits++;
+
 				pos = j + 1;
 				for (int k = 0; k < 13; k++)
 				{
@@ -751,6 +769,7 @@ static bool hammingDecodeType2(bool *inputOutputBooleanBitsArray)
 		if (bitLocation != 0xFF)
 		{
 			inputOutputBooleanBitsArray[bitLocation] = !inputOutputBooleanBitsArray[bitLocation];
+			BPTCCorrectedBits++;
 			return true;
 		}
 	}
@@ -775,6 +794,7 @@ static bool hammingDecodeType1(bool *inputOutputBooleanBitsArray)
 		if (bitLocation != 0xFF)
 		{
 			inputOutputBooleanBitsArray[bitLocation] = !inputOutputBooleanBitsArray[bitLocation];
+			hotspotTelemetryCount(HOTSPOT_TELEMETRY_COUNTER_FEC_CORRECTED_BITS, 1);
 			return true;
 		}
 	}
@@ -1074,12 +1094,16 @@ static void getStatus(void)
 	buf[0]  = MMDVM_FRAME_START;
 	buf[1]  = 13;
 	buf[2]  = MMDVM_GET_STATUS;
+#if defined(RADIO_HAS_FSK_TX)
 	buf[3]  = (0x02 | 0x20); // DMR and POCSAG enabled
+#else
+	buf[3]  = 0x02; // DMR enabled
+#endif
 	buf[4]  = hotspotModemState;
 	buf[5]  = ( ((hotspotState == HOTSPOT_STATE_TX_START_BUFFERING) ||
 				(hotspotState == HOTSPOT_STATE_TRANSMITTING) ||
 				(hotspotState == HOTSPOT_STATE_TX_SHUTDOWN)) ||
-				hotspotCwKeying ) ? 0x01 : 0x00;
+				hotspotCwKeying || hotspotPocsagKeying ) ? 0x01 : 0x00;
 
 	if (hasRXOverflow())
 	{
@@ -1099,7 +1123,11 @@ static void getStatus(void)
 	buf[9]  = 0; // No YSF space
 	buf[10] = 0; // No P25 space
 	buf[11] = 0; // no NXDN space
-	buf[12] = 1; // virtual space for POCSAG
+#if defined(RADIO_HAS_FSK_TX)
+	buf[12] = pocsagGetQueueSpace(); // POCSAG space, in batches
+#else
+	buf[12] = 0; // No POCSAG space
+#endif
 
 	if (!hotspotMmdvmHostIsConnected)
 	{
@@ -1428,52 +1456,60 @@ static uint8_t setQSOInfo(const uint8_t *data, uint8_t length)
 }
 
 
-#if 0
+// MMDVMHost sends one batch (sync codeword + 16 codewords, big endian) per frame
 static uint8_t handlePOCSAG(const uint8_t *data, uint8_t length)
 {
-	return 0;
-}
+	uint32_t codewords[POCSAG_BATCH_WORDS];
+
+#if !defined(RADIO_HAS_FSK_TX)
+	// The synthesiser can't be FSK keyed, POCSAG is reported disabled, as by the MMDVM firmware
+	return 2;
 #endif
-void handleHotspotRequest(void)
-{
-	mmdvmHostLastActiveTime = ticksGetMillis(); // MMDVMHost sign of life.
 
-	// Rebuild the MMDVMHost frame stored in the USB (circular) buffer
-	uint8_t currentFrame[256]; // Absolute max frame length that MMDVMHost can send (+1)
-	uint8_t frameLength = (com_requestbuffer[comRecvMMDVMIndexOut++] - 1); // Remove our data block length header
+	if (length != POCSAG_BATCH_BYTES)
+	{
+		return 4;
+	}
 
-	// Make sure the index stays within limits.
-	if (comRecvMMDVMIndexOut >= COM_REQUESTBUFFER_SIZE)
+	// The transmitter is already used for DMR or CW ID
+	if ((hotspotState == HOTSPOT_STATE_TX_START_BUFFERING) || (hotspotState == HOTSPOT_STATE_TRANSMITTING) ||
+			(hotspotState == HOTSPOT_STATE_TX_SHUTDOWN) || hotspotCwKeying)
 	{
-		comRecvMMDVMIndexOut = 0;
+		return 5;
 	}
 
-	// Extract the MMDVMHost frame
-	for (uint8_t i = 0; i < frameLength; i++)
+	for (uint8_t i = 0; i < POCSAG_BATCH_WORDS; i++)
 	{
-		currentFrame[i] = com_requestbuffer[comRecvMMDVMIndexOut++];
+		codewords[i] = ((uint32_t)data[(i * 4)] << 24) | ((uint32_t)data[(i * 4) + 1] << 16) | ((uint32_t)data[(i * 4) + 2] << 8) | data[(i * 4) + 3];
 
-		// Make sure the index stays within limits.
-		if (comRecvMMDVMIndexOut >= COM_REQUESTBUFFER_SIZE)
+		if (pocsagCodewordIsValid(codewords[i]) == false)
 		{
-			comRecvMMDVMIndexOut = 0;
+			return 4;
 		}
 	}
 
-	// Make sure the index stays within limits.
-	if (comRecvMMDVMIndexOut >= COM_REQUESTBUFFER_SIZE)
+	if (pocsagQueueBatch(codewords) == false)
 	{
-		comRecvMMDVMIndexOut = 0;
+		return 5;
 	}
 
-	// Decrement the frame counter
-	comRecvMMDVMFrameCount--;
+	hotspotPocsagKeying = true;
+
+	return 0;
+}
+
+void handleHotspotRequest(void)
+{
+	mmdvmHostLastActiveTime = ticksGetMillis(); // MMDVMHost sign of life.
+
+	// The frame is handled in place, straight from the USB receive buffer,
+	// the parser has already checked its start byte and length.
+	const uint8_t *currentFrame;
+	uint8_t frameLength;
 
-	// Something went wrong, resync to the RX buffer
-	if (comRecvMMDVMFrameCount < 0)
+	if (usbComMMDVMPeekFrame(&currentFrame, &frameLength) == false)
 	{
-		comRecvMMDVMIndexIn = comRecvMMDVMIndexOut = 0; // Resync, it may skip few frames.
-		comRecvMMDVMFrameCount = 0;
+		return;
 	}
 
 	// Handle the frame, if valid.
@@ -1613,15 +1649,15 @@ void handleHotspotRequest(void)
 				break;
 
 			case MMDVM_POCSAG_DATA:
+				err = 5;
 				if ((hotspotModemState == STATE_IDLE) || (hotspotModemState == STATE_POCSAG))
 				{
-					//err = handlePOCSAG(currentFrame + 3, frameLength - 3);
-					err = 0;
+					err = handlePOCSAG(currentFrame + 3, frameLength - 3);
 				}
 
 				if (err == 0)
 				{
-					sendACK(currentFrame[2]); // We don't send pages, but POCSAG can be enabled in Pi-Star
+					sendACK(currentFrame[2]);
 				}
 				else
 				{
@@ -1649,12 +1685,9 @@ void handleHotspotRequest(void)
 				break;
 		}
 	}
-	else
-	{
-		// Invalid MMDVM header byte: resync (it may skip few frames).
-		comRecvMMDVMIndexIn = comRecvMMDVMIndexOut = 0;
-		comRecvMMDVMFrameCount = 0;
-	}
+
+	// Hand the buffer space back to the USB parser.
+	usbComMMDVMReleaseFrame();
 
 	if ((uiDataGlobal.displayQSOState == QSO_DISPLAY_CALLER_DATA) || (uiDataGlobal.displayQSOState == QSO_DISPLAY_CALLER_DATA_UPDATE))
 	{
@@ -1725,77 +1758,190 @@ void handleHotspotRequest(void)
 			uiHotspotUpdateScreen(HOTSPOT_RX_IDLE);
 		}
 	}
+
+	if (hotspotPocsagKeying)
+	{
+		if (pocsagTxProgress == POCSAG_TX_IDLE)
+		{
+			// Start TX POCSAG, prepare for ANALOG (wide, 4.5kHz deviation), the synthesiser is then FSK keyed by the TIM6 ISR
+			if (trxGetMode() != RADIO_MODE_ANALOG)
+			{
+				trxSetModeAndBandwidth(RADIO_MODE_ANALOG, true);
+				trxSetTxCSS(CODEPLUG_CSS_TONE_NONE);
+			}
+
+			// Pages go out on their own frequency
+			if (hotspotFreqPocsag != hotspotFreqTx)
+			{
+				trxSetFrequency(hotspotFreqRx, hotspotFreqPocsag, DMR_MODE_DMO);
+				trxSetPowerFromLevel(hotspotPowerLevel);
+			}
+
+			HRC6000ClearIsWakingState();
+			HRC6000SetMic(false);
+			trxEnableTransmission();
+
+			if (pocsagTxStart(hotspotFreqPocsag, POCSAG_BAUDRATE_1200) == false)
+			{
+				// Not supported, just flush the queue
+				pocsagInit();
+				pocsagTxProgress = POCSAG_TX_FINISHED;
+			}
+
+			uiHotspotUpdateScreen(HOTSPOT_RX_IDLE);
+		}
+
+		if (pocsagTxProgress == POCSAG_TX_FINISHED)
+		{
+			pocsagTxStop();
+
+			// Some batches were queued while the ISR was running out of data, keep on transmitting
+			if ((pocsagGetQueueSpace() < (POCSAG_QUEUE_BATCHES - 1)) && pocsagTxStart(hotspotFreqPocsag, POCSAG_BAUDRATE_1200))
+			{
+				return;
+			}
+		}
+
+		// All batches has been TXed, restore DIGITAL
+		if (pocsagTxProgress == POCSAG_TX_IDLE)
+		{
+			trxDisableTransmission();
+			HRC6000SetMic(true);
+
+			trxTransmissionEnabled = false;
+			trxIsTransmitting = false;
+
+			if (hotspotFreqPocsag != hotspotFreqTx)
+			{
+				trxSetFrequency(hotspotFreqRx, hotspotFreqTx, DMR_MODE_DMO);
+				trxSetPowerFromLevel(hotspotPowerLevel);
+			}
+
+			if (trxGetMode() == RADIO_MODE_ANALOG)
+			{
+				trxSetModeAndBandwidth(RADIO_MODE_DIGITAL, false);
+			}
+
+			hotspotPocsagKeying = false;
+			uiHotspotUpdateScreen(HOTSPOT_RX_IDLE);
+		}
+	}
 }
 
 
-// Queue system is a single byte header containing the length of the item, followed by the data
-// if the block won't fit in the space between the current write location and the end of the buffer,
-// a zero is written to the length for that block and the data and its length byte is put at the beginning of the buffer
+// count is at most COM_BUFFER_SIZE
+static inline uint16_t usbComSendBufAdvance(uint16_t position, uint16_t count)
+{
+	position += count;
+
+	return ((position >= COM_BUFFER_SIZE) ? (position - COM_BUFFER_SIZE) : position);
+}
+
+// The USB TX queue is a ring of records, each made of a single byte header containing the length of the
+// MMDVM frame, followed by the frame itself. Records are wrapping around the end of the buffer.
+// Frames are produced by both the HR-C6000 task (RX frames) and the UI task (replies), hence the short critical
+// section on the producer side, while the consumer side (UI task) only moves the tail.
 void enqueueUSBData(uint8_t *data, uint8_t length)
 {
-	if ((usbComSendBufWritePosition + (length + 1)) > (COM_BUFFER_SIZE - 1))
+	if (length < 3) // the shortest MMDVM frame length (3 = DMRLost)
 	{
-		usbComSendBuf[usbComSendBufWritePosition] = 0xFF; // flag that the data block won't fit and will be put at the start of the buffer
-		usbComSendBufWritePosition = 0;
+		return;
 	}
 
-	usbComSendBuf[usbComSendBufWritePosition] = length;
-	memcpy((uint8_t *)&usbComSendBuf[usbComSendBufWritePosition + 1], data, length);
-	usbComSendBufWritePosition += (length + 1);
-	usbComSendBufCount++;
+	taskENTER_CRITICAL();
 
-	if (length <= 1)
+	uint16_t head = usbComSendBufHead;
+	uint16_t used = usbComSendBufAdvance(head, (COM_BUFFER_SIZE - usbComSendBufTail));
+
+	if ((used + length + 1) >= COM_BUFFER_SIZE)
 	{
-		// Blah
+		usbComSendStats.overflows++;
+	}
+	else
+	{
+		uint16_t position = usbComSendBufAdvance(head, 1);
+		uint16_t firstChunk = (((COM_BUFFER_SIZE - position) < length) ? (COM_BUFFER_SIZE - position) : length);
+
+		usbComSendBuf[head] = length;
+		memcpy((uint8_t *)&usbComSendBuf[position], data, firstChunk);
+		memcpy((uint8_t *)&usbComSendBuf[0], (data + firstChunk), (length - firstChunk));
+
+		used += (length + 1);
+		if (used > usbComSendStats.peakUsage)
+		{
+			usbComSendStats.peakUsage = used;
+		}
+
+		hotspotTelemetrySample(HOTSPOT_TELEMETRY_HISTOGRAM_USB_QUEUE_DEPTH, used);
+
+		__DMB();
+		usbComSendBufHead = usbComSendBufAdvance(position, length);
 	}
 
+	taskEXIT_CRITICAL();
 }
 
+// Pack as many whole queued frames as possible into one bulk packet (a frame longer than a packet is sent alone).
+// The records are only released once the USB stack has accepted the packet, otherwise it will be rebuilt on the next call.
 void processUSBDataQueue(void)
 {
-	if (usbComSendBufCount > 0)
+	uint8_t packet[UINT8_MAX];
+	uint16_t head = usbComSendBufHead;
+	uint16_t tail = usbComSendBufTail;
+	uint16_t packetLength = 0;
+	uint16_t frames = 0;
+
+	while (tail != head)
 	{
-		if (usbComSendBuf[usbComSendBufReadPosition] == 0xFF) // End marker
+		uint8_t length = usbComSendBuf[tail];
+		uint16_t position = usbComSendBufAdvance(tail, 1);
+		uint16_t firstChunk = (((COM_BUFFER_SIZE - position) < length) ? (COM_BUFFER_SIZE - position) : length);
+
+		if ((packetLength > 0) && ((packetLength + length) > USB_COM_TX_PACKET_SIZE))
 		{
-			usbComSendBuf[usbComSendBufReadPosition] = 0;
-			usbComSendBufReadPosition = 0;
+			break;
 		}
 
-		uint8_t len = usbComSendBuf[usbComSendBufReadPosition] + 1;
+		memcpy(&packet[packetLength], (uint8_t *)&usbComSendBuf[position], firstChunk);
+		memcpy(&packet[packetLength + firstChunk], (uint8_t *)&usbComSendBuf[0], (length - firstChunk));
+		packetLength += length;
+		tail = usbComSendBufAdvance(position, length);
+		frames++;
+	}
+
+	if (packetLength == 0)
+	{
+		return;
+	}
 
-		if (len < (3 + 1)) // the shortest MMDVM frame length (3 = DMRLost)
-		{
-			usbComSendBufCount--;
-		}
-		else
-		{
 #if defined(STM32F405xx)
-			uint8_t status = CDC_Transmit_FS((uint8_t *)&usbComSendBuf[usbComSendBufReadPosition + 1], usbComSendBuf[usbComSendBufReadPosition]);
+	uint8_t status = CDC_Transmit_FS(packet, packetLength);
 
-			if (status == USBD_OK)
+	if (status == USBD_OK)
 #else
-			usb_status_t status = USB_DeviceCdcAcmSend(s_cdcVcom.cdcAcmHandle, USB_CDC_VCOM_BULK_IN_ENDPOINT, &usbComSendBuf[usbComSendBufReadPosition + 1], usbComSendBuf[usbComSendBufReadPosition]);
+	usb_status_t status = USB_DeviceCdcAcmSend(s_cdcVcom.cdcAcmHandle, USB_CDC_VCOM_BULK_IN_ENDPOINT, packet, packetLength);
 
-			if (status == kStatus_USB_Success)
+	if (status == kStatus_USB_Success)
 #endif
-			{
-				usbComSendBufReadPosition += len;
-
-				if (usbComSendBufReadPosition >= (COM_BUFFER_SIZE - 1)) // reaching the end of the buffer
-				{
-					usbComSendBufReadPosition = 0;
-				}
-
-				usbComSendBufCount--;
-			}
-			else
-			{
-				// USB Send Fail
-			}
-		}
+	{
+		__DMB();
+		usbComSendBufTail = tail;
+		usbComSendStats.packets++;
+		usbComSendStats.frames += frames;
+	}
+	else
+	{
+		// USB busy, retry on next call
 	}
 }
 
+void hotspotGetUSBTxStats(hotspotUSBTxStats_t *stats)
+{
+	taskENTER_CRITICAL();
+	memcpy(stats, &usbComSendStats, sizeof(hotspotUSBTxStats_t));
+	taskEXIT_CRITICAL();
+}
+
 static void swapWithFakeTA(uint8_t *lc)
 {
 	if ((lc[0] >= DMR_EMBEDDED_DATA_TALKER_ALIAS_HEADER) && (lc[0] < DMR_EMBEDDED_DATA_TALKER_ALIAS_BLOCK2))
@@ -1927,9 +2073,20 @@ static void sendTerminator_LC_Frame(volatile const uint8_t *receivedDMRDataAndAu
 
 void hotspotRxFrameHandler(uint8_t* frameBuf) // It's called by and ISR in HRC-6000 code.
 {
+	if (rfFrameBufCount >= HOTSPOT_BUFFER_COUNT)
+	{
+		// Buffer overflow, MMDVMHost isn't reading fast enough
+		hotspotTelemetryCount(HOTSPOT_TELEMETRY_COUNTER_RF_OVERFLOWS, 1);
+		return;
+	}
+
 	memcpy((uint8_t *)&audioAndHotspotDataBuffer.hotspotBuffer[rfFrameBufWriteIdx], frameBuf, AMBE_AUDIO_LENGTH + LC_DATA_LENGTH + 2);// 27 audio + 0x0c header + 2 hotspot signalling bytes
+	hotspotTelemetryStampFrame(HOTSPOT_TELEMETRY_STAMP_RF, rfFrameBufWriteIdx, ticksGetMillis());
 	rfFrameBufCount++;
 	rfFrameBufWriteIdx = ((rfFrameBufWriteIdx + 1) % HOTSPOT_BUFFER_COUNT);
+
+	hotspotTelemetryCount(HOTSPOT_TELEMETRY_COUNTER_RF_FRAMES, 1);
+	hotspotTelemetrySample(HOTSPOT_TELEMETRY_HISTOGRAM_RF_BUFFER_DEPTH, rfFrameBufCount);
 }
 
 static bool getEmbeddedData(volatile const uint8_t *comBuffer)
@@ -2053,7 +2210,9 @@ static void storeNetFrame(volatile const uint8_t *comBuffer)
 	{
 		if (wavbuffer_count >= HOTSPOT_BUFFER_COUNT)
 		{
-			// Buffer overflow
+			// Buffer overflow, drop the frame rather than overwriting the oldest one which may be in use
+			hotspotJitterFrameDropped();
+			return;
 		}
 
 		taskENTER_CRITICAL();
@@ -2062,9 +2221,14 @@ static void storeNetFrame(volatile const uint8_t *comBuffer)
 		memcpy((uint8_t *)&audioAndHotspotDataBuffer.hotspotBuffer[wavbuffer_write_idx][LC_DATA_LENGTH + 14], (uint8_t *)&comBuffer[24], 13);//copy the last 13, whole bytes of audio
 
 		memcpy((uint8_t *)&audioAndHotspotDataBuffer.hotspotBuffer[wavbuffer_write_idx], hotspotTxLC, 9);// copy the current LC into the data (mainly for use with the embedded data);
+		hotspotTelemetryStampFrame(HOTSPOT_TELEMETRY_STAMP_NET, wavbuffer_write_idx, ticksGetMillis());
 		wavbuffer_count++;
 		wavbuffer_write_idx = ((wavbuffer_write_idx + 1) % HOTSPOT_BUFFER_COUNT);
 		taskEXIT_CRITICAL();
+
+		hotspotJitterFrameArrived(ticksGetMillis(), wavbuffer_count);
+		hotspotTelemetryCount(HOTSPOT_TELEMETRY_COUNTER_NET_FRAMES, 1);
+		hotspotTelemetrySample(HOTSPOT_TELEMETRY_HISTOGRAM_NET_BUFFER_DEPTH, wavbuffer_count);
 	}
 }
 
@@ -2084,7 +2248,19 @@ static uint8_t hotspotModeReceiveNetFrame(const uint8_t *comBuffer, uint8_t time
 	lc.srcId = 0;// zero these values as they are checked later in the function, but only updated if the data type is DT_VOICE_LC_HEADER
 	lc.dstId = 0;
 
-	voiceLCHeaderDecode((uint8_t *)comBuffer + MMDVM_HEADER_LENGTH, DT_VOICE_LC_HEADER, &lc);// Need to decode the frame to get the source and destination
+	BPTCCorrectedBits = 0;
+	bool lcDecoded = voiceLCHeaderDecode((uint8_t *)comBuffer + MMDVM_HEADER_LENGTH, DT_VOICE_LC_HEADER, &lc);// Need to decode the frame to get the source and destination
+
+	// Every frame goes through the decoder, only the real LC headers are accounted.
+	if (comBuffer[3] == (DMR_SYNC_DATA | DT_VOICE_LC_HEADER))
+	{
+		hotspotTelemetryCount(HOTSPOT_TELEMETRY_COUNTER_FEC_CORRECTED_BITS, BPTCCorrectedBits);
+
+		if (lcDecoded == false)
+		{
+			hotspotTelemetryCount(HOTSPOT_TELEMETRY_COUNTER_LC_DECODE_FAILURES, 1);
+		}
+	}
 
 	// update the src and destination ID's if valid
 	if 	((lc.srcId != 0) && (lc.dstId != 0))
@@ -2229,6 +2405,42 @@ void mmdvmSendDebug5(const char *text, int16_t n1, int16_t n2, int16_t n3, int16
 }
 #endif
 
+#if (HOTSPOT_TELEMETRY_PERIOD > 0)
+// Periodic counters and histograms, as a binary MMDVM_DEBUG_DUMP frame
+static void sendTelemetry(void)
+{
+	hotspotTelemetrySnapshot_t snapshot;
+	hotspotUSBTxStats_t usbTxStats;
+	hotspotJitterStats_t jitterStats;
+	uint32_t parserErrors;
+	uint32_t parserOverflows;
+	uint8_t buf[3 + HOTSPOT_TELEMETRY_PAYLOAD_LENGTH_MAX];
+
+	// Those are already counted (cumulatively) by their owners.
+	hotspotGetUSBTxStats(&usbTxStats);
+	hotspotJitterGetStats(&jitterStats);
+	hotspotTelemetryCount(HOTSPOT_TELEMETRY_COUNTER_USB_OVERFLOWS, (usbTxStats.overflows - telemetryLastUSBTxStats.overflows));
+	hotspotTelemetryCount(HOTSPOT_TELEMETRY_COUNTER_NET_OVERFLOWS, (jitterStats.overflows - telemetryLastJitterStats.overflows));
+	hotspotTelemetryCount(HOTSPOT_TELEMETRY_COUNTER_NET_UNDERRUNS, (jitterStats.underruns - telemetryLastJitterStats.underruns));
+	telemetryLastUSBTxStats = usbTxStats;
+	telemetryLastJitterStats = jitterStats;
+
+	usbComMMDVMGetParserStats(&parserErrors, &parserOverflows);
+	hotspotTelemetryCount(HOTSPOT_TELEMETRY_COUNTER_USB_PARSER_ERRORS, (parserErrors - telemetryLastParserErrors));
+	hotspotTelemetryCount(HOTSPOT_TELEMETRY_COUNTER_USB_PARSER_OVERFLOWS, (parserOverflows - telemetryLastParserOverflows));
+	telemetryLastParserErrors = parserErrors;
+	telemetryLastParserOverflows = parserOverflows;
+
+	hotspotTelemetryTakeSnapshot(&snapshot, ticksGetMillis());
+
+	buf[0] = MMDVM_FRAME_START;
+	buf[1] = 3 + hotspotTelemetryEncode(&snapshot, telemetrySequence++, &buf[3], HOTSPOT_TELEMETRY_PAYLOAD_LENGTH_MAX);
+	buf[2] = MMDVM_DEBUG_DUMP;
+
+	enqueueUSBData(buf, buf[1]);
+}
+#endif
+
 static void sendDMRLost(void)
 {
 	uint8_t buf[3];
@@ -2269,6 +2481,14 @@ void hotspotStateMachine(void)
 {
 	static uint32_t rxFrameTime = 0;
 
+#if (HOTSPOT_TELEMETRY_PERIOD > 0)
+	if (hotspotMmdvmHostIsConnected && (nonVolatileSettings.hotspotType == HOTSPOT_TYPE_MMDVM) && ticksTimerHasExpired(&telemetryTimer))
+	{
+		ticksTimerStart(&telemetryTimer, HOTSPOT_TELEMETRY_PERIOD);
+		sendTelemetry();
+	}
+#endif
+
 	switch(hotspotState)
 	{
 		case HOTSPOT_STATE_NOT_CONNECTED:
@@ -2437,6 +2657,7 @@ void hotspotStateMachine(void)
 							break;
 					}
 
+					hotspotTelemetryFrameDone(HOTSPOT_TELEMETRY_STAMP_RF, rfFrameBufReadIdx, ticksGetMillis());
 					memset((void *)&audioAndHotspotDataBuffer.hotspotBuffer[rfFrameBufReadIdx], 0, HOTSPOT_BUFFER_SIZE);
 					rfFrameBufReadIdx = ((rfFrameBufReadIdx + 1) % HOTSPOT_BUFFER_COUNT);
 
@@ -2490,9 +2711,10 @@ void hotspotStateMachine(void)
 			}
 			else
 			{
-				if (wavbuffer_count > TX_BUFFER_MIN_BEFORE_TRANSMISSION)
+				// The pre-buffering depth follows the network jitter
+				if (wavbuffer_count >= hotspotJitterGetTargetDepth())
 				{
-					if (hotspotCwKeying == false)
+					if ((hotspotCwKeying == false) && (hotspotPocsagKeying == false))
 					{
 						HRC6000ClearIsWakingState();
 						hotspotState = HOTSPOT_STATE_TRANSMITTING;
@@ -2565,7 +2787,7 @@ static uint8_t setFreq(const uint8_t *data, uint8_t length)
 	const int BAN1_MAX  = 14600000;
 	const int BAN2_MIN  = 43500000;
 	const int BAN2_MAX  = 43800000;
-	uint32_t fRx, fTx;
+	uint32_t fRx, fTx, fPocsag;
 
 	hotspotState = HOTSPOT_STATE_INITIALISE;
 
@@ -2589,15 +2811,29 @@ static uint8_t setFreq(const uint8_t *data, uint8_t length)
 	fRx = (data[1] << 0 | data[2] << 8  | data[3] << 16 | data[4] << 24) / 10;
 	fTx = (data[5] << 0 | data[6] << 8  | data[7] << 16 | data[8] << 24) / 10;
 
-	if ((fTx >= BAN1_MIN && fTx <= BAN1_MAX) || (fTx >= BAN2_MIN && fTx <= BAN2_MAX))
+	// Current MMDVMHost also sends the POCSAG frequency (0 if unset)
+	fPocsag = fTx;
+	if (length >= 14)
+	{
+		uint32_t f = (data[10] << 0 | data[11] << 8  | data[12] << 16 | data[13] << 24) / 10;
+
+		if (f != 0)
+		{
+			fPocsag = f;
+		}
+	}
+
+	if ((fTx >= BAN1_MIN && fTx <= BAN1_MAX) || (fTx >= BAN2_MIN && fTx <= BAN2_MAX) ||
+			(fPocsag >= BAN1_MIN && fPocsag <= BAN1_MAX) || (fPocsag >= BAN2_MIN && fPocsag <= BAN2_MAX))
 	{
 		return 4;// invalid frequency
 	}
 
-	if (trxCheckFrequencyInAmateurBand(fRx) && trxCheckFrequencyInAmateurBand(fTx))
+	if (trxCheckFrequencyInAmateurBand(fRx) && trxCheckFrequencyInAmateurBand(fTx) && trxCheckFrequencyInAmateurBand(fPocsag))
 	{
 		hotspotFreqRx = fRx;
 		hotspotFreqTx = fTx;
+		hotspotFreqPocsag = fPocsag;
 		trxSetFrequency(hotspotFreqRx, hotspotFreqTx, DMR_MODE_DMO);// Override the default assumptions about DMR mode based on frequency
 	}
 	else
@@ -2648,6 +2884,8 @@ void hotspotInit(void)
 	overriddenLCAvailable = false;
 	hotspotCwKeying = false;
 	cwReset();
+	hotspotPocsagKeying = false;
+	pocsagInit();
 	hotspotTxDelay = 0;
 	memset(&hotspotRxedDMR_LC, 0, sizeof(DMRLC_t));// clear automatic variable
 
@@ -2662,10 +2900,20 @@ void hotspotInit(void)
 		memset((void *)&audioAndHotspotDataBuffer.hotspotBuffer[i], 0, HOTSPOT_BUFFER_SIZE);
 	}
 
+	hotspotJitterInit();
+	hotspotTelemetryInit(ticksGetMillis());
+#if (HOTSPOT_TELEMETRY_PERIOD > 0)
+	ticksTimerStart(&telemetryTimer, HOTSPOT_TELEMETRY_PERIOD);
+	telemetrySequence = 0;
+	memset(&telemetryLastUSBTxStats, 0, sizeof(telemetryLastUSBTxStats)); // USB and jitter stats are cleared too
+	memset(&telemetryLastJitterStats, 0, sizeof(telemetryLastJitterStats));
+	usbComMMDVMGetParserStats(&telemetryLastParserErrors, &telemetryLastParserOverflows); // the parser ones are not
+#endif
+
 	// Clear USB TX buffers
-	usbComSendBufWritePosition = 0;
-	usbComSendBufReadPosition = 0;
-	usbComSendBufCount = 0;
+	usbComSendBufHead = 0;
+	usbComSendBufTail = 0;
+	memset(&usbComSendStats, 0, sizeof(usbComSendStats));
 	memset((uint8_t *)&usbComSendBuf, 0, sizeof(usbComSendBuf));
 
 	trxSetModeAndBandwidth(RADIO_MODE_DIGITAL, false);// hotspot mode is for DMR i.e Digital mode
@@ -2680,6 +2928,11 @@ void hotspotInit(void)
 		hotspotFreqRx = 43000000;
 	}
 
+	if (hotspotFreqPocsag == 0)
+	{
+		hotspotFreqPocsag = hotspotFreqTx;
+	}
+
 	MMDVMHostRxState = MMDVMHOST_RX_READY; // We have not sent anything to MMDVMHost, so it can't be busy yet.
 
 	// Set CC, QRG and power, in case hotspot menu has left then re-enter.
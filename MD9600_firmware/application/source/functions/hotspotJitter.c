@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include <string.h>
+#include "functions/hotspotJitter.h"
+
+//
+// Adaptive jitter buffer sizing, for the network to RF direction of the hotspot.
+//
+// The network frames carry no timestamp, so each frame delay is measured against an ideal 60ms clock
+// which is anchored on the earliest frame of the stream (a frame that arrives early moves the anchor).
+// The buffer depth needed to ride out the network jitter is the spread of these delays: a decaying
+// peak of the delays is kept across the streams, and the pre-buffering target depth is derived from it.
+//
+// The transmitter sends silence (the LC is kept, so the embedded signalling stays correct) when it runs
+// out of frames. Those starved slots are only counted as an underrun if a frame of the same stream
+// arrives afterward, as the buffer also runs empty at the end of each stream.
+//
+#define HOTSPOT_JITTER_DECAY_SHIFT     6 // peak delay decays by 1/64 of the gap on each frame (~4s)
+
+typedef struct
+{
+	uint32_t             baseTime; // arrival time of the stream's frame #0, on the ideal clock
+	uint32_t             lastArrival;
+	uint32_t             streamFrames;
+	uint32_t             peakDelay; // ms
+	volatile uint32_t    starvedSlots; // written by the HR-C6000 timeslot handler only
+	uint32_t             starvedSlotsSeen;
+	hotspotJitterStats_t stats;
+} hotspotJitterData_t;
+
+static hotspotJitterData_t hotspotJitter;
+
+static void hotspotJitterUpdateTarget(void)
+{
+	uint32_t depth = (1 + ((hotspotJitter.peakDelay + (HOTSPOT_JITTER_FRAME_DURATION - 1)) / HOTSPOT_JITTER_FRAME_DURATION));
+
+	if (depth < HOTSPOT_JITTER_DEPTH_MIN)
+	{
+		depth = HOTSPOT_JITTER_DEPTH_MIN;
+	}
+	else if (depth > HOTSPOT_JITTER_DEPTH_MAX)
+	{
+		depth = HOTSPOT_JITTER_DEPTH_MAX;
+	}
+
+	hotspotJitter.stats.targetDepth = depth;
+	hotspotJitter.stats.jitter = ((hotspotJitter.peakDelay > UINT16_MAX) ? UINT16_MAX : hotspotJitter.peakDelay);
+}
+
+void hotspotJitterInit(void)
+{
+	memset(&hotspotJitter, 0, sizeof(hotspotJitterData_t));
+	hotspotJitter.peakDelay = ((HOTSPOT_JITTER_DEPTH_DEFAULT - 1) * HOTSPOT_JITTER_FRAME_DURATION);
+	hotspotJitterUpdateTarget();
+}
+
+void hotspotJitterFrameArrived(uint32_t timeMs, uint32_t depth)
+{
+	uint32_t starvedSlots = hotspotJitter.starvedSlots;
+	uint32_t starved = (starvedSlots - hotspotJitter.starvedSlotsSeen);
+
+	hotspotJitter.starvedSlotsSeen = starvedSlots;
+
+	if ((hotspotJitter.streamFrames == 0) || ((int32_t)(timeMs - hotspotJitter.lastArrival) > (int32_t)HOTSPOT_JITTER_STREAM_GAP))
+	{
+		// New stream, the silence sent at the end of the previous one doesn't count.
+		hotspotJitter.baseTime = timeMs;
+		hotspotJitter.streamFrames = 1;
+	}
+	else
+	{
+		uint32_t expected = (hotspotJitter.baseTime + (hotspotJitter.streamFrames * HOTSPOT_JITTER_FRAME_DURATION));
+		int32_t delay = (int32_t)(timeMs - expected);
+
+		if (delay < 0)
+		{
+			hotspotJitter.baseTime += delay;
+			delay = 0;
+		}
+
+		if (starved > 0)
+		{
+			// The pre-buffering wasn't deep enough, make sure the next stream gets at least one more frame.
+			hotspotJitter.stats.underruns++;
+			hotspotJitter.stats.starvedSlots += starved;
+			delay += HOTSPOT_JITTER_FRAME_DURATION;
+		}
+
+		if ((uint32_t)delay > hotspotJitter.peakDelay)
+		{
+			hotspotJitter.peakDelay = delay;
+		}
+		else if ((uint32_t)delay < hotspotJitter.peakDelay)
+		{
+			uint32_t decay = ((hotspotJitter.peakDelay - delay) >> HOTSPOT_JITTER_DECAY_SHIFT);
+
+			hotspotJitter.peakDelay -= ((decay > 0) ? decay : 1);
+		}
+
+		hotspotJitter.streamFrames++;
+		hotspotJitterUpdateTarget();
+	}
+
+	hotspotJitter.lastArrival = timeMs;
+	hotspotJitter.stats.frames++;
+	hotspotJitter.stats.depth = ((depth > UINT8_MAX) ? UINT8_MAX : depth);
+
+	if (hotspotJitter.stats.depth > hotspotJitter.stats.maxDepth)
+	{
+		hotspotJitter.stats.maxDepth = hotspotJitter.stats.depth;
+	}
+}
+
+void hotspotJitterFrameDropped(void)
+{
+	hotspotJitter.stats.overflows++;
+}
+
+// Called from the HR-C6000 timeslot handler, when silence is sent in place of a network frame
+void hotspotJitterSlotStarved(void)
+{
+	hotspotJitter.starvedSlots++;
+}
+
+uint32_t hotspotJitterGetTargetDepth(void)
+{
+	return hotspotJitter.stats.targetDepth;
+}
+
+void hotspotJitterGetStats(hotspotJitterStats_t *stats)
+{
+	memcpy(stats, &hotspotJitter.stats, sizeof(hotspotJitterStats_t));
+}
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include <string.h>
+#include "functions/hotspotTelemetry.h"
+
+//
+// Hotspot performance counters and histograms.
+//
+// Everything is accumulated over a reporting period, then a snapshot is taken (which restarts the period)
+// and encoded into a compact payload, sent to MMDVMHost as a MMDVM_DEBUG_DUMP frame (it ends up in its
+// log file as an hex dump, tools/hotspot_telemetry/decode_telemetry.py decodes it).
+//
+// The recording functions are called from the HR-C6000 and UI tasks without locking, a rare lost
+// increment is acceptable here.
+//
+// Payload layout (all the numbers are unsigned LEB128 varints, unless stated otherwise):
+//   uint8_t  magic (HOTSPOT_TELEMETRY_MAGIC)
+//   uint8_t  version (HOTSPOT_TELEMETRY_VERSION)
+//   uint8_t  sequence
+//            period (ms)
+//   uint8_t  number of counters, followed by the counters
+//   uint8_t  number of histograms, then for each of them:
+//     uint8_t  bucket shift
+//     uint8_t  number of buckets, followed by the buckets
+//
+#define HOTSPOT_TELEMETRY_STAMP_NONE  UINT32_MAX
+
+typedef struct
+{
+	uint32_t                   periodStart;
+	hotspotTelemetrySnapshot_t current;
+	uint32_t                   stamps[HOTSPOT_TELEMETRY_STAMP_MAX][HOTSPOT_TELEMETRY_FRAME_STAMPS];
+} hotspotTelemetryData_t;
+
+// Bucket width of each histogram, in power of 2
+static const uint8_t HOTSPOT_TELEMETRY_HISTOGRAM_SHIFTS[HOTSPOT_TELEMETRY_HISTOGRAM_MAX] =
+{
+		4, // USB queue depth, 16 bytes units
+		0, // RF buffer depth, frames
+		0, // Network buffer depth, frames
+		3, // Frame to air latency, 8ms units
+		0  // ISR to USB latency, ms
+};
+
+static hotspotTelemetryData_t hotspotTelemetry;
+
+void hotspotTelemetryInit(uint32_t timeMs)
+{
+	memset(&hotspotTelemetry.current, 0, sizeof(hotspotTelemetrySnapshot_t));
+	memset(hotspotTelemetry.stamps, 0xFF, sizeof(hotspotTelemetry.stamps));
+	hotspotTelemetry.periodStart = timeMs;
+}
+
+void hotspotTelemetryCount(hotspotTelemetryCounter_t counter, uint32_t value)
+{
+	hotspotTelemetry.current.counters[counter] += value;
+}
+
+void hotspotTelemetrySample(hotspotTelemetryHistogram_t histogram, uint32_t value)
+{
+	uint32_t scaled = (value >> HOTSPOT_TELEMETRY_HISTOGRAM_SHIFTS[histogram]);
+	uint32_t bucket = 0;
+
+	while ((scaled > 0) && (bucket < (HOTSPOT_TELEMETRY_HISTOGRAM_BUCKETS - 1)))
+	{
+		scaled >>= 1;
+		bucket++;
+	}
+
+	if (hotspotTelemetry.current.histograms[histogram][bucket] < UINT16_MAX)
+	{
+		hotspotTelemetry.current.histograms[histogram][bucket]++;
+	}
+}
+
+// Remember when the frame stored at this buffer index was received
+void hotspotTelemetryStampFrame(hotspotTelemetryStamp_t stamp, uint32_t index, uint32_t timeMs)
+{
+	hotspotTelemetry.stamps[stamp][index % HOTSPOT_TELEMETRY_FRAME_STAMPS] = timeMs;
+}
+
+// The frame stored at this buffer index has left the buffer, sample its latency
+void hotspotTelemetryFrameDone(hotspotTelemetryStamp_t stamp, uint32_t index, uint32_t timeMs)
+{
+	uint32_t *frameStamp = &hotspotTelemetry.stamps[stamp][index % HOTSPOT_TELEMETRY_FRAME_STAMPS];
+
+	if (*frameStamp != HOTSPOT_TELEMETRY_STAMP_NONE)
+	{
+		hotspotTelemetrySample(((stamp == HOTSPOT_TELEMETRY_STAMP_RF) ? HOTSPOT_TELEMETRY_HISTOGRAM_ISR_TO_USB_LATENCY : HOTSPOT_TELEMETRY_HISTOGRAM_FRAME_TO_AIR_LATENCY), (timeMs - *frameStamp));
+		*frameStamp = HOTSPOT_TELEMETRY_STAMP_NONE;
+	}
+}
+
+void hotspotTelemetryTakeSnapshot(hotspotTelemetrySnapshot_t *snapshot, uint32_t timeMs)
+{
+	memcpy(snapshot, &hotspotTelemetry.current, sizeof(hotspotTelemetrySnapshot_t));
+	snapshot->periodMs = (timeMs - hotspotTelemetry.periodStart);
+
+	memset(&hotspotTelemetry.current, 0, sizeof(hotspotTelemetrySnapshot_t));
+	hotspotTelemetry.periodStart = timeMs;
+}
+
+static uint8_t *hotspotTelemetryPutVarint(uint8_t *ptr, uint32_t value)
+{
+	while (value >= 0x80)
+	{
+		*ptr++ = ((value & 0x7F) | 0x80);
+		value >>= 7;
+	}
+
+	*ptr++ = value;
+
+	return ptr;
+}
+
+// Returns the payload length, or 0 if the buffer is too small (HOTSPOT_TELEMETRY_PAYLOAD_LENGTH_MAX is always enough)
+uint8_t hotspotTelemetryEncode(const hotspotTelemetrySnapshot_t *snapshot, uint8_t sequence, uint8_t *buffer, uint8_t bufferSize)
+{
+	uint8_t payload[HOTSPOT_TELEMETRY_PAYLOAD_LENGTH_MAX];
+	uint8_t *ptr = payload;
+	uint32_t length;
+
+	*ptr++ = HOTSPOT_TELEMETRY_MAGIC;
+	*ptr++ = HOTSPOT_TELEMETRY_VERSION;
+	*ptr++ = sequence;
+	ptr = hotspotTelemetryPutVarint(ptr, snapshot->periodMs);
+
+	*ptr++ = HOTSPOT_TELEMETRY_COUNTER_MAX;
+	for (uint32_t i = 0; i < HOTSPOT_TELEMETRY_COUNTER_MAX; i++)
+	{
+		ptr = hotspotTelemetryPutVarint(ptr, snapshot->counters[i]);
+	}
+
+	*ptr++ = HOTSPOT_TELEMETRY_HISTOGRAM_MAX;
+	for (uint32_t i = 0; i < HOTSPOT_TELEMETRY_HISTOGRAM_MAX; i++)
+	{
+		*ptr++ = HOTSPOT_TELEMETRY_HISTOGRAM_SHIFTS[i];
+		*ptr++ = HOTSPOT_TELEMETRY_HISTOGRAM_BUCKETS;
+
+		for (uint32_t b = 0; b < HOTSPOT_TELEMETRY_HISTOGRAM_BUCKETS; b++)
+		{
+			ptr = hotspotTelemetryPutVarint(ptr, snapshot->histograms[i][b]);
+		}
+	}
+
+	length = (ptr - payload);
+
+	if (length > bufferSize)
+	{
+		return 0;
+	}
+
+	memcpy(buffer, payload, length);
+
+	return length;
+}
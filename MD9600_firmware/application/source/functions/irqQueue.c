@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <string.h>
+#include "functions/irqQueue.h"
+
+//
+// Single producer (an ISR), single consumer (a task) lock free queue.
+//
+// Each side only writes its own index, the entry being published by the head update, after a barrier.
+// The indexes are free running, so the queue is full when they are IRQ_QUEUE_SIZE apart.
+//
+void irqQueueInit(irqQueue_t *queue)
+{
+	memset(queue, 0, sizeof(irqQueue_t));
+}
+
+// Producer side. Returns false (and counts the entry as dropped) when the queue is full.
+bool irqQueuePush(irqQueue_t *queue, const irqQueueEntry_t *entry)
+{
+	uint32_t head = queue->head;
+
+	if ((head - queue->tail) >= IRQ_QUEUE_SIZE)
+	{
+		queue->dropped++;
+		return false;
+	}
+
+	queue->entries[head & (IRQ_QUEUE_SIZE - 1)] = *entry;
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	queue->head = (head + 1);
+
+	return true;
+}
+
+// Consumer side
+bool irqQueuePop(irqQueue_t *queue, irqQueueEntry_t *entry)
+{
+	uint32_t tail = queue->tail;
+
+	if (tail == queue->head)
+	{
+		return false;
+	}
+
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	*entry = queue->entries[tail & (IRQ_QUEUE_SIZE - 1)];
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	queue->tail = (tail + 1);
+
+	return true;
+}
+
+bool irqQueueIsEmpty(irqQueue_t *queue)
+{
+	return (queue->tail == queue->head);
+}
+
+uint32_t irqQueueGetDropped(irqQueue_t *queue)
+{
+	return queue->dropped;
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <string.h>
+#include "functions/perf.h"
+
+#if defined(USING_PERF)
+
+//
+// Timing probes.
+//
+// Each PERF_BEGIN()/PERF_END() scope adds its duration, in counter ticks (CPU cycles on the radio), to the probe
+// min/max/total and to a log2 histogram. Recording a duration only costs a few stores with the interrupts masked,
+// so the probes can be used in the ISRs. The stats are read by the CPS 'P' command.
+// The cycle counter doesn't count while the core sleeps in WFI, so the blocking waits are kept out of the probe
+// scopes (e.g. the display render probe starts once the previous transfer is complete).
+//
+#if defined(__arm__)
+#define PERF_LOCK()           uint32_t perfPrimask = __get_PRIMASK(); __disable_irq()
+#define PERF_UNLOCK()         __set_PRIMASK(perfPrimask)
+#else
+#define PERF_LOCK()           do {} while(0)
+#define PERF_UNLOCK()         do {} while(0)
+#endif
+
+static perfProbeStats_t perfProbes[PERF_PROBE_MAX];
+
+static const char *perfProbeNames[PERF_PROBE_MAX] =
+{
+		"SysIRQ",
+		"TSIRQ",
+		"Decode",
+		"Display",
+		"FlashRd",
+		"SysDefer",
+		"TxIRQ"
+};
+
+void perfInit(void)
+{
+#if defined(__arm__)
+	// Free running cycle counter
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+	perfReset();
+}
+
+void perfRecord(perfProbe_t probe, uint32_t duration)
+{
+	perfProbeStats_t *stats = &perfProbes[probe];
+	uint32_t bucket = (31U - __builtin_clz(duration | 1U));
+
+	PERF_LOCK();
+
+	if ((stats->count == 0) || (duration < stats->min))
+	{
+		stats->min = duration;
+	}
+
+	if (duration > stats->max)
+	{
+		stats->max = duration;
+	}
+
+	stats->count++;
+	stats->total += duration;
+	stats->buckets[bucket]++;
+
+	PERF_UNLOCK();
+}
+
+// Consistent copy of a probe stats
+void perfGetStats(perfProbe_t probe, perfProbeStats_t *stats)
+{
+	PERF_LOCK();
+	memcpy(stats, &perfProbes[probe], sizeof(perfProbeStats_t));
+	PERF_UNLOCK();
+}
+
+const char *perfGetName(perfProbe_t probe)
+{
+	return perfProbeNames[probe];
+}
+
+uint32_t perfGetCounterFrequency(void)
+{
+#if defined(__arm__)
+	return SystemCoreClock;
+#else
+	return 1000000000U;
+#endif
+}
+
+void perfReset(void)
+{
+	PERF_LOCK();
+	memset(perfProbes, 0, sizeof(perfProbes));
+	PERF_UNLOCK();
+}
+
+#endif // USING_PERF
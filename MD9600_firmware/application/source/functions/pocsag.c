@@ -0,0 +1,336 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include <string.h>
+#include "main.h"
+#include "functions/pocsag.h"
+#include "hardware/radioHardwareInterface.h"
+
+//
+// POCSAG (ITU-R M.584) encoder and 2-FSK transmitter.
+//
+// Codewords are 21 data bits (flag + 20 bits payload), followed by BCH(31,21) parity and an even parity bit.
+// The BCH parity is computed a byte at a time using the remainder table below (generator x^10+x^9+x^8+x^6+x^5+x^3+1).
+//
+// The transmitter directly keys the synthesiser between its 2 precomputed FSK symbols (binary 1 is the low frequency),
+// from the TIM6 ISR, like the APRS bitstream sender does with its precomputed tones.
+// A 576 bits preamble is sent first, then the batches are streamed from the queue until it is empty.
+//
+#define POCSAG_MESSAGE_FLAG         (1U << 20)
+#define POCSAG_PAYLOAD_BITS                20U
+
+static const uint16_t BCH_TABLE[256] =
+{
+		0x000, 0x369, 0x1BB, 0x2D2, 0x376, 0x01F, 0x2CD, 0x1A4, 0x185, 0x2EC, 0x03E, 0x357,
+		0x2F3, 0x19A, 0x348, 0x021, 0x30A, 0x063, 0x2B1, 0x1D8, 0x07C, 0x315, 0x1C7, 0x2AE,
+		0x28F, 0x1E6, 0x334, 0x05D, 0x1F9, 0x290, 0x042, 0x32B, 0x17D, 0x214, 0x0C6, 0x3AF,
+		0x20B, 0x162, 0x3B0, 0x0D9, 0x0F8, 0x391, 0x143, 0x22A, 0x38E, 0x0E7, 0x235, 0x15C,
+		0x277, 0x11E, 0x3CC, 0x0A5, 0x101, 0x268, 0x0BA, 0x3D3, 0x3F2, 0x09B, 0x249, 0x120,
+		0x084, 0x3ED, 0x13F, 0x256, 0x2FA, 0x193, 0x341, 0x028, 0x18C, 0x2E5, 0x037, 0x35E,
+		0x37F, 0x016, 0x2C4, 0x1AD, 0x009, 0x360, 0x1B2, 0x2DB, 0x1F0, 0x299, 0x04B, 0x322,
+		0x286, 0x1EF, 0x33D, 0x054, 0x075, 0x31C, 0x1CE, 0x2A7, 0x303, 0x06A, 0x2B8, 0x1D1,
+		0x387, 0x0EE, 0x23C, 0x155, 0x0F1, 0x398, 0x14A, 0x223, 0x202, 0x16B, 0x3B9, 0x0D0,
+		0x174, 0x21D, 0x0CF, 0x3A6, 0x08D, 0x3E4, 0x136, 0x25F, 0x3FB, 0x092, 0x240, 0x129,
+		0x108, 0x261, 0x0B3, 0x3DA, 0x27E, 0x117, 0x3C5, 0x0AC, 0x29D, 0x1F4, 0x326, 0x04F,
+		0x1EB, 0x282, 0x050, 0x339, 0x318, 0x071, 0x2A3, 0x1CA, 0x06E, 0x307, 0x1D5, 0x2BC,
+		0x197, 0x2FE, 0x02C, 0x345, 0x2E1, 0x188, 0x35A, 0x033, 0x012, 0x37B, 0x1A9, 0x2C0,
+		0x364, 0x00D, 0x2DF, 0x1B6, 0x3E0, 0x089, 0x25B, 0x132, 0x096, 0x3FF, 0x12D, 0x244,
+		0x265, 0x10C, 0x3DE, 0x0B7, 0x113, 0x27A, 0x0A8, 0x3C1, 0x0EA, 0x383, 0x151, 0x238,
+		0x39C, 0x0F5, 0x227, 0x14E, 0x16F, 0x206, 0x0D4, 0x3BD, 0x219, 0x170, 0x3A2, 0x0CB,
+		0x067, 0x30E, 0x1DC, 0x2B5, 0x311, 0x078, 0x2AA, 0x1C3, 0x1E2, 0x28B, 0x059, 0x330,
+		0x294, 0x1FD, 0x32F, 0x046, 0x36D, 0x004, 0x2D6, 0x1BF, 0x01B, 0x372, 0x1A0, 0x2C9,
+		0x2E8, 0x181, 0x353, 0x03A, 0x19E, 0x2F7, 0x025, 0x34C, 0x11A, 0x273, 0x0A1, 0x3C8,
+		0x26C, 0x105, 0x3D7, 0x0BE, 0x09F, 0x3F6, 0x124, 0x24D, 0x3E9, 0x080, 0x252, 0x13B,
+		0x210, 0x179, 0x3AB, 0x0C2, 0x166, 0x20F, 0x0DD, 0x3B4, 0x395, 0x0FC, 0x22E, 0x147,
+		0x0E3, 0x38A, 0x158, 0x231
+};
+
+typedef struct
+{
+	uint32_t          queue[POCSAG_QUEUE_BATCHES][POCSAG_BATCH_WORDS];
+	volatile uint8_t  queueHead; // written by the main task
+	volatile uint8_t  queueTail; // written by the TX ISR
+	radioFSKConfig_t  fsk;
+	uint16_t          preambleBits;
+	uint8_t           wordPos;
+	uint8_t           bitPos;
+	uint32_t          word;
+	int8_t            lastBit;
+} pocsagData_t;
+
+static pocsagData_t pocsag;
+
+volatile pocsagTxProgress_t pocsagTxProgress = POCSAG_TX_IDLE; // used in the ISR
+
+
+uint32_t pocsagEncodeCodeword(uint32_t data)
+{
+	uint32_t codeword;
+	uint16_t remainder = 0;
+	const uint8_t bytes[3] = { ((data >> 16) & 0x1F), ((data >> 8) & 0xFF), (data & 0xFF) }; // leading zeros don't change the remainder
+
+	for (int i = 0; i < 3; i++)
+	{
+		remainder = ((remainder << 8) & 0x3FF) ^ BCH_TABLE[((remainder >> 2) ^ bytes[i]) & 0xFF];
+	}
+
+	codeword = ((data & 0x1FFFFF) << 11) | (remainder << 1);
+
+	return (codeword | (__builtin_popcount(codeword) & 0x01));
+}
+
+bool pocsagCodewordIsValid(uint32_t codeword)
+{
+	return (pocsagEncodeCodeword(codeword >> 11) == codeword);
+}
+
+static uint8_t pocsagNumericValue(char c)
+{
+	if ((c >= '0') && (c <= '9'))
+	{
+		return (c - '0');
+	}
+
+	switch (c)
+	{
+		case 'U':
+			return 0x0B;
+		case ' ':
+			return 0x0C;
+		case '-':
+			return 0x0D;
+		case ']':
+			return 0x0E;
+		case '[':
+			return 0x0F;
+		default:
+			return 0x0A; // spare
+	}
+}
+
+// Stores the message codeword in the next free position, skipping the sync codewords
+static bool pocsagStoreMessageCodeword(uint32_t *batches, uint32_t *pos, uint32_t total, uint32_t payload)
+{
+	if ((*pos % POCSAG_BATCH_WORDS) == 0)
+	{
+		(*pos)++;
+	}
+
+	if (*pos >= total)
+	{
+		return false;
+	}
+
+	batches[(*pos)++] = pocsagEncodeCodeword(POCSAG_MESSAGE_FLAG | payload);
+
+	return true;
+}
+
+// Encodes a page into batches of POCSAG_BATCH_WORDS codewords (sync codeword included), unused codewords are idle ones.
+// Numeric messages are sent as BCD digits, alphanumeric ones as 7 bits ASCII, both LSB first.
+// Returns the number of used batches, or 0 if the message doesn't fit in maxBatches.
+uint8_t pocsagEncodeMessage(uint32_t ric, pocsagFunction_t function, const char *message, uint32_t *batches, uint8_t maxBatches)
+{
+	uint32_t total = (maxBatches * POCSAG_BATCH_WORDS);
+	uint32_t pos = 1 + ((ric & 0x07) * 2); // the address goes in the frame given by the 3 lower bits of the RIC
+	uint32_t payload = 0;
+	uint8_t payloadBits = 0;
+	bool isNumeric = (function == POCSAG_FUNCTION_NUMERIC);
+
+	if ((maxBatches == 0) || (ric > 0x1FFFFF))
+	{
+		return 0;
+	}
+
+	for (uint32_t i = 0; i < total; i++)
+	{
+		batches[i] = (((i % POCSAG_BATCH_WORDS) == 0) ? POCSAG_SYNC_CODEWORD : POCSAG_IDLE_CODEWORD);
+	}
+
+	batches[pos++] = pocsagEncodeCodeword(((ric >> 3) << 2) | (function & 0x03));
+
+	if ((message != NULL) && (isNumeric || (function == POCSAG_FUNCTION_ALPHANUMERIC)))
+	{
+		size_t len = strlen(message);
+
+		for (size_t i = 0; (i < len) || (isNumeric && (payloadBits != 0)); i++)
+		{
+			// Numeric messages are padded with spaces
+			uint8_t value = ((i < len) ? (isNumeric ? pocsagNumericValue(message[i]) : (message[i] & 0x7F)) : 0x0C);
+			uint8_t nbits = (isNumeric ? 4 : 7);
+
+			for (uint8_t b = 0; b < nbits; b++)
+			{
+				payload = (payload << 1) | ((value >> b) & 0x01);
+
+				if (++payloadBits == POCSAG_PAYLOAD_BITS)
+				{
+					if (pocsagStoreMessageCodeword(batches, &pos, total, payload) == false)
+					{
+						return 0;
+					}
+
+					payload = 0;
+					payloadBits = 0;
+				}
+			}
+		}
+
+		if (payloadBits != 0)
+		{
+			if (pocsagStoreMessageCodeword(batches, &pos, total, (payload << (POCSAG_PAYLOAD_BITS - payloadBits))) == false)
+			{
+				return 0;
+			}
+		}
+	}
+
+	return (((pos - 1) / POCSAG_BATCH_WORDS) + 1);
+}
+
+void pocsagInit(void)
+{
+	memset(&pocsag, 0, sizeof(pocsagData_t));
+	pocsagTxProgress = POCSAG_TX_IDLE;
+}
+
+// Returns false if the queue is full
+bool pocsagQueueBatch(const uint32_t *codewords)
+{
+	uint8_t next = ((pocsag.queueHead + 1) & (POCSAG_QUEUE_BATCHES - 1));
+
+	if (next == pocsag.queueTail)
+	{
+		return false;
+	}
+
+	memcpy(pocsag.queue[pocsag.queueHead], codewords, (POCSAG_BATCH_WORDS * sizeof(uint32_t)));
+	pocsag.queueHead = next;
+
+	return true;
+}
+
+// In batches
+uint8_t pocsagGetQueueSpace(void)
+{
+	return ((POCSAG_QUEUE_BATCHES - 1) - ((pocsag.queueHead - pocsag.queueTail) & (POCSAG_QUEUE_BATCHES - 1)));
+}
+
+// The transmitter has to be already keyed on freq
+bool pocsagTxStart(uint32_t freq, uint16_t baudRate)
+{
+	if (radioFSKPrepare(freq, POCSAG_DEVIATION, &pocsag.fsk) == false)
+	{
+		return false;
+	}
+
+	pocsag.preambleBits = POCSAG_PREAMBLE_BITS;
+	pocsag.wordPos = 0;
+	pocsag.bitPos = 0;
+	pocsag.lastBit = -1;
+
+	htim6.Instance = TIM6;
+	htim6.Init.Prescaler = ((baudRate == POCSAG_BAUDRATE_512) ? 4 : 1); // 4 gives 512 baud (with 14062 period). 1 gives 1200 baud
+	htim6.Init.CounterMode = TIM_COUNTERMODE_UP;
+	htim6.Init.Period = ((baudRate == POCSAG_BAUDRATE_512) ? 14062 : 15000);
+	htim6.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+	if (HAL_TIM_Base_Init(&htim6) != HAL_OK)
+	{
+		Error_Handler();
+	}
+
+	TIM_MasterConfigTypeDef sMasterConfig = { 0 };
+	sMasterConfig.MasterOutputTrigger = TIM_TRGO_RESET;
+	sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+	if (HAL_TIMEx_MasterConfigSynchronization(&htim6, &sMasterConfig) != HAL_OK)
+	{
+		Error_Handler();
+	}
+
+	pocsagTxProgress = POCSAG_TX_IN_PROGRESS;
+	HAL_TIM_Base_Start_IT(&htim6);
+
+	return true;
+}
+
+// Stops the transmission (if any), remaining batches are kept in the queue
+void pocsagTxStop(void)
+{
+	if (pocsagTxProgress == POCSAG_TX_IN_PROGRESS)
+	{
+		HAL_TIM_Base_Stop_IT(&htim6);
+	}
+
+	pocsagTxProgress = POCSAG_TX_IDLE;
+}
+
+void pocsagBitStreamSender(void)
+{
+	bool bit;
+
+	if (pocsagTxProgress != POCSAG_TX_IN_PROGRESS)
+	{
+		return;
+	}
+
+	if (pocsag.preambleBits > 0)
+	{
+		bit = ((pocsag.preambleBits & 0x01) == 0); // 1010...
+		pocsag.preambleBits--;
+	}
+	else
+	{
+		if (pocsag.bitPos == 0)
+		{
+			if (pocsag.wordPos == POCSAG_BATCH_WORDS)
+			{
+				pocsag.queueTail = ((pocsag.queueTail + 1) & (POCSAG_QUEUE_BATCHES - 1));
+				pocsag.wordPos = 0;
+			}
+
+			if (pocsag.queueTail == pocsag.queueHead)
+			{
+				// just stop the ISR and flag that the data has been sent.
+				HAL_TIM_Base_Stop_IT(&htim6);
+				pocsagTxProgress = POCSAG_TX_FINISHED;
+				return;
+			}
+
+			pocsag.word = pocsag.queue[pocsag.queueTail][pocsag.wordPos++];
+			pocsag.bitPos = 32;
+		}
+
+		bit = ((pocsag.word & 0x80000000) != 0);
+		pocsag.word <<= 1;
+		pocsag.bitPos--;
+	}
+
+	if (bit != pocsag.lastBit)
+	{
+		radioFSKSetSymbol(&pocsag.fsk, (bit == false));
+		pocsag.lastBit = bit;
+	}
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include <FreeRTOS.h>
+#include <task.h>
+#include "functions/scheduler.h"
+#include "functions/ticks.h"
+
+//
+// Main task scheduling.
+//
+// Instead of spinning until the next ms, the main task blocks on its task notification until the earliest
+// deadline of its clients, or until an ISR/driver posts an event. The deadline handling only depends on the
+// time passed by the caller, so it can be driven by a virtual clock.
+//
+typedef struct
+{
+	TaskHandle_t      task;
+	volatile uint32_t events;
+	uint32_t          deadlines[SCHEDULER_CLIENT_MAX];
+	uint32_t          armed; // clients with a deadline, bit field
+} schedulerData_t;
+
+static schedulerData_t scheduler;
+
+// Called from the main task
+void schedulerInit(void)
+{
+	scheduler.events = 0;
+	scheduler.armed = 0;
+	scheduler.task = xTaskGetCurrentTaskHandle();
+}
+
+void schedulerSetDeadline(schedulerClient_t client, uint32_t time)
+{
+	scheduler.deadlines[client] = time;
+	scheduler.armed |= (1U << client);
+}
+
+void schedulerClearDeadline(schedulerClient_t client)
+{
+	scheduler.armed &= ~(1U << client);
+}
+
+bool schedulerIsDue(schedulerClient_t client, uint32_t now)
+{
+	return ((scheduler.armed & (1U << client)) && ((int32_t)(scheduler.deadlines[client] - now) <= 0));
+}
+
+bool schedulerIsAnyDue(uint32_t now)
+{
+	return (schedulerGetTimeout(now) == 0);
+}
+
+// Time to wait until the earliest deadline, in ms (0 if one is already due)
+uint32_t schedulerGetTimeout(uint32_t now)
+{
+	uint32_t timeout = SCHEDULER_WAIT_MAX;
+
+	for (uint32_t client = 0; client < SCHEDULER_CLIENT_MAX; client++)
+	{
+		if (scheduler.armed & (1U << client))
+		{
+			int32_t remaining = (int32_t)(scheduler.deadlines[client] - now);
+
+			if (remaining <= 0)
+			{
+				return 0;
+			}
+
+			if ((uint32_t)remaining < timeout)
+			{
+				timeout = remaining;
+			}
+		}
+	}
+
+	return timeout;
+}
+
+void schedulerPostEvent(uint32_t events)
+{
+	taskENTER_CRITICAL();
+	scheduler.events |= events;
+	taskEXIT_CRITICAL();
+
+	if (scheduler.task != NULL)
+	{
+		xTaskNotifyGive(scheduler.task);
+	}
+}
+
+void schedulerPostEventFromISR(uint32_t events)
+{
+	UBaseType_t savedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+	scheduler.events |= events;
+	taskEXIT_CRITICAL_FROM_ISR(savedInterruptStatus);
+
+	if (scheduler.task != NULL)
+	{
+		BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+		vTaskNotifyGiveFromISR(scheduler.task, &higherPriorityTaskWoken);
+		portYIELD_FROM_ISR(higherPriorityTaskWoken);
+	}
+}
+
+// Blocks until an event is posted or the earliest deadline is reached, returns (and clears) the posted events.
+// A notification given after the events were collected only causes a spurious wake up.
+uint32_t schedulerWait(void)
+{
+	uint32_t timeout = schedulerGetTimeout(ticksGetMillis());
+	uint32_t events;
+
+	if ((timeout > 0) && (scheduler.events == 0))
+	{
+		ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout));
+	}
+
+	taskENTER_CRITICAL();
+	events = scheduler.events;
+	scheduler.events = 0;
+	taskEXIT_CRITICAL();
+
+	return events;
+}
@@ -33,6 +33,8 @@
 #include "functions/sound.h"
 #include "functions/voicePrompts.h"
 #include "functions/rxPowerSaving.h"
+#include "functions/trace.h"
+#include "functions/taskMemory.h"
 #include "interfaces/interrupts.h"
 
 
@@ -48,6 +50,8 @@ typedef union byteSwap16
 byteSwap16_t swapper;
 
 Task_t beepTask;
+static StaticTask_t beepTaskTCB;
+static TASK_STACK_CCM(beepTaskStack, (1000U / sizeof(StackType_t)));
 
 
 __attribute__((section(".data.$RAM2"))) union sharedDataBuffer audioAndHotspotDataBuffer;
@@ -232,13 +236,8 @@ void soundInitBeepTask(void)
 	sine_beep_duration = 0;
 	taskEXIT_CRITICAL();
 
-	xTaskCreate(soundBeepTaskFunction,           /* pointer to the task */
-			"beepTask",                          /* task name for kernel awareness debugging */
-			1000L / sizeof(portSTACK_TYPE),      /* task stack size */
-			NULL,                      			 /* optional task startup argument */
-			(UBaseType_t)osPriorityHigh,         /* initial priority */
-			&beepTask.Handle 					 /* optional task handle to create */
-	);
+	beepTask.Handle = taskMemoryCreate(soundBeepTaskFunction, "beepTask", beepTaskStack,
+			(sizeof(beepTaskStack) / sizeof(StackType_t)), &beepTaskTCB, (UBaseType_t)osPriorityHigh);
 
 	beepTask.Running = true;
 	beepTask.AliveCount = TASK_FLAGGED_ALIVE;
@@ -319,11 +318,9 @@ bool soundRefillData(uint32_t bufNum)
 					{
 						gain = 99;
 					}
-#if 0
-#if defined(USING_EXTERNAL_DEBUGGER)
-				SEGGER_RTT_printf(0, "%d\t%d\t%d\n",(int)dmrRxAGCrxPeakAverage, gain, I2S_DAC_GAIN_LOOPUP[gain]);
-#endif
-#endif
+
+					TRACE3(TRACE_EVENT_DMR_RX_AGC, (int)dmrRxAGCrxPeakAverage, gain, I2S_DAC_GAIN_LOOPUP[gain]);
+
 					if (lastDMRRxAGCGain != gain)
 					{
 						lastDMRRxAGCGain = gain;
@@ -389,6 +386,7 @@ void soundSendData(void)
 {
 	if (g_TX_SAI_in_use == false)
 	{
+		I2SMonitorStop();
 		g_TX_SAI_in_use = true;
 		radioSetAudioPath(false);
 		soundFillData();
@@ -402,12 +400,31 @@ bool soundReceiveData(void)
 	{
 		return false;
 	}
+	I2SMonitorStop();
     isSending = false;
     isReceiving = true;
 	soundStartDMA();
 	return true;
 }
 
+// Starts the I2S transfers only to capture the RX audio (used by the DTMF decoder), if the bus is idle.
+void soundMonitorStart(void)
+{
+	if ((g_TX_SAI_in_use == false) && (isMonitoring == false) && (HAL_I2S_GetState(&hi2s3) == HAL_I2S_STATE_READY))
+	{
+		memset(i2s_Tx_Buffer, 0x00, sizeof(i2s_Tx_Buffer));
+		isSending = false;
+		isReceiving = false;
+		isMonitoring = true;
+		soundStartDMA();
+	}
+}
+
+void soundMonitorStop(void)
+{
+	I2SMonitorStop();
+}
+
 void soundReceiveRefillData(uint32_t bufNum)
 {
 	if (wavbuffer_count <= (WAV_BUFFER_COUNT - 2))
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "main.h"
+#include "functions/taskMemory.h"
+
+//
+// All the tasks are created with xTaskCreateStatic(), their stacks and control blocks being sized at build time.
+//
+// The stacks are registered here, so cpuStats can report the size of each task stack next to its high-water mark
+// (TaskStatus_t only gives the stack base). The registrations happen at init, from a single task (or before the
+// scheduler starts), an entry being complete before the count includes it.
+//
+typedef struct
+{
+	const StackType_t *stack;
+	uint32_t           size;
+} taskMemoryStack_t;
+
+static taskMemoryStack_t taskMemoryStacks[TASK_MEMORY_STACKS_MAX];
+static volatile uint32_t taskMemoryStackCount = 0;
+
+// Kernel tasks memory, replacing the weak cmsis_os2.c definitions
+static StaticTask_t idleTaskTCB;
+static TASK_STACK_CCM(idleTaskStack, configMINIMAL_STACK_SIZE);
+static StaticTask_t timerTaskTCB;
+static TASK_STACK_CCM(timerTaskStack, configTIMER_TASK_STACK_DEPTH);
+
+
+void vApplicationGetIdleTaskMemory(StaticTask_t **ppxIdleTaskTCBBuffer, StackType_t **ppxIdleTaskStackBuffer, uint32_t *pulIdleTaskStackSize)
+{
+	*ppxIdleTaskTCBBuffer = &idleTaskTCB;
+	*ppxIdleTaskStackBuffer = idleTaskStack;
+	*pulIdleTaskStackSize = (sizeof(idleTaskStack) / sizeof(StackType_t));
+
+	taskMemoryRegister(idleTaskStack, *pulIdleTaskStackSize);
+}
+
+void vApplicationGetTimerTaskMemory(StaticTask_t **ppxTimerTaskTCBBuffer, StackType_t **ppxTimerTaskStackBuffer, uint32_t *pulTimerTaskStackSize)
+{
+	*ppxTimerTaskTCBBuffer = &timerTaskTCB;
+	*ppxTimerTaskStackBuffer = timerTaskStack;
+	*pulTimerTaskStackSize = (sizeof(timerTaskStack) / sizeof(StackType_t));
+
+	taskMemoryRegister(timerTaskStack, *pulTimerTaskStackSize);
+}
+
+TaskHandle_t taskMemoryCreate(TaskFunction_t function, const char *name, StackType_t *stack, uint32_t stackSize, StaticTask_t *tcb, UBaseType_t priority)
+{
+	TaskHandle_t handle = xTaskCreateStatic(function, name, stackSize, NULL, priority, stack, tcb);
+
+	configASSERT(handle != NULL);
+	taskMemoryRegister(stack, stackSize);
+
+	return handle;
+}
+
+void taskMemoryRegister(const StackType_t *stack, uint32_t stackSize)
+{
+	uint32_t count = taskMemoryStackCount;
+
+	if (count < TASK_MEMORY_STACKS_MAX)
+	{
+		taskMemoryStacks[count].stack = stack;
+		taskMemoryStacks[count].size = stackSize;
+		__DMB();
+		taskMemoryStackCount = (count + 1);
+	}
+}
+
+// Returns the size (in words) of the stack starting at this address, 0 when it's not a registered one.
+uint32_t taskMemoryGetStackSize(const StackType_t *stack)
+{
+	uint32_t count = taskMemoryStackCount;
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (taskMemoryStacks[i].stack == stack)
+		{
+			return taskMemoryStacks[i].size;
+		}
+	}
+
+	return 0;
+}
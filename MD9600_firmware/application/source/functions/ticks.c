@@ -36,15 +36,33 @@
 extern volatile uint32_t PITCounter; // 1ms granularity
 #endif
 
+//
+// Timer callbacks, kept in a binary min-heap ordered by expiry time (ties are ordered by insertion, as before),
+// so adding, cancelling and expiring a callback are O(log n). The heap holds indexes into a fixed pool of slots,
+// and a handle is the slot index along with the slot generation, so a stale handle can't cancel a reused slot.
+//
 typedef struct
 {
 	timerCallback_t  funPtr;
 	int              menuDestination;
-	ticksTimer_t     PIT_TriggerTimer;
-} timerCallbackbackStruct_t;
+	uint32_t         expiry;
+	uint32_t         sequence; // insertion order
+	uint16_t         generation;
+	uint16_t         heapIndex;
+} timerCallbackSlot_t;
 
-#define MAX_NUM_TIMER_CALLBACKS 8
-static timerCallbackbackStruct_t callbacksArray[MAX_NUM_TIMER_CALLBACKS];// As a global this will get cleared by the compiler
+typedef struct
+{
+	timerCallbackSlot_t slots[TICKS_CALLBACKS_MAX];
+	uint16_t            heap[TICKS_CALLBACKS_MAX]; // slot indexes
+	uint16_t            freeSlots[TICKS_CALLBACKS_MAX];
+	uint32_t            count;
+	uint32_t            freeCount;
+	uint32_t            sequence;
+	bool                initialised;
+} timerCallbacksData_t;
+
+static timerCallbacksData_t timerCallbacks;// As a global this will get cleared by the compiler
 
 inline uint32_t ticksGetMillis(void)
 {
@@ -55,97 +73,241 @@ inline uint32_t ticksGetMillis(void)
 #endif
 }
 
-void handleTimerCallbacks(void)
+static void timerCallbacksInit(void)
+{
+	for (uint32_t i = 0; i < TICKS_CALLBACKS_MAX; i++)
+	{
+		timerCallbacks.freeSlots[i] = ((TICKS_CALLBACKS_MAX - 1) - i);
+		timerCallbacks.slots[i].generation = 1;
+	}
+
+	timerCallbacks.freeCount = TICKS_CALLBACKS_MAX;
+	timerCallbacks.initialised = true;
+}
+
+static inline bool timerCallbacksIsBefore(uint16_t slotA, uint16_t slotB)
 {
-	int i = 0;
+	timerCallbackSlot_t *a = &timerCallbacks.slots[slotA];
+	timerCallbackSlot_t *b = &timerCallbacks.slots[slotB];
+	int32_t diff = (int32_t)(a->expiry - b->expiry);
 
-	while((callbacksArray[i].funPtr != NULL) && (i < MAX_NUM_TIMER_CALLBACKS))
+	return ((diff < 0) || ((diff == 0) && ((int32_t)(a->sequence - b->sequence) < 0)));
+}
+
+static inline void timerCallbacksHeapSet(uint32_t index, uint16_t slot)
+{
+	timerCallbacks.heap[index] = slot;
+	timerCallbacks.slots[slot].heapIndex = index;
+}
+
+static void timerCallbacksSiftUp(uint32_t index)
+{
+	uint16_t slot = timerCallbacks.heap[index];
+
+	while (index > 0)
 	{
-		timerCallback_t cbFunction = NULL;
+		uint32_t parent = ((index - 1) >> 1);
+
+		if (timerCallbacksIsBefore(slot, timerCallbacks.heap[parent]) == false)
+		{
+			break;
+		}
+
+		timerCallbacksHeapSet(index, timerCallbacks.heap[parent]);
+		index = parent;
+	}
+
+	timerCallbacksHeapSet(index, slot);
+}
+
+static void timerCallbacksSiftDown(uint32_t index)
+{
+	uint16_t slot = timerCallbacks.heap[index];
+
+	while (true)
+	{
+		uint32_t child = ((index << 1) + 1);
+
+		if (child >= timerCallbacks.count)
+		{
+			break;
+		}
+
+		if (((child + 1) < timerCallbacks.count) && timerCallbacksIsBefore(timerCallbacks.heap[child + 1], timerCallbacks.heap[child]))
+		{
+			child++;
+		}
+
+		if (timerCallbacksIsBefore(timerCallbacks.heap[child], slot) == false)
+		{
+			break;
+		}
+
+		timerCallbacksHeapSet(index, timerCallbacks.heap[child]);
+		index = child;
+	}
+
+	timerCallbacksHeapSet(index, slot);
+}
+
+static void timerCallbacksRemove(uint16_t slot)
+{
+	uint32_t index = timerCallbacks.slots[slot].heapIndex;
+
+	timerCallbacks.count--;
+
+	if (index != timerCallbacks.count)
+	{
+		// Move the last element into the hole, then restore the heap order in whichever direction is needed
+		uint16_t moved = timerCallbacks.heap[timerCallbacks.count];
+
+		timerCallbacksHeapSet(index, moved);
+		timerCallbacksSiftDown(index);
+		timerCallbacksSiftUp(timerCallbacks.slots[moved].heapIndex);
+	}
+
+	timerCallbacks.slots[slot].funPtr = NULL;
+	timerCallbacks.slots[slot].generation++;
+	if (timerCallbacks.slots[slot].generation == 0)
+	{
+		timerCallbacks.slots[slot].generation = 1;
+	}
+	timerCallbacks.freeSlots[timerCallbacks.freeCount++] = slot;
+}
 
-		if (ticksTimerHasExpired(&callbacksArray[i].PIT_TriggerTimer))
+static void timerCallbacksReschedule(uint16_t slot, uint32_t delay)
+{
+	timerCallbacks.slots[slot].expiry = (ticksGetMillis() + delay);
+	timerCallbacks.slots[slot].sequence = timerCallbacks.sequence++;
+	timerCallbacksSiftDown(timerCallbacks.slots[slot].heapIndex);
+	timerCallbacksSiftUp(timerCallbacks.slots[slot].heapIndex);
+}
+
+static int timerCallbacksFind(timerCallback_t funPtr)
+{
+	for (uint32_t i = 0; i < timerCallbacks.count; i++)
+	{
+		if (timerCallbacks.slots[timerCallbacks.heap[i]].funPtr == funPtr)
 		{
-			// Does the current menu matches the desired destination menu
-			if ((callbacksArray[i].menuDestination == MENU_ANY) || (callbacksArray[i].menuDestination == menuSystemGetCurrentMenuNumber()))
-			{
-				// Postpone the call to callback function, as it could add/delete/update a TimerCallback in its code.
-				cbFunction = callbacksArray[i].funPtr;
-			}
-
-			if (i != (MAX_NUM_TIMER_CALLBACKS - 1))
-			{
-				memmove(&callbacksArray[i], &callbacksArray[i + 1], ((MAX_NUM_TIMER_CALLBACKS - 1) - i) * sizeof(timerCallbackbackStruct_t));
-			}
-
-			callbacksArray[MAX_NUM_TIMER_CALLBACKS - 1].funPtr = NULL;
+			return timerCallbacks.heap[i];
 		}
-		else
+	}
+
+	return -1;
+}
+
+void handleTimerCallbacks(void)
+{
+	uint32_t now = ticksGetMillis();
+
+	while ((timerCallbacks.count > 0) && ((int32_t)(timerCallbacks.slots[timerCallbacks.heap[0]].expiry - now) <= 0))
+	{
+		uint16_t slot = timerCallbacks.heap[0];
+		timerCallback_t cbFunction = NULL;
+
+		// Does the current menu matches the desired destination menu
+		if ((timerCallbacks.slots[slot].menuDestination == MENU_ANY) || (timerCallbacks.slots[slot].menuDestination == menuSystemGetCurrentMenuNumber()))
 		{
-			i++;
+			cbFunction = timerCallbacks.slots[slot].funPtr;
 		}
 
+		// Removed before the call, as the callback could add/delete/update a TimerCallback in its code.
+		timerCallbacksRemove(slot);
+
 		if (cbFunction != NULL)
 		{
 			cbFunction();
-			i = 0; // Restart from the beginning of the array
 		}
 	}
 }
 
-bool addTimerCallback(timerCallback_t funPtr, uint32_t delayIn_mS, int menuDest, bool updateExistingCallbackTime)
+ticksCallbackHandle_t ticksCallbackAdd(timerCallback_t funPtr, uint32_t delayIn_mS, int menuDest)
 {
-	uint32_t callBackTime =
+	if (timerCallbacks.initialised == false)
+	{
+		timerCallbacksInit();
+	}
+
+	if (timerCallbacks.freeCount == 0)
+	{
+		return TICKS_CALLBACK_INVALID_HANDLE;
+	}
+
+	uint16_t slot = timerCallbacks.freeSlots[--timerCallbacks.freeCount];
+
+	timerCallbacks.slots[slot].funPtr = funPtr;
+	timerCallbacks.slots[slot].menuDestination = menuDest;
+	timerCallbacks.slots[slot].expiry = (ticksGetMillis() +
 #if defined(PLATFORM_MD9600)
-			delayIn_mS;
+			delayIn_mS);
 #else
-			(delayIn_mS * PIT_COUNTS_PER_MS);
+			(delayIn_mS * PIT_COUNTS_PER_MS));
 #endif
+	timerCallbacks.slots[slot].sequence = timerCallbacks.sequence++;
+	timerCallbacksHeapSet(timerCallbacks.count, slot);
+	timerCallbacks.count++;
+	timerCallbacksSiftUp(timerCallbacks.count - 1);
 
-	for(int i = 0; i < MAX_NUM_TIMER_CALLBACKS; i++)
+	return (((ticksCallbackHandle_t)timerCallbacks.slots[slot].generation << 16) | slot);
+}
+
+bool ticksCallbackCancel(ticksCallbackHandle_t handle)
+{
+	uint32_t slot = (handle & 0xFFFF);
+
+	if ((slot < TICKS_CALLBACKS_MAX) && (timerCallbacks.slots[slot].funPtr != NULL) &&
+			(timerCallbacks.slots[slot].generation == (handle >> 16)))
 	{
-		if (callbacksArray[i].funPtr == NULL)
-		{
-			callbacksArray[i].funPtr = funPtr;
-			callbacksArray[i].menuDestination = menuDest;
-			ticksTimerStart(&callbacksArray[i].PIT_TriggerTimer, callBackTime);
-			return true;
-		}
+		timerCallbacksRemove(slot);
+		return true;
+	}
 
-		if ((callbacksArray[i].funPtr == funPtr) && updateExistingCallbackTime)
-		{
-			callbacksArray[i].menuDestination = menuDest;
-			ticksTimerStart(&callbacksArray[i].PIT_TriggerTimer, callBackTime);
-			return true;
-		}
+	return false;
+}
+
+// Expiry time of the next callback, for the scheduling of the caller of handleTimerCallbacks()
+bool ticksCallbackGetNextExpiry(uint32_t *expiry)
+{
+	if (timerCallbacks.count == 0)
+	{
+		return false;
+	}
+
+	*expiry = timerCallbacks.slots[timerCallbacks.heap[0]].expiry;
+	return true;
+}
+
+bool addTimerCallback(timerCallback_t funPtr, uint32_t delayIn_mS, int menuDest, bool updateExistingCallbackTime)
+{
+	if (updateExistingCallbackTime)
+	{
+		int slot = timerCallbacksFind(funPtr);
 
-		// callbacksArray[i] must be non-null pointer
-		if (ticksTimerHasExpired(&callbacksArray[i].PIT_TriggerTimer))
+		if (slot >= 0)
 		{
-			if (i != (MAX_NUM_TIMER_CALLBACKS - 1))
-			{
-				// shuffle all other callbacks down in the list if there is space
-				memmove(&callbacksArray[i+1], &callbacksArray[i], ((MAX_NUM_TIMER_CALLBACKS - 1) - i) * sizeof(timerCallbackbackStruct_t));
-			}
-			callbacksArray[i].funPtr = funPtr;
-			callbacksArray[i].menuDestination = menuDest;
-			ticksTimerStart(&callbacksArray[i].PIT_TriggerTimer, callBackTime);
+			timerCallbacks.slots[slot].menuDestination = menuDest;
+			timerCallbacksReschedule(slot,
+#if defined(PLATFORM_MD9600)
+					delayIn_mS);
+#else
+					(delayIn_mS * PIT_COUNTS_PER_MS));
+#endif
 			return true;
 		}
 	}
-	return false;
+
+	return (ticksCallbackAdd(funPtr, delayIn_mS, menuDest) != TICKS_CALLBACK_INVALID_HANDLE);
 }
 
 bool cancelTimerCallback(timerCallback_t funPtr, int menuDest)
 {
-	for(int i = 0; i < MAX_NUM_TIMER_CALLBACKS; i++)
+	for (uint32_t i = 0; i < timerCallbacks.count; i++)
 	{
-		if ((callbacksArray[i].funPtr == funPtr) && (callbacksArray[i].menuDestination == menuDest))
+		uint16_t slot = timerCallbacks.heap[i];
+
+		if ((timerCallbacks.slots[slot].funPtr == funPtr) && (timerCallbacks.slots[slot].menuDestination == menuDest))
 		{
-			if (i != (MAX_NUM_TIMER_CALLBACKS - 1))
-			{
-				memmove(&callbacksArray[i], &callbacksArray[i + 1], ((MAX_NUM_TIMER_CALLBACKS - 1) - i) * sizeof(timerCallbackbackStruct_t));
-			}
-			callbacksArray[MAX_NUM_TIMER_CALLBACKS - 1].funPtr = NULL;
+			timerCallbacksRemove(slot);
 			return true;
 		}
 	}
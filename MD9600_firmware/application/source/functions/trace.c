@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include <string.h>
+#include "main.h"
+#include "functions/trace.h"
+#include "functions/cpuStats.h"
+#if defined(USING_EXTERNAL_DEBUGGER)
+#include "SeggerRTT/RTT/SEGGER_RTT.h"
+#endif
+
+#if defined(USING_TRACE)
+
+//
+// Binary trace ring.
+//
+// Tracing an event only costs a timestamp read, a slot reservation and a few stores: there is no formatting
+// and no I/O at the call site, so it can be used in the ISRs. The records are drained in the idle time, to
+// the RTT channel TRACE_RTT_CHANNEL when an external debugger is used, otherwise by the CPS 'T' command,
+// and decoded on the host by tools/trace/decode_trace.py.
+// The records are timestamped with the run time counter (1 us), not the DWT cycle counter which stops while the
+// idle task sleeps in WFI: the intervals spanning some idle time, like the DMR slot edges ones, would be too short.
+//
+#define TRACE_RTT_CHANNEL          1U
+#define TRACE_DRAIN_BATCH          8U
+
+typedef struct
+{
+	traceRecord_t     ring[TRACE_RING_SIZE];
+	volatile uint32_t head; // next record to reserve, shared by all the writers
+	volatile uint32_t tail; // next record to read, only written by the reader
+	volatile uint32_t dropped;
+	uint32_t          droppedReported;
+} traceData_t;
+
+static traceData_t trace;
+#if defined(USING_EXTERNAL_DEBUGGER)
+static uint8_t traceRTTBuffer[(TRACE_RING_SIZE / 2) * sizeof(traceRecord_t)];
+#endif
+
+void traceInit(void)
+{
+	memset(&trace, 0, sizeof(trace));
+
+#if defined(USING_EXTERNAL_DEBUGGER)
+	SEGGER_RTT_ConfigUpBuffer(TRACE_RTT_CHANNEL, "Trace", traceRTTBuffer, sizeof(traceRTTBuffer), SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+#endif
+}
+
+// Lock free, callable from any task or ISR: the slot is reserved with an exclusive access on the head,
+// then filled, its header being written last to publish it to the reader.
+void traceWrite(traceEvent_t event, uint32_t argCount, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3)
+{
+	uint32_t timestamp = cpuStatsGetRunTimeCounter();
+	uint32_t head;
+
+	do
+	{
+		head = __LDREXW(&trace.head);
+
+		if ((head - trace.tail) >= TRACE_RING_SIZE)
+		{
+			uint32_t dropped;
+
+			__CLREX();
+
+			do
+			{
+				dropped = __LDREXW(&trace.dropped);
+			} while (__STREXW((dropped + 1), &trace.dropped) != 0);
+
+			return;
+		}
+	} while (__STREXW((head + 1), &trace.head) != 0);
+
+	traceRecord_t *record = &trace.ring[head & (TRACE_RING_SIZE - 1)];
+
+	record->timestamp = timestamp;
+	record->args[0] = a0;
+	record->args[1] = a1;
+	record->args[2] = a2;
+	record->args[3] = a3;
+	__DMB();
+	record->header = (((uint32_t)event << 8) | argCount);
+}
+
+// Single reader. Stops at the first record which is still being written, and reports the
+// records lost since the previous call as a TRACE_EVENT_DROPPED record.
+uint32_t traceRead(traceRecord_t *records, uint32_t maxRecords)
+{
+	uint32_t count = 0;
+
+	while ((count < maxRecords) && (trace.tail != trace.head))
+	{
+		traceRecord_t *record = &trace.ring[trace.tail & (TRACE_RING_SIZE - 1)];
+
+		if (record->header == 0)
+		{
+			break;
+		}
+
+		__DMB();
+		memcpy(&records[count], record, sizeof(traceRecord_t));
+		record->header = 0;
+		__DMB();
+		trace.tail++;
+		count++;
+	}
+
+	uint32_t dropped = trace.dropped;
+
+	if ((dropped != trace.droppedReported) && (count < maxRecords))
+	{
+		records[count].header = (((uint32_t)TRACE_EVENT_DROPPED << 8) | 1);
+		records[count].timestamp = cpuStatsGetRunTimeCounter();
+		records[count].args[0] = (dropped - trace.droppedReported);
+		records[count].args[1] = 0;
+		records[count].args[2] = 0;
+		records[count].args[3] = 0;
+		trace.droppedReported = dropped;
+		count++;
+	}
+
+	return count;
+}
+
+// Called from the main loop, in its idle time.
+void traceDrain(void)
+{
+#if defined(USING_EXTERNAL_DEBUGGER)
+	traceRecord_t records[TRACE_DRAIN_BATCH];
+	uint32_t space = (SEGGER_RTT_GetAvailWriteSpace(TRACE_RTT_CHANNEL) / sizeof(traceRecord_t));
+	uint32_t count;
+
+	while ((space > 0) && ((count = traceRead(records, ((space > TRACE_DRAIN_BATCH) ? TRACE_DRAIN_BATCH : space))) > 0))
+	{
+		SEGGER_RTT_WriteSkipNoLock(TRACE_RTT_CHANNEL, records, (count * sizeof(traceRecord_t)));
+		space -= count;
+	}
+#endif
+}
+
+#endif // USING_TRACE
@@ -189,6 +189,7 @@ const int trxDTMFfreq2[] = {  941,  697,  697,  697,  770,  770,  770,  852,  85
 calibrationPowerValues_t trxPowerSettings;
 
 static bool powerUpDownState = true;
+static bool trxC6000CalibrationPending = false; // not sent, retried from trxReadRSSIAndNoise()
 
 static uint8_t trxAnalogFilterLevel = ANALOG_FILTER_CSS;
 
@@ -384,6 +385,11 @@ void trxPostponeReadRSSIAndNoise(uint32_t msOverride)
 // Check RSSI and Noise
 void trxReadRSSIAndNoise(bool force)
 {
+	if (trxC6000CalibrationPending)
+	{
+		trxUpdateC6000Calibration();
+	}
+
 	if (rxPowerSavingIsRxOn() && (ticksTimerHasExpired((ticksTimer_t *)&trxNextRssiNoiseSampleTimer) || force))
 	{
 		radioReadRSSIAndNoiseForBand(currentRadioDevice->trxCurrentBand[TRX_RX_FREQ_BAND]);
@@ -908,9 +914,14 @@ static void trxUpdateC6000Calibration(void)
 	if (currentRadioDeviceId == RADIO_DEVICE_PRIMARY)
 	{
 		int8_t cal = calibrationGetMod2Offset(currentRadioDevice->trxCurrentBand[trxTransmissionEnabled ? TRX_TX_FREQ_BAND : TRX_RX_FREQ_BAND]);
-		SPI0WritePageRegByte(0x04, 0x47, cal);			// Set the reference tuning offset
-		SPI0WritePageRegByte(0x04, 0x48, ((cal < 0) ? 0x03 : 0x00));
-		SPI0WritePageRegByte(0x04, 0x04, cal);									//Set MOD 2 Offset (Cal Value)
+		spi0Batch_t batch;
+
+		SPI0BatchInit(&batch);
+		// The shadow is only updated once sent, so a retry sends whatever is still missing
+		trxC6000CalibrationPending = ((SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x47, cal) != 0) ||			// Set the reference tuning offset
+				(SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x48, ((cal < 0) ? 0x03 : 0x00)) != 0) ||
+				(SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x04, cal) != 0) ||									//Set MOD 2 Offset (Cal Value)
+				(SPI0BatchCommit(&batch) != 0));
 	}
 }
 
@@ -1163,6 +1174,7 @@ bool trxPowerUpDownRxAndC6000(bool powerUp, bool includeC6000)
 
 			// Always power up the C6000 even if its may already be powered up, because VP was playing
 			HAL_GPIO_WritePin(C6000_PWD_GPIO_Port, C6000_PWD_Pin, GPIO_PIN_RESET); // Power Up the C6000
+			SPI0ShadowInvalidate();
 			// Allow some time to the C6000 to get ready
 			vTaskDelay((10 / portTICK_PERIOD_MS));
 
@@ -33,7 +33,14 @@
 #include "SeggerRTT/RTT/SEGGER_RTT.h"
 #endif
 #include "functions/trx.h"
+#include "functions/dmrDataDecoder.h"
 #include "functions/hotspot.h"
+#include "functions/hotspotJitter.h"
+#include "functions/hotspotTelemetry.h"
+#include "functions/trace.h"
+#include "functions/perf.h"
+#include "functions/irqQueue.h"
+#include "functions/taskMemory.h"
 #include "user_interface/uiUtilities.h"
 #include "functions/voicePrompts.h"
 #include "interfaces/gpio.h"
@@ -88,6 +95,23 @@
 
 Task_t hrc6000Task;
 
+// System interrupt snapshot, as queued by hrc6000SysInterruptCapture()
+enum
+{
+	SYS_IRQ_SNAPSHOT_REG_0x82 = 0,
+	SYS_IRQ_SNAPSHOT_REG_0x52,
+	SYS_IRQ_SNAPSHOT_FLAGS
+};
+#define SYS_IRQ_SNAPSHOT_REG_0x82_VALID   0x01
+#define SYS_IRQ_SNAPSHOT_REG_0x52_VALID   0x02
+
+static irqQueue_t sysIrqQueue;
+static TaskHandle_t hrc6000DeferredTaskHandle = NULL;
+static StaticTask_t hrc6000DeferredTaskTCB;
+static TASK_STACK_CCM(hrc6000DeferredTaskStack, (2048U / sizeof(StackType_t)));
+static StaticTask_t hrc6000TaskTCB;
+static TASK_STACK_CCM(hrc6000TaskStack, (5000U / sizeof(StackType_t)));
+
 static bool sendingDCS = false;
 
 static const uint8_t SILENCE_AUDIO[AMBE_AUDIO_LENGTH] = {
@@ -311,6 +335,7 @@ static inline void hrc6000TimeslotInterruptHandler(void);
 static inline void hrc6000TxInterruptHandler(void);
 #endif
 static inline void hrc6000RxInterruptHandler(void);
+static void hrc6000SysInterruptProcess(bool reg82Result, bool reg52Result, uint8_t reg0x52);
 static void hrc6000TransitionToTx(void);
 static void hrc6000InitDigitalState(void);
 static void hrc6000TriggerPrivateCallQSODataDisplay(void);
@@ -336,26 +361,58 @@ uint8_t getCurrentTATxFlag(void)
 	{
 		flag = TA_TX_OFF;
 	}
-#if defined(USING_EXTERNAL_DEBUGGER)
-	SEGGER_RTT_printf(0, "%02x\n",flag);
-#endif
+	TRACE1(TRACE_EVENT_TA_TX_FLAG, flag);
 
 	return flag;
 }
 
+// Traces the slot state transition made by the caller, if any (see tools/trace/tdma_timing.py)
+static inline void hrc6000TraceSlotState(int previousState)
+{
+#if defined(USING_TRACE)
+	if (slotState != previousState)
+	{
+		TRACE2(TRACE_EVENT_DMR_SLOT_STATE, previousState, slotState);
+	}
+#else
+	(void)previousState;
+#endif
+}
+
+// Task context only, waits for SPI0 to be released instead of dropping the batch
+static void hrc6000BatchCommitWait(spi0Batch_t *batch)
+{
+	while (SPI0BatchCommit(batch) != 0)
+	{
+		vTaskDelay((1 / portTICK_PERIOD_MS));
+	}
+}
+
 static void hrc6000WriteSPIRegister0x04Multi(const uint8_t values[][2], uint8_t length)
 {
+	spi0Batch_t batch;
+
+	SPI0BatchInit(&batch);
 	for(uint8_t i = 0; i < length; i++)
 	{
-		SPI0WritePageRegByte(0x04, values[i][0], values[i][1]);
+		if (SPI0BatchWritePageRegByte(&batch, 0x04, values[i][0], values[i][1]) != 0)
+		{
+			// The batch is full and could not be sent, send it now, the write can't fail on the emptied batch
+			hrc6000BatchCommitWait(&batch);
+			SPI0BatchWritePageRegByte(&batch, 0x04, values[i][0], values[i][1]);
+		}
 	}
+	hrc6000BatchCommitWait(&batch);
 }
 
 //Updated by G4EML to reflect the sequence used by the official TYT firmware on the MD-9600
 
 void HRC6000Init(void)
 {
+	spi0Batch_t batch;
+
 	hrc.inIRQHandler = false;
+	SPI0ShadowInvalidate();
 
 	// Wake up C6000
 	HAL_GPIO_WritePin(C6000_PWD_GPIO_Port, C6000_PWD_Pin, 0);
@@ -390,35 +447,39 @@ void HRC6000Init(void)
 	SPI0WritePageRegByteArray(0x01, 0x60, spi_init_values_6, 0x60);
 
 	//set a few more auxiliary config registers
-	SPI0WritePageRegByte(0x01, 0x52, 0x08);
-	SPI0WritePageRegByte(0x01, 0x53, 0xEB);
-	SPI0WritePageRegByte(0x01, 0x54, 0x78);
-	SPI0WritePageRegByte(0x01, 0x45, 0x1E);
-	SPI0WritePageRegByte(0x01, 0x37, 0x50);
-	SPI0WritePageRegByte(0x01, 0x35, 0xFF);
+	SPI0BatchInit(&batch);
+	SPI0BatchWritePageRegByte(&batch, 0x01, 0x52, 0x08);
+	SPI0BatchWritePageRegByte(&batch, 0x01, 0x53, 0xEB);
+	SPI0BatchWritePageRegByte(&batch, 0x01, 0x54, 0x78);
+	SPI0BatchWritePageRegByte(&batch, 0x01, 0x45, 0x1E);
+	SPI0BatchWritePageRegByte(&batch, 0x01, 0x37, 0x50);
+	SPI0BatchWritePageRegByte(&batch, 0x01, 0x35, 0xFF);
+	hrc6000BatchCommitWait(&batch);
 
 	//More Initialisation
 	hrc6000WriteSPIRegister0x04Multi(spiInitReg0x04MultiInit4, (sizeof(spiInitReg0x04MultiInit4) / sizeof(spiInitReg0x04MultiInit4[0])));
 
 	//set a few more auxiliary config registers
-	SPI0WritePageRegByte(0x01, 0x24, 0x00);
-	SPI0WritePageRegByte(0x01, 0x25, 0x00);
-	SPI0WritePageRegByte(0x01, 0x26, 0x00);
-	SPI0WritePageRegByte(0x01, 0x27, 0x00);
+	SPI0BatchWritePageRegByte(&batch, 0x01, 0x24, 0x00);
+	SPI0BatchWritePageRegByte(&batch, 0x01, 0x25, 0x00);
+	SPI0BatchWritePageRegByte(&batch, 0x01, 0x26, 0x00);
+	SPI0BatchWritePageRegByte(&batch, 0x01, 0x27, 0x00);
 
 	//initialise ready to receive
-	SPI0WritePageRegByte(0x04, 0x41, 0x40);   //Rx in next Slot
-	SPI0WritePageRegByte(0x04, 0x56, 0x00);	  //Unknown Register
-	SPI0WritePageRegByte(0x04, 0x5C, 0x09);	  //Unknown Register
-	SPI0WritePageRegByte(0x04, 0x5F, 0xF0);	  //Set Sync detect to MS, BS, TDMA1 and TDMA2
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0x41, 0x40);   //Rx in next Slot
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0x56, 0x00);	  //Unknown Register
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0x5C, 0x09);	  //Unknown Register
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0x5F, 0xF0);	  //Set Sync detect to MS, BS, TDMA1 and TDMA2
+	hrc6000BatchCommitWait(&batch);
 
 	//set the MS Synch pattern
 	SPI0WritePageRegByteArray(0x01, 0x04, MS_sync_pattern, 0x06);
 
 	//final init
-	SPI0WritePageRegByte(0x04, 0x11, 0x80);		//Set local chan mode
-	SPI0WritePageRegByte(0x04, 0x81, 0x19);		//Interrupt Masks
-	SPI0WritePageRegByte(0x04, 0x85, 0x00);		//Disable Interrupts
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0x11, 0x80);		//Set local chan mode
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0x81, 0x19);		//Interrupt Masks
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0x85, 0x00);		//Disable Interrupts
+	hrc6000BatchCommitWait(&batch);
 
 
 	HRC6000SetMicGainDMR(nonVolatileSettings.micGainDMR);
@@ -429,7 +490,7 @@ void HRC6000Init(void)
 
 void HRC6000SetMicGainDMR(uint8_t gain)
 {
-	SPI0WritePageRegByte(0x04, 0xE4, 0xE0 + gain);
+	SPI0WritePageRegByteIfChanged(0x04, 0xE4, 0xE0 + gain);
 }
 
 static inline bool hrc6000CrcIsValid(void)
@@ -647,6 +708,11 @@ static void hrc6000HandleLCData(void)
 	uint8_t LCBuf[LC_DATA_LENGTH];
 	bool lcResult = (SPI0ReadPageRegByteArray(0x02, 0x00, LCBuf, LC_DATA_LENGTH) == kStatus_Success); // read the LC from the C6000
 
+	if (lcResult)
+	{
+		TRACE4(TRACE_EVENT_DMR_LC_RECEIVED, LCBuf[0], hrc6000CrcIsValid(), ((LCBuf[3] << 16) | (LCBuf[4] << 8) | LCBuf[5]), ((LCBuf[6] << 16) | (LCBuf[7] << 8) | LCBuf[8]));
+	}
+
 	if (lcResult && hrc6000CrcIsValid() && hrc.ccHold && (hrc.tsAgreed > TS_STABLE_THRESHOLD))
 	{
 		bool lcSent = false;
@@ -951,6 +1017,8 @@ static inline void hrc6000SysReceivedDataInt(void)
 
 	rxSyncType = (reg_0x5F & 0x03); //received Sync Type
 
+	TRACE4(TRACE_EVENT_DMR_RX_DATA, rxSyncClass, rxDataType, hrc.rxCRCisValid, rxSyncType);
+
 	if (codeplugChannelGetFlag(currentChannelData, CHANNEL_FLAG_FORCE_DMO) == 0)
 	{
 		if (rxSyncType == BS_SYNC)       // if we are receiving from a base station (Repeater)
@@ -963,6 +1031,21 @@ static inline void hrc6000SysReceivedDataInt(void)
 		}
 	}
 
+#if defined(USING_DMR_DATA_DECODER)
+	// Data headers and blocks are handed over to the data decoder, which does its own FEC and CRC checks
+	if ((rxSyncClass == SYNC_CLASS_DATA) && (rxPrivacyIndicator == 0) && (settingsUsbMode != USB_MODE_HOTSPOT) && (hrc.transmissionEnabled == false) &&
+			((rxDataType == DMR_DATA_TYPE_DATA_HEADER) || (rxDataType == DMR_DATA_TYPE_RATE_12_DATA) || (rxDataType == DMR_DATA_TYPE_RATE_34_DATA)) &&
+			hrc6000CheckColourCodeFilter() && ((currentRadioDevice->trxDMRModeRx == DMR_MODE_DMO) || hrc6000CheckTimeSlotFilter()))
+	{
+		uint8_t dataBurst[DMR_DATA_DECODER_BURST_LENGTH];
+
+		if (SPI1ReadPageRegByteArray(0x03, 0x00, dataBurst, DMR_DATA_DECODER_BURST_LENGTH) == kStatus_Success)
+		{
+			dmrDataDecoderPushBurst(rxDataType, dataBurst);
+		}
+	}
+#endif
+
 	if (((slotState == DMR_STATE_RX_1) || (slotState == DMR_STATE_RX_2)) &&
 			((rxPrivacyIndicator != 0) || (hrc6000CrcIsValid() == false) || (hrc6000CheckColourCodeFilter() == false)))
 	{
@@ -1250,6 +1333,40 @@ void hrc6000SysInterruptHandler(void)
 	bool reg82Result = (SPI0ReadPageRegByte(0x04, 0x82, &reg_0x82) == kStatus_Success); // Read Interrupt Flag Register1
 	bool reg52Result = (SPI0ReadPageRegByte(0x04, 0x52, &reg0x52) == kStatus_Success);  // Read Received CC and CACH
 
+	TRACE2(TRACE_EVENT_HRC_SYS_IRQ, reg_0x82, reg0x52);
+
+	hrc6000SysInterruptProcess(reg82Result, reg52Result, reg0x52);
+}
+
+// Called from the EXTI ISR. Only the interrupt flags and the received CC/CACH are read here, as they belong
+// to the burst which triggered the interrupt, everything else is handled by hrc6000DeferredTaskFunction().
+void hrc6000SysInterruptCapture(void)
+{
+	irqQueueEntry_t entry;
+	uint8_t reg0x82 = 0;
+	uint8_t reg0x52 = 0;
+	BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+	entry.values[SYS_IRQ_SNAPSHOT_FLAGS] = (((SPI0ReadPageRegByte(0x04, 0x82, &reg0x82) == kStatus_Success) ? SYS_IRQ_SNAPSHOT_REG_0x82_VALID : 0) |
+			((SPI0ReadPageRegByte(0x04, 0x52, &reg0x52) == kStatus_Success) ? SYS_IRQ_SNAPSHOT_REG_0x52_VALID : 0));
+	entry.values[SYS_IRQ_SNAPSHOT_REG_0x82] = reg0x82;
+	entry.values[SYS_IRQ_SNAPSHOT_REG_0x52] = reg0x52;
+
+	TRACE2(TRACE_EVENT_HRC_SYS_IRQ, reg0x82, reg0x52);
+
+	if ((hrc6000DeferredTaskHandle == NULL) || (irqQueuePush(&sysIrqQueue, &entry) == false))
+	{
+		// Nobody to process it, at least release the interrupt line
+		SPI0WritePageRegByte(0x04, 0x83, reg0x82);
+		return;
+	}
+
+	vTaskNotifyGiveFromISR(hrc6000DeferredTaskHandle, &higherPriorityTaskWoken);
+	portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+static void hrc6000SysInterruptProcess(bool reg82Result, bool reg52Result, uint8_t reg0x52)
+{
 	if (reg52Result)
 	{
 		hrc.rxColorCode = (reg0x52 >> 4) & 0x0F;
@@ -1278,15 +1395,19 @@ void hrc6000SysInterruptHandler(void)
 						if (hrc.lastRxColorCodeCount % 2) // Slow down calling trxSetDMRColourCode() otherwise the FW will crash
 						{
 							trxSetDMRColourCode(hrc.rxColorCode);
-							SPI0WritePageRegByte(0x04, 0x40, 0xC3);  // Enable DMR Tx, DMR Rx, Passive Timing, Normal mode
+							spi0Batch_t batch;
+
+							SPI0BatchInit(&batch);
+							SPI0BatchWritePageRegByte(&batch, 0x04, 0x40, 0xC3);  // Enable DMR Tx, DMR Rx, Passive Timing, Normal mode
 
 							if (currentRadioDevice->trxDMRModeTx == DMR_MODE_RMO) // we need to do extra config while in RMO, otherwise the chip will get stuck on a wrong CC
 							{
-								SPI0WritePageRegByte(0x04, 0x41, 0x20);  // Set Sync Fail Bit (Reset?))
-								SPI0WritePageRegByte(0x04, 0x41, 0x00);  // Reset
-								SPI0WritePageRegByte(0x04, 0x41, 0x20);  // Set Sync Fail Bit (Reset?)
-								SPI0WritePageRegByte(0x04, 0x41, 0x50);  // Receive during next Timeslot
+								SPI0BatchWritePageRegByte(&batch, 0x04, 0x41, 0x20);  // Set Sync Fail Bit (Reset?))
+								SPI0BatchWritePageRegByte(&batch, 0x04, 0x41, 0x00);  // Reset
+								SPI0BatchWritePageRegByte(&batch, 0x04, 0x41, 0x20);  // Set Sync Fail Bit (Reset?)
+								SPI0BatchWritePageRegByte(&batch, 0x04, 0x41, 0x50);  // Receive during next Timeslot
 							}
+							SPI0BatchCommit(&batch);
 
 							// Give the HR-C6000 a bit of time.
 							uint32_t m = ticksGetMillis();
@@ -1428,8 +1549,21 @@ void hrc6000SysInterruptHandler(void)
 	SPI0WritePageRegByte(0x04, 0x83, reg_0x82);  // Clear all Interrupt flags set for this run
 }
 
+// Transmit during next timeslot, with the given data type, both written in one go
+static void hrc6000TransmitDuringNextTimeslot(uint8_t dataType)
+{
+	spi0Batch_t batch;
+
+	SPI0BatchInit(&batch);
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0x41, 0x80);
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0x50, dataType);
+	SPI0BatchCommit(&batch);
+}
+
 static void hrc6000TransitionToTx(void)
 {
+	spi0Batch_t batch;
+
 	disableAudioAmp(AUDIO_AMP_MODE_RF);
 	LedWrite(LED_GREEN, 0);
 
@@ -1438,9 +1572,11 @@ static void hrc6000TransitionToTx(void)
 		codecInit(false);
 	}
 
-	SPI0WritePageRegByte(0x04, 0x21, 0xA2); // Set Polite to Color Code and Reset vocoder encodingbuffer
-	SPI0WritePageRegByte(0x04, 0x22, 0x86); // Start Vocoder Encode, I2S mode
-	SPI0WritePageRegByte(0x04, 0x41, 0x00); // Do nothing on the next TS
+	SPI0BatchInit(&batch);
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0x21, 0xA2); // Set Polite to Color Code and Reset vocoder encodingbuffer
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0x22, 0x86); // Start Vocoder Encode, I2S mode
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0x41, 0x00); // Do nothing on the next TS
+	SPI0BatchCommit(&batch);
 
 	slotState = DMR_STATE_TX_START_1;
 	hrc.txSequence = 0;
@@ -1449,6 +1585,8 @@ static void hrc6000TransitionToTx(void)
 //used as a delayed callback to allow time for the final Tx burst and then simulate the final Rx Interrupt and return to receive.
 void hrc6000TxBurstCallback(void)
 {
+	TRACE1(TRACE_EVENT_DMR_TX_BURST_CALLBACK, slotState);
+
 	trxIsTransmittingDMR = false;
 
 	hrc6000SetInIRQHandler(true);
@@ -1458,6 +1596,8 @@ void hrc6000TxBurstCallback(void)
 
 void hrc6000TimeslotInterruptHandler(void)
 {
+	TRACE0(TRACE_EVENT_DMR_TS_EDGE);
+
 	//this check needs to be immediately at the start of the ISR to try to keep the Tx Burst length as close as possible to 30ms.
 	if((trxIsTransmittingDMR) && ( ticksGetMillis() - trxDMRstartTime > 20 ))				// The MD9600 doesn't have the hardware for the Rx Interrupt so we turn off the tx from here instead if it has been on for at least 20ms
 	{
@@ -1565,9 +1705,9 @@ void hrc6000TimeslotInterruptHandler(void)
 	}
 
 	// RX/TX state machine
-#if defined(USING_EXTERNAL_DEBUGGER) && defined(DEBUG_DMR)
-	SEGGER_RTT_printf(0, "state:%d\n",slotState);
-#endif
+	const int slotStateOnEntry = slotState;
+
+	TRACE2(TRACE_EVENT_HRC_TIMESLOT_IRQ, slotState, hrc.timeCode);
 
 	switch (slotState)
 	{
@@ -1689,8 +1829,7 @@ void hrc6000TimeslotInterruptHandler(void)
 		case DMR_STATE_TX_START_1: // Start TX (second step)
 			LedWrite(LED_RED, 1); // for repeater wakeup
 			hrc6000SendPcOrTgLCHeader();
-			SPI0WritePageRegByte(0x04, 0x41, 0x80);    // Transmit during next Timeslot
-			SPI0WritePageRegByte(0x04, 0x50, 0x10);    // Set Data Type to 0001 (Voice LC Header), Data, LCSS=00
+			hrc6000TransmitDuringNextTimeslot(0x10);    // Set Data Type to 0001 (Voice LC Header), Data, LCSS=00
 			trxIsTransmitting = true;
 			slotState = DMR_STATE_TX_START_2;
 			break;
@@ -1701,8 +1840,7 @@ void hrc6000TimeslotInterruptHandler(void)
 			break;
 
 		case DMR_STATE_TX_START_3: // Start TX (fourth step)
-			SPI0WritePageRegByte(0x04, 0x41, 0x80);     // Transmit during Next Timeslot
-			SPI0WritePageRegByte(0x04, 0x50, 0x10);     // Set Data Type to 0001 (Voice LC Header), Data, LCSS=00
+			hrc6000TransmitDuringNextTimeslot(0x10);     // Set Data Type to 0001 (Voice LC Header), Data, LCSS=00
 			slotState = DMR_STATE_TX_START_4;
 			break;
 
@@ -1720,8 +1858,7 @@ void hrc6000TimeslotInterruptHandler(void)
 			break;
 
 		case DMR_STATE_TX_START_5: // Start TX (sixth step)
-			SPI0WritePageRegByte(0x04, 0x41, 0x80);     // Transmit during next Timeslot
-			SPI0WritePageRegByte(0x04, 0x50, 0x10);     // Set Data Type to 0001 (Voice LC Header), Data, LCSS=00
+			hrc6000TransmitDuringNextTimeslot(0x10);     // Set Data Type to 0001 (Voice LC Header), Data, LCSS=00
 			hrc.TAPhase = 0;
 			slotState = DMR_STATE_TX_1;
 			break;
@@ -1756,6 +1893,11 @@ void hrc6000TimeslotInterruptHandler(void)
 					else
 					{
 						SPI1WritePageRegByteArray(0x03, 0x00, SILENCE_AUDIO, AMBE_AUDIO_LENGTH); // send the audio bytes to the hardware
+
+						if (hrc.hotspotPostponedFrameHandling == 0) // The network didn't deliver in time (or the stream has ended)
+						{
+							hotspotJitterSlotStarved();
+						}
 					}
 
 					if (hrc.hotspotPostponedFrameHandling > 0) // Send frames of silence until it's equal to zero
@@ -1793,8 +1935,7 @@ void hrc6000TimeslotInterruptHandler(void)
 			}
 
 			//write_SPI_page_reg_bytearray_SPI1(0x03, 0x00, (uint8_t*)(DMR_frame_buffer + LC_DATA_LENGTH), AMBE_AUDIO_LENGTH);// send the audio bytes to the hardware
-			SPI0WritePageRegByte(0x04, 0x41, 0x80);                      // Transmit during next Timeslot
-			SPI0WritePageRegByte(0x04, 0x50, 0x08 + (hrc.txSequence << 4)); // Data Type= sequence number 0 - 5 (Voice Frame A) , Voice, LCSS = 0
+			hrc6000TransmitDuringNextTimeslot(0x08 + (hrc.txSequence << 4)); // Data Type= sequence number 0 - 5 (Voice Frame A) , Voice, LCSS = 0
 
 			hrc.txSequence = ((hrc.txSequence + 1) % SUPERFRAME_NUM_FRAMES); // 0 .. 5
 
@@ -1807,8 +1948,7 @@ void hrc6000TimeslotInterruptHandler(void)
 				hrc6000SendPcOrTgLCHeader();
 			}
 			SPI1WritePageRegByteArray(0x03, 0x00, SILENCE_AUDIO, AMBE_AUDIO_LENGTH); // send silence audio bytes
-			SPI0WritePageRegByte(0x04, 0x41, 0x80);                   // Transmit during Next Timeslot
-			SPI0WritePageRegByte(0x04, 0x50, 0x20);                   // Data Type =0010 (Terminator with LC), Data, LCSS=0
+			hrc6000TransmitDuringNextTimeslot(0x20);                   // Data Type =0010 (Terminator with LC), Data, LCSS=0
 			slotState = DMR_STATE_TX_END_2;
 			break;
 
@@ -1946,6 +2086,8 @@ void hrc6000TimeslotInterruptHandler(void)
 			hrc.keepMonitorCapturedTSAfterTxing = false;
 		}
 	}
+
+	hrc6000TraceSlotState(slotStateOnEntry);
 }
 
 //the MD9600 does not have the hardware for the Rx Interrupt This handler is retained for compatibility and is called from the timeslot interrupt handler.
@@ -1953,6 +2095,7 @@ static inline void hrc6000RxInterruptHandler(void)
 {
 	if(trxIsTransmittingDMR)					//if we are currently sending DMR then just turn off the RF
 	{
+		TRACE1(TRACE_EVENT_DMR_TX_OFF, slotState);
 		trxFastDMRTx(false);
 	}
 	else
@@ -1964,6 +2107,8 @@ static inline void hrc6000RxInterruptHandler(void)
 
 void hrc6000TxInterruptHandler(void)
 {
+	TRACE1(TRACE_EVENT_HRC_TX_IRQ, slotState);
+
 	if(trxIsTransmittingDMR)
 	{
 		trxFastDMRTx(true);							//already transmitting so just use the fast Tx method.
@@ -2019,13 +2164,17 @@ void HRC6000InitInterrupts(void)
 
 void HRC6000InitDigitalDmrRx(void)
 {
+	spi0Batch_t batch;
+
 	HRC6000SetDMR();						 // ensure any registers changed by FM use are restored to DMR settings
 
-	SPI0WritePageRegByte(0x04, 0x40, 0xC3);  // Enable DMR Tx, DMR Rx, Passive Timing, Normal mode
-	SPI0WritePageRegByte(0x04, 0x41, 0x20);  // Set Sync Fail Bit (Reset?))
-	SPI0WritePageRegByte(0x04, 0x41, 0x00);  // Reset
-	SPI0WritePageRegByte(0x04, 0x41, 0x20);  // Set Sync Fail Bit (Reset?)
-	SPI0WritePageRegByte(0x04, 0x41, 0x50);  // Receive during next Timeslot
+	SPI0BatchInit(&batch);
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0x40, 0xC3);  // Enable DMR Tx, DMR Rx, Passive Timing, Normal mode
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0x41, 0x20);  // Set Sync Fail Bit (Reset?))
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0x41, 0x00);  // Reset
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0x41, 0x20);  // Set Sync Fail Bit (Reset?)
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0x41, 0x50);  // Receive during next Timeslot
+	SPI0BatchCommit(&batch);
 
 	hrc.hasEncodedAudio = false;
 	hrc.receivedFramesCount = -1;
@@ -2215,6 +2364,8 @@ static void hrc6000ManageCCHoldState(void)
 
 static void hrc6000Tick(void)
 {
+	const int slotStateOnEntry = slotState;
+
 	hrc6000ManageCCHoldState();
 
 	if (hrc.transmissionEnabled && (hrc.isWaking == WAKING_MODE_NONE))
@@ -2244,6 +2395,7 @@ static void hrc6000Tick(void)
 					hrc.hotspotPostponedFrameHandling = (HS_NUM_OF_SILENCE_SEQ_ON_STARTUP * 6);
 					// LC and Frame data will be uplodaded in hrc6000TimeslotInterruptHandler(), DMR_STATE_TX_2 case.
 					memcpy((uint8_t *)deferredUpdateBuffer, (uint8_t *)&audioAndHotspotDataBuffer.hotspotBuffer[wavbuffer_read_idx], AMBE_AUDIO_LENGTH + LC_DATA_LENGTH);
+					hotspotTelemetryFrameDone(HOTSPOT_TELEMETRY_STAMP_NET, wavbuffer_read_idx, ticksGetMillis());
 					// Note:
 					//       We don't increment the buffer indexes, because this is also the first frame of audio and we need
 					// it later, and LC data are needed for the silent frames
@@ -2506,7 +2658,10 @@ static void hrc6000Tick(void)
 					}
 					else
 					{
+						// Timed from here, as the inline assembly in codecDecode() doesn't preserve the scratch registers
+						PERF_BEGIN(PERF_PROBE_CODEC_DECODE);
 						codecDecode((uint8_t *)((hrc.hasAbnormalExit || hrc.insertSilenceFrame) ? SILENCE_AUDIO : (DMR_frame_buffer + LC_DATA_LENGTH)), 3);
+						PERF_END(PERF_PROBE_CODEC_DECODE);
 					}
 				}
 
@@ -2587,6 +2742,8 @@ static void hrc6000Tick(void)
 	}
 
 	hrc.rxCRCisValid = false;// Reset this
+
+	hrc6000TraceSlotState(slotStateOnEntry);
 }
 
 static void hrc6000TaskFunction(void *data)
@@ -2613,15 +2770,75 @@ static void hrc6000TaskFunction(void *data)
 	}
 }
 
+// Processes the system interrupts captured by hrc6000SysInterruptCapture(). It runs above all the other tasks,
+// with the other HR-C6000 interrupts masked, so it still can't be interleaved with them, as when it was
+// processed in the ISR, but the other interrupts (I2S, USB, UART) are not held off anymore.
+// As the ISR, it must not run inside the interruptsDisableC6000Interrupts() sections of the other tasks, some
+// of which sleep, so the queue is left pending until they end.
+static void hrc6000DeferredTaskFunction(void *data)
+{
+	irqQueueEntry_t entry;
+
+	while (1U)
+	{
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+		while (irqQueueIsEmpty(&sysIrqQueue) == false)
+		{
+			if (interruptsC6000InterruptsAreDisabled())
+			{
+				vTaskDelay((1 / portTICK_PERIOD_MS));
+				continue;
+			}
+
+			if (irqQueuePop(&sysIrqQueue, &entry) == false)
+			{
+				break;
+			}
+
+			PERF_BEGIN(PERF_PROBE_HRC_SYS_DEFERRED);
+
+			const bool timeslotIrqEnabled = (NVIC_GetEnableIRQ(EXTI0_IRQn) != 0U);
+			const bool txIrqEnabled = (NVIC_GetEnableIRQ(EXTI2_IRQn) != 0U);
+
+			HAL_NVIC_DisableIRQ(EXTI0_IRQn); // Timeslot
+			HAL_NVIC_DisableIRQ(EXTI2_IRQn); // Tx
+			hrc6000SetInIRQHandler(true);
+
+			const int slotStateOnEntry = slotState;
+
+			reg_0x82 = entry.values[SYS_IRQ_SNAPSHOT_REG_0x82];
+			hrc6000SysInterruptProcess(((entry.values[SYS_IRQ_SNAPSHOT_FLAGS] & SYS_IRQ_SNAPSHOT_REG_0x82_VALID) != 0),
+					((entry.values[SYS_IRQ_SNAPSHOT_FLAGS] & SYS_IRQ_SNAPSHOT_REG_0x52_VALID) != 0), entry.values[SYS_IRQ_SNAPSHOT_REG_0x52]);
+			hrc6000TraceSlotState(slotStateOnEntry);
+
+			hrc6000SetInIRQHandler(false);
+
+			// Only restore what was enabled, the main task may have masked them
+			if (txIrqEnabled)
+			{
+				HAL_NVIC_EnableIRQ(EXTI2_IRQn);
+			}
+
+			if (timeslotIrqEnabled)
+			{
+				HAL_NVIC_EnableIRQ(EXTI0_IRQn);
+			}
+
+			PERF_END(PERF_PROBE_HRC_SYS_DEFERRED);
+		}
+	}
+}
+
 void HRC6000InitTask(void)
 {
-	xTaskCreate(hrc6000TaskFunction,            /* pointer to the task */
-			"hrc6000Task",                      /* task name for kernel awareness debugging */
-			5000L / sizeof(portSTACK_TYPE),     /* task stack size */
-			NULL,                               /* optional task startup argument */
-			(UBaseType_t)osPriorityNormal,      /* initial priority */
-			&hrc6000Task.Handle                 /* optional task handle to create */
-	);
+	irqQueueInit(&sysIrqQueue);
+
+	hrc6000DeferredTaskHandle = taskMemoryCreate(hrc6000DeferredTaskFunction, "hrc6000Deferred", hrc6000DeferredTaskStack,
+			(sizeof(hrc6000DeferredTaskStack) / sizeof(StackType_t)), &hrc6000DeferredTaskTCB, (UBaseType_t)osPriorityRealtime);
+
+	hrc6000Task.Handle = taskMemoryCreate(hrc6000TaskFunction, "hrc6000Task", hrc6000TaskStack,
+			(sizeof(hrc6000TaskStack) / sizeof(StackType_t)), &hrc6000TaskTCB, (UBaseType_t)osPriorityNormal);
 
 	hrc6000Task.Running = true;
 	hrc6000Task.AliveCount = TASK_FLAGGED_ALIVE;
@@ -2744,27 +2961,30 @@ bool HRC6000HasGotSync(void)
 
 void HRC6000SetMicGainFM(uint8_t gain)
 {
-	SPI0WritePageRegByte(0x04, 0xE4, 0xE0 + (gain));
+	SPI0WritePageRegByteIfChanged(0x04, 0xE4, 0xE0 + (gain));
 }
 
 void HRC6000SetFMTx(void)
 {
-	SPI0WritePageRegByte(0x04, 0x10, 0x80);											//Switch to FM Mode
-	SPI0WritePageRegByte(0x04, 0xE2, 0x00);											//configure ADC and DAc
-	SPI0WritePageRegByte(0x04, 0xE0, 0xC9);											//CPU Controls Codec, Line in 1,LineOut2, I2S Slave Mode
-	SPI0WritePageRegByte(0x04, 0xE4, 0xE0 + (nonVolatileSettings.micGainFM));       //Mic Gain
-	SPI0WritePageRegByte(0x04, 0xC2, 0x00);											//Mic AGC Off
-	SPI0WritePageRegByte(0x04, 0xE5, 0x1A);											//Unknown (Default value = 0A)
-	SPI0WritePageRegByte(0x04, 0x25, 0x0E);											//Undocumented Register
-	SPI0WritePageRegByte(0x04, 0x26, 0xFE);											//Undocumented register Turns off FM receive
-	SPI0WritePageRegByte(0x04, 0x83, 0xFF);											//Clear aLL Interrupts
-	SPI0WritePageRegByte(0x04, 0x87, 0x00);											//Clear Int Masks
-	SPI0WritePageRegByte(0x04, 0x45, analogIGain);									//Set MOD2 Level (from cal table)
-	SPI0WritePageRegByte(0x04, 0x46, analogQGain);									//Set MOD1 Level (from cal table)
-	SPI0WritePageRegByte(0x04, 0x48, 0x00);											//Two Point Mod Bias =0
-	SPI0WritePageRegByte(0x04, 0x04, Mod2Offset);									//Set MOD 2 Offset (Cal Value)
-	SPI0WritePageRegByte(0x04, 0x49, 0xFF);											//set mod limit registers to max
-	SPI0WritePageRegByte(0x04, 0x4A, 0xFF);
+	spi0Batch_t batch;
+
+	SPI0BatchInit(&batch);
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x10, 0x80);											//Switch to FM Mode
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xE2, 0x00);											//configure ADC and DAc
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xE0, 0xC9);											//CPU Controls Codec, Line in 1,LineOut2, I2S Slave Mode
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xE4, 0xE0 + (nonVolatileSettings.micGainFM));       //Mic Gain
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xC2, 0x00);											//Mic AGC Off
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xE5, 0x1A);											//Unknown (Default value = 0A)
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x25, 0x0E);											//Undocumented Register
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x26, 0xFE);											//Undocumented register Turns off FM receive
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0x83, 0xFF);											//Clear aLL Interrupts
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x87, 0x00);											//Clear Int Masks
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x45, analogIGain);									//Set MOD2 Level (from cal table)
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x46, analogQGain);									//Set MOD1 Level (from cal table)
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x48, 0x00);											//Two Point Mod Bias =0
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x04, Mod2Offset);									//Set MOD 2 Offset (Cal Value)
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x49, 0xFF);											//set mod limit registers to max
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x4A, 0xFF);
 
 	uint8_t deviation;
 	uint8_t CTCdeviation;
@@ -2801,115 +3021,140 @@ void HRC6000SetFMTx(void)
 		}
 	}
 
-	SPI0WritePageRegByte(0x04, 0x35, deviation);									    //FM Deviation Coefficient
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x35, deviation);									    //FM Deviation Coefficient
 
 	if(sendingDCS)
 	{
-		SPI0WritePageRegByte(0x04, 0xA0, DCSdeviation);									//set the DCS deviation level
+		SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xA0, DCSdeviation);									//set the DCS deviation level
 	}
 	else
 	{
-		SPI0WritePageRegByte(0x04, 0xA0, CTCdeviation);									//Set CTCSS Deviation level
+		SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xA0, CTCdeviation);									//Set CTCSS Deviation level
 	}
-	SPI0WritePageRegByte(0x04, 0x3F, 0x04);											//Set FM Limiting Modulation Factor
-	SPI0WritePageRegByte(0x04, 0x34, 0x3C);											//Compressor off, Pre-Emph on 3KHz Audio Filter
-	SPI0WritePageRegByte(0x04, 0x3E, 0x08);											//Rx FM Deviation Coefficient
-	SPI0WritePageRegByte(0x04, 0x37, 0x80);											//Set Codec DAC Gain
-	SPI0WritePageRegByte(0x01, 0x50, 0x00);											//Aux Register 0x50 Undocumented
-	SPI0WritePageRegByte(0x01, 0x51, 0x00);											//Aux Register 0x51 Undocumented
-	SPI0WritePageRegByte(0x04, 0x60, 0x80);											//Set Tx to Analogue Voice Sending mode
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x3F, 0x04);											//Set FM Limiting Modulation Factor
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x34, 0x3C);											//Compressor off, Pre-Emph on 3KHz Audio Filter
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x3E, 0x08);											//Rx FM Deviation Coefficient
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x37, 0x80);											//Set Codec DAC Gain
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x01, 0x50, 0x00);											//Aux Register 0x50 Undocumented
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x01, 0x51, 0x00);											//Aux Register 0x51 Undocumented
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0x60, 0x80);											//Set Tx to Analogue Voice Sending mode
+	SPI0BatchCommit(&batch);
 }
 
 void HRC6000SetFMRx(void)
 {
-	SPI0WritePageRegByte(0x04, 0x60, 0x00);							//FM Voice Tx Mode Off
-	SPI0WritePageRegByte(0x04, 0xE0, 0x89);							//Turn off Microphone input
-	SPI0WritePageRegByte(0x04, 0x10, 0x80);							//Mod Mode FM
-	SPI0WritePageRegByte(0x04, 0xE2, 0x06);							//configure ADC and DAc
-	SPI0WritePageRegByte(0x04, 0x34, 0x3C);							//Compressor off, de-Emph on 3KHz Audio Filter
-	SPI0WritePageRegByte(0x04, 0x81, 0x19);							//Interrupt Masks (for DMR?)
-	SPI0WritePageRegByte(0x04, 0x85, 0x00);							//Interrupt Masks )For DMR?)
-	SPI0WritePageRegByte(0x04, 0x26, 0xFD);							//Undocumented register Turns on FM receive
+	spi0Batch_t batch;
+
+	SPI0BatchInit(&batch);
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0x60, 0x00);							//FM Voice Tx Mode Off
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xE0, 0x89);							//Turn off Microphone input
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x10, 0x80);							//Mod Mode FM
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xE2, 0x06);							//configure ADC and DAc
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x34, 0x3C);							//Compressor off, de-Emph on 3KHz Audio Filter
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x81, 0x19);							//Interrupt Masks (for DMR?)
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x85, 0x00);							//Interrupt Masks )For DMR?)
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x26, 0xFD);							//Undocumented register Turns on FM receive
+	SPI0BatchCommit(&batch);
 }
 
 //restore all important registers that may have been changed by FM mode
 void HRC6000SetDMR(void)
 {
+	spi0Batch_t batch;
+
+	SPI0BatchInit(&batch);
 
 	if(trxGetFrequency() > 30000000)
 	{
-		SPI0WritePageRegByte(0x04, 0x01, 0xB0);										//set 2 point Mod, receive mode IF, non inverted (for UHF)
+		SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x01, 0xB0);										//set 2 point Mod, receive mode IF, non inverted (for UHF)
 	}
 	else
 	{
-		SPI0WritePageRegByte(0x04, 0x01, 0xF0);                                     //set 2 point Mod, receive mode IF, inverted (for VHF)
+		SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x01, 0xF0);                                     //set 2 point Mod, receive mode IF, inverted (for VHF)
 	}
 
-	SPI0WritePageRegByte(0x04, 0x45, digitalIGain);									//Set MOD2 Level (from cal table)
-	SPI0WritePageRegByte(0x04, 0x46, digitalQGain);									//Set MOD1 Level (from cal table)
-	SPI0WritePageRegByte(0x04, 0x10, 0x6E);											//Set mode to DMR,Tier2,Timeslot Mode, Layer 2, Repeater, Aligned, Slot1
-	SPI0WritePageRegByte(0x04, 0xE2, 0x06);											//Configure DAC and ADC
-	SPI0WritePageRegByte(0x04, 0xE0, 0xC9);   										//CODEC under MCU Control, LineOut2 Enabled, Mic_p Enabled,  I2S Slave Mode
-	SPI0WritePageRegByte(0x04, 0xE4, 0xE0 + (nonVolatileSettings.micGainDMR));		//Mic Gain
-	SPI0WritePageRegByte(0x04, 0x26, 0xFD);											//Undocumented register believed to control IF ADC
-	SPI0WritePageRegByte(0x04, 0x37, 0x80);											//Set Codec DAC Gain
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x45, digitalIGain);									//Set MOD2 Level (from cal table)
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x46, digitalQGain);									//Set MOD1 Level (from cal table)
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x10, 0x6E);											//Set mode to DMR,Tier2,Timeslot Mode, Layer 2, Repeater, Aligned, Slot1
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xE2, 0x06);											//Configure DAC and ADC
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xE0, 0xC9);   										//CODEC under MCU Control, LineOut2 Enabled, Mic_p Enabled,  I2S Slave Mode
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xE4, 0xE0 + (nonVolatileSettings.micGainDMR));		//Mic Gain
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x26, 0xFD);											//Undocumented register believed to control IF ADC
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x37, 0x80);											//Set Codec DAC Gain
+	SPI0BatchCommit(&batch);
 }
 
 void HRC6000SetTxCTCSS(uint8_t index)
 {
+	spi0Batch_t batch;
+
+	SPI0BatchInit(&batch);
 	if(index > 0)
 	{
-		SPI0WritePageRegByte(0x04, 0xA1, 0x08);					//Enable CTCSS Mode
-		SPI0WritePageRegByte(0x04, 0xA8, index);				//set the CTCSS Tone
+		SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xA1, 0x08);					//Enable CTCSS Mode
+		SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xA8, index);				//set the CTCSS Tone
 		sendingDCS = false;
 	}
 	else
 	{
-		SPI0WritePageRegByte(0x04, 0xA1, 0x00);					//Disable CTCSS and DCS Mode
+		SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xA1, 0x00);					//Disable CTCSS and DCS Mode
 		sendingDCS = false;
 	}
+	SPI0BatchCommit(&batch);
 }
 
 void HRC6000SetTxDCS(uint16_t code, bool inverted)
 {
+	spi0Batch_t batch;
+
+	SPI0BatchInit(&batch);
 	if(code > 0)
 	{
-		SPI0WritePageRegByte(0x04, 0xA1, 0x04);                      //Enable DCS Mode
-		SPI0WritePageRegByte(0x04, 0xA2, (inverted ? 0x08 : 0x00));  //set the DCS Signaling Polarity
-		SPI0WritePageRegByte(0x04, 0xAB, code & 0xFF);               //low 8 bits of Octal Code
-		SPI0WritePageRegByte(0x04, 0xAC, (code >> 8) & 0x01);        //High bit of Octal Code
+		SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xA1, 0x04);                      //Enable DCS Mode
+		SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xA2, (inverted ? 0x08 : 0x00));  //set the DCS Signaling Polarity
+		SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xAB, code & 0xFF);               //low 8 bits of Octal Code
+		SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xAC, (code >> 8) & 0x01);        //High bit of Octal Code
 		sendingDCS = true;
 	}
 	else
 	{
-		SPI0WritePageRegByte(0x04, 0xA1, 0x00);                      //Disable CTCSS and DCS Mode
+		SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xA1, 0x00);                      //Disable CTCSS and DCS Mode
 		sendingDCS = false;
 	}
+	SPI0BatchCommit(&batch);
 }
 
 void HRC6000SetRxDCS(uint16_t code, bool inverted)
 {
+	spi0Batch_t batch;
+
+	SPI0BatchInit(&batch);
 	if(code > 0)
 	{
-		SPI0WritePageRegByte(0x04, 0xA1, 0x04);                        //Enable DCS Mode
-		SPI0WritePageRegByte(0x04, 0xA2, (inverted ? 0x04 : 0x00));    //set the DCS Signaling Polarity
-		SPI0WritePageRegByte(0x04, 0xD4, code & 0xFF);                 //low 8 bits of Octal Code to receive
-		SPI0WritePageRegByte(0x04, 0xD3, ((code >> 4) & 0x10) + 0x03); //High bit of Octal Code to receive  plus sampling depth high nibble
-		SPI0WritePageRegByte(0x04, 0xD2, 0x20);                        //Sampling Depth Low byte to Set Sampling Depth to 800 (100ms at 8KHz)
+		SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xA1, 0x04);                        //Enable DCS Mode
+		SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xA2, (inverted ? 0x04 : 0x00));    //set the DCS Signaling Polarity
+		SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xD4, code & 0xFF);                 //low 8 bits of Octal Code to receive
+		SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xD3, ((code >> 4) & 0x10) + 0x03); //High bit of Octal Code to receive  plus sampling depth high nibble
+		SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xD2, 0x20);                        //Sampling Depth Low byte to Set Sampling Depth to 800 (100ms at 8KHz)
 	}
 	else
 	{
-		SPI0WritePageRegByte(0x04, 0xA1, 0x00);                        //Disable CTCSS and DCS Mode
+		SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xA1, 0x00);                        //Disable CTCSS and DCS Mode
 	}
+	SPI0BatchCommit(&batch);
 }
 
 void HRC6000SetRxCTCSS(uint8_t index)
 {
-	SPI0WritePageRegByte(0x04, 0xA1, 0x08);					    //Enable CTCSS Mode
-	SPI0WritePageRegByte(0x04, 0xA7, 0x10);						//Set Detection Threshold (was 0x10)
-	SPI0WritePageRegByte(0x04, 0xD3, 0x07);						//Set Sampling Depth to 2000 (250ms at 8KHz)
-	SPI0WritePageRegByte(0x04, 0xD2, 0xD0);						//
-	SPI0WritePageRegByte(0x04, 0xD4, index);					//Set the tone index to decode
+	spi0Batch_t batch;
+
+	SPI0BatchInit(&batch);
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xA1, 0x08);					    //Enable CTCSS Mode
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xA7, 0x10);						//Set Detection Threshold (was 0x10)
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xD3, 0x07);						//Set Sampling Depth to 2000 (250ms at 8KHz)
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xD2, 0xD0);						//
+	SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0xD4, index);					//Set the tone index to decode
+	SPI0BatchCommit(&batch);
 }
 
 bool HRC6000CheckCSS(void)
@@ -2965,6 +3210,7 @@ void HRC6000SetTone1Config(HRC6000_Tone1Config_t *cfg)
 
 void HRC6000SetDTMF(uint8_t code)
 {
+	spi0Batch_t batch;
 	uint8_t deviation;
 
 	SPI0ReadPageRegByte(0x04, 0xA1, &savedTone1Config.Mode);					//save the current tone mode
@@ -2994,31 +3240,38 @@ void HRC6000SetDTMF(uint8_t code)
 		}
 	}
 
-	SPI0WritePageRegByte(0x04, 0xA0, deviation);				//set the DTMF deviation
-	SPI0WritePageRegByte(0x04, 0xA4, 0xFF);				        //set the tone time to Max (2ms increments)
-	SPI0WritePageRegByte(0x04, 0xA3, 0x00);				        //set the tone gap to zero  (2ms increments)
-	SPI0WritePageRegByte(0x04, 0xD1, 0x06);				        //set the number of codes to 6
-	SPI0WritePageRegByte(0x04, 0xAF, ((code<<4) | code));		//set the same code to be sent 6 times (2 codes per register)
-	SPI0WritePageRegByte(0x04, 0xAE, ((code<<4) | code));
-	SPI0WritePageRegByte(0x04, 0xAD, ((code<<4) | code));
-	SPI0WritePageRegByte(0x04, 0x60, 0x00);		                //Set Analogue Voice Sending mode Off
-	SPI0WritePageRegByte(0x04, 0x60, 0x80);	                    //Set Analogue Voice Sending mode on again to send code
+	SPI0BatchInit(&batch);
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0xA0, deviation);				//set the DTMF deviation
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0xA4, 0xFF);				        //set the tone time to Max (2ms increments)
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0xA3, 0x00);				        //set the tone gap to zero  (2ms increments)
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0xD1, 0x06);				        //set the number of codes to 6
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0xAF, ((code<<4) | code));		//set the same code to be sent 6 times (2 codes per register)
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0xAE, ((code<<4) | code));
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0xAD, ((code<<4) | code));
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0x60, 0x00);		                //Set Analogue Voice Sending mode Off
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0x60, 0x80);	                    //Set Analogue Voice Sending mode on again to send code
+	SPI0BatchCommit(&batch);
 }
 
 void HRC6000DTMFoff(bool enableMic)
 {
+	spi0Batch_t batch;
+
 	HRC6000SetMic(enableMic);									//turn on or mute the mic as required.
 
-	SPI0WritePageRegByte(0x04, 0xA0, savedTone1Config.Dev);				    //restore the previous tone deviation
-	SPI0WritePageRegByte(0x04, 0xA1, savedTone1Config.Mode);					//restore the previous tone Mode
-	SPI0WritePageRegByteExtended(0x01, 0x11B, 0x05);			//restore the DTMF 697 Hz tone in case it has been changed by SetTone
-	SPI0WritePageRegByteExtended(0x01, 0x11A, 0x93);			//
-	SPI0WritePageRegByteExtended(0x01, 0x123, 0x09);			//restore the DTMF 1209 Hz tone in case it has been changed by SetTone
-	SPI0WritePageRegByteExtended(0x01, 0x122, 0xAC);			//
+	SPI0BatchInit(&batch);
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0xA0, savedTone1Config.Dev);				    //restore the previous tone deviation
+	SPI0BatchWritePageRegByte(&batch, 0x04, 0xA1, savedTone1Config.Mode);					//restore the previous tone Mode
+	SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x11B, 0x05);			//restore the DTMF 697 Hz tone in case it has been changed by SetTone
+	SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x11A, 0x93);			//
+	SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x123, 0x09);			//restore the DTMF 1209 Hz tone in case it has been changed by SetTone
+	SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x122, 0xAC);			//
+	SPI0BatchCommit(&batch);
 }
 
 void HRC6000SendTone(int tonefreq)
 {
+	spi0Batch_t batch;
 	uint32_t tval;
 
 	tval = (tonefreq * 65536) / 32000;												//calculate the value required to generate this tone
@@ -3026,41 +3279,47 @@ void HRC6000SendTone(int tonefreq)
 	uint8_t tH = (tval >> 8) & 0xFF;
 	uint8_t tL = tval & 0xFF;
 
-	SPI0WritePageRegByteExtended(0x01, 0x11B, tH);// Set  DTMF tone osc 1 to frequency of the required tone
-	SPI0WritePageRegByteExtended(0x01, 0x11A, tL);
+	SPI0BatchInit(&batch);
+	SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x11B, tH);// Set  DTMF tone osc 1 to frequency of the required tone
+	SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x11A, tL);
 
-	SPI0WritePageRegByteExtended(0x01, 0x123, tH);// Set  DTMF tone osc 2 to frequency of the required tone
-	SPI0WritePageRegByteExtended(0x01, 0x122, tL);
+	SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x123, tH);// Set  DTMF tone osc 2 to frequency of the required tone
+	SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x122, tL);
+	SPI0BatchCommit(&batch);
 
 	HRC6000SetDTMF(1); //send DTMF key 1 to send a single
 }
 
 void HRC6000InitDTMF(void)
 {
-	SPI0WritePageRegByteExtended(0x01, 0x11B, 0x05);				//configure 697 Hz tone
-	SPI0WritePageRegByteExtended(0x01, 0x11A, 0x93);				//
-	SPI0WritePageRegByteExtended(0x01, 0x11D, 0x06);				//configure 770 Hz tone
-	SPI0WritePageRegByteExtended(0x01, 0x11C, 0x29);				//
-	SPI0WritePageRegByteExtended(0x01, 0x11F, 0x06);				//configure 852 Hz tone
-	SPI0WritePageRegByteExtended(0x01, 0x11E, 0xD1);				//
-	SPI0WritePageRegByteExtended(0x01, 0x121, 0x07);				//configure 941 Hz tone
-	SPI0WritePageRegByteExtended(0x01, 0x120, 0x87);				//
-
-	SPI0WritePageRegByteExtended(0x01, 0x123, 0x09);				//configure 1209 Hz tone
-	SPI0WritePageRegByteExtended(0x01, 0x122, 0xAC);				//
-	SPI0WritePageRegByteExtended(0x01, 0x125, 0x0A);				//configure 1336 Hz tone
-	SPI0WritePageRegByteExtended(0x01, 0x124, 0xB0);				//
-	SPI0WritePageRegByteExtended(0x01, 0x127, 0x0B);				//configure 1447 Hz tone
-	SPI0WritePageRegByteExtended(0x01, 0x126, 0xD1);				//
-	SPI0WritePageRegByteExtended(0x01, 0x129, 0x0D);				//configure 1633 Hz tone
-	SPI0WritePageRegByteExtended(0x01, 0x128, 0x10);				//
+	spi0Batch_t batch;
+
+	SPI0BatchInit(&batch);
+	SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x11B, 0x05);				//configure 697 Hz tone
+	SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x11A, 0x93);				//
+	SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x11D, 0x06);				//configure 770 Hz tone
+	SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x11C, 0x29);				//
+	SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x11F, 0x06);				//configure 852 Hz tone
+	SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x11E, 0xD1);				//
+	SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x121, 0x07);				//configure 941 Hz tone
+	SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x120, 0x87);				//
+
+	SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x123, 0x09);				//configure 1209 Hz tone
+	SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x122, 0xAC);				//
+	SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x125, 0x0A);				//configure 1336 Hz tone
+	SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x124, 0xB0);				//
+	SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x127, 0x0B);				//configure 1447 Hz tone
+	SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x126, 0xD1);				//
+	SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x129, 0x0D);				//configure 1633 Hz tone
+	SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x128, 0x10);				//
+	SPI0BatchCommit(&batch);
 }
 
 void HRC6000SetDmrRxGain(int8_t gain)
 {
 	gain = CLAMP(gain, -31, 31);
 	uint8_t val = (0x80 + ((gain > 0) * 0x40)) | (gain & 0x1F);
-	SPI0WritePageRegByte(0x04, 0x37, val);
+	SPI0WritePageRegByteIfChanged(0x04, 0x37, val);
 }
 
 bool HRC6000CCIsHeld(void)
@@ -29,6 +29,10 @@
 #include "interfaces/gpio.h"
 #include <string.h>
 #include "main.h"
+#include "functions/perf.h"
+#if defined(PLATFORM_MD9600)
+#include "hardware/ST7567.h"
+#endif
 
 // private functions
 static bool spi_flash_busy(void);
@@ -82,6 +86,7 @@ __attribute__((section(".ccmram"))) uint8_t SPI_Flash_sectorbuffer[4096];
 
 
 uint32_t flashChipPartNumber;
+static volatile bool writeInProgress = false; // a non blocking erase/program was started, and not seen completed yet
 
 bool SPI_Flash_init(void)
 {
@@ -97,16 +102,22 @@ bool SPI_Flash_init(void)
 }
 
 // Returns false for failed
-// Note. There is no error checking that the device is not initially busy.
+// Note. The device is only checked for not being busy after a non blocking erase/program.
 bool SPI_Flash_read(uint32_t addr, uint8_t *dataBuf, int size)
 {
   uint8_t commandBuf[4]= { READ_DATA, addr >> 16, addr >> 8, addr };// command
 
+  SPI_Flash_waitForWriteCompletion();
+
+  PERF_BEGIN(PERF_PROBE_SPI_FLASH_READ);
+
   spi_flash_enable();
   HAL_SPI_Transmit(&HANDLE_SPI, commandBuf, 4, HAL_MAX_DELAY);
   HAL_SPI_Receive(&HANDLE_SPI, dataBuf, size, HAL_MAX_DELAY);
   spi_flash_disable();
 
+  PERF_END(PERF_PROBE_SPI_FLASH_READ);
+
   return true;
 }
 
@@ -226,12 +237,13 @@ uint32_t SPI_Flash_readPartID(void)
 	return (recBuf[2] << 8) | recBuf[3];
 }
 
-bool SPI_Flash_writePage(uint32_t addr_start,uint8_t *dataBuf)
+// Starts programming a page, and returns immediately (SPI_Flash_isBusy() reports the completion)
+void SPI_Flash_writePageStart(uint32_t addr_start, uint8_t *dataBuf)
 {
-	bool isBusy;
-	int waitCounter = 5;// Worst case is something like 3mS
 	uint8_t commandBuf[4]= { PAGE_PGM, addr_start >> 16, addr_start >> 8, 0x00 } ;
 
+	SPI_Flash_waitForWriteCompletion();
+
 	spi_flash_setWriteEnable(true);
 
 	spi_flash_enable();
@@ -241,39 +253,89 @@ bool SPI_Flash_writePage(uint32_t addr_start,uint8_t *dataBuf)
 
 	spi_flash_disable();
 
+	writeInProgress = true;
+}
+
+bool SPI_Flash_writePage(uint32_t addr_start,uint8_t *dataBuf)
+{
+	bool isBusy;
+	int waitCounter = 5;// Worst case is something like 3mS
+
+	SPI_Flash_writePageStart(addr_start, dataBuf);
+
 	do
 	{
 		osDelay(1);
 		isBusy = spi_flash_busy();
 	} while ((waitCounter-- > 0) && isBusy);
 
+	writeInProgress = false;
+
 	return !isBusy;
 }
 
-// Returns true if erased and false if failed.
-bool SPI_Flash_eraseSector(uint32_t addr_start)
+// Starts erasing a sector, and returns immediately (SPI_Flash_isBusy() reports the completion)
+void SPI_Flash_eraseSectorStart(uint32_t addr_start)
 {
-	int waitCounter = 500;// erase can take up to 500 mS
-	bool isBusy;
 	uint8_t commandBuf[4] = { SECTOR_E, addr_start >> 16, addr_start >> 8, 0x00 };
 
+	SPI_Flash_waitForWriteCompletion();
+
 	spi_flash_setWriteEnable(true); // it calls spi_flash_{enable/disable}() by itself
 
 	spi_flash_enable();
 	HAL_SPI_Transmit(&HANDLE_SPI, commandBuf, 4, HAL_MAX_DELAY);
 	spi_flash_disable();
 
+	writeInProgress = true;
+}
+
+// Returns true if erased and false if failed.
+bool SPI_Flash_eraseSector(uint32_t addr_start)
+{
+	int waitCounter = 500;// erase can take up to 500 mS
+	bool isBusy;
+
+	SPI_Flash_eraseSectorStart(addr_start);
+
 	do
 	{
 		osDelay(1);
 		isBusy = spi_flash_busy();
 	} while ((waitCounter-- > 0) && isBusy);
 
+	writeInProgress = false;
+
 	return !isBusy;// If still busy after
 }
 
+// Waits for the completion of an erase/program started by SPI_Flash_eraseSectorStart() or SPI_Flash_writePageStart(),
+// if SPI_Flash_isBusy() hasn't already reported it. Returns false if it's still busy after the erase timeout.
+// It may sleep, so it must not be called with the scheduler locked.
+bool SPI_Flash_waitForWriteCompletion(void)
+{
+	int waitCounter = 500;// erase can take up to 500 mS
+	bool isBusy = false;
+
+	if (writeInProgress)
+	{
+		while ((isBusy = spi_flash_busy()) && (waitCounter-- > 0))
+		{
+			osDelay(1);
+		}
+
+		writeInProgress = false;
+	}
+
+	return !isBusy;
+}
+
 static inline void spi_flash_enable(void)
 {
+#if defined(PLATFORM_MD9600)
+	// SPI2 is shared with the display, whose DMA transfer may still be running
+	displayWaitForTransferComplete();
+#endif
 	HAL_GPIO_WritePin(SPI_Flash_CS_GPIO_Port, SPI_Flash_CS_Pin, GPIO_PIN_RESET);
 }
 
@@ -282,6 +344,18 @@ static void spi_flash_disable(void)
 	HAL_GPIO_WritePin(SPI_Flash_CS_GPIO_Port, SPI_Flash_CS_Pin, GPIO_PIN_SET);
 }
 
+bool SPI_Flash_isBusy(void)
+{
+	bool isBusy = spi_flash_busy();
+
+	if (isBusy == false)
+	{
+		writeInProgress = false;
+	}
+
+	return isBusy;
+}
+
 static bool spi_flash_busy(void)
 {
 	uint8_t r1;
@@ -311,6 +385,8 @@ bool SPI_Flash_readSecurityRegisters(int startBlock, uint8_t *dataBuf, int size)
 
 	int numberofblocks = size / securityBlockSize;
 
+	SPI_Flash_waitForWriteCompletion();
+
 	for (uint8_t i = startBlock; i < numberofblocks + 1; i++)
 	{
 		uint32_t addr = addrs[i];
@@ -330,6 +406,8 @@ uint8_t SPI_Flash_readSingleSecurityRegister(int addr)
 	  uint8_t value;
 	  uint8_t commandBuf[5] = { R_SEC_REGS, ((addr >> 16) & 0xFF), ((addr >> 8) & 0xFF), (addr & 0xFF), 0x00 };
 
+	  SPI_Flash_waitForWriteCompletion();
+
 	  spi_flash_enable();
 	  HAL_SPI_Transmit(&HANDLE_SPI, commandBuf, 5, HAL_MAX_DELAY);
 	  HAL_SPI_Receive(&HANDLE_SPI, &value, 1, HAL_MAX_DELAY);
@@ -57,6 +57,23 @@ extern bool headerRowIsDirty;
 static __attribute__((section(".data.$RAM2"))) uint8_t screenBufData[((DISPLAY_SIZE_X * DISPLAY_SIZE_Y) >> 3)];
 uint8_t *screenBuf = screenBufData;
 
+//
+// Dirty tracking.
+//
+// The drawing functions record, for each row (page), the range of columns they wrote to. The render only sends
+// these ranges, trimmed (and split) against a copy of what the panel shows, so redrawing the same content costs no
+// transfer. The direct writers of the screen buffer have to call displayMarkAllDirty().
+//
+typedef struct
+{
+	uint8_t start;        // first dirty column
+	uint8_t end;          // last dirty column + 1, the row is clean when end <= start
+	bool    synchronised; // the panel copy of this row matches the panel
+} displayDirtySpan_t;
+
+static displayDirtySpan_t dirtySpans[DISPLAY_NUMBER_OF_ROWS];
+static uint8_t panelData[sizeof(screenBufData)]; // what was last sent to the panel, read by the SPI DMA (not in the CCM)
+
 //#define DISPLAY_CHECK_BOUNDS
 
 #ifdef DISPLAY_CHECK_BOUNDS
@@ -68,6 +85,130 @@ DayTime_t themeDaytime = DAY;
 uint16_t themeItems[NIGHT + 1][THEME_ITEM_MAX]; // Theme storage
 #endif
 
+static inline void displayMarkDirty(int16_t row, int16_t startX, int16_t endX)
+{
+	if ((row < 0) || (row >= DISPLAY_NUMBER_OF_ROWS))
+	{
+		return;
+	}
+
+	startX = CLAMP(startX, 0, DISPLAY_SIZE_X);
+	endX = CLAMP(endX, 0, DISPLAY_SIZE_X);
+
+	if (startX < dirtySpans[row].start)
+	{
+		dirtySpans[row].start = startX;
+	}
+
+	if (endX > dirtySpans[row].end)
+	{
+		dirtySpans[row].end = endX;
+	}
+}
+
+// Marks a run of screen buffer bytes, which can wrap to the next row(s)
+static void displayMarkDirtyBytes(int32_t offset, int32_t length)
+{
+	int32_t end = MIN((offset + length), (int32_t)sizeof(screenBufData));
+
+	offset = MAX(offset, 0);
+
+	while (offset < end)
+	{
+		int16_t row = (offset / DISPLAY_SIZE_X);
+		int32_t rowStart = (row * DISPLAY_SIZE_X);
+		int32_t rowEnd = MIN((rowStart + DISPLAY_SIZE_X), end);
+
+		displayMarkDirty(row, (offset - rowStart), (rowEnd - rowStart));
+		offset = rowEnd;
+	}
+}
+
+void displayMarkAllDirty(void)
+{
+	for (int16_t row = 0; row < DISPLAY_NUMBER_OF_ROWS; row++)
+	{
+		dirtySpans[row].start = 0;
+		dirtySpans[row].end = DISPLAY_SIZE_X;
+	}
+}
+
+// The panel content is unknown (reset, woken up, or another panel), the next render will send everything.
+void displayInvalidatePanel(void)
+{
+	for (int16_t row = 0; row < DISPLAY_NUMBER_OF_ROWS; row++)
+	{
+		dirtySpans[row].synchronised = false;
+	}
+
+	displayMarkAllDirty();
+}
+
+// Returns the next span of a row which has to be sent to the panel, NULL when there is none left.
+// The returned data is the panel copy, it stays valid until the next call.
+const uint8_t *displayTakeDirtySpan(int16_t row, int16_t *x, int16_t *length)
+{
+	displayDirtySpan_t *span = &dirtySpans[row];
+	const uint8_t *source = (screenBuf + (row * DISPLAY_SIZE_X));
+	uint8_t *panel = (panelData + (row * DISPLAY_SIZE_X));
+	int16_t start = span->start;
+	int16_t end = span->end;
+	int16_t spanEnd = end;
+
+	span->start = DISPLAY_SIZE_X;
+	span->end = 0;
+
+	if (span->synchronised)
+	{
+		// Skip what the panel already shows
+		while ((start < end) && (source[start] == panel[start]))
+		{
+			start++;
+		}
+
+		while ((end > start) && (source[end - 1] == panel[end - 1]))
+		{
+			end--;
+		}
+
+		// Stop at the first long enough unchanged run, the rest stays dirty
+		int16_t unchanged = 0;
+
+		spanEnd = end;
+		for (int16_t col = start; col < end; col++)
+		{
+			if (source[col] != panel[col])
+			{
+				unchanged = 0;
+			}
+			else if (++unchanged == DISPLAY_SPAN_MIN_GAP)
+			{
+				spanEnd = (col + 1 - DISPLAY_SPAN_MIN_GAP);
+				span->start = (col + 1);
+				span->end = end;
+				break;
+			}
+		}
+	}
+
+	if (start >= spanEnd)
+	{
+		return NULL;
+	}
+
+	memcpy(&panel[start], &source[start], (spanEnd - start));
+
+	if ((start == 0) && (spanEnd == DISPLAY_SIZE_X))
+	{
+		span->synchronised = true;
+	}
+
+	*x = start;
+	*length = (spanEnd - start);
+
+	return &panel[start];
+}
+
 int16_t displaySetPixel(int16_t x, int16_t y, bool isInverted)
 {
 	int16_t i = ((y >> 3) * DISPLAY_SIZE_X) + x;
@@ -86,6 +227,8 @@ int16_t displaySetPixel(int16_t x, int16_t y, bool isInverted)
 		screenBuf[i] &= ~(0x1 << (y & 7));
 	}
 
+	displayMarkDirty((i / DISPLAY_SIZE_X), (i % DISPLAY_SIZE_X), ((i % DISPLAY_SIZE_X) + 1));
+
 	return 0;
 }
 
@@ -283,11 +426,12 @@ int displayPrintCore(int16_t x, int16_t y, const char *szMsg, ucFont_t fontSize,
 		{
 			readPos = (currentCharData + row * charWidthPixels);
 			writePos = (screenBuf + x + (i * charWidthPixels) + ((y >> 3) + row) * DISPLAY_SIZE_X) ;
+			displayMarkDirtyBytes((writePos - screenBuf), charWidthPixels);
 
 			if ((y & 0x07) == 0)
 			{
 				// y position is aligned to a row
-				for(int16_t p = 0; (p < charWidthPixels) && ((writePos - screenBuf) < (DISPLAY_SIZE_X * DISPLAY_SIZE_Y)); p++)
+				for(int16_t p = 0; (p < charWidthPixels) && ((writePos - screenBuf) < ((DISPLAY_SIZE_X * DISPLAY_SIZE_Y) >> 3)); p++)
 				{
 					if (isInverted)
 					{
@@ -310,7 +454,7 @@ int displayPrintCore(int16_t x, int16_t y, const char *szMsg, ucFont_t fontSize,
 				int16_t shiftNum = y & 0x07;
 				// y position is NOT aligned to a row
 
-				for(int16_t p = 0; (p < charWidthPixels) && ((writePos - screenBuf) < (DISPLAY_SIZE_X * DISPLAY_SIZE_Y)); p++)
+				for(int16_t p = 0; (p < charWidthPixels) && ((writePos - screenBuf) < ((DISPLAY_SIZE_X * DISPLAY_SIZE_Y) >> 3)); p++)
 				{
 					if (isInverted)
 					{
@@ -330,8 +474,9 @@ int displayPrintCore(int16_t x, int16_t y, const char *szMsg, ucFont_t fontSize,
 
 				readPos = (currentCharData + row * charWidthPixels);
 				writePos = (screenBuf + x + (i * charWidthPixels) + ((y >> 3) + row + 1) * DISPLAY_SIZE_X) ;
+				displayMarkDirtyBytes((writePos - screenBuf), charWidthPixels);
 
-				for(int16_t p = 0; (p < charWidthPixels) && ((writePos - screenBuf) < (DISPLAY_SIZE_X * DISPLAY_SIZE_Y)); p++)
+				for(int16_t p = 0; (p < charWidthPixels) && ((writePos - screenBuf) < ((DISPLAY_SIZE_X * DISPLAY_SIZE_Y) >> 3)); p++)
 				{
 					if (isInverted)
 					{
@@ -358,6 +503,7 @@ int displayPrintCore(int16_t x, int16_t y, const char *szMsg, ucFont_t fontSize,
 void displayClearBuf(void)
 {
 	memset(screenBuf, 0x00, ((DISPLAY_SIZE_X * DISPLAY_SIZE_Y) >> 3));
+	displayMarkAllDirty();
 }
 
 void displayClearRows(int16_t startRow, int16_t endRow, bool isInverted)
@@ -374,6 +520,11 @@ void displayClearRows(int16_t startRow, int16_t endRow, bool isInverted)
 	// memset would be faster than ucFillRect
 	//ucFillRect(0, (startRow * 8), 128, (8 * (endRow - startRow)), true);
     memset(screenBuf + (DISPLAY_SIZE_X * startRow), (isInverted ? 0xFF : 0x00), (DISPLAY_SIZE_X * (endRow - startRow)));
+
+	for (int16_t row = startRow; row < endRow; row++)
+	{
+		displayMarkDirty(row, 0, DISPLAY_SIZE_X);
+	}
 }
 
 void displayPrintCentered(uint16_t y, const char *text, ucFont_t fontSize)
@@ -1066,6 +1217,11 @@ void displayFillRect(int16_t x, int16_t y, int16_t width, int16_t height, bool i
 	uint8_t bitPatten;
 	int16_t shiftNum;
 
+	for (int16_t row = startRow; row <= endRow; row++)
+	{
+		displayMarkDirty(row, x, endStripe);
+	}
+
 	if (startRow == endRow)
 	{
 		addPtr = screenBuf + (startRow * DISPLAY_SIZE_X);
@@ -1085,7 +1241,8 @@ void displayFillRect(int16_t x, int16_t y, int16_t width, int16_t height, bool i
 	}
 	else
 	{
-		for(int16_t row = startRow; row <= endRow; row++)
+		// A rectangle ending on the bottom edge has an empty endRow, past the buffer
+		for(int16_t row = startRow; (row <= endRow) && (row < DISPLAY_NUMBER_OF_ROWS); row++)
 		{
 			if (row == startRow)
 			{
@@ -1293,6 +1450,7 @@ uint8_t *displayGetScreenBuffer(void)
 void displayRestorePrimaryScreenBuffer(void)
 {
 	screenBuf = screenBufData;
+	displayMarkAllDirty();
 }
 
 uint8_t *displayGetPrimaryScreenBuffer(void)
@@ -1303,6 +1461,7 @@ uint8_t *displayGetPrimaryScreenBuffer(void)
 void displayOverrideScreenBuffer(uint8_t *buffer)
 {
 	screenBuf = buffer;
+	displayMarkAllDirty();
 }
 
 
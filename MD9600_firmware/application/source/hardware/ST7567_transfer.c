@@ -29,45 +29,225 @@
 #include "hardware/ST7567.h"
 #include "main.h"
 #include "interfaces/remoteHead.h"
+#include "functions/perf.h"
 
 static void ST7567transferCommand(register uint8_t data1);
-static void ST7567transferData(uint8_t *rowpos, uint16_t dispsize, uint32_t maxdelay);
+static bool ST7567transferStartSpan(void);
+static void ST7567transferEnd(bool failed);
+static void ST7567transferAbort(void);
+
+//
+// Non blocking render.
+//
+// The render queues the dirty spans (see displayTakeDirtySpan()) and returns. The SPI2 TX DMA sends, for each span,
+// its 3 addressing commands then its data, the next transfer being started from the DMA completion interrupt.
+// The spans data lives in the panel copy, which is only updated by the next render, once this transfer is over,
+// so the screen buffer can be redrawn while the panel is being updated.
+// SPI2 is shared with the SPI flash, which waits for the transfer completion before using it.
+// If the transfer fails, or doesn't complete in time, the panel copy is invalidated, so the next render sends
+// the full frame.
+//
+#define ST7567_TRANSFER_TIMEOUT  10U // ms, a full screen takes ~2ms
+
+typedef struct
+{
+	uint8_t        commands[3]; // page and column addresses
+	uint8_t        length;
+	const uint8_t *data;
+} ST7567span_t;
+
+typedef struct
+{
+	ST7567span_t          spans[DISPLAY_SPANS_MAX]; // read by the DMA (not in the CCM)
+	uint16_t              count;
+	volatile uint16_t     index;       // span being sent
+	volatile bool         sendingData; // the commands of the current span are sent
+	volatile bool         busy;
+	volatile bool         failed;      // set by the interrupt, the panel copy is invalidated by the task
+	volatile TaskHandle_t waitingTask;
+} ST7567transfer_t;
+
+static ST7567transfer_t transfer;
 
 static bool isAwake = true;
 static bool isInverted = false;
+static bool isRenderingToRemoteHead = false;
 
 void displayRenderRows(int16_t startRow, int16_t endRow)
 {
+	// The panel copy is read by the DMA until the previous render is sent
+	displayWaitForTransferComplete();
+
+	PERF_BEGIN(PERF_PROBE_DISPLAY_RENDER);
+
+	if (remoteHeadActive != isRenderingToRemoteHead)
+	{
+		isRenderingToRemoteHead = remoteHeadActive;
+		displayInvalidatePanel();
+	}
+
 	if(remoteHeadActive)
 	{
 		remoteHeadRenderRows(startRow,endRow);
 	}
 	else
 	{
-		taskENTER_CRITICAL();
-
-		uint8_t *rowPos = (displayGetScreenBuffer() + startRow * DISPLAY_SIZE_X);
+		transfer.count = 0;
 
 		for(int16_t row = startRow; row < endRow; row++)
 		{
-			ST7567transferCommand(0xb0 | row); // set Y
-			ST7567transferCommand(0x10 | 0); // set X (high MSB)
-			ST7567transferCommand(0x04);// 4 pixels from left
+			const uint8_t *spanData;
+			int16_t x;
+			int16_t length;
+
+			// DISPLAY_SPANS_MAX is the worst case of displayTakeDirtySpan()
+			while ((spanData = displayTakeDirtySpan(row, &x, &length)) != NULL)
+			{
+				ST7567span_t *span = &transfer.spans[transfer.count++];
 
-			ST7567transferData(rowPos, DISPLAY_SIZE_X, HAL_MAX_DELAY);
-			rowPos += DISPLAY_SIZE_X ;
+				span->commands[0] = (0xb0 | row); // set Y
+				span->commands[1] = (0x10 | ((x + DISPLAY_COLUMN_OFFSET) >> 4)); // set X (high MSB)
+				span->commands[2] = (0x00 | ((x + DISPLAY_COLUMN_OFFSET) & 0x0F)); // set X (low LSB)
+				span->length = length;
+				span->data = spanData;
+			}
 		}
 
-		taskEXIT_CRITICAL();
+		if (transfer.count > 0)
+		{
+			transfer.index = 0;
+			transfer.busy = true;
+
+			if (ST7567transferStartSpan() == false)
+			{
+				ST7567transferAbort();
+			}
+		}
 	}
+
+	PERF_END(PERF_PROBE_DISPLAY_RENDER);
 }
 
-static void ST7567transferData(uint8_t *rowpos, uint16_t dispsize, uint32_t maxdelay)
+// Blocks the calling task until the queued spans are sent, or the transfer timeout
+void displayWaitForTransferComplete(void)
 {
+	if (transfer.busy)
+	{
+		const TickType_t start = xTaskGetTickCount();
+
+		while (transfer.busy)
+		{
+			// The completion is signalled by a task notification. On the main task, this can only cause a spurious
+			// scheduler wake up (its events are kept aside), or take one it doesn't need.
+			transfer.waitingTask = xTaskGetCurrentTaskHandle();
+
+			if (transfer.busy)
+			{
+				ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ST7567_TRANSFER_TIMEOUT));
+			}
+
+			transfer.waitingTask = NULL;
+
+			if (transfer.busy && ((xTaskGetTickCount() - start) >= pdMS_TO_TICKS(ST7567_TRANSFER_TIMEOUT)))
+			{
+				ST7567transferAbort();
+			}
+		}
+	}
+
+	if (transfer.failed)
+	{
+		transfer.failed = false;
+		displayInvalidatePanel();
+	}
+}
+
+static bool ST7567transferStartSpan(void)
+{
+	ST7567span_t *span = &transfer.spans[transfer.index];
+
 	HAL_GPIO_WritePin(LCD_CS_GPIO_Port, LCD_CS_Pin, GPIO_PIN_RESET);
-	HAL_GPIO_WritePin(LCD_RS_GPIO_Port, LCD_RS_Pin, GPIO_PIN_SET);    //Data Mode
-	HAL_SPI_Transmit(&hspi2, rowpos, dispsize, maxdelay);
+	HAL_GPIO_WritePin(LCD_RS_GPIO_Port, LCD_RS_Pin, GPIO_PIN_RESET); // command mode
+	transfer.sendingData = false;
+
+	return (HAL_SPI_Transmit_DMA(&hspi2, span->commands, sizeof(span->commands)) == HAL_OK);
+}
+
+// Task side: stops the DMA, if any, after a failed start or a timeout
+static void ST7567transferAbort(void)
+{
+	HAL_SPI_Abort(&hspi2);
 	HAL_GPIO_WritePin(LCD_CS_GPIO_Port, LCD_CS_Pin, GPIO_PIN_SET);
+	transfer.busy = false;
+	transfer.failed = false;
+	displayInvalidatePanel();
+}
+
+// Interrupt side
+static void ST7567transferEnd(bool failed)
+{
+	TaskHandle_t waitingTask = transfer.waitingTask;
+
+	HAL_GPIO_WritePin(LCD_CS_GPIO_Port, LCD_CS_Pin, GPIO_PIN_SET);
+	transfer.failed = failed;
+	transfer.busy = false;
+
+	if (waitingTask != NULL)
+	{
+		BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+		vTaskNotifyGiveFromISR(waitingTask, &higherPriorityTaskWoken);
+		portYIELD_FROM_ISR(higherPriorityTaskWoken);
+	}
+}
+
+// SPI2 TX DMA completion (the HAL has waited for the last byte to be shifted out)
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+	if (hspi->Instance != SPI2)
+	{
+		return;
+	}
+
+	if (transfer.sendingData == false)
+	{
+		ST7567span_t *span = &transfer.spans[transfer.index];
+
+		HAL_GPIO_WritePin(LCD_RS_GPIO_Port, LCD_RS_Pin, GPIO_PIN_SET); // Data Mode
+		transfer.sendingData = true;
+
+		if (HAL_SPI_Transmit_DMA(&hspi2, (uint8_t *)span->data, span->length) != HAL_OK)
+		{
+			ST7567transferEnd(true);
+		}
+	}
+	else
+	{
+		HAL_GPIO_WritePin(LCD_CS_GPIO_Port, LCD_CS_Pin, GPIO_PIN_SET);
+
+		if (++transfer.index < transfer.count)
+		{
+			if (ST7567transferStartSpan() == false)
+			{
+				ST7567transferEnd(true);
+			}
+		}
+		else
+		{
+			ST7567transferEnd(false);
+		}
+	}
+}
+
+// SPI2 or DMA error: the rest of the queue is dropped, the next render will resend everything
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+	if (hspi->Instance != SPI2)
+	{
+		return;
+	}
+
+	ST7567transferEnd(true);
 }
 
 static void ST7567transferCommand(uint8_t data1)
@@ -78,6 +258,8 @@ static void ST7567transferCommand(uint8_t data1)
 	}
 	else
 	{
+		displayWaitForTransferComplete();
+
 		HAL_GPIO_WritePin(LCD_CS_GPIO_Port, LCD_CS_Pin, GPIO_PIN_RESET);
 		HAL_GPIO_WritePin(LCD_RS_GPIO_Port, LCD_RS_Pin, GPIO_PIN_RESET);// command mode// command mode
 		HAL_SPI_Transmit(&hspi2, &data1, 1, HAL_MAX_DELAY);
@@ -87,7 +269,6 @@ static void ST7567transferCommand(uint8_t data1)
 
 void displaySetInverseVideo(bool inverted)
 {
-	taskENTER_CRITICAL();
 	isInverted = inverted;
 	if (isInverted)
 	{
@@ -99,14 +280,10 @@ void displaySetInverseVideo(bool inverted)
 	}
 
 	ST7567transferCommand(0xAF); // Set Display Enable
-
-	taskEXIT_CRITICAL();
 }
 
 void displayBegin(bool inverted)
 {
-	taskENTER_CRITICAL();
-
 	ST7567transferCommand(0xE2); // System Reset
 
 	ST7567transferCommand(0x2F);// Voltage Follower On
@@ -127,18 +304,15 @@ void displayBegin(bool inverted)
 
 	ST7567transferCommand(0xAF); // enable
 
-	taskEXIT_CRITICAL();
-
+	displayInvalidatePanel();
 	displayClearBuf();
 	displayRender();
 }
 
 void displaySetContrast(uint8_t contrast)
 {
-	taskENTER_CRITICAL();
 	ST7567transferCommand(0x81);              // command to set contrast
 	ST7567transferCommand(contrast);          // set contrast
-	taskEXIT_CRITICAL();
 }
 
 
@@ -151,11 +325,12 @@ void displaySetDisplayPowerMode(bool wake)
 		return;
 	}
 
-	taskENTER_CRITICAL();
 	isAwake = wake;
 
 	if (wake)
 	{
+		displayInvalidatePanel();
+
 		// enter normal display mode
 		if (isInverted)
 		{
@@ -173,6 +348,4 @@ void displaySetDisplayPowerMode(bool wake)
 		ST7567transferCommand(0xAE); // "Set Display OFF" (text from datasheet)
 		ST7567transferCommand(0xA5); // "Set All-Pixel-ON" (text from datasheet)
 	}
-
-	taskEXIT_CRITICAL();
 }
@@ -49,6 +49,15 @@ const uint16_t HRC_CTCSSTones[] =
 
 static bool audioPathFromFM = true;
 static bool ampIsOn = false;
+static bool receiversArePowered = false;
+
+//
+// The synthesisers sequences are only sent when at least one register differs from the shadow, or the other VCO has
+// to be locked. The IF chips are only reset and programmed when their bandwidth changed, or the receivers power
+// has been cut since (see radioSetTx()). They lose what they are sent while the receivers are off, so it isn't
+// recorded in the shadow.
+//
+static CCM_DATA radioShadow_t radioShadow;
 
 RadioDevice_t currentRadioDeviceId = RADIO_DEVICE_PRIMARY;
 TRXDevice_t radioDevices[RADIO_DEVICE_MAX] = {
@@ -73,6 +82,75 @@ TRXDevice_t radioDevices[RADIO_DEVICE_MAX] = {
 
 TRXDevice_t *currentRadioDevice = &radioDevices[RADIO_DEVICE_PRIMARY];
 
+void radioShadowInvalidate(void)
+{
+	for (int i = 0; i < RADIO_SHADOW_BANDS_NUM; i++)
+	{
+		radioShadow.synthValid[i] = false;
+		radioShadow.ifValid[i] = false;
+	}
+}
+
+const radioShadow_t *radioGetShadow(void)
+{
+	return &radioShadow;
+}
+
+static void synthShadowStore(bool VHF, uint8_t add, uint32_t value)
+{
+	if (add < RADIO_SYNTH_REGISTERS_NUM)
+	{
+		radioShadow.synthRegs[(VHF ? RADIO_BAND_VHF : RADIO_BAND_UHF)][add] = value;
+	}
+	radioShadow.synthWritten++;
+}
+
+// The synthesiser is already locked for this VCO, with all these register values.
+static bool synthShadowHoldsAll(bool VHF, bool Tx, const uint8_t *addresses, const uint32_t *values, uint8_t count)
+{
+	int index = (VHF ? RADIO_BAND_VHF : RADIO_BAND_UHF);
+
+	if ((radioShadow.synthValid[index] == false) || (radioShadow.synthTx[index] != Tx))
+	{
+		return false;
+	}
+
+	for (uint8_t i = 0; i < count; i++)
+	{
+		if (radioShadow.synthRegs[index][addresses[i]] != values[i])
+		{
+			return false;
+		}
+	}
+
+	radioShadow.synthSkipped += count;
+	return true;
+}
+
+#if !defined(MD9600_VERSION_5)
+// For the fixed registers only
+static void synthTransferIfChanged(bool VHF, uint8_t add, uint32_t value)
+{
+	int index = (VHF ? RADIO_BAND_VHF : RADIO_BAND_UHF);
+
+	if (radioShadow.synthValid[index] && (radioShadow.synthRegs[index][add] == value))
+	{
+		radioShadow.synthSkipped++;
+		return;
+	}
+
+	SynthTransfer(VHF, add, value);
+}
+#endif
+
+static void synthShadowSetLocked(bool VHF, bool Tx)
+{
+	int index = (VHF ? RADIO_BAND_VHF : RADIO_BAND_UHF);
+
+	radioShadow.synthValid[index] = true;
+	radioShadow.synthTx[index] = Tx;
+}
+
 
 void radioPowerOn(void)
 {
@@ -113,6 +191,7 @@ void radioPowerOn(void)
 
 	//turn on the main power control
 	HAL_GPIO_WritePin(Power_Control_GPIO_Port, Power_Control_Pin, GPIO_PIN_SET);
+	radioShadowInvalidate();
 
 // The V4 VHF synthesiser needs to be initialised as soon as the power is applied. Otherwise it fails to lock.
 #if defined(MD9600_VERSION_4)
@@ -128,6 +207,7 @@ void radioSetRxLNAForDevice(RadioDevice_t deviceId)
 		HAL_GPIO_WritePin(C5_U_SW_GPIO_Port, C5_U_SW_Pin, GPIO_PIN_SET);
 		HAL_GPIO_WritePin(R5_V_SW_GPIO_Port, R5_V_SW_Pin, GPIO_PIN_SET);
 		HAL_GPIO_WritePin(R5_U_SW_GPIO_Port, R5_U_SW_Pin, GPIO_PIN_SET);
+		receiversArePowered = true;
 	}
 }
 
@@ -140,10 +220,12 @@ void radioPowerOff(void)
 	HAL_GPIO_WritePin(C5_U_SW_GPIO_Port, C5_U_SW_Pin, GPIO_PIN_RESET);
 	HAL_GPIO_WritePin(R5_V_SW_GPIO_Port, R5_V_SW_Pin, GPIO_PIN_RESET);
 	HAL_GPIO_WritePin(R5_U_SW_GPIO_Port, R5_U_SW_Pin, GPIO_PIN_RESET);
+	receiversArePowered = false;
 
 	//turn off the main power control
 	HAL_GPIO_WritePin(Power_Control_GPIO_Port, Power_Control_Pin, GPIO_PIN_RESET);
 	trxInvalidateCurrentFrequency();
+	radioShadowInvalidate();
 }
 
 void radioInit(void)
@@ -205,25 +287,42 @@ void radioSetMode(int mode)
 //this function initialises the AK2365A IF Chip in V1-V4 Radios for the specified band and bandwidth and needs to be called whenever the receiver is turned on.
 void radioSetIF(int band, bool wide)
 {
-	HAL_GPIO_WritePin(IF_RST_GPIO_Port, IF_RST_Pin, GPIO_PIN_RESET);     //Pulse the reset pin Low
-//	HAL_Delay(1);
-	for( volatile int i=0;i<100;i++);									//short delay to meet datasheet requirement of 1us
-	HAL_GPIO_WritePin(IF_RST_GPIO_Port, IF_RST_Pin, GPIO_PIN_SET);
-//	HAL_Delay(8);													   //allow time for the reset (this time is what the TYT Firmware uses)
-	IFTransfer(band, 0x08AA);                                           //Send the chip soft reset command to Reg 4
-//	HAL_Delay(2);
-	if (wide)
+	int index = ((band == RADIO_BAND_VHF) ? RADIO_BAND_VHF : RADIO_BAND_UHF);
+
+	if (radioShadow.ifValid[index] && (radioShadow.ifWide[index] == wide))
 	{
-		IFTransfer(band, 0x02F1);										  // Reg 1 values for 25Khz filtering
+		radioShadow.ifSkipped++;
 	}
 	else
 	{
-		IFTransfer(band, 0x02E9);										  // Reg 1 values for 12.5Khz filtering
+		HAL_GPIO_WritePin(IF_RST_GPIO_Port, IF_RST_Pin, GPIO_PIN_RESET);     //Pulse the reset pin Low
+//		HAL_Delay(1);
+		for( volatile int i=0;i<100;i++);									//short delay to meet datasheet requirement of 1us
+		HAL_GPIO_WritePin(IF_RST_GPIO_Port, IF_RST_Pin, GPIO_PIN_SET);
+//		HAL_Delay(8);													   //allow time for the reset (this time is what the TYT Firmware uses)
+
+		// The reset line is shared by both IF chips
+		radioShadow.ifValid[RADIO_BAND_VHF] = false;
+		radioShadow.ifValid[RADIO_BAND_UHF] = false;
+
+		IFTransfer(band, 0x08AA);                                           //Send the chip soft reset command to Reg 4
+//		HAL_Delay(2);
+		if (wide)
+		{
+			IFTransfer(band, 0x02F1);										  // Reg 1 values for 25Khz filtering
+		}
+		else
+		{
+			IFTransfer(band, 0x02E9);										  // Reg 1 values for 12.5Khz filtering
+		}
+		IFTransfer(band, 0x041D);										  // Reg 2 values for AGC
+		IFTransfer(band, 0x0600);										  // Reg 3 values for IF Gain=6dB (Default setting)
+		IFTransfer(band, 0x1601);										  // Reg B values for Auto AGC
+		IFTransfer(band, 0x1880);										  // Reg C values for Auto AGC
+
+		radioShadow.ifValid[index] = receiversArePowered;
+		radioShadow.ifWide[index] = wide;
 	}
-	IFTransfer(band, 0x041D);										  // Reg 2 values for AGC
-	IFTransfer(band, 0x0600);										  // Reg 3 values for IF Gain=6dB (Default setting)
-	IFTransfer(band, 0x1601);										  // Reg B values for Auto AGC
-	IFTransfer(band, 0x1880);										  // Reg C values for Auto AGC
 
 	//as we have just set the IF for a band we should also select that bands audio for receive
 	if (band == RADIO_BAND_VHF)				//VHF
@@ -238,6 +337,8 @@ void radioSetIF(int band, bool wide)
 
 void IFTransfer(bool band, uint16_t data1)
 {
+	radioShadow.ifWritten++;
+
 	//set the correct CE low
 	if (band == RADIO_BAND_VHF)
 	{
@@ -373,14 +474,19 @@ void radioSetFrequency(uint32_t freq, bool Tx)
 
 	//now send the register values to the Synthesiser chip. This is the order they are sent by the TYT firmware.
 
-	SynthTransfer(bandIsVHF, 8, reg8);
-	SynthTransfer(bandIsVHF, 9, reg9);
-	SynthTransfer(bandIsVHF, 5, reg5);
-	SynthTransfer(bandIsVHF, 0, reg0);
-	SynthTransfer(bandIsVHF, 2, reg2);
-	SynthTransfer(bandIsVHF, 1, reg1);
-	SynthTransfer(bandIsVHF, 6, reg6);
-	SynthTransfer(bandIsVHF, 7, reg7);
+	if (synthShadowHoldsAll(bandIsVHF, Tx, (const uint8_t []) { 8, 9, 5, 0, 2, 1, 6, 7 }, (const uint32_t []) { reg8, reg9, reg5, reg0, reg2, reg1, reg6, reg7 }, 8) == false)
+	{
+		//The fixed registers are only sent if they changed, the frequency ones always are, to relock the synthesiser.
+		synthTransferIfChanged(bandIsVHF, 8, reg8);
+		synthTransferIfChanged(bandIsVHF, 9, reg9);
+		synthTransferIfChanged(bandIsVHF, 5, reg5);
+		SynthTransfer(bandIsVHF, 0, reg0);
+		SynthTransfer(bandIsVHF, 2, reg2);
+		SynthTransfer(bandIsVHF, 1, reg1);
+		synthTransferIfChanged(bandIsVHF, 6, reg6);
+		synthTransferIfChanged(bandIsVHF, 7, reg7);
+		synthShadowSetLocked(bandIsVHF, Tx);
+	}
 
 	//As we have just changed the frequency we should also output the relevant tuning voltages.
 
@@ -404,6 +510,7 @@ void radioSetFrequency(uint32_t freq, bool Tx)
 //send the 16 bit value to the VHF or UHF Sky Synthesiser
 void SynthTransfer(bool VHF, uint8_t add, uint16_t data1)
 {
+	synthShadowStore(VHF, add, data1);
 	data1 = data1 | (add << 12);
 
 	//set the correct CE low
@@ -549,12 +656,17 @@ void radioSetFrequency(uint32_t freq, bool Tx)
 
 	//now send the register values to the Synthesiser chip. This is the order they are sent by the TYT firmware.
 
-	SynthTransfer(bandIsVHF, 5, reg5);
-	SynthTransfer(bandIsVHF, 6, reg6);
-	SynthTransfer(bandIsVHF, 3, reg3);
-	SynthTransfer(bandIsVHF, 4, reg4);
-	SynthTransfer(bandIsVHF, 1, reg1);
-	SynthTransfer(bandIsVHF, 2, reg2);
+	if (synthShadowHoldsAll(bandIsVHF, Tx, (const uint8_t []) { 5, 6, 3, 4, 1, 2 }, (const uint32_t []) { reg5, reg6, reg3, reg4, reg1, reg2 }, 6) == false)
+	{
+		//The fixed registers are only sent if they changed, the frequency ones always are, to relock the synthesiser.
+		synthTransferIfChanged(bandIsVHF, 5, reg5);
+		synthTransferIfChanged(bandIsVHF, 6, reg6);
+		synthTransferIfChanged(bandIsVHF, 3, reg3);
+		synthTransferIfChanged(bandIsVHF, 4, reg4);
+		SynthTransfer(bandIsVHF, 1, reg1);
+		SynthTransfer(bandIsVHF, 2, reg2);
+		synthShadowSetLocked(bandIsVHF, Tx);
+	}
 
 
 	//As we have just changed the frequency we should also output the relevant tuning voltages.
@@ -580,6 +692,7 @@ void radioSetFrequency(uint32_t freq, bool Tx)
 //send the 16 bit value to the VHF or UHF AK1590 Synthesiser
 void SynthTransfer(bool VHF, uint8_t add, uint32_t data1)
 {
+	synthShadowStore(VHF, add, data1);
 	data1 = (data1 << 4) | (add & 0x0F);
 
 	//set the correct CE low
@@ -758,22 +871,28 @@ void radioSetFrequency(uint32_t freq, bool Tx)
 
 	//now send the register values to the Synthesiser chip. This is the order they are sent by the TYT firmware.
 
-	SynthTransfer(bandIsVHF, 0x00, 0x2000);				//reset chip
-	//may need a delay here to allow time to reset.
-	SynthTransfer(bandIsVHF, 0x00, reg0);
-	SynthTransfer(bandIsVHF, 0x04, reg4);
-	SynthTransfer(bandIsVHF, 0x01, reg1);
-	SynthTransfer(bandIsVHF, 0x02, reg2);
-	SynthTransfer(bandIsVHF, 0x03, reg3);
-	SynthTransfer(bandIsVHF, 0x05, reg5);
-	SynthTransfer(bandIsVHF, 0x06, reg6);
-	SynthTransfer(bandIsVHF, 0x07, reg7);
-	SynthTransfer(bandIsVHF, 0x08, reg8);
-	SynthTransfer(bandIsVHF, 0x29, reg29);
-	SynthTransfer(bandIsVHF, 0x2A, reg2A);
-	SynthTransfer(bandIsVHF, 0x00, reg0 + 1);          //Enable Calibrate
-	//may need a delay here to allow time to Cal.
-	SynthTransfer(bandIsVHF, 0x00, reg0);
+	//The reset and calibration sequence is needed for any change, hence it's sent in full, or not at all.
+	if (synthShadowHoldsAll(bandIsVHF, Tx, (const uint8_t []) { 0x00, 0x04, 0x01, 0x02, 0x03, 0x05, 0x06, 0x07, 0x08, 0x29, 0x2A },
+			(const uint32_t []) { reg0, reg4, reg1, reg2, reg3, reg5, reg6, reg7, reg8, reg29, reg2A }, 11) == false)
+	{
+		SynthTransfer(bandIsVHF, 0x00, 0x2000);				//reset chip
+		//may need a delay here to allow time to reset.
+		SynthTransfer(bandIsVHF, 0x00, reg0);
+		SynthTransfer(bandIsVHF, 0x04, reg4);
+		SynthTransfer(bandIsVHF, 0x01, reg1);
+		SynthTransfer(bandIsVHF, 0x02, reg2);
+		SynthTransfer(bandIsVHF, 0x03, reg3);
+		SynthTransfer(bandIsVHF, 0x05, reg5);
+		SynthTransfer(bandIsVHF, 0x06, reg6);
+		SynthTransfer(bandIsVHF, 0x07, reg7);
+		SynthTransfer(bandIsVHF, 0x08, reg8);
+		SynthTransfer(bandIsVHF, 0x29, reg29);
+		SynthTransfer(bandIsVHF, 0x2A, reg2A);
+		SynthTransfer(bandIsVHF, 0x00, reg0 + 1);          //Enable Calibrate
+		//may need a delay here to allow time to Cal.
+		SynthTransfer(bandIsVHF, 0x00, reg0);
+		synthShadowSetLocked(bandIsVHF, Tx);
+	}
 
 	//As we have just changed the frequency we should also output the relevant tuning voltages.
 
@@ -799,6 +918,7 @@ void SynthTransfer(bool VHF, uint8_t add, uint16_t reg)
 {
 	uint32_t data1;
 
+	synthShadowStore(VHF, add, reg);
 	data1 = ((uint32_t)add << 16) + reg;
 
 	//Set the correct CE Low
@@ -830,6 +950,51 @@ void SynthTransfer(bool VHF, uint8_t add, uint16_t reg)
 	}
 	HAL_GPIO_WritePin(PLL_CLK_GPIO_Port, PLL_CLK_Pin, GPIO_PIN_RESET);
 }
+
+//Precompute the Synthesiser N and fractional values for both FSK symbols (freq - deviation and freq + deviation) of the Tx frequency,
+//so they can be keyed from an ISR without any computation. radioSetFrequency() must have been called first for this Tx frequency.
+bool radioFSKPrepare(uint32_t freq, uint32_t deviation, radioFSKConfig_t *config)
+{
+	uint16_t refdiv;
+	uint32_t ref;
+
+	config->bandIsVHF = (freq < 34900000);
+	refdiv = (config->bandIsVHF ? 8 : 4);
+	ref = 1680000 / refdiv;        //16.8 MHz reference Oscillator
+
+	for (int i = 0; i < 2; i++)
+	{
+		uint32_t symbolFreq = (i == 0) ? (freq - deviation) : (freq + deviation);
+		uint16_t N = symbolFreq / ref;
+		uint32_t frac = ((uint64_t)(symbolFreq % ref) * 16777216) / ref;     //convert remainder to 24 bit fractional value
+
+		config->reg1[i] = (frac >> 16) & 0xFF;
+		config->reg2[i] = frac & 0xFFFF;
+		config->reg4[i] = (N & 0xFF) + 0x3000;
+	}
+
+	return true;
+}
+
+//Switch the Tx frequency to one of the precomputed FSK symbols, no VCO calibration is done as the step is only a few kHz
+void radioFSKSetSymbol(const radioFSKConfig_t *config, bool high)
+{
+	int i = (high ? 1 : 0);
+
+	SynthTransfer(config->bandIsVHF, 0x04, config->reg4[i]);
+	SynthTransfer(config->bandIsVHF, 0x01, config->reg1[i]);
+	SynthTransfer(config->bandIsVHF, 0x02, config->reg2[i]);
+	SynthTransfer(config->bandIsVHF, 0x00, 0x003E);				//latch the new values
+}
+#else
+bool radioFSKPrepare(uint32_t freq, uint32_t deviation, radioFSKConfig_t *config)
+{
+	return false; // Not supported by the other Synthesisers yet
+}
+
+void radioFSKSetSymbol(const radioFSKConfig_t *config, bool high)
+{
+}
 #endif
 
 void radioSetTx(uint8_t band)
@@ -837,6 +1002,10 @@ void radioSetTx(uint8_t band)
 	//Turn off receiver voltages. (thats what the TYT firmware does, both receivers are on or off together)
 	HAL_GPIO_WritePin(R5_V_SW_GPIO_Port, R5_V_SW_Pin, GPIO_PIN_RESET);
 	HAL_GPIO_WritePin(R5_U_SW_GPIO_Port, R5_U_SW_Pin, GPIO_PIN_RESET);
+	receiversArePowered = false;
+	//The IF chips will have to be programmed again when the receivers are back on
+	radioShadow.ifValid[RADIO_BAND_VHF] = false;
+	radioShadow.ifValid[RADIO_BAND_UHF] = false;
 
 	//Configure HRC-6000 for transmit
 	if (trxGetMode() == RADIO_MODE_ANALOG)
@@ -908,6 +1077,7 @@ void radioSetRx(uint8_t band)
 
 	HAL_GPIO_WritePin(R5_V_SW_GPIO_Port, R5_V_SW_Pin, GPIO_PIN_SET);
 	HAL_GPIO_WritePin(R5_U_SW_GPIO_Port, R5_U_SW_Pin, GPIO_PIN_SET);
+	receiversArePowered = true;
 
 	trxIsTransmitting = false;
 	if (trxGetMode() == RADIO_MODE_ANALOG)
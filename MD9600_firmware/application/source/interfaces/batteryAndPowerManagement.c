@@ -54,12 +54,12 @@ static uint32_t lowBatteryCount = 0;
 #define LOW_BATTERY_VOLTAGE_RECOVERY_TIME          30000 // 30 seconds
 #define SUSPEND_LOW_BATTERY_RATE                   1000 // 1 second
 
-#define BATTERY_VOLTAGE_TICK_RELOAD                100
+#define BATTERY_VOLTAGE_UPDATE_PERIOD              100 // ms
 #define BATTERY_VOLTAGE_CALLBACK_TICK_RELOAD       20
 
 
 static int batteryVoltageCallbackTick = 0;
-static int batteryVoltageTick = BATTERY_VOLTAGE_TICK_RELOAD;
+static ticksTimer_t batteryVoltageTimer = { 0, 0 }; // expired, the first update happens straight away
 
 volatile float averageBatteryVoltage = 0;
 static volatile float previousAverageBatteryVoltage;
@@ -202,8 +202,8 @@ void batteryChecking(void)
 
 void batteryUpdate(void)
 {
-	batteryVoltageTick++;
-	if (batteryVoltageTick >= BATTERY_VOLTAGE_TICK_RELOAD)
+	// Time based, as the main loop doesn't run every ms when idle
+	if (ticksTimerHasExpired(&batteryVoltageTimer))
 	{
 		if (previousAverageBatteryVoltage != averageBatteryVoltage)
 		{
@@ -217,7 +217,7 @@ void batteryUpdate(void)
 			batteryVoltageCallbackTick = 0;
 		}
 
-		batteryVoltageTick = 0;
+		ticksTimerStart(&batteryVoltageTimer, BATTERY_VOLTAGE_UPDATE_PERIOD);
 	}
 }
 
@@ -29,6 +29,7 @@
 #include "user_interface/uiGlobals.h"
 #include "user_interface/uiUtilities.h"
 #include "interfaces/gps.h"
+#include "functions/aprs.h"
 #include "user_interface/uiLocalisation.h"
 #include "usb/usb_com.h"
 #if defined(PLATFORM_MD9600)
@@ -38,6 +39,7 @@
 #if defined(HAS_GPS)
 
 #define GPS_RX_BUFFERS_MAX                  3U
+#define GPS_INPUT_RESTART_PERIOD          500U // ms
 
 #if defined(LOG_GPS_DATA)
 #define LOG_RAM_BUF_SIZE                 4096U
@@ -102,6 +104,7 @@ static gpsReceiveData_t gpsRxData;
 
 
 static uint8_t gpsBufferIndexProcessing = 0U;
+static ticksTimer_t gpsInputRestartTimer = { 0, 0 };
 #if defined(STM32F405xx)
 static uint8_t gpsDMABuf[GPS_DMA_BUFFER_SIZE]; // double buffer (two halves) for GPS UART DMA receive
 #endif
@@ -741,7 +744,7 @@ void gpsTick(void)
 
 	if ((menuSystemGetCurrentMenuNumber() != UI_TX_SCREEN) &&
 			(nonVolatileSettings.gps >= GPS_MODE_OFF) &&
-			((ticksGetMillis() % 500) == 0)
+			ticksTimerHasExpired(&gpsInputRestartTimer)
 #if defined(STM32F405xx)
 			&& (HAL_DMA_GetState(&hdma_usart1_rx) != HAL_DMA_STATE_BUSY)
 #elif defined(CPU_MK22FN512VLL12)
@@ -750,6 +753,7 @@ void gpsTick(void)
 	)
 	{
 		gpsDataInputStartStop(true);
+		ticksTimerStart(&gpsInputRestartTimer, GPS_INPUT_RESTART_PERIOD);
 	}
 
 	if (gpsRxData.linesCount > 0U)
@@ -788,7 +792,7 @@ void gpsTick(void)
 			{
 				if (nonVolatileSettings.gps >= GPS_MODE_ON_NMEA)
 				{
-					USB_DEBUG_printf("%s\r\n", gpsLine);// Note. NMEA protocol requires CR LF
+					usbComSendNMEA(gpsLine);
 
 #if defined(LOG_GPS_DATA)
 					// log everything once per minute
@@ -930,6 +934,11 @@ void gpsTick(void)
 						gpsData.LongitudeHiRes = -gpsData.LongitudeHiRes;
 					}
 
+#if !defined(PLATFORM_GD77S)
+					// The heard APRS stations distance/bearing are recomputed when this moved
+					aprsHeardSetOwnPosition(gpsData.LatitudeHiRes, gpsData.LongitudeHiRes);
+#endif
+
 					if (((currentMenu != UI_TX_SCREEN) && (currentMenu != MENU_SATELLITE)) &&
 							(nonVolatileSettings.locationLat != gpsData.Latitude || nonVolatileSettings.locationLon != gpsData.Longitude))
 					{
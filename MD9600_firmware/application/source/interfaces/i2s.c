@@ -27,10 +27,13 @@
  */
 #include "main.h"
 #include "interfaces/i2s.h"
+#include "functions/cssDetector.h"
+#include "functions/dtmfDecoder.h"
 
 volatile bool g_TX_SAI_in_use = false;
 volatile bool isSending = false;
 volatile bool isReceiving = false;
+volatile bool isMonitoring = false;
 
 volatile bool stopOnNextI2SDMAInterrupt = false;
 
@@ -44,6 +47,7 @@ static void clearI2SBuffersAndFlags(void)
 	stopOnNextI2SDMAInterrupt = false;
 	isSending = false;
 	isReceiving = false;
+	isMonitoring = false;
 	 HAL_I2S_DMAStop(&hi2s3);
 	 __HAL_I2SEXT_FLUSH_RX_DR(&hi2s3);
 	g_TX_SAI_in_use = false;
@@ -62,6 +66,13 @@ void HAL_I2SEx_TxRxHalfCpltCallback(I2S_HandleTypeDef *hi2s)
 		{
 			soundReceiveRefillData(0);
 		}
+
+		// The RX audio is available whenever the mic isn't captured
+		if (isReceiving == false)
+		{
+			dtmfDecoderProcessSamples((int16_t *)i2s_Rx_Buffer[0], WAV_BUFFER_SIZE, 2); // 2 x (WAV_BUFFER_SIZE / 2) samples, Left Channel only
+			cssDetectorProcessSamples((int16_t *)i2s_Rx_Buffer[0], WAV_BUFFER_SIZE, 2);
+		}
 	}
 	else
 	{
@@ -81,6 +92,13 @@ void HAL_I2SEx_TxRxCpltCallback(I2S_HandleTypeDef *hi2s)
 		{
 			soundReceiveRefillData(1);
 		}
+
+		// The RX audio is available whenever the mic isn't captured
+		if (isReceiving == false)
+		{
+			dtmfDecoderProcessSamples((int16_t *)i2s_Rx_Buffer[1], WAV_BUFFER_SIZE, 2); // 2 x (WAV_BUFFER_SIZE / 2) samples, Left Channel only
+			cssDetectorProcessSamples((int16_t *)i2s_Rx_Buffer[1], WAV_BUFFER_SIZE, 2);
+		}
 	}
 	else
 	{
@@ -98,6 +116,17 @@ void I2SStartDMA(uint16_t *txbuff, uint16_t *rxbuff, size_t bufferLen)
 	HAL_I2SEx_TransmitReceive_DMA(&hi2s3, txbuff, rxbuff, bufferLen);
 }
 
+// Immediately stops the DMA transfer started only for the RX audio capture, so the I2S bus can be used to play/record sound.
+void I2SMonitorStop(void)
+{
+	if (isMonitoring)
+	{
+		isMonitoring = false;
+		HAL_I2S_DMAStop(&hi2s3);
+		__HAL_I2SEXT_FLUSH_RX_DR(&hi2s3);
+	}
+}
+
 void I2SReset(void)
 {
 
@@ -43,8 +43,11 @@ bool interruptsClearPinFlags(uint32_t *port, uint32_t pin)
 	return true;
 }
 
+static volatile bool c6000InterruptsDisabled = false;
+
 void interruptsDisableC6000Interrupts(void)
 {
+	c6000InterruptsDisabled = true;
 	HAL_NVIC_DisableIRQ(EXTI0_IRQn);
 	HAL_NVIC_DisableIRQ(EXTI1_IRQn);
 	HAL_NVIC_DisableIRQ(EXTI2_IRQn);
@@ -55,4 +58,11 @@ void interruptsEnableC6000Interrupts(void)
 	HAL_NVIC_EnableIRQ(EXTI2_IRQn);
 	HAL_NVIC_EnableIRQ(EXTI1_IRQn);
 	HAL_NVIC_EnableIRQ(EXTI0_IRQn);
+	c6000InterruptsDisabled = false;
+}
+
+// The deferred HR-C6000 interrupt processing has to hold off while the interrupts are masked
+bool interruptsC6000InterruptsAreDisabled(void)
+{
+	return c6000InterruptsDisabled;
 }
@@ -156,7 +156,7 @@ static void remoteAddCommand(uint8_t com)
 	remoteTxBuff[txBuffPoint++] = com;
 }
 
-static void remoteAddData(uint8_t *dat, uint8_t len)
+static void remoteAddData(const uint8_t *dat, uint8_t len)
 {
 	remoteTxBuff[txBuffPoint++] = 'D';
 	remoteTxBuff[txBuffPoint++] = len;
@@ -176,16 +176,20 @@ void remoteHeadRenderRows(int16_t startRow, int16_t endRow)
 	taskENTER_CRITICAL();
 	txBuffPoint = 0;
 
-	uint8_t *rowPos = (displayGetScreenBuffer() + startRow * DISPLAY_SIZE_X);
-
 	for (int16_t row = startRow; row < endRow; row++)
 	{
-		remoteAddCommand(0xb0 | row); // set Y
-		remoteAddCommand(0x10 | 0); // set X (high MSB)
-		remoteAddCommand(0x04); // 4 pixels from left
+		const uint8_t *spanData;
+		int16_t x;
+		int16_t length;
+
+		while ((spanData = displayTakeDirtySpan(row, &x, &length)) != NULL)
+		{
+			remoteAddCommand(0xb0 | row); // set Y
+			remoteAddCommand(0x10 | ((x + DISPLAY_COLUMN_OFFSET) >> 4)); // set X (high MSB)
+			remoteAddCommand(0x00 | ((x + DISPLAY_COLUMN_OFFSET) & 0x0F)); // set X (low LSB)
 
-		remoteAddData(rowPos, DISPLAY_SIZE_X);
-		rowPos += DISPLAY_SIZE_X;
+			remoteAddData(spanData, length);
+		}
 	}
 
 	remoteStartTx();
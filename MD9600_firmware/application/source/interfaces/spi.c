@@ -27,14 +27,90 @@
  */
 
 #include <stdbool.h>
+#include <string.h>
 #include "interfaces/hr-c6000_spi.h"
 #include "main.h"
 
 
 
+// Only taken and released inside a critical section, which also masks all the interrupt handlers using SPI0,
+// so nothing that can run while it's held ever finds it taken (it only guards against reentrancy).
 volatile bool SPI0inUse = false;
 volatile bool SPI1inUse = false;
 
+//
+// Shadow copy of the HR-C6000 registers, pages 0x01 and 0x04 (the other pages are buffers).
+//
+// Every write goes through the shadow, so the *IfChanged() functions can skip a configuration
+// register write when the chip already holds that value. Writing the modules reset register (page 0x04, 0x00),
+// or calling SPI0ShadowInvalidate(), drops the whole shadow, hence the next writes will be sent.
+//
+#define SPI0_SHADOW_PAGE_SIZE  256U
+
+static CCM_DATA struct
+{
+	uint8_t  values[SPI0_SHADOW_PAGES_NUM][SPI0_SHADOW_PAGE_SIZE];
+	uint32_t valid[SPI0_SHADOW_PAGES_NUM][SPI0_SHADOW_PAGE_SIZE / 32];
+	uint32_t written;
+	uint32_t skipped;
+} spi0Shadow;
+
+static inline int spi0ShadowPageIndex(uint8_t page)
+{
+	return ((page == 0x01) ? 0 : ((page == 0x04) ? 1 : -1));
+}
+
+// Needs to be called with the SPI0 locked
+static void spi0ShadowStore(uint8_t page, uint8_t reg, uint8_t val)
+{
+	int index = spi0ShadowPageIndex(page);
+
+	if (index < 0)
+	{
+		return;
+	}
+
+	if ((page == 0x04) && (reg == 0x00)) // Modules reset, all the registers are back to their defaults
+	{
+		SPI0ShadowInvalidate();
+		return;
+	}
+
+	spi0Shadow.values[index][reg] = val;
+	spi0Shadow.valid[index][reg >> 5] |= (1U << (reg & 0x1F));
+}
+
+static bool spi0ShadowMatches(uint8_t page, uint8_t reg, uint8_t val)
+{
+	int index = spi0ShadowPageIndex(page);
+
+	return ((index >= 0) && (spi0Shadow.valid[index][reg >> 5] & (1U << (reg & 0x1F))) && (spi0Shadow.values[index][reg] == val));
+}
+
+void SPI0ShadowInvalidate(void)
+{
+	memset(spi0Shadow.valid, 0, sizeof(spi0Shadow.valid));
+}
+
+bool SPI0ShadowGet(uint8_t page, uint8_t reg, uint8_t *val)
+{
+	int index = spi0ShadowPageIndex(page);
+
+	if ((index < 0) || ((spi0Shadow.valid[index][reg >> 5] & (1U << (reg & 0x1F))) == 0))
+	{
+		return false;
+	}
+
+	*val = spi0Shadow.values[index][reg];
+	return true;
+}
+
+void SPI0ShadowGetStats(uint32_t *written, uint32_t *skipped)
+{
+	*written = spi0Shadow.written;
+	*skipped = spi0Shadow.skipped;
+}
+
 void SPIInit(void)
 {
 
@@ -55,40 +131,62 @@ int SPI0WritePageRegByte(uint8_t page, uint8_t reg, uint8_t val)
 	uint8_t txBuf[3];
 	UBaseType_t SavedInterruptStatus;
 
+	SavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
 	if (SPI0inUse)
 	{
+		taskEXIT_CRITICAL_FROM_ISR(SavedInterruptStatus);
 		return -1;
 	}
 	SPI0inUse = true;
-	SavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
 	txBuf[0] = page;
 	txBuf[1] = reg;
 	txBuf[2] = val;
 
 	SPI0Write(txBuf,3);
+	spi0ShadowStore(page, reg, val);
+	spi0Shadow.written++;
 
 	SPI0inUse = false;
 	taskEXIT_CRITICAL_FROM_ISR(SavedInterruptStatus);
 	return 0;
 }
 
+// Only for configuration registers, never for the command, status or interrupt ones.
+int SPI0WritePageRegByteIfChanged(uint8_t page, uint8_t reg, uint8_t val)
+{
+	UBaseType_t SavedInterruptStatus;
+	bool unchanged;
+
+	SavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+	unchanged = spi0ShadowMatches(page, reg, val);
+	if (unchanged)
+	{
+		spi0Shadow.skipped++;
+	}
+	taskEXIT_CRITICAL_FROM_ISR(SavedInterruptStatus);
+
+	return (unchanged ? 0 : SPI0WritePageRegByte(page, reg, val));
+}
+
 
 int SPI0WritePageRegByteExtended(uint8_t page, uint16_t reg, uint8_t val)
 {
 	uint8_t txBuf[4];
 	UBaseType_t SavedInterruptStatus;
+	SavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
 	if (SPI0inUse)
 	{
+		taskEXIT_CRITICAL_FROM_ISR(SavedInterruptStatus);
 		return -1;
 	}
 	SPI0inUse = true;
-	SavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
 	txBuf[0] = page | 0x40;
 	txBuf[2] = (reg >> 8) & 0x07;
 	txBuf[1] = reg & 0xFF;
 	txBuf[3] = val;
 
 	SPI0Write(txBuf,4);
+	spi0Shadow.written++;
 
 	SPI0inUse = false;
 	taskEXIT_CRITICAL_FROM_ISR(SavedInterruptStatus);
@@ -103,12 +201,13 @@ int SPI0ReadPageRegByte(uint8_t page, uint8_t reg, volatile uint8_t *val)
 	uint8_t rxBuf[3];
 	uint8_t txBuf[3];
 	UBaseType_t SavedInterruptStatus;
+	SavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
 	if (SPI0inUse)
 	{
+		taskEXIT_CRITICAL_FROM_ISR(SavedInterruptStatus);
 		return -1;
 	}
 	SPI0inUse = true;
-	SavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
 	txBuf[0] = page | 0x80;
 	txBuf[1] = reg;
 	txBuf[2] = 0xFF;
@@ -149,11 +248,12 @@ int SPI0WritePageRegByteArray(uint8_t page, uint8_t reg, const uint8_t *values,
 		return kStatus_InvalidArgument;
 	}
 
+	SavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
 	if (SPI0inUse)
 	{
+		taskEXIT_CRITICAL_FROM_ISR(SavedInterruptStatus);
 		return -1;
 	}
-	SavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
 	SPI0inUse = true;
 
 	txBuf[0] = page;
@@ -161,6 +261,15 @@ int SPI0WritePageRegByteArray(uint8_t page, uint8_t reg, const uint8_t *values,
 	memcpy(txBuf + 2, values, length);
 
 	SPI0Write(txBuf, length + 2);
+	spi0Shadow.written++;
+
+	if (spi0ShadowPageIndex(page) >= 0)
+	{
+		for (uint8_t i = 0; (i < length) && ((reg + i) < SPI0_SHADOW_PAGE_SIZE); i++)
+		{
+			spi0ShadowStore(page, (reg + i), values[i]);
+		}
+	}
 
 	SPI0inUse = false;
 	taskEXIT_CRITICAL_FROM_ISR(SavedInterruptStatus);
@@ -178,11 +287,12 @@ int SPI0ReadPageRegByteArray(uint8_t page, uint8_t reg, volatile uint8_t *values
 		return kStatus_InvalidArgument;
 	}
 
+	SavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
 	if (SPI0inUse)
 	{
+		taskEXIT_CRITICAL_FROM_ISR(SavedInterruptStatus);
 		return -1;
 	}
-	SavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
 	SPI0inUse = true;
 
 	txBuf[0] = page | 0x80;
@@ -202,6 +312,138 @@ int SPI0ReadPageRegByteArray(uint8_t page, uint8_t reg, volatile uint8_t *values
 	return 0;
 }
 
+//
+// Register write batches.
+//
+// The writes are queued as ready to send frames, then all sent in a single critical section, instead of
+// entering one per register. A write to the register following the previous one, in the same page, is merged
+// in the previous frame, as the HR-C6000 auto increments the register address (SPI0WritePageRegByteArray()
+// relies on this too). The extended register writes are never merged.
+//
+// When a batch is full, it's committed before queuing the new write. If that commit fails, the write functions
+// return -1 without queuing anything, and the batch is left as it was, ready to be committed and the write retried.
+//
+void SPI0BatchInit(spi0Batch_t *batch)
+{
+	batch->length = 0;
+	batch->frameCount = 0;
+}
+
+static int spi0BatchAddFrame(spi0Batch_t *batch, const uint8_t *header, uint8_t headerLength, uint8_t val)
+{
+	// Full, send what has been queued so far
+	if ((batch->frameCount >= SPI0_BATCH_FRAMES_MAX) || ((batch->length + headerLength + 1U) > SPI0_BATCH_BUFFER_SIZE))
+	{
+		if (SPI0BatchCommit(batch) != 0)
+		{
+			return -1;
+		}
+	}
+
+	memcpy(&batch->buffer[batch->length], header, headerLength);
+	batch->buffer[batch->length + headerLength] = val;
+	batch->length += (headerLength + 1);
+	batch->frameLengths[batch->frameCount++] = (headerLength + 1);
+
+	return 0;
+}
+
+int SPI0BatchWritePageRegByte(spi0Batch_t *batch, uint8_t page, uint8_t reg, uint8_t val)
+{
+	if ((batch->frameCount > 0) && (batch->lastIsExtended == false) && (batch->lastPage == page) &&
+			(batch->lastReg < 0xFF) && ((batch->lastReg + 1) == reg) && (batch->length < SPI0_BATCH_BUFFER_SIZE))
+	{
+		batch->buffer[batch->length++] = val;
+		batch->frameLengths[batch->frameCount - 1]++;
+	}
+	else
+	{
+		const uint8_t header[2] = { page, reg };
+
+		if (spi0BatchAddFrame(batch, header, sizeof(header), val) != 0)
+		{
+			return -1; // Not queued, the next write must not be merged in the previous frame
+		}
+	}
+
+	batch->lastPage = page;
+	batch->lastReg = reg;
+	batch->lastIsExtended = false;
+
+	return 0;
+}
+
+// Only for configuration registers, see SPI0WritePageRegByteIfChanged()
+int SPI0BatchWritePageRegByteIfChanged(spi0Batch_t *batch, uint8_t page, uint8_t reg, uint8_t val)
+{
+	if (spi0ShadowMatches(page, reg, val))
+	{
+		spi0Shadow.skipped++;
+		return 0;
+	}
+
+	return SPI0BatchWritePageRegByte(batch, page, reg, val);
+}
+
+int SPI0BatchWritePageRegByteExtended(spi0Batch_t *batch, uint8_t page, uint16_t reg, uint8_t val)
+{
+	const uint8_t header[3] = { (page | 0x40), (reg & 0xFF), ((reg >> 8) & 0x07) };
+
+	if (spi0BatchAddFrame(batch, header, sizeof(header), val) != 0)
+	{
+		return -1;
+	}
+
+	batch->lastPage = page;
+	batch->lastReg = reg;
+	batch->lastIsExtended = true;
+
+	return 0;
+}
+
+// Sends all the queued frames, and empties the batch. It's kept as is if the SPI is already in use.
+int SPI0BatchCommit(spi0Batch_t *batch)
+{
+	UBaseType_t SavedInterruptStatus;
+	uint8_t *frame = batch->buffer;
+
+	if (batch->frameCount == 0)
+	{
+		return 0;
+	}
+
+	SavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+	if (SPI0inUse)
+	{
+		taskEXIT_CRITICAL_FROM_ISR(SavedInterruptStatus);
+		return -1;
+	}
+	SPI0inUse = true;
+
+	for (uint8_t i = 0; i < batch->frameCount; i++)
+	{
+		SPI0Write(frame, batch->frameLengths[i]);
+
+		if ((frame[0] & 0x40) == 0) // extended registers are not shadowed
+		{
+			for (uint8_t v = 2; (v < batch->frameLengths[i]) && ((frame[1] + v - 2U) < SPI0_SHADOW_PAGE_SIZE); v++)
+			{
+				spi0ShadowStore(frame[0], (frame[1] + v - 2), frame[v]);
+			}
+		}
+
+		frame += batch->frameLengths[i];
+	}
+	spi0Shadow.written += batch->frameCount;
+
+	SPI0inUse = false;
+	taskEXIT_CRITICAL_FROM_ISR(SavedInterruptStatus);
+
+	SPI0BatchInit(batch);
+
+	return 0;
+}
+
 void SPI0Write(uint8_t *txBuf, uint8_t length)
 {
 	uint8_t val;
@@ -35,6 +35,7 @@
 #include "interfaces/adc.h"
 #include "io/buttons.h"
 #include "interfaces/remoteHead.h"
+#include "functions/scheduler.h"
 
 // Front Panel Buttons
 typedef struct
@@ -219,6 +220,12 @@ void keyboardReset(void)
 	keyState = KEY_WAIT_RELEASED;
 }
 
+// No key pressed, being debounced or waiting for its alpha timeout, so the keyboard doesn't need to be scanned every ms.
+bool keyboardIsIdle(void)
+{
+	return ((keyState == KEY_IDLE) && (keypadAlphaKey == 0));
+}
+
 bool keyboardKeyIsDTMFKey(char key)
 {
 	switch (key)
@@ -312,6 +319,9 @@ void rotaryEncoderISR(void)
 			rotaryData.lastA = pinA;		// Inc/Dec according to rotation
 			rotaryData.Direction = ((pinA != pinB) ? 1 : -1);
 			rotaryData.Count += rotaryData.Direction;
+
+			// Wake the main task up, it may be sleeping until its next keyboard scan
+			schedulerPostEventFromISR(SCHEDULER_EVENT_INPUT);
 		}
 	}
 }
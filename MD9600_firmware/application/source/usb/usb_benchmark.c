@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include <string.h>
+#include "main.h"
+#include "functions/ticks.h"
+#include "functions/cpuStats.h"
+#include "usb/usb_com.h"
+#include "usb/usb_benchmark.h"
+
+//
+// USB CDC benchmark, entered and left with the CPS 'B' command.
+//
+// While it runs, the received data bypasses the CPS and MMDVM parsers: usbBenchmarkFeed() is called from
+// the USB receive callback, and usbBenchmarkTick() from tick_com_request(). The round trip times are
+// measured with the run time counter, from the probe submission to the reception of its last byte,
+// so they include the host turnaround. The DWT cycle counter can't be used, as it stops while the idle
+// task sleeps in WFI, waiting for the echo.
+//
+#define USB_BENCHMARK_TX_PER_TICK        4U
+
+typedef struct
+{
+	usbBenchmarkMode_t mode;
+	uint32_t           packetSize;
+	uint32_t           duration;
+	uint32_t           startTime;
+	uint32_t           elapsed;
+	bool               running;
+	uint32_t           sequence;
+	volatile bool      probeInFlight; // set by the tick, cleared by the receive callback
+	uint32_t           probeSequence;
+	uint8_t            probeHeader[4]; // sequence number of the echo being received
+	uint32_t           probeSentCounter;
+	uint32_t           probeSentTime;
+	volatile uint32_t  probeReceived; // bytes of the current probe sent back so far
+	volatile uint32_t  rxBytes;
+	volatile uint32_t  rxPackets;
+	uint32_t           txBytes;
+	uint32_t           txPackets;
+	volatile uint32_t  rttSamples;
+	uint32_t           rttLost;
+	volatile uint32_t  rttMin;
+	volatile uint32_t  rttMax;
+	volatile uint32_t  rttHistogram[USB_BENCHMARK_RTT_BUCKETS];
+} usbBenchmarkData_t;
+
+static usbBenchmarkData_t usbBenchmark;
+
+// Called from the CPS request handler, before the USB mode is switched.
+bool usbBenchmarkStart(usbBenchmarkMode_t mode, uint32_t packetSize, uint32_t duration)
+{
+	if ((mode < USB_BENCHMARK_MODE_ECHO) || (mode > USB_BENCHMARK_MODE_SOURCE) ||
+			(packetSize < 4) || (packetSize > COM_BUFFER_SIZE) ||
+			(duration == 0) || (duration > USB_BENCHMARK_DURATION_MAX))
+	{
+		return false;
+	}
+
+	memset(&usbBenchmark, 0, sizeof(usbBenchmark));
+	usbBenchmark.mode = mode;
+	usbBenchmark.packetSize = packetSize;
+	usbBenchmark.duration = duration;
+	usbBenchmark.rttMin = UINT32_MAX;
+
+	// Fixed pattern, only the sequence number (first 4 bytes) changes from one packet to the next
+	for (uint32_t i = 0; i < packetSize; i++)
+	{
+		usbComSendBuf[i] = i;
+	}
+
+	usbBenchmark.startTime = ticksGetMillis();
+	usbBenchmark.running = true;
+
+	return true;
+}
+
+// Called from the USB receive callback (ISR context), once per USB packet.
+// In echo mode, the echo is only accepted if it starts with the sequence number of the probe in flight, so that a
+// late echo of a timed out probe is dropped instead of being measured against the next one.
+void usbBenchmarkFeed(const uint8_t *data, uint32_t length)
+{
+	if (usbBenchmark.running == false)
+	{
+		return;
+	}
+
+	usbBenchmark.rxBytes += length;
+	usbBenchmark.rxPackets++;
+
+	if ((usbBenchmark.mode == USB_BENCHMARK_MODE_ECHO) && usbBenchmark.probeInFlight)
+	{
+		// The host may split the sequence number over several packets
+		if (usbBenchmark.probeReceived < sizeof(usbBenchmark.probeHeader))
+		{
+			while ((usbBenchmark.probeReceived < sizeof(usbBenchmark.probeHeader)) && (length > 0))
+			{
+				usbBenchmark.probeHeader[usbBenchmark.probeReceived++] = *data++;
+				length--;
+			}
+
+			if (usbBenchmark.probeReceived < sizeof(usbBenchmark.probeHeader))
+			{
+				return;
+			}
+
+			if ((((uint32_t)usbBenchmark.probeHeader[0] << 24) | ((uint32_t)usbBenchmark.probeHeader[1] << 16) |
+					((uint32_t)usbBenchmark.probeHeader[2] << 8) | usbBenchmark.probeHeader[3]) != usbBenchmark.probeSequence)
+			{
+				usbBenchmark.probeReceived = 0;
+				return;
+			}
+		}
+
+		usbBenchmark.probeReceived += length;
+
+		if (usbBenchmark.probeReceived >= usbBenchmark.packetSize)
+		{
+			uint32_t rtt = ((cpuStatsGetRunTimeCounter() - usbBenchmark.probeSentCounter) / (CPU_STATS_COUNTER_FREQUENCY / 1000000U));
+			uint32_t bucket = (rtt / USB_BENCHMARK_RTT_BUCKET);
+
+			usbBenchmark.rttHistogram[((bucket < USB_BENCHMARK_RTT_BUCKETS) ? bucket : (USB_BENCHMARK_RTT_BUCKETS - 1))]++;
+			usbBenchmark.rttSamples++;
+
+			if (rtt < usbBenchmark.rttMin)
+			{
+				usbBenchmark.rttMin = rtt;
+			}
+
+			if (rtt > usbBenchmark.rttMax)
+			{
+				usbBenchmark.rttMax = rtt;
+			}
+
+			usbBenchmark.probeInFlight = false;
+		}
+	}
+}
+
+static bool usbBenchmarkSend(void)
+{
+	usbComSendBuf[0] = (usbBenchmark.sequence >> 24) & 0xFF;
+	usbComSendBuf[1] = (usbBenchmark.sequence >> 16) & 0xFF;
+	usbComSendBuf[2] = (usbBenchmark.sequence >> 8) & 0xFF;
+	usbComSendBuf[3] = (usbBenchmark.sequence >> 0) & 0xFF;
+
+	if (CDC_Transmit_FS((uint8_t *)usbComSendBuf, usbBenchmark.packetSize) != USBD_OK)
+	{
+		return false;
+	}
+
+	usbBenchmark.sequence++;
+	usbBenchmark.txBytes += usbBenchmark.packetSize;
+	usbBenchmark.txPackets++;
+
+	return true;
+}
+
+// Returns false once the benchmark is over
+bool usbBenchmarkTick(void)
+{
+	if (usbBenchmark.running == false)
+	{
+		return false;
+	}
+
+	uint32_t now = ticksGetMillis();
+
+	if ((now - usbBenchmark.startTime) >= usbBenchmark.duration)
+	{
+		usbBenchmark.elapsed = (now - usbBenchmark.startTime);
+		usbBenchmark.running = false;
+		return false;
+	}
+
+	switch (usbBenchmark.mode)
+	{
+		case USB_BENCHMARK_MODE_ECHO:
+			if (usbBenchmark.probeInFlight && ((now - usbBenchmark.probeSentTime) >= USB_BENCHMARK_PROBE_TIMEOUT))
+			{
+				usbBenchmark.probeInFlight = false;
+				usbBenchmark.rttLost++;
+			}
+
+			if (usbBenchmark.probeInFlight == false)
+			{
+				// Armed before the submission, the echo could come back before CDC_Transmit_FS() returns
+				usbBenchmark.probeReceived = 0;
+				usbBenchmark.probeSequence = usbBenchmark.sequence;
+				usbBenchmark.probeSentTime = now;
+				usbBenchmark.probeSentCounter = cpuStatsGetRunTimeCounter();
+				usbBenchmark.probeInFlight = true;
+
+				if (usbBenchmarkSend() == false)
+				{
+					usbBenchmark.probeInFlight = false;
+				}
+			}
+			break;
+
+		case USB_BENCHMARK_MODE_SINK:
+			break;
+
+		case USB_BENCHMARK_MODE_SOURCE:
+			for (uint32_t i = 0; (i < USB_BENCHMARK_TX_PER_TICK) && usbBenchmarkSend(); i++);
+			break;
+	}
+
+	return true;
+}
+
+void usbBenchmarkGetResults(usbBenchmarkResults_t *results)
+{
+	memset(results, 0, sizeof(usbBenchmarkResults_t));
+
+	results->mode = usbBenchmark.mode;
+	results->duration = (usbBenchmark.running ? (ticksGetMillis() - usbBenchmark.startTime) : usbBenchmark.elapsed);
+	results->rxBytes = usbBenchmark.rxBytes;
+	results->rxPackets = usbBenchmark.rxPackets;
+	results->txBytes = usbBenchmark.txBytes;
+	results->txPackets = usbBenchmark.txPackets;
+	results->rttSamples = usbBenchmark.rttSamples;
+	results->rttLost = usbBenchmark.rttLost;
+
+	if (usbBenchmark.rttSamples > 0)
+	{
+		const uint32_t PERCENTILES[] = { 50, 90, 99 };
+		uint32_t *percentileResults[] = { &results->rttP50, &results->rttP90, &results->rttP99 };
+		uint32_t cumulated = 0;
+		uint32_t p = 0;
+
+		results->rttMin = usbBenchmark.rttMin;
+		results->rttMax = usbBenchmark.rttMax;
+
+		for (uint32_t i = 0; (i < USB_BENCHMARK_RTT_BUCKETS) && (p < (sizeof(PERCENTILES) / sizeof(PERCENTILES[0]))); i++)
+		{
+			cumulated += usbBenchmark.rttHistogram[i];
+
+			while ((p < (sizeof(PERCENTILES) / sizeof(PERCENTILES[0]))) && ((cumulated * 100) >= (usbBenchmark.rttSamples * PERCENTILES[p])))
+			{
+				// The last bucket is open ended
+				*percentileResults[p] = ((i < (USB_BENCHMARK_RTT_BUCKETS - 1)) ? ((i + 1) * USB_BENCHMARK_RTT_BUCKET) : results->rttMax);
+				p++;
+			}
+		}
+	}
+}
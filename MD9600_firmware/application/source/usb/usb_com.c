@@ -32,6 +32,7 @@
 #include "user_interface/uiUtilities.h"
 #include "user_interface/menuSystem.h"
 #include "usb/usb_com.h"
+#include "usb/usb_benchmark.h"
 #include "functions/ticks.h"
 #include "interfaces/wdog.h"
 #include "hardware/HR-C6000.h"
@@ -42,6 +43,12 @@
 #include "main.h"
 #include "interfaces/settingsStorage.h"
 #include "interfaces/gps.h"
+#include "functions/trace.h"
+#include "functions/perf.h"
+#include "functions/cpuStats.h"
+#include "functions/crc32.h"
+#include "hardware/radioHardwareInterface.h"
+#include "interfaces/hr-c6000_spi.h"
 
 #define GITVERSIONREV GITVERSION
 
@@ -72,15 +79,87 @@ enum CPS_ACCESS_AREA
 
 
 static void handleCPSRequest(void);
+static void cpsFlashJobProcess(void);
+static void cpsStreamProcess(void);
 
 volatile int com_request = 0;
 volatile uint8_t com_requestbuffer[COM_REQUESTBUFFER_SIZE];
-volatile uint8_t usbComSendBuf[COM_BUFFER_SIZE];
+volatile uint8_t usbComSendBuf[COM_BUFFER_SIZE] __attribute__((aligned(4))); // aligned, the trace records are read straight into it
 
 static int sector = -1;
-volatile int comRecvMMDVMIndexIn = 0;
-volatile int comRecvMMDVMIndexOut = 0;
-volatile int comRecvMMDVMFrameCount = 0;
+
+#define CPS_SECTOR_SIZE                4096U
+#define CPS_SECTOR_PAGES                 16U
+#define CPS_FLASH_ERASE_TIMEOUT         500U // ms
+#define CPS_FLASH_PAGE_TIMEOUT           10U // ms
+#define CPS_STREAM_CHUNKS_PER_TICK        4U
+#define CPS_HASH_READ_SIZE              256U
+
+typedef enum
+{
+	CPS_FLASH_JOB_IDLE = 0,
+	CPS_FLASH_JOB_ERASING,
+	CPS_FLASH_JOB_PROGRAMMING
+} cpsFlashJobState_t;
+
+// Sector being erased/programmed in the background, while the CPS sends the next one
+typedef struct
+{
+	cpsFlashJobState_t state;
+	uint8_t           *buffer;
+	uint32_t           address;
+	uint32_t           page;
+	uint32_t           stepStart;
+	bool               failed;
+} cpsFlashJob_t;
+
+// Streamed read ('S' command)
+typedef struct
+{
+	uint8_t  access;
+	uint32_t address;
+	uint32_t remaining; // not yet read
+	uint32_t chunkLength; // read, but not yet accepted by the USB stack
+} cpsStream_t;
+
+// Not SPI_Flash_sectorbuffer, as the codeplug and settings writes may use it while a sector is programming
+static uint8_t cpsSectorBuffers[2][CPS_SECTOR_SIZE];
+static uint8_t *cpsSectorBuffer = cpsSectorBuffers[0]; // the one the CPS is filling, the other one may be programming
+static uint32_t cpsSectorCoverage[CPS_SECTOR_SIZE / 32]; // bytes of cpsSectorBuffer set by the CPS
+static cpsFlashJob_t cpsFlashJob = { .state = CPS_FLASH_JOB_IDLE };
+static cpsStream_t cpsStream;
+static uint8_t cpsHashReadBuffer[CPS_HASH_READ_SIZE];
+
+typedef enum
+{
+	MMDVM_PARSER_STATE_START = 0,
+	MMDVM_PARSER_STATE_LENGTH,
+	MMDVM_PARSER_STATE_PAYLOAD,
+	MMDVM_PARSER_STATE_SKIP
+} mmdvmParserState_t;
+
+typedef struct
+{
+	uint16_t offset;
+	uint8_t  length;
+} mmdvmParserFrame_t;
+
+typedef struct
+{
+	mmdvmParserState_t state;
+	uint8_t            frameLength; // announced by the frame header
+	uint16_t           received;
+	uint16_t           frameStart; // in com_requestbuffer, UINT16_MAX if the frame is being skipped
+	volatile uint16_t  head; // end of the last stored frame, written by the USB callback
+	volatile uint16_t  tail; // end of the last released frame, written by the hotspot task
+	volatile uint8_t   queueHead;
+	volatile uint8_t   queueTail;
+	mmdvmParserFrame_t queue[COM_MMDVM_FRAME_QUEUE_SIZE];
+	uint32_t           errors;
+	uint32_t           overflows;
+} mmdvmParserData_t;
+
+static mmdvmParserData_t mmdvmParser;
 static bool flashingDMRIDs = false;
 static bool channelsRewritten = false;
 static bool luczRewritten = false;
@@ -111,13 +190,26 @@ static bool addressInSegment(uint32_t address, uint32_t length, uint32_t segment
 	return ((address >= segmentStart) && ((address + length) <= (segmentStart + segmentSize)));
 }
 
+// Work tick_com_request() has to carry on with, without waiting for any USB traffic.
+bool usbComHasPendingWork(void)
+{
+	return ((cpsFlashJob.state != CPS_FLASH_JOB_IDLE) ||
+			((settingsUsbMode == USB_MODE_CPS) && ((com_request == 1) || (cpsStream.remaining > 0) || (cpsStream.chunkLength > 0))) ||
+			(settingsUsbMode == USB_MODE_BENCHMARK));
+}
+
 void tick_com_request(void)
 {
+	// Whatever the USB mode is now, a sector which has started to be erased has to be programmed
+	cpsFlashJobProcess();
+
 	switch (settingsUsbMode)
 	{
 		case USB_MODE_CPS:
 			if (com_request == 1)
 			{
+				cpsStream.remaining = cpsStream.chunkLength = 0; // Any new request aborts a running stream
+
 				TASK_LOCK_WRITE();
 				handleCPSRequest();
 				com_request = 0;
@@ -129,6 +221,10 @@ void tick_com_request(void)
 				}
 				TASK_UNLOCK_WRITE();
 			}
+			else if ((cpsStream.remaining > 0) || (cpsStream.chunkLength > 0))
+			{
+				cpsStreamProcess();
+			}
 			break;
 
 		case USB_MODE_HOTSPOT:
@@ -139,7 +235,7 @@ void tick_com_request(void)
 				com_request = 0;
 
 				if ((nonVolatileSettings.hotspotType != HOTSPOT_TYPE_OFF) &&
-						((comRecvMMDVMFrameCount >= 1) && (com_requestbuffer[1] == MMDVM_FRAME_START)) &&
+						usbComMMDVMHasFrame() &&
 						(uiDataGlobal.dmrDisabled == false)) // DMR (digital) is disabled.
 				{
 					if (menuSystemGetCurrentMenuNumber() != UI_HOTSPOT_MODE)
@@ -149,7 +245,55 @@ void tick_com_request(void)
 				}
 			}
 			break;
+
+		case USB_MODE_BENCHMARK:
+			if (usbBenchmarkTick() == false)
+			{
+				settingsUsbMode = USB_MODE_CPS;
+			}
+			break;
+	}
+}
+
+// Called with the task lock held
+static bool cpsReadFlash(uint32_t address, uint8_t *buffer, uint32_t length)
+{
+	bool result;
+
+	// Calibration register, returns local copy
+	if (addressInSegment(address, length, 0x10000, 0x200))
+	{
+		uint8_t *p = calibrationGetLocalDataPointer();
+		memcpy(buffer, (p + (address - 0x10000)), length);
+		result = true;
 	}
+	else
+	{
+		TASK_UNLOCK_WRITE();
+		result = SPI_Flash_read(address, buffer, length);
+		uint32_t end = address + length - 1;
+		const uint32_t VFOs_END = CODEPLUG_ADDR_VFO_A_CHANNEL + (sizeof(struct_codeplugChannel_t) * 2);
+
+		// if CPS is writing the second part of the EEPROM (emulated in Flash) then the VFO's are being updated.
+		if ((address <= CODEPLUG_ADDR_VFO_A_CHANNEL) && (end  >= VFOs_END))
+		{
+			uint32_t offset = CODEPLUG_ADDR_VFO_A_CHANNEL - address;
+
+			struct_codeplugChannel_t * destPtr = (struct_codeplugChannel_t *)&buffer[offset];
+
+			memcpy((uint8_t *)destPtr, (uint8_t *)&settingsVFOChannel[0], CODEPLUG_CHANNEL_DATA_STRUCT_SIZE);
+			codeplugConvertChannelInternalToCodeplug(destPtr, destPtr);
+
+			destPtr = (struct_codeplugChannel_t *)&buffer[offset + CODEPLUG_CHANNEL_DATA_STRUCT_SIZE];
+
+			memcpy((uint8_t *)destPtr, (uint8_t *)&settingsVFOChannel[1], CODEPLUG_CHANNEL_DATA_STRUCT_SIZE);
+			codeplugConvertChannelInternalToCodeplug(destPtr, destPtr);
+		}
+
+		TASK_LOCK_WRITE();
+	}
+
+	return result;
 }
 
 static void cpsHandleReadCommand(void)
@@ -166,40 +310,7 @@ static void cpsHandleReadCommand(void)
 	switch(com_requestbuffer[1])
 	{
 		case CPS_ACCESS_FLASH:
-		{
-			// Calibration register, returns local copy
-			if (addressInSegment(address, length, 0x10000, 0x200))
-			{
-				uint8_t *p = calibrationGetLocalDataPointer();
-				memcpy((uint8_t *)&usbComSendBuf[3], (p + (address - 0x10000)), length);
-				result = true;
-			}
-			else
-			{
-				TASK_UNLOCK_WRITE();
-				result = SPI_Flash_read(address, (uint8_t *)&usbComSendBuf[3], length);
-				uint32_t end = address + length - 1;
-				const uint32_t VFOs_END = CODEPLUG_ADDR_VFO_A_CHANNEL + (sizeof(struct_codeplugChannel_t) * 2);
-
-				// if CPS is writing the second part of the EEPROM (emulated in Flash) then the VFO's are being updated.
-				if ((address <= CODEPLUG_ADDR_VFO_A_CHANNEL) && (end  >= VFOs_END))
-				{
-					uint32_t offset = CODEPLUG_ADDR_VFO_A_CHANNEL - address;
-
-					struct_codeplugChannel_t * destPtr = (struct_codeplugChannel_t *)&usbComSendBuf[3 + offset];
-
-					memcpy((uint8_t *)destPtr, (uint8_t *)&settingsVFOChannel[0], CODEPLUG_CHANNEL_DATA_STRUCT_SIZE);
-					codeplugConvertChannelInternalToCodeplug(destPtr, destPtr);
-
-					destPtr = (struct_codeplugChannel_t *)&usbComSendBuf[3 + offset + CODEPLUG_CHANNEL_DATA_STRUCT_SIZE];
-
-					memcpy((uint8_t *)destPtr, (uint8_t *)&settingsVFOChannel[1], CODEPLUG_CHANNEL_DATA_STRUCT_SIZE);
-					codeplugConvertChannelInternalToCodeplug(destPtr, destPtr);
-				}
-
-				TASK_LOCK_WRITE();
-			}
-			}
+			result = cpsReadFlash(address, (uint8_t *)&usbComSendBuf[3], length);
 			break;
 
 		case CPS_ACCESS_EEPROM:
@@ -310,6 +421,531 @@ static void cpsHandleReadCommand(void)
 	}
 }
 
+// Streamed read: 'S', area, address (32 bits), length (32 bits).
+// The radio replies with 'S', area and the length, then sends the data as a continuous stream, up to
+// CPS_STREAM_CHUNKS_PER_TICK chunks per tick. The next chunk is read from memory while the previous
+// one is still being sent by the USB stack (which has its own copy). Any new request aborts the stream.
+static void cpsHandleStreamCommand(void)
+{
+	uint8_t access = com_requestbuffer[1];
+	uint32_t address = (com_requestbuffer[2] << 24) + (com_requestbuffer[3] << 16) + (com_requestbuffer[4] << 8) + (com_requestbuffer[5] << 0);
+	uint32_t length = (com_requestbuffer[6] << 24) + (com_requestbuffer[7] << 16) + (com_requestbuffer[8] << 8) + (com_requestbuffer[9] << 0);
+
+	hasToReply = true;
+
+	if (((access != CPS_ACCESS_FLASH) && (access != CPS_ACCESS_EEPROM)) || (length == 0))
+	{
+		usbComSendBuf[0] = '-';
+		replyLength = 1;
+		return;
+	}
+
+	cpsStream.access = access;
+	cpsStream.address = address;
+	cpsStream.remaining = length;
+	cpsStream.chunkLength = 0;
+
+	usbComSendBuf[0] = com_requestbuffer[0];
+	usbComSendBuf[1] = access;
+	memcpy((uint8_t *)&usbComSendBuf[2], (uint8_t *)&com_requestbuffer[6], 4);
+	replyLength = 6;
+}
+
+static void cpsStreamProcess(void)
+{
+	for (uint32_t i = 0; i < CPS_STREAM_CHUNKS_PER_TICK; i++)
+	{
+		if (cpsStream.chunkLength > 0)
+		{
+			TASK_LOCK_WRITE();
+			uint8_t status = CDC_Transmit_FS((uint8_t *)usbComSendBuf, cpsStream.chunkLength);
+			TASK_UNLOCK_WRITE();
+
+			if (status != USBD_OK)
+			{
+				return; // Previous chunk still in flight, retry on next tick
+			}
+
+			cpsStream.chunkLength = 0;
+		}
+
+		if (cpsStream.remaining == 0)
+		{
+			return;
+		}
+
+		uint32_t length = ((cpsStream.remaining > COM_BUFFER_SIZE) ? COM_BUFFER_SIZE : cpsStream.remaining);
+		bool ok;
+
+		if (cpsStream.access == CPS_ACCESS_FLASH)
+		{
+			// Don't let a chunk straddle the areas that cpsReadFlash() replaces, so they are handled as in single reads.
+			const uint32_t BOUNDARIES[] = { 0x10000, 0x10200, CODEPLUG_ADDR_VFO_A_CHANNEL };
+
+			for (uint32_t b = 0; b < (sizeof(BOUNDARIES) / sizeof(BOUNDARIES[0])); b++)
+			{
+				if ((cpsStream.address < BOUNDARIES[b]) && ((cpsStream.address + length) > BOUNDARIES[b]))
+				{
+					length = (BOUNDARIES[b] - cpsStream.address);
+				}
+			}
+
+			TASK_LOCK_WRITE();
+			ok = cpsReadFlash(cpsStream.address, (uint8_t *)usbComSendBuf, length);
+			TASK_UNLOCK_WRITE();
+		}
+		else
+		{
+			ok = EEPROM_Read(cpsStream.address, (uint8_t *)usbComSendBuf, length);
+		}
+
+		if (ok == false)
+		{
+			cpsStream.remaining = 0; // abort, the CPS will time out
+			return;
+		}
+
+		cpsStream.address += length;
+		cpsStream.remaining -= length;
+		cpsStream.chunkLength = length;
+	}
+}
+
+// Sector hashes: 'H', area, address (32 bits), sector count (16 bits).
+// The radio replies with 'H', the sector count (clamped to what fits in one reply) and the CRC-32 of each
+// CPS_SECTOR_SIZE block of raw flash from the address, so the CPS only has to write the sectors that differ.
+static void cpsHandleHashCommand(void)
+{
+	uint32_t address = (com_requestbuffer[2] << 24) + (com_requestbuffer[3] << 16) + (com_requestbuffer[4] << 8) + (com_requestbuffer[5] << 0);
+	uint32_t count = (com_requestbuffer[6] << 8) + (com_requestbuffer[7] << 0);
+	const uint32_t COUNT_MAX = ((COM_BUFFER_SIZE - 3) / 4);
+
+	hasToReply = true;
+
+	if ((com_requestbuffer[1] != CPS_ACCESS_FLASH) || (count == 0))
+	{
+		usbComSendBuf[0] = '-';
+		replyLength = 1;
+		return;
+	}
+
+	if (count > COUNT_MAX)
+	{
+		count = COUNT_MAX;
+	}
+
+	for (uint32_t s = 0; s < count; s++)
+	{
+		uint32_t crc = 0;
+
+		for (uint32_t offset = 0; offset < CPS_SECTOR_SIZE; offset += CPS_HASH_READ_SIZE)
+		{
+			TASK_UNLOCK_WRITE();
+			bool ok = SPI_Flash_read(address + offset, cpsHashReadBuffer, CPS_HASH_READ_SIZE);
+			TASK_LOCK_WRITE();
+
+			if (ok == false)
+			{
+				usbComSendBuf[0] = '-';
+				replyLength = 1;
+				return;
+			}
+
+			crc = crc32Update(crc, cpsHashReadBuffer, CPS_HASH_READ_SIZE);
+		}
+
+		usbComSendBuf[3 + (s * 4)] = (crc >> 24) & 0xFF;
+		usbComSendBuf[4 + (s * 4)] = (crc >> 16) & 0xFF;
+		usbComSendBuf[5 + (s * 4)] = (crc >> 8) & 0xFF;
+		usbComSendBuf[6 + (s * 4)] = (crc >> 0) & 0xFF;
+
+		address += CPS_SECTOR_SIZE;
+	}
+
+	usbComSendBuf[0] = com_requestbuffer[0];
+	usbComSendBuf[1] = (count >> 8) & 0xFF;
+	usbComSendBuf[2] = (count >> 0) & 0xFF;
+	replyLength = 3 + (count * 4);
+}
+
+// USB benchmark: 'B', 1, mode, packet size (16 bits), duration in ms (16 bits) starts it (see usb_benchmark.c),
+// and the USB mode is back to CPS once the duration has elapsed. 'B', 2 returns the results of the last run.
+static void cpsHandleBenchmarkCommand(void)
+{
+	hasToReply = true;
+
+	switch (com_requestbuffer[1])
+	{
+		case 1:
+			if (usbBenchmarkStart(com_requestbuffer[2], ((com_requestbuffer[3] << 8) + com_requestbuffer[4]), ((com_requestbuffer[5] << 8) + com_requestbuffer[6])))
+			{
+				// The receive callback feeds the benchmark from now on
+				settingsUsbMode = USB_MODE_BENCHMARK;
+
+				usbComSendBuf[0] = com_requestbuffer[0];
+				usbComSendBuf[1] = com_requestbuffer[1];
+				replyLength = 2;
+				return;
+			}
+			break;
+
+		case 2:
+			{
+				usbBenchmarkResults_t results;
+
+				usbBenchmarkGetResults(&results);
+
+				const uint32_t values[] = { results.duration, results.rxBytes, results.rxPackets, results.txBytes, results.txPackets, results.rttSamples,
+						results.rttLost, results.rttMin, results.rttMax, results.rttP50, results.rttP90, results.rttP99 };
+
+				usbComSendBuf[0] = com_requestbuffer[0];
+				usbComSendBuf[1] = com_requestbuffer[1];
+				usbComSendBuf[2] = results.mode;
+				replyLength = 3;
+
+				for (uint32_t i = 0; i < (sizeof(values) / sizeof(values[0])); i++)
+				{
+					usbComSendBuf[replyLength++] = (values[i] >> 24) & 0xFF;
+					usbComSendBuf[replyLength++] = (values[i] >> 16) & 0xFF;
+					usbComSendBuf[replyLength++] = (values[i] >> 8) & 0xFF;
+					usbComSendBuf[replyLength++] = (values[i] >> 0) & 0xFF;
+				}
+				return;
+			}
+			break;
+	}
+
+	usbComSendBuf[0] = '-';
+	replyLength = 1;
+}
+
+// CPU and memory usage: 'U'.
+// The radio replies with 'U', the number of tasks, the CPU load (permille, 16 bits), the free and minimum ever free heap
+// (32 bits), then for each task: its name (configMAX_TASK_NAME_LEN bytes, NULL padded), load (permille, 16 bits),
+// minimum ever free stack (words, 16 bits), priority and stack size (words, 16 bits).
+static void cpsHandleUsageCommand(void)
+{
+	const cpuStats_t *stats = cpuStatsGet();
+
+	usbComSendBuf[0] = com_requestbuffer[0];
+	usbComSendBuf[1] = stats->taskCount;
+	usbComSendBuf[2] = (stats->loadPermille >> 8) & 0xFF;
+	usbComSendBuf[3] = (stats->loadPermille >> 0) & 0xFF;
+	usbComSendBuf[4] = (stats->heapFree >> 24) & 0xFF;
+	usbComSendBuf[5] = (stats->heapFree >> 16) & 0xFF;
+	usbComSendBuf[6] = (stats->heapFree >> 8) & 0xFF;
+	usbComSendBuf[7] = (stats->heapFree >> 0) & 0xFF;
+	usbComSendBuf[8] = (stats->heapMinimumEverFree >> 24) & 0xFF;
+	usbComSendBuf[9] = (stats->heapMinimumEverFree >> 16) & 0xFF;
+	usbComSendBuf[10] = (stats->heapMinimumEverFree >> 8) & 0xFF;
+	usbComSendBuf[11] = (stats->heapMinimumEverFree >> 0) & 0xFF;
+	replyLength = 12;
+
+	for (uint32_t i = 0; i < stats->taskCount; i++)
+	{
+		const cpuStatsTask_t *task = &stats->tasks[i];
+
+		strncpy((char *)&usbComSendBuf[replyLength], task->name, configMAX_TASK_NAME_LEN);
+		replyLength += configMAX_TASK_NAME_LEN;
+		usbComSendBuf[replyLength++] = (task->loadPermille >> 8) & 0xFF;
+		usbComSendBuf[replyLength++] = (task->loadPermille >> 0) & 0xFF;
+		usbComSendBuf[replyLength++] = (task->stackHighWater >> 8) & 0xFF;
+		usbComSendBuf[replyLength++] = (task->stackHighWater >> 0) & 0xFF;
+		usbComSendBuf[replyLength++] = task->priority;
+		usbComSendBuf[replyLength++] = (task->stackSize >> 8) & 0xFF;
+		usbComSendBuf[replyLength++] = (task->stackSize >> 0) & 0xFF;
+	}
+
+	hasToReply = true;
+}
+
+#if defined(USING_TRACE)
+// Trace records: 'T'.
+// The radio replies with 'T', the number of records and the records (as many as the ring holds, up to what fits in one reply).
+static void cpsHandleTraceCommand(void)
+{
+	uint32_t count = traceRead((traceRecord_t *)&usbComSendBuf[4], ((COM_BUFFER_SIZE - 4) / sizeof(traceRecord_t)));
+
+	usbComSendBuf[0] = com_requestbuffer[0];
+	usbComSendBuf[1] = count;
+	usbComSendBuf[2] = 0;
+	usbComSendBuf[3] = 0;
+	hasToReply = true;
+	replyLength = (4 + (count * sizeof(traceRecord_t)));
+}
+#endif
+
+#if defined(USING_PERF)
+// Timing probes: 'P', 1 returns the stats, 'P', 2 clears them.
+// The stats reply is 'P', 1, the number of probes, 0, the counter frequency (32 bits), then for each probe: its name
+// (PERF_NAME_LENGTH bytes, NULL padded), count, min, max and mean durations, and the PERF_HISTOGRAM_BUCKETS log2
+// histogram buckets (32 bits each).
+static void cpsHandlePerfCommand(void)
+{
+	hasToReply = true;
+
+	switch (com_requestbuffer[1])
+	{
+		case 1:
+			{
+				const uint32_t PROBE_SIZE = (PERF_NAME_LENGTH + ((4 + PERF_HISTOGRAM_BUCKETS) * 4));
+				uint32_t frequency = perfGetCounterFrequency();
+				uint32_t count = 0;
+
+				replyLength = 8;
+
+				for (uint32_t p = 0; (p < PERF_PROBE_MAX) && ((replyLength + PROBE_SIZE) <= COM_BUFFER_SIZE); p++)
+				{
+					perfProbeStats_t stats;
+
+					perfGetStats(p, &stats);
+
+					const uint32_t values[] = { stats.count, stats.min, stats.max, ((stats.count > 0) ? (uint32_t)(stats.total / stats.count) : 0) };
+
+					strncpy((char *)&usbComSendBuf[replyLength], perfGetName(p), PERF_NAME_LENGTH);
+					replyLength += PERF_NAME_LENGTH;
+
+					for (uint32_t i = 0; i < (sizeof(values) / sizeof(values[0])); i++)
+					{
+						usbComSendBuf[replyLength++] = (values[i] >> 24) & 0xFF;
+						usbComSendBuf[replyLength++] = (values[i] >> 16) & 0xFF;
+						usbComSendBuf[replyLength++] = (values[i] >> 8) & 0xFF;
+						usbComSendBuf[replyLength++] = (values[i] >> 0) & 0xFF;
+					}
+
+					for (uint32_t b = 0; b < PERF_HISTOGRAM_BUCKETS; b++)
+					{
+						usbComSendBuf[replyLength++] = (stats.buckets[b] >> 24) & 0xFF;
+						usbComSendBuf[replyLength++] = (stats.buckets[b] >> 16) & 0xFF;
+						usbComSendBuf[replyLength++] = (stats.buckets[b] >> 8) & 0xFF;
+						usbComSendBuf[replyLength++] = (stats.buckets[b] >> 0) & 0xFF;
+					}
+
+					count++;
+				}
+
+				usbComSendBuf[0] = com_requestbuffer[0];
+				usbComSendBuf[1] = com_requestbuffer[1];
+				usbComSendBuf[2] = count;
+				usbComSendBuf[3] = 0;
+				usbComSendBuf[4] = (frequency >> 24) & 0xFF;
+				usbComSendBuf[5] = (frequency >> 16) & 0xFF;
+				usbComSendBuf[6] = (frequency >> 8) & 0xFF;
+				usbComSendBuf[7] = (frequency >> 0) & 0xFF;
+				return;
+			}
+			break;
+
+		case 2:
+			perfReset();
+
+			usbComSendBuf[0] = com_requestbuffer[0];
+			usbComSendBuf[1] = com_requestbuffer[1];
+			replyLength = 2;
+			return;
+			break;
+	}
+
+	usbComSendBuf[0] = '-';
+	replyLength = 1;
+}
+#endif
+
+static void cpsPutUInt32Array(const uint32_t *values, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		usbComSendBuf[replyLength++] = (values[i] >> 24) & 0xFF;
+		usbComSendBuf[replyLength++] = (values[i] >> 16) & 0xFF;
+		usbComSendBuf[replyLength++] = (values[i] >> 8) & 0xFF;
+		usbComSendBuf[replyLength++] = (values[i] >> 0) & 0xFF;
+	}
+}
+
+// Registers shadows: 'G'.
+// 'G', 1, page (0x01 or 0x04): the reply is 'G', 1, page, 0, the HR-C6000 written and skipped transfers (32 bits), the
+// validity bitmap of the page registers (32 bytes, LSB first), and the 256 registers values.
+// 'G', 2: the reply is 'G', 2, number of bands, number of synthesiser registers, the synthesiser and IF chip written and
+// skipped transfers (32 bits each), then for each band: synthesiser valid, locked for Tx, IF valid, IF wide (one byte
+// each), and the synthesiser registers (32 bits each).
+static void cpsHandleShadowCommand(void)
+{
+	hasToReply = true;
+	replyLength = 0;
+
+	switch (com_requestbuffer[1])
+	{
+		case 1:
+			if ((com_requestbuffer[2] == 0x01) || (com_requestbuffer[2] == 0x04))
+			{
+				uint32_t stats[2];
+
+				SPI0ShadowGetStats(&stats[0], &stats[1]);
+
+				usbComSendBuf[0] = com_requestbuffer[0];
+				usbComSendBuf[1] = com_requestbuffer[1];
+				usbComSendBuf[2] = com_requestbuffer[2];
+				usbComSendBuf[3] = 0;
+				replyLength = 4;
+				cpsPutUInt32Array(stats, 2);
+
+				memset((uint8_t *)&usbComSendBuf[replyLength], 0, (32 + 256));
+				for (uint32_t reg = 0; reg < 256; reg++)
+				{
+					uint8_t val;
+
+					if (SPI0ShadowGet(com_requestbuffer[2], reg, &val))
+					{
+						usbComSendBuf[replyLength + (reg >> 3)] |= (1 << (reg & 0x07));
+						usbComSendBuf[replyLength + 32 + reg] = val;
+					}
+				}
+				replyLength += (32 + 256);
+				return;
+			}
+			break;
+
+		case 2:
+			{
+				const radioShadow_t *shadow = radioGetShadow();
+				const uint32_t stats[] = { shadow->synthWritten, shadow->synthSkipped, shadow->ifWritten, shadow->ifSkipped };
+
+				usbComSendBuf[0] = com_requestbuffer[0];
+				usbComSendBuf[1] = com_requestbuffer[1];
+				usbComSendBuf[2] = RADIO_SHADOW_BANDS_NUM;
+				usbComSendBuf[3] = RADIO_SYNTH_REGISTERS_NUM;
+				replyLength = 4;
+				cpsPutUInt32Array(stats, (sizeof(stats) / sizeof(stats[0])));
+
+				for (uint32_t band = 0; band < RADIO_SHADOW_BANDS_NUM; band++)
+				{
+					usbComSendBuf[replyLength++] = shadow->synthValid[band];
+					usbComSendBuf[replyLength++] = shadow->synthTx[band];
+					usbComSendBuf[replyLength++] = shadow->ifValid[band];
+					usbComSendBuf[replyLength++] = shadow->ifWide[band];
+					cpsPutUInt32Array(shadow->synthRegs[band], RADIO_SYNTH_REGISTERS_NUM);
+				}
+				return;
+			}
+			break;
+	}
+
+	usbComSendBuf[0] = '-';
+	replyLength = 1;
+}
+
+// Background sector erase and programming, one step per call.
+static void cpsFlashJobProcess(void)
+{
+	if (cpsFlashJob.state == CPS_FLASH_JOB_IDLE)
+	{
+		return;
+	}
+
+	if (SPI_Flash_isBusy())
+	{
+		if ((ticksGetMillis() - cpsFlashJob.stepStart) > ((cpsFlashJob.state == CPS_FLASH_JOB_ERASING) ? CPS_FLASH_ERASE_TIMEOUT : CPS_FLASH_PAGE_TIMEOUT))
+		{
+			cpsFlashJob.failed = true;
+			cpsFlashJob.state = CPS_FLASH_JOB_IDLE;
+		}
+		return;
+	}
+
+	if (cpsFlashJob.state == CPS_FLASH_JOB_ERASING)
+	{
+		cpsFlashJob.state = CPS_FLASH_JOB_PROGRAMMING;
+		cpsFlashJob.page = 0;
+	}
+
+	if (cpsFlashJob.page < CPS_SECTOR_PAGES)
+	{
+		SPI_Flash_writePageStart(cpsFlashJob.address + (cpsFlashJob.page * 256), cpsFlashJob.buffer + (cpsFlashJob.page * 256));
+		cpsFlashJob.page++;
+		cpsFlashJob.stepStart = ticksGetMillis();
+	}
+	else
+	{
+		cpsFlashJob.state = CPS_FLASH_JOB_IDLE;
+	}
+}
+
+// Called with the task lock held. Returns false if the last background job has failed.
+static bool cpsFlashJobWait(void)
+{
+	bool ok;
+
+	if ((cpsFlashJob.state != CPS_FLASH_JOB_IDLE) || cpsFlashJob.failed)
+	{
+		TASK_UNLOCK_WRITE();
+		while (cpsFlashJob.state != CPS_FLASH_JOB_IDLE)
+		{
+			osDelay(1);
+			cpsFlashJobProcess();
+		}
+
+		// After a timeout, the Flash may still be busy, which the reads done with the lock held can't wait for
+		SPI_Flash_waitForWriteCompletion();
+		TASK_LOCK_WRITE();
+	}
+
+	ok = (cpsFlashJob.failed == false);
+	cpsFlashJob.failed = false;
+
+	return ok;
+}
+
+static inline void cpsSectorBufferPut(uint32_t offset, uint8_t value)
+{
+	cpsSectorBuffer[offset] = value;
+	cpsSectorCoverage[offset >> 5] |= (1U << (offset & 0x1F));
+}
+
+// The sector is only read from the Flash when the CPS hasn't sent all of its bytes (that read has to wait for
+// the previous sector programming to complete).
+static bool cpsSectorBufferComplete(uint32_t address)
+{
+	bool complete = true;
+
+	for (uint32_t i = 0; i < (CPS_SECTOR_SIZE / 32); i++)
+	{
+		if (cpsSectorCoverage[i] != UINT32_MAX)
+		{
+			complete = false;
+			break;
+		}
+	}
+
+	if (complete == false)
+	{
+		uint8_t page[256];
+
+		for (uint32_t p = 0; p < CPS_SECTOR_PAGES; p++)
+		{
+			TASK_UNLOCK_WRITE();
+			complete = SPI_Flash_read(address + (p * 256), page, sizeof(page));
+			TASK_LOCK_WRITE();
+
+			if (complete == false)
+			{
+				break;
+			}
+
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t offset = ((p * 256) + i);
+
+				if ((cpsSectorCoverage[offset >> 5] & (1U << (offset & 0x1F))) == 0)
+				{
+					cpsSectorBuffer[offset] = page[i];
+				}
+			}
+		}
+	}
+
+	return complete;
+}
+
 static void cpsHandleWriteCommand(void)
 {
 	bool ok = false;
@@ -331,9 +967,9 @@ static void cpsHandleWriteCommand(void)
 					flashingDMRIDs = true;
 				}
 
-				TASK_UNLOCK_WRITE();
-				ok = SPI_Flash_read(sector * 4096, SPI_Flash_sectorbuffer, 4096);
-				TASK_LOCK_WRITE();
+				// The existing data is only read, if needed, when the sector gets written.
+				memset(cpsSectorCoverage, 0, sizeof(cpsSectorCoverage));
+				ok = true;
 			}
 			break;
 
@@ -392,7 +1028,7 @@ static void cpsHandleWriteCommand(void)
 						{
 							if (sector == (address + i) / 4096)
 							{
-								SPI_Flash_sectorbuffer[(address + i) % 4096] = com_requestbuffer[i + 8];
+								cpsSectorBufferPut(((address + i) % 4096), com_requestbuffer[i + 8]);
 							}
 						}
 
@@ -402,7 +1038,7 @@ static void cpsHandleWriteCommand(void)
 							{
 								if (sector == ((QUICKKEYS_BLOCK_END + 1) + i) / 4096)
 								{
-									SPI_Flash_sectorbuffer[((QUICKKEYS_BLOCK_END + 1) + i) % 4096] = com_requestbuffer[i + 8 + ((QUICKKEYS_BLOCK_END + 1) - address)];
+									cpsSectorBufferPut((((QUICKKEYS_BLOCK_END + 1) + i) % 4096), com_requestbuffer[i + 8 + ((QUICKKEYS_BLOCK_END + 1) - address)]);
 								}
 							}
 						}
@@ -416,7 +1052,7 @@ static void cpsHandleWriteCommand(void)
 							{
 								if (sector == ((QUICKKEYS_BLOCK_END + 1) + i) / 4096)
 								{
-									SPI_Flash_sectorbuffer[((QUICKKEYS_BLOCK_END + 1) + i) % 4096] = com_requestbuffer[i + 8 + ((QUICKKEYS_BLOCK_END + 1) - address)];
+									cpsSectorBufferPut((((QUICKKEYS_BLOCK_END + 1) + i) % 4096), com_requestbuffer[i + 8 + ((QUICKKEYS_BLOCK_END + 1) - address)]);
 								}
 							}
 						}
@@ -441,7 +1077,7 @@ static void cpsHandleWriteCommand(void)
 					{
 						if (sector == (address + i) / 4096)
 						{
-							SPI_Flash_sectorbuffer[(address + i) % 4096] = com_requestbuffer[i + 8];
+							cpsSectorBufferPut(((address + i) % 4096), com_requestbuffer[i + 8]);
 						}
 					}
 				}
@@ -453,21 +1089,21 @@ static void cpsHandleWriteCommand(void)
 		case 3: // Flash Write
 			if (sector >= 0)
 			{
-				TASK_UNLOCK_WRITE();
-				ok = SPI_Flash_eraseSector(sector * 4096);
-				TASK_LOCK_WRITE();
+				// Only one sector can be programmed at a time. A failure of the previous one is reported here.
+				ok = (cpsFlashJobWait() && cpsSectorBufferComplete(sector * 4096));
+
 				if (ok)
 				{
-					for (int i = 0; i < 16; i++)
-					{
-						TASK_UNLOCK_WRITE();
-						ok = SPI_Flash_writePage(sector * 4096 + i * 256, SPI_Flash_sectorbuffer + i * 256);
-						TASK_LOCK_WRITE();
-						if (!ok)
-						{
-							break;
-						}
-					}
+					// Program in the background, and let the CPS fill the other buffer in the meantime.
+					cpsFlashJob.buffer = cpsSectorBuffer;
+					cpsFlashJob.address = (sector * 4096);
+					cpsFlashJob.state = CPS_FLASH_JOB_ERASING;
+					cpsFlashJob.stepStart = ticksGetMillis();
+					TASK_UNLOCK_WRITE();
+					SPI_Flash_eraseSectorStart(cpsFlashJob.address);
+					TASK_LOCK_WRITE();
+
+					cpsSectorBuffer = ((cpsSectorBuffer == cpsSectorBuffers[0]) ? cpsSectorBuffers[1] : cpsSectorBuffers[0]);
 				}
 				sector = -1;
 			}
@@ -888,12 +1524,50 @@ static void cpsHandleCommand(void)
 
 static void handleCPSRequest(void)
 {
+	// Only the sector writes can overlap with the background programming.
+	if ((com_requestbuffer[0] != 'X') || (com_requestbuffer[1] < 1) || (com_requestbuffer[1] > 3))
+	{
+		if (cpsFlashJobWait() == false)
+		{
+			sector = -1;
+			usbComSendBuf[0] = '-';
+			hasToReply = true;
+			replyLength = 1;
+			return;
+		}
+	}
+
 	//Handle read
 	switch(com_requestbuffer[0])
 	{
 		case 'R':
 			cpsHandleReadCommand();
 			break;
+		case 'S':
+			cpsHandleStreamCommand();
+			break;
+		case 'H':
+			cpsHandleHashCommand();
+			break;
+		case 'B':
+			cpsHandleBenchmarkCommand();
+			break;
+		case 'U':
+			cpsHandleUsageCommand();
+			break;
+		case 'G':
+			cpsHandleShadowCommand();
+			break;
+#if defined(USING_TRACE)
+		case 'T':
+			cpsHandleTraceCommand();
+			break;
+#endif
+#if defined(USING_PERF)
+		case 'P':
+			cpsHandlePerfCommand();
+			break;
+#endif
 		case 'X'://W
 			cpsHandleWriteCommand();
 			break;
@@ -945,6 +1619,195 @@ static void handleCPSRequest(void)
 			break;
 	}
 }
+// MMDVM frames parser, fed from the USB receive callback.
+//
+// The frame start byte and the length are validated as the bytes arrive, and each frame is stored in one
+// contiguous block of com_requestbuffer (a frame that wouldn't fit before the end of the buffer is stored at
+// its beginning). Completed frames are described in a small queue, so the hotspot code can handle them in place.
+// A short USB packet terminates the current frame, as MMDVMHost never splits a frame over several transfers
+// (so an announced length that doesn't match the data can't desync the parser).
+static void usbComMMDVMParserAllocate(void)
+{
+	uint16_t head = mmdvmParser.head;
+	uint16_t tail = mmdvmParser.tail;
+	uint8_t length = mmdvmParser.frameLength;
+
+	mmdvmParser.frameStart = UINT16_MAX;
+
+	if (((mmdvmParser.queueHead + 1) & (COM_MMDVM_FRAME_QUEUE_SIZE - 1)) == mmdvmParser.queueTail)
+	{
+		return;
+	}
+
+	if (head >= tail)
+	{
+		if ((head + length) <= COM_REQUESTBUFFER_SIZE)
+		{
+			mmdvmParser.frameStart = head;
+		}
+		else if (length < tail) // wrap, keeping head != tail while there is some data
+		{
+			mmdvmParser.frameStart = 0;
+		}
+	}
+	else if ((head + length) < tail)
+	{
+		mmdvmParser.frameStart = head;
+	}
+}
+
+static void usbComMMDVMParserCompleteFrame(uint8_t length)
+{
+	uint8_t queueHead = mmdvmParser.queueHead;
+
+	mmdvmParser.queue[queueHead].offset = mmdvmParser.frameStart;
+	mmdvmParser.queue[queueHead].length = length;
+	mmdvmParser.head = (mmdvmParser.frameStart + length);
+	__DMB();
+	mmdvmParser.queueHead = ((queueHead + 1) & (COM_MMDVM_FRAME_QUEUE_SIZE - 1));
+	mmdvmParser.state = MMDVM_PARSER_STATE_START;
+}
+
+void usbComMMDVMParserReset(void)
+{
+	mmdvmParser.state = MMDVM_PARSER_STATE_START;
+	mmdvmParser.head = 0;
+	mmdvmParser.tail = 0;
+	mmdvmParser.queueHead = 0;
+	mmdvmParser.queueTail = 0;
+}
+
+// Called from the USB receive callback
+void usbComMMDVMParserFeed(const uint8_t *data, uint32_t length, bool endOfTransfer)
+{
+	uint32_t i = 0;
+
+	while (i < length)
+	{
+		switch (mmdvmParser.state)
+		{
+			case MMDVM_PARSER_STATE_START:
+				if (data[i++] == MMDVM_FRAME_START)
+				{
+					mmdvmParser.state = MMDVM_PARSER_STATE_LENGTH;
+				}
+				break;
+
+			case MMDVM_PARSER_STATE_LENGTH:
+				mmdvmParser.frameLength = data[i++];
+				mmdvmParser.received = 2;
+
+				if (mmdvmParser.frameLength < 3) // The shortest MMDVMHost frame length is 3U
+				{
+					mmdvmParser.errors++;
+					mmdvmParser.state = MMDVM_PARSER_STATE_START;
+					break;
+				}
+
+				usbComMMDVMParserAllocate();
+
+				if (mmdvmParser.frameStart == UINT16_MAX)
+				{
+					mmdvmParser.overflows++;
+					mmdvmParser.state = MMDVM_PARSER_STATE_SKIP;
+				}
+				else
+				{
+					com_requestbuffer[mmdvmParser.frameStart] = MMDVM_FRAME_START;
+					com_requestbuffer[mmdvmParser.frameStart + 1] = mmdvmParser.frameLength;
+					mmdvmParser.state = MMDVM_PARSER_STATE_PAYLOAD;
+				}
+				break;
+
+			case MMDVM_PARSER_STATE_PAYLOAD:
+			case MMDVM_PARSER_STATE_SKIP:
+			{
+				uint32_t chunk = (mmdvmParser.frameLength - mmdvmParser.received);
+
+				if (chunk > (length - i))
+				{
+					chunk = (length - i);
+				}
+
+				if (mmdvmParser.state == MMDVM_PARSER_STATE_PAYLOAD)
+				{
+					memcpy((uint8_t *)&com_requestbuffer[mmdvmParser.frameStart + mmdvmParser.received], &data[i], chunk);
+				}
+
+				i += chunk;
+				mmdvmParser.received += chunk;
+
+				if (mmdvmParser.received == mmdvmParser.frameLength)
+				{
+					if (mmdvmParser.state == MMDVM_PARSER_STATE_PAYLOAD)
+					{
+						usbComMMDVMParserCompleteFrame(mmdvmParser.frameLength);
+					}
+					else
+					{
+						mmdvmParser.state = MMDVM_PARSER_STATE_START;
+					}
+				}
+			}
+			break;
+		}
+	}
+
+	if (endOfTransfer && (mmdvmParser.state != MMDVM_PARSER_STATE_START))
+	{
+		// Truncated frame, keep it if it's still long enough (the handlers check the lengths they need)
+		if ((mmdvmParser.state == MMDVM_PARSER_STATE_PAYLOAD) && (mmdvmParser.received >= 3))
+		{
+			usbComMMDVMParserCompleteFrame(mmdvmParser.received);
+		}
+		else
+		{
+			mmdvmParser.errors++;
+		}
+
+		mmdvmParser.state = MMDVM_PARSER_STATE_START;
+	}
+}
+
+bool usbComMMDVMHasFrame(void)
+{
+	return (mmdvmParser.queueTail != mmdvmParser.queueHead);
+}
+
+// Get the oldest received frame, which stays valid until usbComMMDVMReleaseFrame() is called
+bool usbComMMDVMPeekFrame(const uint8_t **frame, uint8_t *length)
+{
+	uint8_t queueTail = mmdvmParser.queueTail;
+
+	if (queueTail == mmdvmParser.queueHead)
+	{
+		return false;
+	}
+
+	*frame = (const uint8_t *)&com_requestbuffer[mmdvmParser.queue[queueTail].offset];
+	*length = mmdvmParser.queue[queueTail].length;
+
+	return true;
+}
+
+void usbComMMDVMReleaseFrame(void)
+{
+	uint8_t queueTail = mmdvmParser.queueTail;
+
+	if (queueTail != mmdvmParser.queueHead)
+	{
+		mmdvmParser.tail = (mmdvmParser.queue[queueTail].offset + mmdvmParser.queue[queueTail].length);
+		__DMB();
+		mmdvmParser.queueTail = ((queueTail + 1) & (COM_MMDVM_FRAME_QUEUE_SIZE - 1));
+	}
+}
+
+void usbComMMDVMGetParserStats(uint32_t *errors, uint32_t *overflows)
+{
+	*errors = mmdvmParser.errors;
+	*overflows = mmdvmParser.overflows;
+}
+
 #if 0
 __attribute__((section(".data.$RAM2"))) volatile uint8_t com_buffer[COM_BUFFER_SIZE];
 int com_buffer_write_idx = 0;
@@ -1020,6 +1883,18 @@ void USB_DEBUG_PRINT(char *str)
 	CDC_Transmit_FS((uint8_t *)usbComSendBuf, strlen((char *)usbComSendBuf));
 }
 
+// Forwards a received NMEA line, as is (the NMEA protocol requires CR LF)
+void usbComSendNMEA(const char *line)
+{
+	size_t length = strnlen(line, (COM_BUFFER_SIZE - 2));
+
+	memcpy((uint8_t *)usbComSendBuf, line, length);
+	usbComSendBuf[length++] = '\r';
+	usbComSendBuf[length++] = '\n';
+
+	CDC_Transmit_FS((uint8_t *)usbComSendBuf, length);
+}
+
 void USB_DEBUG_printf(const char *format, ...)
 {
 	char buf[COM_BUFFER_SIZE];
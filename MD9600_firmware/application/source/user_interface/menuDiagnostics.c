@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include "user_interface/uiGlobals.h"
+#include "user_interface/menuSystem.h"
+#include "user_interface/uiLocalisation.h"
+#include "user_interface/uiUtilities.h"
+#include "functions/cpuStats.h"
+
+// Hidden diagnostics screen (SK2 + Right, from the Radio infos): CPU load, heap usage, then the per task load and
+// minimum ever free stack (in words).
+
+#define DIAGNOSTICS_LINE_BUFFER_SIZE    22 // 21 characters (for a 6 pixels font width) + NULL
+#define DIAGNOSTICS_TASK_LINES           4
+
+static void updateScreen(void);
+static void handleEvent(uiEvent_t *ev);
+static uint32_t menuDiagnosticsNextUpdateTime;
+static uint32_t firstTask = 0;
+
+menuStatus_t menuDiagnostics(uiEvent_t *ev, bool isFirstRun)
+{
+	if (isFirstRun)
+	{
+		menuDataGlobal.numItems = 0;
+		firstTask = 0;
+		menuDiagnosticsNextUpdateTime = ev->time + CPU_STATS_UPDATE_PERIOD;
+		updateScreen();
+	}
+	else
+	{
+		if (ev->time > menuDiagnosticsNextUpdateTime)
+		{
+			menuDiagnosticsNextUpdateTime = ev->time + CPU_STATS_UPDATE_PERIOD;
+			updateScreen();
+		}
+
+		if (ev->hasEvent)
+		{
+			handleEvent(ev);
+		}
+	}
+	return MENU_STATUS_SUCCESS;
+}
+
+static void updateScreen(void)
+{
+	const cpuStats_t *stats = cpuStatsGet();
+	char buffer[DIAGNOSTICS_LINE_BUFFER_SIZE];
+	int16_t y = 16;
+
+	displayClearBuf();
+	menuDisplayTitle("Diagnostics");
+
+	snprintf(buffer, DIAGNOSTICS_LINE_BUFFER_SIZE, "CPU %3u.%u%%%s", (stats->loadPermille / 10), (stats->loadPermille % 10), (stats->overflow ? " (stale)" : ""));
+	displayPrintAt(0, y, buffer, FONT_SIZE_1);
+	y += 8;
+
+	snprintf(buffer, DIAGNOSTICS_LINE_BUFFER_SIZE, "Heap %5u min %5u", (unsigned int)stats->heapFree, (unsigned int)stats->heapMinimumEverFree);
+	displayPrintAt(0, y, buffer, FONT_SIZE_1);
+	y += 8;
+
+	for (uint32_t i = firstTask; (i < stats->taskCount) && (i < (firstTask + DIAGNOSTICS_TASK_LINES)); i++)
+	{
+		const cpuStatsTask_t *task = &stats->tasks[i];
+
+		snprintf(buffer, DIAGNOSTICS_LINE_BUFFER_SIZE, "%-9.9s%3u.%u%%%5u", task->name, (task->loadPermille / 10), (task->loadPermille % 10), task->stackHighWater);
+		displayPrintAt(0, y, buffer, FONT_SIZE_1);
+		y += 8;
+	}
+
+	displayRender();
+}
+
+static void handleEvent(uiEvent_t *ev)
+{
+	if ((ev->events & FUNCTION_EVENT) && (ev->function == FUNC_REDRAW))
+	{
+		updateScreen();
+		return;
+	}
+
+	if (EVENTCHECK_SHORTUP(ev->keys))
+	{
+		switch(ev->keys.key)
+		{
+			case KEY_RED:
+			case KEY_GREEN:
+				menuSystemPopPreviousMenu();
+				return;
+				break;
+
+			case KEY_UP:
+				if (firstTask > 0)
+				{
+					firstTask--;
+					updateScreen();
+				}
+				break;
+
+			case KEY_DOWN:
+				if ((firstTask + DIAGNOSTICS_TASK_LINES) < cpuStatsGet()->taskCount)
+				{
+					firstTask++;
+					updateScreen();
+				}
+				break;
+		}
+	}
+}
@@ -582,6 +582,11 @@ static void handleEvent(uiEvent_t *ev)
 				break;
 
 			case KEY_RIGHT:
+				if (BUTTONCHECK_DOWN(ev, BUTTON_SK2))
+				{
+					menuSystemPushNewMenu(MENU_DIAGNOSTICS);
+					return;
+				}
 				break;
 
 			default:
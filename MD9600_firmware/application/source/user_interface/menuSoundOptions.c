@@ -75,6 +75,7 @@ enum
 #if defined(PLATFORM_MD9600)
 	OPTIONS_SPEAKER_CLICK_SUPPRESS,
 #endif
+	OPTIONS_DTMF_DECODER,
 	NUM_SOUND_MENU_ITEMS
 };
 
@@ -295,6 +296,11 @@ static void updateScreen(bool isFirstRun)
 					rightSideConst = (settingsIsOptionBitSet(BIT_SPEAKER_CLICK_SUPPRESS) ? currentLanguage->on : currentLanguage->off);
 					break;
 #endif
+				case OPTIONS_DTMF_DECODER:
+					leftSide = currentLanguage->dtmf_decoder;
+					rightSideConst = (settingsIsOptionBitSet(BIT_DTMF_DECODER) ?
+							(settingsIsOptionBitSet(BIT_DTMF_REMOTE_CONTROL) ? currentLanguage->dtmf_remote : currentLanguage->on) : currentLanguage->off);
+					break;
 			}
 
 			snprintf(buf, SCREEN_LINE_BUFFER_SIZE, "%s:%s", leftSide, (rightSideVar[0] ? rightSideVar : (rightSideConst ? rightSideConst : "")));
@@ -556,6 +562,17 @@ static void handleEvent(uiEvent_t *ev)
 					settingsSetOptionBit(BIT_SPEAKER_CLICK_SUPPRESS, true);
 					break;
 #endif
+				case OPTIONS_DTMF_DECODER:
+					// Off -> On -> Remote
+					if (settingsIsOptionBitSet(BIT_DTMF_DECODER))
+					{
+						settingsSetOptionBit(BIT_DTMF_REMOTE_CONTROL, true);
+					}
+					else
+					{
+						settingsSetOptionBit(BIT_DTMF_DECODER, true);
+					}
+					break;
 			}
 		}
 		else if (KEYCHECK_PRESS(ev->keys, KEY_LEFT)
@@ -690,6 +707,17 @@ static void handleEvent(uiEvent_t *ev)
 					settingsSetOptionBit(BIT_SPEAKER_CLICK_SUPPRESS, false);
 					break;
 #endif
+				case OPTIONS_DTMF_DECODER:
+					// Remote -> On -> Off
+					if (settingsIsOptionBitSet(BIT_DTMF_REMOTE_CONTROL))
+					{
+						settingsSetOptionBit(BIT_DTMF_REMOTE_CONTROL, false);
+					}
+					else
+					{
+						settingsSetOptionBit(BIT_DTMF_DECODER, false);
+					}
+					break;
 			}
 		}
 		else if ((ev->keys.event & KEY_MOD_PRESS) && (menuDataGlobal.menuOptionsTimeout > 0))
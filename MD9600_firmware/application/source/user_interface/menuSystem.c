@@ -108,6 +108,7 @@ menuDataGlobal_t menuDataGlobal =
 				NULL,// Colour picker
 #endif
 				NULL, //DMRID
+				NULL,// Diagnostics
 
 		}
 };
@@ -168,6 +169,7 @@ static menuFunctionData_t menuFunctions[] =
 		{ menuColourPicker,         NULL, NULL, 0 },
 #endif
 		{ menuDMRID,         NULL, NULL, 0 },
+		{ menuDiagnostics,          NULL, NULL, 0 },
 
 };
 
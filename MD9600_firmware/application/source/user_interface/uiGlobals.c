@@ -191,9 +191,9 @@ struct_codeplugZone_t currentZone =
 };
 
 
-#if defined(PLATFORM_MDUV380) || defined(PLATFORM_MD380) || defined(PLATFORM_RT84_DM1701) || defined(PLATFORM_MD2017)
-__attribute__((section(".ccmram")))
-#else // MD9600 and MK22 platforms
+#if defined(PLATFORM_MD9600) || defined(PLATFORM_MDUV380) || defined(PLATFORM_MD380) || defined(PLATFORM_RT84_DM1701) || defined(PLATFORM_MD2017)
+CCM_DATA
+#else // MK22 platforms
 __attribute__((section(".data.$RAM2")))
 #endif
 struct_codeplugRxGroup_t currentRxGroupData;
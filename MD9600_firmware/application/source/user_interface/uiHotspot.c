@@ -30,6 +30,7 @@
 
 #include "functions/calibration.h"
 #include "functions/hotspot.h"
+#include "functions/pocsag.h"
 #include "user_interface/menuSystem.h"
 #include "user_interface/uiUtilities.h"
 #include "user_interface/uiLocalisation.h"
@@ -172,7 +173,7 @@ menuStatus_t menuHotspotMode(uiEvent_t *ev, bool isFirstRun)
 	{
 #endif
 		processUSBDataQueue();
-		if (comRecvMMDVMFrameCount > 0)
+		if (usbComMMDVMHasFrame())
 		{
 			handleHotspotRequest();
 		}
@@ -578,6 +579,14 @@ void hotspotExit(void)
 			cwReset();
 			hotspotCwKeying = false;
 		}
+
+		if (hotspotPocsagKeying)
+		{
+			pocsagTxStop();
+			pocsagInit();
+			HRC6000SetMic(true);
+			hotspotPocsagKeying = false;
+		}
 	}
 
 	currentChannelData->libreDMR_Power = savedLibreDMR_Power;
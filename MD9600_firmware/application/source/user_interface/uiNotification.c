@@ -209,6 +209,7 @@ void uiNotificationRefresh(void)
 		displayRestorePrimaryScreenBuffer();
 #else
 		memcpy(displayGetPrimaryScreenBuffer(), screenNotificationBufData, sizeof(screenNotificationBufData));
+		displayMarkAllDirty();
 #endif
 	}
 }
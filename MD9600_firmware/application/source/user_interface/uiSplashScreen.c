@@ -149,6 +149,7 @@ static void updateScreen(bool isFirstRun)
 #else
 		customDataHasImage = codeplugGetOpenGD77CustomData(CODEPLUG_CUSTOM_DATA_TYPE_IMAGE, (uint8_t *)displayGetScreenBuffer());
 #endif
+		displayMarkAllDirty(); // the image was written straight to the screen buffer
 	}
 
 	if (!customDataHasImage)
@@ -50,9 +50,9 @@
 
 static const uint8_t DECOMPRESS_LUT[64] = { ' ', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P', 'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y', 'z', '.' };
 
-#if defined(PLATFORM_MDUV380) || defined(PLATFORM_MD380) || defined(PLATFORM_RT84_DM1701) || defined(PLATFORM_MD2017)
-static  __attribute__((section(".ccmram")))
-#else // MD9600 and MK22
+#if defined(PLATFORM_MD9600) || defined(PLATFORM_MDUV380) || defined(PLATFORM_MD380) || defined(PLATFORM_RT84_DM1701) || defined(PLATFORM_MD2017)
+static  CCM_DATA
+#else // MK22
 static  __attribute__((section(".data.$RAM2")))
 #endif
 LinkItem_t callsList[NUM_LASTHEARD_STORED];
@@ -314,6 +314,33 @@ LinkItem_t *lastHeardFindInList(uint32_t id)
 	return NULL;
 }
 
+// Update the location of an already heard station, e.g. from a received DMR data position report
+bool lastHeardUpdateLocation(uint32_t id, double latitude, double longitude)
+{
+	LinkItem_t *item = lastHeardFindInList(id);
+
+	if ((item == NULL) || ((item->locationLat == latitude) && (item->locationLon == longitude)))
+	{
+		return false;
+	}
+
+	item->locationLat = latitude;
+	item->locationLon = longitude;
+
+	if (item == LinkHead)
+	{
+		// Same as the embedded GPS location, display ID:xxxxx if no TA text was received
+		if (item->talkerAlias[0] == 0x00)
+		{
+			snprintf(item->talkerAlias, 16, "ID:%u", item->id);
+		}
+
+		uiDataGlobal.displayQSOState = QSO_DISPLAY_CALLER_DATA_UPDATE;
+	}
+
+	return true;
+}
+
 // returns pointer to maidenheadBuffer
 uint8_t *coordsToMaidenhead(uint8_t *maidenheadBuffer, double latitude, double longitude)
 {
@@ -31,6 +31,7 @@
 #include "hardware/radioHardwareInterface.h"
 #endif
 #include "functions/trx.h"
+#include "functions/cssDetector.h"
 #include "functions/rxPowerSaving.h"
 #include "user_interface/menuSystem.h"
 #include "user_interface/uiUtilities.h"
@@ -682,6 +683,7 @@ void uiVFOModeStopScanning(void)
 
 		trxSetRxCSS(RADIO_DEVICE_PRIMARY, currentChannelData->rxTone);
 		uiDataGlobal.Scan.toneActive = false;
+		cssDetectorStop();
 		trxSetAnalogFilterLevel(nonVolatileSettings.analogFilterLevel);// Restore the filter setting after the tone scan
 		resetAPRS = false;
 	}
@@ -2857,6 +2859,7 @@ static void handleQuickMenuEvent(uiEvent_t *ev)
 						uiDataGlobal.Scan.refreshOnEveryStep = false;
 						uiDataGlobal.Scan.timer.timeout = ((toneScanType == CSS_TYPE_CTCSS) ? (SCAN_TONE_INTERVAL - (scanToneIndex * 2)) : SCAN_TONE_INTERVAL);
 						uiDataGlobal.Scan.direction = 1;
+						cssDetectorStart(toneScanCSS);
 					}
 					break;
 
@@ -3167,13 +3170,29 @@ bool uiVFOModeFrequencyScanningIsActiveAndEnabled(uint32_t *lowFreq, uint32_t *h
 
 static void toneScan(void)
 {
-	if (getAudioAmpStatus() & AUDIO_AMP_MODE_RF)
+	uint16_t detectedTone;
+	bool detected;
+
+	// The software detector evaluates all the tones at once, the HR-C6000 tone stepping is kept as a fallback
+	cssDetectorTick();
+	if ((detected = cssDetectorGetTone(&detectedTone)))
+	{
+		currentChannelData->rxTone = detectedTone;
+		toneScanType = codeplugGetCSSType(detectedTone);
+		scanToneIndex = cssGetToneIndex(detectedTone, toneScanType);
+		trxRxAndTxOff(true);
+		trxSetRxCSS(RADIO_DEVICE_PRIMARY, currentChannelData->rxTone);
+		trxRxOn(true);
+	}
+
+	if (detected || (getAudioAmpStatus() & AUDIO_AMP_MODE_RF))
 	{
 		currentChannelData->txTone = currentChannelData->rxTone;
 		uiDataGlobal.displayQSOState = QSO_DISPLAY_DEFAULT_SCREEN;
 		uiVFOModeUpdateScreen(0);
 		prevCSSTone = (CODEPLUG_CSS_TONE_NONE - 1);
 		uiDataGlobal.Scan.toneActive = false;
+		cssDetectorStop();
 		return;
 	}
 
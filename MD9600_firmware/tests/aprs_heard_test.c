@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+//
+// aprsHeard.c unit tests, and a benchmark with a synthetic packet stream of a busy area.
+//
+// The great circle math of aprs.c isn't linked (aprs.c needs the whole radio), it is replaced by an independent
+// haversine implementation, which is also used to check the lazily computed distances and bearings.
+//
+#include <math.h>
+#include <string.h>
+#include "testUtils.h"
+#include "functions/aprs.h"
+
+#define BENCHMARK_STATIONS     500U // heard in the area, more than the table holds
+#define BENCHMARK_PACKETS   200000U
+
+static uint32_t millis;
+static uint32_t distanceComputations;
+
+uint32_t ticksGetMillis(void)
+{
+	return millis;
+}
+
+static double toRadians(double degrees)
+{
+	return (degrees * M_PI / 180.0);
+}
+
+double aprsDistanceBetweenTwoCoords(double lat1, double lon1, double lat2, double lon2)
+{
+	double dLat = toRadians(lat2 - lat1);
+	double dLon = toRadians(lon2 - lon1);
+	double a = (sin(dLat / 2) * sin(dLat / 2)) + (cos(toRadians(lat1)) * cos(toRadians(lat2)) * sin(dLon / 2) * sin(dLon / 2));
+
+	distanceComputations++;
+
+	return (6372795.0 * 2.0 * atan2(sqrt(a), sqrt(1.0 - a)));
+}
+
+double aprsCourseTo(double lat1, double lon1, double lat2, double lon2)
+{
+	double dLon = toRadians(lon2 - lon1);
+	double y = (sin(dLon) * cos(toRadians(lat2)));
+	double x = ((cos(toRadians(lat1)) * sin(toRadians(lat2))) - (sin(toRadians(lat1)) * cos(toRadians(lat2)) * cos(dLon)));
+	double course = (atan2(y, x) * 180.0 / M_PI);
+
+	return ((course < 0.0) ? (course + 360.0) : course);
+}
+
+static void stationCallsign(char *callsign, uint32_t n)
+{
+	snprintf(callsign, APRS_HEARD_CALLSIGN_LEN_MAX, "F%uAB-%u", ((n / 16) % 1000), (n % 16));
+}
+
+static uint32_t listLength(void)
+{
+	uint32_t length = 0;
+
+	for (aprsHeardStation_t *station = aprsHeardGetFirst(); station != NULL; station = aprsHeardGetNext(station))
+	{
+		length++;
+		TEST_CHECK(length <= APRS_HEARD_LIST_SIZE);
+	}
+
+	return length;
+}
+
+static void testUpdateAndFind(void)
+{
+	aprsHeardClear();
+	millis = 1000;
+
+	TEST_CHECK(aprsHeardGetFirst() == NULL);
+	TEST_CHECK(aprsHeardFind("VK3KYY") == NULL);
+
+	aprsHeardStation_t *station = aprsHeardUpdate("VK3KYY-9", -37.8, 145.0, 90, 30, "Mobile");
+	TEST_CHECK(station != NULL);
+	TEST_CHECK(aprsHeardGetCount() == 1);
+	TEST_CHECK(aprsHeardFind("VK3KYY-9") == station);
+	TEST_CHECK(aprsHeardFind("VK3KYY") == NULL);
+	TEST_CHECK(strcmp(station->comment, "Mobile") == 0);
+	TEST_CHECK(station->time == 1000);
+
+	// A packet without position keeps the previous one, and the comment is only replaced when there is one
+	millis = 2000;
+	TEST_CHECK(aprsHeardUpdate("VK3KYY-9", NAN, NAN, 180, 10, NULL) == station);
+	TEST_CHECK(aprsHeardGetCount() == 1);
+	TEST_CHECK(station->latitude == -37.8);
+	TEST_CHECK(station->course == 180);
+	TEST_CHECK(strcmp(station->comment, "Mobile") == 0);
+	TEST_CHECK(station->time == 2000);
+
+	// Long callsigns and comments are truncated
+	station = aprsHeardUpdate("ABCDEFGHIJKLMNOP", NAN, NAN, 0, 0, "0123456789012345678901234567890123456789012345678");
+	TEST_CHECK(strlen(station->callsign) == (APRS_HEARD_CALLSIGN_LEN_MAX - 1));
+	TEST_CHECK(strlen(station->comment) == (APRS_HEARD_COMMENT_LEN_MAX - 1));
+	TEST_CHECK(aprsHeardFind("ABCDEFGHIJ") == station);
+	TEST_CHECK(aprsHeardFind("ABCDEFGHIJKLMNOP") == station);
+}
+
+static void testSameCallsignIsOneStation(void)
+{
+	// The longest callsign-SSID fits as it is
+	aprsHeardClear();
+	aprsHeardStation_t *station = aprsHeardUpdate("CALLSIG-SS", NAN, NAN, 0, 0, NULL);
+	TEST_CHECK(strcmp(station->callsign, "CALLSIG-SS") == 0);
+	TEST_CHECK(aprsHeardUpdate("CALLSIG-SS", NAN, NAN, 0, 0, NULL) == station);
+	TEST_CHECK(aprsHeardGetCount() == 1);
+	TEST_CHECK(aprsHeardFind("CALLSIG-SS") == station);
+
+	// A too long one is truncated on both update and lookup
+	aprsHeardClear();
+	station = aprsHeardUpdate("TOOLONGCALL-15", NAN, NAN, 0, 0, NULL);
+	TEST_CHECK(aprsHeardUpdate("TOOLONGCALL-15", NAN, NAN, 0, 0, NULL) == station);
+	TEST_CHECK(aprsHeardGetCount() == 1);
+	TEST_CHECK(aprsHeardFind("TOOLONGCALL-15") == station);
+}
+
+static void testMostRecentlyHeardFirst(void)
+{
+	aprsHeardClear();
+
+	aprsHeardUpdate("A1", NAN, NAN, 0, 0, NULL);
+	aprsHeardUpdate("B2", NAN, NAN, 0, 0, NULL);
+	aprsHeardUpdate("C3", NAN, NAN, 0, 0, NULL);
+	aprsHeardUpdate("A1", NAN, NAN, 0, 0, NULL);
+
+	aprsHeardStation_t *station = aprsHeardGetFirst();
+	TEST_CHECK(strcmp(station->callsign, "A1") == 0);
+	station = aprsHeardGetNext(station);
+	TEST_CHECK(strcmp(station->callsign, "C3") == 0);
+	station = aprsHeardGetNext(station);
+	TEST_CHECK(strcmp(station->callsign, "B2") == 0);
+	TEST_CHECK(aprsHeardGetNext(station) == NULL);
+}
+
+static void testLeastRecentlyHeardIsRecycled(void)
+{
+	char callsign[APRS_HEARD_CALLSIGN_LEN_MAX];
+
+	aprsHeardClear();
+
+	for (uint32_t n = 0; n < APRS_HEARD_LIST_SIZE; n++)
+	{
+		stationCallsign(callsign, n);
+		aprsHeardUpdate(callsign, NAN, NAN, 0, 0, NULL);
+	}
+	TEST_CHECK(aprsHeardGetCount() == APRS_HEARD_LIST_SIZE);
+
+	// Station 0 is heard again, station 1 becomes the oldest
+	stationCallsign(callsign, 0);
+	aprsHeardUpdate(callsign, NAN, NAN, 0, 0, NULL);
+
+	stationCallsign(callsign, APRS_HEARD_LIST_SIZE);
+	aprsHeardStation_t *station = aprsHeardUpdate(callsign, NAN, NAN, 0, 0, NULL);
+	TEST_CHECK(aprsHeardGetCount() == APRS_HEARD_LIST_SIZE);
+	TEST_CHECK(aprsHeardGetFirst() == station);
+	TEST_CHECK(listLength() == APRS_HEARD_LIST_SIZE);
+
+	// The recycled station is gone from its hash bucket, all the others are still found
+	stationCallsign(callsign, 1);
+	TEST_CHECK(aprsHeardFind(callsign) == NULL);
+
+	for (uint32_t n = 0; n <= APRS_HEARD_LIST_SIZE; n++)
+	{
+		if (n != 1)
+		{
+			stationCallsign(callsign, n);
+			TEST_CHECK(aprsHeardFind(callsign) != NULL);
+		}
+	}
+}
+
+static void testDistanceAndBearingAreComputedLazily(void)
+{
+	aprsHeardStation_t *north;
+	aprsHeardStation_t *east;
+	uint32_t distance;
+	uint16_t bearing;
+
+	aprsHeardClear();
+
+	north = aprsHeardUpdate("NORTH", 45.1, 5.0, 0, 0, NULL);
+	east = aprsHeardUpdate("EAST", 45.0, 5.1, 0, 0, NULL);
+	TEST_CHECK(aprsHeardUpdate("NOPOS", NAN, NAN, 0, 0, NULL) != NULL);
+
+	// Unknown own position
+	TEST_CHECK(aprsHeardGetDistanceAndBearing(north, &distance, &bearing) == false);
+
+	aprsHeardSetOwnPosition(45.0, 5.0);
+	distanceComputations = 0;
+	TEST_CHECK(aprsHeardGetDistanceAndBearing(north, &distance, &bearing));
+	TEST_CHECK((distance > 11100) && (distance < 11150));
+	TEST_CHECK(bearing == 0);
+	TEST_CHECK(aprsHeardGetDistanceAndBearing(east, &distance, &bearing));
+	TEST_CHECK((distance > 7850) && (distance < 7900));
+	TEST_CHECK(bearing == 90);
+	TEST_CHECK(aprsHeardGetDistanceAndBearing(aprsHeardFind("NOPOS"), &distance, &bearing) == false);
+	TEST_CHECK(distanceComputations == 2);
+
+	// Cached while nothing moves
+	TEST_CHECK(aprsHeardGetDistanceAndBearing(north, &distance, &bearing));
+	TEST_CHECK(distanceComputations == 2);
+
+	// Less than 25m: kept
+	aprsHeardSetOwnPosition(45.0001, 5.0);
+	distanceComputations = 0;
+	TEST_CHECK(aprsHeardGetDistanceAndBearing(north, &distance, &bearing));
+	TEST_CHECK(distanceComputations == 0);
+
+	// The station moved
+	aprsHeardUpdate("NORTH", 45.2, 5.0, 0, 0, NULL);
+	TEST_CHECK(aprsHeardGetDistanceAndBearing(north, &distance, &bearing));
+	TEST_CHECK((distance > 22200) && (distance < 22300));
+	TEST_CHECK(distanceComputations == 1);
+
+	// We moved: each station is recomputed once
+	aprsHeardSetOwnPosition(45.0, 5.2);
+	distanceComputations = 0;
+	TEST_CHECK(aprsHeardGetDistanceAndBearing(east, &distance, &bearing));
+	TEST_CHECK(bearing == 270);
+	TEST_CHECK(aprsHeardGetDistanceAndBearing(east, &distance, &bearing));
+	TEST_CHECK(aprsHeardGetDistanceAndBearing(north, &distance, &bearing));
+	TEST_CHECK(distanceComputations == 2);
+}
+
+// A busy area: BENCHMARK_STATIONS stations, a few of them (digipeaters, weather stations) much more often heard
+// than the others, 1 packet out of 3 without position, and our position moving every 1000 packets, the heard list
+// being walked with the distances every 100 packets, like a heard stations screen would.
+static void benchmarkBusyArea(void)
+{
+	char callsign[APRS_HEARD_CALLSIGN_LEN_MAX];
+	uint32_t seed = 0x12345678U;
+	uint64_t updateTime = 0;
+	uint64_t listTime = 0;
+	uint32_t listWalks = 0;
+	uint32_t distance;
+	uint16_t bearing;
+
+	aprsHeardClear();
+	distanceComputations = 0;
+
+	for (uint32_t p = 0; p < BENCHMARK_PACKETS; p++)
+	{
+		uint32_t r = testRandom(&seed);
+		uint32_t n = (((r & 3) == 0) ? ((r >> 8) % 16) : ((r >> 8) % BENCHMARK_STATIONS));
+		double latitude = (((p % 3) == 0) ? NAN : (45.0 + ((double)(n % 40) * 0.01)));
+		double longitude = (5.0 + ((double)(n / 40) * 0.01));
+		uint64_t start;
+
+		stationCallsign(callsign, n);
+		millis = p;
+
+		start = testGetNanoseconds();
+		TEST_CHECK(aprsHeardUpdate(callsign, latitude, longitude, (r % 360), (r % 100), "Comment") != NULL);
+		updateTime += (testGetNanoseconds() - start);
+
+		if ((p % 1000) == 0)
+		{
+			aprsHeardSetOwnPosition((45.0 + ((double)p / 1e7)), 5.0);
+		}
+
+		if ((p % 100) == 0)
+		{
+			start = testGetNanoseconds();
+			for (aprsHeardStation_t *station = aprsHeardGetFirst(); station != NULL; station = aprsHeardGetNext(station))
+			{
+				aprsHeardGetDistanceAndBearing(station, &distance, &bearing);
+			}
+			listTime += (testGetNanoseconds() - start);
+			listWalks++;
+		}
+	}
+
+	TEST_CHECK(aprsHeardGetCount() == APRS_HEARD_LIST_SIZE);
+	TEST_CHECK(listLength() == APRS_HEARD_LIST_SIZE);
+
+	printf("benchmark: %u packets from %u stations, update %.1f ns, heard list walk with distances %.1f us, "
+			"%.1f distance computations per walk\n", BENCHMARK_PACKETS, BENCHMARK_STATIONS,
+			((double)updateTime / BENCHMARK_PACKETS), ((double)listTime / listWalks / 1000.0),
+			((double)distanceComputations / listWalks));
+}
+
+int main(void)
+{
+	TEST_RUN(testUpdateAndFind);
+	TEST_RUN(testSameCallsignIsOneStation);
+	TEST_RUN(testMostRecentlyHeardFirst);
+	TEST_RUN(testLeastRecentlyHeardIsRecycled);
+	TEST_RUN(testDistanceAndBearingAreComputedLazily);
+	TEST_RUN(benchmarkBusyArea);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,441 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+//
+// The per task CPU load accounting of cpuStats.c: cpuStatsAccount() fed with synthetic uxTaskGetSystemState()
+// snapshots (the first update, the loads, the run time counters wrapping, tasks created and deleted, more tasks than
+// CPU_STATS_TASKS_MAX), a random run against the expected loads, then cpuStatsTick() and the TIM5 setup.
+//
+#include <string.h>
+#include "testUtils.h"
+#include "main.h"
+#include "functions/cpuStats.h"
+#include "functions/taskMemory.h"
+
+#define RANDOM_UPDATES 100000U
+
+TIM_TypeDef mockTIM5;
+RCC_TypeDef mockRCC;
+volatile uint32_t uwTick;
+
+static uint32_t pclk1Frequency;
+
+// Snapshot returned by uxTaskGetSystemState()
+static TaskStatus_t snapshot[CPU_STATS_TASKS_MAX + 4];
+static uint32_t snapshotCount;
+static uint32_t snapshotTotalRunTime;
+static uint32_t systemStateCalls;
+
+// Task stacks, as registered with taskMemory
+static StackType_t stacks[CPU_STATS_TASKS_MAX + 4][4];
+
+static int taskTag[CPU_STATS_TASKS_MAX + 4]; // handles
+#define TASK(n) ((TaskHandle_t)&taskTag[(n)])
+
+int menuSystemGetCurrentMenuNumber(void)
+{
+	return 0;
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void)
+{
+	return pclk1Frequency;
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *status, UBaseType_t arraySize, uint32_t *totalRunTime)
+{
+	systemStateCalls++;
+
+	if (snapshotCount > arraySize)
+	{
+		return 0;
+	}
+
+	memcpy(status, snapshot, (snapshotCount * sizeof(TaskStatus_t)));
+	*totalRunTime = snapshotTotalRunTime;
+
+	return snapshotCount;
+}
+
+UBaseType_t uxTaskGetNumberOfTasks(void)
+{
+	return snapshotCount;
+}
+
+TaskHandle_t xTaskGetIdleTaskHandle(void)
+{
+	return TASK(0);
+}
+
+size_t xPortGetFreeHeapSize(void)
+{
+	return 12000;
+}
+
+size_t xPortGetMinimumEverFreeHeapSize(void)
+{
+	return 9000;
+}
+
+// Task n has a (100 * (n + 1)) words stack, the last one isn't registered
+uint32_t taskMemoryGetStackSize(const StackType_t *stack)
+{
+	for (uint32_t i = 0; i < (CPU_STATS_TASKS_MAX + 3); i++)
+	{
+		if (stack == stacks[i])
+		{
+			return (100 * (i + 1));
+		}
+	}
+
+	return 0;
+}
+
+static const char *TASK_NAMES[] = { "IDLE", "Tmr Svc", "defaultTask", "hrc6000Task", "displayTask", "audioTask", "beepTask", "ThisNameIsLongerThan15" };
+
+// Task n, at position index of the snapshot (uxTaskGetSystemState() doesn't list them by number)
+static void snapshotSetTask(uint32_t index, uint32_t n, uint32_t runTime)
+{
+	snapshot[index] = (TaskStatus_t){
+		.xHandle = TASK(n),
+		.pcTaskName = TASK_NAMES[n % (sizeof(TASK_NAMES) / sizeof(TASK_NAMES[0]))],
+		.xTaskNumber = (n + 1),
+		.eCurrentState = ((n == 0) ? eRunning : eBlocked),
+		.uxCurrentPriority = n,
+		.uxBasePriority = n,
+		.ulRunTimeCounter = runTime,
+		.pxStackBase = stacks[n],
+		.usStackHighWaterMark = (50 + n)
+	};
+}
+
+static const cpuStatsTask_t *statsFindTask(const cpuStats_t *stats, uint32_t n)
+{
+	for (uint32_t i = 0; i < stats->taskCount; i++)
+	{
+		if (stats->tasks[i].handle == TASK(n))
+		{
+			return &stats->tasks[i];
+		}
+	}
+
+	return NULL;
+}
+
+// No reference yet: the loads are 0, the tasks are listed in creation order
+static void testFirstUpdate(void)
+{
+	cpuStats_t stats;
+
+	memset(&stats, 0, sizeof(stats));
+	for (uint32_t i = 0; i < 8; i++)
+	{
+		snapshotSetTask(i, (7 - i), (1000 * i));
+	}
+	cpuStatsAccount(&stats, snapshot, 8, 500000, TASK(0));
+
+	TEST_CHECK(stats.taskCount == 8);
+	TEST_CHECK(stats.totalRunTime == 500000);
+	TEST_CHECK(stats.periodRunTime == 0);
+	TEST_CHECK(stats.loadPermille == 0);
+
+	for (uint32_t i = 0; i < 8; i++)
+	{
+		const cpuStatsTask_t *task = &stats.tasks[i];
+
+		TEST_CHECK(task->handle == TASK(i));
+		TEST_CHECK(task->number == (i + 1));
+		TEST_CHECK(task->loadPermille == 0);
+		TEST_CHECK(task->runTime == (1000 * (7 - i)));
+		TEST_CHECK(task->priority == i);
+		TEST_CHECK(task->stackHighWater == (50 + i));
+		TEST_CHECK(task->stackSize == (100 * (i + 1)));
+		TEST_CHECK(strncmp(task->name, TASK_NAMES[i], (configMAX_TASK_NAME_LEN - 1)) == 0);
+		TEST_CHECK(strlen(task->name) < configMAX_TASK_NAME_LEN);
+	}
+	TEST_CHECK(strcmp(stats.tasks[7].name, "ThisNameIsLonge") == 0); // truncated
+}
+
+// The loads over the period, the idle task not counted in the total load
+static void testLoads(void)
+{
+	cpuStats_t stats;
+
+	memset(&stats, 0, sizeof(stats));
+	snapshotSetTask(0, 0, 0);
+	snapshotSetTask(1, 1, 0);
+	snapshotSetTask(2, 2, 0);
+	snapshotSetTask(3, 3, 0);
+	cpuStatsAccount(&stats, snapshot, 4, 0, TASK(0));
+
+	// 1 s: idle 70%, 1 at 20%, 2 at 9.99%, 3 at 0.01%
+	snapshotSetTask(0, 2, 99900);
+	snapshotSetTask(1, 0, 700000);
+	snapshotSetTask(2, 3, 100);
+	snapshotSetTask(3, 1, 200000);
+	cpuStatsAccount(&stats, snapshot, 4, 1000000, TASK(0));
+
+	TEST_CHECK(stats.periodRunTime == 1000000);
+	TEST_CHECK(statsFindTask(&stats, 0)->loadPermille == 700);
+	TEST_CHECK(statsFindTask(&stats, 1)->loadPermille == 200);
+	TEST_CHECK(statsFindTask(&stats, 2)->loadPermille == 99); // rounded down
+	TEST_CHECK(statsFindTask(&stats, 3)->loadPermille == 0);
+	TEST_CHECK(stats.loadPermille == 299);
+
+	// Nothing ran but the idle task
+	snapshotSetTask(0, 0, 1700000);
+	snapshotSetTask(1, 1, 200000);
+	snapshotSetTask(2, 2, 99900);
+	snapshotSetTask(3, 3, 100);
+	cpuStatsAccount(&stats, snapshot, 4, 2000000, TASK(0));
+	TEST_CHECK(statsFindTask(&stats, 0)->loadPermille == 1000);
+	TEST_CHECK(stats.loadPermille == 0);
+
+	// A task counter ahead of the total (they are read at slightly different times) is clamped
+	snapshotSetTask(0, 0, 1700000);
+	snapshotSetTask(1, 1, 1300000);
+	cpuStatsAccount(&stats, snapshot, 4, 3000000, TASK(0));
+	TEST_CHECK(statsFindTask(&stats, 1)->loadPermille == 1000);
+	TEST_CHECK(stats.loadPermille == 1000);
+
+	// Same total, no period
+	cpuStatsAccount(&stats, snapshot, 4, 3000000, TASK(0));
+	TEST_CHECK(stats.periodRunTime == 0);
+	TEST_CHECK(stats.loadPermille == 0);
+}
+
+// The counters wrap every ~71 minutes, only their differences matter
+static void testCounterWrap(void)
+{
+	cpuStats_t stats;
+	uint32_t start = (UINT32_MAX - 250000);
+
+	memset(&stats, 0, sizeof(stats));
+	snapshotSetTask(0, 0, (UINT32_MAX - 100000));
+	snapshotSetTask(1, 1, (UINT32_MAX - 10));
+	cpuStatsAccount(&stats, snapshot, 2, start, TASK(0));
+
+	snapshotSetTask(0, 0, (UINT32_MAX - 100000 + 600000));
+	snapshotSetTask(1, 1, (UINT32_MAX - 10 + 400000));
+	cpuStatsAccount(&stats, snapshot, 2, (start + 1000000), TASK(0));
+
+	TEST_CHECK(stats.totalRunTime < start);
+	TEST_CHECK(stats.periodRunTime == 1000000);
+	TEST_CHECK(statsFindTask(&stats, 0)->loadPermille == 600);
+	TEST_CHECK(statsFindTask(&stats, 1)->loadPermille == 400);
+	TEST_CHECK(stats.loadPermille == 400);
+}
+
+// A new task has no reference, a deleted one is dropped, and a handle is matched whatever the snapshot order
+static void testTasksCreatedAndDeleted(void)
+{
+	cpuStats_t stats;
+
+	memset(&stats, 0, sizeof(stats));
+	snapshotSetTask(0, 0, 0);
+	snapshotSetTask(1, 1, 0);
+	snapshotSetTask(2, 2, 0);
+	cpuStatsAccount(&stats, snapshot, 3, 0, TASK(0));
+
+	// 2 deleted, 4 created with a counter already running
+	snapshotSetTask(0, 4, 300000);
+	snapshotSetTask(1, 1, 500000);
+	snapshotSetTask(2, 0, 500000);
+	cpuStatsAccount(&stats, snapshot, 3, 1000000, TASK(0));
+
+	TEST_CHECK(stats.taskCount == 3);
+	TEST_CHECK(statsFindTask(&stats, 2) == NULL);
+	TEST_CHECK(statsFindTask(&stats, 4)->loadPermille == 0);
+	TEST_CHECK(statsFindTask(&stats, 1)->loadPermille == 500);
+	TEST_CHECK(stats.tasks[2].handle == TASK(4));
+
+	// Now 4 has its reference
+	snapshotSetTask(0, 4, 400000);
+	snapshotSetTask(1, 1, 900000);
+	snapshotSetTask(2, 0, 1000000);
+	cpuStatsAccount(&stats, snapshot, 3, 2000000, TASK(0));
+	TEST_CHECK(statsFindTask(&stats, 4)->loadPermille == 100);
+	TEST_CHECK(statsFindTask(&stats, 1)->loadPermille == 400);
+	TEST_CHECK(stats.loadPermille == 500);
+}
+
+// cpuStatsAccount() keeps CPU_STATS_TASKS_MAX tasks, cpuStatsTick() flags a snapshot which doesn't fit and keeps the
+// previous stats
+static void testTooManyTasks(void)
+{
+	cpuStats_t stats;
+
+	memset(&stats, 0, sizeof(stats));
+	for (uint32_t i = 0; i < (CPU_STATS_TASKS_MAX + 2); i++)
+	{
+		snapshotSetTask(i, i, 0);
+	}
+	cpuStatsAccount(&stats, snapshot, (CPU_STATS_TASKS_MAX + 2), 0, TASK(0));
+	TEST_CHECK(stats.taskCount == CPU_STATS_TASKS_MAX);
+	TEST_CHECK(stats.tasks[CPU_STATS_TASKS_MAX - 1].handle == TASK(CPU_STATS_TASKS_MAX - 1));
+
+	uwTick = 1000;
+	cpuStatsInit();
+	snapshotCount = 3;
+	snapshotTotalRunTime = 0;
+	cpuStatsTick();
+	TEST_CHECK(cpuStatsGet()->taskCount == 3);
+	TEST_CHECK(cpuStatsGet()->overflow == false);
+
+	snapshotCount = (CPU_STATS_TASKS_MAX + 1);
+	snapshotTotalRunTime = 1000000;
+	uwTick += CPU_STATS_UPDATE_PERIOD;
+	cpuStatsTick();
+	TEST_CHECK(cpuStatsGet()->overflow);
+	TEST_CHECK(cpuStatsGet()->taskCount == 3);
+	TEST_CHECK(cpuStatsGet()->totalRunTime == 0);
+
+	snapshotCount = 3;
+	uwTick += CPU_STATS_UPDATE_PERIOD;
+	cpuStatsTick();
+	TEST_CHECK(cpuStatsGet()->overflow == false);
+	TEST_CHECK(cpuStatsGet()->periodRunTime == 1000000);
+}
+
+// Random periods split between the tasks: each load is the rounded down share of the period
+static void testRandomUpdates(void)
+{
+	cpuStats_t stats;
+	uint32_t seed = 0x43505553;
+	uint32_t runTimes[CPU_STATS_TASKS_MAX] = { 0 };
+	uint32_t totalRunTime = (testRandom(&seed));
+
+	memset(&stats, 0, sizeof(stats));
+
+	for (uint32_t update = 0; update < RANDOM_UPDATES; update++)
+	{
+		uint32_t count = (1 + (testRandom(&seed) % CPU_STATS_TASKS_MAX));
+		uint32_t period = (1 + (testRandom(&seed) % 2000000));
+		uint32_t deltas[CPU_STATS_TASKS_MAX] = { 0 };
+		uint32_t left = period;
+		uint32_t expectedBusy = 0;
+
+		if (update > 0)
+		{
+			// The task count only changes on the first update, to keep all the references
+			count = stats.taskCount;
+		}
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			deltas[i] = ((i == (count - 1)) ? left : (testRandom(&seed) % (left + 1)));
+			left -= deltas[i];
+		}
+
+		totalRunTime += period;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			runTimes[i] += deltas[i];
+			// Listed in a random rotation
+			snapshotSetTask(((i + update) % count), i, runTimes[i]);
+		}
+
+		cpuStatsAccount(&stats, snapshot, count, totalRunTime, TASK(0));
+		TEST_CHECK(stats.taskCount == count);
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			uint32_t expected = ((update == 0) ? 0 : (uint32_t)(((uint64_t)deltas[i] * 1000) / period));
+
+			TEST_CHECK(stats.tasks[i].handle == TASK(i));
+			TEST_CHECK(stats.tasks[i].loadPermille == expected);
+			if (i != 0)
+			{
+				expectedBusy += expected;
+			}
+		}
+		TEST_CHECK(stats.loadPermille == expectedBusy);
+	}
+}
+
+// Updated right away, then once per CPU_STATS_UPDATE_PERIOD
+static void testTick(void)
+{
+	uwTick = 5000;
+	systemStateCalls = 0;
+	cpuStatsInit();
+	snapshotCount = 2;
+	snapshotSetTask(0, 0, 0);
+	snapshotSetTask(1, 1, 0);
+	snapshotTotalRunTime = 0;
+
+	cpuStatsTick();
+	TEST_CHECK(systemStateCalls == 1);
+	TEST_CHECK(cpuStatsGet()->heapFree == 12000);
+	TEST_CHECK(cpuStatsGet()->heapMinimumEverFree == 9000);
+
+	snapshotSetTask(0, 0, 250000);
+	snapshotSetTask(1, 1, 750000);
+	snapshotTotalRunTime = 1000000;
+	uwTick += (CPU_STATS_UPDATE_PERIOD - 1);
+	cpuStatsTick();
+	TEST_CHECK(systemStateCalls == 1);
+
+	uwTick++;
+	cpuStatsTick();
+	TEST_CHECK(systemStateCalls == 2);
+	TEST_CHECK(cpuStatsGet()->loadPermille == 750);
+}
+
+// TIM5 counts at CPU_STATS_COUNTER_FREQUENCY, its clock being twice PCLK1 when APB1 is divided
+static void testConfigureTimer(void)
+{
+	pclk1Frequency = 42000000;
+	mockRCC.CFGR = RCC_CFGR_PPRE1_DIV4;
+	mockTIM5.CNT = 1234;
+	cpuStatsConfigureTimer();
+	TEST_CHECK(mockTIM5.PSC == 83);
+	TEST_CHECK(mockTIM5.ARR == 0xFFFFFFFF);
+	TEST_CHECK(mockTIM5.CNT == 0);
+	TEST_CHECK(mockTIM5.CR1 == TIM_CR1_CEN);
+
+	pclk1Frequency = 16000000;
+	mockRCC.CFGR = RCC_CFGR_PPRE1_DIV1;
+	cpuStatsConfigureTimer();
+	TEST_CHECK(mockTIM5.PSC == 15);
+
+	mockTIM5.CNT = 0xFFFFFFF0;
+	TEST_CHECK(cpuStatsGetRunTimeCounter() == 0xFFFFFFF0);
+}
+
+int main(void)
+{
+	TEST_RUN(testFirstUpdate);
+	TEST_RUN(testLoads);
+	TEST_RUN(testCounterWrap);
+	TEST_RUN(testTasksCreatedAndDeleted);
+	TEST_RUN(testTooManyTasks);
+	TEST_RUN(testRandomUpdates);
+	TEST_RUN(testTick);
+	TEST_RUN(testConfigureTimer);
+
+	return EXIT_SUCCESS;
+}
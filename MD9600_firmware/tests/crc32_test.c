@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+//
+// crc32.c, as used by the sector hash CPS command ('H'), against a known Flash image.
+//
+// data/flash_image.bin is 10000 bytes: an erased sector, a sector of pseudo random data, and a partially written
+// one. As in tools/cps_stream/cps_sector_diff.py, the image is padded with the erased state up to a whole number of
+// sectors, then each sector is hashed in reads of the same size as the radio does. The expected values were
+// computed with Python's zlib.crc32().
+//
+#include <stdbool.h>
+#include <string.h>
+#include "testUtils.h"
+#include "functions/crc32.h"
+
+#define IMAGE_PATH              "data/flash_image.bin"
+#define IMAGE_SIZE              10000U
+#define SECTOR_SIZE              4096U // CPS_SECTOR_SIZE
+#define HASH_READ_SIZE            256U // CPS_HASH_READ_SIZE
+#define IMAGE_SECTORS              3U
+
+static const uint32_t IMAGE_SECTOR_CRCS[IMAGE_SECTORS] = { 0xF154670A, 0x310C3E6C, 0xDA7C8D07 };
+#define IMAGE_CRC               0xC39BB971 // whole file, without the padding
+#define IMAGE_SECTOR1_FLIPPED_CRC 0x65428F2B // sector 1, bit 0 of its byte 100 flipped
+
+static uint8_t image[IMAGE_SECTORS * SECTOR_SIZE];
+
+static void imageLoad(void)
+{
+	FILE *f = fopen(IMAGE_PATH, "rb");
+
+	TEST_CHECK(f != NULL);
+	memset(image, 0xFF, sizeof(image));
+	TEST_CHECK(fread(image, 1, sizeof(image), f) == IMAGE_SIZE);
+	fclose(f);
+}
+
+// Same loop as cpsHandleHashCommand(), the Flash reads being replaced by the image
+static uint32_t sectorHash(uint32_t sector)
+{
+	uint32_t crc = 0;
+
+	for (uint32_t offset = 0; offset < SECTOR_SIZE; offset += HASH_READ_SIZE)
+	{
+		crc = crc32Update(crc, &image[(sector * SECTOR_SIZE) + offset], HASH_READ_SIZE);
+	}
+
+	return crc;
+}
+
+static void testCheckValue(void)
+{
+	TEST_CHECK(crc32Update(0, (const uint8_t *)"123456789", 9) == 0xCBF43926);
+	TEST_CHECK(crc32Update(0, (const uint8_t *)"", 0) == 0);
+}
+
+static void testSplitUpdatesMatchOneUpdate(void)
+{
+	const uint32_t CHUNK_SIZES[] = { 1, 7, HASH_READ_SIZE, IMAGE_SIZE };
+
+	imageLoad();
+
+	for (uint32_t i = 0; i < (sizeof(CHUNK_SIZES) / sizeof(CHUNK_SIZES[0])); i++)
+	{
+		uint32_t crc = 0;
+
+		for (uint32_t offset = 0; offset < IMAGE_SIZE; offset += CHUNK_SIZES[i])
+		{
+			uint32_t length = (((IMAGE_SIZE - offset) < CHUNK_SIZES[i]) ? (IMAGE_SIZE - offset) : CHUNK_SIZES[i]);
+
+			crc = crc32Update(crc, &image[offset], length);
+		}
+
+		TEST_CHECK(crc == IMAGE_CRC);
+	}
+}
+
+static void testImageSectorHashes(void)
+{
+	imageLoad();
+
+	for (uint32_t s = 0; s < IMAGE_SECTORS; s++)
+	{
+		TEST_CHECK(sectorHash(s) == IMAGE_SECTOR_CRCS[s]);
+	}
+}
+
+static void testChangedSectorIsDetected(void)
+{
+	imageLoad();
+	image[SECTOR_SIZE + 100] ^= 0x01;
+
+	TEST_CHECK(sectorHash(0) == IMAGE_SECTOR_CRCS[0]);
+	TEST_CHECK(sectorHash(1) == IMAGE_SECTOR1_FLIPPED_CRC);
+	TEST_CHECK(sectorHash(2) == IMAGE_SECTOR_CRCS[2]);
+}
+
+int main(void)
+{
+	TEST_RUN(testCheckValue);
+	TEST_RUN(testSplitUpdatesMatchOneUpdate);
+	TEST_RUN(testImageSectorHashes);
+	TEST_RUN(testChangedSectorIsDetected);
+
+	return EXIT_SUCCESS;
+}
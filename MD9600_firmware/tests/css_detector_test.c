@@ -0,0 +1,431 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+//
+// cssDetector.c against synthetic 8kHz audio: every CTCSS tone and DCS code, normal and inverted, with and without
+// voice and noise, the rejection of the signals which aren't a tone, then a benchmark.
+//
+// The DCS bit streams are built with an independent Golay(23,12) encoder, checked against a published codeword.
+// The CTCSS and DCS tables are the ones of trx.c, which needs the whole radio.
+//
+#include <math.h>
+#include <string.h>
+#include "testUtils.h"
+#include "main.h"
+#include "functions/cssDetector.h"
+#include "functions/dtmfDecoder.h"
+
+#define TONE_AMPLITUDE      2000.0 // sub-audible tones are sent at a low level
+#define VOICE_AMPLITUDE     8000.0
+#define DCS_BIT_RATE         134.4
+#define DETECTION_TIME         600U // ms, 2 CTCSS windows (the first one may be partial), or 80 DCS bits
+#define BENCHMARK_SECONDS       60U
+
+const uint8_t TRX_NUM_CTCSS = 50U;
+const uint16_t TRX_CTCSSTones[] = {
+		670,  693,  719,  744,  770,  797,  825,  854,  885,  915,
+		948,  974, 1000, 1035, 1072, 1109, 1148, 1188, 1230, 1273,
+		1318, 1365, 1413, 1462, 1514, 1567, 1598, 1622, 1655, 1679,
+		1713, 1738, 1773, 1799, 1835, 1862, 1899, 1928, 1966, 1995,
+		2035, 2065, 2107, 2181, 2257, 2291, 2336, 2418, 2503, 2541
+};
+
+const uint8_t TRX_NUM_DCS = 83U;
+const uint16_t TRX_DCSCodes[] = {
+		0x023, 0x025, 0x026, 0x031, 0x032, 0x043, 0x047, 0x051, 0x054, 0x065, 0x071, 0x072, 0x073, 0x074,
+		0x114, 0x115, 0x116, 0x125, 0x131, 0x132, 0x134, 0x143, 0x152, 0x155, 0x156, 0x162, 0x165, 0x172, 0x174,
+		0x205, 0x223, 0x226, 0x243, 0x244, 0x245, 0x251, 0x261, 0x263, 0x265, 0x271,
+		0x306, 0x311, 0x315, 0x331, 0x343, 0x345, 0x351, 0x364, 0x365, 0x371,
+		0x411, 0x412, 0x413, 0x423, 0x431, 0x432, 0x445, 0x464, 0x465, 0x466,
+		0x503, 0x506, 0x516, 0x532, 0x546, 0x565,
+		0x606, 0x612, 0x624, 0x627, 0x631, 0x632, 0x654, 0x662, 0x664,
+		0x703, 0x712, 0x723, 0x731, 0x732, 0x734, 0x743, 0x754
+};
+
+int mockCriticalNesting;
+static uint32_t soundMonitorStarts;
+static uint32_t noiseSeed = 0x13579BDFU;
+
+typedef struct
+{
+	double   ctcss; // Hz, 0 for none
+	double   ctcssAmplitude;
+	uint32_t dcsWord; // 23 bits codeword, 0 for none
+	bool     dcsInverted;
+	double   dcsBitRate;
+	double   voice; // Hz, 0 for none
+	double   noise; // peak amplitude
+	uint32_t sample; // running sample index
+} signal_t;
+
+void soundMonitorStart(void)
+{
+	soundMonitorStarts++;
+}
+
+void soundMonitorStop(void)
+{
+}
+
+bool dtmfDecoderIsActive(void)
+{
+	return false;
+}
+
+// Golay(23,12) by long division with the generator x^11 + x^10 + x^6 + x^5 + x^4 + x^2 + 1 (0xC75).
+// The 12 data bits are the 9 bits code (3 octal digits) and the 100 marker, sent first, followed by the 11 parity bits.
+static uint32_t dcsCodeword(uint16_t code)
+{
+	uint32_t data = (0x800 | (((code >> 8) & 0x07) << 6) | (((code >> 4) & 0x07) << 3) | (code & 0x07));
+	uint32_t remainder = 0;
+
+	// Systematic encoding, the data polynomial is sent lowest degree first
+	for (int bit = 0; bit < 12; bit++)
+	{
+		bool feedback = (((data >> bit) & 1) ^ (remainder & 1));
+
+		remainder >>= 1;
+		if (feedback)
+		{
+			remainder ^= (0xC75 >> 1);
+		}
+	}
+
+	return ((remainder << 12) | data);
+}
+
+// Two codes are the same bit stream when one codeword is a rotation of the other (e.g. 345 and 532), a receiver
+// can't tell them apart
+static bool dcsSameStream(uint16_t code1, uint16_t code2)
+{
+	uint32_t codeword1 = dcsCodeword(code1);
+	uint32_t codeword2 = dcsCodeword(code2);
+
+	for (int r = 0; r < 23; r++)
+	{
+		if ((((codeword1 >> r) | (codeword1 << (23 - r))) & 0x7FFFFF) == codeword2)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// The detected tone has the flags, and its code sends the same bit stream as the expected code
+static bool dcsDetected(uint16_t tone, uint16_t code, uint16_t flags)
+{
+	return ((tone != CODEPLUG_CSS_TONE_NONE) && ((tone & (CSS_TYPE_DCS | CSS_TYPE_DCS_INVERTED)) == flags) &&
+			dcsSameStream((tone & ~(CSS_TYPE_DCS | CSS_TYPE_DCS_INVERTED)), code));
+}
+
+static void signalReset(signal_t *signal)
+{
+	memset(signal, 0, sizeof(signal_t));
+	signal->ctcssAmplitude = TONE_AMPLITUDE;
+	signal->dcsBitRate = DCS_BIT_RATE;
+}
+
+static void feedSignal(signal_t *signal, uint32_t ms)
+{
+	int16_t samples[CSS_DETECTOR_SAMPLE_RATE / 1000];
+
+	while (ms-- > 0)
+	{
+		for (uint32_t i = 0; i < (CSS_DETECTOR_SAMPLE_RATE / 1000); i++, signal->sample++)
+		{
+			double t = ((double)signal->sample / CSS_DETECTOR_SAMPLE_RATE);
+			double sample = 0.0;
+
+			if (signal->ctcss > 0.0)
+			{
+				sample += (signal->ctcssAmplitude * sin(2.0 * M_PI * signal->ctcss * t));
+			}
+
+			if (signal->dcsWord != 0)
+			{
+				uint32_t bit = ((uint32_t)(t * signal->dcsBitRate) % 23U); // codeword sent continuously, LSB first
+				bool level = (((signal->dcsWord >> bit) & 1) != signal->dcsInverted);
+
+				sample += (level ? TONE_AMPLITUDE : -TONE_AMPLITUDE);
+			}
+
+			if (signal->voice > 0.0)
+			{
+				sample += (VOICE_AMPLITUDE * sin(2.0 * M_PI * signal->voice * t));
+			}
+
+			if (signal->noise > 0.0)
+			{
+				sample += (signal->noise * (((double)(testRandom(&noiseSeed) & 0xFFFF) / 32768.0) - 1.0));
+			}
+
+			samples[i] = (int16_t)lround(sample);
+		}
+
+		cssDetectorProcessSamples(samples, (CSS_DETECTOR_SAMPLE_RATE / 1000), 1);
+	}
+}
+
+// Runs the detector over the signal, returns the detected tone or CODEPLUG_CSS_TONE_NONE
+static uint16_t detect(signal_t *signal, CodeplugCSSTypes_t types, uint32_t ms)
+{
+	uint16_t tone;
+
+	cssDetectorStart(types);
+	feedSignal(signal, ms);
+
+	return (cssDetectorGetTone(&tone) ? tone : CODEPLUG_CSS_TONE_NONE);
+}
+
+static void testDcsCodewords(void)
+{
+	// Published codeword of 023, the encoder of the detector is only reachable through detection
+	TEST_CHECK(dcsCodeword(0x023) == 0x763813);
+
+	for (uint32_t i = 0; i < TRX_NUM_DCS; i++)
+	{
+		uint32_t codeword = dcsCodeword(TRX_DCSCodes[i]);
+
+		TEST_CHECK((codeword >> 23) == 0);
+		TEST_CHECK((codeword & 0xE00) == 0x800);
+	}
+}
+
+static void testAllCtcssTones(void)
+{
+	signal_t signal;
+
+	cssDetectorInit();
+
+	for (uint32_t i = 0; i < TRX_NUM_CTCSS; i++)
+	{
+		signalReset(&signal);
+		signal.ctcss = (TRX_CTCSSTones[i] / 10.0);
+		TEST_CHECK(detect(&signal, CSS_TYPE_NONE, DETECTION_TIME) == TRX_CTCSSTones[i]);
+		TEST_CHECK(detect(&signal, CSS_TYPE_CTCSS, DETECTION_TIME) == TRX_CTCSSTones[i]);
+
+		// With voice and noise, the tone is still there
+		signal.voice = 1000.0;
+		signal.noise = 1000.0;
+		TEST_CHECK(detect(&signal, CSS_TYPE_CTCSS, DETECTION_TIME) == TRX_CTCSSTones[i]);
+	}
+
+	// Not searched
+	signalReset(&signal);
+	signal.ctcss = 88.5;
+	TEST_CHECK(detect(&signal, CSS_TYPE_DCS, DETECTION_TIME) == CODEPLUG_CSS_TONE_NONE);
+}
+
+// Transmitters are not exactly on frequency, and the closest tones are only 2.3Hz apart: the adjacent tones are
+// only told apart by the strongest filter, which still has to be the nominal one up to 1Hz off
+static void testOffFrequencyCtcssTones(void)
+{
+	const double offsets[] = { -1.0, -0.5, 0.5, 1.0 };
+	signal_t signal;
+
+	cssDetectorInit();
+
+	for (uint32_t i = 0; i < TRX_NUM_CTCSS; i++)
+	{
+		for (uint32_t o = 0; o < (sizeof(offsets) / sizeof(offsets[0])); o++)
+		{
+			signalReset(&signal);
+			signal.ctcss = ((TRX_CTCSSTones[i] / 10.0) + offsets[o]);
+			TEST_CHECK(detect(&signal, CSS_TYPE_CTCSS, DETECTION_TIME) == TRX_CTCSSTones[i]);
+
+			signal.voice = 1000.0;
+			signal.noise = 1000.0;
+			TEST_CHECK(detect(&signal, CSS_TYPE_CTCSS, DETECTION_TIME) == TRX_CTCSSTones[i]);
+		}
+	}
+}
+
+static void testAllDcsCodes(void)
+{
+	signal_t signal;
+
+	cssDetectorInit();
+
+	for (uint32_t i = 0; i < TRX_NUM_DCS; i++)
+	{
+		signalReset(&signal);
+		signal.dcsWord = dcsCodeword(TRX_DCSCodes[i]);
+		TEST_CHECK(dcsDetected(detect(&signal, CSS_TYPE_DCS, DETECTION_TIME), TRX_DCSCodes[i], CSS_TYPE_DCS));
+
+		signal.dcsInverted = true;
+		TEST_CHECK(dcsDetected(detect(&signal, (CSS_TYPE_DCS | CSS_TYPE_DCS_INVERTED), DETECTION_TIME), TRX_DCSCodes[i], (CSS_TYPE_DCS | CSS_TYPE_DCS_INVERTED)));
+
+		// Inverted codes only searched: a normal one isn't reported
+		signal.dcsInverted = false;
+		signal.voice = 1000.0;
+		uint16_t tone = detect(&signal, (CSS_TYPE_DCS | CSS_TYPE_DCS_INVERTED), DETECTION_TIME);
+		TEST_CHECK((tone == CODEPLUG_CSS_TONE_NONE) || (tone & CSS_TYPE_DCS_INVERTED));
+		TEST_CHECK(tone != (TRX_DCSCodes[i] | CSS_TYPE_DCS | CSS_TYPE_DCS_INVERTED));
+	}
+
+	// Only the aliases of the table, both are reported as the same code
+	TEST_CHECK(dcsSameStream(0x345, 0x532));
+	TEST_CHECK(dcsSameStream(0x023, 0x025) == false);
+
+	// Normal polarity, searching everything, with voice and a slightly off bit rate
+	signalReset(&signal);
+	signal.dcsWord = dcsCodeword(0x411);
+	signal.voice = 1200.0;
+	signal.dcsBitRate = (DCS_BIT_RATE * 0.995);
+	TEST_CHECK(detect(&signal, CSS_TYPE_NONE, DETECTION_TIME) == (0x411 | CSS_TYPE_DCS));
+
+	// 047I is a rotation of 023N, the normal polarity wins when both are searched
+	signalReset(&signal);
+	signal.dcsWord = dcsCodeword(0x047);
+	signal.dcsInverted = true;
+	TEST_CHECK(detect(&signal, CSS_TYPE_NONE, DETECTION_TIME) == (0x023 | CSS_TYPE_DCS));
+	TEST_CHECK(detect(&signal, (CSS_TYPE_DCS | CSS_TYPE_DCS_INVERTED), DETECTION_TIME) == (0x047 | CSS_TYPE_DCS | CSS_TYPE_DCS_INVERTED));
+
+	// Not searched
+	TEST_CHECK(detect(&signal, CSS_TYPE_CTCSS, DETECTION_TIME) == CODEPLUG_CSS_TONE_NONE);
+}
+
+static void testRejection(void)
+{
+	signal_t signal;
+
+	cssDetectorInit();
+
+	// Silence
+	signalReset(&signal);
+	TEST_CHECK(detect(&signal, CSS_TYPE_NONE, 2000) == CODEPLUG_CSS_TONE_NONE);
+
+	// Noise alone
+	signal.noise = 8000.0;
+	TEST_CHECK(detect(&signal, CSS_TYPE_NONE, 2000) == CODEPLUG_CSS_TONE_NONE);
+
+	// A tone buried in noise (-28dB SNR, at -22dB it is already found in some windows)
+	signalReset(&signal);
+	signal.ctcss = 123.0;
+	signal.ctcssAmplitude = (TONE_AMPLITUDE / 2.0);
+	signal.noise = 30000.0;
+	TEST_CHECK(detect(&signal, CSS_TYPE_CTCSS, 2000) == CODEPLUG_CSS_TONE_NONE);
+
+	// Whistles over the voice band, none may alias in the CTCSS band after the decimation (800Hz did with a 2nd order CIC)
+	for (uint32_t frequency = 300; frequency <= 3400; frequency += 50)
+	{
+		signalReset(&signal);
+		signal.voice = frequency;
+		TEST_CHECK(detect(&signal, CSS_TYPE_NONE, 1000) == CODEPLUG_CSS_TONE_NONE);
+	}
+
+	// A CTCSS tone is never decoded as a DCS code
+	for (uint32_t i = 0; i < TRX_NUM_CTCSS; i += 7)
+	{
+		signalReset(&signal);
+		signal.ctcss = (TRX_CTCSSTones[i] / 10.0);
+		TEST_CHECK(detect(&signal, (CSS_TYPE_DCS | CSS_TYPE_DCS_INVERTED), 2000) == CODEPLUG_CSS_TONE_NONE);
+		TEST_CHECK(detect(&signal, CSS_TYPE_DCS, 2000) == CODEPLUG_CSS_TONE_NONE);
+	}
+
+	// Stopped: nothing reported, nor processed
+	signalReset(&signal);
+	signal.ctcss = 100.0;
+	cssDetectorStart(CSS_TYPE_CTCSS);
+	cssDetectorStop();
+	feedSignal(&signal, DETECTION_TIME);
+	cssDetectorStart(CSS_TYPE_CTCSS);
+	uint16_t tone;
+	TEST_CHECK(cssDetectorGetTone(&tone) == false);
+}
+
+static void testDetectedToneFollowsTheSignal(void)
+{
+	signal_t signal;
+	uint16_t tone;
+
+	cssDetectorInit();
+	soundMonitorStarts = 0;
+
+	signalReset(&signal);
+	signal.ctcss = 67.0;
+	TEST_CHECK(detect(&signal, CSS_TYPE_NONE, DETECTION_TIME) == 670);
+	TEST_CHECK(soundMonitorStarts == 1);
+
+	// The tone changes without restarting the detector
+	signal.ctcss = 250.3;
+	feedSignal(&signal, DETECTION_TIME);
+	TEST_CHECK(cssDetectorGetTone(&tone) && (tone == 2503));
+
+	// A DCS code replaces it, and stays once confirmed, even if the spectrum looks like a tone
+	signal.ctcss = 0.0;
+	signal.dcsWord = dcsCodeword(0x265);
+	feedSignal(&signal, DETECTION_TIME);
+	TEST_CHECK(cssDetectorGetTone(&tone) && (tone == (0x265 | CSS_TYPE_DCS)));
+
+	cssDetectorTick();
+	TEST_CHECK(soundMonitorStarts == 2);
+}
+
+static void benchmarkDetection(void)
+{
+	uint32_t samplesCount = (BENCHMARK_SECONDS * CSS_DETECTOR_SAMPLE_RATE);
+	int16_t *samples = malloc(samplesCount * sizeof(int16_t));
+	uint32_t codeword = dcsCodeword(0x134);
+	uint16_t tone;
+
+	TEST_CHECK(samples != NULL);
+
+	for (uint32_t i = 0; i < samplesCount; i++)
+	{
+		double t = ((double)i / CSS_DETECTOR_SAMPLE_RATE);
+		uint32_t bit = ((uint32_t)(t * DCS_BIT_RATE) % 23U);
+
+		samples[i] = (int16_t)lround((VOICE_AMPLITUDE * sin(2.0 * M_PI * 700.0 * t)) + ((((codeword >> bit) & 1) ? TONE_AMPLITUDE : -TONE_AMPLITUDE)));
+	}
+
+	cssDetectorInit();
+	cssDetectorStart(CSS_TYPE_NONE);
+
+	uint64_t start = testGetNanoseconds();
+	cssDetectorProcessSamples(samples, samplesCount, 1);
+	uint64_t elapsed = (testGetNanoseconds() - start);
+
+	TEST_CHECK(cssDetectorGetTone(&tone) && (tone == (0x134 | CSS_TYPE_DCS)));
+	printf("benchmark: %u s of audio, all CTCSS tones and DCS codes searched, %.2f ms, %.1f ns per sample\n",
+			BENCHMARK_SECONDS, ((double)elapsed / 1e6), ((double)elapsed / samplesCount));
+
+	free(samples);
+}
+
+int main(void)
+{
+	TEST_RUN(testDcsCodewords);
+	TEST_RUN(testAllCtcssTones);
+	TEST_RUN(testOffFrequencyCtcssTones);
+	TEST_RUN(testAllDcsCodes);
+	TEST_RUN(testRejection);
+	TEST_RUN(testDetectedToneFollowsTheSignal);
+	TEST_RUN(benchmarkDetection);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,354 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+//
+// The dirty tracking of ST7567_display.c: the drawing functions record the changed columns of each row, and the
+// render sends them, trimmed and split against the panel copy, to a simulated panel (st7567Sim.c).
+//
+// Counts the bytes (data and addressing commands) sent by typical screen updates, checks what forces a full resend,
+// then runs a fuzz of random primitives and partial renders (built with ASan/UBSan when available), the panel having
+// to show the screen buffer after every render.
+//
+#include <string.h>
+#include "testUtils.h"
+#include "main.h"
+#include "hardware/ST7567.h"
+#include "st7567Sim.h"
+
+#define FUZZ_STEPS      20000U
+#define SPAN_COMMANDS       3U // page and column addresses
+#define FULL_SCREEN_BYTES  (DISPLAY_NUMBER_OF_ROWS * (SPAN_COMMANDS + DISPLAY_SIZE_X))
+
+typedef struct
+{
+	const char *header;
+	const char *channel;
+	const char *frequency;
+	int16_t     rssi; // bar width
+	bool        popup;
+} screenState_t;
+
+static const uint8_t *screen(void)
+{
+	return displayGetPrimaryScreenBuffer();
+}
+
+// Renders all the rows and lets the transfer complete, returns the bytes sent
+static uint32_t render(void)
+{
+	uint32_t bytes = panelBytes();
+
+	displayRender();
+	displayWaitForTransferComplete();
+	TEST_CHECK(panel.dmaPending == false);
+
+	return (panelBytes() - bytes);
+}
+
+static void checkPanelShowsScreen(void)
+{
+	for (int16_t row = 0; row < DISPLAY_NUMBER_OF_ROWS; row++)
+	{
+		TEST_CHECK(panelRowMatches(row, screen()));
+	}
+}
+
+// Clears and redraws everything, as most screens do
+static void drawScreen(const screenState_t *state)
+{
+	displayClearBuf();
+	displayPrintCore(0, 2, state->header, FONT_SIZE_1, TEXT_ALIGN_LEFT, false);
+	displayDrawFastHLine(0, 11, DISPLAY_SIZE_X, true);
+	displayPrintCentered(16, state->channel, FONT_SIZE_3);
+	displayPrintCentered(34, state->frequency, FONT_SIZE_1);
+	displayFillRect(0, 44, state->rssi, 4, false);
+
+	if (state->popup)
+	{
+		displayFillRoundRect(16, 20, 96, 28, 3, false);
+		displayPrintCentered(28, "Saved", FONT_SIZE_3);
+	}
+}
+
+// Only the header rows, as the header refresh does
+static void drawHeader(const screenState_t *state)
+{
+	displayClearRows(0, 2, false);
+	displayPrintCore(0, 2, state->header, FONT_SIZE_1, TEXT_ALIGN_LEFT, false);
+	displayDrawFastHLine(0, 11, DISPLAY_SIZE_X, true);
+}
+
+static void testScreenUpdates(void)
+{
+	screenState_t state = { .header = "DMR  TS1 CC1  12.6V", .channel = "Repeater 1", .frequency = "439.1250 MHz", .rssi = 40, .popup = false };
+	uint32_t bytes;
+
+	panelReset();
+	displayBegin(false);
+	displayWaitForTransferComplete();
+	TEST_CHECK(panel.resets == 1);
+	TEST_CHECK(panel.displayOn && (panel.inverse == false));
+	TEST_CHECK(panel.contrast == 0x12);
+	TEST_CHECK(panelBytes() == (9 + FULL_SCREEN_BYTES)); // 9 setup commands, then the blank screen
+	printf("  display begin: %u bytes\n", panelBytes());
+
+	drawScreen(&state);
+	bytes = render();
+	checkPanelShowsScreen();
+	printf("  first screen: %u bytes\n", bytes);
+
+	drawScreen(&state);
+	TEST_CHECK(render() == 0);
+
+	for (uint32_t i = 0; i < 10; i++)
+	{
+		drawHeader(&state);
+		TEST_CHECK(render() == 0);
+	}
+
+	state.channel = "Repeater 2";
+	drawScreen(&state);
+	bytes = render();
+	checkPanelShowsScreen();
+	TEST_CHECK(bytes <= (2 * (SPAN_COMMANDS + 8))); // one 8x16 character
+	printf("  one character changed: %u bytes\n", bytes);
+
+	state.rssi = 46;
+	drawScreen(&state);
+	bytes = render();
+	checkPanelShowsScreen();
+	TEST_CHECK(bytes == (SPAN_COMMANDS + 6));
+	printf("  RSSI bar grows: %u bytes\n", bytes);
+
+	state.frequency = "145.6125 MHz";
+	drawScreen(&state);
+	bytes = render();
+	checkPanelShowsScreen();
+	printf("  frequency changed: %u bytes\n", bytes);
+
+	state.popup = true;
+	drawScreen(&state);
+	bytes = render();
+	checkPanelShowsScreen();
+	printf("  popup shown: %u bytes\n", bytes);
+
+	state.popup = false;
+	drawScreen(&state);
+	TEST_CHECK(render() == bytes);
+	checkPanelShowsScreen();
+}
+
+// Unchanged runs shorter than DISPLAY_SPAN_MIN_GAP are sent, longer ones split the span
+static void testSpanSplit(void)
+{
+	displayClearBuf();
+	render();
+
+	displaySetPixel(10, 20, true);
+	displaySetPixel((10 + DISPLAY_SPAN_MIN_GAP), 20, true); // DISPLAY_SPAN_MIN_GAP - 1 unchanged between
+	TEST_CHECK(render() == (SPAN_COMMANDS + DISPLAY_SPAN_MIN_GAP + 1));
+
+	displaySetPixel(10, 20, false);
+	displaySetPixel((10 + DISPLAY_SPAN_MIN_GAP + 1), 20, true); // DISPLAY_SPAN_MIN_GAP unchanged between
+	TEST_CHECK(render() == (2 * (SPAN_COMMANDS + 1)));
+
+	// The first and last columns
+	displaySetPixel(0, 63, true);
+	displaySetPixel((DISPLAY_SIZE_X - 1), 63, true);
+	TEST_CHECK(render() == (2 * (SPAN_COMMANDS + 1)));
+	checkPanelShowsScreen();
+
+	// Changed back before the render
+	displaySetPixel(64, 0, true);
+	displaySetPixel(64, 0, false);
+	TEST_CHECK(render() == 0);
+}
+
+// What makes the panel content unknown, or the screen buffer replaced
+static void testFullResend(void)
+{
+	static uint8_t otherBuffer[(DISPLAY_SIZE_X * DISPLAY_SIZE_Y) >> 3];
+
+	displayClearBuf();
+	displayPrintCentered(24, "Full resend", FONT_SIZE_3);
+	render();
+
+	// Woken up: everything
+	displaySetDisplayPowerMode(false);
+	TEST_CHECK(panel.displayOn == false);
+	memset(panel.ram, 0xA5, sizeof(panel.ram)); // what the panel shows isn't known any more
+	displaySetDisplayPowerMode(true);
+	TEST_CHECK(panel.displayOn);
+	TEST_CHECK(render() == FULL_SCREEN_BYTES);
+	checkPanelShowsScreen();
+
+	// Marked all dirty without change: nothing
+	displayMarkAllDirty();
+	TEST_CHECK(render() == 0);
+
+	// Another buffer with the same content: nothing, then its changes
+	memcpy(otherBuffer, screen(), sizeof(otherBuffer));
+	displayOverrideScreenBuffer(otherBuffer);
+	TEST_CHECK(render() == 0);
+	displaySetPixel(5, 5, true);
+	TEST_CHECK(render() == (SPAN_COMMANDS + 1));
+	TEST_CHECK(memcmp(&panel.ram[0][DISPLAY_COLUMN_OFFSET], otherBuffer, DISPLAY_SIZE_X) == 0);
+	displayRestorePrimaryScreenBuffer();
+	TEST_CHECK(render() == (SPAN_COMMANDS + 1)); // the pixel is gone
+	checkPanelShowsScreen();
+
+	// A direct write of the buffer is only sent once marked
+	displayGetScreenBuffer()[300] ^= 0xFF;
+	TEST_CHECK(render() == 0);
+	displayMarkAllDirty();
+	TEST_CHECK(render() == (SPAN_COMMANDS + 1));
+
+	// Partial renders leave the other rows dirty
+	displayClearBuf();
+	render();
+	displayClearRows(0, DISPLAY_NUMBER_OF_ROWS, true);
+	displayRenderRows(2, 4);
+	displayWaitForTransferComplete();
+	TEST_CHECK(panelRowMatches(2, screen()) && panelRowMatches(3, screen()));
+	TEST_CHECK(panelRowMatches(1, screen()) == false);
+	TEST_CHECK(render() == ((DISPLAY_NUMBER_OF_ROWS - 2) * (SPAN_COMMANDS + DISPLAY_SIZE_X)));
+	checkPanelShowsScreen();
+}
+
+static const uint8_t BITMAP[] = { 0xF0, 0x0F, 0x81, 0x18, 0x3C, 0xC3, 0x55, 0xAA };
+
+// Random primitives, some partly off the screen, then a render of a random range of rows
+static void testFuzz(void)
+{
+	static const char *TEXTS[] = { "A", "Hello", "12.5", "Zone 1", "!?#", "WWWWWWWWWWWWWWWWWWWWWWW" };
+	uint32_t seed = 0x53543735;
+	uint64_t bytes = 0;
+
+	displayClearBuf();
+	render();
+
+	for (uint32_t step = 0; step < FUZZ_STEPS; step++)
+	{
+		uint32_t primitives = (1 + (testRandom(&seed) % 4));
+
+		for (uint32_t p = 0; p < primitives; p++)
+		{
+			int16_t x = ((int16_t)(testRandom(&seed) % 160) - 16);
+			int16_t y = ((int16_t)(testRandom(&seed) % 96) - 16);
+			int16_t w = (int16_t)(testRandom(&seed) % 64);
+			int16_t h = (int16_t)(testRandom(&seed) % 40);
+			bool inverted = (testRandom(&seed) & 1);
+			// The displayFillRect() based primitives don't clip, their callers keep them on the screen
+			int16_t rx = CLAMP(x, 0, (DISPLAY_SIZE_X - 1));
+			int16_t ry = CLAMP(y, 0, (DISPLAY_SIZE_Y - 1));
+			int16_t rw = MAX(MIN(w, (DISPLAY_SIZE_X - rx)), 1);
+			int16_t rh = MAX(MIN(h, (DISPLAY_SIZE_Y - ry)), 1);
+			int16_t r = MIN(MIN(rx, (DISPLAY_SIZE_X - 1 - rx)), MIN(ry, (DISPLAY_SIZE_Y - 1 - ry)));
+
+			switch (testRandom(&seed) % 12)
+			{
+				case 0:
+					displaySetPixel(x, y, inverted);
+					break;
+				case 1:
+					displayDrawLine(x, y, (x + w), (y + h - 20), inverted);
+					break;
+				case 2:
+					displayFillRect(rx, ry, rw, rh, inverted);
+					break;
+				case 3:
+					displayPrintCore(rx, ry, TEXTS[w % 6], (ucFont_t)(h % 4), (ucTextAlign_t)(w % 3), inverted);
+					break;
+				case 4:
+					displayDrawCircle(x, y, (h / 2), inverted);
+					break;
+				case 5:
+					displayFillCircle(rx, ry, MIN((h / 2), r), inverted);
+					break;
+				case 6:
+					displayFillTriangle(rx, ry, (rx + rw - 1), MIN((ry + 5), (DISPLAY_SIZE_Y - 1)), MIN((rx + 10), (DISPLAY_SIZE_X - 1)), (ry + rh - 1), inverted);
+					break;
+				case 7:
+					if ((rw > 6) && (rh > 6))
+					{
+						displayDrawRoundRect(rx, ry, rw, rh, 3, inverted);
+					}
+					break;
+				case 8:
+					displayClearRows((int16_t)(testRandom(&seed) % 9), (int16_t)(testRandom(&seed) % 9), inverted);
+					break;
+				case 9:
+					displayDrawXBitmap(x, y, BITMAP, 16, 4, inverted);
+					break;
+				case 10:
+					// A direct write, marked
+					displayGetScreenBuffer()[testRandom(&seed) % ((DISPLAY_SIZE_X * DISPLAY_SIZE_Y) >> 3)] = (uint8_t)testRandom(&seed);
+					displayMarkAllDirty();
+					break;
+				case 11:
+					if ((testRandom(&seed) % 8) == 0)
+					{
+						displayClearBuf();
+					}
+					break;
+			}
+		}
+
+		uint32_t before = panelBytes();
+		int16_t startRow = (int16_t)(testRandom(&seed) % DISPLAY_NUMBER_OF_ROWS);
+		int16_t endRow = (int16_t)(startRow + 1 + (testRandom(&seed) % (DISPLAY_NUMBER_OF_ROWS - startRow)));
+
+		if ((testRandom(&seed) % 4) == 0)
+		{
+			startRow = 0;
+			endRow = DISPLAY_NUMBER_OF_ROWS;
+		}
+
+		displayRenderRows(startRow, endRow);
+		displayWaitForTransferComplete();
+
+		for (int16_t row = startRow; row < endRow; row++)
+		{
+			TEST_CHECK(panelRowMatches(row, screen()));
+		}
+		bytes += (panelBytes() - before);
+	}
+
+	// What was left dirty
+	render();
+	checkPanelShowsScreen();
+	printf("  %u steps, %.1f bytes per render\n", FUZZ_STEPS, ((double)bytes / FUZZ_STEPS));
+}
+
+int main(void)
+{
+	TEST_RUN(testScreenUpdates);
+	TEST_RUN(testSpanSplit);
+	TEST_RUN(testFullResend);
+	TEST_RUN(testFuzz);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,364 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+//
+// The non blocking render of ST7567_transfer.c, against the simulated panel (st7567Sim.c): the queued spans, sent
+// as their addressing commands then their data by DMA transfers chained from the completion interrupt, the screen
+// buffer being redrawn while they are sent, and the recovery from a DMA start failure, a SPI error or a transfer
+// which never completes (the panel copy is invalidated, so the next render resends everything).
+// Then a fuzz mixing all these (built with ASan/UBSan when available).
+//
+#include <string.h>
+#include "testUtils.h"
+#include "main.h"
+#include "hardware/ST7567.h"
+#include "interfaces/remoteHead.h"
+#include "st7567Sim.h"
+
+#define FUZZ_STEPS          20000U
+#define SPAN_COMMANDS           3U // page and column addresses
+#define FULL_SCREEN_BYTES  (DISPLAY_NUMBER_OF_ROWS * (SPAN_COMMANDS + DISPLAY_SIZE_X))
+#define TRANSFER_TIMEOUT       10U // ms, ST7567_TRANSFER_TIMEOUT
+
+static const uint8_t *screen(void)
+{
+	return displayGetPrimaryScreenBuffer();
+}
+
+static uint32_t render(void)
+{
+	uint32_t bytes = panelBytes();
+
+	displayRender();
+	displayWaitForTransferComplete();
+	TEST_CHECK(panel.dmaPending == false);
+
+	return (panelBytes() - bytes);
+}
+
+static bool panelShows(const uint8_t *buffer)
+{
+	for (int16_t row = 0; row < DISPLAY_NUMBER_OF_ROWS; row++)
+	{
+		if (panelRowMatches(row, buffer) == false)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void clearFaults(void)
+{
+	panel.failStart = 0;
+	panel.errorAt = 0;
+	panel.stuck = false;
+}
+
+// Blank screen on the panel, nothing pending
+static void start(void)
+{
+	clearFaults();
+	displayClearBuf();
+	displayInvalidatePanel();
+	render();
+	TEST_CHECK(panelShows(screen()));
+}
+
+// Each span is a 3 bytes commands transfer then its data transfer, the next one started from the completion
+static void testChaining(void)
+{
+	start();
+
+	displaySetPixel(10, 4, true);              // row 0
+	displayFillRect(40, 20, 20, 4, false);     // row 2
+	displayPrintAt(0, 56, "Spans", FONT_SIZE_1); // row 7
+
+	uint32_t starts = panel.dmaStarts;
+	uint32_t notifications = panel.notifications;
+
+	displayRender();
+	TEST_CHECK(panel.dmaPending);
+
+	// One transfer at a time, in the order of the queue
+	uint32_t completions = panelCompleteTransfers();
+	uint32_t spans = (completions / 2);
+
+	TEST_CHECK((completions % 2) == 0);
+	TEST_CHECK(spans == 3);
+	TEST_CHECK((panel.dmaStarts - starts) == completions);
+	for (uint32_t i = starts; i < panel.dmaStarts; i += 2)
+	{
+		TEST_CHECK((panel.dmaLog[i].dataMode == false) && (panel.dmaLog[i].length == SPAN_COMMANDS));
+		TEST_CHECK(panel.dmaLog[i + 1].dataMode);
+	}
+	TEST_CHECK(panel.dmaLog[starts + 1].length == 1);
+	TEST_CHECK(panel.dmaLog[starts + 3].length == 20);
+
+	// Only the task waiting is notified
+	TEST_CHECK(panel.notifications == notifications);
+	TEST_CHECK(panel.selected == false);
+	TEST_CHECK(panelShows(screen()));
+
+	// Already complete: no wait
+	uint32_t waits = panel.waits;
+
+	displayWaitForTransferComplete();
+	TEST_CHECK(panel.waits == waits);
+
+	// Waiting: notified once, at the end of the queue
+	displayFillRect(0, 0, 128, 64, false);
+	displayRender();
+	displayWaitForTransferComplete();
+	TEST_CHECK(panel.waits == (waits + 1));
+	TEST_CHECK(panel.notifications == 0); // taken
+	TEST_CHECK(panelShows(screen()));
+}
+
+// The spans are sent from the panel copy, the screen buffer can change during the transfer
+static void testRedrawWhileSending(void)
+{
+	static uint8_t rendered[(DISPLAY_SIZE_X * DISPLAY_SIZE_Y) >> 3];
+
+	start();
+
+	displayPrintCentered(16, "Before", FONT_SIZE_3);
+	displayRender();
+	memcpy(rendered, screen(), sizeof(rendered));
+
+	panelCompleteTransfer(); // first span commands only
+	displayClearBuf();
+	displayPrintCentered(16, "After", FONT_SIZE_3);
+	displayFillRect(0, 0, 128, 8, false);
+	panelCompleteTransfers();
+	TEST_CHECK(panelShows(rendered));
+
+	// Then only the changes
+	uint32_t bytes = render();
+
+	TEST_CHECK(bytes < FULL_SCREEN_BYTES);
+	TEST_CHECK(panelShows(screen()));
+}
+
+// A single command waits for the transfer to end, as the SPI2 bus is shared
+static void testCommandWhileSending(void)
+{
+	start();
+
+	displayFillRect(0, 0, 128, 64, false);
+	displayRender();
+	TEST_CHECK(panel.dmaPending);
+
+	displaySetContrast(0x20); // HAL_SPI_Transmit() checks nothing is pending
+	TEST_CHECK(panel.contrast == 0x20);
+	TEST_CHECK(panelShows(screen()));
+}
+
+// A failure anywhere in the queue: the transfer ends, and the next render sends the full screen
+static void testFailures(void)
+{
+	for (uint32_t failure = 0; failure < 5; failure++)
+	{
+		uint32_t aborts;
+
+		start();
+		displayPrintCentered(24, "Failure", FONT_SIZE_3);
+		aborts = panel.aborts;
+
+		switch (failure)
+		{
+			case 0: // first start, from the task
+				panel.failStart = (panel.dmaStarts + 1);
+				break;
+			case 1: // first data start, from the interrupt
+				panel.failStart = (panel.dmaStarts + 2);
+				break;
+			case 2: // second span start, from the interrupt
+				panel.failStart = (panel.dmaStarts + 3);
+				break;
+			case 3: // SPI error
+				panel.errorAt = (panel.dmaCompletions + 2);
+				break;
+			case 4: // never completes
+				panel.stuck = true;
+				break;
+		}
+
+		uint32_t ticks = panel.ticks;
+
+		displayRender();
+		displayWaitForTransferComplete();
+		TEST_CHECK(panel.dmaPending == false);
+		TEST_CHECK(panel.selected == false);
+		TEST_CHECK(panel.aborts == (aborts + (((failure == 0) || (failure == 4)) ? 1 : 0)));
+		TEST_CHECK((panel.ticks - ticks) == ((failure == 4) ? TRANSFER_TIMEOUT : 0));
+		TEST_CHECK(panelShows(screen()) == false);
+
+		clearFaults();
+		TEST_CHECK(render() == FULL_SCREEN_BYTES);
+		TEST_CHECK(panelShows(screen()));
+		TEST_CHECK(render() == 0);
+	}
+
+	// A failure during a single command wait is handled the same way
+	start();
+	displayFillRect(0, 0, 128, 64, false);
+	panel.stuck = true;
+	displayRender();
+	displaySetContrast(0x30);
+	TEST_CHECK(panel.contrast == 0x30);
+	clearFaults();
+	TEST_CHECK(render() == FULL_SCREEN_BYTES);
+}
+
+// The remote head renders on its own, switching back to the panel resends everything
+static void testRemoteHead(void)
+{
+	start();
+
+	remoteHeadActive = true;
+	displayPrintCentered(24, "Remote", FONT_SIZE_3);
+	TEST_CHECK(render() == 0);
+	TEST_CHECK(panel.remoteRenders == 1);
+	displaySetContrast(0x12);
+	TEST_CHECK(panel.remoteCommands == 2);
+
+	remoteHeadActive = false;
+	TEST_CHECK(render() == FULL_SCREEN_BYTES);
+	TEST_CHECK(panelShows(screen()));
+	TEST_CHECK(panel.remoteRenders == 1);
+}
+
+// Random drawing, renders, partial transfers, redraws while sending, and failures. Whatever happened, a render
+// without failure brings the panel in sync.
+static void testFuzz(void)
+{
+	static uint8_t rendered[(DISPLAY_SIZE_X * DISPLAY_SIZE_Y) >> 3];
+	uint32_t seed = 0x444D4131;
+	uint32_t failures = 0;
+	uint32_t fullResends = 0;
+
+	start();
+
+	for (uint32_t step = 0; step < FUZZ_STEPS; step++)
+	{
+		uint32_t fault = (testRandom(&seed) % 16);
+		uint32_t aborts = panel.aborts;
+
+		for (uint32_t p = (testRandom(&seed) % 4); p > 0; p--)
+		{
+			int16_t x = (int16_t)(testRandom(&seed) % DISPLAY_SIZE_X);
+			int16_t y = (int16_t)(testRandom(&seed) % DISPLAY_SIZE_Y);
+			int16_t w = (int16_t)(testRandom(&seed) % 48);
+			int16_t h = (int16_t)(testRandom(&seed) % 24);
+
+			if (testRandom(&seed) & 1)
+			{
+				displayFillRect(x, y, MIN(w, (DISPLAY_SIZE_X - x)), MIN(h, (DISPLAY_SIZE_Y - y)), (testRandom(&seed) & 1));
+			}
+			else
+			{
+				displayPrintAt(x, MIN(y, (DISPLAY_SIZE_Y - 8)), "Fuzz", FONT_SIZE_1);
+			}
+		}
+
+		switch (fault)
+		{
+			case 0:
+				panel.failStart = (panel.dmaStarts + 1 + (testRandom(&seed) % 8));
+				break;
+			case 1:
+				panel.errorAt = (panel.dmaCompletions + 1 + (testRandom(&seed) % 8));
+				break;
+			case 2:
+				panel.stuck = true;
+				break;
+		}
+
+		uint32_t starts = panel.dmaStarts;
+		uint32_t completions = panel.dmaCompletions;
+
+		displayRender();
+		memcpy(rendered, screen(), sizeof(rendered));
+
+		// Part of the queue sent, then more drawing during the rest
+		for (uint32_t i = (testRandom(&seed) % 6); i > 0; i--)
+		{
+			panelCompleteTransfer();
+		}
+		if (testRandom(&seed) & 1)
+		{
+			displayFillRect((int16_t)(testRandom(&seed) % 120), 0, 8, 8, (testRandom(&seed) & 1));
+		}
+		displayWaitForTransferComplete();
+		TEST_CHECK(panel.dmaPending == false);
+		TEST_CHECK(panel.selected == false);
+
+		bool failed = ((panel.aborts != aborts) ||
+				((panel.failStart != 0) && (panel.failStart > starts) && (panel.failStart <= panel.dmaStarts)) ||
+				((panel.errorAt != 0) && (panel.errorAt > completions) && (panel.errorAt <= panel.dmaCompletions)));
+
+		if (failed)
+		{
+			failures++;
+		}
+		else
+		{
+			TEST_CHECK(panelShows(rendered));
+		}
+
+		clearFaults();
+		if (((testRandom(&seed) % 4) == 0) || failed)
+		{
+			uint32_t bytes = render();
+
+			TEST_CHECK(panelShows(screen()));
+			if (bytes == FULL_SCREEN_BYTES)
+			{
+				fullResends++;
+			}
+			TEST_CHECK((failed == false) || (bytes == FULL_SCREEN_BYTES));
+		}
+	}
+
+	printf("  %u steps, %u failed transfers, %u full resends\n", FUZZ_STEPS, failures, fullResends);
+}
+
+int main(void)
+{
+	panelReset();
+	displayBegin(false);
+
+	TEST_RUN(testChaining);
+	TEST_RUN(testRedrawWhileSending);
+	TEST_RUN(testCommandWhileSending);
+	TEST_RUN(testFailures);
+	TEST_RUN(testRemoteHead);
+	TEST_RUN(testFuzz);
+
+	return EXIT_SUCCESS;
+}
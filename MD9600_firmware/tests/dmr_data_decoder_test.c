@@ -0,0 +1,717 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+//
+// dmrDataDecoder.c against bursts built by an encoder written from ETSI TS 102 361-1 Annex B: BPTC(196,96) and
+// rate 3/4 trellis round trips, with bit and symbol errors, then whole data messages (UDT text and location,
+// unconfirmed IP/UDP text over rate 1/2 blocks, confirmed rate 3/4 blocks) and their rejection cases, then the
+// benchmark of both burst decoders.
+//
+#include <string.h>
+#include <math.h>
+#include "testUtils.h"
+#include "functions/dmrDataDecoder.h"
+
+#define INFO_BITS                  196U
+#define SLOT_TYPE_FILL             0xA5 // the slot type bits between both info halves must be skipped
+#define BENCHMARK_BURSTS        100000U
+
+static uint32_t mockMillis;
+static uint32_t locationId;
+static double locationLatitude;
+static double locationLongitude;
+static uint32_t seed = 0x0BADCAFEU;
+
+uint32_t ticksGetMillis(void)
+{
+	return mockMillis;
+}
+
+bool lastHeardUpdateLocation(uint32_t id, double latitude, double longitude)
+{
+	locationId = id;
+	locationLatitude = latitude;
+	locationLongitude = longitude;
+
+	return true;
+}
+
+static void setBit(uint8_t *data, uint32_t index, uint8_t bit)
+{
+	data[index >> 3] = ((data[index >> 3] & ~(0x80 >> (index & 0x07))) | ((bit & 0x01) << (7 - (index & 0x07))));
+}
+
+static uint8_t getBit(const uint8_t *data, uint32_t index)
+{
+	return ((data[index >> 3] >> (7 - (index & 0x07))) & 0x01);
+}
+
+// Info bit to burst bit, the 20 slot type bits sit in the middle
+static uint32_t burstBitIndex(uint32_t infoBit)
+{
+	return ((infoBit < 98) ? infoBit : (infoBit + 20));
+}
+
+static void burstInit(uint8_t *burst)
+{
+	memset(burst, SLOT_TYPE_FILL, DMR_DATA_DECODER_BURST_LENGTH);
+}
+
+// BPTC(196,96): 96 data bits in 9 rows of 15 bits (after a reserved bit, the first row has 3 more reserved bits),
+// rows are Hamming(15,11,3) codewords and the 15 columns Hamming(13,9,3) codewords, interleaved by 181 steps
+static void encodeBPTC(const uint8_t *payload, uint8_t *burst)
+{
+	uint8_t matrix[INFO_BITS] = { 0 };
+	uint32_t bitIndex = 0;
+
+	for (int row = 0; row < 9; row++)
+	{
+		uint8_t *d = &matrix[1 + (row * 15)];
+
+		for (int col = ((row == 0) ? 3 : 0); col < 11; col++)
+		{
+			d[col] = getBit(payload, bitIndex++);
+		}
+
+		d[11] = (d[0] ^ d[1] ^ d[2] ^ d[3] ^ d[5] ^ d[7] ^ d[8]);
+		d[12] = (d[1] ^ d[2] ^ d[3] ^ d[4] ^ d[6] ^ d[8] ^ d[9]);
+		d[13] = (d[2] ^ d[3] ^ d[4] ^ d[5] ^ d[7] ^ d[9] ^ d[10]);
+		d[14] = (d[0] ^ d[1] ^ d[2] ^ d[4] ^ d[6] ^ d[7] ^ d[10]);
+	}
+
+	for (int col = 0; col < 15; col++)
+	{
+		uint8_t d[13];
+
+		for (int row = 0; row < 9; row++)
+		{
+			d[row] = matrix[1 + col + (row * 15)];
+		}
+
+		d[9] = (d[0] ^ d[1] ^ d[3] ^ d[5] ^ d[6]);
+		d[10] = (d[0] ^ d[1] ^ d[2] ^ d[4] ^ d[6] ^ d[7]);
+		d[11] = (d[0] ^ d[1] ^ d[2] ^ d[3] ^ d[5] ^ d[7] ^ d[8]);
+		d[12] = (d[0] ^ d[2] ^ d[4] ^ d[5] ^ d[8]);
+
+		for (int row = 9; row < 13; row++)
+		{
+			matrix[1 + col + (row * 15)] = d[row];
+		}
+	}
+
+	burstInit(burst);
+	for (uint32_t i = 0; i < INFO_BITS; i++)
+	{
+		setBit(burst, burstBitIndex((i * 181) % INFO_BITS), matrix[i]);
+	}
+}
+
+// Symbol sent as each dibit of the burst: 0, 1, 8, 9 ... 96, 97, then 2, 3, 10, 11 ... and so on
+static void trellisInterleave(uint8_t *interleave)
+{
+	uint32_t n = 0;
+
+	for (uint32_t column = 0; column < 4; column++)
+	{
+		for (uint32_t k = 0; ((k * 8) + (column * 2) + 1) < 98; k++)
+		{
+			interleave[n++] = ((k * 8) + (column * 2));
+			interleave[n++] = ((k * 8) + (column * 2) + 1);
+		}
+	}
+}
+
+// Rate 3/4 trellis: 48 tribits and a null flushing one, each giving a constellation point from the previous tribit,
+// sent as 2 symbols, the 98 dibits being interleaved
+static void encodeTrellis(const uint8_t *payload, uint8_t *burst)
+{
+	static const uint8_t ENCODE[8][8] =
+	{
+			{  0,  8,  4, 12,  2, 10,  6, 14 },
+			{  4, 12,  2, 10,  6, 14,  0,  8 },
+			{  1,  9,  5, 13,  3, 11,  7, 15 },
+			{  5, 13,  3, 11,  7, 15,  1,  9 },
+			{  3, 11,  7, 15,  1,  9,  5, 13 },
+			{  7, 15,  1,  9,  5, 13,  3, 11 },
+			{  2, 10,  6, 14,  0,  8,  4, 12 },
+			{  6, 14,  0,  8,  4, 12,  2, 10 }
+	};
+	static const int8_t POINT_SYMBOLS[16][2] =
+	{
+			{ +1, -1 }, { -1, -1 }, { +3, -3 }, { -3, -3 }, { -3, -1 }, { +3, -1 }, { -1, -3 }, { +1, -3 },
+			{ -3, +3 }, { +3, +3 }, { -1, +1 }, { +1, +1 }, { +1, +3 }, { -1, +3 }, { +3, +1 }, { -3, +1 }
+	};
+	int8_t symbols[98];
+	uint8_t interleave[98];
+	uint8_t state = 0;
+
+	for (uint32_t i = 0; i < 49; i++)
+	{
+		uint8_t tribit = ((i < 48) ? ((getBit(payload, (i * 3)) << 2) | (getBit(payload, ((i * 3) + 1)) << 1) | getBit(payload, ((i * 3) + 2))) : 0);
+		uint8_t point = ENCODE[state][tribit];
+
+		symbols[i * 2] = POINT_SYMBOLS[point][0];
+		symbols[(i * 2) + 1] = POINT_SYMBOLS[point][1];
+		state = tribit;
+	}
+
+	trellisInterleave(interleave);
+
+	burstInit(burst);
+	for (uint32_t i = 0; i < 98; i++)
+	{
+		int8_t symbol = symbols[interleave[i]];
+		uint8_t dibit = ((symbol == 3) ? 0x01 : ((symbol == 1) ? 0x00 : ((symbol == -1) ? 0x02 : 0x03)));
+
+		setBit(burst, burstBitIndex(i * 2), (dibit >> 1));
+		setBit(burst, burstBitIndex((i * 2) + 1), dibit);
+	}
+}
+
+static uint16_t crcCCITT(const uint8_t *data, size_t length)
+{
+	uint16_t crc = 0;
+
+	for (size_t i = 0; i < (length * 8); i++)
+	{
+		crc = ((((crc >> 15) ^ getBit(data, i)) & 0x01) ? ((crc << 1) ^ 0x1021) : (crc << 1));
+	}
+
+	return ~crc;
+}
+
+static uint16_t crc9(const uint8_t *data, size_t length, uint8_t serialNumber, uint16_t mask)
+{
+	uint16_t crc = 0;
+
+	for (size_t i = 0; i < ((length * 8) + 7); i++)
+	{
+		uint8_t bit = ((i < (length * 8)) ? getBit(data, i) : ((serialNumber >> (6 - (i - (length * 8)))) & 0x01));
+
+		crc = (((((crc >> 8) ^ bit) & 0x01) ? ((crc << 1) ^ 0x059) : (crc << 1)) & 0x1FF);
+	}
+
+	return ((~crc & 0x1FF) ^ mask);
+}
+
+// The octets are processed by swapped pairs
+static uint32_t crc32(const uint8_t *data, size_t length)
+{
+	uint32_t crc = 0;
+
+	for (size_t i = 0; i < (length * 8); i++)
+	{
+		crc = ((((crc >> 31) ^ getBit(data, ((i ^ 0x08)))) & 0x01) ? ((crc << 1) ^ 0x04C11DB7) : (crc << 1));
+	}
+
+	return crc;
+}
+
+static void headerCRC(uint8_t *header)
+{
+	uint16_t crc = (crcCCITT(header, 10) ^ 0xCCCC);
+
+	header[10] = (crc >> 8);
+	header[11] = (crc & 0xFF);
+}
+
+static bool sendHeader(uint8_t *header)
+{
+	uint8_t burst[DMR_DATA_DECODER_BURST_LENGTH];
+
+	encodeBPTC(header, burst);
+
+	return dmrDataDecoderProcessBurst(DMR_DATA_TYPE_DATA_HEADER, burst);
+}
+
+static bool sendBlock(const uint8_t *block, bool isRate34)
+{
+	uint8_t burst[DMR_DATA_DECODER_BURST_LENGTH];
+
+	mockMillis += 60; // a block every other slot
+	if (isRate34)
+	{
+		encodeTrellis(block, burst);
+		return dmrDataDecoderProcessBurst(DMR_DATA_TYPE_RATE_34_DATA, burst);
+	}
+
+	encodeBPTC(block, burst);
+	return dmrDataDecoderProcessBurst(DMR_DATA_TYPE_RATE_12_DATA, burst);
+}
+
+// Flips the bit of the BPTC matrix (before interleaving)
+static void flipMatrixBit(uint8_t *burst, uint32_t index)
+{
+	uint32_t bit = burstBitIndex((index * 181) % INFO_BITS);
+
+	setBit(burst, bit, (getBit(burst, bit) ^ 0x01));
+}
+
+static void testBPTC(void)
+{
+	uint8_t payload[DMR_DATA_DECODER_BPTC_PAYLOAD_LENGTH];
+	uint8_t decoded[DMR_DATA_DECODER_BPTC_PAYLOAD_LENGTH];
+	uint8_t burst[DMR_DATA_DECODER_BURST_LENGTH];
+	uint8_t corrupted[DMR_DATA_DECODER_BURST_LENGTH];
+
+	for (uint32_t n = 0; n < 200; n++)
+	{
+		for (uint32_t i = 0; i < sizeof(payload); i++)
+		{
+			payload[i] = testRandom(&seed);
+		}
+
+		encodeBPTC(payload, burst);
+		TEST_CHECK(dmrDataDecoderBPTCDecode(burst, decoded));
+		TEST_CHECK(memcmp(decoded, payload, sizeof(payload)) == 0);
+
+		// Every single bit error, and random double errors, are corrected. Except 2 errors in the parity rows of
+		// the same column, which no pass can locate, these bursts are rejected (the payload isn't affected).
+		for (uint32_t bit = 0; bit < INFO_BITS; bit++)
+		{
+			memcpy(corrupted, burst, sizeof(burst));
+			flipMatrixBit(corrupted, bit);
+			TEST_CHECK(dmrDataDecoderBPTCDecode(corrupted, decoded));
+			TEST_CHECK(memcmp(decoded, payload, sizeof(payload)) == 0);
+
+			uint32_t other = ((bit + 1 + (testRandom(&seed) % (INFO_BITS - 1))) % INFO_BITS);
+			bool sameColumnParity = ((bit > 135) && (other > 135) && (((bit - 1) % 15) == ((other - 1) % 15)));
+
+			flipMatrixBit(corrupted, other);
+			TEST_CHECK(dmrDataDecoderBPTCDecode(corrupted, decoded) != sameColumnParity);
+			TEST_CHECK(sameColumnParity || (memcmp(decoded, payload, sizeof(payload)) == 0));
+		}
+	}
+
+	// 4 errors on the corners of a rectangle inside the data can't be located
+	memcpy(corrupted, burst, sizeof(burst));
+	flipMatrixBit(corrupted, (1 + 15 + 2)); // rows 1 and 3, columns 2 and 7
+	flipMatrixBit(corrupted, (1 + 15 + 7));
+	flipMatrixBit(corrupted, (1 + 45 + 2));
+	flipMatrixBit(corrupted, (1 + 45 + 7));
+	dmrDataDecoderBPTCDecode(corrupted, decoded);
+	TEST_CHECK(memcmp(decoded, payload, sizeof(payload)) != 0);
+}
+
+static void testTrellis(void)
+{
+	uint8_t payload[DMR_DATA_DECODER_TRELLIS_PAYLOAD_LENGTH];
+	uint8_t decoded[DMR_DATA_DECODER_TRELLIS_PAYLOAD_LENGTH];
+	uint8_t burst[DMR_DATA_DECODER_BURST_LENGTH];
+	uint8_t interleave[98];
+
+	trellisInterleave(interleave);
+
+	for (uint32_t n = 0; n < 2000; n++)
+	{
+		for (uint32_t i = 0; i < sizeof(payload); i++)
+		{
+			payload[i] = testRandom(&seed);
+		}
+
+		encodeTrellis(payload, burst);
+		TEST_CHECK(dmrDataDecoderTrellisDecode(burst, decoded));
+		TEST_CHECK(memcmp(decoded, payload, sizeof(payload)) == 0);
+
+		// Symbols off by one level (the most likely error), away from each other in the trellis
+		for (uint32_t e = 0; e < 3; e++)
+		{
+			uint32_t symbol = ((e * 40) + (testRandom(&seed) % 10));
+			uint32_t dibit = 0;
+
+			while (interleave[dibit] != symbol)
+			{
+				dibit++;
+			}
+
+			setBit(burst, burstBitIndex((dibit * 2) + 1), (getBit(burst, burstBitIndex((dibit * 2) + 1)) ^ 0x01));
+		}
+
+		TEST_CHECK(dmrDataDecoderTrellisDecode(burst, decoded));
+		TEST_CHECK(memcmp(decoded, payload, sizeof(payload)) == 0);
+	}
+
+	// Noise is discarded on its path metric
+	uint32_t accepted = 0;
+	for (uint32_t n = 0; n < 1000; n++)
+	{
+		for (uint32_t i = 0; i < sizeof(burst); i++)
+		{
+			burst[i] = testRandom(&seed);
+		}
+
+		accepted += (dmrDataDecoderTrellisDecode(burst, decoded) ? 1 : 0);
+	}
+	TEST_CHECK(accepted == 0);
+}
+
+// UDT header: 1 to 4 rate 1/2 blocks, the last 2 octets being the CRC-CCITT
+static void makeUDTHeader(uint8_t *header, uint8_t format, uint8_t padNibbles, uint8_t blocks, uint32_t src, uint32_t dst, bool isGroup)
+{
+	memset(header, 0, 12);
+	header[0] = ((isGroup ? 0x80 : 0x00) | DMR_DATA_DPF_UDT);
+	header[1] = format;
+	header[2] = (dst >> 16); header[3] = (dst >> 8); header[4] = dst;
+	header[5] = (src >> 16); header[6] = (src >> 8); header[7] = src;
+	header[8] = ((padNibbles << 3) | (blocks - 1));
+	headerCRC(header);
+}
+
+// Unconfirmed and confirmed header, the user data is followed by the pad octets then the CRC-32
+static void makeDataHeader(uint8_t *header, dmrDataPacketFormat_t dpf, uint8_t sap, uint8_t padOctets, uint8_t blocks, uint32_t src, uint32_t dst, bool isGroup)
+{
+	memset(header, 0, 12);
+	header[0] = ((isGroup ? 0x80 : 0x00) | (padOctets & 0x10) | dpf);
+	header[1] = ((sap << 4) | (padOctets & 0x0F));
+	header[2] = (dst >> 16); header[3] = (dst >> 8); header[4] = dst;
+	header[5] = (src >> 16); header[6] = (src >> 8); header[7] = src;
+	header[8] = (0x80 | blocks); // full message
+	headerCRC(header);
+}
+
+static void packText7(const char *text, uint8_t *data)
+{
+	for (uint32_t i = 0; text[i] != 0; i++)
+	{
+		for (uint32_t b = 0; b < 7; b++)
+		{
+			setBit(data, ((i * 7) + b), ((text[i] >> (6 - b)) & 0x01));
+		}
+	}
+}
+
+// IPv4/UDP datagram to the Motorola TMS port, carrying a TMS header then the UTF-16LE text
+static size_t makeTMSDatagram(const char *text, uint8_t *data)
+{
+	static const uint8_t TMS_HEADER[] = { 0x00, 0x20, 0xA0, 0x00, 0x01, 0x04, 0x0D, 0x00, 0x0A, 0x00 };
+	size_t textLength = strlen(text);
+	size_t length = (20 + 8 + sizeof(TMS_HEADER) + (textLength * 2));
+
+	memset(data, 0, length);
+	data[0] = 0x45; // IPv4, 20 octets header
+	data[2] = (length >> 8); data[3] = length;
+	data[8] = 64;
+	data[9] = 17; // UDP
+	data[12] = 12; data[15] = 1; // 12.0.0.1
+	data[16] = 13; data[19] = 2;
+	data[20] = (4007 >> 8); data[21] = (4007 & 0xFF);
+	data[22] = (4007 >> 8); data[23] = (4007 & 0xFF);
+	data[24] = ((length - 20) >> 8); data[25] = (length - 20);
+	memcpy(&data[28], TMS_HEADER, sizeof(TMS_HEADER));
+
+	for (size_t i = 0; i < textLength; i++)
+	{
+		data[28 + sizeof(TMS_HEADER) + (i * 2)] = text[i];
+	}
+
+	return length;
+}
+
+// Appends the pad and the CRC-32 (LSB first) to fill the blocks, returns the pad length
+static uint8_t finishData(uint8_t *data, size_t length, size_t blocks, size_t blockLength)
+{
+	size_t total = (blocks * blockLength);
+	uint8_t padOctets = (total - 4 - length);
+
+	memset(&data[length], 0, padOctets);
+
+	uint32_t crc = crc32(data, (total - 4));
+
+	for (int i = 0; i < 4; i++)
+	{
+		data[total - 4 + i] = (crc >> (i * 8));
+	}
+
+	return padOctets;
+}
+
+static void testUDTMessages(void)
+{
+	uint8_t header[12];
+	uint8_t block[2][DMR_DATA_DECODER_BPTC_PAYLOAD_LENGTH];
+	dmrDataMessage_t message;
+
+	dmrDataDecoderInit();
+
+	// ISO 7 bits text on 2 blocks: 12 characters are 84 bits, padded to 88 bits, then 96 bits of pad and 16 of CRC
+	memset(block, 0, sizeof(block));
+	packText7("Hello DMR 73", &block[0][0]);
+	uint16_t crc = crcCCITT(&block[0][0], 22);
+	block[1][10] = (crc >> 8);
+	block[1][11] = crc;
+
+	makeUDTHeader(header, 0x03, 22, 2, 2345678, 91, true);
+	TEST_CHECK(sendHeader(header));
+	TEST_CHECK(dmrDataDecoderGetMessage(&message) == false);
+	TEST_CHECK(sendBlock(block[0], false));
+	TEST_CHECK(dmrDataDecoderGetMessage(&message) == false);
+	TEST_CHECK(sendBlock(block[1], false));
+	TEST_CHECK(dmrDataDecoderGetMessage(&message));
+	TEST_CHECK(strcmp(message.text, "Hello DMR 73") == 0);
+	TEST_CHECK((message.srcId == 2345678) && (message.dstId == 91) && message.isGroup);
+	TEST_CHECK(dmrDataDecoderGetMessage(&message) == false);
+
+	// Corrupted CRC: no message
+	block[1][11] ^= 0x01;
+	TEST_CHECK(sendHeader(header));
+	TEST_CHECK(sendBlock(block[0], false));
+	TEST_CHECK(sendBlock(block[1], false));
+	TEST_CHECK(dmrDataDecoderGetMessage(&message) == false);
+	block[1][11] ^= 0x01;
+
+	// Header CRC error
+	header[4] ^= 0x01;
+	TEST_CHECK(sendHeader(header) == false);
+	header[4] ^= 0x01;
+
+	// The blocks must follow the header within the timeout
+	TEST_CHECK(sendHeader(header));
+	TEST_CHECK(sendBlock(block[0], false));
+	mockMillis += DMR_DATA_DECODER_BLOCK_TIMEOUT;
+	TEST_CHECK(sendBlock(block[1], false) == false);
+	TEST_CHECK(dmrDataDecoderGetMessage(&message) == false);
+
+	// UDT is only rate 1/2
+	uint8_t rate34Block[DMR_DATA_DECODER_TRELLIS_PAYLOAD_LENGTH] = { 0 };
+	TEST_CHECK(sendHeader(header));
+	TEST_CHECK(sendBlock(rate34Block, true) == false);
+	TEST_CHECK(sendBlock(block[0], false) == false);
+
+	// Blocks without header are ignored
+	TEST_CHECK(sendBlock(block[1], false) == false);
+
+	// LIP short location report in binary UDT: 51.5N 0.125W
+	uint8_t lip[DMR_DATA_DECODER_BPTC_PAYLOAD_LENGTH] = { 0 };
+	int32_t longitude = (int32_t)lround(-0.125 * (33554432.0 / 360.0));
+	int32_t latitude = (int32_t)lround(51.5 * (16777216.0 / 180.0));
+
+	for (uint32_t b = 0; b < 25; b++)
+	{
+		setBit(lip, (4 + b), ((longitude >> (24 - b)) & 0x01));
+	}
+	for (uint32_t b = 0; b < 24; b++)
+	{
+		setBit(lip, (29 + b), ((latitude >> (23 - b)) & 0x01));
+	}
+	crc = crcCCITT(lip, 10);
+	lip[10] = (crc >> 8);
+	lip[11] = crc;
+
+	locationId = 0;
+	makeUDTHeader(header, 0x00, 0, 1, 3456789, 5057, false);
+	TEST_CHECK(sendHeader(header));
+	TEST_CHECK(sendBlock(lip, false));
+	TEST_CHECK(locationId == 3456789);
+	TEST_CHECK(fabs(locationLatitude - 51.5) < 0.00002);
+	TEST_CHECK(fabs(locationLongitude + 0.125) < 0.00002);
+	TEST_CHECK(dmrDataDecoderGetMessage(&message) == false); // a location isn't a text
+}
+
+static void testPacketDataMessages(void)
+{
+	uint8_t header[12];
+	uint8_t data[DMR_DATA_DECODER_BLOCKS_MAX * DMR_DATA_DECODER_TRELLIS_PAYLOAD_LENGTH];
+	uint8_t block[DMR_DATA_DECODER_TRELLIS_PAYLOAD_LENGTH];
+	dmrDataMessage_t message;
+	const char *text = "Meet at the repeater site at 10";
+
+	dmrDataDecoderInit();
+
+	// Unconfirmed rate 1/2: the whole datagram is cut in 12 octets blocks
+	size_t length = makeTMSDatagram(text, data);
+	uint8_t blocks = ((length + 4 + 11) / 12);
+	uint8_t pad = finishData(data, length, blocks, 12);
+
+	makeDataHeader(header, DMR_DATA_DPF_UNCONFIRMED, 0x04, pad, blocks, 1234567, 7654321, false);
+	TEST_CHECK(sendHeader(header));
+	for (uint8_t i = 0; i < blocks; i++)
+	{
+		TEST_CHECK(sendBlock(&data[i * 12], false));
+	}
+	TEST_CHECK(dmrDataDecoderGetMessage(&message));
+	TEST_CHECK(strcmp(message.text, text) == 0);
+	TEST_CHECK((message.srcId == 1234567) && (message.dstId == 7654321) && (message.isGroup == false));
+
+	// A lost block makes the CRC-32 fail
+	TEST_CHECK(sendHeader(header));
+	for (uint8_t i = 0; i < blocks; i++)
+	{
+		TEST_CHECK(sendBlock(&data[((i == 1) ? 2 : i) * 12], false));
+	}
+	TEST_CHECK(dmrDataDecoderGetMessage(&message) == false);
+
+	// Confirmed rate 3/4: each block starts with its serial number and CRC-9, then 16 octets
+	length = makeTMSDatagram(text, data);
+	blocks = ((length + 4 + 15) / 16);
+	pad = finishData(data, length, blocks, 16);
+
+	makeDataHeader(header, DMR_DATA_DPF_CONFIRMED, 0x04, pad, blocks, 2000001, 3000002, true);
+	TEST_CHECK(sendHeader(header));
+	for (uint8_t i = 0; i < blocks; i++)
+	{
+		uint16_t crc = crc9(&data[i * 16], 16, i, 0x1FF);
+
+		block[0] = ((i << 1) | (crc >> 8));
+		block[1] = crc;
+		memcpy(&block[2], &data[i * 16], 16);
+		TEST_CHECK(sendBlock(block, true));
+	}
+	TEST_CHECK(dmrDataDecoderGetMessage(&message));
+	TEST_CHECK(strcmp(message.text, text) == 0);
+	TEST_CHECK((message.srcId == 2000001) && message.isGroup);
+
+	// A block with a wrong serial number fails its CRC-9, and drops the message
+	TEST_CHECK(sendHeader(header));
+	uint16_t crc = crc9(&data[0], 16, 0, 0x1FF);
+	block[0] = ((5 << 1) | (crc >> 8));
+	block[1] = crc;
+	memcpy(&block[2], &data[0], 16);
+	TEST_CHECK(sendBlock(block, true) == false);
+	TEST_CHECK(sendBlock(block, true) == false);
+
+	// Confirmed rate 1/2 blocks use the other CRC-9 mask
+	length = makeTMSDatagram("QSL", data);
+	blocks = ((length + 4 + 9) / 10);
+	pad = finishData(data, length, blocks, 10);
+
+	makeDataHeader(header, DMR_DATA_DPF_CONFIRMED, 0x04, pad, blocks, 2000001, 3000002, true);
+	TEST_CHECK(sendHeader(header));
+	for (uint8_t i = 0; i < blocks; i++)
+	{
+		uint16_t blockCrc = crc9(&data[i * 10], 10, i, 0x0F0);
+
+		block[0] = ((i << 1) | (blockCrc >> 8));
+		block[1] = blockCrc;
+		memcpy(&block[2], &data[i * 10], 10);
+		TEST_CHECK(sendBlock(block, false));
+	}
+	TEST_CHECK(dmrDataDecoderGetMessage(&message));
+	TEST_CHECK(strcmp(message.text, "QSL") == 0);
+}
+
+static void testQueuedBursts(void)
+{
+	uint8_t header[12];
+	uint8_t block[DMR_DATA_DECODER_BPTC_PAYLOAD_LENGTH] = { 0 };
+	uint8_t burst[DMR_DATA_DECODER_BURST_LENGTH];
+	dmrDataMessage_t message;
+
+	dmrDataDecoderInit();
+
+	packText7("CQ", block);
+	uint16_t crc = crcCCITT(block, 10);
+	block[10] = (crc >> 8);
+	block[11] = crc;
+	makeUDTHeader(header, 0x03, 12, 1, 100, 200, true);
+
+	// Pushed from the ISR, decoded by the tick
+	encodeBPTC(header, burst);
+	dmrDataDecoderPushBurst(DMR_DATA_TYPE_DATA_HEADER, burst);
+	encodeBPTC(block, burst);
+	dmrDataDecoderPushBurst(DMR_DATA_TYPE_RATE_12_DATA, burst);
+	TEST_CHECK(dmrDataDecoderGetMessage(&message) == false);
+	dmrDataDecoderTick();
+	TEST_CHECK(dmrDataDecoderGetMessage(&message));
+	TEST_CHECK(strcmp(message.text, "CQ") == 0);
+
+	// At the call end, the queued bursts are decoded, then the partial message is dropped
+	encodeBPTC(header, burst);
+	dmrDataDecoderPushBurst(DMR_DATA_TYPE_DATA_HEADER, burst);
+	dmrDataDecoderReset();
+	TEST_CHECK(sendBlock(block, false) == false);
+
+	// The queue holds (DMR_DATA_DECODER_QUEUE_SIZE - 1) bursts, the others are dropped
+	encodeBPTC(header, burst);
+	for (uint32_t i = 0; i < (DMR_DATA_DECODER_QUEUE_SIZE - 1); i++)
+	{
+		dmrDataDecoderPushBurst(DMR_DATA_TYPE_DATA_HEADER, burst);
+	}
+	encodeBPTC(block, burst);
+	dmrDataDecoderPushBurst(DMR_DATA_TYPE_RATE_12_DATA, burst);
+	dmrDataDecoderTick();
+	TEST_CHECK(dmrDataDecoderGetMessage(&message) == false);
+
+	dmrDataDecoderPushBurst(DMR_DATA_TYPE_RATE_12_DATA, burst);
+	dmrDataDecoderTick();
+	TEST_CHECK(dmrDataDecoderGetMessage(&message));
+}
+
+static void benchmarkBurstDecoders(void)
+{
+	uint8_t payload[DMR_DATA_DECODER_TRELLIS_PAYLOAD_LENGTH];
+	uint8_t *bursts = malloc(64 * DMR_DATA_DECODER_BURST_LENGTH);
+	uint32_t failures = 0;
+
+	TEST_CHECK(bursts != NULL);
+
+	for (uint32_t n = 0; n < 64; n++)
+	{
+		for (uint32_t i = 0; i < sizeof(payload); i++)
+		{
+			payload[i] = testRandom(&seed);
+		}
+		encodeTrellis(payload, &bursts[n * DMR_DATA_DECODER_BURST_LENGTH]);
+	}
+
+	uint64_t start = testGetNanoseconds();
+	for (uint32_t n = 0; n < BENCHMARK_BURSTS; n++)
+	{
+		failures += (dmrDataDecoderTrellisDecode(&bursts[(n & 63) * DMR_DATA_DECODER_BURST_LENGTH], payload) ? 0 : 1);
+	}
+	uint64_t viterbiElapsed = (testGetNanoseconds() - start);
+
+	for (uint32_t n = 0; n < 64; n++)
+	{
+		encodeBPTC(&bursts[((n + 1) & 63) * DMR_DATA_DECODER_BURST_LENGTH], &bursts[n * DMR_DATA_DECODER_BURST_LENGTH]);
+	}
+
+	start = testGetNanoseconds();
+	for (uint32_t n = 0; n < BENCHMARK_BURSTS; n++)
+	{
+		failures += (dmrDataDecoderBPTCDecode(&bursts[(n & 63) * DMR_DATA_DECODER_BURST_LENGTH], payload) ? 0 : 1);
+	}
+	uint64_t bptcElapsed = (testGetNanoseconds() - start);
+
+	TEST_CHECK(failures == 0);
+	printf("benchmark: %u bursts, Viterbi (rate 3/4) %.1f ns, BPTC (rate 1/2) %.1f ns per burst\n",
+			BENCHMARK_BURSTS, ((double)viterbiElapsed / BENCHMARK_BURSTS), ((double)bptcElapsed / BENCHMARK_BURSTS));
+
+	free(bursts);
+}
+
+int main(void)
+{
+	dmrDataDecoderInit();
+
+	TEST_RUN(testBPTC);
+	TEST_RUN(testTrellis);
+	TEST_RUN(testUDTMessages);
+	TEST_RUN(testPacketDataMessages);
+	TEST_RUN(testQueuedBursts);
+	TEST_RUN(benchmarkBurstDecoders);
+
+	return EXIT_SUCCESS;
+}
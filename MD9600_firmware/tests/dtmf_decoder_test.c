@@ -0,0 +1,565 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+//
+// dtmfDecoder.c against synthetic 8kHz tones: the 16 digits, twist and frequency deviation limits, the noise
+// rejection, the 2 blocks debounce and the remote control access code, then a decode benchmark.
+//
+// The decoder is enabled through dtmfDecoderTick() with faked settings (analog mode, decoder option set, remote
+// control only in its own test, boot PIN 0427). The blocks are fed in whole DTMF_DECODER_BLOCK_SIZE chunks, so that the tones line up with them.
+//
+#include <math.h>
+#include <string.h>
+#include "testUtils.h"
+#include "main.h"
+#include "functions/dtmfDecoder.h"
+#include "functions/settings.h"
+#include "user_interface/menuSystem.h"
+
+#define TONE_AMPLITUDE          6000.0 // per tone, in 16 bits samples
+#define BLOCK                   DTMF_DECODER_BLOCK_SIZE
+#define BENCHMARK_SECONDS       60U
+
+static const double ROWS[4] = { 697.0, 770.0, 852.0, 941.0 };
+static const double COLUMNS[4] = { 1209.0, 1336.0, 1477.0, 1633.0 };
+static const char DIGITS[] = "123A456B789C*0#D";
+
+int mockCriticalNesting;
+volatile int settingsUsbMode = USB_MODE_CPS;
+volatile bool trxTransmissionEnabled = false;
+static uint32_t millis;
+static uint32_t noiseSeed = 0x2468ACE1U;
+static uint32_t phase; // sample index, so that consecutive blocks of the same tone are continuous
+static bool remoteControl;
+static int bootPinLength = 4;
+
+bool settingsIsOptionBitSet(bitfieldOptions_t bit)
+{
+	return ((bit == BIT_DTMF_DECODER) || (remoteControl && (bit == BIT_DTMF_REMOTE_CONTROL)));
+}
+
+int codeplugGetPasswordPin(int32_t *pinCode)
+{
+	*pinCode = 427;
+	return bootPinLength;
+}
+
+int trxGetMode(void)
+{
+	return RADIO_MODE_ANALOG;
+}
+
+void soundMonitorStart(void)
+{
+}
+
+void soundMonitorStop(void)
+{
+}
+
+int menuSystemGetCurrentMenuNumber(void)
+{
+	return UI_CHANNEL_MODE;
+}
+
+void uiNotificationShow(uiNotificationType_t type, uiNotificationID_t id, uint32_t msTimeout, const char *message, bool immediateRender)
+{
+}
+
+uint32_t ticksGetMillis(void)
+{
+	return millis;
+}
+
+void ticksTimerStart(ticksTimer_t *timer, uint32_t timeout)
+{
+	timer->start = millis;
+	timer->timeout = timeout;
+}
+
+bool ticksTimerHasExpired(ticksTimer_t *timer)
+{
+	return ((millis - timer->start) >= timer->timeout);
+}
+
+static void decoderStart(void)
+{
+	dtmfDecoderInit();
+	dtmfDecoderTick();
+	TEST_CHECK(dtmfDecoderIsActive());
+	phase = 0;
+}
+
+// Feeds blocks of a row/column tone pair (0 Hz: no tone), with optional white noise (peak amplitude)
+static void feedTones(double rowFrequency, double rowAmplitude, double columnFrequency, double columnAmplitude, double noise, uint32_t blocks)
+{
+	int16_t samples[BLOCK];
+
+	while (blocks-- > 0)
+	{
+		for (uint32_t i = 0; i < BLOCK; i++, phase++)
+		{
+			double t = ((double)phase / DTMF_DECODER_SAMPLE_RATE);
+			double sample = ((rowAmplitude * sin(2.0 * M_PI * rowFrequency * t)) + (columnAmplitude * sin(2.0 * M_PI * columnFrequency * t)));
+
+			if (noise > 0.0)
+			{
+				sample += (noise * (((double)(testRandom(&noiseSeed) & 0xFFFF) / 32768.0) - 1.0));
+			}
+
+			samples[i] = (int16_t)lround(sample);
+		}
+
+		dtmfDecoderProcessSamples(samples, BLOCK, 1);
+	}
+}
+
+// Feeds a digit (0: silence) for a number of samples, in chunks which don't line up with the blocks
+static void feedDigitSamples(char digit, uint32_t count)
+{
+	int16_t samples[37];
+	double rowFrequency = 0.0;
+	double columnFrequency = 0.0;
+
+	if (digit != 0)
+	{
+		const char *position = strchr(DIGITS, digit);
+
+		TEST_CHECK(position != NULL);
+		rowFrequency = ROWS[(position - DIGITS) / 4];
+		columnFrequency = COLUMNS[(position - DIGITS) % 4];
+	}
+
+	while (count > 0)
+	{
+		uint32_t chunk = ((count < (sizeof(samples) / sizeof(samples[0]))) ? count : (sizeof(samples) / sizeof(samples[0])));
+
+		for (uint32_t i = 0; i < chunk; i++, phase++)
+		{
+			double t = ((double)phase / DTMF_DECODER_SAMPLE_RATE);
+
+			samples[i] = (int16_t)lround(TONE_AMPLITUDE * (sin(2.0 * M_PI * rowFrequency * t) + sin(2.0 * M_PI * columnFrequency * t)));
+		}
+
+		dtmfDecoderProcessSamples(samples, chunk, 1);
+		count -= chunk;
+	}
+}
+
+static void feedDigit(char digit, uint32_t blocks)
+{
+	const char *position = strchr(DIGITS, digit);
+
+	TEST_CHECK(position != NULL);
+	feedTones(ROWS[(position - DIGITS) / 4], TONE_AMPLITUDE, COLUMNS[(position - DIGITS) % 4], TONE_AMPLITUDE, 0.0, blocks);
+}
+
+static void feedSilence(uint32_t blocks)
+{
+	feedTones(0.0, 0.0, 0.0, 0.0, 0.0, blocks);
+}
+
+// Returns the digits decoded since the previous call
+static const char *decodedDigits(void)
+{
+	static char digits[DTMF_DECODER_EVENT_QUEUE_SIZE + 1];
+	uint32_t count = 0;
+	char digit;
+
+	while (dtmfDecoderGetDigit(&digit))
+	{
+		TEST_CHECK(count < DTMF_DECODER_EVENT_QUEUE_SIZE);
+		digits[count++] = digit;
+	}
+	digits[count] = 0;
+
+	return digits;
+}
+
+// 1 digit, tone and pause of 4 blocks (51ms, above the ITU 40ms minimum), with the row level scaled by rowGain
+static bool isDecodedWithTwist(double rowGainDb)
+{
+	decoderStart();
+	feedTones(ROWS[1], (TONE_AMPLITUDE * pow(10.0, (rowGainDb / 20.0))), COLUMNS[1], TONE_AMPLITUDE, 0.0, 4);
+	feedSilence(4);
+
+	const char *digits = decodedDigits();
+
+	TEST_CHECK((digits[0] == 0) || (strcmp(digits, "5") == 0));
+
+	return (digits[0] != 0);
+}
+
+static bool isDecodedWithDeviation(double deviationPercent)
+{
+	double factor = (1.0 + (deviationPercent / 100.0));
+
+	decoderStart();
+	feedTones((ROWS[2] * factor), TONE_AMPLITUDE, (COLUMNS[3] * factor), TONE_AMPLITUDE, 0.0, 4);
+	feedSilence(4);
+
+	const char *digits = decodedDigits();
+
+	TEST_CHECK((digits[0] == 0) || (strcmp(digits, "C") == 0));
+
+	return (digits[0] != 0);
+}
+
+static void testAllDigits(void)
+{
+	decoderStart();
+
+	for (uint32_t i = 0; i < 8; i++)
+	{
+		feedDigit(DIGITS[i], 4);
+		feedSilence(4);
+	}
+	TEST_CHECK(strcmp(decodedDigits(), "123A456B") == 0);
+
+	for (uint32_t i = 8; i < 16; i++)
+	{
+		feedDigit(DIGITS[i], 4);
+		feedSilence(4);
+	}
+	TEST_CHECK(strcmp(decodedDigits(), "789C*0#D") == 0);
+
+	// Reduced level (-20dB), still well above the detection threshold
+	decoderStart();
+	feedTones(ROWS[3], (TONE_AMPLITUDE / 10.0), COLUMNS[0], (TONE_AMPLITUDE / 10.0), 0.0, 4);
+	TEST_CHECK(strcmp(decodedDigits(), "*") == 0);
+}
+
+static void testInterleavedSamples(void)
+{
+	int16_t stereo[BLOCK * 2];
+
+	// Same tone on both channels of an interleaved buffer, only one of them is decoded
+	decoderStart();
+	for (uint32_t b = 0; b < 3; b++)
+	{
+		for (uint32_t i = 0; i < BLOCK; i++, phase++)
+		{
+			double t = ((double)phase / DTMF_DECODER_SAMPLE_RATE);
+			int16_t sample = (int16_t)lround(TONE_AMPLITUDE * (sin(2.0 * M_PI * ROWS[0] * t) + sin(2.0 * M_PI * COLUMNS[2] * t)));
+
+			stereo[(i * 2)] = sample;
+			stereo[(i * 2) + 1] = sample;
+		}
+
+		dtmfDecoderProcessSamples(stereo, BLOCK, 2);
+	}
+
+	TEST_CHECK(strcmp(decodedDigits(), "3") == 0);
+}
+
+static void testTwist(void)
+{
+	// Normal twist (row louder) up to 8dB, reverse twist (column louder) up to 4dB
+	TEST_CHECK(isDecodedWithTwist(0.0));
+	TEST_CHECK(isDecodedWithTwist(4.0));
+	TEST_CHECK(isDecodedWithTwist(7.5));
+	TEST_CHECK(isDecodedWithTwist(8.5) == false);
+	TEST_CHECK(isDecodedWithTwist(12.0) == false);
+	TEST_CHECK(isDecodedWithTwist(-3.5));
+	TEST_CHECK(isDecodedWithTwist(-4.5) == false);
+	TEST_CHECK(isDecodedWithTwist(-8.0) == false);
+}
+
+static void testFrequencyDeviation(void)
+{
+	// ITU-T Q.24: operation within 1.5%
+	TEST_CHECK(isDecodedWithDeviation(0.0));
+	TEST_CHECK(isDecodedWithDeviation(1.5));
+	TEST_CHECK(isDecodedWithDeviation(-1.5));
+
+	// Far off, between two DTMF frequencies of each group
+	TEST_CHECK(isDecodedWithDeviation(5.0) == false);
+	TEST_CHECK(isDecodedWithDeviation(-5.0) == false);
+
+	// Only one of the tones: no digit
+	decoderStart();
+	feedTones(ROWS[0], TONE_AMPLITUDE, 0.0, 0.0, 0.0, 4);
+	feedTones(0.0, 0.0, COLUMNS[0], TONE_AMPLITUDE, 0.0, 4);
+	feedTones(1000.0, TONE_AMPLITUDE, 2000.0, TONE_AMPLITUDE, 0.0, 4);
+	TEST_CHECK(decodedDigits()[0] == 0);
+}
+
+static void testNoiseRejection(void)
+{
+	// Noise alone, at several levels
+	decoderStart();
+	feedTones(0.0, 0.0, 0.0, 0.0, 3000.0, 40);
+	feedTones(0.0, 0.0, 0.0, 0.0, 20000.0, 40);
+	TEST_CHECK(decodedDigits()[0] == 0);
+
+	// A tone pair buried in noise doesn't hold enough of the block energy
+	feedTones(ROWS[1], (TONE_AMPLITUDE / 4.0), COLUMNS[2], (TONE_AMPLITUDE / 4.0), 20000.0, 8);
+	TEST_CHECK(decodedDigits()[0] == 0);
+
+	// Mild noise is fine
+	feedSilence(2);
+	feedTones(ROWS[1], TONE_AMPLITUDE, COLUMNS[2], TONE_AMPLITUDE, 1500.0, 4);
+	TEST_CHECK(strcmp(decodedDigits(), "6") == 0);
+}
+
+static void testTwoHitsDebounce(void)
+{
+	decoderStart();
+
+	// A single block hit isn't a digit
+	feedDigit('1', 1);
+	feedSilence(2);
+	TEST_CHECK(decodedDigits()[0] == 0);
+
+	// Two consecutive identical hits are
+	feedDigit('1', 2);
+	TEST_CHECK(strcmp(decodedDigits(), "1") == 0);
+
+	// A long tone is reported once
+	feedDigit('1', 20);
+	TEST_CHECK(decodedDigits()[0] == 0);
+
+	// A 1 block drop out doesn't repeat it
+	feedSilence(1);
+	feedDigit('1', 4);
+	TEST_CHECK(decodedDigits()[0] == 0);
+
+	// Nor a change of digit without the 2 blocks pause
+	feedDigit('2', 4);
+	TEST_CHECK(decodedDigits()[0] == 0);
+
+	// After a 2 blocks pause, the same digit is a new one
+	feedSilence(2);
+	feedDigit('2', 2);
+	TEST_CHECK(strcmp(decodedDigits(), "2") == 0);
+
+	// Alternating hits never give 2 identical ones in a row
+	feedSilence(2);
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		feedDigit('4', 1);
+		feedDigit('7', 1);
+	}
+	TEST_CHECK(decodedDigits()[0] == 0);
+
+	// A reset drops a half detected digit
+	feedSilence(2);
+	feedDigit('9', 1);
+	dtmfDecoderReset();
+	feedDigit('9', 1);
+	TEST_CHECK(decodedDigits()[0] == 0);
+	feedDigit('9', 1);
+	TEST_CHECK(strcmp(decodedDigits(), "9") == 0);
+}
+
+// ITU-T Q.24: 40ms tones separated by 40ms pauses are all decoded, whatever their position in the blocks
+static void testItuTiming(void)
+{
+	const uint32_t ms = (DTMF_DECODER_SAMPLE_RATE / 1000);
+
+	for (uint32_t offset = 0; offset < BLOCK; offset++)
+	{
+		char digits[sizeof(DIGITS)] = { 0 };
+
+		decoderStart();
+		feedDigitSamples(0, offset);
+
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			feedDigitSamples(DIGITS[i], (40 * ms));
+			feedDigitSamples(0, (40 * ms));
+			strcat(digits, decodedDigits());
+		}
+
+		TEST_CHECK(strcmp(digits, DIGITS) == 0);
+	}
+}
+
+// Tones up to 20ms are not digits (ITU-T Q.24 non-operate duration), even with 40ms pauses
+static void testShortTonesRejected(void)
+{
+	const uint32_t ms = (DTMF_DECODER_SAMPLE_RATE / 1000);
+
+	for (uint32_t offset = 0; offset < BLOCK; offset++)
+	{
+		decoderStart();
+		feedDigitSamples(0, offset);
+
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			feedDigitSamples(DIGITS[i], (20 * ms));
+			feedDigitSamples(0, (40 * ms));
+		}
+
+		TEST_CHECK(decodedDigits()[0] == 0);
+	}
+}
+
+// Sends each digit, then returns the ones which were turned into key presses, with UP/DOWN/GREEN/RED back to A/B/C/D
+static const char *remoteKeys(const char *digits)
+{
+	static char keys[DTMF_DECODER_RECEIVED_DIGITS_MAX + 1];
+	uint32_t count = 0;
+	keyboardCode_t key;
+
+	while (*digits != 0)
+	{
+		feedDigit(*digits++, 2);
+		feedSilence(2);
+
+		while (dtmfDecoderGetRemoteKey(&key))
+		{
+			if (key.event & KEY_MOD_PRESS)
+			{
+				TEST_CHECK(count < DTMF_DECODER_RECEIVED_DIGITS_MAX);
+				keys[count++] = ((key.key == KEY_UP) ? 'A' : ((key.key == KEY_DOWN) ? 'B' :
+						((key.key == KEY_GREEN) ? 'C' : ((key.key == KEY_RED) ? 'D' : key.key))));
+			}
+		}
+	}
+	keys[count] = 0;
+
+	return keys;
+}
+
+static void testRemoteControlAccessCode(void)
+{
+	remoteControl = true;
+	decoderStart();
+
+	// Locked, only A and B go through
+	TEST_CHECK(strcmp(remoteKeys("1C2D*A#B"), "AB") == 0);
+
+	// A wrong code, or the right one with extra digits, doesn't unlock
+	TEST_CHECK(remoteKeys("0428#C")[0] == 0);
+	TEST_CHECK(remoteKeys("00427#C")[0] == 0);
+
+	// The right code does, for all keys
+	TEST_CHECK(strcmp(remoteKeys("0427#C5D*"), "C5D*") == 0);
+
+	// Each key restarts the idle timeout
+	millis += (DTMF_DECODER_REMOTE_TIMEOUT - 1);
+	TEST_CHECK(strcmp(remoteKeys("7"), "7") == 0);
+	millis += (DTMF_DECODER_REMOTE_TIMEOUT - 1);
+	TEST_CHECK(strcmp(remoteKeys("8"), "8") == 0);
+
+	// Locked again once it expired
+	millis += DTMF_DECODER_REMOTE_TIMEOUT;
+	TEST_CHECK(strcmp(remoteKeys("9CA"), "A") == 0);
+
+	// And on reset
+	TEST_CHECK(strcmp(remoteKeys("0427#9"), "9") == 0);
+	dtmfDecoderReset();
+	TEST_CHECK(remoteKeys("9")[0] == 0);
+
+	// Without boot PIN it never unlocks
+	bootPinLength = 0;
+	TEST_CHECK(strcmp(remoteKeys("#0427#C1B"), "B") == 0);
+
+	bootPinLength = 4;
+	remoteControl = false;
+}
+
+static void testQueueFull(void)
+{
+	decoderStart();
+
+	// The queue holds (size - 1) digits, the next ones are dropped until it's read
+	for (uint32_t i = 0; i < DTMF_DECODER_EVENT_QUEUE_SIZE; i++)
+	{
+		feedDigit(DIGITS[i % 16], 2);
+		feedSilence(2);
+	}
+
+	TEST_CHECK(strlen(decodedDigits()) == (DTMF_DECODER_EVENT_QUEUE_SIZE - 1));
+
+	feedDigit('#', 2);
+	TEST_CHECK(strcmp(decodedDigits(), "#") == 0);
+}
+
+static void benchmarkDecode(void)
+{
+	uint32_t blocks = ((BENCHMARK_SECONDS * DTMF_DECODER_SAMPLE_RATE) / BLOCK);
+	int16_t *samples = malloc(blocks * BLOCK * sizeof(int16_t));
+	uint32_t decoded = 0;
+	char digit;
+
+	TEST_CHECK(samples != NULL);
+
+	// Digits of 8 blocks, with 8 blocks pauses, over some noise
+	for (uint32_t i = 0; i < (blocks * BLOCK); i++)
+	{
+		double t = ((double)i / DTMF_DECODER_SAMPLE_RATE);
+		uint32_t digitIndex = ((i / (BLOCK * 16)) % 16);
+		double sample = (((double)(testRandom(&noiseSeed) & 0x3FF)) - 512.0);
+
+		if (((i / (BLOCK * 8)) & 1) == 0)
+		{
+			sample += (TONE_AMPLITUDE * (sin(2.0 * M_PI * ROWS[digitIndex / 4] * t) + sin(2.0 * M_PI * COLUMNS[digitIndex % 4] * t)));
+		}
+
+		samples[i] = (int16_t)lround(sample);
+	}
+
+	decoderStart();
+
+	uint64_t start = testGetNanoseconds();
+
+	for (uint32_t b = 0; b < blocks; b++)
+	{
+		dtmfDecoderProcessSamples(&samples[b * BLOCK], BLOCK, 1);
+
+		while (dtmfDecoderGetDigit(&digit))
+		{
+			decoded++;
+		}
+	}
+
+	uint64_t elapsed = (testGetNanoseconds() - start);
+
+	TEST_CHECK(decoded == (blocks / 16));
+	printf("benchmark: %u s of audio decoded in %.2f ms, %.1f ns per sample, %u digits\n", BENCHMARK_SECONDS,
+			((double)elapsed / 1e6), ((double)elapsed / (blocks * BLOCK)), decoded);
+
+	free(samples);
+}
+
+int main(void)
+{
+	TEST_RUN(testAllDigits);
+	TEST_RUN(testInterleavedSamples);
+	TEST_RUN(testTwist);
+	TEST_RUN(testFrequencyDeviation);
+	TEST_RUN(testNoiseRejection);
+	TEST_RUN(testTwoHitsDebounce);
+	TEST_RUN(testItuTiming);
+	TEST_RUN(testShortTonesRejected);
+	TEST_RUN(testRemoteControlAccessCode);
+	TEST_RUN(testQueueFull);
+	TEST_RUN(benchmarkDecode);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,441 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+//
+// The adaptive jitter buffer sizing of hotspotJitter.c, against replayed network arrival traces.
+//
+// Each stream is a DMR voice call sent every 60ms by the network, delayed by a random jitter (and sometimes a
+// spike), replayed millisecond by millisecond into a model of the hotspot transmitter: the buffer fills up to the
+// target depth, then one frame is sent every 60ms, silence when the buffer is empty. The underruns and starved slots
+// counted by the model are checked against the module statistics, and the target depth against the jitter.
+//
+#include <string.h>
+#include "testUtils.h"
+#include "functions/hotspotJitter.h"
+
+#define BUFFER_CAPACITY      48U // HOTSPOT_BUFFER_COUNT
+#define STREAM_GAP         2000U // ms, between the replayed streams
+#define BENCHMARK_FRAMES  10000000U
+
+typedef struct
+{
+	uint32_t frames;
+	uint32_t jitterMax; // ms, uniform delay spread
+	uint32_t spikeEvery; // frames, 0 for none
+	uint32_t spikeDelay; // ms
+	uint32_t interval; // ms between the frames sent by the network, 0 for real time
+} trace_t;
+
+typedef struct
+{
+	uint32_t underruns; // silence episodes while frames of the stream were still to come
+	uint32_t starvedSlots;
+	uint32_t overflows;
+	uint32_t maxDepth;
+	uint32_t startDepth; // target depth when the transmission started
+} replayResult_t;
+
+static uint32_t seed = 0x4A495454;
+
+// Replays one stream from startTime, returns the time the transmitter went idle
+static uint32_t replayStream(uint32_t startTime, const trace_t *trace, replayResult_t *result)
+{
+	uint32_t arrivals[4096];
+	uint32_t arrived = 0;
+	uint32_t depth = 0;
+	bool transmitting = false;
+	bool starving = false;
+	uint32_t nextSlot = 0;
+
+	memset(result, 0, sizeof(replayResult_t));
+	TEST_CHECK(trace->frames <= 4096);
+
+	// The network delivers the frames in order
+	for (uint32_t i = 0; i < trace->frames; i++)
+	{
+		uint32_t delay = ((trace->jitterMax > 0) ? (testRandom(&seed) % (trace->jitterMax + 1)) : 0);
+
+		if ((trace->spikeEvery > 0) && (i > 0) && ((i % trace->spikeEvery) == 0))
+		{
+			delay += trace->spikeDelay;
+		}
+
+		arrivals[i] = (startTime + (i * ((trace->interval > 0) ? trace->interval : HOTSPOT_JITTER_FRAME_DURATION)) + delay);
+		if ((i > 0) && ((int32_t)(arrivals[i] - arrivals[i - 1]) < 0))
+		{
+			arrivals[i] = arrivals[i - 1];
+		}
+	}
+
+	for (uint32_t t = startTime; ; t++)
+	{
+		while ((arrived < trace->frames) && (arrivals[arrived] == t))
+		{
+			if (depth >= BUFFER_CAPACITY)
+			{
+				hotspotJitterFrameDropped();
+				result->overflows++;
+			}
+			else
+			{
+				depth++;
+				hotspotJitterFrameArrived(t, depth);
+				if (depth > result->maxDepth)
+				{
+					result->maxDepth = depth;
+				}
+			}
+			arrived++;
+			starving = false;
+		}
+
+		if ((transmitting == false) && (depth > 0) && ((depth >= hotspotJitterGetTargetDepth()) || (arrived == trace->frames)))
+		{
+			transmitting = true;
+			nextSlot = t;
+			result->startDepth = hotspotJitterGetTargetDepth();
+		}
+
+		if (transmitting && (t == nextSlot))
+		{
+			nextSlot += HOTSPOT_JITTER_FRAME_DURATION;
+
+			if (depth > 0)
+			{
+				depth--;
+			}
+			else
+			{
+				// Silence, as the hotspot doesn't know yet whether the stream has ended
+				hotspotJitterSlotStarved();
+
+				if (arrived == trace->frames)
+				{
+					return t; // end of the stream, this silence isn't an underrun
+				}
+
+				if (starving == false)
+				{
+					result->underruns++;
+					starving = true;
+				}
+				result->starvedSlots++;
+			}
+		}
+	}
+}
+
+static void checkStats(const hotspotJitterStats_t *before, const replayResult_t *result, uint32_t frames)
+{
+	hotspotJitterStats_t stats;
+
+	hotspotJitterGetStats(&stats);
+	TEST_CHECK((stats.frames - before->frames) == (frames - result->overflows));
+	TEST_CHECK((stats.overflows - before->overflows) == result->overflows);
+	TEST_CHECK((stats.underruns - before->underruns) == result->underruns);
+	TEST_CHECK((stats.starvedSlots - before->starvedSlots) == result->starvedSlots);
+	TEST_CHECK((stats.targetDepth >= HOTSPOT_JITTER_DEPTH_MIN) && (stats.targetDepth <= HOTSPOT_JITTER_DEPTH_MAX));
+	TEST_CHECK(stats.maxDepth >= result->maxDepth);
+}
+
+static void testInit(void)
+{
+	hotspotJitterStats_t stats;
+
+	hotspotJitterInit();
+	hotspotJitterGetStats(&stats);
+
+	TEST_CHECK(stats.targetDepth == HOTSPOT_JITTER_DEPTH_DEFAULT);
+	TEST_CHECK(hotspotJitterGetTargetDepth() == HOTSPOT_JITTER_DEPTH_DEFAULT);
+	TEST_CHECK(stats.jitter == ((HOTSPOT_JITTER_DEPTH_DEFAULT - 1) * HOTSPOT_JITTER_FRAME_DURATION));
+	TEST_CHECK((stats.frames == 0) && (stats.underruns == 0) && (stats.starvedSlots == 0) && (stats.overflows == 0));
+	TEST_CHECK((stats.depth == 0) && (stats.maxDepth == 0));
+}
+
+// A network without jitter: no underrun, and the target decays to the minimum over a few streams
+static void testSteadyNetwork(void)
+{
+	static const trace_t TRACE = { .frames = 500 };
+	hotspotJitterStats_t before;
+	replayResult_t result;
+	uint32_t t = 1000;
+
+	hotspotJitterInit();
+
+	for (uint32_t stream = 0; stream < 4; stream++)
+	{
+		hotspotJitterGetStats(&before);
+		t = (replayStream(t, &TRACE, &result) + STREAM_GAP);
+		checkStats(&before, &result, TRACE.frames);
+		TEST_CHECK((result.underruns == 0) && (result.overflows == 0));
+	}
+
+	TEST_CHECK(hotspotJitterGetTargetDepth() == HOTSPOT_JITTER_DEPTH_MIN);
+}
+
+// The target follows the delay spread: 1 frame, plus the spread rounded up to frames
+static void testTargetFollowsJitter(void)
+{
+	static const uint32_t JITTERS[] = { 30, 100, 170, 290, 500 };
+	hotspotJitterStats_t stats;
+
+	for (uint32_t j = 0; j < (sizeof(JITTERS) / sizeof(JITTERS[0])); j++)
+	{
+		trace_t trace = { .frames = 2000, .jitterMax = JITTERS[j] };
+		uint32_t expected = (1 + ((JITTERS[j] + HOTSPOT_JITTER_FRAME_DURATION - 1) / HOTSPOT_JITTER_FRAME_DURATION));
+		replayResult_t result;
+		uint32_t t = 5000;
+
+		hotspotJitterInit();
+
+		// First stream to learn, then none of the following streams underruns
+		t = (replayStream(t, &trace, &result) + STREAM_GAP);
+		for (uint32_t stream = 0; stream < 3; stream++)
+		{
+			hotspotJitterStats_t before;
+
+			hotspotJitterGetStats(&before);
+			t = (replayStream(t, &trace, &result) + STREAM_GAP);
+			checkStats(&before, &result, trace.frames);
+			TEST_CHECK(result.underruns == 0);
+		}
+
+		// The measured spread can't exceed the real one, and the peak is close to it after 2000 frames
+		hotspotJitterGetStats(&stats);
+		TEST_CHECK(stats.jitter <= JITTERS[j]);
+		TEST_CHECK(stats.jitter >= ((JITTERS[j] * 3) / 4));
+		TEST_CHECK((stats.targetDepth == expected) || (stats.targetDepth == (expected - 1)));
+	}
+}
+
+// Starting too shallow underruns, each underrun adds a frame to the peak delay, and the next streams don't underrun
+static void testUnderrunsRaiseTarget(void)
+{
+	static const trace_t TRACE = { .frames = 300, .jitterMax = 350 };
+	hotspotJitterStats_t before;
+	hotspotJitterStats_t stats;
+	replayResult_t result;
+	uint32_t t = 0;
+	uint32_t underrunStreams = 0;
+
+	hotspotJitterInit();
+
+	// Learn a quiet network first, down to the minimum depth
+	for (uint32_t stream = 0; stream < 3; stream++)
+	{
+		static const trace_t QUIET = { .frames = 500 };
+
+		t = (replayStream(t, &QUIET, &result) + STREAM_GAP);
+	}
+	TEST_CHECK(hotspotJitterGetTargetDepth() == HOTSPOT_JITTER_DEPTH_MIN);
+
+	hotspotJitterGetStats(&before);
+	t = (replayStream(t, &TRACE, &result) + STREAM_GAP);
+	checkStats(&before, &result, TRACE.frames);
+	TEST_CHECK(result.underruns > 0);
+	TEST_CHECK(result.startDepth == HOTSPOT_JITTER_DEPTH_MIN);
+
+	hotspotJitterGetStats(&stats);
+	TEST_CHECK(stats.jitter >= ((350 * 3) / 4));
+
+	for (uint32_t stream = 0; stream < 5; stream++)
+	{
+		hotspotJitterGetStats(&before);
+		t = (replayStream(t, &TRACE, &result) + STREAM_GAP);
+		checkStats(&before, &result, TRACE.frames);
+		underrunStreams += ((result.underruns > 0) ? 1 : 0);
+	}
+	TEST_CHECK(underrunStreams == 0);
+}
+
+// A single late frame raises the target at once, which then decays back (1/64 of the gap per frame)
+static void testSpikeAndDecay(void)
+{
+	static const trace_t SPIKE = { .frames = 60, .jitterMax = 20, .spikeEvery = 50, .spikeDelay = 600 };
+	static const trace_t QUIET = { .frames = 100, .jitterMax = 20 };
+	hotspotJitterStats_t before;
+	replayResult_t result;
+	uint32_t t = 0;
+	uint32_t streams = 0;
+
+	hotspotJitterInit();
+	for (uint32_t stream = 0; stream < 10; stream++)
+	{
+		t = (replayStream(t, &QUIET, &result) + STREAM_GAP);
+	}
+	TEST_CHECK(hotspotJitterGetTargetDepth() == HOTSPOT_JITTER_DEPTH_MIN);
+
+	hotspotJitterGetStats(&before);
+	t = (replayStream(t, &SPIKE, &result) + STREAM_GAP);
+	checkStats(&before, &result, SPIKE.frames);
+	TEST_CHECK(hotspotJitterGetTargetDepth() >= 8); // the 600ms spike, partly decayed by the 10 following frames
+
+	// Back to the minimum after some quiet streams, which don't underrun
+	while (hotspotJitterGetTargetDepth() > HOTSPOT_JITTER_DEPTH_MIN)
+	{
+		hotspotJitterGetStats(&before);
+		t = (replayStream(t, &QUIET, &result) + STREAM_GAP);
+		checkStats(&before, &result, QUIET.frames);
+		TEST_CHECK(result.underruns == 0);
+		TEST_CHECK(++streams < 20);
+	}
+	TEST_CHECK(streams > 1);
+}
+
+// The first frame of a stream arriving late doesn't make all the others look late: the anchor moves to the earliest
+static void testEarlyFramesMoveTheAnchor(void)
+{
+	hotspotJitterStats_t stats;
+	uint32_t t = 10000;
+
+	hotspotJitterInit();
+	for (uint32_t stream = 0; stream < 3; stream++)
+	{
+		static const trace_t QUIET = { .frames = 500 };
+		replayResult_t result;
+
+		t = (replayStream(t, &QUIET, &result) + STREAM_GAP);
+	}
+
+	hotspotJitterFrameArrived(t + 300, 1); // 300ms late
+	for (uint32_t i = 1; i < 100; i++)
+	{
+		hotspotJitterFrameArrived(t + (i * HOTSPOT_JITTER_FRAME_DURATION), 1);
+	}
+
+	hotspotJitterGetStats(&stats);
+	TEST_CHECK(stats.jitter == 0);
+	TEST_CHECK(stats.targetDepth == HOTSPOT_JITTER_DEPTH_MIN);
+}
+
+// A short silence stays in the stream (and the starved slots count), a long one starts a new stream
+static void testStreamGap(void)
+{
+	hotspotJitterStats_t stats;
+	uint32_t t = 0;
+
+	hotspotJitterInit();
+	hotspotJitterFrameArrived(t, 1);
+	hotspotJitterSlotStarved();
+	hotspotJitterSlotStarved();
+
+	t += (HOTSPOT_JITTER_STREAM_GAP + 1);
+	hotspotJitterFrameArrived(t, 1);
+	hotspotJitterGetStats(&stats);
+	TEST_CHECK((stats.underruns == 0) && (stats.starvedSlots == 0));
+
+	hotspotJitterSlotStarved();
+	t += HOTSPOT_JITTER_STREAM_GAP; // not longer than the gap
+	hotspotJitterFrameArrived(t, 1);
+	hotspotJitterGetStats(&stats);
+	TEST_CHECK((stats.underruns == 1) && (stats.starvedSlots == 1));
+	TEST_CHECK(stats.jitter >= HOTSPOT_JITTER_FRAME_DURATION); // the underrun adds one frame, on top of the delay
+}
+
+// The millisecond clock wraps after 49 days
+static void testClockWrap(void)
+{
+	static const trace_t TRACE = { .frames = 1000, .jitterMax = 100 };
+	hotspotJitterStats_t before;
+	hotspotJitterStats_t stats;
+	replayResult_t result;
+	uint32_t t = (UINT32_MAX - (30 * HOTSPOT_JITTER_FRAME_DURATION));
+
+	hotspotJitterInit();
+	hotspotJitterGetStats(&before);
+	t = (replayStream(t, &TRACE, &result) + STREAM_GAP);
+	checkStats(&before, &result, TRACE.frames);
+
+	hotspotJitterGetStats(&stats);
+	TEST_CHECK(t < (TRACE.frames * HOTSPOT_JITTER_FRAME_DURATION * 2)); // wrapped
+	TEST_CHECK((stats.jitter > 50) && (stats.jitter <= 100));
+}
+
+// A network burst overflows the buffer, and the target and reported depths are clamped
+static void testOverflowAndDepth(void)
+{
+	static const trace_t BURST = { .frames = 200, .interval = 5 };
+	hotspotJitterStats_t stats;
+	replayResult_t result;
+	hotspotJitterStats_t before;
+
+	hotspotJitterInit();
+
+	// The network sends much faster than real time (the frames look early, so the target can only decay)
+	hotspotJitterGetStats(&before);
+	replayStream(0, &BURST, &result);
+	checkStats(&before, &result, BURST.frames);
+	TEST_CHECK(result.overflows > 0);
+	hotspotJitterGetStats(&stats);
+	TEST_CHECK(stats.maxDepth == BUFFER_CAPACITY);
+	TEST_CHECK(stats.targetDepth < HOTSPOT_JITTER_DEPTH_DEFAULT);
+
+	// The longest delay which doesn't start a new stream needs more than the maximum depth
+	hotspotJitterInit();
+	hotspotJitterFrameArrived(100000, 1);
+	hotspotJitterFrameArrived(100000 + HOTSPOT_JITTER_STREAM_GAP, 2);
+	TEST_CHECK(hotspotJitterGetTargetDepth() == HOTSPOT_JITTER_DEPTH_MAX);
+
+	hotspotJitterFrameArrived(100000 + HOTSPOT_JITTER_STREAM_GAP + HOTSPOT_JITTER_FRAME_DURATION, 1000);
+	hotspotJitterGetStats(&stats);
+	TEST_CHECK((stats.depth == UINT8_MAX) && (stats.maxDepth == UINT8_MAX));
+}
+
+static void benchmarkFrameArrived(void)
+{
+	uint32_t sum = 0;
+
+	hotspotJitterInit();
+
+	uint64_t start = testGetNanoseconds();
+
+	for (uint32_t i = 0; i < BENCHMARK_FRAMES; i++)
+	{
+		hotspotJitterFrameArrived((i * HOTSPOT_JITTER_FRAME_DURATION) + (testRandom(&seed) & 0x7F), (i & 0x0F));
+		sum += hotspotJitterGetTargetDepth();
+	}
+
+	uint64_t elapsed = (testGetNanoseconds() - start);
+
+	TEST_CHECK(sum > 0);
+	printf("  %.1f ns per frame\n", ((double)elapsed / BENCHMARK_FRAMES));
+}
+
+int main(void)
+{
+	TEST_RUN(testInit);
+	TEST_RUN(testSteadyNetwork);
+	TEST_RUN(testTargetFollowsJitter);
+	TEST_RUN(testUnderrunsRaiseTarget);
+	TEST_RUN(testSpikeAndDecay);
+	TEST_RUN(testEarlyFramesMoveTheAnchor);
+	TEST_RUN(testStreamGap);
+	TEST_RUN(testClockWrap);
+	TEST_RUN(testOverflowAndDepth);
+	TEST_RUN(benchmarkFrameArrived);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,228 @@
+#!/usr/bin/env python3
+#
+# hotspotTelemetry.c encoder against tools/hotspot_telemetry/decode_telemetry.py, round trip.
+#
+# The firmware module is built for the host with a driver generated from the scenarios below (counters, histogram
+# samples, frame latencies), and the payloads it encodes are decoded by the tool, directly, as a whole MMDVM frame,
+# and from a MMDVMHost log hex dump. The expected values are computed here, independently of the C code.
+#
+# Skipped (exit code 77) when the host gcc isn't available.
+#
+import contextlib
+import io
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+FIRMWARE_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+sys.path.insert(0, os.path.join(FIRMWARE_DIR, "..", "tools", "hotspot_telemetry"))
+
+import decode_telemetry
+
+COUNTERS = 10 # HOTSPOT_TELEMETRY_COUNTER_MAX
+HISTOGRAMS = 5 # HOTSPOT_TELEMETRY_HISTOGRAM_MAX
+BUCKETS = 8
+SHIFTS = [4, 0, 0, 3, 0] # HOTSPOT_TELEMETRY_HISTOGRAM_SHIFTS
+FRAME_TO_AIR_LATENCY = 3
+ISR_TO_USB_LATENCY = 4
+STAMP_RF = 0
+STAMP_NET = 1
+PAYLOAD_LENGTH_MAX = 200
+MMDVM_DEBUG_DUMP = 0xFA
+
+# Each scenario is one reporting period: (sequence, period in ms, counters, histogram samples, frame stamps).
+# The samples are (histogram, value, repeat), the stamps (stamp, buffer index, received, done, done again).
+SCENARIOS = [
+	(0, 0, [0] * COUNTERS, [], []),
+	(1, 10000, [1, 127, 128, 16383, 16384, 2097151, 2097152, 268435455, 268435456, 4294967295],
+		[(0, 0, 1), (0, 15, 1), (0, 16, 2), (0, 1023, 1), (0, 1024, 1), (0, 4000, 3),
+		 (1, 0, 1), (1, 1, 1), (1, 2, 1), (1, 3, 1), (1, 63, 1), (1, 64, 1), (1, 4294967295, 1),
+		 (2, 5, 500), (2, 48, 7),
+		 (3, 7, 1), (3, 8, 1), (3, 1023, 1), (3, 1024, 1),
+		 (4, 0, 1), (4, 127, 1), (4, 128, 1)],
+		[]),
+	(2, 60000, [1000, 0, 0, 0, 0, 0, 0, 0, 0, 0], [(2, 3, 70000)], []), # saturated bucket
+	(255, 4294967295, [4294967295] * COUNTERS, [(h, 4294967295, 65535) for h in range(HISTOGRAMS)] + [(h, 0, 65535) for h in range(HISTOGRAMS)], []),
+	(3, 5000, [0] * COUNTERS, [],
+		[(STAMP_NET, 0, 1000, 1100, True), (STAMP_NET, 47, 1000, 1000, False), (STAMP_NET, 48 + 5, 2000, 2030, False),
+		 (STAMP_RF, 3, 4294967290, 5, False), (STAMP_RF, 4, 100, 227, False)]),
+]
+
+
+def check(condition, message):
+	if not condition:
+		sys.stderr.write("check failed: %s\n" % message)
+		sys.exit(1)
+
+
+def bucketOf(value, shift):
+	return (value >> shift).bit_length()
+
+
+def labelCovers(label, value):
+	if label.startswith("<"):
+		return value < int(label[1:])
+	if label.startswith(">="):
+		return value >= int(label[2:])
+	(low, high) = label.split("-")
+	return int(low) <= value <= int(high)
+
+
+def expectedReport(scenario):
+	(sequence, period, counters, samples, stamps) = scenario
+	histograms = [[0] * BUCKETS for _ in range(HISTOGRAMS)]
+
+	def sample(histogram, value, repeat):
+		bucket = min(bucketOf(value, SHIFTS[histogram]), BUCKETS - 1)
+		histograms[histogram][bucket] = min(histograms[histogram][bucket] + repeat, 65535)
+
+	for (histogram, value, repeat) in samples:
+		sample(histogram, value, repeat)
+
+	for (stamp, index, received, done, doneAgain) in stamps:
+		sample(ISR_TO_USB_LATENCY if stamp == STAMP_RF else FRAME_TO_AIR_LATENCY, (done - received) & 0xFFFFFFFF, 1)
+
+	return {"sequence": sequence, "period": period, "counters": counters, "histograms": list(zip(SHIFTS, histograms))}
+
+
+def driverSource(scenarios):
+	lines = ["#include <stdio.h>", "#include \"functions/hotspotTelemetry.h\"", "",
+			"static void emit(uint32_t time, uint8_t sequence)", "{",
+			"\thotspotTelemetrySnapshot_t snapshot;", "\tuint8_t payload[HOTSPOT_TELEMETRY_PAYLOAD_LENGTH_MAX];",
+			"\thotspotTelemetryTakeSnapshot(&snapshot, time);",
+			"\tuint8_t length = hotspotTelemetryEncode(&snapshot, sequence, payload, sizeof(payload));",
+			"\tprintf(\"%u %u\", hotspotTelemetryEncode(&snapshot, sequence, payload, length - 1), length);",
+			"\tfor (uint8_t i = 0; i < length; i++) printf(\" %02X\", payload[i]);",
+			"\tprintf(\"\\n\");", "}", "",
+			"int main(void)", "{", "\tuint32_t time = 123456;", "\thotspotTelemetryInit(time);"]
+
+	for (sequence, period, counters, samples, stamps) in scenarios:
+		for (counter, value) in enumerate(counters):
+			# Split in two, the counters accumulate
+			lines.append("\thotspotTelemetryCount(%d, %uU);" % (counter, value // 2))
+			lines.append("\thotspotTelemetryCount(%d, %uU);" % (counter, value - (value // 2)))
+		for (histogram, value, repeat) in samples:
+			lines.append("\tfor (int i = 0; i < %d; i++) hotspotTelemetrySample(%d, %uU);" % (repeat, histogram, value))
+		for (stamp, index, received, done, doneAgain) in stamps:
+			lines.append("\thotspotTelemetryStampFrame(%d, %d, %uU);" % (stamp, index, received))
+			lines.append("\thotspotTelemetryFrameDone(%d, %d, %uU);" % (stamp, index, done))
+			if doneAgain:
+				lines.append("\thotspotTelemetryFrameDone(%d, %d, %uU);" % (stamp, index, done + 1000))
+		# A frame done which was never stamped isn't sampled
+		lines.append("\thotspotTelemetryFrameDone(%d, 20, 5000U);" % STAMP_NET)
+		lines.append("\ttime += %uU;" % period)
+		lines.append("\temit(time, %d);" % sequence)
+
+	lines += ["\treturn 0;", "}", ""]
+	return "\n".join(lines)
+
+
+# Returns the (payloads, short buffer results) encoded by the firmware module
+def encode(directory, scenarios):
+	driver = os.path.join(directory, "driver.c")
+	executable = os.path.join(directory, "driver")
+	with open(driver, "w") as f:
+		f.write(driverSource(scenarios))
+
+	subprocess.check_call(["gcc", "-std=c11", "-Wall", "-Werror", "-I", os.path.join(FIRMWARE_DIR, "application", "include"),
+			driver, os.path.join(FIRMWARE_DIR, "application", "source", "functions", "hotspotTelemetry.c"), "-o", executable])
+	output = subprocess.check_output([executable], universal_newlines=True)
+
+	payloads = []
+	for line in output.splitlines():
+		fields = line.split()
+		check(int(fields[1]) == len(fields) - 2, "payload length")
+		check(int(fields[0]) == 0, "encoded into a too small buffer")
+		payloads.append(bytes(int(h, 16) for h in fields[2:]))
+	return payloads
+
+
+def testRoundTrip(directory):
+	payloads = encode(directory, SCENARIOS)
+	check(len(payloads) == len(SCENARIOS), "one payload per period")
+
+	for (scenario, payload) in zip(SCENARIOS, payloads):
+		report = decode_telemetry.decode(payload)
+		expected = expectedReport(scenario)
+		check(report == expected, "decoded %r, expected %r" % (report, expected))
+		check(len(payload) <= PAYLOAD_LENGTH_MAX, "payload length %d" % len(payload))
+
+		# Each sample lands in the bucket whose label covers it
+		for (histogram, value, repeat) in scenario[3]:
+			(shift, buckets) = report["histograms"][histogram]
+			bucket = min(bucketOf(value, shift), BUCKETS - 1)
+			check(labelCovers(decode_telemetry.bucketLabel(bucket, BUCKETS, shift), value), "label of %d in histogram %d" % (value, histogram))
+
+		# Whole MMDVM frame, as sent by hotspot.c
+		frame = bytes([0xE0, len(payload) + 3, MMDVM_DEBUG_DUMP]) + payload
+		check(decode_telemetry.decode(frame) == expected, "whole frame")
+
+	# The largest values give the longest payload, which fits with some margin
+	check(max(len(p) for p in payloads) == len(payloads[3]), "longest payload")
+	print("  payloads of %s bytes" % ", ".join(str(len(p)) for p in payloads))
+
+
+# MMDVMHost CUtils::dump() format, the 3 bytes header isn't dumped
+def mmdvmHostLog(payloads):
+	lines = []
+	for (n, payload) in enumerate(payloads):
+		lines.append("M: 2024-05-01 10:00:%02d.000 DMR Slot 2, received network voice header from F1ABC to TG 91" % n)
+		lines.append("M: 2024-05-01 10:00:%02d.100 Debug: Modem dump" % n)
+		for offset in range(0, len(payload), 16):
+			chunk = payload[offset:offset + 16]
+			text = "".join((chr(b) if 32 <= b < 127 else ".") for b in chunk)
+			lines.append("M: 2024-05-01 10:00:%02d.100 %04X:  %s%s   *%s*" % (n, offset, "".join("%02X " % b for b in chunk), "   " * (16 - len(chunk)), text))
+	lines.append("M: 2024-05-01 10:01:00.000 DMR Slot 2, network end of voice transmission")
+	return [line + "\n" for line in lines]
+
+
+def testLogDumps(directory):
+	payloads = encode(directory, SCENARIOS)
+	dumps = list(decode_telemetry.dumpsFromLog(mmdvmHostLog(payloads)))
+	check(len(dumps) == len(payloads), "%d dumps found in the log" % len(dumps))
+
+	for (scenario, dump) in zip(SCENARIOS, dumps):
+		check(decode_telemetry.decode(bytes(dump)) == expectedReport(scenario), "log dump")
+
+	# The report is printed with the names the firmware uses
+	output = io.StringIO()
+	with contextlib.redirect_stdout(output):
+		decode_telemetry.printReport(decode_telemetry.decode(payloads[1]))
+	check("Telemetry #1, period 10.0s" in output.getvalue(), "report title")
+	check("USB parser overflows" in output.getvalue() and "ISR to USB latency (ms), 3 samples" in output.getvalue(), "report names")
+
+
+def testInvalidPayloads(directory):
+	payloads = encode(directory, SCENARIOS[1:2])
+
+	check(decode_telemetry.decode(b"\x00" + payloads[0][1:]) is None, "not a telemetry payload")
+
+	for length in range(1, len(payloads[0])):
+		try:
+			decode_telemetry.decode(payloads[0][:length])
+			check(False, "truncated payload of %d bytes accepted" % length)
+		except ValueError:
+			pass
+
+	try:
+		decode_telemetry.decode(bytes([payloads[0][0], 2]) + payloads[0][2:])
+		check(False, "unknown version accepted")
+	except ValueError:
+		pass
+
+
+def main():
+	if shutil.which("gcc") is None:
+		print("skipped, gcc not found")
+		sys.exit(77)
+
+	for test in (testRoundTrip, testLogDumps, testInvalidPayloads):
+		with tempfile.TemporaryDirectory() as directory:
+			test(directory)
+		print("%s: OK" % test.__name__)
+
+
+if __name__ == "__main__":
+	main()
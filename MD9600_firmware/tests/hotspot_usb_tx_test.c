@@ -0,0 +1,419 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+//
+// The hotspot USB TX ring of hotspot.c (enqueueUSBData() / processUSBDataQueue()) against a simulated CDC endpoint:
+// the packing of whole frames into 64 bytes packets, the retry while the endpoint is busy, the overflow, and long
+// random runs checking the byte stream across many wraps of the ring. Then a throughput and latency benchmark.
+//
+// hotspot_usb_tx_1536_test builds the same test with the 512 * 3 buffer size of the other platforms, which isn't
+// a power of 2.
+//
+#include <string.h>
+#include "testUtils.h"
+#include "main.h"
+#include "functions/hotspot.h"
+#include "functions/pocsag.h"
+#include "functions/settings.h"
+#include "functions/sound.h"
+#include "functions/ticks.h"
+#include "functions/trx.h"
+#include "user_interface/menuSystem.h"
+#include "user_interface/uiHotspot.h"
+#include "user_interface/uiUtilities.h"
+#include "hardware/HR-C6000.h"
+#include "usb/usb_com.h"
+
+#define PACKET_SIZE                64U
+#define STREAM_BYTES_MAX       400000U
+#define BENCHMARK_FRAMES      1000000U
+#define BENCHMARK_DMR_FRAME_LENGTH 40U // 3 bytes header, control byte, 33 bytes payload, 2 bytes RSSI, padding
+#define BENCHMARK_REPLY_LENGTH     10U // short replies (ACK, NAK, DMR lost), which pack several per packet
+
+// Simulated CDC endpoint: the accepted packets are appended to the received stream
+static uint8_t receivedStream[STREAM_BYTES_MAX];
+static uint32_t receivedLength;
+static uint32_t receivedPackets;
+static uint16_t largestPacket;
+static bool cdcBusy;
+
+// Benchmark: the endpoint only measures the latency of each frame, from its enqueueUSBData() call
+#define LATENCY_SLOTS            1024U // power of 2, more than the frames the ring can hold
+static bool benchmarkRunning;
+static uint64_t enqueueTimes[LATENCY_SLOTS];
+static uint32_t framesSent;
+static uint64_t latencySum;
+static uint64_t latencyMax;
+
+// Everything hotspot.c links against, the TX ring only uses the CDC endpoint and the telemetry
+int mockCriticalNesting;
+volatile uint8_t usbComSendBuf[COM_BUFFER_SIZE];
+union sharedDataBuffer audioAndHotspotDataBuffer;
+volatile int16_t wavbuffer_read_idx;
+volatile int16_t wavbuffer_write_idx;
+volatile int16_t wavbuffer_count;
+bool PTTToggledDown;
+settingsStruct_t nonVolatileSettings;
+uiDataGlobal_t uiDataGlobal;
+TRXDevice_t radioDevices[RADIO_DEVICE_MAX];
+volatile bool trxTransmissionEnabled;
+volatile bool trxIsTransmitting;
+uint32_t trxDMRID;
+uint32_t trxTalkGroupOrPcId;
+volatile pocsagTxProgress_t pocsagTxProgress;
+
+uint8_t CDC_Transmit_FS(uint8_t *buf, uint16_t len)
+{
+	if (cdcBusy)
+	{
+		return USBD_BUSY;
+	}
+
+	if (benchmarkRunning)
+	{
+		uint64_t now = testGetNanoseconds();
+
+		for (uint16_t offset = 0; offset < len; offset += buf[offset + 1], framesSent++)
+		{
+			uint64_t latency = (now - enqueueTimes[framesSent & (LATENCY_SLOTS - 1)]);
+
+			latencySum += latency;
+			if (latency > latencyMax)
+			{
+				latencyMax = latency;
+			}
+		}
+
+		receivedPackets++;
+		return USBD_OK;
+	}
+
+	TEST_CHECK((receivedLength + len) <= STREAM_BYTES_MAX);
+	memcpy(&receivedStream[receivedLength], buf, len);
+	receivedLength += len;
+	receivedPackets++;
+	if (len > largestPacket)
+	{
+		largestPacket = len;
+	}
+
+	return USBD_OK;
+}
+
+uint32_t ticksGetMillis(void) { return 0; }
+void ticksTimerStart(ticksTimer_t *timer, uint32_t timeout) { }
+bool ticksTimerHasExpired(ticksTimer_t *timer) { return false; }
+void HRC6000ClearIsWakingState(void) { }
+void HRC6000GetTone1Config(HRC6000_Tone1Config_t *cfg) { }
+void HRC6000ResetTimeSlotDetection(void) { }
+void HRC6000SetMic(bool isOn) { }
+void HRC6000SetTone1Config(HRC6000_Tone1Config_t *cfg) { }
+char *chomp(char *str) { return str; }
+void hotspotExit(void) { }
+bool lastHeardListUpdate(uint8_t *dmrDataBuffer, bool forceOnHotspot) { return false; }
+uint8_t pocsagGetQueueSpace(void) { return 0; }
+void pocsagInit(void) { }
+bool pocsagTxStart(uint32_t freq, uint16_t baudRate) { return false; }
+void pocsagTxStop(void) { }
+bool trxCheckFrequencyInAmateurBand(uint32_t frequency) { return true; }
+void trxDTMFoff(bool enableMic) { }
+void trxDisableTransmission(void) { }
+void trxEnableTransmission(void) { }
+int trxGetMode(void) { return RADIO_MODE_DIGITAL; }
+void trxSetDMRColourCode(uint8_t colourCode) { }
+void trxSetFrequency(uint32_t fRx, uint32_t fTx, int dmrMode) { }
+void trxSetModeAndBandwidth(int mode, bool bandwidthIs25kHz) { }
+void trxSetPowerFromLevel(uint8_t powerLevel) { }
+void trxSetTone1(int toneFreq) { }
+void trxSetTxCSS(uint16_t tone) { }
+void uiHotspotUpdateScreen(uint8_t rxCommandState) { }
+void usbComMMDVMGetParserStats(uint32_t *errors, uint32_t *overflows) { *errors = 0; *overflows = 0; }
+bool usbComMMDVMPeekFrame(const uint8_t **frame, uint8_t *length) { return false; }
+void usbComMMDVMReleaseFrame(void) { }
+
+// MMDVM like frame: 0xE0, length, then a running byte pattern (the sequence number of the byte in the whole stream)
+static uint32_t makeFrame(uint8_t *frame, uint8_t length, uint32_t streamPosition)
+{
+	frame[0] = 0xE0;
+	frame[1] = length;
+
+	for (uint32_t i = 2; i < length; i++)
+	{
+		frame[i] = (uint8_t)((streamPosition + i) * 7);
+	}
+
+	return (streamPosition + length);
+}
+
+static void resetEndpoint(void)
+{
+	hotspotInit();
+	receivedLength = 0;
+	receivedPackets = 0;
+	largestPacket = 0;
+	cdcBusy = false;
+}
+
+static void testPacking(void)
+{
+	uint8_t frames[8][UINT8_MAX];
+	static const uint8_t LENGTHS[8] = { 3, 40, 20, 4, 64, 100, 10, 54 };
+	uint32_t position = 0;
+	hotspotUSBTxStats_t stats;
+
+	resetEndpoint();
+
+	for (uint32_t i = 0; i < 8; i++)
+	{
+		position = makeFrame(frames[i], LENGTHS[i], position);
+		enqueueUSBData(frames[i], LENGTHS[i]);
+	}
+
+	// Frames shorter than the shortest MMDVM frame are ignored
+	enqueueUSBData(frames[0], 2);
+
+	// 3 + 40 + 20 = 63, then 4, then the 64 and 100 bytes ones alone, then 10 + 54
+	processUSBDataQueue();
+	TEST_CHECK((receivedPackets == 1) && (receivedLength == 63));
+	processUSBDataQueue();
+	TEST_CHECK((receivedPackets == 2) && (receivedLength == 67));
+	processUSBDataQueue();
+	TEST_CHECK((receivedPackets == 3) && (receivedLength == 131));
+	processUSBDataQueue();
+	TEST_CHECK((receivedPackets == 4) && (receivedLength == 231));
+	processUSBDataQueue();
+	TEST_CHECK((receivedPackets == 5) && (receivedLength == 295));
+	processUSBDataQueue();
+	TEST_CHECK(receivedPackets == 5);
+
+	uint32_t offset = 0;
+	for (uint32_t i = 0; i < 8; i++)
+	{
+		TEST_CHECK(memcmp(&receivedStream[offset], frames[i], LENGTHS[i]) == 0);
+		offset += LENGTHS[i];
+	}
+
+	hotspotGetUSBTxStats(&stats);
+	TEST_CHECK((stats.packets == 5) && (stats.frames == 8) && (stats.overflows == 0));
+	TEST_CHECK(stats.peakUsage == (295 + 8));
+}
+
+static void testBusyEndpoint(void)
+{
+	uint8_t frame[UINT8_MAX];
+	hotspotUSBTxStats_t stats;
+
+	resetEndpoint();
+
+	makeFrame(frame, 30, 0);
+	enqueueUSBData(frame, 30);
+	enqueueUSBData(frame, 30);
+
+	// Nothing is released while the endpoint is busy, the same packet is rebuilt
+	cdcBusy = true;
+	processUSBDataQueue();
+	processUSBDataQueue();
+	TEST_CHECK(receivedPackets == 0);
+
+	// Queued meanwhile, it joins the packet if it fits
+	enqueueUSBData(frame, 4);
+	cdcBusy = false;
+	processUSBDataQueue();
+	TEST_CHECK((receivedPackets == 1) && (receivedLength == 64));
+	processUSBDataQueue();
+	TEST_CHECK((receivedPackets == 1));
+
+	hotspotGetUSBTxStats(&stats);
+	TEST_CHECK((stats.packets == 1) && (stats.frames == 3));
+}
+
+static void testOverflow(void)
+{
+	uint8_t frame[UINT8_MAX];
+	hotspotUSBTxStats_t stats;
+	uint32_t queued = 0;
+	uint32_t queuedBytes = 0;
+
+	resetEndpoint();
+	makeFrame(frame, 100, 0);
+
+	// The ring holds (COM_BUFFER_SIZE - 1) bytes, records are the frame and its length byte
+	for (uint32_t i = 0; i < ((COM_BUFFER_SIZE / 101) + 5); i++)
+	{
+		enqueueUSBData(frame, 100);
+	}
+
+	hotspotGetUSBTxStats(&stats);
+	queued = ((COM_BUFFER_SIZE - 1) / 101);
+	TEST_CHECK(stats.overflows == (((COM_BUFFER_SIZE / 101) + 5) - queued));
+	TEST_CHECK(stats.peakUsage == (queued * 101));
+
+	// A smaller frame still fits in the remaining space
+	uint32_t remaining = ((COM_BUFFER_SIZE - 1) - (queued * 101));
+	if (remaining >= 4)
+	{
+		enqueueUSBData(frame, (remaining - 1));
+		queuedBytes = (remaining - 1);
+		hotspotGetUSBTxStats(&stats);
+		TEST_CHECK(stats.peakUsage == (COM_BUFFER_SIZE - 1));
+	}
+
+	while (receivedPackets < (queued + ((queuedBytes > 0) ? 1 : 0)))
+	{
+		uint32_t before = receivedPackets;
+
+		processUSBDataQueue();
+		TEST_CHECK(receivedPackets == (before + 1));
+	}
+
+	TEST_CHECK(receivedLength == ((queued * 100) + queuedBytes));
+
+	// And everything is usable again
+	enqueueUSBData(frame, 100);
+	processUSBDataQueue();
+	TEST_CHECK(receivedLength == ((queued * 100) + queuedBytes + 100));
+}
+
+// Random frame lengths, random producer/consumer interleaving and busy endpoint: the received stream has to be the
+// queued frames in order, minus the overflowed ones, while the ring positions wrap many times
+static void testRandomStream(void)
+{
+	static uint8_t expectedStream[STREAM_BYTES_MAX];
+	uint32_t expectedLength = 0;
+	uint32_t streamPosition = 0;
+	uint32_t seed = 0x5EED1234U;
+	uint32_t overflows = 0;
+	hotspotUSBTxStats_t stats;
+	uint8_t frame[UINT8_MAX];
+
+	resetEndpoint();
+
+	while (expectedLength < (STREAM_BYTES_MAX - (2 * UINT8_MAX)))
+	{
+		uint32_t action = (testRandom(&seed) % 16);
+
+		if (action < 9)
+		{
+			uint8_t length = ((testRandom(&seed) & 0x03) ? (3 + (testRandom(&seed) % 60)) : (3 + (testRandom(&seed) % 252)));
+
+			streamPosition = makeFrame(frame, length, streamPosition);
+			enqueueUSBData(frame, length);
+
+			uint32_t previousOverflows = overflows;
+			hotspotGetUSBTxStats(&stats);
+			overflows = stats.overflows;
+
+			if (overflows == previousOverflows)
+			{
+				memcpy(&expectedStream[expectedLength], frame, length);
+				expectedLength += length;
+			}
+		}
+		else
+		{
+			cdcBusy = (action == 15);
+			processUSBDataQueue();
+		}
+	}
+
+	cdcBusy = false;
+	for (uint32_t i = 0; i < COM_BUFFER_SIZE; i++)
+	{
+		processUSBDataQueue();
+	}
+
+	hotspotGetUSBTxStats(&stats);
+	TEST_CHECK(receivedLength == expectedLength);
+	TEST_CHECK(memcmp(receivedStream, expectedStream, expectedLength) == 0);
+	TEST_CHECK(largestPacket <= UINT8_MAX);
+	TEST_CHECK(stats.overflows > 0); // the consumer is slower than the producer, the overflow path was taken
+	TEST_CHECK(stats.peakUsage < COM_BUFFER_SIZE);
+	TEST_CHECK((receivedLength / COM_BUFFER_SIZE) > 100); // the ring wrapped
+	printf("%u bytes in %u packets, %u frames, %u dropped\n", receivedLength, receivedPackets, stats.frames, stats.overflows);
+}
+
+// Throughput and latency through the ring, with the consumer polled after each frame (the UI task runs more often
+// than frames arrive), then with the consumer starved while 8 frames pile up
+static void benchmarkThroughput(void)
+{
+	static const uint8_t LENGTHS[2] = { BENCHMARK_DMR_FRAME_LENGTH, BENCHMARK_REPLY_LENGTH };
+	uint8_t frame[UINT8_MAX];
+	hotspotUSBTxStats_t stats;
+
+	for (uint32_t l = 0; l < 2; l++)
+	{
+		uint8_t length = LENGTHS[l];
+
+		makeFrame(frame, length, 0);
+
+		for (uint32_t burst = 1; burst <= 8; burst *= 8)
+		{
+			resetEndpoint();
+			benchmarkRunning = true;
+			framesSent = 0;
+			latencySum = 0;
+			latencyMax = 0;
+
+			uint64_t start = testGetNanoseconds();
+			for (uint32_t i = 0; i < BENCHMARK_FRAMES; i += burst)
+			{
+				for (uint32_t b = 0; b < burst; b++)
+				{
+					enqueueTimes[(i + b) & (LATENCY_SLOTS - 1)] = testGetNanoseconds();
+					enqueueUSBData(frame, length);
+				}
+
+				for (uint32_t b = 0; b < burst; b++)
+				{
+					processUSBDataQueue();
+				}
+			}
+			uint64_t elapsed = (testGetNanoseconds() - start);
+
+			benchmarkRunning = false;
+			hotspotGetUSBTxStats(&stats);
+			TEST_CHECK((stats.frames == BENCHMARK_FRAMES) && (framesSent == BENCHMARK_FRAMES) && (stats.overflows == 0));
+			printf("benchmark: %u frames of %u bytes queued by %u, %.1f ns per frame (%.1f MB/s), %.2f frames per packet, "
+					"latency %.1f ns average, %.1f us max\n",
+					BENCHMARK_FRAMES, length, burst, ((double)elapsed / BENCHMARK_FRAMES),
+					(((double)BENCHMARK_FRAMES * length * 1000.0) / elapsed), ((double)stats.frames / stats.packets),
+					((double)latencySum / BENCHMARK_FRAMES), ((double)latencyMax / 1000.0));
+		}
+	}
+}
+
+int main(void)
+{
+	printf("COM_BUFFER_SIZE %u\n", COM_BUFFER_SIZE);
+
+	TEST_RUN(testPacking);
+	TEST_RUN(testBusyEndpoint);
+	TEST_RUN(testOverflow);
+	TEST_RUN(testRandomStream);
+	TEST_RUN(benchmarkThroughput);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include <string.h>
+#include "testUtils.h"
+#include "main.h"
+#include "interfaces/hr-c6000_spi.h"
+#include "hrc6000Sim.h"
+
+GPIO_TypeDef mockGPIOD;
+GPIO_TypeDef mockGPIOE;
+SPI_HandleTypeDef hspi1;
+int mockCriticalNesting = 0;
+
+chip_t chip;
+
+static void chipApplyFrame(const uint8_t *data, uint32_t length)
+{
+	if (length < 3)
+	{
+		return;
+	}
+
+	uint8_t page = (data[0] & 0x07);
+
+	if (data[0] & 0x80) // read
+	{
+		return;
+	}
+
+	if (data[0] & 0x40) // extended, single register
+	{
+		TEST_CHECK(length == 4);
+		chip.extendedRegisters[page][(data[1] | ((data[2] & 0x07) << 8))] = data[3];
+		return;
+	}
+
+	// The register address auto increments
+	for (uint32_t i = 2; i < length; i++)
+	{
+		chip.registers[page][(uint8_t)(data[1] + i - 2)] = data[i];
+	}
+}
+
+static uint8_t chipReadByte(uint32_t index)
+{
+	if ((index < 2) || ((chip.current[0] & 0x80) == 0))
+	{
+		return 0xFF;
+	}
+
+	return chip.registers[chip.current[0] & 0x07][(uint8_t)(chip.current[1] + index - 2)];
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state)
+{
+	bool level = (state != GPIO_PIN_RESET);
+
+	if (port != DMR_SPI_CS_GPIO_Port)
+	{
+		return;
+	}
+
+	if (mockCriticalNesting > chip.maxCriticalNesting)
+	{
+		chip.maxCriticalNesting = mockCriticalNesting;
+	}
+
+	switch (pin)
+	{
+		case DMR_SPI_CS_Pin:
+			if (level == false)
+			{
+				chip.selected = true;
+				chip.bitCount = 0;
+				memset(chip.current, 0, sizeof(chip.current));
+			}
+			else if (chip.selected)
+			{
+				uint32_t length = (chip.bitCount / 8);
+
+				// Every transfer has to be atomic
+				TEST_CHECK(mockCriticalNesting > 0);
+				TEST_CHECK((chip.bitCount % 8) == 0);
+
+				if (chip.frameCount < CHIP_FRAMES_MAX)
+				{
+					chipFrame_t *frame = &chip.frames[chip.frameCount];
+
+					frame->length = length;
+					memcpy(frame->data, chip.current, length);
+				}
+
+				chip.frameCount++;
+				chip.byteCount += length;
+				chipApplyFrame(chip.current, length);
+				chip.selected = false;
+			}
+			break;
+
+		case DMR_SPI_MOSI_Pin:
+			chip.mosi = level;
+			break;
+
+		case DMR_SPI_CLK_Pin:
+			if (chip.selected)
+			{
+				uint32_t index = (chip.bitCount / 8);
+
+				TEST_CHECK(index < CHIP_FRAME_LENGTH_MAX);
+
+				if ((chip.clock == true) && (level == false))
+				{
+					chip.miso = ((chipReadByte(index) >> (7 - (chip.bitCount % 8))) & 0x01);
+				}
+				else if ((chip.clock == false) && (level == true))
+				{
+					chip.current[index] |= (chip.mosi << (7 - (chip.bitCount % 8)));
+					chip.bitCount++;
+				}
+			}
+			chip.clock = level;
+			break;
+	}
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *port, uint16_t pin)
+{
+	return (((port == DMR_SPI_MISO_GPIO_Port) && (pin == DMR_SPI_MISO_Pin) && chip.miso) ? GPIO_PIN_SET : GPIO_PIN_RESET);
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t size, uint32_t timeout)
+{
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef *hspi, uint8_t *pTxData, uint8_t *pRxData, uint16_t size, uint32_t timeout)
+{
+	return HAL_OK;
+}
+
+void chipReset(void)
+{
+	memset(&chip, 0, sizeof(chip));
+	chip.clock = true;
+	SPI0inUse = false;
+	SPI0ShadowInvalidate();
+}
+
+void chipCheckFrame(uint32_t index, const uint8_t *expected, uint32_t length)
+{
+	TEST_CHECK(index < chip.frameCount);
+	TEST_CHECK(index < CHIP_FRAMES_MAX);
+	TEST_CHECK(chip.frames[index].length == length);
+	TEST_CHECK(memcmp(chip.frames[index].data, expected, length) == 0);
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef _OPENGD77_HRC6000_SIM_H_
+#define _OPENGD77_HRC6000_SIM_H_
+
+//
+// Simulated HR-C6000 on the bit banged SPI0 bus, shared by the tests which build spi.c.
+//
+// The GPIO writes of SPI0Write()/SPI0Read() are decoded into frames (chip select low to high, MOSI sampled on the
+// clock rising edge, MISO driven after the falling edge), which are counted, logged and applied to a register file,
+// so the tests check what the chip would actually receive.
+//
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CHIP_FRAMES_MAX        256U // logged, the others are only counted
+#define CHIP_FRAME_LENGTH_MAX  160U
+
+typedef struct
+{
+	uint8_t  data[CHIP_FRAME_LENGTH_MAX];
+	uint32_t length;
+} chipFrame_t;
+
+typedef struct
+{
+	bool        selected;
+	bool        clock;
+	bool        mosi;
+	bool        miso;
+	uint32_t    bitCount;
+	uint8_t     current[CHIP_FRAME_LENGTH_MAX];
+	chipFrame_t frames[CHIP_FRAMES_MAX];
+	uint32_t    frameCount;
+	uint32_t    byteCount;
+	uint8_t     registers[8][256];
+	uint8_t     extendedRegisters[8][2048];
+	int         maxCriticalNesting;
+} chip_t;
+
+extern chip_t chip;
+extern volatile bool SPI0inUse;
+
+void chipReset(void);
+void chipCheckFrame(uint32_t index, const uint8_t *expected, uint32_t length);
+
+#endif /* _OPENGD77_HRC6000_SIM_H_ */
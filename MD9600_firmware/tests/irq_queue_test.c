@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+//
+// The interrupt to task queue of irqQueue.c: the empty queue, the full queue and its dropped count, the free running
+// indexes wrapping, a random run against a reference ring, then a producer thread against a consumer thread (the ISR
+// and the task), checking that every entry arrives whole and in order, and that every refused push is counted.
+//
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include "testUtils.h"
+#include "functions/irqQueue.h"
+
+#define RANDOM_OPERATIONS  1000000U
+#define THREADED_ENTRIES   1000000U
+#define BENCHMARK_ENTRIES 10000000U
+
+// Entry n: all its values derived from n, so a torn entry is caught
+static irqQueueEntry_t entryMake(uint32_t n)
+{
+	irqQueueEntry_t entry;
+
+	for (uint32_t i = 0; i < IRQ_QUEUE_VALUES_MAX; i++)
+	{
+		entry.values[i] = (uint8_t)((n >> (i * 8)) ^ (i * 0x5A));
+	}
+
+	return entry;
+}
+
+static bool entryIs(const irqQueueEntry_t *entry, uint32_t n)
+{
+	irqQueueEntry_t expected = entryMake(n);
+
+	return (memcmp(entry, &expected, sizeof(irqQueueEntry_t)) == 0);
+}
+
+static void testEmpty(void)
+{
+	irqQueue_t queue;
+	irqQueueEntry_t entry = entryMake(0x11223344);
+
+	irqQueueInit(&queue);
+	TEST_CHECK(irqQueueIsEmpty(&queue));
+	TEST_CHECK(irqQueuePop(&queue, &entry) == false);
+	TEST_CHECK(entryIs(&entry, 0x11223344)); // untouched
+	TEST_CHECK(irqQueueGetDropped(&queue) == 0);
+
+	TEST_CHECK(irqQueuePush(&queue, &(irqQueueEntry_t){ .values = { 1, 2, 3, 4 } }));
+	TEST_CHECK(irqQueueIsEmpty(&queue) == false);
+	TEST_CHECK(irqQueuePop(&queue, &entry));
+	TEST_CHECK((entry.values[0] == 1) && (entry.values[3] == 4));
+	TEST_CHECK(irqQueueIsEmpty(&queue));
+	TEST_CHECK(irqQueuePop(&queue, &entry) == false);
+}
+
+// IRQ_QUEUE_SIZE entries fit, the next ones are dropped and counted, until the consumer frees a place
+static void testFull(void)
+{
+	irqQueue_t queue;
+	irqQueueEntry_t entry;
+
+	irqQueueInit(&queue);
+	for (uint32_t i = 0; i < IRQ_QUEUE_SIZE; i++)
+	{
+		entry = entryMake(i);
+		TEST_CHECK(irqQueuePush(&queue, &entry));
+	}
+	TEST_CHECK(irqQueueGetDropped(&queue) == 0);
+
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		entry = entryMake(100 + i);
+		TEST_CHECK(irqQueuePush(&queue, &entry) == false);
+	}
+	TEST_CHECK(irqQueueGetDropped(&queue) == 3);
+
+	TEST_CHECK(irqQueuePop(&queue, &entry));
+	TEST_CHECK(entryIs(&entry, 0));
+	entry = entryMake(IRQ_QUEUE_SIZE);
+	TEST_CHECK(irqQueuePush(&queue, &entry));
+	entry = entryMake(999);
+	TEST_CHECK(irqQueuePush(&queue, &entry) == false);
+	TEST_CHECK(irqQueueGetDropped(&queue) == 4);
+
+	// In order, the dropped ones missing
+	for (uint32_t i = 1; i <= IRQ_QUEUE_SIZE; i++)
+	{
+		TEST_CHECK(irqQueuePop(&queue, &entry));
+		TEST_CHECK(entryIs(&entry, i));
+	}
+	TEST_CHECK(irqQueueIsEmpty(&queue));
+
+	// Init clears the count
+	irqQueueInit(&queue);
+	TEST_CHECK(irqQueueGetDropped(&queue) == 0);
+}
+
+// The indexes are never masked, so the full and empty tests must hold when they wrap
+static void testIndexesWrap(void)
+{
+	irqQueue_t queue;
+	irqQueueEntry_t entry;
+	uint32_t pushed = 0;
+	uint32_t popped = 0;
+
+	irqQueueInit(&queue);
+	queue.head = (UINT32_MAX - 2);
+	queue.tail = (UINT32_MAX - 2);
+	TEST_CHECK(irqQueueIsEmpty(&queue));
+
+	// Full across the wrap: head has wrapped, tail hasn't
+	while (irqQueuePush(&queue, (entry = entryMake(pushed), &entry)))
+	{
+		pushed++;
+	}
+	TEST_CHECK(pushed == IRQ_QUEUE_SIZE);
+	TEST_CHECK(queue.head < queue.tail);
+	TEST_CHECK(irqQueueGetDropped(&queue) == 1);
+
+	// Interleaved, across the wrap of the tail
+	for (uint32_t i = 0; i < (4 * IRQ_QUEUE_SIZE); i++)
+	{
+		TEST_CHECK(irqQueuePop(&queue, &entry));
+		TEST_CHECK(entryIs(&entry, popped++));
+		entry = entryMake(pushed++);
+		TEST_CHECK(irqQueuePush(&queue, &entry));
+	}
+
+	while (irqQueuePop(&queue, &entry))
+	{
+		TEST_CHECK(entryIs(&entry, popped++));
+	}
+	TEST_CHECK(popped == pushed);
+	TEST_CHECK(irqQueueIsEmpty(&queue));
+	TEST_CHECK(queue.tail == (UINT32_MAX - 2 + pushed));
+	TEST_CHECK(irqQueueGetDropped(&queue) == 1);
+}
+
+// Random pushes and pops against a reference ring, starting close to the wrap
+static void testRandomOperations(void)
+{
+	irqQueue_t queue;
+	irqQueueEntry_t entry;
+	uint32_t seed = 0x49525131;
+	uint32_t pushed = 0;
+	uint32_t popped = 0;
+	uint32_t dropped = 0;
+
+	irqQueueInit(&queue);
+	queue.head = (UINT32_MAX - 1000);
+	queue.tail = (UINT32_MAX - 1000);
+
+	for (uint32_t op = 0; op < RANDOM_OPERATIONS; op++)
+	{
+		// Bursts of interrupts, then the task catching up
+		if ((testRandom(&seed) % 100) < ((op & 0x400) ? 60 : 35))
+		{
+			bool fits = ((pushed - popped) < IRQ_QUEUE_SIZE);
+
+			entry = entryMake(pushed);
+			TEST_CHECK(irqQueuePush(&queue, &entry) == fits);
+			if (fits)
+			{
+				pushed++;
+			}
+			else
+			{
+				dropped++;
+			}
+		}
+		else
+		{
+			bool available = (pushed != popped);
+
+			TEST_CHECK(irqQueuePop(&queue, &entry) == available);
+			if (available)
+			{
+				TEST_CHECK(entryIs(&entry, popped));
+				popped++;
+			}
+		}
+
+		TEST_CHECK(irqQueueIsEmpty(&queue) == (pushed == popped));
+		TEST_CHECK(irqQueueGetDropped(&queue) == dropped);
+	}
+
+	TEST_CHECK(dropped > 0);
+	printf("  %u entries, %u dropped\n", pushed, dropped);
+}
+
+typedef struct
+{
+	irqQueue_t    queue;
+	volatile bool done;
+	uint32_t      refused;
+} threadedRun_t;
+
+// Retries a refused entry, so they all get through, the refusals being the expected dropped count
+static void *producerThread(void *arg)
+{
+	threadedRun_t *run = arg;
+
+	for (uint32_t i = 0; i < THREADED_ENTRIES; i++)
+	{
+		irqQueueEntry_t entry = entryMake(i);
+
+		while (irqQueuePush(&run->queue, &entry) == false)
+		{
+			run->refused++;
+			sched_yield();
+		}
+	}
+
+	__atomic_store_n(&run->done, true, __ATOMIC_RELEASE);
+
+	return NULL;
+}
+
+// An ISR producer (one thread) against the consumer task (this thread)
+static void testThreaded(void)
+{
+	static threadedRun_t run;
+	pthread_t producer;
+	irqQueueEntry_t entry;
+	uint32_t popped = 0;
+
+	irqQueueInit(&run.queue);
+	run.done = false;
+	run.refused = 0;
+	TEST_CHECK(pthread_create(&producer, NULL, producerThread, &run) == 0);
+
+	while (true)
+	{
+		bool done = __atomic_load_n(&run.done, __ATOMIC_ACQUIRE);
+
+		while (irqQueuePop(&run.queue, &entry))
+		{
+			TEST_CHECK(entryIs(&entry, popped));
+			popped++;
+		}
+
+		if (done)
+		{
+			break;
+		}
+		sched_yield(); // the host may have a single core
+	}
+
+	TEST_CHECK(pthread_join(producer, NULL) == 0);
+	TEST_CHECK(popped == THREADED_ENTRIES);
+	TEST_CHECK(irqQueueGetDropped(&run.queue) == run.refused);
+	printf("  %u entries, %u refused while full\n", popped, run.refused);
+}
+
+static void benchmarkPushPop(void)
+{
+	irqQueue_t queue;
+	irqQueueEntry_t entry = entryMake(0);
+	uint32_t popped = 0;
+
+	irqQueueInit(&queue);
+
+	uint64_t start = testGetNanoseconds();
+
+	for (uint32_t i = 0; i < BENCHMARK_ENTRIES; i++)
+	{
+		irqQueuePush(&queue, &entry);
+		if ((i & 3) == 3)
+		{
+			while (irqQueuePop(&queue, &entry))
+			{
+				popped++;
+			}
+		}
+	}
+
+	uint64_t elapsed = (testGetNanoseconds() - start);
+
+	TEST_CHECK(popped == BENCHMARK_ENTRIES);
+	printf("  %.1f ns per push and pop, in bursts of 4\n", ((double)elapsed / BENCHMARK_ENTRIES));
+}
+
+int main(void)
+{
+	TEST_RUN(testEmpty);
+	TEST_RUN(testFull);
+	TEST_RUN(testIndexesWrap);
+	TEST_RUN(testRandomOperations);
+	TEST_RUN(testThreaded);
+	TEST_RUN(benchmarkPushPop);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,186 @@
+#!/usr/bin/env python3
+#
+# tools/memory_map/map_report.py against a real GNU ld map file.
+#
+# Host objects are linked with the firmware linker script (STM32F405VGTX_FLASH.ld), the map file format and the
+# section placement being the same as with the ARM toolchain. The radio's 'U' reply is faked for --budget --port.
+#
+# Skipped (exit code 77) when the host gcc/ld/ar aren't available.
+#
+import contextlib
+import io
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+
+FIRMWARE_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+LINKER_SCRIPT = os.path.join(FIRMWARE_DIR, "STM32F405VGTX_FLASH.ld")
+sys.path.insert(0, os.path.join(FIRMWARE_DIR, "..", "tools", "memory_map"))
+
+import map_report
+
+# Two modules, using the firmware placement attributes (utils.h, taskMemory.h)
+SOURCES = {
+	"taskMemory.c": """
+		#include <stdint.h>
+		uint32_t idleTaskStack[128] __attribute__((section(".ccmram.stack.idleTaskStack"), used));
+		uint32_t defaultTaskBuffer[2048];
+		uint8_t ucHeap[1024];
+		void Reset_Handler(void) { }
+	""",
+	"codec.c": """
+		#include <stdint.h>
+		uint8_t codecBuffer[CODEC_CCM_SIZE] __attribute__((section(".ccmram"), used));
+		uint32_t hrc6000TaskStack[1248] __attribute__((section(".ccmram.stack.hrc6000TaskStack"), used));
+		int codecCalls = 5;
+		__attribute__((section(".RamFunc"), noinline)) void codecTick(void) { codecCalls++; }
+	""",
+}
+
+CCM_SIZE = 65536
+CCM_FREE_MIN = 0x1000 # _Min_Ccmram_Free
+TOOLS = ("gcc", "ld", "ar")
+
+
+def check(condition, message):
+	if not condition:
+		sys.stderr.write("check failed: %s\n" % message)
+		sys.exit(1)
+
+
+# Returns the map file path, or None with the linker errors if the link failed
+def link(directory, codecCcmSize):
+	objects = []
+	for (name, source) in SOURCES.items():
+		path = os.path.join(directory, name)
+		with open(path, "w") as f:
+			f.write(source)
+		objects.append(path[:-2] + ".o")
+		subprocess.check_call(["gcc", "-O1", "-fno-pic", "-ffunction-sections", "-fdata-sections", "-fno-asynchronous-unwind-tables",
+				"-DCODEC_CCM_SIZE=%d" % codecCcmSize, "-c", path, "-o", objects[-1]])
+
+	# The script discards these libraries' sections, they have to exist
+	for library in ("libc.a", "libm.a", "libgcc.a"):
+		subprocess.check_call(["ar", "rc", os.path.join(directory, library)])
+
+	mapPath = os.path.join(directory, "firmware.map")
+	result = subprocess.run(["ld", "-static", "-nostdlib", "-L", directory, "-T", LINKER_SCRIPT, "-Map", mapPath,
+			"-o", os.path.join(directory, "firmware.elf")] + objects, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+
+	if result.returncode != 0:
+		return (None, result.stdout)
+	return (mapPath, result.stdout)
+
+
+def budgetReport(mapPath, usage=None):
+	(regions, outputSections, inputSections) = map_report.parseMap(mapPath)
+	output = io.StringIO()
+	with contextlib.redirect_stdout(output):
+		map_report.printBudget(regions, outputSections, inputSections, usage)
+	return output.getvalue()
+
+
+def rowOf(report, name):
+	for line in report.splitlines():
+		fields = line.split()
+		if fields and fields[0] == name:
+			return fields
+	return None
+
+
+def testBudget(directory):
+	(mapPath, errors) = link(directory, 10272)
+	check(mapPath is not None, "link failed:\n" + errors)
+
+	report = budgetReport(mapPath)
+	check(rowOf(report, "module")[1:] == ["CCMRAM", "RAM", "FLASH"], "regions")
+
+	# codec.o: 10272 + 4992 in the CCM, its initialised data and RAM function in RAM and in flash (load image)
+	codec = rowOf(report, "codec.o")
+	check(codec is not None and int(codec[1]) == (10272 + 4992), "codec.o CCM use: %r" % codec)
+	taskMemory = rowOf(report, "taskMemory.o")
+	check(taskMemory is not None and int(taskMemory[1]) == 512 and int(taskMemory[2]) >= (8192 + 1024), "taskMemory.o use: %r" % taskMemory)
+	check(int(rowOf(report, "free")[1]) == (CCM_SIZE - (10272 + 4992 + 512)), "CCM free")
+
+	check(rowOf(report, "hrc6000TaskStack")[1:4] == ["CCMRAM", "4992", "bytes"], "hrc6000 stack")
+	check(rowOf(report, "idleTaskStack")[1:3] == ["CCMRAM", "512"], "idle stack")
+	check(rowOf(report, "defaultTaskBuffer")[1:3] == ["RAM", "8192"], "default task stack (CubeMX)")
+	check("Task stacks: %d bytes" % (4992 + 512 + 8192) in report, "stacks total")
+	check("FreeRTOS heap: 1024 bytes (RAM)" in report, "heap")
+
+
+# A 'U' reply as sent by the radio (usb_com.c), read through a fake serial port
+class FakePort:
+	def __init__(self, reply):
+		self.reply = reply
+		self.written = b""
+
+	def reset_input_buffer(self):
+		pass
+
+	def write(self, data):
+		self.written += data
+
+	def read(self, count):
+		(data, self.reply) = (self.reply[:count], self.reply[count:])
+		return data
+
+
+def usageReply(tasks):
+	reply = b"U" + struct.pack(">BHII", len(tasks), 250, 700, 600)
+	for (name, load, highWater, priority, stackSize) in tasks:
+		reply += name.encode("ascii").ljust(map_report.TASK_NAME_LENGTH, b"\x00") + struct.pack(">HHBH", load, highWater, priority, stackSize)
+	return reply
+
+
+def testMeasuredStacks(directory):
+	(mapPath, errors) = link(directory, 10272)
+	check(mapPath is not None, "link failed:\n" + errors)
+
+	port = FakePort(usageReply([("hrc6000Task", 120, 400, 40, 1250), ("beepTask", 5, 20, 24, 256), ("IDLE", 800, 60, 0, 0)]))
+	usage = map_report.readUsage(port)
+	check(port.written == b"U", "request")
+	check(usage[0:2] == (700, 600), "heap free")
+
+	report = budgetReport(mapPath, usage)
+	check("free 700 bytes, minimum ever free 600 bytes" in report, "heap use")
+	check(rowOf(report, "hrc6000Task")[1:6] == ["40", "1250", "400", "850", "68.0%"], "hrc6000Task use")
+	beep = [line for line in report.splitlines() if line.startswith("beepTask")]
+	check(beep and ("less than %d%% free" % map_report.STACK_WARNING_MARGIN) in beep[0], "beepTask flagged")
+	check(rowOf(report, "IDLE")[2] == "?", "unknown stack size")
+
+	# Truncated reply
+	try:
+		map_report.readUsage(FakePort(usageReply([("hrc6000Task", 1, 2, 3, 4)])[:-1]))
+		check(False, "short reply accepted")
+	except IOError:
+		pass
+
+
+def testCcmHeadroom(directory):
+	used = 4992 + 512 # no alignment padding, every size being a multiple of 32
+
+	(mapPath, errors) = link(directory, (CCM_SIZE - CCM_FREE_MIN - used))
+	check(mapPath is not None, "link with exactly _Min_Ccmram_Free left failed:\n" + errors)
+
+	(mapPath, errors) = link(directory, (CCM_SIZE - CCM_FREE_MIN - used + 32))
+	check(mapPath is None and "_Min_Ccmram_Free" in errors, "CCM headroom not enforced")
+
+
+def main():
+	missing = [tool for tool in TOOLS if shutil.which(tool) is None]
+	if missing:
+		print("skipped, %s not found" % ", ".join(missing))
+		sys.exit(77)
+
+	for test in (testBudget, testMeasuredStacks, testCcmHeadroom):
+		with tempfile.TemporaryDirectory() as directory:
+			test(directory)
+		print("%s: OK" % test.__name__)
+
+
+if __name__ == "__main__":
+	main()
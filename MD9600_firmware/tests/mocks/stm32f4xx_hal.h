@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef _OPENGD77_HAL_STM32F4XX_HAL_H_
+#define _OPENGD77_HAL_STM32F4XX_HAL_H_
+
+// Host replacement of the STM32F4 HAL and CMSIS core headers, included by the real Core/Inc/main.h.
+// Only what the tested sources use: the peripheral handles are opaque, the registers are plain variables
+// defined by the tests which use them, as are the HAL functions.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum
+{
+	HAL_OK = 0,
+	HAL_ERROR,
+	HAL_BUSY,
+	HAL_TIMEOUT
+} HAL_StatusTypeDef;
+
+typedef enum
+{
+	GPIO_PIN_RESET = 0,
+	GPIO_PIN_SET
+} GPIO_PinState;
+
+typedef struct
+{
+	volatile uint32_t IDR;
+	volatile uint32_t ODR;
+	volatile uint32_t BSRR;
+} GPIO_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t CR1;
+	volatile uint32_t PSC;
+	volatile uint32_t ARR;
+	volatile uint32_t CNT;
+	volatile uint32_t EGR;
+} TIM_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t CFGR;
+} RCC_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t CTRL;
+	volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+	volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+typedef struct { uint32_t unused; } ADC_HandleTypeDef;
+typedef struct { uint32_t unused; } DAC_HandleTypeDef;
+typedef struct { uint32_t unused; } DMA_HandleTypeDef;
+typedef struct { uint32_t unused; } I2C_HandleTypeDef;
+typedef struct { uint32_t unused; } I2S_HandleTypeDef;
+typedef struct { uint32_t unused; } RTC_HandleTypeDef;
+typedef struct { uint32_t unused; } SPI_TypeDef;
+
+typedef struct
+{
+	SPI_TypeDef *Instance;
+} SPI_HandleTypeDef;
+
+typedef struct
+{
+	uint32_t Prescaler;
+	uint32_t CounterMode;
+	uint32_t Period;
+	uint32_t ClockDivision;
+	uint32_t RepetitionCounter;
+	uint32_t AutoReloadPreload;
+} TIM_Base_InitTypeDef;
+
+typedef struct
+{
+	TIM_TypeDef          *Instance;
+	TIM_Base_InitTypeDef Init;
+} TIM_HandleTypeDef;
+
+typedef struct
+{
+	uint32_t MasterOutputTrigger;
+	uint32_t MasterSlaveMode;
+} TIM_MasterConfigTypeDef;
+
+typedef struct
+{
+	uint32_t OCMode;
+	uint32_t Pulse;
+	uint32_t OCPolarity;
+	uint32_t OCFastMode;
+} TIM_OC_InitTypeDef;
+
+typedef struct { uint32_t unused; } UART_HandleTypeDef;
+
+typedef enum
+{
+	EXTI0_IRQn = 6,
+	EXTI1_IRQn = 7,
+	EXTI2_IRQn = 8,
+	EXTI15_10_IRQn = 40
+} IRQn_Type;
+
+extern GPIO_TypeDef mockGPIOA;
+extern GPIO_TypeDef mockGPIOB;
+extern GPIO_TypeDef mockGPIOC;
+extern GPIO_TypeDef mockGPIOD;
+extern GPIO_TypeDef mockGPIOE;
+extern TIM_TypeDef mockTIM5;
+extern TIM_TypeDef mockTIM6;
+extern SPI_TypeDef mockSPI2;
+extern RCC_TypeDef mockRCC;
+extern DWT_Type mockDWT;
+extern CoreDebug_Type mockCoreDebug;
+extern uint32_t SystemCoreClock;
+extern volatile uint32_t uwTick; // HAL millisecond counter
+
+#define GPIOA                        (&mockGPIOA)
+#define GPIOB                        (&mockGPIOB)
+#define GPIOC                        (&mockGPIOC)
+#define GPIOD                        (&mockGPIOD)
+#define GPIOE                        (&mockGPIOE)
+#define TIM5                         (&mockTIM5)
+#define TIM6                         (&mockTIM6)
+#define SPI2                         (&mockSPI2)
+#define RCC                          (&mockRCC)
+#define DWT                          (&mockDWT)
+#define CoreDebug                    (&mockCoreDebug)
+#define DWT_CTRL_CYCCNTENA_Msk       (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk   (1UL << 24)
+#define RCC_CFGR_PPRE1               (0x7UL << 10)
+#define RCC_CFGR_PPRE1_DIV1          0x00000000U
+#define RCC_CFGR_PPRE1_DIV4          0x00001400U
+#define TIM_CR1_CEN                  (1UL << 0)
+#define TIM_EGR_UG                   (1UL << 0)
+
+#define GPIO_PIN_0                   ((uint16_t)0x0001)
+#define GPIO_PIN_1                   ((uint16_t)0x0002)
+#define GPIO_PIN_2                   ((uint16_t)0x0004)
+#define GPIO_PIN_3                   ((uint16_t)0x0008)
+#define GPIO_PIN_4                   ((uint16_t)0x0010)
+#define GPIO_PIN_5                   ((uint16_t)0x0020)
+#define GPIO_PIN_6                   ((uint16_t)0x0040)
+#define GPIO_PIN_7                   ((uint16_t)0x0080)
+#define GPIO_PIN_8                   ((uint16_t)0x0100)
+#define GPIO_PIN_9                   ((uint16_t)0x0200)
+#define GPIO_PIN_10                  ((uint16_t)0x0400)
+#define GPIO_PIN_11                  ((uint16_t)0x0800)
+#define GPIO_PIN_12                  ((uint16_t)0x1000)
+#define GPIO_PIN_13                  ((uint16_t)0x2000)
+#define GPIO_PIN_14                  ((uint16_t)0x4000)
+#define GPIO_PIN_15                  ((uint16_t)0x8000)
+
+#define HAL_MAX_DELAY                0xFFFFFFFFU
+
+#define TIM_COUNTERMODE_UP              0x00000000U
+#define TIM_AUTORELOAD_PRELOAD_DISABLE  0x00000000U
+#define TIM_TRGO_RESET                  0x00000000U
+#define TIM_MASTERSLAVEMODE_DISABLE     0x00000000U
+#define TIM_OCMODE_PWM1                 0x00000060U
+#define TIM_OCPOLARITY_HIGH             0x00000000U
+#define TIM_OCFAST_DISABLE              0x00000000U
+#define TIM_CHANNEL_1                   0x00000000U
+
+#define __HAL_RCC_TIM5_CLK_ENABLE()  do {} while(0)
+
+#define __DMB()                      __sync_synchronize()
+#define __DSB()                      __sync_synchronize()
+#define __WFI()                      do {} while(0)
+#define __NOP()                      do {} while(0)
+#define __disable_irq()              do {} while(0)
+#define __enable_irq()               do {} while(0)
+
+// No linker sections on the host
+#define RAM_FUNCTION
+#define CCM_DATA
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *port, uint16_t pin);
+uint32_t HAL_GetTick(void);
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef *hspi, uint8_t *pTxData, uint8_t *pRxData, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t size);
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef *hspi);
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi);
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi);
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIMEx_MasterConfigSynchronization(TIM_HandleTypeDef *htim, TIM_MasterConfigTypeDef *sMasterConfig);
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t channel);
+HAL_StatusTypeDef HAL_TIM_PWM_Stop(TIM_HandleTypeDef *htim, uint32_t channel);
+HAL_StatusTypeDef HAL_TIM_PWM_ConfigChannel(TIM_HandleTypeDef *htim, TIM_OC_InitTypeDef *sConfig, uint32_t channel);
+void NVIC_SystemReset(void);
+
+#endif /* _OPENGD77_HAL_STM32F4XX_HAL_H_ */
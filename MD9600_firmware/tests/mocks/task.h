@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef _OPENGD77_MOCK_TASK_H_
+#define _OPENGD77_MOCK_TASK_H_
+
+#include "FreeRTOS.h"
+
+extern int mockCriticalNesting;
+
+static inline UBaseType_t mockEnterCritical(void)
+{
+	return (UBaseType_t)mockCriticalNesting++;
+}
+
+static inline void mockExitCritical(UBaseType_t saved)
+{
+	mockCriticalNesting = (int)saved;
+}
+
+#define taskENTER_CRITICAL_FROM_ISR()        mockEnterCritical()
+#define taskEXIT_CRITICAL_FROM_ISR(saved)    mockExitCritical(saved)
+#define taskENTER_CRITICAL()                 ((void)mockEnterCritical())
+#define taskEXIT_CRITICAL()                  mockExitCritical((UBaseType_t)(mockCriticalNesting - 1))
+
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+typedef struct { uint32_t unused; } StaticTask_t;
+
+typedef enum
+{
+	eRunning = 0,
+	eReady,
+	eBlocked,
+	eSuspended,
+	eDeleted,
+	eInvalid
+} eTaskState;
+
+typedef struct
+{
+	TaskHandle_t xHandle;
+	const char   *pcTaskName;
+	UBaseType_t  xTaskNumber;
+	eTaskState   eCurrentState;
+	UBaseType_t  uxCurrentPriority;
+	UBaseType_t  uxBasePriority;
+	uint32_t     ulRunTimeCounter;
+	StackType_t  *pxStackBase;
+	uint16_t     usStackHighWaterMark;
+} TaskStatus_t;
+
+void vTaskDelay(const TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higherPriorityTaskWoken);
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait);
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *status, UBaseType_t arraySize, uint32_t *totalRunTime);
+UBaseType_t uxTaskGetNumberOfTasks(void);
+TaskHandle_t xTaskGetIdleTaskHandle(void);
+
+#endif /* _OPENGD77_MOCK_TASK_H_ */
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+//
+// perf.c, the timing probes read by the CPS 'P' command (tools/perf/perf_dump.py).
+//
+// The recorded durations are checked against the probe min/max/total and its log2 histogram, and a probe scope
+// against the time it spent. On the host, the counter is CLOCK_MONOTONIC, in ns.
+//
+#include <string.h>
+#include <time.h>
+#include "testUtils.h"
+#include "functions/perf.h"
+
+static void testRecord(void)
+{
+	perfProbeStats_t stats;
+
+	perfInit();
+
+	perfRecord(PERF_PROBE_CODEC_DECODE, 5);
+	perfRecord(PERF_PROBE_CODEC_DECODE, 0);
+	perfRecord(PERF_PROBE_CODEC_DECODE, 1000);
+	perfRecord(PERF_PROBE_CODEC_DECODE, 1);
+	perfRecord(PERF_PROBE_CODEC_DECODE, 0xFFFFFFFF);
+
+	perfGetStats(PERF_PROBE_CODEC_DECODE, &stats);
+	TEST_CHECK(stats.count == 5);
+	TEST_CHECK(stats.min == 0);
+	TEST_CHECK(stats.max == 0xFFFFFFFF);
+	TEST_CHECK(stats.total == (5ULL + 1000ULL + 1ULL + 0xFFFFFFFFULL));
+
+	// [2^n, 2^(n+1)), bucket 0 also counts 0
+	TEST_CHECK(stats.buckets[0] == 2);
+	TEST_CHECK(stats.buckets[2] == 1);
+	TEST_CHECK(stats.buckets[9] == 1);
+	TEST_CHECK(stats.buckets[31] == 1);
+
+	uint32_t bucketsTotal = 0;
+	for (uint32_t b = 0; b < PERF_HISTOGRAM_BUCKETS; b++)
+	{
+		bucketsTotal += stats.buckets[b];
+	}
+	TEST_CHECK(bucketsTotal == stats.count);
+
+	// The minimum isn't stuck at 0 for a probe which never recorded 0
+	perfRecord(PERF_PROBE_HRC_SYS_IRQ, 300);
+	perfRecord(PERF_PROBE_HRC_SYS_IRQ, 200);
+	perfRecord(PERF_PROBE_HRC_SYS_IRQ, 400);
+	perfGetStats(PERF_PROBE_HRC_SYS_IRQ, &stats);
+	TEST_CHECK((stats.count == 3) && (stats.min == 200) && (stats.max == 400) && (stats.total == 900));
+
+	// The other probes are left alone
+	for (uint32_t p = 0; p < PERF_PROBE_MAX; p++)
+	{
+		if ((p != PERF_PROBE_CODEC_DECODE) && (p != PERF_PROBE_HRC_SYS_IRQ))
+		{
+			perfGetStats(p, &stats);
+			TEST_CHECK((stats.count == 0) && (stats.total == 0));
+		}
+	}
+
+	perfReset();
+	perfGetStats(PERF_PROBE_CODEC_DECODE, &stats);
+	TEST_CHECK((stats.count == 0) && (stats.max == 0) && (stats.buckets[0] == 0));
+}
+
+// Every probe needs a name for the USB dump, and the dump tells them apart by name
+static void testNames(void)
+{
+	for (uint32_t p = 0; p < PERF_PROBE_MAX; p++)
+	{
+		const char *name = perfGetName(p);
+
+		TEST_CHECK(name != NULL);
+		TEST_CHECK((strlen(name) > 0) && (strlen(name) <= PERF_NAME_LENGTH));
+
+		for (uint32_t q = 0; q < p; q++)
+		{
+			TEST_CHECK(strcmp(name, perfGetName(q)) != 0);
+		}
+	}
+}
+
+static uint64_t nanoseconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((ts.tv_sec * 1000000000ULL) + ts.tv_nsec);
+}
+
+// Busy, like the probed code: the scopes must not block, as the radio cycle counter stops in WFI
+static void probedSpin(uint32_t us)
+{
+	PERF_BEGIN(PERF_PROBE_HRC_SYS_IRQ);
+	const uint64_t end = (nanoseconds() + (us * 1000ULL));
+	while (nanoseconds() < end)
+	{
+	}
+	PERF_END(PERF_PROBE_HRC_SYS_IRQ);
+}
+
+static void testScopeDuration(void)
+{
+	perfProbeStats_t stats;
+	const uint32_t SPIN_US = 500;
+
+	perfReset();
+	probedSpin(SPIN_US);
+	perfGetStats(PERF_PROBE_HRC_SYS_IRQ, &stats);
+
+	uint64_t minimum = (((uint64_t)SPIN_US * perfGetCounterFrequency()) / 1000000U);
+
+	TEST_CHECK(stats.count == 1);
+	TEST_CHECK(stats.max >= minimum);
+	TEST_CHECK(stats.max < (minimum * 100U));
+}
+
+int main(void)
+{
+	TEST_RUN(testRecord);
+	TEST_RUN(testNames);
+	TEST_RUN(testScopeDuration);
+
+	return 0;
+}
@@ -0,0 +1,429 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+//
+// pocsag.c: the BCH(31,21) and parity of the codewords against a bit by bit encoder, the sync and idle codewords,
+// the address and message placement in the batches (decoded back by the test), the batch queue, and the bit
+// stream sent by the TIM6 ISR, then a benchmark.
+//
+#include <string.h>
+#include "testUtils.h"
+#include "main.h"
+#include "functions/pocsag.h"
+#include "hardware/radioHardwareInterface.h"
+
+#define MAX_BATCHES              4U
+#define BENCHMARK_CODEWORDS  1000000U
+
+TIM_HandleTypeDef htim6;
+TIM_TypeDef mockTIM6;
+
+static bool timerRunning;
+static bool symbolHigh;
+static uint32_t symbolChanges;
+
+bool radioFSKPrepare(uint32_t freq, uint32_t deviation, radioFSKConfig_t *config)
+{
+	return (deviation == POCSAG_DEVIATION);
+}
+
+void radioFSKSetSymbol(const radioFSKConfig_t *config, bool high)
+{
+	symbolHigh = high;
+	symbolChanges++;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim)
+{
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIMEx_MasterConfigSynchronization(TIM_HandleTypeDef *htim, TIM_MasterConfigTypeDef *sMasterConfig)
+{
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim)
+{
+	timerRunning = true;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef *htim)
+{
+	timerRunning = false;
+	return HAL_OK;
+}
+
+void Error_Handler(void)
+{
+	abort();
+}
+
+// Long division by the generator x^10+x^9+x^8+x^6+x^5+x^3+1, a bit at a time, then the even parity
+static uint32_t referenceCodeword(uint32_t data)
+{
+	uint32_t remainder = ((data & 0x1FFFFF) << 10);
+
+	for (int bit = 30; bit >= 10; bit--)
+	{
+		if (remainder & (1U << bit))
+		{
+			remainder ^= (0x769U << (bit - 10));
+		}
+	}
+
+	uint32_t codeword = (((data & 0x1FFFFF) << 11) | (remainder << 1));
+
+	return (codeword | (__builtin_popcount(codeword) & 0x01));
+}
+
+typedef struct
+{
+	int32_t  addressPos; // codeword index, -1 if none
+	uint32_t address;
+	uint8_t  function;
+	char     text[128];
+} decodedPage_t;
+
+// Decodes the batches as a pager would: the sync codeword starts each batch, then the address codeword and the
+// message codewords, whose 20 bits payloads are a bit stream of LSB first characters
+static bool decodePage(const uint32_t *batches, uint8_t count, bool isNumeric, decodedPage_t *page)
+{
+	static const char NUMERIC_CHARS[] = "0123456089*U -][";
+	uint32_t bits = 0;
+	uint8_t nbits = 0;
+	size_t len = 0;
+
+	memset(page, 0, sizeof(decodedPage_t));
+	page->addressPos = -1;
+
+	for (uint32_t i = 0; i < (count * POCSAG_BATCH_WORDS); i++)
+	{
+		uint32_t codeword = batches[i];
+
+		if ((i % POCSAG_BATCH_WORDS) == 0)
+		{
+			if (codeword != POCSAG_SYNC_CODEWORD)
+			{
+				return false;
+			}
+			continue;
+		}
+
+		if ((codeword == POCSAG_IDLE_CODEWORD) || (pocsagCodewordIsValid(codeword) == false) || (codeword != referenceCodeword(codeword >> 11)))
+		{
+			if (codeword != POCSAG_IDLE_CODEWORD)
+			{
+				return false;
+			}
+			continue;
+		}
+
+		if ((codeword & 0x80000000) == 0)
+		{
+			if (page->addressPos >= 0)
+			{
+				return false; // a single address per page
+			}
+
+			page->addressPos = i;
+			page->address = ((codeword >> 13) & 0x3FFFF);
+			page->function = ((codeword >> 11) & 0x03);
+			continue;
+		}
+
+		for (int b = 30; b >= 11; b--)
+		{
+			bits |= (((codeword >> b) & 0x01) << nbits);
+			nbits++;
+
+			if (nbits == (isNumeric ? 4 : 7))
+			{
+				if (len < (sizeof(page->text) - 1))
+				{
+					page->text[len++] = (isNumeric ? NUMERIC_CHARS[bits] : (char)bits);
+				}
+				bits = 0;
+				nbits = 0;
+			}
+		}
+	}
+
+	return true;
+}
+
+static void testKnownCodewords(void)
+{
+	// The sync and idle codewords are valid BCH codewords
+	TEST_CHECK(pocsagCodewordIsValid(POCSAG_SYNC_CODEWORD));
+	TEST_CHECK(pocsagCodewordIsValid(POCSAG_IDLE_CODEWORD));
+	TEST_CHECK(pocsagEncodeCodeword(POCSAG_SYNC_CODEWORD >> 11) == POCSAG_SYNC_CODEWORD);
+	TEST_CHECK(pocsagEncodeCodeword(POCSAG_IDLE_CODEWORD >> 11) == POCSAG_IDLE_CODEWORD);
+	TEST_CHECK(referenceCodeword(POCSAG_SYNC_CODEWORD >> 11) == POCSAG_SYNC_CODEWORD);
+	TEST_CHECK(referenceCodeword(POCSAG_IDLE_CODEWORD >> 11) == POCSAG_IDLE_CODEWORD);
+
+	TEST_CHECK(pocsagEncodeCodeword(0) == 0);
+}
+
+static void testCodewordsAgainstReference(void)
+{
+	uint32_t seed = 0x2468ACE1U;
+
+	// Every single bit data, then random data
+	for (int bit = 0; bit < 21; bit++)
+	{
+		TEST_CHECK(pocsagEncodeCodeword(1U << bit) == referenceCodeword(1U << bit));
+	}
+
+	for (uint32_t i = 0; i < 100000; i++)
+	{
+		uint32_t data = (testRandom(&seed) & 0x1FFFFF);
+		uint32_t codeword = pocsagEncodeCodeword(data);
+
+		TEST_CHECK(codeword == referenceCodeword(data));
+		TEST_CHECK((__builtin_popcount(codeword) & 0x01) == 0);
+		TEST_CHECK(pocsagCodewordIsValid(codeword));
+
+		// Any single bit error is detected
+		TEST_CHECK(pocsagCodewordIsValid(codeword ^ (1U << (i % 32))) == false);
+	}
+}
+
+static void testAddressPlacement(void)
+{
+	uint32_t batches[MAX_BATCHES * POCSAG_BATCH_WORDS];
+	decodedPage_t page;
+
+	// The address goes in the frame given by the 3 lower bits of the RIC, with the upper 18 bits and the function
+	for (uint32_t ric = 0; ric < 16; ric++)
+	{
+		uint32_t fullRic = ((ric * 0x1234U) + ric) & 0x1FFFFF;
+
+		for (int function = POCSAG_FUNCTION_NUMERIC; function <= POCSAG_FUNCTION_ALPHANUMERIC; function++)
+		{
+			bool tone = ((function == POCSAG_FUNCTION_TONE_1) || (function == POCSAG_FUNCTION_TONE_2));
+
+			TEST_CHECK(pocsagEncodeMessage(fullRic, function, (tone ? "ignored" : NULL), batches, MAX_BATCHES) == 1);
+			TEST_CHECK(decodePage(batches, MAX_BATCHES, true, &page));
+			TEST_CHECK(page.addressPos == (int32_t)(1 + ((fullRic & 0x07) * 2)));
+			TEST_CHECK(page.address == (fullRic >> 3));
+			TEST_CHECK(page.function == function);
+			TEST_CHECK(page.text[0] == 0);
+
+			// Everything else is idle, and the other batches are padding
+			for (uint32_t i = 0; i < (MAX_BATCHES * POCSAG_BATCH_WORDS); i++)
+			{
+				if (((i % POCSAG_BATCH_WORDS) != 0) && (i != (uint32_t)page.addressPos))
+				{
+					TEST_CHECK(batches[i] == POCSAG_IDLE_CODEWORD);
+				}
+			}
+		}
+	}
+
+	TEST_CHECK(pocsagEncodeMessage(0x1FFFFF, POCSAG_FUNCTION_TONE_1, NULL, batches, MAX_BATCHES) == 1);
+	TEST_CHECK(pocsagEncodeMessage(0x200000, POCSAG_FUNCTION_TONE_1, NULL, batches, MAX_BATCHES) == 0);
+	TEST_CHECK(pocsagEncodeMessage(1234, POCSAG_FUNCTION_TONE_1, NULL, batches, 0) == 0);
+}
+
+static void testMessages(void)
+{
+	uint32_t batches[MAX_BATCHES * POCSAG_BATCH_WORDS];
+	decodedPage_t page;
+
+	// Numeric, padded with spaces to the end of the last codeword (5 digits per codeword)
+	TEST_CHECK(pocsagEncodeMessage(1234560, POCSAG_FUNCTION_NUMERIC, "0123456089U -][", batches, MAX_BATCHES) == 1);
+	TEST_CHECK(decodePage(batches, MAX_BATCHES, true, &page));
+	TEST_CHECK(page.address == (1234560 >> 3));
+	TEST_CHECK(strcmp(page.text, "0123456089U -][") == 0);
+	TEST_CHECK(batches[page.addressPos + 1] != POCSAG_IDLE_CODEWORD);
+	TEST_CHECK(batches[page.addressPos + 3] != POCSAG_IDLE_CODEWORD);
+	TEST_CHECK(batches[page.addressPos + 4] == POCSAG_IDLE_CODEWORD);
+
+	TEST_CHECK(pocsagEncodeMessage(8, POCSAG_FUNCTION_NUMERIC, "12", batches, MAX_BATCHES) == 1);
+	TEST_CHECK(decodePage(batches, MAX_BATCHES, true, &page));
+	TEST_CHECK(strcmp(page.text, "12   ") == 0);
+
+	// Alphanumeric, the last codeword is zero padded (NUL characters)
+	TEST_CHECK(pocsagEncodeMessage(2000000, POCSAG_FUNCTION_ALPHANUMERIC, "Hello, World!", batches, MAX_BATCHES) == 1);
+	TEST_CHECK(decodePage(batches, MAX_BATCHES, false, &page));
+	TEST_CHECK(page.function == POCSAG_FUNCTION_ALPHANUMERIC);
+	TEST_CHECK(strcmp(page.text, "Hello, World!") == 0);
+
+	// Across batches: the sync codewords are skipped
+	const char *longMessage = "The quick brown fox jumps over the lazy dog, 0123456089 times.";
+	uint8_t count = pocsagEncodeMessage(7, POCSAG_FUNCTION_ALPHANUMERIC, longMessage, batches, MAX_BATCHES);
+	TEST_CHECK(count == 3); // 22 message codewords after the address in the last frame
+	TEST_CHECK(decodePage(batches, count, false, &page));
+	TEST_CHECK(page.addressPos == 15);
+	TEST_CHECK(strcmp(page.text, longMessage) == 0);
+	TEST_CHECK(batches[POCSAG_BATCH_WORDS] == POCSAG_SYNC_CODEWORD);
+
+	// Doesn't fit
+	TEST_CHECK(pocsagEncodeMessage(7, POCSAG_FUNCTION_ALPHANUMERIC, longMessage, batches, 2) == 0);
+}
+
+static void testQueue(void)
+{
+	uint32_t batch[POCSAG_BATCH_WORDS] = { 0 };
+
+	pocsagInit();
+	TEST_CHECK(pocsagGetQueueSpace() == (POCSAG_QUEUE_BATCHES - 1));
+
+	for (uint32_t i = 0; i < (POCSAG_QUEUE_BATCHES - 1); i++)
+	{
+		TEST_CHECK(pocsagQueueBatch(batch));
+		TEST_CHECK(pocsagGetQueueSpace() == (POCSAG_QUEUE_BATCHES - 2 - i));
+	}
+
+	TEST_CHECK(pocsagQueueBatch(batch) == false);
+}
+
+// Runs the ISR until the end of the transmission, the sent bit is the inverse of the FSK symbol (binary 1 is low)
+static uint32_t runTransmission(uint8_t *bits, uint32_t maxBits)
+{
+	uint32_t count = 0;
+
+	while ((pocsagTxProgress == POCSAG_TX_IN_PROGRESS) && (count < maxBits))
+	{
+		pocsagBitStreamSender();
+
+		if (pocsagTxProgress == POCSAG_TX_IN_PROGRESS)
+		{
+			bits[count++] = (symbolHigh ? 0 : 1);
+		}
+	}
+
+	return count;
+}
+
+static void testBitStream(void)
+{
+	uint32_t batches[MAX_BATCHES * POCSAG_BATCH_WORDS];
+	static uint8_t bits[POCSAG_PREAMBLE_BITS + (MAX_BATCHES * POCSAG_BATCH_WORDS * 32) + 1];
+
+	uint8_t count = pocsagEncodeMessage(7, POCSAG_FUNCTION_ALPHANUMERIC, "The quick brown fox jumps over the lazy dog, 0123456089 times.", batches, MAX_BATCHES);
+
+	pocsagInit();
+	for (uint8_t i = 0; i < count; i++)
+	{
+		TEST_CHECK(pocsagQueueBatch(&batches[i * POCSAG_BATCH_WORDS]));
+	}
+
+	symbolChanges = 0;
+	TEST_CHECK(pocsagTxStart(439000000, POCSAG_BAUDRATE_1200));
+	TEST_CHECK(timerRunning);
+	TEST_CHECK(htim6.Instance == TIM6);
+	TEST_CHECK(htim6.Init.Prescaler == 1);
+
+	uint32_t nbits = runTransmission(bits, sizeof(bits));
+
+	TEST_CHECK(pocsagTxProgress == POCSAG_TX_FINISHED);
+	TEST_CHECK(timerRunning == false);
+	TEST_CHECK(nbits == (POCSAG_PREAMBLE_BITS + (count * POCSAG_BATCH_WORDS * 32)));
+	TEST_CHECK(pocsagGetQueueSpace() == (POCSAG_QUEUE_BATCHES - 1));
+
+	// 1010... preamble
+	for (uint32_t i = 0; i < POCSAG_PREAMBLE_BITS; i++)
+	{
+		TEST_CHECK(bits[i] == ((i & 0x01) == 0));
+	}
+
+	// Then the codewords, MSB first
+	for (uint32_t w = 0; w < (count * POCSAG_BATCH_WORDS); w++)
+	{
+		uint32_t word = 0;
+
+		for (uint32_t b = 0; b < 32; b++)
+		{
+			word = (word << 1) | bits[POCSAG_PREAMBLE_BITS + (w * 32) + b];
+		}
+
+		TEST_CHECK(word == batches[w]);
+	}
+
+	// The synthesiser is only written on symbol changes
+	uint32_t changes = 1;
+	for (uint32_t i = 1; i < nbits; i++)
+	{
+		changes += (bits[i] != bits[i - 1]);
+	}
+	TEST_CHECK(symbolChanges == changes);
+
+	// Stopped in the middle: the remaining batches are kept
+	pocsagInit();
+	TEST_CHECK(pocsagQueueBatch(batches));
+	TEST_CHECK(pocsagTxStart(439000000, POCSAG_BAUDRATE_512));
+	TEST_CHECK(htim6.Init.Prescaler == 4);
+	TEST_CHECK(runTransmission(bits, (POCSAG_PREAMBLE_BITS + 10)) == (POCSAG_PREAMBLE_BITS + 10));
+	pocsagTxStop();
+	TEST_CHECK(timerRunning == false);
+	TEST_CHECK(pocsagTxProgress == POCSAG_TX_IDLE);
+	pocsagBitStreamSender();
+	TEST_CHECK(pocsagGetQueueSpace() == (POCSAG_QUEUE_BATCHES - 2));
+}
+
+static void benchmarkEncodeCodeword(void)
+{
+	uint32_t seed = 0x1F2E3D4CU;
+	uint32_t accumulator = 0;
+	uint64_t start = testGetNanoseconds();
+
+	for (uint32_t i = 0; i < BENCHMARK_CODEWORDS; i++)
+	{
+		accumulator ^= pocsagEncodeCodeword(testRandom(&seed) & 0x1FFFFF);
+	}
+
+	uint64_t tableElapsed = (testGetNanoseconds() - start);
+
+	seed = 0x1F2E3D4CU;
+	start = testGetNanoseconds();
+
+	for (uint32_t i = 0; i < BENCHMARK_CODEWORDS; i++)
+	{
+		accumulator ^= referenceCodeword(testRandom(&seed) & 0x1FFFFF);
+	}
+
+	uint64_t bitElapsed = (testGetNanoseconds() - start);
+
+	TEST_CHECK(accumulator == 0); // both encoded the same codewords
+	printf("benchmark: %u codewords, table %.1f ns, bit by bit %.1f ns per codeword\n",
+			BENCHMARK_CODEWORDS, ((double)tableElapsed / BENCHMARK_CODEWORDS), ((double)bitElapsed / BENCHMARK_CODEWORDS));
+}
+
+int main(void)
+{
+	TEST_RUN(testKnownCodewords);
+	TEST_RUN(testCodewordsAgainstReference);
+	TEST_RUN(testAddressPlacement);
+	TEST_RUN(testMessages);
+	TEST_RUN(testQueue);
+	TEST_RUN(testBitStream);
+	TEST_RUN(benchmarkEncodeCodeword);
+
+	return EXIT_SUCCESS;
+}
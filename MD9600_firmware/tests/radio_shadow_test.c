@@ -0,0 +1,774 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+//
+// Synthesiser and IF chip shadows (radioHardwareInterface.c), against simulated chips decoding the bit banged buses.
+//
+// The synthesisers and IF chips registers are rebuilt from the GPIO writes, and they lose them when their power
+// is cut: the main power control for the synthesisers, the receivers power (R5) for the IF chips, and the shared
+// reset line for both IF chips. Each synthesiser also remembers the VCO (Rx or Tx) selected when it was last
+// programmed, as that's what it locked on.
+// The shadowed sequences have to leave the synthesisers exactly as the full ones do, which are obtained by
+// invalidating the shadows before each call, while sending fewer words. A full IF sequence resets both IF chips, so
+// instead, the IF chip of the band has to hold the expected registers after each radioSetIF().
+//
+// Built for the SKY synthesiser (V1-V3), radio_shadow_v4_test.c and radio_shadow_v5_test.c for the other ones.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "testUtils.h"
+#include "main.h"
+#include "functions/settings.h"
+#include "functions/trx.h"
+#include "hardware/radioHardwareInterface.h"
+
+#if defined(MD9600_VERSION_5)
+#define SYNTH_WORD_BITS           24U
+#define SYNTH_FULL_WORDS          14U // reset, 11 registers, calibrate and run
+#elif defined(MD9600_VERSION_4)
+#define SYNTH_WORD_BITS           24U
+#define SYNTH_FULL_WORDS           6U
+#else
+#define SYNTH_WORD_BITS           16U
+#define SYNTH_FULL_WORDS           8U
+#endif
+#define IF_FULL_WORDS              6U
+#define IF_REGISTERS_NUM          16U
+
+#define REG_UNKNOWN       0xFFFFFFFFU
+#define RANDOM_STEPS           20000U
+
+// Frequencies are in 10 Hz units, radioSetFrequency() splits the bands at 349 MHz. The receivers LO is 49.95 MHz
+// away, so depending on the synthesiser, the last two Tx frequencies can program the same registers as the Rx of
+// CHANNELS[0] and CHANNELS[4]: only the VCO differs.
+static const uint32_t CHANNELS[] = { 14450000, 14500000, 14652500, 14400000, 43500000, 43900000, 44600625, 43862500, 19445000, 38505000 };
+#define TX_SAME_AS_RX_VHF   CHANNELS[8]
+
+typedef struct
+{
+	bool     selected;
+	uint32_t word;
+	uint32_t bitCount;
+	uint32_t regs[RADIO_SYNTH_REGISTERS_NUM];
+	bool     lockedTx; // VCO selected when last programmed
+	uint32_t words;
+} synthSim_t;
+
+typedef struct
+{
+	bool     selected;
+	uint32_t word;
+	uint32_t bitCount;
+	uint32_t regs[IF_REGISTERS_NUM];
+	uint32_t words;
+	uint32_t resets;
+} ifSim_t;
+
+typedef struct
+{
+	synthSim_t synth[RADIO_SHADOW_BANDS_NUM];
+	ifSim_t    ifChip[RADIO_SHADOW_BANDS_NUM];
+	bool       powered;
+	bool       receiversPowered[RADIO_SHADOW_BANDS_NUM];
+	bool       ifReset;
+	bool       vcoTx[RADIO_SHADOW_BANDS_NUM];
+	bool       pllData;
+	bool       pllClock;
+	bool       ifData;
+	bool       ifClock;
+} radioSim_t;
+
+// What the synthesisers hold after a step, compared between the shadowed and the full runs
+typedef struct
+{
+	uint32_t synthRegs[RADIO_SHADOW_BANDS_NUM][RADIO_SYNTH_REGISTERS_NUM];
+	bool     synthLockedTx[RADIO_SHADOW_BANDS_NUM];
+} radioState_t;
+
+static radioSim_t sim;
+
+GPIO_TypeDef mockGPIOA;
+GPIO_TypeDef mockGPIOB;
+GPIO_TypeDef mockGPIOC;
+GPIO_TypeDef mockGPIOD;
+GPIO_TypeDef mockGPIOE;
+TIM_HandleTypeDef htim4;
+volatile bool trxIsTransmitting;
+volatile uint8_t trxTxVox;
+volatile uint8_t trxTxMic;
+volatile bool trxDMRSynchronisedRSSIReadPending;
+volatile uint16_t txDACDrivePower;
+volatile uint16_t VHFRxTuningVolts;
+volatile uint16_t UHFRxTuningVolts;
+
+static void synthClear(synthSim_t *synth)
+{
+	for (uint32_t r = 0; r < RADIO_SYNTH_REGISTERS_NUM; r++)
+	{
+		synth->regs[r] = REG_UNKNOWN;
+	}
+	synth->lockedTx = false;
+}
+
+static void ifClear(ifSim_t *ifChip)
+{
+	for (uint32_t r = 0; r < IF_REGISTERS_NUM; r++)
+	{
+		ifChip->regs[r] = REG_UNKNOWN;
+	}
+}
+
+static void simInit(void)
+{
+	memset(&sim, 0, sizeof(sim));
+
+	for (uint32_t b = 0; b < RADIO_SHADOW_BANDS_NUM; b++)
+	{
+		synthClear(&sim.synth[b]);
+		ifClear(&sim.ifChip[b]);
+	}
+}
+
+static void synthWordReceived(synthSim_t *synth, bool vcoTx)
+{
+	uint32_t add;
+	uint32_t value;
+
+#if defined(MD9600_VERSION_5)
+	add = (synth->word >> 16);
+	value = (synth->word & 0xFFFF);
+#elif defined(MD9600_VERSION_4)
+	add = (synth->word & 0x0F);
+	value = (synth->word >> 4);
+#else
+	add = (synth->word >> 12);
+	value = (synth->word & 0x0FFF);
+#endif
+
+	TEST_CHECK(synth->bitCount == SYNTH_WORD_BITS);
+	TEST_CHECK(add < RADIO_SYNTH_REGISTERS_NUM);
+
+	synth->words++;
+	if (sim.powered)
+	{
+		synth->regs[add] = value;
+		synth->lockedTx = vcoTx;
+	}
+}
+
+#if !defined(MD9600_VERSION_5)
+// AK2365A: 7 bits of address, 9 bits of data
+static void ifWordReceived(uint32_t band)
+{
+	ifSim_t *ifChip = &sim.ifChip[band];
+
+	TEST_CHECK(ifChip->bitCount == 16);
+
+	ifChip->words++;
+	if (sim.receiversPowered[band] && (sim.ifReset == false))
+	{
+		ifChip->regs[ifChip->word >> 9] = (ifChip->word & 0x1FF);
+	}
+}
+#endif
+
+static void chipSelect(bool *selected, uint32_t *word, uint32_t *bitCount, bool level)
+{
+	*selected = (level == false);
+	*word = 0;
+	*bitCount = 0;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state)
+{
+	bool level = (state != GPIO_PIN_RESET);
+
+	if ((port == Power_Control_GPIO_Port) && (pin == Power_Control_Pin))
+	{
+		if (level == false)
+		{
+			synthClear(&sim.synth[RADIO_BAND_VHF]);
+			synthClear(&sim.synth[RADIO_BAND_UHF]);
+		}
+		sim.powered = level;
+	}
+	else if ((port == R5_V_SW_GPIO_Port) && (pin == R5_V_SW_Pin))
+	{
+		if (level == false)
+		{
+			ifClear(&sim.ifChip[RADIO_BAND_VHF]);
+		}
+		sim.receiversPowered[RADIO_BAND_VHF] = level;
+	}
+	else if ((port == R5_U_SW_GPIO_Port) && (pin == R5_U_SW_Pin))
+	{
+		if (level == false)
+		{
+			ifClear(&sim.ifChip[RADIO_BAND_UHF]);
+		}
+		sim.receiversPowered[RADIO_BAND_UHF] = level;
+	}
+	else if ((port == VCO_VCC_V_SW_GPIO_Port) && (pin == VCO_VCC_V_SW_Pin))
+	{
+		sim.vcoTx[RADIO_BAND_VHF] = (level == false);
+	}
+	else if ((port == VCO_VCC_U_SW_GPIO_Port) && (pin == VCO_VCC_U_SW_Pin))
+	{
+		sim.vcoTx[RADIO_BAND_UHF] = (level == false);
+	}
+	else if ((port == PLL_CS_V_GPIO_Port) && (pin == PLL_CS_V_Pin))
+	{
+		synthSim_t *synth = &sim.synth[RADIO_BAND_VHF];
+
+		if (level && synth->selected)
+		{
+			synthWordReceived(synth, sim.vcoTx[RADIO_BAND_VHF]);
+		}
+		chipSelect(&synth->selected, &synth->word, &synth->bitCount, level);
+	}
+	else if ((port == PLL_CS_U_GPIO_Port) && (pin == PLL_CS_U_Pin))
+	{
+		synthSim_t *synth = &sim.synth[RADIO_BAND_UHF];
+
+		if (level && synth->selected)
+		{
+			synthWordReceived(synth, sim.vcoTx[RADIO_BAND_UHF]);
+		}
+		chipSelect(&synth->selected, &synth->word, &synth->bitCount, level);
+	}
+	else if ((port == PLL_DATA_GPIO_Port) && (pin == PLL_DATA_Pin))
+	{
+		sim.pllData = level;
+	}
+	else if ((port == PLL_CLK_GPIO_Port) && (pin == PLL_CLK_Pin))
+	{
+		// Sampled on the rising edge
+		if (level && (sim.pllClock == false))
+		{
+			for (uint32_t b = 0; b < RADIO_SHADOW_BANDS_NUM; b++)
+			{
+				if (sim.synth[b].selected)
+				{
+					sim.synth[b].word = ((sim.synth[b].word << 1) | sim.pllData);
+					sim.synth[b].bitCount++;
+				}
+			}
+		}
+		sim.pllClock = level;
+	}
+#if !defined(MD9600_VERSION_5) // these pins select the IF bandwidths on the V5
+	else if ((port == IF_RST_GPIO_Port) && (pin == IF_RST_Pin))
+	{
+		// Shared by both IF chips, active low
+		if (level == false)
+		{
+			ifClear(&sim.ifChip[RADIO_BAND_VHF]);
+			ifClear(&sim.ifChip[RADIO_BAND_UHF]);
+			sim.ifChip[RADIO_BAND_VHF].resets++;
+			sim.ifChip[RADIO_BAND_UHF].resets++;
+		}
+		sim.ifReset = (level == false);
+	}
+	else if ((port == IF_CS_V_GPIO_Port) && (pin == IF_CS_V_Pin))
+	{
+		ifSim_t *ifChip = &sim.ifChip[RADIO_BAND_VHF];
+
+		if (level && ifChip->selected)
+		{
+			ifWordReceived(RADIO_BAND_VHF);
+		}
+		chipSelect(&ifChip->selected, &ifChip->word, &ifChip->bitCount, level);
+	}
+	else if ((port == IF_CS_U_GPIO_Port) && (pin == IF_CS_U_Pin))
+	{
+		ifSim_t *ifChip = &sim.ifChip[RADIO_BAND_UHF];
+
+		if (level && ifChip->selected)
+		{
+			ifWordReceived(RADIO_BAND_UHF);
+		}
+		chipSelect(&ifChip->selected, &ifChip->word, &ifChip->bitCount, level);
+	}
+	else if ((port == IF_DATA_GPIO_Port) && (pin == IF_DATA_Pin))
+	{
+		sim.ifData = level;
+	}
+	else if ((port == IF_CLK_GPIO_Port) && (pin == IF_CLK_Pin))
+	{
+		if (level && (sim.ifClock == false))
+		{
+			for (uint32_t b = 0; b < RADIO_SHADOW_BANDS_NUM; b++)
+			{
+				if (sim.ifChip[b].selected)
+				{
+					sim.ifChip[b].word = ((sim.ifChip[b].word << 1) | sim.ifData);
+					sim.ifChip[b].bitCount++;
+				}
+			}
+		}
+		sim.ifClock = level;
+	}
+#endif
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t channel) { return HAL_OK; }
+HAL_StatusTypeDef HAL_TIM_PWM_Stop(TIM_HandleTypeDef *htim, uint32_t channel) { return HAL_OK; }
+HAL_StatusTypeDef HAL_TIM_PWM_ConfigChannel(TIM_HandleTypeDef *htim, TIM_OC_InitTypeDef *sConfig, uint32_t channel) { return HAL_OK; }
+void dacOut(int channel, uint16_t val) { }
+int adcGetVOX(void) { return 0; }
+int adcGetVHFRSSI(void) { return 0; }
+int adcGetUHFRSSI(void) { return 0; }
+int adcGetVHFNoise(void) { return 0; }
+int adcGetUHFNoise(void) { return 0; }
+int trxGetMode(void) { return RADIO_MODE_ANALOG; }
+uint32_t trxGetFrequency(void) { return CHANNELS[0]; }
+void trxInvalidateCurrentFrequency(void) { }
+bool settingsIsOptionBitSet(bitfieldOptions_t bit) { return false; }
+void HRC6000SetMicGainFM(uint8_t gain) { }
+void HRC6000SetFMTx(void) { }
+void HRC6000SetFMRx(void) { }
+void HRC6000SetDMR(void) { }
+void HRC6000SetTxCTCSS(uint8_t index) { }
+void HRC6000SetTxDCS(uint16_t code, bool inverted) { }
+void HRC6000SetRxCTCSS(uint8_t index) { }
+void HRC6000SetRxDCS(uint16_t code, bool inverted) { }
+bool HRC6000CheckCSS(void) { return false; }
+void HRC6000SetLineOut(bool isOn) { }
+void HRC6000SendTone(int tonefreq) { }
+
+static uint32_t bandOf(uint32_t freq)
+{
+	return ((freq < 34900000) ? RADIO_BAND_VHF : RADIO_BAND_UHF);
+}
+
+static uint32_t synthWords(void)
+{
+	return (sim.synth[RADIO_BAND_VHF].words + sim.synth[RADIO_BAND_UHF].words);
+}
+
+static uint32_t ifWords(void)
+{
+	return (sim.ifChip[RADIO_BAND_VHF].words + sim.ifChip[RADIO_BAND_UHF].words);
+}
+
+static void stateGet(radioState_t *state)
+{
+	memset(state, 0, sizeof(radioState_t));
+
+	for (uint32_t b = 0; b < RADIO_SHADOW_BANDS_NUM; b++)
+	{
+		memcpy(state->synthRegs[b], sim.synth[b].regs, sizeof(state->synthRegs[b]));
+		state->synthLockedTx[b] = sim.synth[b].lockedTx;
+	}
+}
+
+static void radioStart(void)
+{
+	simInit();
+	radioShadowInvalidate();
+	radioPowerOn();
+	radioSetRx(RADIO_BAND_VHF);
+}
+
+// Synthesiser registers programmed, for this VCO
+static void checkSynthProgrammed(uint32_t freq, bool Tx)
+{
+	const synthSim_t *synth = &sim.synth[bandOf(freq)];
+	uint32_t programmed = 0;
+
+	for (uint32_t r = 0; r < RADIO_SYNTH_REGISTERS_NUM; r++)
+	{
+		programmed += (synth->regs[r] != REG_UNKNOWN);
+	}
+
+	TEST_CHECK(programmed > 0);
+	TEST_CHECK(synth->lockedTx == Tx);
+}
+
+static void testSynthSkip(void)
+{
+	uint32_t before;
+
+	radioStart();
+
+	// Unknown state: the whole sequence (radioPowerOn() already programs the VHF synthesiser of the V4 radios)
+	radioShadowInvalidate();
+	before = synthWords();
+	radioSetFrequency(CHANNELS[0], false);
+	TEST_CHECK((synthWords() - before) == SYNTH_FULL_WORDS);
+	checkSynthProgrammed(CHANNELS[0], false);
+
+	// Nothing changed: nothing sent
+	before = synthWords();
+	uint32_t skipped = radioGetShadow()->synthSkipped;
+	radioSetFrequency(CHANNELS[0], false);
+	TEST_CHECK(synthWords() == before);
+	TEST_CHECK(radioGetShadow()->synthSkipped > skipped);
+
+	// Same registers for the other VCO, the synthesiser has to lock again
+	radioState_t rxState;
+	radioState_t txState;
+
+	stateGet(&rxState);
+	radioSetFrequency(TX_SAME_AS_RX_VHF, true);
+	stateGet(&txState);
+	TEST_CHECK(memcmp(rxState.synthRegs, txState.synthRegs, sizeof(rxState.synthRegs)) == 0);
+	TEST_CHECK(synthWords() > before);
+	checkSynthProgrammed(TX_SAME_AS_RX_VHF, true);
+	before = synthWords();
+	radioSetFrequency(CHANNELS[0], false);
+	TEST_CHECK(synthWords() > before);
+	checkSynthProgrammed(CHANNELS[0], false);
+
+	// The other band's synthesiser is left alone, and still holds its state afterwards
+	radioSetFrequency(CHANNELS[0], false);
+	before = sim.synth[RADIO_BAND_VHF].words;
+	radioSetFrequency(CHANNELS[4], false);
+	TEST_CHECK(sim.synth[RADIO_BAND_VHF].words == before);
+	checkSynthProgrammed(CHANNELS[4], false);
+	before = synthWords();
+	radioSetFrequency(CHANNELS[0], false);
+	TEST_CHECK(synthWords() == before);
+
+#if !defined(MD9600_VERSION_5)
+	// Only the frequency registers follow a channel change in the same band and direction,
+	// the fixed ones (and the reference divider, the same for both) are skipped
+	before = synthWords();
+	radioSetFrequency(CHANNELS[1], false);
+	TEST_CHECK((synthWords() - before) < SYNTH_FULL_WORDS);
+	TEST_CHECK((synthWords() - before) > 0);
+#else
+	// The TI synthesiser needs its reset and calibration sequence for any change
+	before = synthWords();
+	radioSetFrequency(CHANNELS[1], false);
+	TEST_CHECK((synthWords() - before) == SYNTH_FULL_WORDS);
+#endif
+}
+
+static void testSynthInvalidation(void)
+{
+	uint32_t before;
+
+	radioStart();
+	radioSetFrequency(CHANNELS[4], false);
+
+	// The power cut loses the synthesisers registers
+	radioPowerOff();
+	radioPowerOn();
+	before = synthWords();
+	radioSetFrequency(CHANNELS[4], false);
+	TEST_CHECK((synthWords() - before) == SYNTH_FULL_WORDS);
+	checkSynthProgrammed(CHANNELS[4], false);
+
+	// Explicit invalidation
+	radioShadowInvalidate();
+	before = synthWords();
+	radioSetFrequency(CHANNELS[4], false);
+	TEST_CHECK((synthWords() - before) == SYNTH_FULL_WORDS);
+
+	// radioSetTx() doesn't touch the synthesisers: the Tx frequency was already programmed
+	radioSetFrequency(CHANNELS[4], true);
+	before = synthWords();
+	radioSetTx(RADIO_BAND_UHF);
+	radioSetFrequency(CHANNELS[4], true);
+	TEST_CHECK(synthWords() == before);
+	radioSetRx(RADIO_BAND_UHF);
+	radioSetFrequency(CHANNELS[4], false);
+	TEST_CHECK(synthWords() > before);
+	checkSynthProgrammed(CHANNELS[4], false);
+}
+
+#if defined(MD9600_VERSION_5)
+// The FSK symbols are written behind the shadow's back, through SynthTransfer() which keeps it up to date
+static void testSynthFSK(void)
+{
+	radioFSKConfig_t config;
+	radioState_t expected;
+	radioState_t actual;
+	uint32_t before;
+
+	radioStart();
+	radioSetFrequency(CHANNELS[5], true);
+	stateGet(&expected);
+
+	TEST_CHECK(radioFSKPrepare(CHANNELS[5], 450, &config));
+	radioFSKSetSymbol(&config, true);
+	radioFSKSetSymbol(&config, false);
+
+	before = synthWords();
+	radioSetFrequency(CHANNELS[5], true);
+	TEST_CHECK((synthWords() - before) == SYNTH_FULL_WORDS);
+	stateGet(&actual);
+	TEST_CHECK(memcmp(expected.synthRegs, actual.synthRegs, sizeof(expected.synthRegs)) == 0);
+}
+#endif
+
+#if !defined(MD9600_VERSION_5)
+static void checkIFProgrammed(uint32_t band, bool wide)
+{
+	const ifSim_t *ifChip = &sim.ifChip[band];
+
+	TEST_CHECK(ifChip->regs[1] == (wide ? 0x0F1 : 0x0E9));
+	TEST_CHECK(ifChip->regs[2] == 0x01D);
+	TEST_CHECK(ifChip->regs[3] == 0x000);
+	TEST_CHECK(ifChip->regs[0x0B] == 0x001);
+	TEST_CHECK(ifChip->regs[0x0C] == 0x080);
+}
+
+static void testIFSkip(void)
+{
+	uint32_t before;
+
+	radioStart();
+
+	radioSetIF(RADIO_BAND_VHF, true);
+	checkIFProgrammed(RADIO_BAND_VHF, true);
+	TEST_CHECK(ifWords() == IF_FULL_WORDS);
+
+	// Same bandwidth: no reset, nothing sent
+	before = sim.ifChip[RADIO_BAND_VHF].resets;
+	uint32_t skipped = radioGetShadow()->ifSkipped;
+	radioSetIF(RADIO_BAND_VHF, true);
+	TEST_CHECK(ifWords() == IF_FULL_WORDS);
+	TEST_CHECK(sim.ifChip[RADIO_BAND_VHF].resets == before);
+	TEST_CHECK(radioGetShadow()->ifSkipped == (skipped + 1));
+
+	// Bandwidth change
+	radioSetIF(RADIO_BAND_VHF, false);
+	checkIFProgrammed(RADIO_BAND_VHF, false);
+	TEST_CHECK(ifWords() == (2 * IF_FULL_WORDS));
+}
+
+static void testIFInvalidation(void)
+{
+	uint32_t before;
+
+	radioStart();
+
+	// The reset line is shared: programming the UHF chip resets the VHF one, which has to be programmed again
+	radioSetIF(RADIO_BAND_VHF, true);
+	radioSetIF(RADIO_BAND_UHF, true);
+	checkIFProgrammed(RADIO_BAND_UHF, true);
+	before = ifWords();
+	radioSetIF(RADIO_BAND_VHF, true);
+	TEST_CHECK((ifWords() - before) == IF_FULL_WORDS);
+	checkIFProgrammed(RADIO_BAND_VHF, true);
+
+	// radioSetTx() cuts the receivers power, the IF chips lose their registers
+	radioSetTx(RADIO_BAND_VHF);
+	radioSetRx(RADIO_BAND_VHF);
+	before = ifWords();
+	radioSetIF(RADIO_BAND_VHF, true);
+	TEST_CHECK((ifWords() - before) == IF_FULL_WORDS);
+	checkIFProgrammed(RADIO_BAND_VHF, true);
+
+	// Programmed while transmitting, the receivers being off: lost, so it has to be sent again once back on Rx
+	radioSetTx(RADIO_BAND_VHF);
+	radioSetIF(RADIO_BAND_VHF, true);
+	radioSetRx(RADIO_BAND_VHF);
+	before = ifWords();
+	radioSetIF(RADIO_BAND_VHF, true);
+	TEST_CHECK((ifWords() - before) == IF_FULL_WORDS);
+	checkIFProgrammed(RADIO_BAND_VHF, true);
+
+	// radioFastTx() leaves the receivers on
+	radioFastTx(true);
+	radioFastTx(false);
+	before = ifWords();
+	radioSetIF(RADIO_BAND_VHF, true);
+	TEST_CHECK(ifWords() == before);
+
+	// Power cycle
+	radioPowerOff();
+	radioPowerOn();
+	radioSetRx(RADIO_BAND_VHF);
+	before = ifWords();
+	radioSetIF(RADIO_BAND_VHF, true);
+	TEST_CHECK((ifWords() - before) == IF_FULL_WORDS);
+	checkIFProgrammed(RADIO_BAND_VHF, true);
+
+	// Explicit invalidation
+	radioShadowInvalidate();
+	before = ifWords();
+	radioSetIF(RADIO_BAND_VHF, true);
+	TEST_CHECK((ifWords() - before) == IF_FULL_WORDS);
+}
+#endif
+
+typedef enum
+{
+	STEP_FREQUENCY = 0,
+	STEP_IF,
+	STEP_TX,
+	STEP_RX,
+	STEP_FAST_TX,
+	STEP_POWER_CYCLE,
+	STEP_MAX
+} stepType_t;
+
+// One random step, the shadows being invalidated before each chip programming on the full run
+static void randomStep(uint32_t *seed, bool full)
+{
+	uint32_t r = testRandom(seed);
+	uint32_t type = (r % 64);
+	uint32_t freq = CHANNELS[(r >> 8) % ARRAY_SIZE(CHANNELS)];
+	bool Tx = ((r >> 16) & 1);
+	bool wide = ((r >> 17) & 1);
+	uint32_t band = ((r >> 18) & 1);
+
+	if (type < 36)
+	{
+		type = STEP_FREQUENCY;
+	}
+	else if (type < 52)
+	{
+		type = STEP_IF;
+	}
+	else
+	{
+		type = (STEP_TX + (type % (STEP_MAX - STEP_TX)));
+	}
+
+	if (full && ((type == STEP_FREQUENCY) || (type == STEP_IF)))
+	{
+		radioShadowInvalidate();
+	}
+
+	switch (type)
+	{
+		case STEP_FREQUENCY:
+			radioSetFrequency(freq, Tx);
+			break;
+		case STEP_IF:
+			radioSetIF(band, wide);
+#if !defined(MD9600_VERSION_5)
+			if (sim.receiversPowered[band])
+			{
+				checkIFProgrammed(band, wide);
+			}
+#endif
+			break;
+		case STEP_TX:
+			radioSetTx(band);
+			break;
+		case STEP_RX:
+			radioSetRx(band);
+			break;
+		case STEP_FAST_TX:
+			radioFastTx(Tx);
+			break;
+		case STEP_POWER_CYCLE:
+			radioPowerOff();
+			radioPowerOn();
+			radioSetRx(band);
+			break;
+	}
+}
+
+// The shadowed run has to leave the synthesisers in the same state as the full one after every step
+static void testRandomAgainstFull(void)
+{
+	radioState_t *states = malloc(RANDOM_STEPS * sizeof(radioState_t));
+	uint32_t seed;
+	uint32_t fullSynthWords;
+	uint32_t fullIFWords;
+
+	TEST_CHECK(states != NULL);
+
+	seed = 0x5EED0045;
+	radioStart();
+	for (uint32_t step = 0; step < RANDOM_STEPS; step++)
+	{
+		randomStep(&seed, true);
+		stateGet(&states[step]);
+	}
+	fullSynthWords = synthWords();
+	fullIFWords = ifWords();
+
+	seed = 0x5EED0045;
+	radioStart();
+	for (uint32_t step = 0; step < RANDOM_STEPS; step++)
+	{
+		radioState_t state;
+
+		randomStep(&seed, false);
+		stateGet(&state);
+		TEST_CHECK(memcmp(&state, &states[step], sizeof(radioState_t)) == 0);
+	}
+
+	TEST_CHECK(synthWords() < fullSynthWords);
+	TEST_CHECK(ifWords() <= fullIFWords);
+	printf("  %u random steps: synthesiser words %u -> %u, IF words %u -> %u\n", RANDOM_STEPS, fullSynthWords, synthWords(), fullIFWords, ifWords());
+
+	free(states);
+}
+
+// A zone scan over the channels of one band, on the same bandwidth: bus traffic with and without the shadows
+static void benchmarkScan(void)
+{
+	const uint32_t SCAN_ROUNDS = 16;
+	uint32_t words[2][2];
+
+	for (uint32_t full = 0; full < 2; full++)
+	{
+		radioStart();
+
+		for (uint32_t round = 0; round < SCAN_ROUNDS; round++)
+		{
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				if (full)
+				{
+					radioShadowInvalidate();
+				}
+				radioSetIF(RADIO_BAND_VHF, true);
+				radioSetFrequency(CHANNELS[c], false);
+			}
+		}
+
+		words[full][0] = synthWords();
+		words[full][1] = ifWords();
+	}
+
+	printf("  scan of %u channels: synthesiser words %u -> %u, IF words %u -> %u\n", (SCAN_ROUNDS * 4), words[1][0], words[0][0], words[1][1], words[0][1]);
+}
+
+int main(void)
+{
+	TEST_RUN(testSynthSkip);
+	TEST_RUN(testSynthInvalidation);
+#if defined(MD9600_VERSION_5)
+	TEST_RUN(testSynthFSK);
+#else
+	TEST_RUN(testIFSkip);
+	TEST_RUN(testIFInvalidation);
+#endif
+	TEST_RUN(testRandomAgainstFull);
+	TEST_RUN(benchmarkScan);
+
+	return 0;
+}
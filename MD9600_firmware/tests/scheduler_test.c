@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+//
+// scheduler.c against a virtual clock.
+//
+// The task notification is faked: ulTaskNotifyTake() moves the millisecond clock forward, up to its timeout or to the
+// time of the next simulated interrupt, which posts its events the way the USB and rotary encoder ISRs do.
+//
+#include <string.h>
+#include "testUtils.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "functions/scheduler.h"
+
+#define IDLE_SCAN_PERIOD       10U // ms, same as the keyboard scan period while nothing is pressed
+
+int mockCriticalNesting;
+
+static struct
+{
+	uint32_t millis;
+	uint32_t notifications; // pending notification count
+	uint32_t takes;         // ulTaskNotifyTake() calls, i.e. the times the task blocked
+	uint32_t lastTimeout;
+	bool     isrPending;
+	uint32_t isrTime;
+	uint32_t isrEvents;
+} virtualTask;
+
+static int taskHandle;
+
+uint32_t ticksGetMillis(void)
+{
+	return virtualTask.millis;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+	return &taskHandle;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+	TEST_CHECK(task == &taskHandle);
+	virtualTask.notifications++;
+
+	return pdTRUE;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higherPriorityTaskWoken)
+{
+	TEST_CHECK(task == &taskHandle);
+	virtualTask.notifications++;
+	*higherPriorityTaskWoken = pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait)
+{
+	uint32_t notifications;
+
+	TEST_CHECK(clearCountOnExit == pdTRUE);
+	TEST_CHECK(mockCriticalNesting == 0);
+
+	virtualTask.takes++;
+	virtualTask.lastTimeout = ticksToWait;
+
+	if ((virtualTask.notifications == 0) && virtualTask.isrPending && ((virtualTask.isrTime - virtualTask.millis) <= ticksToWait))
+	{
+		virtualTask.millis = virtualTask.isrTime;
+		virtualTask.isrPending = false;
+		schedulerPostEventFromISR(virtualTask.isrEvents);
+	}
+
+	if (virtualTask.notifications == 0)
+	{
+		virtualTask.millis += ticksToWait;
+		return 0;
+	}
+
+	notifications = virtualTask.notifications;
+	virtualTask.notifications = 0;
+
+	return notifications;
+}
+
+static void virtualTaskReset(uint32_t millis)
+{
+	memset(&virtualTask, 0, sizeof(virtualTask));
+	virtualTask.millis = millis;
+	schedulerInit();
+}
+
+static void isrPostAt(uint32_t time, uint32_t events)
+{
+	virtualTask.isrPending = true;
+	virtualTask.isrTime = time;
+	virtualTask.isrEvents = events;
+}
+
+// Main loop pass model: one client is due every ms while everyPass is set, the keyboard scan otherwise.
+// Returns the number of passes run during duration ms.
+static uint32_t runLoop(uint32_t duration, bool everyPass)
+{
+	uint32_t end = (virtualTask.millis + duration);
+	uint32_t passes = 0;
+
+	while ((int32_t)(end - virtualTask.millis) > 0)
+	{
+		uint32_t startTime = virtualTask.millis;
+
+		passes++;
+
+		if (everyPass)
+		{
+			schedulerSetDeadline(SCHEDULER_CLIENT_MAIN_LOOP, (startTime + 1));
+		}
+		else
+		{
+			schedulerClearDeadline(SCHEDULER_CLIENT_MAIN_LOOP);
+		}
+
+		schedulerSetDeadline(SCHEDULER_CLIENT_KEYBOARD, (startTime + IDLE_SCAN_PERIOD));
+
+		while (schedulerIsAnyDue(virtualTask.millis) == false)
+		{
+			if (schedulerWait() & SCHEDULER_EVENT_INPUT)
+			{
+				break;
+			}
+		}
+	}
+
+	return passes;
+}
+
+static void testNoDeadlineWaitsTheMaximum(void)
+{
+	virtualTaskReset(1000);
+
+	TEST_CHECK(schedulerGetTimeout(1000) == SCHEDULER_WAIT_MAX);
+	TEST_CHECK(schedulerIsAnyDue(1000) == false);
+	TEST_CHECK(schedulerIsDue(SCHEDULER_CLIENT_MAIN_LOOP, 1000) == false);
+
+	TEST_CHECK(schedulerWait() == 0);
+	TEST_CHECK(virtualTask.takes == 1);
+	TEST_CHECK(virtualTask.lastTimeout == SCHEDULER_WAIT_MAX);
+	TEST_CHECK(virtualTask.millis == (1000 + SCHEDULER_WAIT_MAX));
+}
+
+static void testEarliestDeadlineWins(void)
+{
+	virtualTaskReset(1000);
+
+	schedulerSetDeadline(SCHEDULER_CLIENT_KEYBOARD, 1010);
+	schedulerSetDeadline(SCHEDULER_CLIENT_TICKS_CALLBACKS, 1035);
+	schedulerSetDeadline(SCHEDULER_CLIENT_DISPLAY, 1004);
+	TEST_CHECK(schedulerGetTimeout(1000) == 4);
+
+	TEST_CHECK(schedulerWait() == 0);
+	TEST_CHECK(virtualTask.millis == 1004);
+	TEST_CHECK(schedulerIsDue(SCHEDULER_CLIENT_DISPLAY, 1004));
+	TEST_CHECK(schedulerIsDue(SCHEDULER_CLIENT_KEYBOARD, 1004) == false);
+	TEST_CHECK(schedulerIsAnyDue(1004));
+
+	// Due: no blocking at all
+	TEST_CHECK(schedulerWait() == 0);
+	TEST_CHECK(virtualTask.takes == 1);
+
+	schedulerClearDeadline(SCHEDULER_CLIENT_DISPLAY);
+	TEST_CHECK(schedulerIsDue(SCHEDULER_CLIENT_DISPLAY, 1004) == false);
+	TEST_CHECK(schedulerGetTimeout(1004) == 6);
+
+	// A deadline further than the maximum is reached in several waits
+	schedulerClearDeadline(SCHEDULER_CLIENT_KEYBOARD);
+	schedulerSetDeadline(SCHEDULER_CLIENT_TICKS_CALLBACKS, 1304);
+	while (schedulerIsAnyDue(virtualTask.millis) == false)
+	{
+		TEST_CHECK(schedulerWait() == 0);
+	}
+	TEST_CHECK(virtualTask.millis == 1304);
+	TEST_CHECK(virtualTask.takes == 4);
+}
+
+static void testDeadlinesAcrossTheClockWrap(void)
+{
+	virtualTaskReset(0xFFFFFFF8U);
+
+	schedulerSetDeadline(SCHEDULER_CLIENT_KEYBOARD, (0xFFFFFFF8U + IDLE_SCAN_PERIOD));
+	TEST_CHECK(schedulerGetTimeout(0xFFFFFFF8U) == IDLE_SCAN_PERIOD);
+	TEST_CHECK(schedulerIsDue(SCHEDULER_CLIENT_KEYBOARD, 0xFFFFFFFFU) == false);
+
+	TEST_CHECK(schedulerWait() == 0);
+	TEST_CHECK(virtualTask.millis == 2);
+	TEST_CHECK(schedulerIsDue(SCHEDULER_CLIENT_KEYBOARD, 2));
+
+	// An overdue deadline stays due
+	TEST_CHECK(schedulerIsDue(SCHEDULER_CLIENT_KEYBOARD, 50));
+	TEST_CHECK(schedulerGetTimeout(50) == 0);
+}
+
+static void testEventWakesTheTaskUpEarly(void)
+{
+	virtualTaskReset(2000);
+
+	schedulerSetDeadline(SCHEDULER_CLIENT_KEYBOARD, (2000 + IDLE_SCAN_PERIOD));
+	isrPostAt(2003, SCHEDULER_EVENT_INPUT);
+
+	TEST_CHECK(schedulerWait() == SCHEDULER_EVENT_INPUT);
+	TEST_CHECK(virtualTask.millis == 2003);
+	TEST_CHECK(mockCriticalNesting == 0);
+
+	// The events are returned once
+	TEST_CHECK(schedulerWait() == 0);
+	TEST_CHECK(virtualTask.millis == (2000 + IDLE_SCAN_PERIOD));
+}
+
+static void testPendingEventDoesNotBlock(void)
+{
+	virtualTaskReset(3000);
+
+	schedulerSetDeadline(SCHEDULER_CLIENT_KEYBOARD, (3000 + IDLE_SCAN_PERIOD));
+	schedulerPostEvent(SCHEDULER_EVENT_USB);
+	schedulerPostEventFromISR(SCHEDULER_EVENT_INPUT);
+
+	TEST_CHECK(schedulerWait() == (SCHEDULER_EVENT_USB | SCHEDULER_EVENT_INPUT));
+	TEST_CHECK(virtualTask.takes == 0);
+	TEST_CHECK(virtualTask.millis == 3000);
+
+	// The notifications left behind only cause a spurious wake up
+	TEST_CHECK(schedulerWait() == 0);
+	TEST_CHECK(virtualTask.takes == 1);
+	TEST_CHECK(virtualTask.millis == 3000);
+	TEST_CHECK(schedulerWait() == 0);
+	TEST_CHECK(virtualTask.millis == (3000 + IDLE_SCAN_PERIOD));
+}
+
+static void testIdleLoopDoesNotWakeUpEveryMillisecond(void)
+{
+	virtualTaskReset(5000);
+
+	// Something needs every pass (key held, audio, TX...): 1 pass per ms
+	TEST_CHECK(runLoop(1000, true) == 1000);
+
+	// Idle: the keyboard scan period
+	virtualTask.takes = 0;
+	TEST_CHECK(runLoop(1000, false) == (1000 / IDLE_SCAN_PERIOD));
+	TEST_CHECK(virtualTask.takes == (1000 / IDLE_SCAN_PERIOD));
+
+	// The rotary encoder starts a pass straight away
+	isrPostAt((virtualTask.millis + 3), SCHEDULER_EVENT_INPUT);
+	TEST_CHECK(runLoop(IDLE_SCAN_PERIOD, false) == 2);
+}
+
+int main(void)
+{
+	TEST_RUN(testNoDeadlineWaitsTheMaximum);
+	TEST_RUN(testEarliestDeadlineWins);
+	TEST_RUN(testDeadlinesAcrossTheClockWrap);
+	TEST_RUN(testEventWakesTheTaskUpEarly);
+	TEST_RUN(testPendingEventDoesNotBlock);
+	TEST_RUN(testIdleLoopDoesNotWakeUpEveryMillisecond);
+
+	return EXIT_SUCCESS;
+}
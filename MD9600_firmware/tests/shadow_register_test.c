@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+//
+// HR-C6000 shadow registers (spi.c), bus traffic of a zone scan against the simulated HR-C6000 (see hrc6000Sim.h).
+//
+// HR-C6000.c itself needs most of the firmware to build, so each channel load replays the register writes of
+// HRC6000SetFMRx() followed by HRC6000SetRxCTCSS() or HRC6000SetRxDCS(0) (copied from there), through the real
+// batch and shadow code. The synthesiser and IF chip shadows (radioHardwareInterface.c) are in radio_shadow_test.c.
+//
+#include <stdio.h>
+#include <string.h>
+#include "testUtils.h"
+#include "main.h"
+#include "interfaces/hr-c6000_spi.h"
+#include "hrc6000Sim.h"
+
+#define SCAN_CHANNELS           64U
+#define NO_TONE               0xFFU
+
+typedef struct
+{
+	bool    always; // not a configuration register, never skipped
+	uint8_t reg;
+	uint8_t val;
+} channelWrite_t;
+
+static const channelWrite_t FM_RX_WRITES[] =
+{
+		{ true,  0x60, 0x00 }, // FM Voice Tx Mode Off
+		{ false, 0xE0, 0x89 }, // Turn off Microphone input
+		{ false, 0x10, 0x80 }, // Mod Mode FM
+		{ false, 0xE2, 0x06 }, // configure ADC and DAC
+		{ false, 0x34, 0x3C }, // Compressor off, de-Emph on 3KHz Audio Filter
+		{ false, 0x81, 0x19 }, // Interrupt Masks
+		{ false, 0x85, 0x00 }, // Interrupt Masks
+		{ false, 0x26, 0xFD }  // Turns on FM receive
+};
+
+static const channelWrite_t RX_CTCSS_WRITES[] =
+{
+		{ false, 0xA1, 0x08 }, // Enable CTCSS Mode
+		{ false, 0xA7, 0x10 }, // Detection Threshold
+		{ false, 0xD3, 0x07 }, // Sampling Depth 2000
+		{ false, 0xD2, 0xD0 },
+		{ false, 0xD4, 0x00 }  // tone index, replaced by the channel one
+};
+
+static const channelWrite_t RX_CSS_OFF_WRITES[] =
+{
+		{ false, 0xA1, 0x00 }  // Disable CTCSS and DCS Mode
+};
+
+// A zone in which most channels share their CTCSS tone with their neighbours, every 4th one having none
+static uint8_t channelTone(uint32_t channel)
+{
+	return (((channel % 4) == 3) ? NO_TONE : (uint8_t)(0x0C + (channel / 16)));
+}
+
+static void channelWrites(spi0Batch_t *batch, const channelWrite_t *writes, uint32_t count, bool useShadow, uint8_t lastValue)
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint8_t val = (((i + 1) == count) && (lastValue != NO_TONE)) ? lastValue : writes[i].val;
+
+		if (useShadow && (writes[i].always == false))
+		{
+			TEST_CHECK(SPI0BatchWritePageRegByteIfChanged(batch, 0x04, writes[i].reg, val) == 0);
+		}
+		else
+		{
+			TEST_CHECK(SPI0BatchWritePageRegByte(batch, 0x04, writes[i].reg, val) == 0);
+		}
+	}
+}
+
+static void channelLoad(uint32_t channel, bool useShadow)
+{
+	spi0Batch_t batch;
+	uint8_t tone = channelTone(channel);
+
+	SPI0BatchInit(&batch);
+	channelWrites(&batch, FM_RX_WRITES, (sizeof(FM_RX_WRITES) / sizeof(FM_RX_WRITES[0])), useShadow, NO_TONE);
+	TEST_CHECK(SPI0BatchCommit(&batch) == 0);
+
+	SPI0BatchInit(&batch);
+	if (tone != NO_TONE)
+	{
+		channelWrites(&batch, RX_CTCSS_WRITES, (sizeof(RX_CTCSS_WRITES) / sizeof(RX_CTCSS_WRITES[0])), useShadow, tone);
+	}
+	else
+	{
+		channelWrites(&batch, RX_CSS_OFF_WRITES, (sizeof(RX_CSS_OFF_WRITES) / sizeof(RX_CSS_OFF_WRITES[0])), useShadow, NO_TONE);
+	}
+	TEST_CHECK(SPI0BatchCommit(&batch) == 0);
+}
+
+static void scan(bool useShadow, uint8_t registers[256])
+{
+	chipReset();
+
+	for (uint32_t channel = 0; channel < SCAN_CHANNELS; channel++)
+	{
+		channelLoad(channel, useShadow);
+	}
+
+	memcpy(registers, chip.registers[4], 256);
+	TEST_CHECK(mockCriticalNesting == 0);
+}
+
+static void testScanTrafficDrops(void)
+{
+	uint8_t registersPlain[256];
+	uint8_t registersShadow[256];
+	uint32_t framesPlain;
+	uint32_t bytesPlain;
+	uint32_t written;
+	uint32_t skipped;
+
+	scan(false, registersPlain);
+	framesPlain = chip.frameCount;
+	bytesPlain = chip.byteCount;
+
+	scan(true, registersShadow);
+	SPI0ShadowGetStats(&written, &skipped);
+
+	printf("%u channel loads: %u frames / %u bytes written, %u frames / %u bytes with the shadows (%u writes skipped)\n",
+			SCAN_CHANNELS, framesPlain, bytesPlain, chip.frameCount, chip.byteCount, skipped);
+
+	// Same chip state, for a fraction of the traffic
+	TEST_CHECK(memcmp(registersPlain, registersShadow, sizeof(registersPlain)) == 0);
+	TEST_CHECK((chip.frameCount * 2) < framesPlain);
+	TEST_CHECK((chip.byteCount * 3) < bytesPlain);
+
+	// 0x60 is always written, so every channel load sends something
+	TEST_CHECK(chip.frameCount >= SCAN_CHANNELS);
+}
+
+static void testInvalidatedShadowIsRewritten(void)
+{
+	uint8_t registers[256];
+	uint32_t frames;
+	uint32_t framesPlain;
+
+	// Reference: one load without the shadows
+	chipReset();
+	channelLoad(0, false);
+	framesPlain = chip.frameCount;
+	memcpy(registers, chip.registers[4], sizeof(registers));
+
+	chipReset();
+	channelLoad(0, true);
+	TEST_CHECK(chip.frameCount == framesPlain); // nothing known yet
+
+	// Reloading it: only 0x60
+	frames = chip.frameCount;
+	channelLoad(0, true);
+	TEST_CHECK(chip.frameCount == (frames + 1));
+
+	// After a chip reset, everything goes out again
+	memset(chip.registers, 0, sizeof(chip.registers));
+	SPI0ShadowInvalidate();
+	channelLoad(0, true);
+	TEST_CHECK(memcmp(registers, chip.registers[4], sizeof(registers)) == 0);
+}
+
+int main(void)
+{
+	TEST_RUN(testScanTrafficDrops);
+	TEST_RUN(testInvalidatedShadowIsRewritten);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+//
+// spi.c register write batches, against the simulated HR-C6000 (see hrc6000Sim.h).
+//
+#include <string.h>
+#include "testUtils.h"
+#include "main.h"
+#include "interfaces/hr-c6000_spi.h"
+#include "hrc6000Sim.h"
+
+// Queues writes to every other register (nothing merged) until the batch is full, returns how many
+static uint32_t fillBatch(spi0Batch_t *batch, uint8_t page, uint8_t val)
+{
+	uint32_t count = 0;
+
+	while ((batch->frameCount < SPI0_BATCH_FRAMES_MAX) && ((batch->length + 3U) <= SPI0_BATCH_BUFFER_SIZE))
+	{
+		TEST_CHECK(SPI0BatchWritePageRegByte(batch, page, (count * 2), val) == 0);
+		count++;
+	}
+
+	return count;
+}
+
+static void testConsecutiveRegistersAreMerged(void)
+{
+	spi0Batch_t batch;
+
+	chipReset();
+	SPI0BatchInit(&batch);
+	TEST_CHECK(SPI0BatchWritePageRegByte(&batch, 0x04, 0x47, 0x11) == 0);
+	TEST_CHECK(SPI0BatchWritePageRegByte(&batch, 0x04, 0x48, 0x22) == 0);
+	TEST_CHECK(SPI0BatchWritePageRegByte(&batch, 0x04, 0x49, 0x33) == 0);
+	TEST_CHECK(SPI0BatchWritePageRegByte(&batch, 0x04, 0x04, 0x44) == 0);
+	TEST_CHECK(SPI0BatchWritePageRegByte(&batch, 0x01, 0x05, 0x55) == 0); // other page
+	TEST_CHECK(SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x11B, 0x66) == 0);
+	TEST_CHECK(SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x11C, 0x77) == 0); // never merged
+	TEST_CHECK(chip.frameCount == 0);
+
+	TEST_CHECK(SPI0BatchCommit(&batch) == 0);
+	TEST_CHECK(chip.frameCount == 5);
+	chipCheckFrame(0, (const uint8_t[]){ 0x04, 0x47, 0x11, 0x22, 0x33 }, 5);
+	chipCheckFrame(1, (const uint8_t[]){ 0x04, 0x04, 0x44 }, 3);
+	chipCheckFrame(2, (const uint8_t[]){ 0x01, 0x05, 0x55 }, 3);
+	chipCheckFrame(3, (const uint8_t[]){ 0x41, 0x1B, 0x01, 0x66 }, 4);
+	chipCheckFrame(4, (const uint8_t[]){ 0x41, 0x1C, 0x01, 0x77 }, 4);
+	TEST_CHECK(chip.registers[4][0x49] == 0x33);
+	TEST_CHECK(chip.extendedRegisters[1][0x11C] == 0x77);
+
+	// Emptied
+	TEST_CHECK(batch.frameCount == 0);
+	TEST_CHECK(SPI0BatchCommit(&batch) == 0);
+	TEST_CHECK(chip.frameCount == 5);
+	TEST_CHECK(mockCriticalNesting == 0);
+}
+
+static void testUnchangedRegistersAreSkipped(void)
+{
+	spi0Batch_t batch;
+	uint32_t written;
+	uint32_t skipped;
+	uint8_t val;
+
+	chipReset();
+	SPI0BatchInit(&batch);
+	TEST_CHECK(SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x47, 0x11) == 0);
+	TEST_CHECK(SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x48, 0x22) == 0);
+	TEST_CHECK(SPI0BatchCommit(&batch) == 0);
+	TEST_CHECK(chip.frameCount == 1);
+	TEST_CHECK(SPI0ShadowGet(0x04, 0x48, &val) && (val == 0x22));
+
+	SPI0ShadowGetStats(&written, &skipped);
+	TEST_CHECK(SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x47, 0x11) == 0);
+	TEST_CHECK(SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x48, 0x23) == 0);
+	TEST_CHECK(SPI0BatchCommit(&batch) == 0);
+	TEST_CHECK(chip.frameCount == 2);
+	chipCheckFrame(1, (const uint8_t[]){ 0x04, 0x48, 0x23 }, 3);
+
+	uint32_t skippedBefore = skipped;
+	SPI0ShadowGetStats(&written, &skipped);
+	TEST_CHECK(skipped == (skippedBefore + 1));
+
+	// The modules reset drops the shadow
+	TEST_CHECK(SPI0WritePageRegByte(0x04, 0x00, 0xFF) == 0);
+	TEST_CHECK(SPI0ShadowGet(0x04, 0x48, &val) == false);
+	TEST_CHECK(SPI0BatchWritePageRegByteIfChanged(&batch, 0x04, 0x48, 0x23) == 0);
+	TEST_CHECK(batch.frameCount == 1);
+}
+
+static void testFullBatchIsCommitted(void)
+{
+	spi0Batch_t batch;
+
+	chipReset();
+	SPI0BatchInit(&batch);
+
+	uint32_t count = fillBatch(&batch, 0x01, 0x5A);
+
+	TEST_CHECK(count == SPI0_BATCH_FRAMES_MAX);
+	TEST_CHECK(chip.frameCount == 0);
+
+	// No more room, the queued frames are sent first
+	TEST_CHECK(SPI0BatchWritePageRegByte(&batch, 0x01, 0xF0, 0xAA) == 0);
+	TEST_CHECK(chip.frameCount == count);
+	TEST_CHECK(batch.frameCount == 1);
+
+	TEST_CHECK(SPI0BatchCommit(&batch) == 0);
+	TEST_CHECK(chip.frameCount == (count + 1));
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		TEST_CHECK(chip.registers[1][i * 2] == 0x5A);
+	}
+	TEST_CHECK(chip.registers[1][0xF0] == 0xAA);
+
+	// Buffer full (extended frames are 4 bytes)
+	SPI0BatchInit(&batch);
+	for (uint32_t i = 0; i < (SPI0_BATCH_BUFFER_SIZE / 4); i++)
+	{
+		TEST_CHECK(SPI0BatchWritePageRegByteExtended(&batch, 0x01, (0x100 + i), i) == 0);
+	}
+	TEST_CHECK(batch.length == SPI0_BATCH_BUFFER_SIZE);
+	TEST_CHECK(SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x200, 0x55) == 0);
+	TEST_CHECK(SPI0BatchCommit(&batch) == 0);
+	TEST_CHECK(chip.extendedRegisters[1][0x100 + (SPI0_BATCH_BUFFER_SIZE / 4) - 1] == ((SPI0_BATCH_BUFFER_SIZE / 4) - 1));
+	TEST_CHECK(chip.extendedRegisters[1][0x200] == 0x55);
+}
+
+static void testWriteFailsWhenTheFullBatchCannotBeSent(void)
+{
+	spi0Batch_t batch;
+
+	chipReset();
+	SPI0BatchInit(&batch);
+
+	uint32_t count = fillBatch(&batch, 0x01, 0x10);
+
+	// With SPI0 taken, 0x70 can't be queued
+	SPI0inUse = true;
+	TEST_CHECK(SPI0BatchWritePageRegByte(&batch, 0x01, 0x70, 0xAA) != 0);
+	TEST_CHECK(SPI0BatchWritePageRegByteIfChanged(&batch, 0x01, 0x70, 0xAA) != 0);
+	TEST_CHECK(SPI0BatchWritePageRegByteExtended(&batch, 0x01, 0x170, 0xAA) != 0);
+	TEST_CHECK(SPI0BatchCommit(&batch) != 0);
+	TEST_CHECK(batch.frameCount == count);
+	TEST_CHECK(chip.frameCount == 0);
+	TEST_CHECK(mockCriticalNesting == 0);
+
+	// Nothing lost once released
+	SPI0inUse = false;
+	TEST_CHECK(SPI0BatchCommit(&batch) == 0);
+	TEST_CHECK(chip.frameCount == count);
+	TEST_CHECK(chip.registers[1][(count - 1) * 2] == 0x10);
+	TEST_CHECK(chip.registers[1][0x70] == 0x00);
+}
+
+static void testMergeIsNotBrokenByAFailedWrite(void)
+{
+	spi0Batch_t batch;
+
+	chipReset();
+	SPI0BatchInit(&batch);
+
+	// Fill the batch, the last frame being 0x01:0x20, with a byte left
+	for (uint32_t i = 0; i < ((SPI0_BATCH_BUFFER_SIZE - 4) / 4); i++)
+	{
+		TEST_CHECK(SPI0BatchWritePageRegByteExtended(&batch, 0x02, i, i) == 0);
+	}
+	TEST_CHECK(SPI0BatchWritePageRegByte(&batch, 0x01, 0x20, 0x01) == 0);
+	TEST_CHECK(batch.length == (SPI0_BATCH_BUFFER_SIZE - 1));
+
+	SPI0inUse = true;
+	TEST_CHECK(SPI0BatchWritePageRegByte(&batch, 0x01, 0x30, 0x02) != 0);
+	SPI0inUse = false;
+
+	// 0x31 must not be merged in the 0x20 frame, as if 0x30 had been queued
+	TEST_CHECK(SPI0BatchWritePageRegByte(&batch, 0x01, 0x31, 0x03) == 0);
+	TEST_CHECK(SPI0BatchWritePageRegByte(&batch, 0x01, 0x21, 0x04) == 0);
+	TEST_CHECK(SPI0BatchCommit(&batch) == 0);
+	TEST_CHECK(chip.registers[1][0x20] == 0x01);
+	TEST_CHECK(chip.registers[1][0x21] == 0x04);
+	TEST_CHECK(chip.registers[1][0x30] == 0x00);
+	TEST_CHECK(chip.registers[1][0x31] == 0x03);
+}
+
+static void testReadBack(void)
+{
+	volatile uint8_t val = 0;
+	volatile uint8_t values[4];
+
+	chipReset();
+	TEST_CHECK(SPI0WritePageRegByteArray(0x04, 0x10, (const uint8_t[]){ 0xA0, 0xA1, 0xA2, 0xA3 }, 4) == 0);
+	TEST_CHECK(SPI0ReadPageRegByte(0x04, 0x12, &val) == 0);
+	TEST_CHECK(val == 0xA2);
+	TEST_CHECK(SPI0ReadPageRegByteArray(0x04, 0x10, values, 4) == 0);
+	TEST_CHECK((values[0] == 0xA0) && (values[3] == 0xA3));
+
+	// Not reentrant
+	SPI0inUse = true;
+	TEST_CHECK(SPI0ReadPageRegByte(0x04, 0x12, &val) != 0);
+	TEST_CHECK(SPI0WritePageRegByte(0x04, 0x12, 0x00) != 0);
+	TEST_CHECK(mockCriticalNesting == 0);
+	SPI0inUse = false;
+	TEST_CHECK(chip.registers[4][0x12] == 0xA2);
+}
+
+int main(void)
+{
+	TEST_RUN(testConsecutiveRegistersAreMerged);
+	TEST_RUN(testUnchangedRegistersAreSkipped);
+	TEST_RUN(testFullBatchIsCommitted);
+	TEST_RUN(testWriteFailsWhenTheFullBatchCannotBeSent);
+	TEST_RUN(testMergeIsNotBrokenByAFailedWrite);
+	TEST_RUN(testReadBack);
+
+	return EXIT_SUCCESS;
+}
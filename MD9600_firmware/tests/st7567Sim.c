@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include <string.h>
+#include "testUtils.h"
+#include "main.h"
+#include "hardware/ST7567.h"
+#include "interfaces/remoteHead.h"
+#include "user_interface/menuSystem.h"
+#include "user_interface/uiLocalisation.h"
+#include "st7567Sim.h"
+
+GPIO_TypeDef mockGPIOD;
+SPI_TypeDef mockSPI2;
+SPI_HandleTypeDef hspi2 = { .Instance = SPI2 };
+int mockCriticalNesting = 0;
+
+// Other drivers the display code calls
+bool remoteHeadActive = false;
+bool headerRowIsDirty;
+
+static int renderTask; // its handle
+
+panel_t panel;
+
+static void panelApplyByte(uint8_t byte, bool dataMode)
+{
+	TEST_CHECK(panel.selected);
+
+	if (dataMode)
+	{
+		TEST_CHECK(panel.page < PANEL_PAGES);
+		TEST_CHECK(panel.column < PANEL_COLUMNS);
+		panel.ram[panel.page][panel.column++] = byte;
+		panel.dataBytes++;
+		return;
+	}
+
+	panel.commandBytes++;
+
+	if (panel.contrastNext)
+	{
+		panel.contrast = byte;
+		panel.contrastNext = false;
+	}
+	else if ((byte & 0xF0) == 0xB0)
+	{
+		panel.page = (byte & 0x0F);
+	}
+	else if ((byte & 0xF0) == 0x10)
+	{
+		panel.column = ((panel.column & 0x0F) | ((byte & 0x0F) << 4));
+	}
+	else if ((byte & 0xF0) == 0x00)
+	{
+		panel.column = ((panel.column & 0xF0) | (byte & 0x0F));
+	}
+	else
+	{
+		switch (byte)
+		{
+			case 0x81:
+				panel.contrastNext = true;
+				break;
+			case 0xA4:
+			case 0xA7:
+				panel.inverse = (byte == 0xA7);
+				break;
+			case 0xAE:
+			case 0xAF:
+				panel.displayOn = (byte == 0xAF);
+				break;
+			case 0xE2:
+				panel.resets++; // the display RAM is kept
+				break;
+		}
+	}
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state)
+{
+	bool level = (state != GPIO_PIN_RESET);
+
+	if (port != LCD_CS_GPIO_Port)
+	{
+		return;
+	}
+
+	switch (pin)
+	{
+		case LCD_CS_Pin:
+			panel.selected = (level == false);
+			break;
+
+		case LCD_RS_Pin:
+			// Only changed between transfers
+			TEST_CHECK(panel.dmaPending == false);
+			panel.dataMode = level;
+			break;
+	}
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t size, uint32_t timeout)
+{
+	TEST_CHECK(hspi == &hspi2);
+	TEST_CHECK(panel.dmaPending == false); // the bus is shared
+
+	for (uint16_t i = 0; i < size; i++)
+	{
+		panelApplyByte(pData[i], panel.dataMode);
+	}
+
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t size)
+{
+	TEST_CHECK(hspi == &hspi2);
+	TEST_CHECK(panel.dmaPending == false);
+	TEST_CHECK(panel.selected);
+	TEST_CHECK(size > 0);
+
+	if (panel.dmaStarts < PANEL_DMA_LOG_MAX)
+	{
+		panel.dmaLog[panel.dmaStarts] = (panelDma_t){ .length = size, .dataMode = panel.dataMode };
+	}
+
+	if (++panel.dmaStarts == panel.failStart)
+	{
+		return HAL_ERROR;
+	}
+
+	panel.dmaData = pData;
+	panel.dmaLength = size;
+	panel.dmaDataMode = panel.dataMode;
+	panel.dmaPending = true;
+
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef *hspi)
+{
+	TEST_CHECK(hspi == &hspi2);
+	panel.dmaPending = false;
+	panel.aborts++;
+
+	return HAL_OK;
+}
+
+// Completes the pending DMA transfer, as the interrupt would, which can start the next one
+bool panelCompleteTransfer(void)
+{
+	if ((panel.dmaPending == false) || panel.stuck)
+	{
+		return false;
+	}
+
+	panel.dmaPending = false;
+	mockCriticalNesting++; // interrupt context
+
+	if (++panel.dmaCompletions == panel.errorAt)
+	{
+		HAL_SPI_ErrorCallback(&hspi2);
+	}
+	else
+	{
+		for (uint16_t i = 0; i < panel.dmaLength; i++)
+		{
+			panelApplyByte(panel.dmaData[i], panel.dmaDataMode);
+		}
+
+		HAL_SPI_TxCpltCallback(&hspi2);
+	}
+
+	mockCriticalNesting--;
+
+	return true;
+}
+
+uint32_t panelCompleteTransfers(void)
+{
+	uint32_t count = 0;
+
+	while (panelCompleteTransfer())
+	{
+		count++;
+	}
+
+	return count;
+}
+
+uint32_t panelBytes(void)
+{
+	return (panel.commandBytes + panel.dataBytes);
+}
+
+bool panelRowMatches(int16_t row, const uint8_t *screen)
+{
+	return (memcmp(&panel.ram[row][DISPLAY_COLUMN_OFFSET], &screen[row * DISPLAY_SIZE_X], DISPLAY_SIZE_X) == 0);
+}
+
+void panelReset(void)
+{
+	memset(&panel, 0, sizeof(panel));
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+	return panel.ticks;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+	return &renderTask;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higherPriorityTaskWoken)
+{
+	TEST_CHECK(task == &renderTask);
+	panel.notifications++;
+	*higherPriorityTaskWoken = pdTRUE;
+}
+
+// The render task waiting: the DMA runs until the transfer ends (completion notified), or the timeout
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait)
+{
+	uint32_t notifications;
+
+	panel.waits++;
+	panelCompleteTransfers();
+
+	notifications = panel.notifications;
+	if (notifications == 0)
+	{
+		panel.ticks += ticksToWait;
+	}
+	panel.notifications = 0;
+
+	return notifications;
+}
+
+// UI, not used by these tests
+static const stringsTable_t strings;
+const stringsTable_t *currentLanguage = &strings;
+
+bool uiNotificationIsVisible(void)
+{
+	return false;
+}
+
+void uiNotificationRefresh(void)
+{
+	TEST_CHECK(false);
+}
+
+// The remote head only counts what it is sent
+void remoteHeadRenderRows(int16_t startRow, int16_t endRow)
+{
+	panel.remoteRenders++;
+}
+
+void remoteHeadTransferCommand(uint8_t data1)
+{
+	panel.remoteCommands++;
+}
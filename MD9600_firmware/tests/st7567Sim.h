@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef _OPENGD77_ST7567_SIM_H_
+#define _OPENGD77_ST7567_SIM_H_
+
+//
+// Simulated ST7567 panel on SPI2, shared by the tests which build ST7567_display.c and ST7567_transfer.c.
+//
+// The chip select and command/data lines, and the SPI2 transfers (blocking, or DMA), are decoded into the panel
+// commands: the page and column addresses set where the data bytes go in the display RAM, the column incrementing
+// after each byte. A DMA transfer is applied when it completes, from the data as it is then, which is either
+// done by panelCompleteTransfer(), or by the task notification wait of the render.
+//
+// The DMA transfers are logged, and can be made to fail to start, to end with an error, or to never complete.
+//
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PANEL_PAGES    8U
+#define PANEL_COLUMNS  132U
+#define PANEL_DMA_LOG_MAX  256U
+
+typedef struct
+{
+	uint16_t length;
+	bool     dataMode;
+} panelDma_t;
+
+typedef struct
+{
+	bool           selected;
+	bool           dataMode;
+	uint8_t        page;
+	uint8_t        column;
+	bool           contrastNext; // the byte after 0x81 is the contrast
+	uint8_t        contrast;
+	bool           displayOn;
+	bool           inverse;
+	uint8_t        ram[PANEL_PAGES][PANEL_COLUMNS];
+	uint32_t       commandBytes;
+	uint32_t       dataBytes;
+	uint32_t       resets;      // 0xE2 commands
+
+	// SPI2 TX DMA
+	uint8_t       *dmaData;
+	uint16_t       dmaLength;
+	bool           dmaPending;
+	bool           dmaDataMode;
+	uint32_t       dmaStarts;
+	uint32_t       dmaCompletions;
+	uint32_t       aborts;
+	panelDma_t     dmaLog[PANEL_DMA_LOG_MAX];
+	uint32_t       failStart;  // this DMA start (counting from 1) returns HAL_ERROR, 0 for none
+	uint32_t       errorAt;    // this completion (counting from 1) is a SPI error, 0 for none
+	bool           stuck;      // the pending transfer doesn't complete
+
+	// Task side
+	uint32_t       ticks;         // xTaskGetTickCount()
+	uint32_t       notifications; // given to the render task
+	uint32_t       waits;         // ulTaskNotifyTake() calls
+	uint32_t       remoteRenders;
+	uint32_t       remoteCommands;
+} panel_t;
+
+extern panel_t panel;
+
+void panelReset(void);
+bool panelCompleteTransfer(void);
+uint32_t panelCompleteTransfers(void);
+uint32_t panelBytes(void);
+bool panelRowMatches(int16_t row, const uint8_t *screen);
+
+#endif /* _OPENGD77_ST7567_SIM_H_ */
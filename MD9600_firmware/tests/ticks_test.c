@@ -0,0 +1,552 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+//
+// The timer callbacks of ticks.c (the min-heap of ticksCallbackAdd() and friends) against a reference model (a
+// list sorted by expiry, then insertion order), with random adds, cancels, reschedules and clock steps, across the
+// wrap of the millisecond clock. Then the handle generations, the callbacks which add and cancel callbacks, the
+// menu destinations, the full pool, the ticksTimer functions, and a benchmark with 500 pending callbacks.
+//
+// ticks_512_test builds the same test with a 512 callbacks pool.
+//
+#include <string.h>
+#include "testUtils.h"
+#include "main.h"
+#include "functions/ticks.h"
+#include "user_interface/menuSystem.h"
+
+#define CALLBACK_FUNCTIONS        8U
+#define RANDOM_OPERATIONS    200000U
+#define BENCHMARK_CALLBACKS     500U
+#define BENCHMARK_OPERATIONS 1000000U
+
+int mockCriticalNesting;
+volatile uint32_t uwTick;
+static int currentMenu = MENU_EMPTY;
+
+int menuSystemGetCurrentMenuNumber(void)
+{
+	return currentMenu;
+}
+
+// Reference model: pending callbacks sorted by expiry, then insertion
+typedef struct
+{
+	uint32_t              function;
+	int                   menu;
+	uint32_t              expiry;
+	ticksCallbackHandle_t handle;
+} modelCallback_t;
+
+static modelCallback_t model[TICKS_CALLBACKS_MAX];
+static uint32_t modelCount;
+
+// Calls made by handleTimerCallbacks()
+static uint32_t calls[RANDOM_OPERATIONS];
+static uint32_t callCount;
+
+static void callbackRecord(uint32_t function)
+{
+	TEST_CHECK(callCount < RANDOM_OPERATIONS);
+	calls[callCount++] = function;
+}
+
+static void callback0(void) { callbackRecord(0); }
+static void callback1(void) { callbackRecord(1); }
+static void callback2(void) { callbackRecord(2); }
+static void callback3(void) { callbackRecord(3); }
+static void callback4(void) { callbackRecord(4); }
+static void callback5(void) { callbackRecord(5); }
+static void callback6(void) { callbackRecord(6); }
+static void callback7(void) { callbackRecord(7); }
+
+static const timerCallback_t CALLBACKS[CALLBACK_FUNCTIONS] = { callback0, callback1, callback2, callback3, callback4, callback5, callback6, callback7 };
+
+static void modelInsert(uint32_t function, int menu, uint32_t delay, ticksCallbackHandle_t handle)
+{
+	uint32_t expiry = (uwTick + delay);
+	uint32_t i = modelCount;
+
+	// After the ones which expire at the same time
+	while ((i > 0) && ((int32_t)(model[i - 1].expiry - expiry) > 0))
+	{
+		model[i] = model[i - 1];
+		i--;
+	}
+
+	model[i] = (modelCallback_t){ .function = function, .menu = menu, .expiry = expiry, .handle = handle };
+	modelCount++;
+}
+
+static void modelRemove(uint32_t index)
+{
+	memmove(&model[index], &model[index + 1], ((modelCount - index - 1) * sizeof(modelCallback_t)));
+	modelCount--;
+}
+
+// Expected calls of handleTimerCallbacks(), removing the expired callbacks from the model
+static uint32_t modelExpire(uint32_t *expected)
+{
+	uint32_t count = 0;
+
+	while ((modelCount > 0) && ((int32_t)(model[0].expiry - uwTick) <= 0))
+	{
+		if ((model[0].menu == MENU_ANY) || (model[0].menu == currentMenu))
+		{
+			expected[count++] = model[0].function;
+		}
+		modelRemove(0);
+	}
+
+	return count;
+}
+
+static void checkNextExpiry(void)
+{
+	uint32_t expiry;
+
+	if (modelCount == 0)
+	{
+		TEST_CHECK(ticksCallbackGetNextExpiry(&expiry) == false);
+	}
+	else
+	{
+		TEST_CHECK(ticksCallbackGetNextExpiry(&expiry));
+		TEST_CHECK(expiry == model[0].expiry);
+	}
+}
+
+// Empties the pool, whatever is pending
+static void resetCallbacks(void)
+{
+	uint32_t expiry;
+
+	while (ticksCallbackGetNextExpiry(&expiry))
+	{
+		uwTick = expiry;
+		handleTimerCallbacks();
+	}
+
+	modelCount = 0;
+	callCount = 0;
+	currentMenu = MENU_EMPTY;
+}
+
+// Functions 0 to 5 are added with handles, possibly several times. Functions 6 and 7 only through
+// addTimerCallback(), which reschedules them, so they are pending once at most (as the UI uses them).
+static void testRandomOperations(void)
+{
+	static uint32_t expected[TICKS_CALLBACKS_MAX];
+	uint32_t seed = 0x5449434B;
+	uint32_t expiries = 0;
+	bool wrapped = false;
+
+	// Starts a minute before the wrap of the clock
+	uwTick = (UINT32_MAX - 60000);
+	resetCallbacks();
+
+	for (uint32_t op = 0; op < RANDOM_OPERATIONS; op++)
+	{
+		uint32_t action = (testRandom(&seed) % 16);
+		int menu = (((testRandom(&seed) % 4) == 0) ? UI_CPS : MENU_ANY);
+		uint32_t delay = (((testRandom(&seed) % 8) == 0) ? (testRandom(&seed) % 5) : (testRandom(&seed) % 2000));
+
+		if (action < 6)
+		{
+			uint32_t function = (testRandom(&seed) % 6);
+			ticksCallbackHandle_t handle = ticksCallbackAdd(CALLBACKS[function], delay, menu);
+
+			if (modelCount == TICKS_CALLBACKS_MAX)
+			{
+				TEST_CHECK(handle == TICKS_CALLBACK_INVALID_HANDLE);
+			}
+			else
+			{
+				TEST_CHECK(handle != TICKS_CALLBACK_INVALID_HANDLE);
+				modelInsert(function, menu, delay, handle);
+			}
+		}
+		else if ((action < 8) && (modelCount > 0))
+		{
+			uint32_t index = (testRandom(&seed) % modelCount);
+
+			if (model[index].handle != TICKS_CALLBACK_INVALID_HANDLE)
+			{
+				TEST_CHECK(ticksCallbackCancel(model[index].handle));
+				TEST_CHECK(ticksCallbackCancel(model[index].handle) == false); // only once
+				modelRemove(index);
+			}
+		}
+		else if (action < 10)
+		{
+			uint32_t function = (6 + (testRandom(&seed) % 2));
+			uint32_t index;
+
+			for (index = 0; index < modelCount; index++)
+			{
+				if (model[index].function == function)
+				{
+					break;
+				}
+			}
+
+			if (action == 8)
+			{
+				// Rescheduled, with its new menu, or added
+				TEST_CHECK(addTimerCallback(CALLBACKS[function], delay, menu, true) == ((index < modelCount) || (modelCount < TICKS_CALLBACKS_MAX)));
+				if (index < modelCount)
+				{
+					modelRemove(index);
+				}
+				if (modelCount < TICKS_CALLBACKS_MAX)
+				{
+					modelInsert(function, menu, delay, TICKS_CALLBACK_INVALID_HANDLE);
+				}
+			}
+			else
+			{
+				// Only cancelled if the menu matches
+				bool cancelled = ((index < modelCount) && (model[index].menu == menu));
+
+				TEST_CHECK(cancelTimerCallback(CALLBACKS[function], menu) == cancelled);
+				if (cancelled)
+				{
+					modelRemove(index);
+				}
+			}
+		}
+		else
+		{
+			uint32_t previous = uwTick;
+
+			uwTick += (testRandom(&seed) % 300);
+			wrapped |= (uwTick < previous);
+
+			if ((testRandom(&seed) % 4) == 0)
+			{
+				currentMenu = ((currentMenu == UI_CPS) ? MENU_EMPTY : UI_CPS);
+			}
+
+			uint32_t count = modelExpire(expected);
+
+			callCount = 0;
+			handleTimerCallbacks();
+			TEST_CHECK(callCount == count);
+			TEST_CHECK(memcmp(calls, expected, (count * sizeof(uint32_t))) == 0);
+			expiries += count;
+		}
+
+		checkNextExpiry();
+	}
+
+	TEST_CHECK(wrapped);
+	printf("  %u callbacks called\n", expiries);
+}
+
+// A handle is the slot and its generation: a stale handle can't cancel the callback which reuses the slot, and
+// no handle is ever the invalid one, even once the generation has wrapped
+static void testHandles(void)
+{
+	uwTick = 1000;
+	resetCallbacks();
+
+	ticksCallbackHandle_t first = ticksCallbackAdd(callback0, 10, MENU_ANY);
+
+	TEST_CHECK(first != TICKS_CALLBACK_INVALID_HANDLE);
+	TEST_CHECK(ticksCallbackCancel(first));
+
+	ticksCallbackHandle_t second = ticksCallbackAdd(callback1, 10, MENU_ANY);
+
+	TEST_CHECK((second & 0xFFFF) == (first & 0xFFFF)); // same slot, reused first
+	TEST_CHECK(second != first);
+	TEST_CHECK(ticksCallbackCancel(first) == false);
+	TEST_CHECK(ticksCallbackCancel(TICKS_CALLBACK_INVALID_HANDLE) == false);
+	TEST_CHECK(ticksCallbackCancel(((second >> 16) << 16) | TICKS_CALLBACKS_MAX) == false); // no such slot
+
+	// Expired, then stale
+	uwTick += 10;
+	handleTimerCallbacks();
+	TEST_CHECK((callCount == 1) && (calls[0] == 1));
+	TEST_CHECK(ticksCallbackCancel(second) == false);
+
+	for (uint32_t i = 0; i < (2 * UINT16_MAX); i++)
+	{
+		ticksCallbackHandle_t handle = ticksCallbackAdd(callback2, 1, MENU_ANY);
+
+		TEST_CHECK(handle != TICKS_CALLBACK_INVALID_HANDLE);
+		TEST_CHECK((handle >> 16) != 0);
+		TEST_CHECK(ticksCallbackCancel(handle));
+	}
+}
+
+static ticksCallbackHandle_t periodicHandle;
+static ticksCallbackHandle_t victimHandle;
+static uint32_t periodicCalls;
+
+// Adds itself back, and cancels the victim on its 3rd call
+static void periodicCallback(void)
+{
+	periodicCalls++;
+	periodicHandle = ticksCallbackAdd(periodicCallback, 100, MENU_ANY);
+	TEST_CHECK(periodicHandle != TICKS_CALLBACK_INVALID_HANDLE);
+
+	if (periodicCalls == 3)
+	{
+		TEST_CHECK(ticksCallbackCancel(victimHandle));
+	}
+}
+
+// Reschedules callback1 to expire now, so it runs in the same handleTimerCallbacks() call
+static void rescheduleCallback(void)
+{
+	callbackRecord(7);
+	TEST_CHECK(addTimerCallback(callback1, 0, MENU_ANY, true));
+}
+
+static void testCallbacksChangingCallbacks(void)
+{
+	uwTick = 5000;
+	resetCallbacks();
+	periodicCalls = 0;
+
+	periodicHandle = ticksCallbackAdd(periodicCallback, 100, MENU_ANY);
+	victimHandle = ticksCallbackAdd(callback0, 1000, MENU_ANY);
+
+	// All the periods due are caught up by one call
+	uwTick += 250;
+	handleTimerCallbacks();
+	TEST_CHECK(periodicCalls == 1); // re-added at 5350, not yet due
+
+	for (uint32_t i = 0; i < 10; i++)
+	{
+		uwTick += 100;
+		handleTimerCallbacks();
+	}
+	TEST_CHECK(periodicCalls == 11);
+	TEST_CHECK(callCount == 0); // the victim was cancelled before its time
+	TEST_CHECK(ticksCallbackCancel(victimHandle) == false);
+	TEST_CHECK(ticksCallbackCancel(periodicHandle));
+
+	// A callback rescheduling another one, which was due later, to now
+	ticksCallbackAdd(rescheduleCallback, 10, MENU_ANY);
+	ticksCallbackAdd(callback1, 500, MENU_ANY);
+	uwTick += 10;
+	handleTimerCallbacks();
+	TEST_CHECK((callCount == 2) && (calls[0] == 7) && (calls[1] == 1));
+	checkNextExpiry();
+}
+
+// A callback for another menu than the current one is dropped when it expires
+static void testMenuDestination(void)
+{
+	uwTick = 100;
+	resetCallbacks();
+
+	currentMenu = UI_CPS;
+	ticksCallbackAdd(callback0, 10, MENU_MAIN_MENU);
+	ticksCallbackAdd(callback1, 10, UI_CPS);
+	ticksCallbackAdd(callback2, 10, MENU_ANY);
+	uwTick += 10;
+	handleTimerCallbacks();
+	TEST_CHECK((callCount == 2) && (calls[0] == 1) && (calls[1] == 2));
+	checkNextExpiry();
+
+	// Cancelled with the menu it was added for only
+	TEST_CHECK(addTimerCallback(callback3, 10, UI_CPS, false));
+	TEST_CHECK(cancelTimerCallback(callback3, MENU_ANY) == false);
+	TEST_CHECK(cancelTimerCallback(callback4, UI_CPS) == false);
+	TEST_CHECK(cancelTimerCallback(callback3, UI_CPS));
+
+	// Without the update, the same function is added twice
+	TEST_CHECK(addTimerCallback(callback3, 10, MENU_ANY, false));
+	TEST_CHECK(addTimerCallback(callback3, 20, MENU_ANY, false));
+	callCount = 0;
+	uwTick += 20;
+	handleTimerCallbacks();
+	TEST_CHECK(callCount == 2);
+}
+
+// All the slots in use: the next add fails until one is freed, and ties expire in insertion order
+static void testFullPool(void)
+{
+	uwTick = 0;
+	resetCallbacks();
+
+	for (uint32_t i = 0; i < TICKS_CALLBACKS_MAX; i++)
+	{
+		TEST_CHECK(ticksCallbackAdd(CALLBACKS[i % CALLBACK_FUNCTIONS], 50, MENU_ANY) != TICKS_CALLBACK_INVALID_HANDLE);
+	}
+	TEST_CHECK(ticksCallbackAdd(callback0, 1, MENU_ANY) == TICKS_CALLBACK_INVALID_HANDLE);
+	TEST_CHECK(addTimerCallback(callback0, 1, MENU_ANY, false) == false);
+	TEST_CHECK(addTimerCallback(callback0, 1, MENU_ANY, true)); // rescheduled, no slot needed
+
+	uwTick = 1;
+	handleTimerCallbacks();
+	TEST_CHECK((callCount == 1) && (calls[0] == 0));
+	TEST_CHECK(ticksCallbackAdd(callback1, 49, MENU_ANY) != TICKS_CALLBACK_INVALID_HANDLE);
+
+	callCount = 0;
+	uwTick = 50;
+	handleTimerCallbacks();
+	TEST_CHECK(callCount == TICKS_CALLBACKS_MAX);
+	for (uint32_t i = 0; i < (TICKS_CALLBACKS_MAX - 1); i++)
+	{
+		TEST_CHECK(calls[i] == ((i + 1) % CALLBACK_FUNCTIONS));
+	}
+	TEST_CHECK(calls[TICKS_CALLBACKS_MAX - 1] == 1); // added last
+}
+
+static void testTimers(void)
+{
+	ticksTimer_t timer;
+
+	ticksTimerReset(&timer);
+	TEST_CHECK(ticksTimerIsEnabled(&timer) == false);
+	TEST_CHECK(ticksTimerRemaining(&timer) == 0);
+
+	uwTick = (UINT32_MAX - 50);
+	ticksTimerStart(&timer, 100);
+	TEST_CHECK(ticksTimerIsEnabled(&timer));
+	TEST_CHECK(ticksTimerHasExpired(&timer) == false);
+	TEST_CHECK(ticksTimerRemaining(&timer) == 100);
+
+	uwTick += 99; // wrapped
+	TEST_CHECK(ticksTimerHasExpired(&timer) == false);
+	TEST_CHECK(ticksTimerRemaining(&timer) == 1);
+
+	uwTick++;
+	TEST_CHECK(ticksTimerHasExpired(&timer));
+	TEST_CHECK(ticksTimerRemaining(&timer) == 0);
+
+	uwTick += 1000000;
+	TEST_CHECK(ticksTimerHasExpired(&timer));
+	TEST_CHECK(ticksTimerRemaining(&timer) == 0);
+
+	// A zero timeout has always expired
+	ticksTimerStart(&timer, 0);
+	TEST_CHECK(ticksTimerHasExpired(&timer));
+	TEST_CHECK(ticksTimerIsEnabled(&timer) == false);
+
+	TEST_CHECK(ticksGetMillis() == uwTick);
+}
+
+// BENCHMARK_CALLBACKS pending (or as many as the pool holds), each expiry adding a new one. The sorted list of the
+// model runs the same pattern, for comparison.
+static void benchmarkCallbacks(void)
+{
+	uint32_t pending = ((BENCHMARK_CALLBACKS < TICKS_CALLBACKS_MAX) ? BENCHMARK_CALLBACKS : TICKS_CALLBACKS_MAX);
+	uint32_t seed = 0x42454E43;
+	static uint32_t expected[TICKS_CALLBACKS_MAX];
+	ticksCallbackHandle_t handles[TICKS_CALLBACKS_MAX];
+
+	uwTick = 0;
+	resetCallbacks();
+
+	for (uint32_t i = 0; i < pending; i++)
+	{
+		ticksCallbackAdd(callback0, (1 + (testRandom(&seed) % 10000)), MENU_ANY);
+	}
+
+	// Expire and add back, the clock jumping to the next expiry
+	uint64_t start = testGetNanoseconds();
+	uint32_t operations = 0;
+
+	while (operations < BENCHMARK_OPERATIONS)
+	{
+		uint32_t expiry;
+
+		ticksCallbackGetNextExpiry(&expiry);
+		uwTick = expiry;
+		callCount = 0;
+		handleTimerCallbacks();
+
+		for (uint32_t i = 0; i < callCount; i++)
+		{
+			ticksCallbackAdd(callback0, (1 + (testRandom(&seed) % 10000)), MENU_ANY);
+		}
+		operations += callCount;
+	}
+
+	uint64_t heapExpiry = (testGetNanoseconds() - start);
+
+	// Cancel and add back, by handle
+	resetCallbacks();
+	for (uint32_t i = 0; i < pending; i++)
+	{
+		handles[i] = ticksCallbackAdd(callback0, (1 + (testRandom(&seed) % 10000)), MENU_ANY);
+	}
+
+	start = testGetNanoseconds();
+	for (uint32_t i = 0; i < BENCHMARK_OPERATIONS; i++)
+	{
+		uint32_t index = (i % pending);
+
+		TEST_CHECK(ticksCallbackCancel(handles[index]));
+		handles[index] = ticksCallbackAdd(callback0, (1 + (testRandom(&seed) % 10000)), MENU_ANY);
+	}
+	uint64_t heapCancel = (testGetNanoseconds() - start);
+
+	// Same expiry pattern with the sorted list
+	resetCallbacks();
+	uwTick = 0;
+	for (uint32_t i = 0; i < pending; i++)
+	{
+		modelInsert(0, MENU_ANY, (1 + (testRandom(&seed) % 10000)), 0);
+	}
+
+	start = testGetNanoseconds();
+	operations = 0;
+	while (operations < BENCHMARK_OPERATIONS)
+	{
+		uwTick = model[0].expiry;
+		uint32_t count = modelExpire(expected);
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			modelInsert(0, MENU_ANY, (1 + (testRandom(&seed) % 10000)), 0);
+		}
+		operations += count;
+	}
+	uint64_t listExpiry = (testGetNanoseconds() - start);
+
+	modelCount = 0;
+	resetCallbacks();
+	printf("  %u pending: heap %.1f ns per expiry and add, %.1f ns per cancel and add, sorted list %.1f ns per expiry and add\n",
+			pending, ((double)heapExpiry / BENCHMARK_OPERATIONS), ((double)heapCancel / BENCHMARK_OPERATIONS), ((double)listExpiry / BENCHMARK_OPERATIONS));
+}
+
+int main(void)
+{
+	TEST_RUN(testRandomOperations);
+	TEST_RUN(testHandles);
+	TEST_RUN(testCallbacksChangingCallbacks);
+	TEST_RUN(testMenuDestination);
+	TEST_RUN(testFullPool);
+	TEST_RUN(testTimers);
+	TEST_RUN(benchmarkCallbacks);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,260 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include <string.h>
+#include "testUtils.h"
+#include "main.h"
+#include "dmr_codec/codec.h"
+#include "functions/calibration.h"
+#include "functions/codeplug.h"
+#include "functions/cpuStats.h"
+#include "functions/rxPowerSaving.h"
+#include "functions/settings.h"
+#include "functions/sound.h"
+#include "functions/ticks.h"
+#include "functions/voicePrompts.h"
+#include "hardware/EEPROM.h"
+#include "hardware/SPI_Flash.h"
+#include "hardware/ST7567.h"
+#include "hardware/radioHardwareInterface.h"
+#include "interfaces/gps.h"
+#include "interfaces/hr-c6000_spi.h"
+#include "user_interface/menuSystem.h"
+#include "user_interface/uiGlobals.h"
+#include "user_interface/uiUtilities.h"
+#include "usb/usb_benchmark.h"
+#include "usb/usb_com.h"
+#include "usbComSim.h"
+
+usbComSim_t sim;
+
+int mockCriticalNesting = 0;
+union sharedDataBuffer audioAndHotspotDataBuffer;
+volatile int16_t wavbuffer_count;
+settingsStruct_t nonVolatileSettings;
+uiDataGlobal_t uiDataGlobal;
+struct_codeplugChannel_t settingsVFOChannel[2];
+volatile int settingsUsbMode = USB_MODE_CPS;
+uint32_t dmrIDDatabaseMemoryLocation2;
+uint32_t flashChipPartNumber;
+bool voicePromptDataIsLoaded;
+const int CODEPLUG_ADDR_CHANNEL_HEADER_EEPROM = 0x3780;
+const int CODEPLUG_ADDR_VFO_A_CHANNEL = 0x7590;
+const uint32_t VOICE_PROMPTS_FLASH_HEADER_ADDRESS = 0x8F400 + FLASH_ADDRESS_OFFSET;
+const uint32_t VOICE_PROMPTS_FLASH_OLD_HEADER_ADDRESS = 0xE0000 + FLASH_ADDRESS_OFFSET;
+
+static uint8_t calibration[0x200];
+static uint8_t screenBuffer[1024];
+static cpuStats_t cpuStats;
+static radioShadow_t radioShadow;
+
+void simReset(void)
+{
+	memset(&sim, 0, sizeof(sim));
+	memset(sim.flash, 0xFF, sizeof(sim.flash));
+	memset(sim.eeprom, 0xFF, sizeof(sim.eeprom));
+	settingsUsbMode = USB_MODE_CPS;
+	com_request = 0;
+	mockCriticalNesting = 0;
+}
+
+bool simFlashIsBusy(void)
+{
+	return (sim.stuck || (sim.busyPolls > 0));
+}
+
+uint8_t CDC_Transmit_FS(uint8_t *buf, uint16_t len)
+{
+	if (sim.busyCalls > 0)
+	{
+		sim.busyCalls--;
+		return USBD_BUSY;
+	}
+
+	TEST_CHECK((sim.receivedLength + len) <= SIM_RECEIVED_MAX);
+	if ((sim.receivedLength + len) <= SIM_RECEIVED_MAX)
+	{
+		memcpy(&sim.received[sim.receivedLength], buf, len);
+		sim.receivedLength += len;
+	}
+	sim.packets++;
+
+	return USBD_OK;
+}
+
+bool SPI_Flash_isBusy(void)
+{
+	if (sim.stuck)
+	{
+		return true;
+	}
+
+	if (sim.busyPolls > 0)
+	{
+		sim.busyPolls--;
+		return true;
+	}
+
+	return false;
+}
+
+bool SPI_Flash_read(uint32_t address, uint8_t *buf, int size)
+{
+	if (simFlashIsBusy())
+	{
+		sim.readsWhileBusy++;
+	}
+
+	if (sim.failReads || ((address + size) > SIM_FLASH_SIZE))
+	{
+		return false;
+	}
+
+	memcpy(buf, &sim.flash[address], size);
+	return true;
+}
+
+void SPI_Flash_eraseSectorStart(uint32_t address)
+{
+	TEST_CHECK((address % SIM_FLASH_SECTOR_SIZE) == 0);
+	TEST_CHECK((address + SIM_FLASH_SECTOR_SIZE) <= SIM_FLASH_SIZE);
+
+	if (simFlashIsBusy())
+	{
+		sim.startsWhileBusy++;
+		return;
+	}
+
+	memset(&sim.flash[address], 0xFF, SIM_FLASH_SECTOR_SIZE);
+	sim.erases++;
+	sim.busyPolls = sim.eraseBusyPolls;
+}
+
+// The page is shifted in before the chip goes busy, so the buffer may change afterwards
+void SPI_Flash_writePageStart(uint32_t address, uint8_t *dataBuf)
+{
+	TEST_CHECK((address % SIM_FLASH_PAGE_SIZE) == 0);
+	TEST_CHECK((address + SIM_FLASH_PAGE_SIZE) <= SIM_FLASH_SIZE);
+
+	if (simFlashIsBusy())
+	{
+		sim.startsWhileBusy++;
+		return;
+	}
+
+	for (uint32_t i = 0; i < SIM_FLASH_PAGE_SIZE; i++)
+	{
+		if (dataBuf[i] & ~sim.flash[address + i])
+		{
+			sim.programsOverData++;
+		}
+		sim.flash[address + i] &= dataBuf[i];
+	}
+
+	sim.pagePrograms++;
+	sim.busyPolls = sim.pageBusyPolls;
+}
+
+bool SPI_Flash_waitForWriteCompletion(void)
+{
+	sim.stuck = false;
+	sim.busyPolls = 0;
+	return true;
+}
+
+bool SPI_Flash_readSecurityRegisters(int startBlock, uint8_t *dataBuf, int size)
+{
+	memset(dataBuf, 0xFF, size);
+	return true;
+}
+
+bool EEPROM_Read(int address, uint8_t *buf, int size)
+{
+	if ((address < 0) || ((address + size) > (int)SIM_EEPROM_SIZE))
+	{
+		return false;
+	}
+
+	memcpy(buf, &sim.eeprom[address], size);
+	return true;
+}
+
+uint32_t ticksGetMillis(void)
+{
+	return sim.millis;
+}
+
+osStatus_t osDelay(uint32_t ticks)
+{
+	sim.millis += ticks;
+	return osOK;
+}
+
+void vTaskDelay(const TickType_t ticks)
+{
+	sim.millis += ticks;
+}
+
+uint8_t *calibrationGetLocalDataPointer(void) { return calibration; }
+uint8_t *displayGetPrimaryScreenBuffer(void) { return screenBuffer; }
+const cpuStats_t *cpuStatsGet(void) { return &cpuStats; }
+const radioShadow_t *radioGetShadow(void) { return &radioShadow; }
+void NVIC_SystemReset(void) { }
+bool addTimerCallback(timerCallback_t funPtr, uint32_t delayIn_mS, int menuDest, bool updateExistingCallbackTime) { return true; }
+void calibrationSaveLocal(void) { }
+void codecEncode(uint8_t *outdata_ptr, int numbBlocks) { }
+void codecInitInternalBuffers(void) { }
+bool codeplugAllChannelsIndexIsInUse(int index) { return false; }
+void codeplugAllChannelsInitCache(void) { }
+void codeplugConvertChannelInternalToCodeplug(struct_codeplugChannel_t *codeplugChannel, struct_codeplugChannel_t *internalChannel) { }
+int16_t codeplugGetLastUsedChannelInZone(int zoneNum) { return 0; }
+void codeplugInitLastUsedChannelInZone(void) { }
+bool codeplugSaveLastUsedChannelInZone(void) { return true; }
+int16_t codeplugSetLastUsedChannelInZone(int zoneNum, int16_t channelNum) { return channelNum; }
+int codeplugZonesGetCount(void) { return 0; }
+void codeplugZonesInitCache(void) { }
+void daytimeThemeChangeUpdate(bool startup) { }
+void dmrIDCacheInit(void) { }
+void gpsLoggingStart(void) { }
+void gpsLoggingStop(void) { }
+void menuSatelliteScreenClearPredictions(bool reloadKeps) { }
+int menuSystemGetCurrentMenuNumber(void) { return UI_CPS; }
+void menuSystemPopAllAndDisplayRootMenu(void) { }
+void menuSystemPushNewMenu(int menuNumber) { }
+void rxPowerSavingSetLevel(int newLevel) { }
+void rxPowerSavingSetState(ecoPhase_t newState) { }
+void setRtc_custom(time_t_custom tc) { }
+bool settingsIsOptionBitSet(bitfieldOptions_t bit) { return false; }
+bool settingsRestoreDefaultSettings(void) { return true; }
+bool settingsSaveSettings(bool includeVFOs) { return true; }
+void soundInit(void) { }
+void uiCPSUpdate(uiCPSCommand_t command, int x, int y, ucFont_t fontSize, ucTextAlign_t alignment, bool isInverted, char *szMsg) { }
+bool usbBenchmarkStart(usbBenchmarkMode_t mode, uint32_t packetSize, uint32_t duration) { return false; }
+bool usbBenchmarkTick(void) { return false; }
+void usbBenchmarkGetResults(usbBenchmarkResults_t *results) { memset(results, 0, sizeof(usbBenchmarkResults_t)); }
+bool voicePromptsCheckMagicAndVersion(uint32_t *bufferAddress) { return false; }
+bool SPI0ShadowGet(uint8_t page, uint8_t reg, uint8_t *val) { return false; }
+void SPI0ShadowGetStats(uint32_t *written, uint32_t *skipped) { *written = 0; *skipped = 0; }
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef _OPENGD77_USB_COM_SIM_H_
+#define _OPENGD77_USB_COM_SIM_H_
+
+//
+// Simulated surroundings of usb_com.c, shared by the tests which build it: the CDC endpoint, a NOR Flash with
+// non blocking erase and page programming, the EEPROM, the clock, and the fakes of everything else it links against.
+//
+// The Flash only clears bits when a page is programmed, and counts the accesses the driver can't do while the chip
+// is busy, so the tests check what the chip would actually hold.
+//
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SIM_RECEIVED_MAX       (1024U * 1024U)
+#define SIM_FLASH_SIZE         (2U * 1024U * 1024U)
+#define SIM_FLASH_SECTOR_SIZE       4096U
+#define SIM_FLASH_PAGE_SIZE          256U
+#define SIM_EEPROM_SIZE        (64U * 1024U)
+
+typedef struct
+{
+	// CDC endpoint, the accepted packets are appended to received
+	uint8_t  received[SIM_RECEIVED_MAX];
+	uint32_t receivedLength;
+	uint32_t packets;
+	uint32_t busyCalls; // the next calls to CDC_Transmit_FS() that return USBD_BUSY
+
+	// Flash
+	uint8_t  flash[SIM_FLASH_SIZE];
+	uint32_t eraseBusyPolls; // SPI_Flash_isBusy() calls, for each erase and each page program
+	uint32_t pageBusyPolls;
+	uint32_t busyPolls; // left for the current operation
+	bool     stuck; // busy until SPI_Flash_waitForWriteCompletion()
+	bool     failReads;
+	uint32_t erases;
+	uint32_t pagePrograms;
+	uint32_t readsWhileBusy;
+	uint32_t startsWhileBusy;
+	uint32_t programsOverData; // bits a page program would have to set
+
+	uint8_t  eeprom[SIM_EEPROM_SIZE];
+	uint32_t millis; // ticksGetMillis(), advanced by osDelay() and vTaskDelay()
+} usbComSim_t;
+
+extern usbComSim_t sim;
+
+void simReset(void);
+bool simFlashIsBusy(void);
+
+#endif /* _OPENGD77_USB_COM_SIM_H_ */
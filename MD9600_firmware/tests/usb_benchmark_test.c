@@ -0,0 +1,348 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+//
+// usb_benchmark.c against a simulated CDC endpoint.
+//
+// The radio side is the real benchmark code. The host side records what CDC_Transmit_FS() submits and sends it back,
+// split into 64 byte full speed packets (or any other split), through usbBenchmarkFeed(), while the tests drive the
+// millisecond clock and the run time counter.
+//
+#include <string.h>
+#include "testUtils.h"
+#include "main.h"
+#include "usb/usb_com.h"
+#include "usb/usb_benchmark.h"
+#include "functions/cpuStats.h"
+
+#define FS_PACKET_SIZE                64U
+#define ENDPOINT_QUEUE_SIZE           16U
+
+TIM_TypeDef mockTIM5;
+volatile uint8_t usbComSendBuf[COM_BUFFER_SIZE];
+
+typedef struct
+{
+	uint8_t  data[COM_BUFFER_SIZE];
+	uint32_t length;
+} endpointPacket_t;
+
+static struct
+{
+	uint32_t         millis;
+	bool             busy; // CDC_Transmit_FS() refuses the submissions
+	endpointPacket_t sent[ENDPOINT_QUEUE_SIZE];
+	uint32_t         sentCount;
+} endpoint;
+
+uint32_t ticksGetMillis(void)
+{
+	return endpoint.millis;
+}
+
+uint8_t CDC_Transmit_FS(uint8_t *buf, uint16_t len)
+{
+	if (endpoint.busy)
+	{
+		return USBD_BUSY;
+	}
+
+	TEST_CHECK(len <= COM_BUFFER_SIZE);
+
+	endpointPacket_t *packet = &endpoint.sent[endpoint.sentCount % ENDPOINT_QUEUE_SIZE];
+
+	memcpy(packet->data, buf, len);
+	packet->length = len;
+	endpoint.sentCount++;
+
+	return USBD_OK;
+}
+
+static void endpointReset(void)
+{
+	memset(&endpoint, 0, sizeof(endpoint));
+	memset(&mockTIM5, 0, sizeof(mockTIM5));
+}
+
+static void advanceMicroseconds(uint32_t us)
+{
+	mockTIM5.CNT += (us * (CPU_STATS_COUNTER_FREQUENCY / 1000000U));
+}
+
+static void advanceMilliseconds(uint32_t ms)
+{
+	endpoint.millis += ms;
+	advanceMicroseconds(ms * 1000U);
+}
+
+static uint32_t sentSequence(uint32_t index)
+{
+	const uint8_t *data = endpoint.sent[index % ENDPOINT_QUEUE_SIZE].data;
+
+	return (((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3]);
+}
+
+// Sends back a submitted packet, the first chunk has firstChunkSize bytes, the others up to FS_PACKET_SIZE.
+static void echoSplit(uint32_t index, uint32_t firstChunkSize)
+{
+	const endpointPacket_t *packet = &endpoint.sent[index % ENDPOINT_QUEUE_SIZE];
+	uint32_t offset = 0;
+	uint32_t chunk = firstChunkSize;
+
+	while (offset < packet->length)
+	{
+		if (chunk > (packet->length - offset))
+		{
+			chunk = (packet->length - offset);
+		}
+
+		usbBenchmarkFeed(&packet->data[offset], chunk);
+		offset += chunk;
+		chunk = FS_PACKET_SIZE;
+	}
+}
+
+static void echo(uint32_t index)
+{
+	echoSplit(index, FS_PACKET_SIZE);
+}
+
+static void testStartRejectsInvalidParameters(void)
+{
+	endpointReset();
+
+	TEST_CHECK(usbBenchmarkStart(0, 64, 1000) == false);
+	TEST_CHECK(usbBenchmarkStart(USB_BENCHMARK_MODE_SOURCE + 1, 64, 1000) == false);
+	TEST_CHECK(usbBenchmarkStart(USB_BENCHMARK_MODE_ECHO, 3, 1000) == false);
+	TEST_CHECK(usbBenchmarkStart(USB_BENCHMARK_MODE_ECHO, (COM_BUFFER_SIZE + 1), 1000) == false);
+	TEST_CHECK(usbBenchmarkStart(USB_BENCHMARK_MODE_ECHO, 64, 0) == false);
+	TEST_CHECK(usbBenchmarkStart(USB_BENCHMARK_MODE_ECHO, 64, (USB_BENCHMARK_DURATION_MAX + 1)) == false);
+	TEST_CHECK(usbBenchmarkTick() == false);
+}
+
+static void testEchoRoundTrip(void)
+{
+	usbBenchmarkResults_t results;
+
+	endpointReset();
+	TEST_CHECK(usbBenchmarkStart(USB_BENCHMARK_MODE_ECHO, 200, 1000));
+
+	TEST_CHECK(usbBenchmarkTick());
+	TEST_CHECK(endpoint.sentCount == 1);
+	TEST_CHECK(endpoint.sent[0].length == 200);
+	TEST_CHECK(sentSequence(0) == 0);
+
+	// Only one probe in flight
+	TEST_CHECK(usbBenchmarkTick());
+	TEST_CHECK(endpoint.sentCount == 1);
+
+	advanceMicroseconds(250);
+	echo(0);
+
+	usbBenchmarkGetResults(&results);
+	TEST_CHECK(results.rttSamples == 1);
+	TEST_CHECK(results.rttLost == 0);
+	TEST_CHECK(results.rttMin == 250);
+	TEST_CHECK(results.rttMax == 250);
+	TEST_CHECK(results.rttP50 == 300);
+	TEST_CHECK(results.rxBytes == 200);
+	TEST_CHECK(results.rxPackets == 4);
+
+	// The next probe goes out on the next tick
+	TEST_CHECK(usbBenchmarkTick());
+	TEST_CHECK(endpoint.sentCount == 2);
+	TEST_CHECK(sentSequence(1) == 1);
+}
+
+static void testEchoSequenceSplitOverPackets(void)
+{
+	usbBenchmarkResults_t results;
+
+	endpointReset();
+	TEST_CHECK(usbBenchmarkStart(USB_BENCHMARK_MODE_ECHO, 64, 1000));
+	TEST_CHECK(usbBenchmarkTick());
+
+	advanceMicroseconds(1000);
+	echoSplit(0, 1);
+	usbBenchmarkGetResults(&results);
+	TEST_CHECK(results.rttSamples == 1);
+	TEST_CHECK(results.rttMin == 1000);
+	TEST_CHECK(results.rxPackets == 2);
+}
+
+static void testEchoRoundTripAcrossTheCounterWrap(void)
+{
+	usbBenchmarkResults_t results;
+
+	endpointReset();
+	mockTIM5.CNT = 0xFFFFFF00U;
+	TEST_CHECK(usbBenchmarkStart(USB_BENCHMARK_MODE_ECHO, 64, 1000));
+	TEST_CHECK(usbBenchmarkTick());
+
+	advanceMicroseconds(2500);
+	echo(0);
+	usbBenchmarkGetResults(&results);
+	TEST_CHECK(results.rttSamples == 1);
+	TEST_CHECK(results.rttMin == 2500);
+}
+
+static void testEchoLateEchoIsDropped(void)
+{
+	usbBenchmarkResults_t results;
+
+	endpointReset();
+	TEST_CHECK(usbBenchmarkStart(USB_BENCHMARK_MODE_ECHO, 128, 10000));
+	TEST_CHECK(usbBenchmarkTick());
+	TEST_CHECK(endpoint.sentCount == 1);
+
+	// Probe 0 times out, probe 1 is sent
+	advanceMilliseconds(USB_BENCHMARK_PROBE_TIMEOUT);
+	TEST_CHECK(usbBenchmarkTick());
+	TEST_CHECK(endpoint.sentCount == 2);
+	TEST_CHECK(sentSequence(1) == 1);
+
+	// The echo of probe 0 finally arrives, it must not complete probe 1
+	advanceMicroseconds(100);
+	echo(0);
+	usbBenchmarkGetResults(&results);
+	TEST_CHECK(results.rttLost == 1);
+	TEST_CHECK(results.rttSamples == 0);
+	TEST_CHECK(results.rxBytes == 128);
+
+	TEST_CHECK(usbBenchmarkTick());
+	TEST_CHECK(endpoint.sentCount == 2);
+
+	advanceMicroseconds(400);
+	echo(1);
+	usbBenchmarkGetResults(&results);
+	TEST_CHECK(results.rttSamples == 1);
+	TEST_CHECK(results.rttMin == 500);
+	TEST_CHECK(results.rttLost == 1);
+}
+
+static void testEchoTruncatedSequenceIsDropped(void)
+{
+	const uint8_t wrongSequence[4] = { 0x00, 0x00, 0x00, 0x07 };
+	usbBenchmarkResults_t results;
+
+	endpointReset();
+	TEST_CHECK(usbBenchmarkStart(USB_BENCHMARK_MODE_ECHO, 64, 1000));
+	TEST_CHECK(usbBenchmarkTick());
+
+	usbBenchmarkFeed(&wrongSequence[0], 2);
+	usbBenchmarkFeed(&wrongSequence[2], 2);
+	usbBenchmarkGetResults(&results);
+	TEST_CHECK(results.rttSamples == 0);
+
+	advanceMicroseconds(100);
+	echo(0);
+	usbBenchmarkGetResults(&results);
+	TEST_CHECK(results.rttSamples == 1);
+}
+
+static void testSinkCountsReceivedData(void)
+{
+	const uint8_t packet[FS_PACKET_SIZE] = { 0 };
+	usbBenchmarkResults_t results;
+
+	endpointReset();
+	TEST_CHECK(usbBenchmarkStart(USB_BENCHMARK_MODE_SINK, 64, 1000));
+
+	for (int i = 0; i < 10; i++)
+	{
+		usbBenchmarkFeed(packet, sizeof(packet));
+		TEST_CHECK(usbBenchmarkTick());
+	}
+
+	TEST_CHECK(endpoint.sentCount == 0);
+	usbBenchmarkGetResults(&results);
+	TEST_CHECK(results.rxBytes == (10 * FS_PACKET_SIZE));
+	TEST_CHECK(results.rxPackets == 10);
+	TEST_CHECK(results.rttSamples == 0);
+}
+
+static void testSourceStopsWhenTheEndpointIsBusy(void)
+{
+	usbBenchmarkResults_t results;
+
+	endpointReset();
+	TEST_CHECK(usbBenchmarkStart(USB_BENCHMARK_MODE_SOURCE, 512, 1000));
+
+	TEST_CHECK(usbBenchmarkTick());
+	TEST_CHECK(endpoint.sentCount == 4);
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		TEST_CHECK(sentSequence(i) == i);
+	}
+
+	endpoint.busy = true;
+	TEST_CHECK(usbBenchmarkTick());
+	TEST_CHECK(endpoint.sentCount == 4);
+
+	endpoint.busy = false;
+	TEST_CHECK(usbBenchmarkTick());
+	TEST_CHECK(endpoint.sentCount == 8);
+	TEST_CHECK(sentSequence(4) == 4);
+
+	usbBenchmarkGetResults(&results);
+	TEST_CHECK(results.txPackets == 8);
+	TEST_CHECK(results.txBytes == (8 * 512));
+}
+
+static void testStopsAfterTheDuration(void)
+{
+	usbBenchmarkResults_t results;
+
+	endpointReset();
+	TEST_CHECK(usbBenchmarkStart(USB_BENCHMARK_MODE_SINK, 64, 100));
+	advanceMilliseconds(99);
+	TEST_CHECK(usbBenchmarkTick());
+	advanceMilliseconds(2);
+	TEST_CHECK(usbBenchmarkTick() == false);
+
+	// Ignored once stopped
+	usbBenchmarkFeed((const uint8_t *)"data", 4);
+
+	advanceMilliseconds(50);
+	usbBenchmarkGetResults(&results);
+	TEST_CHECK(results.duration == 101);
+	TEST_CHECK(results.rxBytes == 0);
+}
+
+int main(void)
+{
+	TEST_RUN(testStartRejectsInvalidParameters);
+	TEST_RUN(testEchoRoundTrip);
+	TEST_RUN(testEchoSequenceSplitOverPackets);
+	TEST_RUN(testEchoRoundTripAcrossTheCounterWrap);
+	TEST_RUN(testEchoLateEchoIsDropped);
+	TEST_RUN(testEchoTruncatedSequenceIsDropped);
+	TEST_RUN(testSinkCountsReceivedData);
+	TEST_RUN(testSourceStopsWhenTheEndpointIsBusy);
+	TEST_RUN(testStopsAfterTheDuration);
+
+	return EXIT_SUCCESS;
+}
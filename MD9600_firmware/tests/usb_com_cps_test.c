@@ -0,0 +1,628 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+//
+// The CPS side of usb_com.c against a simulated CDC endpoint and NOR Flash (usbComSim.c): the sector writes
+// ('X' 1, 2 and 3) with the byte coverage bitmap and the two 4KB sector buffers (one filled by the CPS while the
+// other one is erased and programmed in the background), the erase and page program timeouts, the sector hashes
+// ('H') and the streamed reads ('S').
+//
+// The CPS is modelled as the host which sends one request, waits for its reply, and lets the radio task run a few
+// ticks in between, so the background programming overlaps with the next requests as it does on the radio.
+//
+#include <string.h>
+#include "testUtils.h"
+#include "main.h"
+#include "functions/calibration.h"
+#include "functions/codeplug.h"
+#include "functions/crc32.h"
+#include "functions/settings.h"
+#include "usb/usb_com.h"
+#include "usbComSim.h"
+
+#define SECTOR_SIZE              4096U
+#define SECTOR_PAGES               16U
+#define CPS_ACCESS_FLASH            1U
+#define CPS_ACCESS_EEPROM           2U
+#define WRITE_DATA_MAX    (COM_REQUESTBUFFER_SIZE - 8)
+#define TEST_AREA            0x40000U // away from the calibration, codeplug and voice prompts special cases
+#define TEST_SECTORS               32U
+#define CALIBRATION_ADDRESS  0x10000U
+#define CALIBRATION_SIZE       0x200U
+
+static uint8_t expected[SIM_FLASH_SIZE]; // what the Flash should hold
+static uint32_t seed = 0x43505321;
+static uint32_t ticksBetweenRequests = 2;
+
+static void tick(void)
+{
+	sim.millis++;
+	tick_com_request();
+}
+
+static void waitIdle(void)
+{
+	for (uint32_t i = 0; usbComHasPendingWork(); i++)
+	{
+		TEST_CHECK(i < 100000);
+		tick();
+	}
+}
+
+// Sends a request, returns the reply length (the reply is at the end of sim.received)
+static uint32_t request(const uint8_t *data, uint32_t length, const uint8_t **reply)
+{
+	uint32_t start = sim.receivedLength;
+
+	TEST_CHECK(length <= COM_REQUESTBUFFER_SIZE);
+	memcpy((uint8_t *)com_requestbuffer, data, length);
+	com_request = 1;
+	tick();
+	TEST_CHECK(com_request == 0);
+	TEST_CHECK(mockCriticalNesting == 0);
+
+	*reply = &sim.received[start];
+	uint32_t replyLength = (sim.receivedLength - start);
+
+	for (uint32_t i = 0; i < ticksBetweenRequests; i++)
+	{
+		tick();
+	}
+
+	return replyLength;
+}
+
+static void put32(uint8_t *buffer, uint32_t value)
+{
+	buffer[0] = (value >> 24);
+	buffer[1] = (value >> 16);
+	buffer[2] = (value >> 8);
+	buffer[3] = (value >> 0);
+}
+
+static bool writeCommand(uint8_t step, const uint8_t *parameters, uint32_t length)
+{
+	uint8_t buffer[COM_REQUESTBUFFER_SIZE];
+	const uint8_t *reply;
+
+	buffer[0] = 'X';
+	buffer[1] = step;
+	memcpy(&buffer[2], parameters, length);
+
+	uint32_t replyLength = request(buffer, (2 + length), &reply);
+
+	if ((replyLength == 2) && (reply[0] == 'X') && (reply[1] == step))
+	{
+		return true;
+	}
+
+	TEST_CHECK((replyLength == 1) && (reply[0] == '-'));
+	return false;
+}
+
+static bool prepareSector(uint32_t sector)
+{
+	uint8_t parameters[3] = { (sector >> 16), (sector >> 8), sector };
+
+	return writeCommand(1, parameters, sizeof(parameters));
+}
+
+static bool sendData(uint32_t address, const uint8_t *data, uint32_t length)
+{
+	uint8_t parameters[6 + WRITE_DATA_MAX];
+
+	TEST_CHECK(length <= WRITE_DATA_MAX);
+	put32(parameters, address);
+	parameters[4] = (length >> 8);
+	parameters[5] = length;
+	memcpy(&parameters[6], data, length);
+
+	return writeCommand(2, parameters, (6 + length));
+}
+
+static bool writeSector(void)
+{
+	return writeCommand(3, NULL, 0);
+}
+
+// Sends the given bytes of a sector, in random sized chunks. The parts of the sector which aren't sent must keep
+// what the Flash held.
+static bool uploadSector(uint32_t sector, const uint8_t *data, uint32_t from, uint32_t to)
+{
+	uint32_t address = (sector * SECTOR_SIZE);
+
+	TEST_CHECK(prepareSector(sector));
+
+	for (uint32_t offset = from; offset < to; )
+	{
+		uint32_t length = (1 + (testRandom(&seed) % 600));
+
+		if (length > (to - offset))
+		{
+			length = (to - offset);
+		}
+
+		TEST_CHECK(sendData(address + offset, &data[offset], length));
+		offset += length;
+	}
+
+	if (writeSector())
+	{
+		memcpy(&expected[address + from], &data[from], (to - from));
+		return true;
+	}
+
+	return false;
+}
+
+static void fillRandom(uint8_t *data, uint32_t length)
+{
+	for (uint32_t i = 0; i < length; i++)
+	{
+		data[i] = testRandom(&seed);
+	}
+}
+
+static void checkFlash(void)
+{
+	TEST_CHECK(memcmp(sim.flash, expected, SIM_FLASH_SIZE) == 0);
+	TEST_CHECK(sim.readsWhileBusy == 0);
+	TEST_CHECK(sim.startsWhileBusy == 0);
+	TEST_CHECK(sim.programsOverData == 0);
+}
+
+static void resetRadio(uint32_t eraseBusyPolls, uint32_t pageBusyPolls)
+{
+	waitIdle();
+	simReset();
+	sim.eraseBusyPolls = eraseBusyPolls;
+	sim.pageBusyPolls = pageBusyPolls;
+
+	// Some old content, which partial writes must keep
+	fillRandom(sim.flash, SIM_FLASH_SIZE);
+	memcpy(expected, sim.flash, SIM_FLASH_SIZE);
+	ticksBetweenRequests = 2;
+}
+
+// Whole sectors: the coverage is complete, the Flash is never read, and every sector is erased and programmed once
+static void testWholeSectors(void)
+{
+	uint8_t data[SECTOR_SIZE];
+
+	resetRadio(30, 3);
+
+	for (uint32_t s = 0; s < TEST_SECTORS; s++)
+	{
+		fillRandom(data, SECTOR_SIZE);
+		TEST_CHECK(uploadSector(((TEST_AREA / SECTOR_SIZE) + s), data, 0, SECTOR_SIZE));
+	}
+	waitIdle();
+
+	checkFlash();
+	TEST_CHECK(sim.erases == TEST_SECTORS);
+	TEST_CHECK(sim.pagePrograms == (TEST_SECTORS * SECTOR_PAGES));
+}
+
+// Partial sectors: the bytes the CPS didn't send are read back from the Flash, once the previous sector (which
+// may be the same one) is programmed
+static void testPartialSectors(void)
+{
+	uint8_t data[SECTOR_SIZE];
+	static const uint32_t RANGES[][2] = { { 0, 1 }, { 4095, 4096 }, { 100, 3000 }, { 0, 2048 }, { 2048, 4096 }, { 255, 257 }, { 1, 4095 } };
+
+	resetRadio(40, 5);
+
+	for (uint32_t r = 0; r < (sizeof(RANGES) / sizeof(RANGES[0])); r++)
+	{
+		uint32_t sector = ((TEST_AREA / SECTOR_SIZE) + (r % 3));
+
+		fillRandom(data, SECTOR_SIZE);
+		TEST_CHECK(uploadSector(sector, data, RANGES[r][0], RANGES[r][1]));
+	}
+	waitIdle();
+	checkFlash();
+
+	// Holes in the middle, the same sector over and over, no tick between the requests
+	ticksBetweenRequests = 0;
+	for (uint32_t i = 0; i < 20; i++)
+	{
+		uint32_t sector = (TEST_AREA / SECTOR_SIZE);
+		uint32_t address = (sector * SECTOR_SIZE);
+
+		fillRandom(data, SECTOR_SIZE);
+		TEST_CHECK(prepareSector(sector));
+		for (uint32_t offset = (i * 7); offset < SECTOR_SIZE; offset += 200)
+		{
+			uint32_t length = (((offset + 100) > SECTOR_SIZE) ? (SECTOR_SIZE - offset) : 100);
+
+			TEST_CHECK(sendData(address + offset, &data[offset], length));
+			memcpy(&expected[address + offset], &data[offset], length);
+		}
+		TEST_CHECK(writeSector());
+	}
+	waitIdle();
+	checkFlash();
+}
+
+// The CPS fills one buffer while the other one is programmed: the data requests of the next sector are answered
+// without waiting for the programming, and don't corrupt the sector being programmed
+static void testDoubleBuffering(void)
+{
+	uint8_t data[2][SECTOR_SIZE];
+	uint32_t sector = (TEST_AREA / SECTOR_SIZE);
+
+	resetRadio(200, 5); // erase and programming take about 280 ticks
+
+	fillRandom(data[0], SECTOR_SIZE);
+	fillRandom(data[1], SECTOR_SIZE);
+	TEST_CHECK(uploadSector(sector, data[0], 0, SECTOR_SIZE));
+
+	// The next sector is sent while the first one is being programmed
+	uint32_t millis = sim.millis;
+
+	TEST_CHECK(prepareSector(sector + 1));
+	for (uint32_t offset = 0; offset < SECTOR_SIZE; offset += 512)
+	{
+		TEST_CHECK(sendData(((sector + 1) * SECTOR_SIZE) + offset, &data[1][offset], 512));
+	}
+	TEST_CHECK((sim.millis - millis) == (9 * (1 + ticksBetweenRequests))); // no wait
+	TEST_CHECK(usbComHasPendingWork());
+	TEST_CHECK(sim.pagePrograms < SECTOR_PAGES);
+
+	// Its write waits for the first sector, then starts programming this one
+	TEST_CHECK(writeSector());
+	memcpy(&expected[(sector + 1) * SECTOR_SIZE], data[1], SECTOR_SIZE);
+	TEST_CHECK(sim.pagePrograms == SECTOR_PAGES);
+	TEST_CHECK(sim.erases == 2);
+
+	// A read waits for the programming as well
+	const uint8_t *reply;
+	uint8_t read[8] = { 'R', CPS_ACCESS_FLASH };
+
+	put32(&read[2], ((sector + 1) * SECTOR_SIZE));
+	read[6] = 0;
+	read[7] = 16;
+	TEST_CHECK(request(read, sizeof(read), &reply) == (3 + 16));
+	TEST_CHECK(memcmp(&reply[3], data[1], 16) == 0);
+	TEST_CHECK(sim.pagePrograms == (2 * SECTOR_PAGES));
+
+	checkFlash();
+}
+
+// A chip that stays busy fails the job after the erase (or page) timeout, which the next request reports
+static void testTimeouts(void)
+{
+	uint8_t data[SECTOR_SIZE];
+	uint32_t sector = (TEST_AREA / SECTOR_SIZE);
+	uint8_t erased[SECTOR_SIZE];
+
+	memset(erased, 0xFF, sizeof(erased));
+	fillRandom(data, SECTOR_SIZE);
+
+	for (uint32_t stuckAfterPages = 0; stuckAfterPages < 2; stuckAfterPages++)
+	{
+		resetRadio(5, 2);
+
+		TEST_CHECK(uploadSector(sector, data, 0, SECTOR_SIZE));
+		memcpy(&expected[sector * SECTOR_SIZE], erased, SECTOR_SIZE); // erased, then programming stops
+
+		// Stuck during the erase, or during the first page
+		while (sim.pagePrograms < stuckAfterPages)
+		{
+			tick();
+		}
+		sim.stuck = true;
+
+		uint32_t start = sim.millis;
+
+		for (uint32_t i = 0; i < 1000; i++)
+		{
+			tick();
+		}
+		TEST_CHECK(usbComHasPendingWork() == false);
+
+		// The data request of the next sector doesn't wait, its write reports the failure
+		TEST_CHECK(prepareSector(sector + 1));
+		TEST_CHECK(sendData(((sector + 1) * SECTOR_SIZE), data, 100));
+		TEST_CHECK(writeSector() == false);
+		TEST_CHECK(sim.erases == 1);
+
+		// The pages programmed before the chip got stuck
+		memcpy(&expected[sector * SECTOR_SIZE], data, (stuckAfterPages * 256));
+		checkFlash();
+		TEST_CHECK((sim.millis - start) > 10);
+
+		// Only once, the chip is fine again
+		TEST_CHECK(uploadSector(sector + 1, data, 0, SECTOR_SIZE));
+		waitIdle();
+		checkFlash();
+	}
+
+	// A failure is also reported to a request which isn't a sector write
+	resetRadio(5, 2);
+	TEST_CHECK(uploadSector(sector, data, 0, SECTOR_SIZE));
+	memcpy(&expected[sector * SECTOR_SIZE], erased, SECTOR_SIZE);
+	sim.stuck = true;
+	for (uint32_t i = 0; i < 1000; i++)
+	{
+		tick();
+	}
+
+	const uint8_t *reply;
+	uint8_t read[8] = { 'R', CPS_ACCESS_FLASH, 0, 0, 0, 0, 0, 16 };
+
+	TEST_CHECK((request(read, sizeof(read), &reply) == 1) && (reply[0] == '-'));
+	TEST_CHECK(request(read, sizeof(read), &reply) == (3 + 16));
+	checkFlash();
+}
+
+// Sector hashes: the CPS only rewrites the sectors which differ
+static void testHashes(void)
+{
+	uint8_t data[SECTOR_SIZE];
+	uint8_t hash[8] = { 'H', CPS_ACCESS_FLASH };
+	const uint8_t *reply;
+	const uint32_t COUNT_MAX = ((COM_BUFFER_SIZE - 3) / 4);
+
+	resetRadio(10, 2);
+
+	for (uint32_t s = 0; s < TEST_SECTORS; s += 5)
+	{
+		fillRandom(data, SECTOR_SIZE);
+		TEST_CHECK(uploadSector(((TEST_AREA / SECTOR_SIZE) + s), data, 0, SECTOR_SIZE));
+	}
+
+	// The hashes follow the last write, which is still being programmed
+	put32(&hash[2], TEST_AREA);
+	hash[6] = 0;
+	hash[7] = TEST_SECTORS;
+	TEST_CHECK(request(hash, sizeof(hash), &reply) == (3 + (TEST_SECTORS * 4)));
+	TEST_CHECK((reply[0] == 'H') && (reply[1] == 0) && (reply[2] == TEST_SECTORS));
+
+	for (uint32_t s = 0; s < TEST_SECTORS; s++)
+	{
+		uint32_t crc = crc32Update(0, &expected[TEST_AREA + (s * SECTOR_SIZE)], SECTOR_SIZE);
+
+		TEST_CHECK(reply[3 + (s * 4)] == (uint8_t)(crc >> 24));
+		TEST_CHECK(reply[4 + (s * 4)] == (uint8_t)(crc >> 16));
+		TEST_CHECK(reply[5 + (s * 4)] == (uint8_t)(crc >> 8));
+		TEST_CHECK(reply[6 + (s * 4)] == (uint8_t)(crc >> 0));
+	}
+
+	// Clamped to one reply
+	hash[6] = 0xFF;
+	hash[7] = 0xFF;
+	put32(&hash[2], 0);
+	TEST_CHECK(request(hash, sizeof(hash), &reply) == (3 + (COUNT_MAX * 4)));
+	TEST_CHECK((((reply[1] << 8) | reply[2])) == COUNT_MAX);
+
+	// Rejected: other area, no sector, past the end of the Flash
+	hash[1] = CPS_ACCESS_EEPROM;
+	hash[7] = 1;
+	TEST_CHECK((request(hash, sizeof(hash), &reply) == 1) && (reply[0] == '-'));
+	hash[1] = CPS_ACCESS_FLASH;
+	hash[6] = hash[7] = 0;
+	TEST_CHECK((request(hash, sizeof(hash), &reply) == 1) && (reply[0] == '-'));
+	put32(&hash[2], (SIM_FLASH_SIZE - SECTOR_SIZE));
+	hash[7] = 2;
+	TEST_CHECK((request(hash, sizeof(hash), &reply) == 1) && (reply[0] == '-'));
+
+	checkFlash();
+}
+
+static uint32_t streamRead(uint8_t access, uint32_t address, uint32_t length, uint8_t *data)
+{
+	uint8_t stream[10] = { 'S', access };
+	const uint8_t *reply;
+	uint32_t start = sim.receivedLength;
+
+	put32(&stream[2], address);
+	put32(&stream[6], length);
+
+	uint32_t replyLength = request(stream, sizeof(stream), &reply);
+
+	if (replyLength == 1)
+	{
+		TEST_CHECK(reply[0] == '-');
+		return 0;
+	}
+
+	TEST_CHECK((replyLength >= 6) && (reply[0] == 'S') && (reply[1] == access) && (memcmp(&reply[2], &stream[6], 4) == 0));
+
+	for (uint32_t i = 0; usbComHasPendingWork(); i++)
+	{
+		TEST_CHECK(i < 100000);
+
+		// The endpoint is busy now and then, the chunk is sent again on the next tick
+		if ((testRandom(&seed) % 4) == 0)
+		{
+			sim.busyCalls = 1;
+		}
+		tick();
+	}
+
+	uint32_t received = (sim.receivedLength - start - 6);
+
+	memcpy(data, &sim.received[start + 6], received);
+	return received;
+}
+
+// Streamed reads, with the calibration and VFOs replaced as the single reads do
+static void testStreamedReads(void)
+{
+	static uint8_t data[SIM_FLASH_SIZE];
+	static uint8_t reference[SIM_FLASH_SIZE];
+	uint8_t *calibration = calibrationGetLocalDataPointer();
+
+	resetRadio(10, 2);
+	fillRandom(calibration, CALIBRATION_SIZE);
+	fillRandom((uint8_t *)settingsVFOChannel, sizeof(settingsVFOChannel));
+	fillRandom(sim.eeprom, SIM_EEPROM_SIZE);
+
+	// From before the calibration to past the VFOs
+	uint32_t length = streamRead(CPS_ACCESS_FLASH, 0xF000, 0x80000, data);
+
+	TEST_CHECK(length == 0x80000);
+	memcpy(reference, &sim.flash[0xF000], length);
+	memcpy(&reference[CALIBRATION_ADDRESS - 0xF000], calibration, CALIBRATION_SIZE);
+	TEST_CHECK(memcmp(data, reference, length) == 0);
+
+	length = streamRead(CPS_ACCESS_FLASH, 0x7000, 0x1000, data);
+	TEST_CHECK(length == 0x1000);
+	memcpy(reference, &sim.flash[0x7000], length);
+	memcpy(&reference[CODEPLUG_ADDR_VFO_A_CHANNEL - 0x7000], &settingsVFOChannel[0], CODEPLUG_CHANNEL_DATA_STRUCT_SIZE); // packed
+	memcpy(&reference[CODEPLUG_ADDR_VFO_A_CHANNEL - 0x7000 + CODEPLUG_CHANNEL_DATA_STRUCT_SIZE], &settingsVFOChannel[1], CODEPLUG_CHANNEL_DATA_STRUCT_SIZE);
+	TEST_CHECK(memcmp(data, reference, length) == 0);
+
+	length = streamRead(CPS_ACCESS_EEPROM, 0x100, 0x8000, data);
+	TEST_CHECK((length == 0x8000) && (memcmp(data, &sim.eeprom[0x100], length) == 0));
+
+	// Odd lengths
+	for (uint32_t i = 0; i < 50; i++)
+	{
+		uint32_t address = (TEST_AREA + (testRandom(&seed) % 0x10000));
+		uint32_t size = (1 + (testRandom(&seed) % 10000));
+
+		TEST_CHECK(streamRead(CPS_ACCESS_FLASH, address, size, data) == size);
+		TEST_CHECK(memcmp(data, &sim.flash[address], size) == 0);
+	}
+
+	// A read error aborts the stream (the CPS times out), a new request aborts it too
+	sim.failReads = true;
+	TEST_CHECK(streamRead(CPS_ACCESS_FLASH, TEST_AREA, 0x10000, data) == 0);
+	sim.failReads = false;
+	TEST_CHECK(usbComHasPendingWork() == false);
+
+	uint8_t stream[10] = { 'S', CPS_ACCESS_FLASH };
+	const uint8_t *reply;
+
+	put32(&stream[2], TEST_AREA);
+	put32(&stream[6], 0x10000);
+	ticksBetweenRequests = 0;
+	request(stream, sizeof(stream), &reply);
+	tick();
+	TEST_CHECK(usbComHasPendingWork());
+	uint8_t read[8] = { 'R', CPS_ACCESS_FLASH, 0, 0, 0, 0, 0, 16 };
+	TEST_CHECK(request(read, sizeof(read), &reply) == (3 + 16));
+	TEST_CHECK(usbComHasPendingWork() == false);
+
+	// Rejected: unknown area, no data
+	TEST_CHECK(streamRead(CPS_ACCESS_FLASH + 5, 0, 16, data) == 0);
+	TEST_CHECK(streamRead(CPS_ACCESS_FLASH, 0, 0, data) == 0);
+}
+
+// The local calibration sector is kept in RAM, and saved by the sector write
+static void testCalibrationSector(void)
+{
+	uint8_t data[CALIBRATION_SIZE];
+	uint8_t *calibration = calibrationGetLocalDataPointer();
+
+	resetRadio(10, 2);
+	fillRandom(data, CALIBRATION_SIZE);
+
+	TEST_CHECK(prepareSector(CALIBRATION_ADDRESS / SECTOR_SIZE));
+	TEST_CHECK(sendData(CALIBRATION_ADDRESS, data, CALIBRATION_SIZE));
+	TEST_CHECK(writeSector());
+	waitIdle();
+
+	TEST_CHECK(memcmp(calibration, data, CALIBRATION_SIZE) == 0);
+	TEST_CHECK(sim.erases == 0);
+	checkFlash();
+}
+
+// Random uploads, as a CPS doing differential writes would
+static void testRandomUploads(void)
+{
+	uint8_t data[SECTOR_SIZE];
+
+	resetRadio(0, 0);
+
+	for (uint32_t i = 0; i < 400; i++)
+	{
+		uint32_t sector = ((TEST_AREA / SECTOR_SIZE) + (testRandom(&seed) % TEST_SECTORS));
+		uint32_t from = (testRandom(&seed) % SECTOR_SIZE);
+		uint32_t to = (from + 1 + (testRandom(&seed) % (SECTOR_SIZE - from)));
+
+		if ((i % 4) == 0)
+		{
+			from = 0;
+			to = SECTOR_SIZE;
+		}
+
+		sim.eraseBusyPolls = (testRandom(&seed) % 60);
+		sim.pageBusyPolls = (testRandom(&seed) % 6);
+		ticksBetweenRequests = (testRandom(&seed) % 4);
+		fillRandom(data, SECTOR_SIZE);
+		TEST_CHECK(uploadSector(sector, data, from, to));
+	}
+	waitIdle();
+	checkFlash();
+}
+
+static void benchmarkUpload(void)
+{
+	static uint8_t data[TEST_SECTORS * SECTOR_SIZE];
+
+	resetRadio(0, 0);
+	ticksBetweenRequests = 0;
+	fillRandom(data, sizeof(data));
+
+	uint64_t start = testGetNanoseconds();
+
+	for (uint32_t s = 0; s < TEST_SECTORS; s++)
+	{
+		uint32_t address = (TEST_AREA + (s * SECTOR_SIZE));
+
+		TEST_CHECK(prepareSector(address / SECTOR_SIZE));
+		for (uint32_t offset = 0; offset < SECTOR_SIZE; offset += 1024)
+		{
+			TEST_CHECK(sendData(address + offset, &data[(s * SECTOR_SIZE) + offset], 1024));
+		}
+		TEST_CHECK(writeSector());
+	}
+	waitIdle();
+
+	uint64_t elapsed = (testGetNanoseconds() - start);
+
+	memcpy(&expected[TEST_AREA], data, sizeof(data));
+	checkFlash();
+	printf("  %.1f us per 4KB sector (radio side, simulated Flash)\n", ((double)elapsed / 1000.0) / TEST_SECTORS);
+}
+
+int main(void)
+{
+	TEST_RUN(testWholeSectors);
+	TEST_RUN(testPartialSectors);
+	TEST_RUN(testDoubleBuffering);
+	TEST_RUN(testTimeouts);
+	TEST_RUN(testHashes);
+	TEST_RUN(testStreamedReads);
+	TEST_RUN(testCalibrationSector);
+	TEST_RUN(testRandomUploads);
+	TEST_RUN(benchmarkUpload);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,554 @@
+/*
+ * Copyright (C) 2024 Roger Clark, VK3KYY / G4KYF
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+ *    in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * 4. Use of this source code or binary releases for commercial purposes is strictly forbidden. This includes, without limitation,
+ *    incorporation in a commercial product or incorporation into a product or project which allows commercial use.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+//
+// The MMDVM frames parser of usb_com.c (usbComMMDVMParserFeed() and the frames queue), fed with USB transfers
+// replayed as the CDC receive callback gets them: 64 bytes packets, a short one ending the transfer.
+//
+// Frames split over several packets and several frames coalesced in one transfer, the wrap of the frames to the
+// start of com_requestbuffer, the queue and buffer overflows (the frame is skipped, the next one is parsed), the
+// resync after a bad length and the truncated frames. Then long random runs with a slow consumer, and a benchmark.
+//
+#include <string.h>
+#include "testUtils.h"
+#include "main.h"
+#include "usb/usb_com.h"
+#include "usbComSim.h"
+
+#define PACKET_SIZE           64U
+#define FRAME_LENGTH_MIN       7U // start, length, sequence number (32 bits), one byte of pattern
+#define TRANSFER_MAX        4096U
+#define RANDOM_FRAMES     200000U
+#define BENCHMARK_FRAMES 2000000U
+#define BENCHMARK_DMR_FRAME_LENGTH 37U // 0xE0, length, command, slot, 33 bytes payload
+
+// Frames sent, which may still be in the parser queue
+typedef struct
+{
+	uint8_t  length;
+	uint32_t sequence;
+} sentFrame_t;
+
+static uint32_t sequence;
+
+// 0xE0, length, then the sequence number and a pattern which depends on it (with plenty of 0xE0 bytes,
+// which mustn't be taken for frame starts)
+static uint32_t makeFrame(uint8_t *frame, uint8_t length, uint32_t frameSequence)
+{
+	frame[0] = 0xE0;
+	frame[1] = length;
+	frame[2] = (uint8_t)(frameSequence >> 24);
+	frame[3] = (uint8_t)(frameSequence >> 16);
+	frame[4] = (uint8_t)(frameSequence >> 8);
+	frame[5] = (uint8_t)(frameSequence >> 0);
+
+	for (uint32_t i = 6; i < length; i++)
+	{
+		frame[i] = (((frameSequence + i) % 3) == 0) ? 0xE0 : (uint8_t)((frameSequence * 31) + i);
+	}
+
+	return length;
+}
+
+static bool frameMatches(const uint8_t *frame, uint8_t length, const sentFrame_t *sent)
+{
+	uint8_t expected[UINT8_MAX];
+
+	makeFrame(expected, sent->length, sent->sequence);
+
+	return ((length == sent->length) && (memcmp(frame, expected, length) == 0));
+}
+
+// Replays one USB transfer as the CDC receive callback does: 64 bytes packets, the last one ending the transfer if
+// it's short (a transfer which is a multiple of 64 bytes has no end marker).
+static void feedTransfer(const uint8_t *data, uint32_t length)
+{
+	for (uint32_t offset = 0; offset < length; offset += PACKET_SIZE)
+	{
+		uint32_t packet = (((length - offset) > PACKET_SIZE) ? PACKET_SIZE : (length - offset));
+
+		usbComMMDVMParserFeed(&data[offset], packet, (packet < PACKET_SIZE));
+	}
+}
+
+static void resetParser(void)
+{
+	simReset();
+	usbComMMDVMParserReset();
+	sequence = 0;
+}
+
+static void checkStats(uint32_t expectedErrors, uint32_t expectedOverflows)
+{
+	static uint32_t errorsBase;
+	static uint32_t overflowsBase;
+	uint32_t errors;
+	uint32_t overflows;
+
+	// The counters aren't cleared by usbComMMDVMParserReset(), check the changes
+	usbComMMDVMGetParserStats(&errors, &overflows);
+	if (expectedErrors == UINT32_MAX)
+	{
+		errorsBase = errors;
+		overflowsBase = overflows;
+		return;
+	}
+
+	TEST_CHECK((errors - errorsBase) == expectedErrors);
+	TEST_CHECK((overflows - overflowsBase) == expectedOverflows);
+	errorsBase = errors;
+	overflowsBase = overflows;
+}
+
+static void checkAndReleaseFrame(const sentFrame_t *sent)
+{
+	const uint8_t *frame;
+	uint8_t length;
+
+	TEST_CHECK(usbComMMDVMHasFrame());
+	TEST_CHECK(usbComMMDVMPeekFrame(&frame, &length));
+	TEST_CHECK(frameMatches(frame, length, sent));
+	TEST_CHECK((frame >= (const uint8_t *)com_requestbuffer) && ((frame + length) <= (const uint8_t *)&com_requestbuffer[COM_REQUESTBUFFER_SIZE]));
+	usbComMMDVMReleaseFrame();
+}
+
+static void testEmptyQueue(void)
+{
+	const uint8_t *frame = NULL;
+	uint8_t length = 0;
+
+	resetParser();
+	checkStats(UINT32_MAX, 0);
+
+	TEST_CHECK(usbComMMDVMHasFrame() == false);
+	TEST_CHECK(usbComMMDVMPeekFrame(&frame, &length) == false);
+	TEST_CHECK((frame == NULL) && (length == 0));
+	usbComMMDVMReleaseFrame(); // nothing to release
+	TEST_CHECK(usbComMMDVMHasFrame() == false);
+
+	// Bytes which aren't frame starts are ignored
+	static const uint8_t NOISE[] = { 0x00, 0xFF, 0x12, 0xE1 };
+	feedTransfer(NOISE, sizeof(NOISE));
+	TEST_CHECK(usbComMMDVMHasFrame() == false);
+	checkStats(0, 0);
+}
+
+// One frame per transfer, each split in 64 bytes packets
+static void testSplitFrames(void)
+{
+	uint8_t frame[UINT8_MAX];
+
+	resetParser();
+	checkStats(UINT32_MAX, 0);
+
+	for (uint32_t length = 3; length <= UINT8_MAX; length++)
+	{
+		sentFrame_t sent = { .length = length, .sequence = sequence++ };
+
+		if (length < FRAME_LENGTH_MIN)
+		{
+			// Too short for the sequence number, checked byte by byte
+			const uint8_t *parsed;
+			uint8_t parsedLength;
+
+			memset(frame, 0x55, sizeof(frame));
+			frame[0] = 0xE0;
+			frame[1] = length;
+			feedTransfer(frame, length);
+			TEST_CHECK(usbComMMDVMPeekFrame(&parsed, &parsedLength));
+			TEST_CHECK((parsedLength == length) && (memcmp(parsed, frame, length) == 0));
+			usbComMMDVMReleaseFrame();
+			continue;
+		}
+
+		feedTransfer(frame, makeFrame(frame, length, sent.sequence));
+		checkAndReleaseFrame(&sent);
+		TEST_CHECK(usbComMMDVMHasFrame() == false);
+	}
+
+	checkStats(0, 0);
+}
+
+// Several frames in one transfer, straddling the packets
+static void testCoalescedFrames(void)
+{
+	uint8_t transfer[TRANSFER_MAX];
+	sentFrame_t sent[16];
+	static const uint8_t LENGTHS[16] = { 10, 37, 64, 7, 200, 17, 128, 63, 65, 255, 12, 37, 37, 37, 100, 9 };
+	uint32_t length = 0;
+
+	resetParser();
+	checkStats(UINT32_MAX, 0);
+
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		sent[i].length = LENGTHS[i];
+		sent[i].sequence = sequence++;
+		length += makeFrame(&transfer[length], sent[i].length, sent[i].sequence);
+	}
+
+	feedTransfer(transfer, length);
+
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		checkAndReleaseFrame(&sent[i]);
+	}
+	TEST_CHECK(usbComMMDVMHasFrame() == false);
+	checkStats(0, 0);
+}
+
+// Frames are stored contiguously, one which doesn't fit before the end of the buffer goes to its start
+static void testWrap(void)
+{
+	uint8_t frame[UINT8_MAX];
+	sentFrame_t sent[COM_MMDVM_FRAME_QUEUE_SIZE];
+	uint32_t sentCount = 0;
+	uint32_t stored = 0;
+	const uint8_t *parsed;
+	uint8_t parsedLength;
+
+	resetParser();
+	checkStats(UINT32_MAX, 0);
+
+	// Fill the buffer up to less than one frame from its end, releasing the first frame only
+	while ((stored + 200) <= COM_REQUESTBUFFER_SIZE)
+	{
+		sent[sentCount].length = 200;
+		sent[sentCount].sequence = sequence++;
+		feedTransfer(frame, makeFrame(frame, 200, sent[sentCount].sequence));
+		sentCount++;
+		stored += 200;
+	}
+	TEST_CHECK(sentCount < (COM_MMDVM_FRAME_QUEUE_SIZE - 1));
+
+	TEST_CHECK(usbComMMDVMPeekFrame(&parsed, &parsedLength));
+	TEST_CHECK(parsed == (const uint8_t *)com_requestbuffer);
+	checkAndReleaseFrame(&sent[0]);
+
+	// 200 bytes are free at the start: a 200 bytes frame doesn't fit (one byte is kept free), a 199 bytes one does
+	feedTransfer(frame, makeFrame(frame, 200, sequence++));
+	checkStats(0, 1);
+
+	sent[sentCount].length = 199;
+	sent[sentCount].sequence = sequence++;
+	feedTransfer(frame, makeFrame(frame, 199, sent[sentCount].sequence));
+	sentCount++;
+	checkStats(0, 0);
+
+	// The frames are in the order they were received, the last one at the start of the buffer
+	for (uint32_t i = 1; i < sentCount; i++)
+	{
+		TEST_CHECK(usbComMMDVMPeekFrame(&parsed, &parsedLength));
+		if (i == (sentCount - 1))
+		{
+			TEST_CHECK(parsed == (const uint8_t *)com_requestbuffer);
+		}
+		checkAndReleaseFrame(&sent[i]);
+	}
+	TEST_CHECK(usbComMMDVMHasFrame() == false);
+
+	// Empty again, the next frames follow the wrapped one
+	sent[0].length = 50;
+	sent[0].sequence = sequence++;
+	feedTransfer(frame, makeFrame(frame, 50, sent[0].sequence));
+	TEST_CHECK(usbComMMDVMPeekFrame(&parsed, &parsedLength));
+	TEST_CHECK(parsed == (const uint8_t *)&com_requestbuffer[199]);
+	checkAndReleaseFrame(&sent[0]);
+	checkStats(0, 0);
+}
+
+// A full queue or a full buffer skips the whole frame, whatever its payload holds, and the next one is parsed
+static void testOverflow(void)
+{
+	uint8_t transfer[TRANSFER_MAX];
+	sentFrame_t sent[COM_MMDVM_FRAME_QUEUE_SIZE];
+	uint32_t length = 0;
+
+	// Queue full: 32 entries, one kept free
+	resetParser();
+	checkStats(UINT32_MAX, 0);
+
+	for (uint32_t i = 0; i < COM_MMDVM_FRAME_QUEUE_SIZE; i++)
+	{
+		sent[i].length = 10;
+		sent[i].sequence = sequence++;
+		length += makeFrame(&transfer[length], sent[i].length, sent[i].sequence);
+	}
+	feedTransfer(transfer, length);
+	checkStats(0, 1);
+
+	checkAndReleaseFrame(&sent[0]);
+	length = makeFrame(transfer, 10, sent[0].sequence);
+	feedTransfer(transfer, length);
+	checkStats(0, 0);
+
+	for (uint32_t i = 1; i < (COM_MMDVM_FRAME_QUEUE_SIZE - 1); i++)
+	{
+		checkAndReleaseFrame(&sent[i]);
+	}
+	checkAndReleaseFrame(&sent[0]); // the one sent again
+	TEST_CHECK(usbComMMDVMHasFrame() == false);
+
+	// Buffer full: 8 frames of 255 bytes fit in 2048, the 9th is skipped, split over packets
+	resetParser();
+	length = 0;
+	for (uint32_t i = 0; i < 10; i++)
+	{
+		sent[i].length = UINT8_MAX;
+		sent[i].sequence = sequence++;
+		length += makeFrame(&transfer[length], sent[i].length, sent[i].sequence);
+	}
+	feedTransfer(transfer, length);
+
+	uint32_t fitting = (COM_REQUESTBUFFER_SIZE - 1) / UINT8_MAX;
+	checkStats(0, (10 - fitting));
+
+	for (uint32_t i = 0; i < fitting; i++)
+	{
+		checkAndReleaseFrame(&sent[i]);
+	}
+	TEST_CHECK(usbComMMDVMHasFrame() == false);
+
+	// Everything is free again
+	sent[0].length = 20;
+	sent[0].sequence = sequence++;
+	feedTransfer(transfer, makeFrame(transfer, 20, sent[0].sequence));
+	checkAndReleaseFrame(&sent[0]);
+	checkStats(0, 0);
+}
+
+// A length below 3 is an error, the parser looks for the next frame start
+static void testResync(void)
+{
+	uint8_t transfer[TRANSFER_MAX];
+	sentFrame_t sent = { .length = 40 };
+	uint32_t length = 0;
+
+	resetParser();
+	checkStats(UINT32_MAX, 0);
+
+	static const uint8_t BAD[] = { 0x11, 0x22, 0xE0, 0x00, 0x33, 0xE0, 0x01, 0xE0, 0x02, 0x44 };
+	memcpy(transfer, BAD, sizeof(BAD));
+	length = sizeof(BAD);
+	sent.sequence = sequence++;
+	length += makeFrame(&transfer[length], sent.length, sent.sequence);
+
+	feedTransfer(transfer, length);
+	checkStats(3, 0);
+	checkAndReleaseFrame(&sent);
+	TEST_CHECK(usbComMMDVMHasFrame() == false);
+
+	// Length byte split from the start byte, by a full packet boundary
+	memset(transfer, 0x00, PACKET_SIZE - 1);
+	length = (PACKET_SIZE - 1);
+	sent.sequence = sequence++;
+	length += makeFrame(&transfer[length], sent.length, sent.sequence);
+	feedTransfer(transfer, length);
+	checkAndReleaseFrame(&sent);
+	checkStats(0, 0);
+}
+
+// The end of the transfer terminates the frame: kept if it has at least 3 bytes, an error otherwise
+static void testTruncatedFrames(void)
+{
+	uint8_t transfer[TRANSFER_MAX];
+	sentFrame_t sent = { .length = 40 };
+	const uint8_t *parsed;
+	uint8_t parsedLength;
+
+	resetParser();
+	checkStats(UINT32_MAX, 0);
+
+	makeFrame(transfer, 100, sequence++);
+	feedTransfer(transfer, 50);
+	checkStats(0, 0);
+	TEST_CHECK(usbComMMDVMPeekFrame(&parsed, &parsedLength));
+	TEST_CHECK((parsedLength == 50) && (memcmp(parsed, transfer, 50) == 0));
+	usbComMMDVMReleaseFrame();
+
+	// Start and length only
+	feedTransfer(transfer, 2);
+	checkStats(1, 0);
+	TEST_CHECK(usbComMMDVMHasFrame() == false);
+
+	// Start only
+	feedTransfer(transfer, 1);
+	checkStats(1, 0);
+	TEST_CHECK(usbComMMDVMHasFrame() == false);
+
+	// A skipped frame which is truncated is an error too
+	for (uint32_t i = 0; i < (COM_MMDVM_FRAME_QUEUE_SIZE - 1); i++)
+	{
+		feedTransfer(transfer, makeFrame(transfer, 10, sequence++));
+	}
+	makeFrame(transfer, 100, sequence++);
+	feedTransfer(transfer, 50);
+	checkStats(1, 1);
+	while (usbComMMDVMHasFrame())
+	{
+		usbComMMDVMReleaseFrame();
+	}
+
+	// A transfer which is a multiple of 64 bytes has no end marker, the next one completes the frame
+	makeFrame(transfer, 100, sequence++);
+	feedTransfer(transfer, PACKET_SIZE);
+	TEST_CHECK(usbComMMDVMHasFrame() == false);
+	feedTransfer(&transfer[PACKET_SIZE], (100 - PACKET_SIZE));
+	TEST_CHECK(usbComMMDVMPeekFrame(&parsed, &parsedLength));
+	TEST_CHECK((parsedLength == 100) && (memcmp(parsed, transfer, 100) == 0));
+	usbComMMDVMReleaseFrame();
+
+	// And the parser is back in sync
+	sent.sequence = sequence++;
+	feedTransfer(transfer, makeFrame(transfer, sent.length, sent.sequence));
+	checkAndReleaseFrame(&sent);
+	checkStats(0, 0);
+}
+
+// Random transfers (1 to 8 frames) and a consumer which releases a random number of frames between them. Every
+// frame is either delivered intact and in order, or dropped and counted as an overflow. The frames are checked when
+// released, so the ones received meanwhile mustn't have overwritten them.
+static void testRandomReplay(void)
+{
+	uint8_t transfer[TRANSFER_MAX];
+	static sentFrame_t sent[RANDOM_FRAMES + 8];
+	uint32_t sentCount = 0;
+	uint32_t checked = 0;
+	uint32_t delivered = 0;
+	uint32_t wraps = 0;
+	uint32_t seed = 0x4D4D4456;
+	uint32_t errors;
+	uint32_t overflows;
+	uint32_t overflowsBase;
+	uint32_t errorsBase;
+
+	resetParser();
+	usbComMMDVMGetParserStats(&errorsBase, &overflowsBase);
+
+	while (sentCount < RANDOM_FRAMES)
+	{
+		uint32_t frames = (1 + (testRandom(&seed) % 8));
+		uint32_t length = 0;
+
+		for (uint32_t i = 0; i < frames; i++)
+		{
+			sent[sentCount].length = (FRAME_LENGTH_MIN + (testRandom(&seed) % (UINT8_MAX - FRAME_LENGTH_MIN + 1)));
+			sent[sentCount].sequence = sentCount;
+			length += makeFrame(&transfer[length], sent[sentCount].length, sent[sentCount].sequence);
+			sentCount++;
+		}
+
+		feedTransfer(transfer, length);
+
+		uint32_t releases = (testRandom(&seed) % 12);
+
+		while ((releases-- > 0) && usbComMMDVMHasFrame())
+		{
+			const uint8_t *frame;
+			uint8_t frameLength;
+
+			TEST_CHECK(usbComMMDVMPeekFrame(&frame, &frameLength));
+			TEST_CHECK(frameLength >= FRAME_LENGTH_MIN);
+
+			uint32_t frameSequence = ((frame[2] << 24) | (frame[3] << 16) | (frame[4] << 8) | frame[5]);
+
+			TEST_CHECK((frameSequence >= checked) && (frameSequence < sentCount));
+			TEST_CHECK(frameMatches(frame, frameLength, &sent[frameSequence]));
+			if (frame == (const uint8_t *)com_requestbuffer)
+			{
+				wraps++;
+			}
+			checked = (frameSequence + 1);
+			delivered++;
+			usbComMMDVMReleaseFrame();
+		}
+	}
+
+	while (usbComMMDVMHasFrame())
+	{
+		const uint8_t *frame;
+		uint8_t frameLength;
+
+		TEST_CHECK(usbComMMDVMPeekFrame(&frame, &frameLength));
+		TEST_CHECK(frameMatches(frame, frameLength, &sent[(frame[2] << 24) | (frame[3] << 16) | (frame[4] << 8) | frame[5]]));
+		delivered++;
+		usbComMMDVMReleaseFrame();
+	}
+
+	usbComMMDVMGetParserStats(&errors, &overflows);
+	TEST_CHECK(errors == errorsBase);
+	TEST_CHECK((delivered + (overflows - overflowsBase)) == sentCount);
+	TEST_CHECK((overflows - overflowsBase) > 0); // the consumer is slow enough to overflow
+	TEST_CHECK(wraps > 0);
+	printf("  %u frames, %u delivered, %u overflows, %u wraps\n", sentCount, delivered, (overflows - overflowsBase), wraps);
+}
+
+// DMR frames as MMDVMHost sends them while transmitting, in 64 bytes packets, consumed as they arrive
+static void benchmarkParser(void)
+{
+	uint8_t frame[BENCHMARK_DMR_FRAME_LENGTH];
+	uint32_t transferred = 0;
+
+	resetParser();
+	makeFrame(frame, BENCHMARK_DMR_FRAME_LENGTH, 0);
+
+	uint64_t start = testGetNanoseconds();
+
+	for (uint32_t i = 0; i < BENCHMARK_FRAMES; i++)
+	{
+		const uint8_t *parsed;
+		uint8_t length;
+
+		feedTransfer(frame, BENCHMARK_DMR_FRAME_LENGTH);
+
+		if (usbComMMDVMPeekFrame(&parsed, &length))
+		{
+			transferred += length;
+			usbComMMDVMReleaseFrame();
+		}
+	}
+
+	uint64_t elapsed = (testGetNanoseconds() - start);
+
+	TEST_CHECK(transferred == (BENCHMARK_FRAMES * BENCHMARK_DMR_FRAME_LENGTH));
+	printf("  %u bytes frames: %.1f ns per frame (feed, peek and release), %.1f MB/s\n", BENCHMARK_DMR_FRAME_LENGTH,
+			((double)elapsed / BENCHMARK_FRAMES), (((double)transferred * 1000.0) / (double)elapsed));
+}
+
+int main(void)
+{
+	TEST_RUN(testEmptyQueue);
+	TEST_RUN(testSplitFrames);
+	TEST_RUN(testCoalescedFrames);
+	TEST_RUN(testWrap);
+	TEST_RUN(testOverflow);
+	TEST_RUN(testResync);
+	TEST_RUN(testTruncatedFrames);
+	TEST_RUN(testRandomReplay);
+	TEST_RUN(benchmarkParser);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+#
+# Compares a local Flash image with the radio's Flash, using the sector hash CPS command ('H'),
+# and lists the sectors that differ (the only ones a differential upload has to write).
+#
+# Usage:
+#   cps_sector_diff.py /dev/ttyACM0 0x30000 codeplug.bin
+#
+# Requires pyserial.
+#
+import argparse
+import struct
+import sys
+import zlib
+
+import serial
+
+CPS_ACCESS_FLASH = 1
+SECTOR_SIZE = 4096
+SECTORS_PER_REQUEST = 64 # keeps each reply well under a second
+
+
+def sectorHashes(port, address, count):
+	port.write(struct.pack(">cBIH", b"H", CPS_ACCESS_FLASH, address, count))
+
+	header = port.read(3)
+	if len(header) != 3 or header[0:1] != b"H":
+		raise IOError("request rejected (%r)" % header)
+
+	(returned,) = struct.unpack(">H", header[1:3])
+	payload = port.read(returned * 4)
+	if len(payload) != (returned * 4):
+		raise IOError("short reply")
+
+	return list(struct.unpack(">%dI" % returned, payload))
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Sector differences between a Flash image and the radio")
+	parser.add_argument("--timeout", type=float, default=5.0, help="reply timeout, in seconds")
+	parser.add_argument("port")
+	parser.add_argument("address", type=lambda v: int(v, 0), help="Flash address of the image (sector aligned)")
+	parser.add_argument("image")
+	args = parser.parse_args()
+
+	if args.address % SECTOR_SIZE:
+		sys.exit("address must be a multiple of %d" % SECTOR_SIZE)
+
+	with open(args.image, "rb") as f:
+		image = f.read()
+
+	# The last sector is compared with what an upload would leave in it, i.e. the image padded with the erased state
+	sectors = (len(image) + SECTOR_SIZE - 1) // SECTOR_SIZE
+	image += b"\xff" * ((sectors * SECTOR_SIZE) - len(image))
+
+	radioHashes = []
+	with serial.Serial(args.port, 115200, timeout=args.timeout) as port:
+		port.reset_input_buffer()
+		while len(radioHashes) < sectors:
+			count = min(SECTORS_PER_REQUEST, sectors - len(radioHashes))
+			radioHashes += sectorHashes(port, args.address + (len(radioHashes) * SECTOR_SIZE), count)
+
+	different = []
+	for i in range(sectors):
+		if zlib.crc32(image[i * SECTOR_SIZE:(i + 1) * SECTOR_SIZE]) != radioHashes[i]:
+			different.append(i)
+
+	for i in different:
+		print("0x%08X" % (args.address + (i * SECTOR_SIZE)))
+
+	sys.stderr.write("%d of %d sectors differ\n" % (len(different), sectors))
+
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+#
+# Reads a memory range from the radio with the streamed CPS read command ('S'), and reports the throughput.
+#
+# Usage:
+#   cps_stream_read.py /dev/ttyACM0 0x0 0x1000000 flash.bin
+#   cps_stream_read.py --eeprom COM5 0x0 0x10000 eeprom.bin
+#
+# Requires pyserial.
+#
+import argparse
+import struct
+import sys
+import time
+
+import serial
+
+CPS_ACCESS_FLASH = 1
+CPS_ACCESS_EEPROM = 2
+
+
+def streamRead(port, access, address, length, timeout):
+	port.reset_input_buffer()
+	port.write(struct.pack(">cBII", b"S", access, address, length))
+
+	header = port.read(6)
+	if len(header) != 6 or header[0:1] != b"S":
+		raise IOError("request rejected (%r)" % header)
+
+	(announced,) = struct.unpack(">I", header[2:6])
+	if announced != length:
+		raise IOError("unexpected length %d" % announced)
+
+	data = bytearray()
+	lastProgress = 0
+	port.timeout = timeout
+
+	while len(data) < length:
+		chunk = port.read(min(65536, length - len(data)))
+		if not chunk:
+			raise IOError("stream stalled after %d bytes" % len(data))
+		data.extend(chunk)
+
+		if (len(data) - lastProgress) >= 0x40000:
+			lastProgress = len(data)
+			sys.stderr.write("\r%d%%" % ((len(data) * 100) // length))
+
+	sys.stderr.write("\r")
+	return bytes(data)
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Streamed CPS read")
+	parser.add_argument("--eeprom", action="store_true", help="read the (emulated) EEPROM instead of the Flash")
+	parser.add_argument("--timeout", type=float, default=2.0, help="inter chunk timeout, in seconds")
+	parser.add_argument("port")
+	parser.add_argument("address", type=lambda v: int(v, 0))
+	parser.add_argument("length", type=lambda v: int(v, 0))
+	parser.add_argument("output")
+	args = parser.parse_args()
+
+	with serial.Serial(args.port, 115200, timeout=args.timeout) as port:
+		start = time.monotonic()
+		data = streamRead(port, (CPS_ACCESS_EEPROM if args.eeprom else CPS_ACCESS_FLASH), args.address, args.length, args.timeout)
+		elapsed = time.monotonic() - start
+
+	with open(args.output, "wb") as f:
+		f.write(data)
+
+	print("%d bytes in %.2fs, %.1f kB/s" % (len(data), elapsed, (len(data) / 1024.0) / elapsed))
+
+
+if __name__ == "__main__":
+	main()
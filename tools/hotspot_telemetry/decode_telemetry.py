@@ -0,0 +1,168 @@
+#!/usr/bin/env python3
+#
+# Decodes the hotspot telemetry frames (MMDVM_DEBUG_DUMP, see hotspotTelemetry.c) from a MMDVMHost log file,
+# or from hex strings given on the command line.
+#
+# Usage:
+#   decode_telemetry.py MMDVM-2024-01-01.log
+#   tail -f MMDVM-2024-01-01.log | decode_telemetry.py
+#   decode_telemetry.py --hex "54 01 00 90 4E 08 ..."
+#
+import argparse
+import re
+import sys
+
+MAGIC = 0x54
+VERSION = 1
+MMDVM_FRAME_START = 0xE0
+MMDVM_DEBUG_DUMP = 0xFA
+
+COUNTERS = [
+	"RF frames",
+	"Network frames",
+	"USB overflows",
+	"RF overflows",
+	"Network overflows",
+	"Network underruns",
+	"LC decode failures",
+	"FEC corrected bits",
+	"USB parser errors",
+	"USB parser overflows",
+]
+
+HISTOGRAMS = [
+	("USB queue depth", "bytes"),
+	("RF buffer depth", "frames"),
+	("Network buffer depth", "frames"),
+	("Frame to air latency", "ms"),
+	("ISR to USB latency", "ms"),
+]
+
+DUMP_LINE = re.compile(r"\b[0-9A-Fa-f]{4}:\s+((?:[0-9A-Fa-f]{2}\s+)+)")
+
+
+class Reader:
+	def __init__(self, data):
+		self.data = data
+		self.pos = 0
+
+	def byte(self):
+		if self.pos >= len(self.data):
+			raise ValueError("truncated payload")
+		value = self.data[self.pos]
+		self.pos += 1
+		return value
+
+	def varint(self):
+		value = 0
+		shift = 0
+		while True:
+			b = self.byte()
+			value |= (b & 0x7F) << shift
+			if (b & 0x80) == 0:
+				return value
+			shift += 7
+
+
+def decode(payload):
+	# The MMDVM header may, or may not, be part of the dump
+	if len(payload) >= 3 and payload[0] == MMDVM_FRAME_START and payload[2] == MMDVM_DEBUG_DUMP:
+		payload = payload[3:]
+
+	r = Reader(payload)
+	if r.byte() != MAGIC:
+		return None
+	version = r.byte()
+	if version != VERSION:
+		raise ValueError("unsupported telemetry version %d" % version)
+
+	report = {"sequence": r.byte(), "period": r.varint(), "counters": [], "histograms": []}
+
+	for _ in range(r.byte()):
+		report["counters"].append(r.varint())
+
+	for _ in range(r.byte()):
+		shift = r.byte()
+		buckets = [r.varint() for _ in range(r.byte())]
+		report["histograms"].append((shift, buckets))
+
+	return report
+
+
+def bucketLabel(index, count, shift):
+	if index == 0:
+		return "<%d" % (1 << shift)
+	low = (1 << (index - 1)) << shift
+	if index == (count - 1):
+		return ">=%d" % low
+	return "%d-%d" % (low, ((1 << index) << shift) - 1)
+
+
+def printReport(report):
+	print("Telemetry #%d, period %.1fs" % (report["sequence"], report["period"] / 1000.0))
+
+	for i, value in enumerate(report["counters"]):
+		name = COUNTERS[i] if i < len(COUNTERS) else "Counter %d" % i
+		print("  %-22s %d" % (name, value))
+
+	for i, (shift, buckets) in enumerate(report["histograms"]):
+		name, unit = HISTOGRAMS[i] if i < len(HISTOGRAMS) else ("Histogram %d" % i, "")
+		total = sum(buckets)
+		print("  %s (%s), %d samples" % (name, unit, total))
+		if total == 0:
+			continue
+		for b, value in enumerate(buckets):
+			if value:
+				print("    %-10s %6d %s" % (bucketLabel(b, len(buckets), shift), value, "#" * max(1, (value * 40) // total)))
+
+
+def dumpsFromLog(lines):
+	data = None
+	for line in lines:
+		if "Modem dump" in line:
+			if data:
+				yield data
+			data = bytearray()
+			continue
+
+		match = DUMP_LINE.search(line) if data is not None else None
+		if match:
+			data.extend(int(h, 16) for h in match.group(1).split())
+		elif data is not None:
+			if data:
+				yield data
+			data = None
+
+	if data:
+		yield data
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Decode the hotspot telemetry frames")
+	parser.add_argument("--hex", action="append", help="payload (or whole frame) as hex bytes")
+	parser.add_argument("logs", nargs="*", help="MMDVMHost log files (stdin if none)")
+	args = parser.parse_args()
+
+	if args.hex:
+		dumps = [bytes.fromhex(h.replace(",", " ")) for h in args.hex]
+	elif args.logs:
+		dumps = []
+		for log in args.logs:
+			with open(log, errors="replace") as f:
+				dumps.extend(dumpsFromLog(f))
+	else:
+		dumps = dumpsFromLog(sys.stdin)
+
+	for dump in dumps:
+		try:
+			report = decode(bytes(dump))
+		except ValueError as e:
+			print("Invalid telemetry frame: %s" % e, file=sys.stderr)
+			continue
+
+		if report:
+			printReport(report)
+
+
+if __name__ == "__main__":
+	main()
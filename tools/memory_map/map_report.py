@@ -0,0 +1,353 @@
+#!/usr/bin/env python3
+#
+# Reports what landed where from the GNU ld map file of the firmware (e.g. Debug/MD9600_firmware.map): the use of
+# each memory region, the functions copied to RAM (RAM_FUNCTION, .RamFunc) and the data placed in the CCM RAM
+# (CCM_DATA, .ccmram), see application/include/utils.h and STM32F405VGTX_FLASH.ld.
+#
+# --budget reports the static memory budget instead: the use of each region per module (object file or library),
+# the task stacks (TASK_STACK_CCM/TASK_STACK_RAM, see application/include/functions/taskMemory.h) and the FreeRTOS
+# heap. With --port, the stack sizes and high-water marks measured by the radio (CPS 'U' command) are added.
+#
+# Usage:
+#   map_report.py MD9600_firmware.map
+#   map_report.py --top 20 MD9600_firmware.map
+#   map_report.py --compare before.map after.map
+#   map_report.py --budget MD9600_firmware.map
+#   map_report.py --budget --port /dev/ttyACM0 MD9600_firmware.map
+#
+# --port requires pyserial.
+#
+import argparse
+import re
+import struct
+import sys
+
+PLACEMENT_SECTIONS = (".RamFunc", ".ccmram")
+STACK_SECTION_RE = re.compile(r"^\.(ccmram|bss)\.stack\.(\S+)$")
+CUBEMX_STACKS = ("defaultTaskBuffer",) # osThreadNew() static stacks, generated by CubeMX
+HEAP_SYMBOL = "ucHeap"
+TASK_NAME_LENGTH = 16 # configMAX_TASK_NAME_LEN
+STACK_WARNING_MARGIN = 10 # %, minimum free stack below which a task is flagged
+
+REGION_RE = re.compile(r"^(\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)(\s+\S+)?\s*$")
+OUTPUT_SECTION_RE = re.compile(r"^(\.\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)(\s+load address 0x([0-9a-fA-F]+))?")
+INPUT_SECTION_RE = re.compile(r"^ (\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+INPUT_NAME_ONLY_RE = re.compile(r"^ (\.\S+)\s*$")
+INPUT_CONTINUATION_RE = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+SYMBOL_RE = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+([A-Za-z_]\w*)\s*$")
+
+
+class InputSection:
+	def __init__(self, outputSection, name, address, size, objectFile):
+		self.outputSection = outputSection
+		self.name = name
+		self.address = address
+		self.size = size
+		self.objectFile = objectFile
+		self.symbols = []
+
+
+def parseMap(path):
+	regions = []
+	outputSections = []
+	inputSections = []
+
+	with open(path, "r", errors="replace") as f:
+		lines = f.read().splitlines()
+
+	i = 0
+	while i < len(lines) and not lines[i].startswith("Memory Configuration"):
+		i += 1
+
+	while i < len(lines) and not lines[i].startswith("Linker script and memory map"):
+		m = REGION_RE.match(lines[i])
+		if m and m.group(1) not in ("Name", "*default*"):
+			regions.append((m.group(1), int(m.group(2), 16), int(m.group(3), 16)))
+		i += 1
+
+	currentOutput = None
+	pendingName = None
+
+	for line in lines[i:]:
+		m = OUTPUT_SECTION_RE.match(line)
+		if m:
+			load = int(m.group(5), 16) if m.group(5) else int(m.group(2), 16)
+			currentOutput = m.group(1)
+			outputSections.append((currentOutput, int(m.group(2), 16), int(m.group(3), 16), load))
+			pendingName = None
+			continue
+
+		if pendingName is not None:
+			m = INPUT_CONTINUATION_RE.match(line)
+			if m:
+				inputSections.append(InputSection(currentOutput, pendingName, int(m.group(1), 16), int(m.group(2), 16), m.group(3).strip()))
+				pendingName = None
+				continue
+			pendingName = None
+
+		m = INPUT_SECTION_RE.match(line)
+		if m and not m.group(4).startswith("0x"):
+			inputSections.append(InputSection(currentOutput, m.group(1), int(m.group(2), 16), int(m.group(3), 16), m.group(4).strip()))
+			continue
+
+		m = INPUT_NAME_ONLY_RE.match(line)
+		if m:
+			pendingName = m.group(1)
+			continue
+
+		m = SYMBOL_RE.match(line)
+		if m and inputSections:
+			last = inputSections[-1]
+			address = int(m.group(1), 16)
+			if last.address <= address < (last.address + max(last.size, 1)):
+				last.symbols.append((address, m.group(2)))
+
+	return (regions, outputSections, [s for s in inputSections if s.size > 0])
+
+
+def regionOf(regions, address):
+	for (name, origin, length) in regions:
+		if origin <= address < (origin + length):
+			return name
+	return None
+
+
+def regionUsage(regions, outputSections):
+	used = dict((name, 0) for (name, origin, length) in regions)
+
+	for (name, address, size, load) in outputSections:
+		region = regionOf(regions, address)
+		if region is not None:
+			used[region] += size
+		# Initialised data (and RAM functions) also take their load image in flash
+		loadRegion = regionOf(regions, load)
+		if load != address and loadRegion is not None:
+			used[loadRegion] += size
+
+	return used
+
+
+def shortObject(objectFile):
+	return re.sub(r"^.*/", "", objectFile)
+
+
+def sectionLabel(section):
+	if section.symbols:
+		return ", ".join(name for (address, name) in section.symbols)
+	return re.sub(r"^\.(text|data|bss|rodata|RamFunc|ccmram)\.?", "", section.name) or "(%s)" % section.name
+
+
+# Names of the functions/variables of a section: its global symbols, and with -ffunction-sections/-fdata-sections,
+# the one in its name (static ones have no symbol in the map file)
+def sectionSymbols(section):
+	names = [name for (address, name) in section.symbols]
+	m = re.match(r"^\.(text|data|bss|rodata)\.(\S+)$", section.name)
+	if m and m.group(2) not in names:
+		names.append(m.group(2))
+	return names
+
+
+def printUsage(regions, used):
+	print("%-10s %10s %10s %10s %10s %6s" % ("region", "origin", "size", "used", "free", "use"))
+	for (name, origin, length) in regions:
+		print("%-10s 0x%08X %10d %10d %10d %5.1f%%" % (name, origin, length, used[name], (length - used[name]), (used[name] * 100.0) / length if length else 0.0))
+
+
+def printPlacement(inputSections):
+	for placement in PLACEMENT_SECTIONS:
+		sections = [s for s in inputSections if s.name == placement or s.name.startswith(placement + ".")]
+		total = sum(s.size for s in sections)
+
+		print("\n%s: %d bytes" % (placement, total))
+		for s in sorted(sections, key=lambda s: -s.size):
+			print("  0x%08X %8d  %-40s %s" % (s.address, s.size, sectionLabel(s), shortObject(s.objectFile)))
+
+
+def printTop(regions, inputSections, count):
+	for (name, origin, length) in regions:
+		sections = sorted([s for s in inputSections if regionOf(regions, s.address) == name], key=lambda s: -s.size)[:count]
+		if not sections:
+			continue
+
+		print("\nLargest in %s:" % name)
+		for s in sections:
+			print("  0x%08X %8d  %-40s %s" % (s.address, s.size, sectionLabel(s), shortObject(s.objectFile)))
+
+
+def placementKey(section):
+	return (section.name, shortObject(section.objectFile))
+
+
+def moduleName(objectFile):
+	# Group the members of a library
+	return re.sub(r"\(.*\)$", "", shortObject(objectFile))
+
+
+def moduleUsage(regions, outputSections, inputSections):
+	loadOffsets = dict((name, load - address) for (name, address, size, load) in outputSections)
+	modules = {}
+
+	for s in inputSections:
+		usage = modules.setdefault(moduleName(s.objectFile), dict((name, 0) for (name, origin, length) in regions))
+		region = regionOf(regions, s.address)
+		if region is not None:
+			usage[region] += s.size
+		loadOffset = loadOffsets.get(s.outputSection, 0)
+		loadRegion = regionOf(regions, s.address + loadOffset)
+		if loadOffset != 0 and loadRegion is not None:
+			usage[loadRegion] += s.size
+
+	return modules
+
+
+def stackSections(inputSections):
+	stacks = []
+	for s in inputSections:
+		m = STACK_SECTION_RE.match(s.name)
+		if m:
+			stacks.append((m.group(2), s))
+		else:
+			for name in sectionSymbols(s):
+				if name in CUBEMX_STACKS:
+					stacks.append((name, s))
+	return stacks
+
+
+def readUsage(port):
+	port.reset_input_buffer()
+	port.write(b"U")
+
+	header = port.read(12)
+	if len(header) != 12 or header[0:1] != b"U":
+		raise IOError("request rejected (%r)" % header)
+
+	(count, load, heapFree, heapMinimumEverFree) = struct.unpack(">BHII", header[1:12])
+	recordSize = TASK_NAME_LENGTH + 7
+	data = port.read(count * recordSize)
+	if len(data) != (count * recordSize):
+		raise IOError("short reply (%d bytes)" % len(data))
+
+	tasks = []
+	for t in range(count):
+		chunk = data[(t * recordSize):((t + 1) * recordSize)]
+		name = chunk[0:TASK_NAME_LENGTH].split(b"\x00")[0].decode("ascii", "replace")
+		(taskLoad, highWater, priority, stackSize) = struct.unpack(">HHBH", chunk[TASK_NAME_LENGTH:])
+		tasks.append((name, taskLoad, highWater, priority, stackSize))
+
+	return (heapFree, heapMinimumEverFree, tasks)
+
+
+def printBudget(regions, outputSections, inputSections, usage):
+	names = [name for (name, origin, length) in regions]
+	modules = moduleUsage(regions, outputSections, inputSections)
+	ramRegions = [name for (name, origin, length) in regions if not name.upper().startswith("FLASH")]
+
+	print(("%-40s" + " %10s" * len(names)) % (("module",) + tuple(names)))
+	for (module, used) in sorted(modules.items(), key=lambda m: (-sum(m[1][r] for r in ramRegions), m[0])):
+		if any(used[r] for r in ramRegions):
+			print(("%-40s" + " %10d" * len(names)) % ((module,) + tuple(used[n] for n in names)))
+
+	total = regionUsage(regions, outputSections)
+	print(("%-40s" + " %10d" * len(names)) % (("total",) + tuple(total[n] for n in names)))
+	print(("%-40s" + " %10d" * len(names)) % (("free",) + tuple((length - total[name]) for (name, origin, length) in regions)))
+
+	stacks = stackSections(inputSections)
+	print("\nTask stacks: %d bytes" % sum(s.size for (name, s) in stacks))
+	for (name, s) in sorted(stacks, key=lambda n: -n[1].size):
+		print("  %-24s %-8s %8d bytes %6d words  %s" % (name, regionOf(regions, s.address), s.size, s.size // 4, shortObject(s.objectFile)))
+
+	heap = [s for s in inputSections if HEAP_SYMBOL in sectionSymbols(s)]
+	if heap:
+		print("\nFreeRTOS heap: %d bytes (%s)" % (heap[0].size, regionOf(regions, heap[0].address)))
+
+	if usage is None:
+		return
+
+	(heapFree, heapMinimumEverFree, tasks) = usage
+	print("  free %d bytes, minimum ever free %d bytes" % (heapFree, heapMinimumEverFree))
+
+	print("\n%-16s %5s %10s %10s %10s %6s" % ("task", "prio", "stack", "min free", "max used", "use"))
+	for (name, load, highWater, priority, stackSize) in tasks:
+		if stackSize == 0:
+			print("%-16s %5d %10s %10d %10s %6s" % (name, priority, "?", highWater, "?", "?"))
+			continue
+
+		used = stackSize - highWater
+		flag = "  <- less than %d%% free" % STACK_WARNING_MARGIN if ((highWater * 100) < (stackSize * STACK_WARNING_MARGIN)) else ""
+		print("%-16s %5d %10d %10d %10d %5.1f%%%s" % (name, priority, stackSize, highWater, used, (used * 100.0) / stackSize, flag))
+	print("(stack sizes in words)")
+
+
+def printComparison(before, after):
+	(regions, beforeOutput, beforeInput) = before
+	(afterRegions, afterOutput, afterInput) = after
+	beforeUsed = regionUsage(regions, beforeOutput)
+	afterUsed = regionUsage(afterRegions, afterOutput)
+
+	print("%-10s %10s %10s %10s" % ("region", "before", "after", "delta"))
+	for (name, origin, length) in afterRegions:
+		print("%-10s %10d %10d %+10d" % (name, beforeUsed.get(name, 0), afterUsed[name], afterUsed[name] - beforeUsed.get(name, 0)))
+
+	beforeRegions = dict((placementKey(s), regionOf(regions, s.address)) for s in beforeInput)
+	moved = []
+	for s in afterInput:
+		key = placementKey(s)
+		region = regionOf(afterRegions, s.address)
+		if key in beforeRegions and beforeRegions[key] != region:
+			moved.append((s, beforeRegions[key], region))
+
+	# A section moved by a section attribute changes its name (e.g. .text.foo becoming .RamFunc), match them by symbol
+	beforeSymbols = {}
+	for s in beforeInput:
+		for symbol in sectionSymbols(s):
+			beforeSymbols[symbol] = regionOf(regions, s.address)
+	for s in afterInput:
+		if any(s.name == p or s.name.startswith(p + ".") for p in PLACEMENT_SECTIONS):
+			for symbol in sectionSymbols(s):
+				if beforeSymbols.get(symbol) not in (None, regionOf(afterRegions, s.address)):
+					moved.append((s, beforeSymbols[symbol], regionOf(afterRegions, s.address)))
+					break
+
+	if moved:
+		print("\nMoved:")
+		for (s, fromRegion, toRegion) in moved:
+			print("  %-8s -> %-8s %8d  %-40s %s" % (fromRegion, toRegion, s.size, sectionLabel(s), shortObject(s.objectFile)))
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Firmware memory placement report")
+	parser.add_argument("--top", type=int, default=10, help="number of largest input sections listed per region")
+	parser.add_argument("--compare", metavar="BEFORE_MAP", help="report the differences from this older map file")
+	parser.add_argument("--budget", action="store_true", help="report the static memory use per module, the task stacks and the heap")
+	parser.add_argument("--port", help="with --budget, read the measured stack high-water marks from the radio on this serial port")
+	parser.add_argument("map")
+	args = parser.parse_args()
+
+	after = parseMap(args.map)
+	(regions, outputSections, inputSections) = after
+	if not regions:
+		sys.exit("no memory configuration found in %s, is it a GNU ld map file?" % args.map)
+
+	if args.compare:
+		printComparison(parseMap(args.compare), after)
+	elif args.budget:
+		usage = None
+		if args.port:
+			import serial
+
+			with serial.Serial(args.port, 115200, timeout=1.0) as port:
+				try:
+					usage = readUsage(port)
+				except IOError as e:
+					sys.exit(str(e))
+
+		printBudget(regions, outputSections, inputSections, usage)
+	else:
+		printUsage(regions, regionUsage(regions, outputSections))
+		printPlacement(inputSections)
+		if args.top > 0:
+			printTop(regions, inputSections, args.top)
+
+
+if __name__ == "__main__":
+	main()
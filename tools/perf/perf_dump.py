@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+#
+# Dumps the radio timing probes (CPS 'P' command, see application/source/functions/perf.c), as a table of
+# count/min/mean/max durations in microseconds, followed by the non empty log2 histogram buckets of each probe.
+# The firmware has to be built with USING_PERF defined (functions/perf.h).
+#
+# --save and --compare are meant for before/after measurements, like a code placement in RAM (build with and
+# without NO_RAM_FUNCTIONS, utils.h): save the dump of one build, then compare the other build with it. The
+# comparison is in counter ticks, which are CPU cycles on the radio.
+#
+# Usage:
+#   perf_dump.py /dev/ttyACM0
+#   perf_dump.py --reset COM5
+#   perf_dump.py --save flash.json /dev/ttyACM0
+#   perf_dump.py --compare flash.json /dev/ttyACM0
+#
+# Requires pyserial.
+#
+import argparse
+import json
+import struct
+import sys
+
+PERF_NAME_LENGTH = 8
+PERF_HISTOGRAM_BUCKETS = 32
+PROBE_SIZE = PERF_NAME_LENGTH + ((4 + PERF_HISTOGRAM_BUCKETS) * 4)
+
+
+def readProbes(port):
+	port.reset_input_buffer()
+	port.write(b"P\x01")
+
+	header = port.read(8)
+	if len(header) != 8 or header[0:2] != b"P\x01":
+		raise IOError("request rejected (%r), is the firmware built with USING_PERF?" % header)
+
+	count = header[2]
+	(frequency,) = struct.unpack(">I", header[4:8])
+	data = port.read(count * PROBE_SIZE)
+	if len(data) != (count * PROBE_SIZE):
+		raise IOError("short reply (%d bytes)" % len(data))
+
+	probes = []
+	for p in range(count):
+		chunk = data[(p * PROBE_SIZE):((p + 1) * PROBE_SIZE)]
+		name = chunk[0:PERF_NAME_LENGTH].split(b"\x00")[0].decode("ascii")
+		values = struct.unpack(">%dI" % (4 + PERF_HISTOGRAM_BUCKETS), chunk[PERF_NAME_LENGTH:])
+		probes.append((name, values[0], values[1], values[2], values[3], values[4:]))
+
+	return (frequency, probes)
+
+
+def resetProbes(port):
+	port.reset_input_buffer()
+	port.write(b"P\x02")
+	reply = port.read(2)
+	if reply != b"P\x02":
+		raise IOError("reset rejected (%r)" % reply)
+
+
+def printProbes(frequency, probes):
+	us = frequency / 1e6
+
+	print("%-8s %10s %10s %10s %10s" % ("probe", "count", "min us", "mean us", "max us"))
+	for (name, count, minimum, maximum, mean, buckets) in probes:
+		if count == 0:
+			print("%-8s %10d %10s %10s %10s" % (name, 0, "-", "-", "-"))
+		else:
+			print("%-8s %10d %10.2f %10.2f %10.2f" % (name, count, minimum / us, mean / us, maximum / us))
+
+	for (name, count, minimum, maximum, mean, buckets) in probes:
+		if count == 0:
+			continue
+
+		print("\n%s" % name)
+		for (b, n) in enumerate(buckets):
+			if n:
+				print("  %10.2f - %10.2f us %10d %5.1f%%" % (((1 << b) if b else 0) / us, (1 << (b + 1)) / us, n, (n * 100.0) / count))
+
+
+# Durations in counter ticks
+def probesToDict(probes):
+	return dict((name, { "count": count, "min": minimum, "mean": mean, "max": maximum })
+			for (name, count, minimum, maximum, mean, buckets) in probes if count > 0)
+
+
+# Mean and max durations of the probes present in both dumps, with the change in percent
+def printComparison(before, after):
+	print("%-8s %12s %12s %8s %12s %12s %8s" % ("probe", "mean before", "mean after", "change", "max before", "max after", "change"))
+	for name in sorted(set(before) & set(after)):
+		b = before[name]
+		a = after[name]
+		meanChange = (((a["mean"] - b["mean"]) * 100.0) / b["mean"]) if b["mean"] else 0.0
+		maxChange = (((a["max"] - b["max"]) * 100.0) / b["max"]) if b["max"] else 0.0
+		print("%-8s %12d %12d %7.1f%% %12d %12d %7.1f%%" % (name, b["mean"], a["mean"], meanChange, b["max"], a["max"], maxChange))
+
+	for name in sorted(set(before) ^ set(after)):
+		print("%-8s only in the %s dump" % (name, "before" if name in before else "after"))
+
+
+def main():
+	import serial
+
+	parser = argparse.ArgumentParser(description="Radio timing probes dump")
+	parser.add_argument("--reset", action="store_true", help="clear the probes after the dump")
+	parser.add_argument("--save", metavar="FILE", help="also save the durations to this JSON file")
+	parser.add_argument("--compare", metavar="FILE", help="compare the durations with a dump saved by --save")
+	parser.add_argument("port")
+	args = parser.parse_args()
+
+	with serial.Serial(args.port, 115200, timeout=1.0) as port:
+		try:
+			(frequency, probes) = readProbes(port)
+			if args.reset:
+				resetProbes(port)
+		except IOError as e:
+			sys.exit(str(e))
+
+	printProbes(frequency, probes)
+
+	durations = probesToDict(probes)
+
+	if args.save:
+		with open(args.save, "w") as f:
+			json.dump(durations, f, indent=1, sort_keys=True)
+
+	if args.compare:
+		with open(args.compare) as f:
+			print("")
+			printComparison(json.load(f), durations)
+
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+#
+# Dumps the registers shadows of the radio (CPS 'G' command, see application/source/interfaces/spi.c and
+# application/source/hardware/radioHardwareInterface.c): the HR-C6000 pages 0x01 and 0x04, then the synthesiser and
+# IF chips state, with the written/skipped transfers counters.
+#
+# Usage:
+#   shadow_dump.py /dev/ttyACM0
+#
+# Requires pyserial.
+#
+import argparse
+import struct
+import sys
+
+HRC6000_PAGES = (0x01, 0x04)
+BAND_NAMES = ("VHF", "UHF")
+
+
+def readHRC6000Page(port, page):
+	port.reset_input_buffer()
+	port.write(bytes((ord("G"), 1, page)))
+
+	reply = port.read(4 + 8 + 32 + 256)
+	if len(reply) != (4 + 8 + 32 + 256) or reply[0:3] != bytes((ord("G"), 1, page)):
+		raise IOError("request rejected (%r)" % reply[0:4])
+
+	(written, skipped) = struct.unpack(">II", reply[4:12])
+	valid = reply[12:44]
+	values = reply[44:]
+
+	return (written, skipped, [(values[r] if (valid[r >> 3] & (1 << (r & 7))) else None) for r in range(256)])
+
+
+def readRadio(port):
+	port.reset_input_buffer()
+	port.write(b"G\x02")
+
+	header = port.read(4 + 16)
+	if len(header) != 20 or header[0:2] != b"G\x02":
+		raise IOError("request rejected (%r)" % header[0:4])
+
+	bands = header[2]
+	registers = header[3]
+	stats = struct.unpack(">4I", header[4:20])
+	bandSize = 4 + (registers * 4)
+	data = port.read(bands * bandSize)
+	if len(data) != (bands * bandSize):
+		raise IOError("short reply (%d bytes)" % len(data))
+
+	states = []
+	for b in range(bands):
+		chunk = data[(b * bandSize):((b + 1) * bandSize)]
+		states.append((bool(chunk[0]), bool(chunk[1]), bool(chunk[2]), bool(chunk[3]), struct.unpack(">%dI" % registers, chunk[4:])))
+
+	return (stats, states)
+
+
+def printHRC6000Page(page, written, skipped, registers):
+	print("HR-C6000 page 0x%02X (%d written, %d skipped transfers, all pages)" % (page, written, skipped))
+	for row in range(0, 256, 16):
+		cells = [("%02X" % v) if v is not None else "--" for v in registers[row:(row + 16)]]
+		print("  %02X: %s" % (row, " ".join(cells)))
+
+
+def printRadio(stats, states):
+	print("Synthesisers: %d written, %d skipped transfers" % (stats[0], stats[1]))
+	print("IF chips:     %d written, %d skipped transfers" % (stats[2], stats[3]))
+	for (b, (synthValid, synthTx, ifValid, ifWide, registers)) in enumerate(states):
+		name = BAND_NAMES[b] if b < len(BAND_NAMES) else str(b)
+		print("%s: synthesiser %s, IF %s" % (name, ("locked for " + ("Tx" if synthTx else "Rx")) if synthValid else "unknown",
+				("wide" if ifWide else "narrow") if ifValid else "unknown"))
+		if synthValid:
+			print("  " + " ".join("%02X:%05X" % (a, v) for (a, v) in enumerate(registers)))
+
+
+def main():
+	import serial
+
+	parser = argparse.ArgumentParser(description="Radio registers shadows dump")
+	parser.add_argument("port")
+	args = parser.parse_args()
+
+	with serial.Serial(args.port, 115200, timeout=1.0) as port:
+		try:
+			pages = [(page,) + readHRC6000Page(port, page) for page in HRC6000_PAGES]
+			(stats, states) = readRadio(port)
+		except IOError as e:
+			sys.exit(str(e))
+
+	for page in pages:
+		printHRC6000Page(*page)
+	printRadio(stats, states)
+
+
+if __name__ == "__main__":
+	main()
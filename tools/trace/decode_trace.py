@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+#
+# Decodes the firmware binary trace records (see application/include/functions/trace.h).
+#
+# The records are either read from a file holding the RTT trace channel output (e.g. captured with
+# JLinkRTTLogger on channel 1), or polled from the radio with the CPS 'T' command.
+#
+# Usage:
+#   decode_trace.py --file trace.bin
+#   decode_trace.py --port /dev/ttyACM0
+#
+# The firmware has to be built with USING_TRACE defined. Polling the radio requires pyserial.
+#
+import argparse
+import struct
+import sys
+import time
+
+RECORD_FORMAT = "<II4I"
+RECORD_SIZE = struct.calcsize(RECORD_FORMAT)
+
+# Format strings, indexed by the traceEvent_t values. Keep in sync with trace.h (IDs are never reused).
+EVENTS = {
+	1: ("DROPPED", "{0} records lost, the ring was full"),
+	2: ("HRC_SYS_IRQ", "reg 0x82=0x{0:02X} reg 0x52=0x{1:02X}"),
+	3: ("HRC_TIMESLOT_IRQ", "state={0} timecode={1}"),
+	4: ("HRC_TX_IRQ", "state={0}"),
+	5: ("TA_TX_FLAG", "flag=0x{0:02X}"),
+	6: ("DMR_RX_AGC", "peak average={0} gain={1} DAC gain={2}"),
+	7: ("DMR_TS_EDGE", ""),
+	8: ("DMR_SLOT_STATE", "{0} -> {1}"),
+	9: ("DMR_RX_DATA", "sync class={0} data type={1} CRC valid={2} sync type={3}"),
+	10: ("DMR_LC_RECEIVED", "FLCO=0x{0:02X} CRC valid={1} dst={2} src={3}"),
+	11: ("DMR_TX_OFF", "state={0}"),
+	12: ("DMR_TX_BURST_CALLBACK", "state={0}"),
+}
+
+EVENT_IDS = dict((name, event) for (event, (name, fmt)) in EVENTS.items())
+
+
+def toSigned(value):
+	return value - (1 << 32) if value & 0x80000000 else value
+
+
+def parseRecord(record):
+	(header, timestamp, a0, a1, a2, a3) = struct.unpack(RECORD_FORMAT, record)
+	argCount = header & 0xFF
+
+	return (header >> 8, timestamp, [toSigned(a) for a in (a0, a1, a2, a3)[:argCount]])
+
+
+class Decoder:
+	def __init__(self, clock):
+		self.clock = clock
+		self.lastTimestamp = None
+		self.ticks = 0
+
+	# Returns the record time, in seconds since the first record
+	def elapsed(self, timestamp):
+		# The counter wraps, and records can be slightly out of order (an ISR preempting a writer)
+		if self.lastTimestamp is not None:
+			self.ticks += toSigned((timestamp - self.lastTimestamp) & 0xFFFFFFFF)
+		self.lastTimestamp = timestamp
+
+		return self.ticks / self.clock
+
+	def decode(self, record):
+		(event, timestamp, args) = parseRecord(record)
+		argCount = len(args)
+		seconds = self.elapsed(timestamp)
+
+		(name, fmt) = EVENTS.get(event, ("EVENT_%d" % event, " ".join("{%d}" % i for i in range(argCount))))
+		try:
+			text = fmt.format(*args)
+		except (IndexError, ValueError):
+			text = " ".join(str(a) for a in args)
+
+		return "%12.6f  %-21s %s" % (seconds, name, text)
+
+
+# Yields the raw records of an RTT trace channel capture
+def fileRecords(path):
+	with open(path, "rb") as f:
+		data = f.read()
+
+	for offset in range(0, len(data) - RECORD_SIZE + 1, RECORD_SIZE):
+		yield data[offset:offset + RECORD_SIZE]
+
+
+# Yields the raw records polled from the radio, until the duration (in seconds) has elapsed, or forever
+def radioRecords(portName, interval, duration=None):
+	import serial
+
+	end = (time.monotonic() + duration) if duration is not None else None
+
+	with serial.Serial(portName, 115200, timeout=1.0) as port:
+		port.reset_input_buffer()
+		while (end is None) or (time.monotonic() < end):
+			port.write(b"T")
+			header = port.read(4)
+			if len(header) != 4 or header[0:1] != b"T":
+				raise IOError("request rejected (%r), is the firmware built with USING_TRACE?" % header)
+
+			payload = port.read(header[1] * RECORD_SIZE)
+			for offset in range(0, len(payload) - RECORD_SIZE + 1, RECORD_SIZE):
+				yield payload[offset:offset + RECORD_SIZE]
+
+			if header[1] == 0:
+				sys.stdout.flush()
+				time.sleep(interval)
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Firmware binary trace decoder")
+	source = parser.add_mutually_exclusive_group(required=True)
+	source.add_argument("--file", help="RTT trace channel capture")
+	source.add_argument("--port", help="poll the radio on this serial port")
+	parser.add_argument("--clock", type=float, default=1e6, help="timestamp counter frequency (firmware CPU_STATS_COUNTER_FREQUENCY), in Hz")
+	parser.add_argument("--interval", type=float, default=0.05, help="polling interval when the ring is empty, in seconds")
+	args = parser.parse_args()
+
+	decoder = Decoder(args.clock)
+
+	try:
+		records = fileRecords(args.file) if args.file else radioRecords(args.port, args.interval)
+		for record in records:
+			print(decoder.decode(record))
+	except KeyboardInterrupt:
+		pass
+
+
+if __name__ == "__main__":
+	main()
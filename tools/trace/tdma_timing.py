@@ -0,0 +1,215 @@
+#!/usr/bin/env python3
+#
+# DMR TDMA timing analysis of the firmware binary trace (see application/include/functions/trace.h and decode_trace.py).
+#
+# The DMR_TS_EDGE records, traced first thing in the timeslot ISR, give the 30ms slot grid: the script reports the
+# jitter of their intervals, the missed edges, the Tx bursts starting late or lasting too short/long relative to that
+# grid, and the repeater wake attempts, with the slot state transitions they went through.
+#
+# Usage:
+#   tdma_timing.py --file trace.bin
+#   tdma_timing.py --port /dev/ttyACM0 --duration 30 --save trace.bin --plot
+#
+# The firmware has to be built with USING_TRACE defined. Polling the radio requires pyserial, --plot requires matplotlib.
+#
+import argparse
+import statistics
+
+from decode_trace import EVENT_IDS, Decoder, fileRecords, parseRecord, radioRecords
+
+SLOT_PERIOD = 0.030
+
+# enum DMR_SLOT_STATE, in application/include/hardware/HR-C6000.h
+SLOT_STATES = ("IDLE", "RX_1", "RX_2", "RX_END",
+		"TX_START_1", "TX_START_2", "TX_START_3", "TX_START_4", "TX_START_5",
+		"TX_1", "TX_2", "TX_END_1", "TX_END_2", "TX_END_3_RMO", "TX_END_3_DMO",
+		"REPEATER_WAKE_1", "REPEATER_WAKE_2", "REPEATER_WAKE_3",
+		"REPEATER_WAKE_FAIL_1", "REPEATER_WAKE_FAIL_2")
+
+
+def stateName(state):
+	return SLOT_STATES[state] if 0 <= state < len(SLOT_STATES) else str(state)
+
+
+def loadEvents(records, clock):
+	decoder = Decoder(clock)
+	events = []
+
+	for record in records:
+		(event, timestamp, args) = parseRecord(record)
+		events.append((decoder.elapsed(timestamp), event, args))
+
+	# Records of different writers can be slightly out of order
+	events.sort(key=lambda e: e[0])
+	return events
+
+
+def slotGrid(events):
+	edges = [t for (t, event, args) in events if event == EVENT_IDS["DMR_TS_EDGE"]]
+	jitter = []
+	missed = []
+
+	for (previous, current) in zip(edges, edges[1:]):
+		interval = current - previous
+		slots = max(1, int(round(interval / SLOT_PERIOD)))
+
+		if slots > 1:
+			missed.append((previous, slots - 1))
+		jitter.append((current, interval - (slots * SLOT_PERIOD)))
+
+	return (edges, jitter, missed)
+
+
+def lastEdgeBefore(edges, t, start):
+	while (start + 1) < len(edges) and edges[start + 1] <= t:
+		start += 1
+	return start
+
+
+def txBursts(events, edges):
+	bursts = []
+	edgeIndex = 0
+	start = None
+
+	for (t, event, args) in events:
+		if event == EVENT_IDS["HRC_TX_IRQ"]:
+			edgeIndex = lastEdgeBefore(edges, t, edgeIndex)
+			offset = (t - edges[edgeIndex]) if (edges and edges[edgeIndex] <= t) else None
+			start = (t, offset, args[0] if args else -1)
+		elif event == EVENT_IDS["DMR_TX_OFF"] and start is not None:
+			bursts.append((start[0], start[1], t - start[0], start[2]))
+			start = None
+
+	return bursts
+
+
+def wakeAttempts(events):
+	attempts = []
+	current = None
+
+	for (t, event, args) in events:
+		if event != EVENT_IDS["DMR_SLOT_STATE"] or len(args) < 2:
+			continue
+
+		(previous, state) = args
+		if stateName(state) == "REPEATER_WAKE_1" and current is None:
+			current = [t, []]
+		if current is not None:
+			current[1].append((t - current[0], stateName(previous), stateName(state)))
+			if stateName(state) in ("RX_1", "IDLE", "REPEATER_WAKE_FAIL_1", "REPEATER_WAKE_FAIL_2") and len(current[1]) > 1:
+				attempts.append((current[0], (stateName(state) == "RX_1"), current[1]))
+				current = None
+
+	if current is not None:
+		attempts.append((current[0], None, current[1]))
+
+	return attempts
+
+
+def printStats(title, values):
+	if not values:
+		print("%s: none" % title)
+		return
+
+	us = [v * 1e6 for v in values]
+	print("%s: %d, min %.1f us, mean %.1f us, max %.1f us, stdev %.1f us" %
+			(title, len(us), min(us), statistics.mean(us), max(us), statistics.pstdev(us)))
+
+
+def printHistogram(values, binWidth):
+	bins = {}
+
+	for v in values:
+		b = int((v * 1e6) // binWidth)
+		bins[b] = bins.get(b, 0) + 1
+
+	for b in sorted(bins):
+		print("  %8.0f .. %8.0f us %8d %s" % (b * binWidth, (b + 1) * binWidth, bins[b], "#" * min(60, bins[b])))
+
+
+def plot(jitter, bursts, lateThreshold):
+	import matplotlib.pyplot as plt
+
+	(figure, (jitterAxes, burstAxes)) = plt.subplots(2, 1, sharex=True)
+
+	jitterAxes.plot([t for (t, j) in jitter], [j * 1e6 for (t, j) in jitter], ".", markersize=3)
+	jitterAxes.set_ylabel("slot interval jitter (us)")
+	jitterAxes.grid(True)
+
+	timed = [b for b in bursts if b[1] is not None]
+	late = [b for b in timed if b[1] > lateThreshold]
+	burstAxes.plot([b[0] for b in timed], [b[1] * 1e6 for b in timed], ".", markersize=3, label="Tx start")
+	burstAxes.plot([b[0] for b in late], [b[1] * 1e6 for b in late], "rx", label="late")
+	burstAxes.set_ylabel("Tx start after the slot edge (us)")
+	burstAxes.set_xlabel("time (s)")
+	burstAxes.grid(True)
+	burstAxes.legend()
+
+	plt.show()
+
+
+def main():
+	parser = argparse.ArgumentParser(description="DMR TDMA timing analysis")
+	source = parser.add_mutually_exclusive_group(required=True)
+	source.add_argument("--file", help="RTT trace channel capture, or a file saved with --save")
+	source.add_argument("--port", help="poll the radio on this serial port")
+	parser.add_argument("--duration", type=float, default=10.0, help="polling duration, in seconds")
+	parser.add_argument("--interval", type=float, default=0.02, help="polling interval when the ring is empty, in seconds")
+	parser.add_argument("--save", help="save the polled records to this file")
+	parser.add_argument("--clock", type=float, default=1e6, help="timestamp counter frequency (firmware CPU_STATS_COUNTER_FREQUENCY), in Hz")
+	parser.add_argument("--late", type=float, default=1000.0, help="Tx start offset after the slot edge reported as late, in us")
+	parser.add_argument("--bin", type=float, default=50.0, help="jitter histogram bin width, in us")
+	parser.add_argument("--plot", action="store_true", help="plot the slot jitter and the Tx start offsets")
+	args = parser.parse_args()
+
+	if args.file:
+		records = list(fileRecords(args.file))
+	else:
+		records = []
+		try:
+			for record in radioRecords(args.port, args.interval, args.duration):
+				records.append(record)
+		except KeyboardInterrupt:
+			pass
+
+		if args.save:
+			with open(args.save, "wb") as f:
+				f.write(b"".join(records))
+
+	events = loadEvents(records, args.clock)
+	dropped = sum(args[0] for (t, event, args) in events if event == EVENT_IDS["DROPPED"] and args)
+	if dropped:
+		print("WARNING: %d records were lost, the intervals spanning them are not reliable\n" % dropped)
+
+	(edges, jitter, missed) = slotGrid(events)
+	print("Slot edges: %d over %.3f s" % (len(edges), (edges[-1] - edges[0]) if len(edges) > 1 else 0.0))
+	printStats("Slot interval jitter", [j for (t, j) in jitter])
+	printHistogram([j for (t, j) in jitter], args.bin)
+	for (t, count) in missed:
+		print("  %12.6f  %d slot edge(s) missed" % (t, count))
+
+	bursts = txBursts(events, edges)
+	lateThreshold = args.late / 1e6
+	print()
+	printStats("Tx start after the slot edge", [b[1] for b in bursts if b[1] is not None])
+	printStats("Tx burst length", [b[2] for b in bursts])
+	for (t, offset, length, state) in bursts:
+		if (offset is not None) and (offset > lateThreshold):
+			print("  %12.6f  late Tx burst, +%.1f us after the slot edge, %.1f ms long, state %s" % (t, offset * 1e6, length * 1e3, stateName(state)))
+		elif length > SLOT_PERIOD:
+			print("  %12.6f  Tx burst overlapping the next slot, %.1f ms long, state %s" % (t, length * 1e3, stateName(state)))
+
+	attempts = wakeAttempts(events)
+	if attempts:
+		print("\nRepeater wake attempts:")
+		for (t, success, transitions) in attempts:
+			print("  %12.6f  %s" % (t, "awaken" if success else ("failed" if success is False else "unfinished")))
+			for (offset, previous, state) in transitions:
+				print("      +%9.3f ms  %s -> %s" % (offset * 1e3, previous, state))
+
+	if args.plot:
+		plot(jitter, bursts, lateThreshold)
+
+
+if __name__ == "__main__":
+	main()
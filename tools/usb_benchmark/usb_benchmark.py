@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+#
+# Runs the radio USB CDC benchmark (CPS 'B' command, see application/source/usb/usb_benchmark.c) and prints
+# the results measured by the radio, next to the host side ones.
+#
+# Modes:
+#   echo   the radio sends probes, this script sends them back, the radio records the round trip times
+#   sink   this script sends as fast as possible, the radio counts
+#   source the radio sends as fast as possible, this script counts and checks the sequence numbers
+#
+# Usage:
+#   usb_benchmark.py /dev/ttyACM0 echo --size 64 --duration 5000
+#   usb_benchmark.py COM5 all
+#
+# Requires pyserial. The protocol functions only use read()/write()/reset_input_buffer() on the port
+# object, so they can be driven by a simulated endpoint.
+#
+import argparse
+import struct
+import sys
+import time
+
+MODES = { "echo": 1, "sink": 2, "source": 3 }
+RESULT_FIELDS = ("duration", "rxBytes", "rxPackets", "txBytes", "txPackets", "rttSamples",
+		"rttLost", "rttMin", "rttMax", "rttP50", "rttP90", "rttP99")
+SETTLE_TIME = 0.3 # s, after the end of the run, for the pipes to drain
+
+
+def startBenchmark(port, mode, size, duration):
+	port.reset_input_buffer()
+	port.write(struct.pack(">cBBHH", b"B", 1, MODES[mode], size, duration))
+	reply = port.read(2)
+	if reply != b"B\x01":
+		raise IOError("benchmark rejected (%r)" % reply)
+
+
+def getResults(port):
+	port.reset_input_buffer()
+	port.write(b"B\x02")
+	reply = port.read(3 + (4 * len(RESULT_FIELDS)))
+	if len(reply) != (3 + (4 * len(RESULT_FIELDS))) or reply[0:2] != b"B\x02":
+		raise IOError("unexpected results (%r)" % reply)
+
+	results = dict(zip(RESULT_FIELDS, struct.unpack(">%dI" % len(RESULT_FIELDS), reply[3:])))
+	results["mode"] = reply[2]
+	return results
+
+
+def runEcho(port, size, duration):
+	host = { "bytes": 0 }
+	end = time.monotonic() + (duration / 1000.0)
+
+	while time.monotonic() < end:
+		data = port.read(size)
+		if data:
+			port.write(data)
+			host["bytes"] += len(data)
+
+	return host
+
+
+def runSink(port, size, duration):
+	host = { "bytes": 0 }
+	payload = bytes(i & 0xFF for i in range(size))
+	# Stop a bit early, the radio is back in CPS mode once the duration has elapsed
+	end = time.monotonic() + ((duration / 1000.0) * 0.95)
+
+	while time.monotonic() < end:
+		host["bytes"] += port.write(payload)
+
+	return host
+
+
+def runSource(port, size, duration):
+	host = { "bytes": 0, "sequenceErrors": 0 }
+	expected = 0
+	pending = bytearray()
+	end = time.monotonic() + (duration / 1000.0) + SETTLE_TIME
+
+	while time.monotonic() < end:
+		data = port.read(65536)
+		host["bytes"] += len(data)
+		pending.extend(data)
+
+		while len(pending) >= size:
+			(sequence,) = struct.unpack(">I", pending[0:4])
+			if sequence != expected:
+				host["sequenceErrors"] += 1
+			expected = sequence + 1
+			del pending[0:size]
+
+	return host
+
+
+RUNNERS = { "echo": runEcho, "sink": runSink, "source": runSource }
+
+
+def runMode(port, mode, size, duration):
+	startBenchmark(port, mode, size, duration)
+	host = RUNNERS[mode](port, size, duration)
+	time.sleep(SETTLE_TIME)
+	return (getResults(port), host)
+
+
+def printResults(mode, size, results, host):
+	seconds = max(results["duration"], 1) / 1000.0
+
+	print("%s, %d byte packets, %.1fs" % (mode, size, seconds))
+	print("  radio RX: %10.1f kB/s %8.0f packets/s" % ((results["rxBytes"] / 1024.0) / seconds, results["rxPackets"] / seconds))
+	print("  radio TX: %10.1f kB/s %8.0f packets/s" % ((results["txBytes"] / 1024.0) / seconds, results["txPackets"] / seconds))
+	print("  host:     %10.1f kB/s" % ((host["bytes"] / 1024.0) / seconds))
+
+	if "sequenceErrors" in host:
+		print("  sequence errors: %d" % host["sequenceErrors"])
+
+	if results["rttSamples"] > 0:
+		print("  round trip (us): min %d  p50 %d  p90 %d  p99 %d  max %d  (%d samples, %d lost)" %
+				(results["rttMin"], results["rttP50"], results["rttP90"], results["rttP99"], results["rttMax"],
+					results["rttSamples"], results["rttLost"]))
+
+
+def main():
+	import serial
+
+	parser = argparse.ArgumentParser(description="Radio USB CDC benchmark")
+	parser.add_argument("port")
+	parser.add_argument("mode", choices=(list(MODES.keys()) + ["all"]))
+	parser.add_argument("--size", type=int, default=64, help="packet size, in bytes (4..2048)")
+	parser.add_argument("--duration", type=int, default=5000, help="run duration, in ms (up to 60000)")
+	args = parser.parse_args()
+
+	modes = (list(MODES.keys()) if args.mode == "all" else [args.mode])
+
+	with serial.Serial(args.port, 115200, timeout=0.1) as port:
+		for mode in modes:
+			try:
+				(results, host) = runMode(port, mode, args.size, args.duration)
+			except IOError as e:
+				sys.exit("%s: %s" % (mode, e))
+
+			printResults(mode, args.size, results, host)
+
+
+if __name__ == "__main__":
+	main()